@@ -0,0 +1,314 @@
+"""
+Call tree of a trace log, built from its `.index` file.
+
+Every call entry in the index becomes a node, numbered in log order; node 0 is
+a virtual root. A call's parent is the call on top of the stack when it
+starts, and a return/exception closes the most recent call of its frame id
+together with the calls opened after it (those are marked "partial"). Since
+nodes are numbered in log order the numbering is a preorder walk, so:
+
+    descendants of k      nodes [k + 1, subtree_end[k])
+    children of k         children[child_begin[k] : child_begin[k + 1]]
+    siblings of k         children of parent[k]; k is at sibling_index[k]
+    calls of a frame id   frame_calls[frame_begin[i] : frame_begin[i + 1]]
+                          where frame_keys[i] is the frame id
+    calls at a location   a range of `locations`, sorted by (filename, lineno)
+
+A generator frame gets a new node each time it is resumed, under whichever
+call resumed it, so the tree has no cycles. `cycle` reports a cycle between
+frame ids (parent frame -> child frame edges), which means the tracer logged
+inconsistent events.
+
+`build_call_graph` in cpp/tracer_core.cpp produces the columns as bytes; this
+module falls back to the equivalent `_py_build_call_graph` when the extension
+is not built.
+"""
+
+import bisect
+import json
+from array import array
+from typing import Any, Dict, List, Optional, Sequence, Tuple
+
+NO_PARENT = 0xFFFFFFFF
+NO_END = -1
+STATUS_NAMES = (None, "return", "exception", "partial")
+STATUS_PARTIAL = 3
+
+ROOT_NAME = "<root>"
+
+# Column name -> array typecode, shared with call_graph::Graph.
+COLUMNS = {
+    "start": "Q",
+    "end": "q",
+    "frame_id": "Q",
+    "parent": "I",
+    "subtree_end": "I",
+    "child_begin": "I",
+    "children": "I",
+    "sibling_index": "I",
+    "filename": "I",
+    "func": "I",
+    "lineno": "I",
+    "status": "B",
+    "frame_keys": "Q",
+    "frame_begin": "I",
+    "frame_calls": "I",
+    "locations": "I",
+}
+
+
+def _read_calls(index_file: str, intern) -> List[Tuple[int, int, int, int, int, int]]:
+    """(position, frame_id, filename, func, lineno, type) of the call/return/exception entries."""
+    empty, unknown = intern(""), intern("N/A")
+    types = {"call": 0, "return": 1, "exception": 2}
+    calls = []
+    with open(index_file, "rb") as f:
+        for raw in f:
+            if raw.startswith(b"#"):
+                continue
+            try:
+                entry = json.loads(raw)
+                entry_type = types.get(entry["type"])
+                frame_id, position = int(entry["frame_id"]), int(entry["position"])
+                lineno = int(entry.get("lineno") or 0)
+            except (ValueError, KeyError, TypeError):
+                continue
+            if entry_type is None:
+                continue
+            filename, func = empty, unknown
+            if entry_type == 0:
+                if isinstance(entry.get("filename"), str):
+                    filename = intern(entry["filename"])
+                if isinstance(entry.get("func"), str):
+                    func = intern(entry["func"])
+            calls.append((position, frame_id, filename, func, lineno, entry_type))
+    return calls
+
+
+def _find_cycle(frame_id: Sequence[int], parent: Sequence[int], frame_count: int) -> List[int]:
+    """First cycle between frame ids found by a depth-first search in first-appearance order."""
+    count = len(frame_id)
+    if frame_count >= count:
+        return []
+    dense: Dict[int, int] = {}
+    for node in range(1, count):
+        dense.setdefault(frame_id[node], len(dense))
+    frames = list(dense)
+    successors: List[List[int]] = [[] for _ in frames]
+    edges = set()
+    for node in range(1, count):
+        if parent[node] == 0:
+            continue
+        edge = (dense[frame_id[parent[node]]], dense[frame_id[node]])
+        if edge not in edges:
+            edges.add(edge)
+            successors[edge[0]].append(edge[1])
+    white, gray, black = 0, 1, 2
+    color = [white] * len(frames)
+    came_from = [-1] * len(frames)
+    for origin in range(len(frames)):
+        if color[origin] != white:
+            continue
+        color[origin] = gray
+        stack = [[origin, 0]]
+        while stack:
+            top = stack[-1]
+            current = top[0]
+            if top[1] == len(successors[current]):
+                color[current] = black
+                stack.pop()
+                continue
+            neighbor = successors[current][top[1]]
+            top[1] += 1
+            if color[neighbor] == white:
+                color[neighbor] = gray
+                came_from[neighbor] = current
+                stack.append([neighbor, 0])
+            elif color[neighbor] == gray:
+                path = []
+                at = current
+                while at != neighbor:
+                    path.append(frames[at])
+                    at = came_from[at]
+                path.append(frames[neighbor])
+                return path[::-1]
+    return []
+
+
+def _py_build_call_graph(index_file: str) -> Dict[str, Any]:
+    """Pure Python version of tracer_core.build_call_graph, used when the extension is not built."""
+    strings: List[str] = []
+    ids: Dict[str, int] = {}
+
+    def intern(value: str) -> int:
+        if value not in ids:
+            ids[value] = len(strings)
+            strings.append(value)
+        return ids[value]
+
+    calls = _read_calls(index_file, intern)
+    calls.sort(key=lambda call: call[0])
+    root_name = intern(ROOT_NAME)
+
+    columns = {name: array(code) for name, code in COLUMNS.items()}
+    start, end, frame_id, parent = columns["start"], columns["end"], columns["frame_id"], columns["parent"]
+    filename, func, lineno, status = columns["filename"], columns["func"], columns["lineno"], columns["status"]
+
+    def add_node(position, frame, parent_node, file_id, func_id, line):
+        start.append(position)
+        end.append(NO_END)
+        frame_id.append(frame)
+        parent.append(parent_node)
+        filename.append(file_id)
+        func.append(func_id)
+        lineno.append(line)
+        status.append(0)
+        return len(start) - 1
+
+    add_node(0, 0, NO_PARENT, root_name, root_name, 0)
+    end[0] = 0
+    stack: List[int] = []
+    partial = set()
+    latest: Dict[int, int] = {}
+    on_stack: Dict[int, int] = {}
+    for position, frame, file_id, func_id, line, entry_type in calls:
+        if entry_type == 0:
+            node = add_node(position, frame, stack[-1] if stack else 0, file_id, func_id, line)
+            latest[frame] = node
+            on_stack[frame] = on_stack.get(frame, 0) + 1
+            stack.append(node)
+            continue
+        if frame in latest:
+            end[latest[frame]] = position
+            status[latest[frame]] = entry_type
+        if not on_stack.get(frame):
+            continue
+        while stack:
+            popped = stack.pop()
+            on_stack[frame_id[popped]] -= 1
+            if frame_id[popped] == frame:
+                break
+            partial.add(popped)
+    partial.update(stack)
+    for node in partial:
+        status[node] = STATUS_PARTIAL
+        end[node] = NO_END
+
+    count = len(start)
+    child_begin = columns["child_begin"]
+    child_begin.extend([0] * (count + 1))
+    for node in range(1, count):
+        child_begin[parent[node] + 1] += 1
+    for node in range(count):
+        child_begin[node + 1] += child_begin[node]
+    fill = list(child_begin[:count])
+    children, sibling_index = columns["children"], columns["sibling_index"]
+    children.extend([0] * (count - 1))
+    sibling_index.extend([0] * count)
+    for node in range(1, count):
+        p = parent[node]
+        sibling_index[node] = fill[p] - child_begin[p]
+        children[fill[p]] = node
+        fill[p] += 1
+    subtree_end = columns["subtree_end"]
+    subtree_end.extend(range(1, count + 1))
+    for node in range(count - 1, 0, -1):
+        p = parent[node]
+        subtree_end[p] = max(subtree_end[p], subtree_end[node])
+
+    frame_calls = sorted(range(count), key=lambda node: frame_id[node])
+    columns["frame_calls"].extend(frame_calls)
+    for i, node in enumerate(frame_calls):
+        if i == 0 or frame_id[node] != columns["frame_keys"][-1]:
+            columns["frame_keys"].append(frame_id[node])
+            columns["frame_begin"].append(i)
+    columns["frame_begin"].append(count)
+    columns["locations"].extend(sorted(range(1, count), key=lambda node: (filename[node], lineno[node])))
+
+    graph: Dict[str, Any] = {name: column.tobytes() for name, column in columns.items()}
+    graph["strings"] = strings
+    graph["cycle"] = _find_cycle(frame_id, parent, len(columns["frame_keys"]))
+    return graph
+
+
+try:
+    from .tracer_core import build_call_graph
+except ImportError:
+    # tracer_core is not built or was built for another Python version.
+    build_call_graph = _py_build_call_graph
+
+
+class CallGraph:
+    """Read-only view over the columns returned by `build_call_graph`."""
+
+    ROOT = 0
+
+    def __init__(self, graph: Dict[str, Any]):
+        for name, code in COLUMNS.items():
+            setattr(self, name, memoryview(graph[name]).cast(code))
+        self.strings: List[str] = list(graph["strings"])
+        self.cycle: List[int] = list(graph["cycle"])
+        self._string_ids: Dict[str, List[int]] = {}
+        for i, value in enumerate(self.strings):
+            self._string_ids.setdefault(value, []).append(i)
+
+    def __len__(self) -> int:
+        """Number of nodes, including the root."""
+        return len(self.start)
+
+    def calls_of(self, frame_id: int) -> Sequence[int]:
+        """Nodes of every call of a frame id in log order; frame id 0 is the root."""
+        i = bisect.bisect_left(self.frame_keys, frame_id)
+        if i == len(self.frame_keys) or self.frame_keys[i] != frame_id:
+            return ()
+        return self.frame_calls[self.frame_begin[i] : self.frame_begin[i + 1]]
+
+    def parent_of(self, node: int) -> Optional[int]:
+        parent = self.parent[node]
+        return None if parent == NO_PARENT else parent
+
+    def children_of(self, node: int) -> Sequence[int]:
+        return self.children[self.child_begin[node] : self.child_begin[node + 1]]
+
+    def descendants_of(self, node: int) -> range:
+        """Descendants in preorder, excluding the node itself."""
+        return range(node + 1, self.subtree_end[node])
+
+    def siblings_of(self, node: int) -> Tuple[Sequence[int], int]:
+        """The parent's children and the node's index among them; the root is its own only sibling."""
+        parent = self.parent_of(node)
+        if parent is None:
+            return (node,), 0
+        return self.children_of(parent), self.sibling_index[node]
+
+    def nodes_at(self, filename: str, lineno: int) -> List[int]:
+        """Calls starting at a location, in log order."""
+        nodes: List[int] = []
+        for file_id in self._string_ids.get(filename, ()):
+            key = (file_id, lineno)
+            first = bisect.bisect_left(self.locations, key, key=self._location_key)
+            last = bisect.bisect_right(self.locations, key, key=self._location_key)
+            nodes.extend(self.locations[first:last])
+        return sorted(nodes)
+
+    def _location_key(self, node: int) -> Tuple[int, int]:
+        return self.filename[node], self.lineno[node]
+
+    def filename_of(self, node: int) -> str:
+        return self.strings[self.filename[node]]
+
+    def func_of(self, node: int) -> str:
+        return self.strings[self.func[node]]
+
+    def end_of(self, node: int) -> Optional[int]:
+        end = self.end[node]
+        return None if end == NO_END else end
+
+    def status_of(self, node: int) -> Optional[str]:
+        """None, "return", "exception" or "partial"."""
+        return STATUS_NAMES[self.status[node]]
+
+
+def load_call_graph(index_file) -> CallGraph:
+    """Builds the call graph of a `.index` file, natively when tracer_core is available."""
+    return CallGraph(build_call_graph(str(index_file)))
@@ -2,12 +2,18 @@
 以较快的速度过滤掉不关心的代码文件，有用的再交给python层处理
 */
 #include <Python.h>
+#include <algorithm>
 #include <boolobject.h>
 #include <bytesobject.h>
 #include <ceval.h>
+#include <chrono>
+#include <condition_variable>
 #include <cpython/code.h>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <filesystem>
 #include <longobject.h>
 #include <mutex>
@@ -18,9 +24,12 @@
 #include <pytypedefs.h>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <tupleobject.h>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -195,8 +204,8 @@ private:
 public:
   TraceDispatcher(const char *target_path, PyObject *tracer_logic,
                   PyObject *config)
-      : target_path(fs::absolute(fs::path(target_path))), config(config),
-        trace_logic(tracer_logic) {
+      : target_path(fs::absolute(fs::path(target_path))),
+        trace_logic(tracer_logic), config(config) {
     Py_INCREF(trace_logic);
     Py_INCREF(config);
   }
@@ -246,12 +255,11 @@ public:
     frame_internal->f_trace_lines = 1;
   }
 
-  int handle_opcode_event(PyFrameObject *frame, PyObject *arg) {
+  int handle_opcode_event(PyFrameObject *frame, PyObject *) {
     if (bad_frame != nullptr && frame == bad_frame) {
       return 0;
     }
 
-    int lasti = PyFrame_GetLasti(frame);
     PyCodeObject *code = PyFrame_GetCode(frame);
 
     struct internal_frame *frame_internal = (struct internal_frame *)frame;
@@ -341,7 +349,7 @@ public:
     return 0;
   }
 
-  int handle_call_event(PyFrameObject *frame, PyObject *arg) {
+  int handle_call_event(PyFrameObject *frame, PyObject *) {
     if (is_target_frame(frame)) {
       {
         std::lock_guard<std::mutex> lock(cache_mutex);
@@ -376,7 +384,7 @@ public:
     return 0;
   }
 
-  int handle_line_event(PyFrameObject *frame, PyObject *arg) {
+  int handle_line_event(PyFrameObject *frame, PyObject *) {
     std::lock_guard<std::mutex> lock(cache_mutex);
     if (active_frames.find(frame) != active_frames.end()) {
       PyObject *ret = PyObject_CallMethod(trace_logic, "handle_line", "O",
@@ -434,8 +442,8 @@ typedef struct {
   PyObject_HEAD TraceDispatcher *dispatcher;
 } TraceDispatcherObject;
 
-static PyObject *TraceDispatcher_new(PyTypeObject *type, PyObject *args,
-                                     PyObject *kwargs) {
+static PyObject *TraceDispatcher_new(PyTypeObject *type, PyObject *,
+                                     PyObject *) {
   TraceDispatcherObject *self =
       (TraceDispatcherObject *)type->tp_alloc(type, 0);
   if (!self) {
@@ -445,7 +453,7 @@ static PyObject *TraceDispatcher_new(PyTypeObject *type, PyObject *args,
   return (PyObject *)self;
 }
 
-static PyObject *TraceDispatcher_start(PyObject *self, PyObject *args) {
+static PyObject *TraceDispatcher_start(PyObject *self, PyObject *) {
   TraceDispatcherObject *obj = (TraceDispatcherObject *)self;
   if (!obj->dispatcher) {
     PyErr_SetString(PyExc_RuntimeError, "Invalid dispatcher");
@@ -455,7 +463,7 @@ static PyObject *TraceDispatcher_start(PyObject *self, PyObject *args) {
   Py_RETURN_NONE;
 }
 
-static PyObject *TraceDispatcher_stop(PyObject *self, PyObject *args) {
+static PyObject *TraceDispatcher_stop(PyObject *self, PyObject *) {
   TraceDispatcherObject *obj = (TraceDispatcherObject *)self;
   if (!obj->dispatcher) {
     PyErr_SetString(PyExc_RuntimeError, "Invalid dispatcher");
@@ -491,8 +499,10 @@ static PyMethodDef TraceDispatcher_methods[] = {
     {nullptr, nullptr, 0, nullptr}};
 
 static void TraceDispatcher_dealloc(TraceDispatcherObject *self) {
+  PyTypeObject *type = Py_TYPE(self);
   self->dispatcher->~TraceDispatcher();
-  Py_TYPE(self)->tp_free((PyObject *)self);
+  type->tp_free((PyObject *)self);
+  Py_DECREF(type); // 堆类型的实例持有类型的引用
 }
 
 static int TraceDispatcher_init(TraceDispatcherObject *self, PyObject *args,
@@ -513,75 +523,2478 @@ static int TraceDispatcher_init(TraceDispatcherObject *self, PyObject *args,
   return 0;
 }
 
-static PyTypeObject TraceDispatcherType = {
-    PyVarObject_HEAD_INIT(nullptr,
-                          0) "tracer_core.TraceDispatcher", /* tp_name */
-    sizeof(TraceDispatcherObject),                          /* tp_basicsize */
-    0,                                                      /* tp_itemsize */
-    (destructor)TraceDispatcher_dealloc,                    /* tp_dealloc */
-    0,                                        /* tp_vectorcall_offset */
-    0,                                        /* tp_getattr */
-    0,                                        /* tp_setattr */
-    0,                                        /* tp_as_async */
-    0,                                        /* tp_repr */
-    0,                                        /* tp_as_number */
-    0,                                        /* tp_as_sequence */
-    0,                                        /* tp_as_mapping */
-    0,                                        /* tp_hash */
-    0,                                        /* tp_call */
-    0,                                        /* tp_str */
-    0,                                        /* tp_getattro */
-    0,                                        /* tp_setattro */
-    0,                                        /* tp_as_buffer */
-    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
-    "Trace dispatcher object",                /* tp_doc */
-    0,                                        /* tp_traverse */
-    0,                                        /* tp_clear */
-    0,                                        /* tp_richcompare */
-    0,                                        /* tp_weaklistoffset */
-    0,                                        /* tp_iter */
-    0,                                        /* tp_iternext */
-    TraceDispatcher_methods,                  /* tp_methods */
-    0,                                        /* tp_members */
-    0,                                        /* tp_getset */
-    0,                                        /* tp_base */
-    0,                                        /* tp_dict */
-    0,                                        /* tp_descr_get */
-    0,                                        /* tp_descr_set */
-    0,                                        /* tp_dictoffset */
-    (initproc)TraceDispatcher_init,           /* tp_init */
-    0,                                        /* tp_alloc */
-    TraceDispatcher_new,                      /* tp_new */
+// 用 PyType_Spec 按槽位名称创建类型，PyInit_tracer_core 中生成
+static PyType_Slot TraceDispatcher_slots[] = {
+    {Py_tp_dealloc, (void *)TraceDispatcher_dealloc},
+    {Py_tp_doc, (void *)"Trace dispatcher object"},
+    {Py_tp_methods, TraceDispatcher_methods},
+    {Py_tp_init, (void *)TraceDispatcher_init},
+    {Py_tp_new, (void *)TraceDispatcher_new},
+    {0, nullptr}};
+
+static PyType_Spec TraceDispatcher_spec = {
+    "tracer_core.TraceDispatcher", sizeof(TraceDispatcherObject), 0,
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, TraceDispatcher_slots};
+
+/*
+语句行表：给每一行记录它所在简单语句的起止行，供 source_cache.get_statement_info 使用，
+替代对整个文件 ast.parse + ast.walk。表按代码对象惰性构建，只扫描该代码对象覆盖的行
+（co_firstlineno 到 co_positions 中最大的结束行），挂在 co_extra 上随代码对象一起释放。
+
+扫描是一个简化的词法分析：只跟踪括号深度、字符串、注释和续行符，一个逻辑行就是一条语句。
+复合语句的头部（if/for/def/装饰器 ...）不算简单语句，与 stmt_line_table.py 的结果一致；
+同一行用分号隔开的多条语句作为一个整体。
+*/
+namespace stmt_span {
+
+constexpr uint32_t kNone = 0;             // 不属于简单语句，按单行处理
+constexpr uint32_t kUnknown = UINT32_MAX; // 起点在语句中间，交给 Python 层
+
+struct Table {
+  uint32_t first_line;
+  uint32_t count;
+  uint32_t spans[]; // count 对 (start, end)
+};
+
+static Py_ssize_t extra_index = -1;
+
+static void free_table(void *table) { std::free(table); }
+
+enum class Head { Simple, Compound, Soft };
+
+static bool is_ident_char(char c) {
+  return c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || (c & 0x80);
+}
+
+// 按逻辑行的第一个词判断是否为复合语句头部，match/case 是软关键字，要看行尾是否为冒号
+static Head classify(const char *p, const char *end) {
+  static const char *const compound[] = {
+      "if",     "elif", "else", "for",   "while", "try", "except",
+      "finally", "with", "def",  "class", "async", nullptr};
+  if (*p == '@') {
+    return Head::Compound;
+  }
+  const char *q = p;
+  while (q < end && is_ident_char(*q)) {
+    ++q;
+  }
+  std::string_view word(p, q - p);
+  for (const char *const *kw = compound; *kw; ++kw) {
+    if (word == *kw) {
+      return Head::Compound;
+    }
+  }
+  if (word == "match" || word == "case") {
+    return Head::Soft;
+  }
+  return Head::Simple;
+}
+
+// 一行中注释之外的最后一个非空白字符，假定行首不在字符串中
+static char last_significant(const char *p, const char *end) {
+  char last = 0;
+  char quote = 0;
+  for (; p < end; ++p) {
+    char c = *p;
+    if (quote) {
+      if (c == '\\') {
+        ++p;
+      } else if (c == quote) {
+        quote = 0;
+      }
+      continue;
+    }
+    if (c == '#') {
+      break;
+    }
+    if (c == '\'' || c == '"') {
+      quote = c;
+    }
+    if (c != ' ' && c != '\t' && c != '\f' && c != '\r') {
+      last = c;
+    }
+  }
+  return last;
+}
+
+struct LogicalLine {
+  uint32_t start = 0;
+  uint32_t body = 0; // 复合语句头部冒号之后同一逻辑行内的语句起始行
+  Head head = Head::Simple;
+  bool colon = false;
+  bool unknown = false; // 出现了多余的右括号
+  char last = 0;        // 括号外最后一个有效字符
+};
+
+// 逐行喂入源码，维护括号深度、字符串和续行状态，切分出逻辑行
+struct Scanner {
+  LogicalLine ll;
+  bool open = false;
+  int depth = 0;
+  char quote = 0; // 所在字符串的引号
+  bool triple = false;
+
+  // 返回这一行是否结束了当前逻辑行，结束时 ll 为该逻辑行
+  bool feed(const char *p, const char *end, uint32_t line) {
+    bool continued = false;
+    for (; p < end; ++p) {
+      char c = *p;
+      if (quote) {
+        if (c == '\\') {
+          if (++p == end) {
+            continued = true;
+          }
+        } else if (c == quote) {
+          if (!triple) {
+            quote = 0;
+          } else if (end - p >= 3 && p[1] == quote && p[2] == quote) {
+            quote = 0;
+            p += 2;
+          }
+        }
+        continue;
+      }
+      if (c == ' ' || c == '\t' || c == '\f' || c == '\r') {
+        continue;
+      }
+      if (c == '#') {
+        break;
+      }
+      if (c == '\\') {
+        continued = true;
+        break;
+      }
+      if (!open) {
+        open = true;
+        ll = LogicalLine();
+        ll.start = line;
+        ll.head = classify(p, end);
+      } else if (ll.colon && !ll.body) {
+        ll.body = line;
+      }
+      if (depth == 0) {
+        ll.last = c;
+      }
+      switch (c) {
+      case '(':
+      case '[':
+      case '{':
+        ++depth;
+        break;
+      case ')':
+      case ']':
+      case '}':
+        if (--depth < 0) {
+          // 多出来的右括号：扫描起点在括号表达式中间
+          depth = 0;
+          ll.unknown = true;
+        }
+        break;
+      case ':':
+        if (depth == 0 && ll.head == Head::Compound && !ll.colon) {
+          ll.colon = true;
+        }
+        break;
+      case '\'':
+      case '"':
+        quote = c;
+        triple = end - p >= 3 && p[1] == c && p[2] == c;
+        if (triple) {
+          p += 2;
+        }
+        break;
+      default:
+        break;
+      }
+    }
+    if (quote && !triple && !continued) {
+      quote = 0; // 未闭合的单行字符串，语法错误
+    }
+    if (open && depth == 0 && !quote && !continued) {
+      open = false;
+      return true;
+    }
+    return false;
+  }
+};
+
+static void fill(std::vector<uint32_t> &spans, uint32_t first_line,
+                 const LogicalLine &ll, bool unknown, uint32_t end) {
+  bool simple = ll.head == Head::Simple ||
+                (ll.head == Head::Soft && ll.last != ':');
+  uint32_t start = simple ? ll.start : ll.body;
+  for (uint32_t line = ll.start; line <= end; ++line) {
+    uint32_t *span = &spans[2 * (line - first_line)];
+    if (unknown || ll.unknown) {
+      span[0] = span[1] = kUnknown;
+    } else if (start && line >= start) {
+      span[0] = start;
+      span[1] = end;
+    }
+  }
+}
+
+static const char *line_at(PyObject *lines, uint32_t line, Py_ssize_t *size) {
+  return PyUnicode_AsUTF8AndSize(PyList_GET_ITEM(lines, line - 1), size);
+}
+
+/*
+lambda、推导式的代码对象可能从语句中间开始。判断依据：上一行以续行符、左括号、逗号或
+运算符结尾；上一行以字符串结尾而这一行以字符串开头；或者往后扫描到以逗号结尾的逻辑行
+之后，出现了多余的右括号
+*/
+static int starts_mid_statement(PyObject *lines, uint32_t first_line,
+                                uint32_t next_line) {
+  Py_ssize_t total = PyList_GET_SIZE(lines);
+  Py_ssize_t size;
+  if (first_line >= 2) {
+    const char *prev = line_at(lines, first_line - 1, &size);
+    if (!prev) {
+      return -1;
+    }
+    char last = last_significant(prev, prev + size);
+    if (last && std::strchr("\\([{,+-*/%&|^<>=.@~", last)) {
+      return 1;
+    }
+    // 跨行的隐式字符串拼接只能出现在括号中
+    const char *s = line_at(lines, first_line, &size);
+    if (!s) {
+      return -1;
+    }
+    const char *p = s;
+    while (p < s + size && (*p == ' ' || *p == '\t')) {
+      ++p;
+    }
+    for (int i = 0; i < 2 && p < s + size && std::strchr("rRbBfFuU", *p); ++i) {
+      ++p;
+    }
+    if ((last == '"' || last == '\'') && p < s + size &&
+        (*p == '"' || *p == '\'')) {
+      return 1;
+    }
+  }
+  Scanner scanner;
+  for (uint32_t line = next_line; (Py_ssize_t)line <= total; ++line) {
+    const char *s = line_at(lines, line, &size);
+    if (!s) {
+      return -1;
+    }
+    if (scanner.feed(s, s + size, line)) {
+      if (scanner.ll.unknown) {
+        return 1;
+      }
+      if (scanner.ll.last != ',') {
+        break;
+      }
+    }
+  }
+  return 0;
+}
+
+// 扫描 lines 中从 first_line 开始的行，直到越过 last_line 所在的逻辑行
+static Table *build(PyObject *lines, uint32_t first_line, uint32_t last_line,
+                    bool expression) {
+  Py_ssize_t total = PyList_GET_SIZE(lines);
+  std::vector<uint32_t> spans;
+  Scanner scanner;
+  bool first = true;
+  uint32_t line = first_line;
+  for (; (Py_ssize_t)line <= total; ++line) {
+    if (line > last_line && !scanner.open) {
+      break;
+    }
+    spans.push_back(kNone);
+    spans.push_back(kNone);
+    Py_ssize_t size;
+    const char *s = line_at(lines, line, &size);
+    if (!s) {
+      return nullptr;
+    }
+    if (scanner.feed(s, s + size, line)) {
+      int unknown = 0;
+      if (first && expression) {
+        unknown = starts_mid_statement(lines, first_line, line + 1);
+        if (unknown < 0) {
+          return nullptr;
+        }
+      }
+      fill(spans, first_line, scanner.ll, unknown, line);
+      first = false;
+    }
+  }
+  if (scanner.open) {
+    fill(spans, first_line, scanner.ll, false, line - 1);
+  }
+
+  uint32_t count = spans.size() / 2;
+  Table *table = static_cast<Table *>(
+      std::malloc(sizeof(Table) + spans.size() * sizeof(uint32_t)));
+  if (!table) {
+    PyErr_NoMemory();
+    return nullptr;
+  }
+  table->first_line = first_line;
+  table->count = count;
+  std::copy(spans.begin(), spans.end(), table->spans);
+  return table;
+}
+
+// 代码对象覆盖的最后一行：co_positions 中最大的结束行
+static long last_line_of(PyObject *code, long first_line) {
+  PyObject *positions = PyObject_CallMethod(code, "co_positions", nullptr);
+  if (!positions) {
+    return -1;
+  }
+  long last = first_line;
+  PyObject *item;
+  while ((item = PyIter_Next(positions))) {
+    PyObject *end_line = PyTuple_GET_ITEM(item, 1);
+    if (end_line != Py_None) {
+      last = std::max(last, PyLong_AsLong(end_line));
+    }
+    Py_DECREF(item);
+  }
+  Py_DECREF(positions);
+  return PyErr_Occurred() ? -1 : last;
+}
+
+static Table *get_table(PyCodeObject *code, PyObject *lines) {
+  void *extra = nullptr;
+  if (_PyCode_GetExtra((PyObject *)code, extra_index, &extra) < 0) {
+    return nullptr;
+  }
+  if (extra) {
+    return static_cast<Table *>(extra);
+  }
+  long last_line = last_line_of((PyObject *)code, code->co_firstlineno);
+  if (last_line < 0) {
+    return nullptr;
+  }
+  // <lambda>、<genexpr> 等表达式代码对象，<module> 和函数、类总是从语句开头开始
+  const char *name = PyUnicode_AsUTF8(code->co_name);
+  if (!name) {
+    return nullptr;
+  }
+  bool expression = name[0] == '<' && std::strcmp(name, "<module>") != 0;
+  Table *table = build(lines, code->co_firstlineno, last_line, expression);
+  if (table &&
+      _PyCode_SetExtra((PyObject *)code, extra_index, table) < 0) {
+    free_table(table);
+    return nullptr;
+  }
+  return table;
+}
+
+} // namespace stmt_span
+
+/*
+帧区间索引：把日志旁边的 .index（每行一个 JSON，记录 call/return/exception 在日志中的字节位置）
+转换成定长记录的二进制文件，供 trace_pager.py 用 mmap 分页读取调用树，打开大日志时不用整体解析。
+
+记录按 call 的位置排序，即调用树的先序遍历，一个帧的后代是紧跟着它的一段连续记录
+[i + 1, subtree_end)。父子关系按字节区间的包含关系确定，多线程交错导致的越界区间截断到父帧内。
+文件格式与 trace_pager.py 中的 _HEADER/_RECORD 保持一致。
+*/
+namespace frame_index {
+
+constexpr uint32_t kNoParent = UINT32_MAX;
+constexpr uint32_t kVersion = 1;
+
+enum Flags : uint32_t {
+  kOpen = 0,      // 没有结束记录，区间延伸到父帧或日志末尾
+  kReturned = 1,  // 以 return 行结束
+  kException = 2, // 以 exception 行结束
+};
+
+struct Record {
+  uint64_t start; // call 行的起始位置
+  uint64_t end;   // 结束行之后的位置
+  uint32_t frame_id;
+  uint32_t parent;
+  uint32_t subtree_end;
+  uint32_t child_count;
+  uint32_t depth;
+  uint32_t flags;
+};
+static_assert(sizeof(Record) == 40, "record layout is shared with Python");
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t count;
+  uint64_t log_size;
+  uint64_t index_size;
+  uint8_t reserved[24];
+};
+static_assert(sizeof(Header) == 64, "header layout is shared with Python");
+
+struct Entry {
+  std::string_view type;
+  uint64_t frame_id = 0;
+  uint64_t position = 0;
+  // 以下字段只有调用图用到；字符串保留 JSON 转义，不含引号
+  std::string_view filename;
+  std::string_view func;
+  uint64_t lineno = 0;
+  bool has_filename = false;
+  bool has_func = false;
+};
+
+static const char *skip_space(const char *p, const char *end) {
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+    ++p;
+  }
+  return p;
+}
+
+// 跳过一个 JSON 字符串（p 指向开头的引号），返回结尾引号之后的位置
+static const char *skip_string(const char *p, const char *end) {
+  for (++p; p < end; ++p) {
+    if (*p == '\\') {
+      ++p;
+    } else if (*p == '"') {
+      return p + 1;
+    }
+  }
+  return nullptr;
+}
+
+// 解析索引行的 type/frame_id/position（必需）和 filename/func/lineno，其余字段跳过
+static bool parse_entry(const char *p, const char *end, Entry &entry) {
+  p = skip_space(p, end);
+  if (p == end || *p != '{') {
+    return false;
+  }
+  bool has_type = false, has_frame = false, has_position = false;
+  ++p;
+  while (true) {
+    p = skip_space(p, end);
+    if (p < end && *p == '}') {
+      break;
+    }
+    if (p == end || *p != '"') {
+      return false;
+    }
+    const char *key_end = skip_string(p, end);
+    if (!key_end) {
+      return false;
+    }
+    std::string_view key(p + 1, key_end - p - 2);
+    p = skip_space(key_end, end);
+    if (p == end || *p != ':') {
+      return false;
+    }
+    p = skip_space(p + 1, end);
+    if (p == end) {
+      return false;
+    }
+    const char *value = p;
+    if (*p == '"') {
+      p = skip_string(p, end);
+      if (!p) {
+        return false;
+      }
+    } else {
+      while (p < end && *p != ',' && *p != '}') {
+        ++p;
+      }
+    }
+    if (key == "type" && *value == '"') {
+      entry.type = std::string_view(value + 1, p - value - 2);
+      has_type = true;
+    } else if (key == "filename" && *value == '"') {
+      entry.filename = std::string_view(value + 1, p - value - 2);
+      entry.has_filename = true;
+    } else if (key == "func" && *value == '"') {
+      entry.func = std::string_view(value + 1, p - value - 2);
+      entry.has_func = true;
+    } else if (key == "lineno") {
+      entry.lineno = std::strtoull(value, nullptr, 10);
+    } else if (key == "frame_id" || key == "position") {
+      char *num_end;
+      uint64_t number = std::strtoull(value, &num_end, 10);
+      if (num_end == value) {
+        return false;
+      }
+      (key == "frame_id" ? entry.frame_id : entry.position) = number;
+      (key == "frame_id" ? has_frame : has_position) = true;
+    }
+    p = skip_space(p, end);
+    if (p < end && *p == ',') {
+      ++p;
+    }
+  }
+  return has_type && has_frame && has_position;
+}
+
+static void add_entry(std::vector<Record> &records,
+                      std::unordered_map<uint64_t, uint32_t> &open,
+                      const Entry &entry) {
+  auto it = open.find(entry.frame_id);
+  if (entry.type == "call") {
+    if (it != open.end()) {
+      // 同一帧 ID 再次调用前没有 return（异常退出）：截止到新调用处
+      Record &previous = records[it->second];
+      if (previous.flags == kOpen) {
+        previous.end = entry.position;
+      }
+      open.erase(it);
+    }
+    open.emplace(entry.frame_id, (uint32_t)records.size());
+    records.push_back(Record{entry.position, 0, (uint32_t)entry.frame_id,
+                             kNoParent, 0, 0, 0, kOpen});
+  } else if (it != open.end() && entry.position >= records[it->second].start) {
+    Record &record = records[it->second];
+    record.end = entry.position;
+    if (entry.type == "return") {
+      record.flags = kReturned;
+      open.erase(it);
+    } else if (entry.type == "exception") {
+      record.flags = kException; // 异常可能被捕获，帧仍然可能 return
+    }
+  }
+}
+
+// 分块读取索引文件，对每个有效的行调用 on_entry
+template <typename OnEntry>
+static bool read_entries(const char *path, uint64_t &index_size,
+                         OnEntry &&on_entry) {
+  FILE *f = std::fopen(path, "rb");
+  if (!f) {
+    return false;
+  }
+  std::vector<char> buffer(1 << 20);
+  size_t kept = 0;
+  index_size = 0;
+  while (true) {
+    if (kept == buffer.size()) {
+      buffer.resize(buffer.size() * 2); // 超长的一行
+    }
+    size_t n = std::fread(buffer.data() + kept, 1, buffer.size() - kept, f);
+    index_size += n;
+    const char *p = buffer.data();
+    const char *end = p + kept + n;
+    while (p < end) {
+      const char *eol =
+          static_cast<const char *>(std::memchr(p, '\n', end - p));
+      if (!eol) {
+        if (n > 0) {
+          break; // 不完整的行留到下一块
+        }
+        eol = end;
+      }
+      Entry entry;
+      if (*p != '#' && parse_entry(p, eol, entry)) {
+        on_entry(entry);
+      }
+      p = eol + 1;
+    }
+    if (n == 0) {
+      break;
+    }
+    kept = p < end ? end - p : 0;
+    std::memmove(buffer.data(), p, kept);
+  }
+  bool ok = !std::ferror(f);
+  std::fclose(f);
+  return ok;
+}
+
+// 逐行生成记录，内存只与帧数有关
+static bool read_records(const char *path, std::vector<Record> &records,
+                         uint64_t &index_size) {
+  std::unordered_map<uint64_t, uint32_t> open; // frame_id -> 未结束的记录
+  return read_entries(path, index_size, [&](const Entry &entry) {
+    add_entry(records, open, entry);
+  });
+}
+
+static void link(std::vector<Record> &records, uint64_t log_size) {
+  std::vector<uint32_t> stack;
+  for (uint32_t i = 0; i < records.size(); ++i) {
+    Record &record = records[i];
+    while (!stack.empty() && records[stack.back()].end <= record.start) {
+      records[stack.back()].subtree_end = i;
+      stack.pop_back();
+    }
+    uint64_t limit = stack.empty() ? log_size : records[stack.back()].end;
+    if (record.end == 0 || record.end > limit) {
+      record.end = limit;
+      if (record.flags != kReturned || record.end < record.start) {
+        record.flags = kOpen;
+      }
+    }
+    if (record.end < record.start) {
+      record.end = record.start;
+    }
+    record.depth = (uint32_t)stack.size();
+    if (!stack.empty()) {
+      record.parent = stack.back();
+      ++records[stack.back()].child_count;
+    }
+    stack.push_back(i);
+  }
+  for (uint32_t index : stack) {
+    records[index].subtree_end = (uint32_t)records.size();
+  }
+}
+
+static bool write(const std::string &path, const std::vector<Record> &records,
+                  uint64_t log_size, uint64_t index_size) {
+  Header header = {};
+  std::memcpy(header.magic, "TRFRIDX1", 8);
+  header.version = kVersion;
+  header.record_size = sizeof(Record);
+  header.count = records.size();
+  header.log_size = log_size;
+  header.index_size = index_size;
+  std::string tmp = path + ".tmp";
+  FILE *f = std::fopen(tmp.c_str(), "wb");
+  if (!f) {
+    return false;
+  }
+  bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1 &&
+            (records.empty() ||
+             std::fwrite(records.data(), sizeof(Record), records.size(), f) ==
+                 records.size());
+  ok = std::fclose(f) == 0 && ok;
+  if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+    std::remove(tmp.c_str());
+    return false;
+  }
+  return true;
+}
+
+} // namespace frame_index
+
+static PyObject *build_frame_index(PyObject *, PyObject *args) {
+  const char *index_path;
+  const char *out_path;
+  unsigned long long log_size;
+  if (!PyArg_ParseTuple(args, "ssK", &index_path, &out_path, &log_size)) {
+    return nullptr;
+  }
+  std::vector<frame_index::Record> records;
+  uint64_t index_size = 0;
+  bool write_ok = false;
+  PyThreadState *save = PyEval_SaveThread();
+  bool read_ok = frame_index::read_records(index_path, records, index_size);
+  if (read_ok) {
+    frame_index::link(records, log_size);
+    write_ok = frame_index::write(out_path, records, log_size, index_size);
+  }
+  PyEval_RestoreThread(save);
+  if (!read_ok) {
+    return PyErr_SetFromErrnoWithFilename(PyExc_OSError, index_path);
+  }
+  if (!write_ok) {
+    return PyErr_SetFromErrnoWithFilename(PyExc_OSError, out_path);
+  }
+  return PyLong_FromSize_t(records.size());
+}
+
+/*
+调用图：gpt_lib/graph_tracer.py 的 GraphTraceLogExtractor 原来逐行 json.loads 索引，
+以帧 ID 为节点建 networkx 图，再递归 DFS 查环，大的追踪要几分钟还会超出递归深度。
+这里复用上面的索引解析，每个 call 记录是一个节点（0 号是虚拟根），按日志位置编号；
+父节点是调用时栈顶的节点，所以编号就是先序遍历，后代是连续区间 [k + 1, subtree_end)。
+子节点按 CSR 存放：children[child_begin[k], child_begin[k + 1])，
+sibling_index 是节点在父节点子列表中的序号，兄弟和后代查询都是 O(1) 的区间。
+各列以 bytes 返回，布局与 debugger/call_graph.py 的 _py_build_call_graph 一致。
+*/
+namespace call_graph {
+
+enum Status : uint8_t { kNone = 0, kReturn = 1, kException = 2, kPartial = 3 };
+
+struct Call {
+  uint64_t position;
+  uint64_t frame_id;
+  uint32_t filename;
+  uint32_t func;
+  uint32_t lineno;
+  uint8_t type; // 0 call, 1 return, 2 exception
+};
+
+struct Graph {
+  std::vector<uint64_t> start;
+  std::vector<int64_t> end; // -1 表示没有结束位置
+  std::vector<uint64_t> frame_id;
+  std::vector<uint32_t> parent;
+  std::vector<uint32_t> subtree_end;
+  std::vector<uint32_t> child_begin; // 节点数 + 1 项
+  std::vector<uint32_t> children;
+  std::vector<uint32_t> sibling_index;
+  std::vector<uint32_t> filename;
+  std::vector<uint32_t> func;
+  std::vector<uint32_t> lineno;
+  std::vector<uint8_t> status;
+  std::vector<uint64_t> frame_keys;  // 排序后的帧 ID，根节点是 0
+  std::vector<uint32_t> frame_begin; // 帧 ID 的调用是 frame_calls 中的区间
+  std::vector<uint32_t> frame_calls;
+  std::vector<uint32_t> locations;   // 按 (filename, lineno) 排序的节点
+  std::vector<uint64_t> cycle;       // 帧 ID 之间的一个环
+};
+
+// 字符串表，保留 JSON 转义，交给 Python 时再解码
+struct Strings {
+  std::unordered_map<std::string, uint32_t> ids;
+  std::vector<std::string> values;
+
+  uint32_t intern(std::string_view value) {
+    auto found = ids.find(std::string(value));
+    if (found != ids.end()) {
+      return found->second;
+    }
+    uint32_t id = (uint32_t)values.size();
+    values.emplace_back(value);
+    ids.emplace(values.back(), id);
+    return id;
+  }
+};
+
+static uint32_t add_node(Graph &graph, uint64_t start, uint64_t frame_id,
+                         uint32_t parent, uint32_t filename, uint32_t func,
+                         uint32_t lineno) {
+  graph.start.push_back(start);
+  graph.end.push_back(-1);
+  graph.frame_id.push_back(frame_id);
+  graph.parent.push_back(parent);
+  graph.filename.push_back(filename);
+  graph.func.push_back(func);
+  graph.lineno.push_back(lineno);
+  graph.status.push_back(kNone);
+  return (uint32_t)graph.start.size() - 1;
+}
+
+// 按栈模型建树：return/exception 结束同一帧 ID 最近的调用，并关闭其后打开的调用
+static void build_tree(std::vector<Call> &calls, Graph &graph,
+                       uint32_t root_name) {
+  auto by_position = [](const Call &a, const Call &b) {
+    return a.position < b.position;
+  };
+  if (!std::is_sorted(calls.begin(), calls.end(), by_position)) {
+    std::stable_sort(calls.begin(), calls.end(), by_position);
+  }
+  add_node(graph, 0, 0, UINT32_MAX, root_name, root_name, 0);
+  graph.end[0] = 0;
+  std::vector<uint32_t> stack;
+  std::vector<uint8_t> partial(1, 0);
+  std::unordered_map<uint64_t, uint32_t> latest;   // 帧 ID -> 最近的调用
+  std::unordered_map<uint64_t, uint32_t> on_stack; // 帧 ID -> 栈中的个数
+  for (const Call &call : calls) {
+    if (call.type == 0) {
+      uint32_t node =
+          add_node(graph, call.position, call.frame_id,
+                   stack.empty() ? 0 : stack.back(), call.filename, call.func,
+                   call.lineno);
+      partial.push_back(0);
+      latest[call.frame_id] = node;
+      on_stack[call.frame_id]++;
+      stack.push_back(node);
+      continue;
+    }
+    auto found = latest.find(call.frame_id);
+    if (found != latest.end()) {
+      graph.end[found->second] = (int64_t)call.position;
+      graph.status[found->second] = call.type == 1 ? kReturn : kException;
+    }
+    auto count = on_stack.find(call.frame_id);
+    if (count == on_stack.end() || count->second == 0) {
+      continue;
+    }
+    while (!stack.empty()) {
+      uint32_t popped = stack.back();
+      stack.pop_back();
+      on_stack[graph.frame_id[popped]]--;
+      if (graph.frame_id[popped] == call.frame_id) {
+        break;
+      }
+      partial[popped] = 1;
+    }
+  }
+  for (uint32_t node : stack) {
+    partial[node] = 1;
+  }
+  for (size_t node = 0; node < partial.size(); ++node) {
+    if (partial[node]) {
+      graph.status[node] = kPartial;
+      graph.end[node] = -1;
+    }
+  }
+}
+
+static void link(Graph &graph) {
+  uint32_t count = (uint32_t)graph.start.size();
+  graph.child_begin.assign(count + 1, 0);
+  for (uint32_t node = 1; node < count; ++node) {
+    graph.child_begin[graph.parent[node] + 1]++;
+  }
+  for (uint32_t node = 0; node < count; ++node) {
+    graph.child_begin[node + 1] += graph.child_begin[node];
+  }
+  // 节点按位置编号，子列表自然按调用顺序排列
+  std::vector<uint32_t> fill(graph.child_begin.begin(),
+                             graph.child_begin.end() - 1);
+  graph.children.resize(count > 0 ? count - 1 : 0);
+  graph.sibling_index.assign(count, 0);
+  for (uint32_t node = 1; node < count; ++node) {
+    uint32_t parent = graph.parent[node];
+    graph.sibling_index[node] = fill[parent] - graph.child_begin[parent];
+    graph.children[fill[parent]++] = node;
+  }
+  graph.subtree_end.resize(count);
+  for (uint32_t node = 0; node < count; ++node) {
+    graph.subtree_end[node] = node + 1;
+  }
+  for (uint32_t node = count; node-- > 1;) {
+    uint32_t parent = graph.parent[node];
+    graph.subtree_end[parent] =
+        std::max(graph.subtree_end[parent], graph.subtree_end[node]);
+  }
+
+  // 生成器每次恢复都是一次新的调用，帧 ID 相同
+  graph.frame_calls.resize(count);
+  for (uint32_t node = 0; node < count; ++node) {
+    graph.frame_calls[node] = node;
+  }
+  std::stable_sort(graph.frame_calls.begin(), graph.frame_calls.end(),
+                   [&](uint32_t a, uint32_t b) {
+                     return graph.frame_id[a] < graph.frame_id[b];
+                   });
+  for (uint32_t i = 0; i < count; ++i) {
+    uint64_t frame_id = graph.frame_id[graph.frame_calls[i]];
+    if (i == 0 || frame_id != graph.frame_keys.back()) {
+      graph.frame_keys.push_back(frame_id);
+      graph.frame_begin.push_back(i);
+    }
+  }
+  graph.frame_begin.push_back(count);
+
+  graph.locations.resize(count > 0 ? count - 1 : 0);
+  for (uint32_t node = 1; node < count; ++node) {
+    graph.locations[node - 1] = node;
+  }
+  std::stable_sort(graph.locations.begin(), graph.locations.end(),
+                   [&](uint32_t a, uint32_t b) {
+                     return graph.filename[a] != graph.filename[b]
+                                ? graph.filename[a] < graph.filename[b]
+                                : graph.lineno[a] < graph.lineno[b];
+                   });
+}
+
+// 帧 ID 之间的边（父帧 -> 子帧）只有在帧 ID 被再次调用时才可能成环；
+// 用显式栈做 DFS，按帧出现的顺序出发，找到第一个环即停止
+static void find_cycle(Graph &graph) {
+  uint32_t count = (uint32_t)graph.start.size();
+  if (graph.frame_keys.size() >= count) {
+    return; // 每个帧 ID 只调用一次，节点树就是帧图
+  }
+  std::unordered_map<uint64_t, uint32_t> dense;
+  std::vector<uint64_t> frames;
+  for (uint32_t node = 1; node < count; ++node) {
+    if (dense.emplace(graph.frame_id[node], (uint32_t)frames.size()).second) {
+      frames.push_back(graph.frame_id[node]);
+    }
+  }
+  std::vector<std::vector<uint32_t>> successors(frames.size());
+  std::unordered_set<uint64_t> edges;
+  for (uint32_t node = 1; node < count; ++node) {
+    uint32_t parent = graph.parent[node];
+    if (parent == 0) {
+      continue;
+    }
+    uint32_t from = dense[graph.frame_id[parent]];
+    uint32_t to = dense[graph.frame_id[node]];
+    if (edges.insert(((uint64_t)from << 32) | to).second) {
+      successors[from].push_back(to);
+    }
+  }
+  enum : uint8_t { kWhite, kGray, kBlack };
+  std::vector<uint8_t> color(frames.size(), kWhite);
+  std::vector<uint32_t> came_from(frames.size(), UINT32_MAX);
+  std::vector<std::pair<uint32_t, uint32_t>> stack; // (帧, 下一个后继)
+  for (uint32_t origin = 0; origin < frames.size(); ++origin) {
+    if (color[origin] != kWhite) {
+      continue;
+    }
+    color[origin] = kGray;
+    stack.emplace_back(origin, 0);
+    while (!stack.empty()) {
+      auto &[current, next] = stack.back();
+      if (next == successors[current].size()) {
+        color[current] = kBlack;
+        stack.pop_back();
+        continue;
+      }
+      uint32_t neighbor = successors[current][next++];
+      if (color[neighbor] == kWhite) {
+        color[neighbor] = kGray;
+        came_from[neighbor] = current;
+        stack.emplace_back(neighbor, 0);
+      } else if (color[neighbor] == kGray) {
+        std::vector<uint64_t> path;
+        for (uint32_t at = current; at != neighbor; at = came_from[at]) {
+          path.push_back(frames[at]);
+        }
+        path.push_back(frames[neighbor]);
+        graph.cycle.assign(path.rbegin(), path.rend());
+        return;
+      }
+    }
+  }
+}
+
+static bool load(const char *path, Graph &graph, Strings &strings) {
+  std::vector<Call> calls;
+  uint32_t empty = strings.intern("");
+  uint32_t unknown = strings.intern("N/A");
+  uint64_t index_size = 0;
+  bool ok = frame_index::read_entries(
+      path, index_size, [&](const frame_index::Entry &entry) {
+        uint8_t type;
+        if (entry.type == "call") {
+          type = 0;
+        } else if (entry.type == "return") {
+          type = 1;
+        } else if (entry.type == "exception") {
+          type = 2;
+        } else {
+          return;
+        }
+        Call call{entry.position, entry.frame_id, empty, unknown,
+                  (uint32_t)entry.lineno, type};
+        if (type == 0) {
+          if (entry.has_filename) {
+            call.filename = strings.intern(entry.filename);
+          }
+          if (entry.has_func) {
+            call.func = strings.intern(entry.func);
+          }
+        }
+        calls.push_back(call);
+      });
+  if (!ok) {
+    return false;
+  }
+  build_tree(calls, graph, strings.intern("<root>"));
+  link(graph);
+  find_cycle(graph);
+  return true;
+}
+
+template <typename T>
+static PyObject *column(const std::vector<T> &values) {
+  return PyBytes_FromStringAndSize(
+      reinterpret_cast<const char *>(values.data()),
+      values.size() * sizeof(T));
+}
+
+// JSON 转义的字符串交给 json.loads 解码，其余直接按 UTF-8 解码
+static PyObject *decode_strings(const Strings &strings) {
+  PyObject *result = PyList_New(strings.values.size());
+  PyObject *loads = nullptr;
+  for (size_t i = 0; result && i < strings.values.size(); ++i) {
+    const std::string &raw = strings.values[i];
+    PyObject *value;
+    if (raw.find('\\') == std::string::npos) {
+      value = PyUnicode_DecodeUTF8(raw.data(), raw.size(), "replace");
+    } else {
+      if (!loads) {
+        PyObject *json = PyImport_ImportModule("json");
+        loads = json ? PyObject_GetAttrString(json, "loads") : nullptr;
+        Py_XDECREF(json);
+      }
+      std::string quoted = "\"" + raw + "\"";
+      PyObject *text =
+          loads ? PyUnicode_DecodeUTF8(quoted.data(), quoted.size(), "replace")
+                : nullptr;
+      value = text ? PyObject_CallOneArg(loads, text) : nullptr;
+      Py_XDECREF(text);
+    }
+    if (!value) {
+      Py_CLEAR(result);
+      break;
+    }
+    PyList_SET_ITEM(result, i, value);
+  }
+  Py_XDECREF(loads);
+  return result;
+}
+
+} // namespace call_graph
+
+static PyObject *build_call_graph(PyObject *, PyObject *args) {
+  const char *index_path;
+  if (!PyArg_ParseTuple(args, "s", &index_path)) {
+    return nullptr;
+  }
+  call_graph::Graph graph;
+  call_graph::Strings strings;
+  PyThreadState *save = PyEval_SaveThread();
+  bool ok = call_graph::load(index_path, graph, strings);
+  PyEval_RestoreThread(save);
+  if (!ok) {
+    return PyErr_SetFromErrnoWithFilename(PyExc_OSError, index_path);
+  }
+  PyObject *cycle = PyList_New(graph.cycle.size());
+  for (size_t i = 0; cycle && i < graph.cycle.size(); ++i) {
+    PyObject *frame_id = PyLong_FromUnsignedLongLong(graph.cycle[i]);
+    if (!frame_id) {
+      Py_CLEAR(cycle);
+      break;
+    }
+    PyList_SET_ITEM(cycle, i, frame_id);
+  }
+  if (!cycle) {
+    return nullptr;
+  }
+  return Py_BuildValue(
+      "{sNsNsNsNsNsNsNsNsNsNsNsNsNsNsNsNsNsN}", "start",
+      call_graph::column(graph.start), "end", call_graph::column(graph.end),
+      "frame_id", call_graph::column(graph.frame_id), "parent",
+      call_graph::column(graph.parent), "subtree_end",
+      call_graph::column(graph.subtree_end), "child_begin",
+      call_graph::column(graph.child_begin), "children",
+      call_graph::column(graph.children), "sibling_index",
+      call_graph::column(graph.sibling_index), "filename",
+      call_graph::column(graph.filename), "func",
+      call_graph::column(graph.func), "lineno",
+      call_graph::column(graph.lineno), "status",
+      call_graph::column(graph.status), "frame_keys",
+      call_graph::column(graph.frame_keys), "frame_begin",
+      call_graph::column(graph.frame_begin), "frame_calls",
+      call_graph::column(graph.frame_calls), "locations",
+      call_graph::column(graph.locations), "strings",
+      call_graph::decode_strings(strings), "cycle", cycle);
+}
+
+/*
+执行行位图：记录一个帧执行过的行号，供 tracer_html.py 在帧返回前累积。
+位图从第一个 64 对齐的行号开始，按需向前后扩展；一个帧只属于一个代码对象，
+行号集中在 co_firstlineno 附近，所以通常只有一两个字。
+
+序列化为游程：先写第一个执行行，再交替写"连续执行的行数"和"跳过的行数"，
+都是 LEB128 变长整数。格式与 line_bitmap.py 的 encode_runs/decode_runs
+以及 tracer_scripts.js 的 decodeLineRuns 保持一致。
+*/
+namespace line_bitmap {
+
+struct Bitmap {
+  uint32_t base = 0; // words[0] 第 0 位对应的行号，64 的倍数
+  uint32_t count = 0;
+  std::vector<uint64_t> words;
+};
+
+static void add(Bitmap &bitmap, uint32_t line) {
+  uint32_t aligned = line & ~63u;
+  if (bitmap.words.empty()) {
+    bitmap.base = aligned;
+    bitmap.words.push_back(0);
+  } else if (aligned < bitmap.base) {
+    bitmap.words.insert(bitmap.words.begin(), (bitmap.base - aligned) / 64, 0);
+    bitmap.base = aligned;
+  }
+  size_t word = (line - bitmap.base) / 64;
+  if (word >= bitmap.words.size()) {
+    bitmap.words.resize(word + 1, 0);
+  }
+  uint64_t bit = 1ull << (line & 63);
+  if (!(bitmap.words[word] & bit)) {
+    bitmap.words[word] |= bit;
+    bitmap.count++;
+  }
+}
+
+// 按升序对每个执行行调用 fn
+template <typename Fn> static void for_each(const Bitmap &bitmap, Fn fn) {
+  for (size_t i = 0; i < bitmap.words.size(); i++) {
+    uint64_t word = bitmap.words[i];
+    while (word) {
+      fn(bitmap.base + (uint32_t)(i * 64) + (uint32_t)__builtin_ctzll(word));
+      word &= word - 1;
+    }
+  }
+}
+
+static void put_varint(std::string &out, uint32_t value) {
+  while (value >= 0x80) {
+    out.push_back((char)((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.push_back((char)value);
+}
+
+static std::string encode(const Bitmap &bitmap) {
+  std::string out;
+  uint32_t run_start = 0;
+  uint32_t prev = 0;
+  bool first = true;
+  for_each(bitmap, [&](uint32_t line) {
+    if (first) {
+      put_varint(out, line);
+      run_start = line;
+      first = false;
+    } else if (line != prev + 1) {
+      put_varint(out, prev + 1 - run_start);
+      put_varint(out, line - prev - 1);
+      run_start = line;
+    }
+    prev = line;
+  });
+  if (!first) {
+    put_varint(out, prev + 1 - run_start);
+  }
+  return out;
+}
+
+} // namespace line_bitmap
+
+typedef struct {
+  PyObject_HEAD line_bitmap::Bitmap *bitmap;
+} LineBitmapObject;
+
+static PyObject *LineBitmap_new(PyTypeObject *type, PyObject *args,
+                                PyObject *kwargs) {
+  if (!_PyArg_NoPositional("LineBitmap", args) ||
+      !_PyArg_NoKeywords("LineBitmap", kwargs)) {
+    return nullptr;
+  }
+  LineBitmapObject *self = (LineBitmapObject *)type->tp_alloc(type, 0);
+  if (!self) {
+    return nullptr;
+  }
+  self->bitmap = new line_bitmap::Bitmap();
+  return (PyObject *)self;
+}
+
+static void LineBitmap_dealloc(LineBitmapObject *self) {
+  PyTypeObject *type = Py_TYPE(self);
+  delete self->bitmap;
+  type->tp_free((PyObject *)self);
+  Py_DECREF(type); // 堆类型的实例持有类型的引用
+}
+
+static PyObject *LineBitmap_add(PyObject *self, PyObject *arg) {
+  long line = PyLong_AsLong(arg);
+  if (line == -1 && PyErr_Occurred()) {
+    return nullptr;
+  }
+  if (line < 0 || line > (long)INT32_MAX) {
+    PyErr_SetString(PyExc_ValueError, "line number out of range");
+    return nullptr;
+  }
+  line_bitmap::add(*((LineBitmapObject *)self)->bitmap, (uint32_t)line);
+  Py_RETURN_NONE;
+}
+
+static PyObject *LineBitmap_update(PyObject *self, PyObject *arg) {
+  if (Py_TYPE(arg) != Py_TYPE(self)) {
+    PyErr_SetString(PyExc_TypeError, "Argument must be a LineBitmap");
+    return nullptr;
+  }
+  line_bitmap::Bitmap &target = *((LineBitmapObject *)self)->bitmap;
+  line_bitmap::for_each(*((LineBitmapObject *)arg)->bitmap,
+                        [&](uint32_t line) { line_bitmap::add(target, line); });
+  Py_RETURN_NONE;
+}
+
+static PyObject *LineBitmap_lines(PyObject *self, PyObject *) {
+  const line_bitmap::Bitmap &bitmap = *((LineBitmapObject *)self)->bitmap;
+  PyObject *result = PyList_New(bitmap.count);
+  if (!result) {
+    return nullptr;
+  }
+  Py_ssize_t i = 0;
+  bool ok = true;
+  line_bitmap::for_each(bitmap, [&](uint32_t line) {
+    PyObject *item = ok ? PyLong_FromUnsignedLong(line) : nullptr;
+    if (!item) {
+      ok = false;
+      return;
+    }
+    PyList_SET_ITEM(result, i++, item);
+  });
+  if (!ok) {
+    Py_DECREF(result);
+    return nullptr;
+  }
+  return result;
+}
+
+static PyObject *LineBitmap_encode(PyObject *self, PyObject *) {
+  std::string encoded =
+      line_bitmap::encode(*((LineBitmapObject *)self)->bitmap);
+  return PyBytes_FromStringAndSize(encoded.data(), encoded.size());
+}
+
+static Py_ssize_t LineBitmap_len(PyObject *self) {
+  return ((LineBitmapObject *)self)->bitmap->count;
+}
+
+static PyMethodDef LineBitmap_methods[] = {
+    {"add", LineBitmap_add, METH_O, "Mark a line as executed"},
+    {"update", LineBitmap_update, METH_O,
+     "Merge the lines of another LineBitmap"},
+    {"lines", LineBitmap_lines, METH_NOARGS,
+     "Executed lines in ascending order"},
+    {"encode", LineBitmap_encode, METH_NOARGS,
+     "Run-length encoded lines, see line_bitmap.decode_runs"},
+    {nullptr, nullptr, 0, nullptr}};
+
+static PyType_Slot LineBitmap_slots[] = {
+    {Py_tp_dealloc, (void *)LineBitmap_dealloc},
+    {Py_tp_doc, (void *)"Executed lines of one frame as a bitmap"},
+    {Py_tp_methods, LineBitmap_methods},
+    {Py_tp_new, (void *)LineBitmap_new},
+    {Py_sq_length, (void *)LineBitmap_len},
+    {0, nullptr}};
+
+static PyType_Spec LineBitmap_spec = {"tracer_core.LineBitmap",
+                                      sizeof(LineBitmapObject), 0,
+                                      Py_TPFLAGS_DEFAULT, LineBitmap_slots};
+
+/*
+日志消息格式化：TraceLogic 的消息是 {"template": ..., "data": {...}}，原来控制台、文件和 HTML
+三个输出各自执行一次 template.format(**data)，每次都要把 data 复制成关键字参数并重新解析模板。
+这里把模板解析成 (字面量, 字段名, 字面量, ...) 元组按模板内容缓存，格式化时直接从 data 取值
+写入 _PyUnicodeWriter；tracer_common.format_log_message 把结果存在消息上，各输出共用一次格式化。
+只支持 {name} 和 {{ }} 转义，其他写法（格式说明、下标、位置参数）解析为 None，由调用方退回
+str.format。
+*/
+namespace log_format {
+
+constexpr Py_ssize_t kMaxTemplates = 4096;
+
+static PyObject *template_cache = nullptr; // 模板 -> 元组或 None
+
+static bool is_name_char(Py_UCS4 ch) {
+  return ch == '_' || (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') ||
+         (ch >= '0' && ch <= '9');
+}
+
+static bool flush_literal(_PyUnicodeWriter &literal, PyObject *parts) {
+  PyObject *text = _PyUnicodeWriter_Finish(&literal);
+  _PyUnicodeWriter_Init(&literal);
+  if (!text) {
+    return false;
+  }
+  int ret = PyList_Append(parts, text);
+  Py_DECREF(text);
+  return ret == 0;
+}
+
+// 返回新引用：元组，或不支持时的 None
+static PyObject *parse(PyObject *tmpl) {
+  Py_ssize_t length = PyUnicode_GET_LENGTH(tmpl);
+  int kind = PyUnicode_KIND(tmpl);
+  const void *data = PyUnicode_DATA(tmpl);
+  PyObject *parts = PyList_New(0);
+  if (!parts) {
+    return nullptr;
+  }
+  _PyUnicodeWriter literal;
+  _PyUnicodeWriter_Init(&literal);
+  Py_ssize_t i = 0;
+  while (i < length) {
+    Py_UCS4 ch = PyUnicode_READ(kind, data, i);
+    if (ch != '{' && ch != '}') {
+      if (_PyUnicodeWriter_WriteChar(&literal, ch) < 0) {
+        goto error;
+      }
+      i++;
+      continue;
+    }
+    if (i + 1 < length && PyUnicode_READ(kind, data, i + 1) == ch) {
+      if (_PyUnicodeWriter_WriteChar(&literal, ch) < 0) {
+        goto error;
+      }
+      i += 2;
+      continue;
+    }
+    Py_ssize_t end = i + 1;
+    while (end < length && is_name_char(PyUnicode_READ(kind, data, end))) {
+      end++;
+    }
+    Py_UCS4 first = end > i + 1 ? PyUnicode_READ(kind, data, i + 1) : '0';
+    if (ch == '}' || end >= length || PyUnicode_READ(kind, data, end) != '}' ||
+        (first >= '0' && first <= '9')) {
+      _PyUnicodeWriter_Dealloc(&literal);
+      Py_DECREF(parts);
+      Py_RETURN_NONE;
+    }
+    if (!flush_literal(literal, parts)) {
+      goto error;
+    }
+    PyObject *key = PyUnicode_Substring(tmpl, i + 1, end);
+    if (!key) {
+      goto error;
+    }
+    PyUnicode_InternInPlace(&key);
+    int ret = PyList_Append(parts, key);
+    Py_DECREF(key);
+    if (ret < 0) {
+      goto error;
+    }
+    i = end + 1;
+  }
+  if (!flush_literal(literal, parts)) {
+    Py_DECREF(parts);
+    return nullptr;
+  }
+  {
+    PyObject *result = PyList_AsTuple(parts);
+    Py_DECREF(parts);
+    return result;
+  }
+error:
+  _PyUnicodeWriter_Dealloc(&literal);
+  Py_DECREF(parts);
+  return nullptr;
+}
+
+// 返回新引用，模板解析失败时返回 nullptr
+static PyObject *get_parts(PyObject *tmpl) {
+  PyObject *parts = PyDict_GetItemWithError(template_cache, tmpl);
+  if (parts) {
+    Py_INCREF(parts);
+    return parts;
+  }
+  if (PyErr_Occurred()) {
+    return nullptr;
+  }
+  parts = parse(tmpl);
+  if (!parts) {
+    return nullptr;
+  }
+  // 模板几乎都是常量，超过上限说明有动态拼接的模板，整体清空即可
+  if (PyDict_GET_SIZE(template_cache) >= kMaxTemplates) {
+    PyDict_Clear(template_cache);
+  }
+  if (PyDict_SetItem(template_cache, tmpl, parts) < 0) {
+    Py_DECREF(parts);
+    return nullptr;
+  }
+  return parts;
+}
+
+static PyObject *format(PyObject *parts, PyObject *data) {
+  _PyUnicodeWriter writer;
+  _PyUnicodeWriter_Init(&writer);
+  writer.overallocate = 1;
+  Py_ssize_t count = PyTuple_GET_SIZE(parts);
+  for (Py_ssize_t i = 0; i < count; i++) {
+    PyObject *part = PyTuple_GET_ITEM(parts, i);
+    if (i % 2 == 0) {
+      if (PyUnicode_GET_LENGTH(part) &&
+          _PyUnicodeWriter_WriteStr(&writer, part) < 0) {
+        goto error;
+      }
+      continue;
+    }
+    PyObject *value = PyDict_GetItemWithError(data, part);
+    if (!value) {
+      if (!PyErr_Occurred()) {
+        PyErr_SetObject(PyExc_KeyError, part);
+      }
+      goto error;
+    }
+    if (PyUnicode_CheckExact(value)) {
+      if (_PyUnicodeWriter_WriteStr(&writer, value) < 0) {
+        goto error;
+      }
+      continue;
+    }
+    PyObject *text = PyObject_Format(value, nullptr);
+    if (!text) {
+      goto error;
+    }
+    int ret = _PyUnicodeWriter_WriteStr(&writer, text);
+    Py_DECREF(text);
+    if (ret < 0) {
+      goto error;
+    }
+  }
+  return _PyUnicodeWriter_Finish(&writer);
+error:
+  _PyUnicodeWriter_Dealloc(&writer);
+  return nullptr;
+}
+
+} // namespace log_format
+
+static PyObject *format_log(PyObject *, PyObject *args) {
+  PyObject *tmpl;
+  PyObject *data;
+  if (!PyArg_ParseTuple(args, "UO!", &tmpl, &PyDict_Type, &data)) {
+    return nullptr;
+  }
+  PyObject *parts = log_format::get_parts(tmpl);
+  if (!parts || parts == Py_None) {
+    return parts;
+  }
+  PyObject *result = log_format::format(parts, data);
+  Py_DECREF(parts);
+  return result;
+}
+
+/*
+输出队列：TraceLogic 原来用 queue.Queue 缓存消息，刷新线程每秒醒来逐条取出，取出和分发都持有 GIL。
+这里是多生产者单消费者的有界队列：被跟踪线程在 put 中只做一次加锁入队；消费线程在 get_batch 中
+释放 GIL 等待，队列攒够 batch_size 条或第一条消息等待超过 latency 后整批取出。
+
+队列满时的策略：
+  block       生产者释放 GIL 等待消费线程腾出空间（默认，不丢消息）
+  drop_oldest 丢弃最旧的消息
+  sample      超过 3/4 容量后每 sample_rate 条只保留一条，满了丢弃新消息
+消费线程自己产生的消息（例如跟踪跟踪器自身时）总是入队，避免自己等自己。
+*/
+namespace output_queue {
+
+enum class Policy { kBlock, kDropOldest, kSample };
+
+struct Queue {
+  std::mutex mutex;
+  std::condition_variable not_empty;
+  std::condition_variable not_full;
+  std::deque<PyObject *> items;
+  size_t capacity = 0;
+  size_t batch_size = 0;
+  size_t sample_rate = 0;
+  std::chrono::microseconds latency{0};
+  Policy policy = Policy::kBlock;
+  bool closed = false;
+  bool has_consumer = false;
+  std::thread::id consumer;
+  int waiting_producers = 0;
+  uint64_t accepted = 0;
+  uint64_t dropped = 0;
+  uint64_t blocked = 0;
+  uint64_t sample_counter = 0;
+  size_t max_depth = 0;
+};
+
+static bool parse_policy(const char *name, Policy &policy) {
+  std::string_view value(name);
+  if (value == "block") {
+    policy = Policy::kBlock;
+  } else if (value == "drop_oldest") {
+    policy = Policy::kDropOldest;
+  } else if (value == "sample") {
+    policy = Policy::kSample;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// 调用时持有 mutex
+static void push(Queue &queue, PyObject *item) {
+  queue.items.push_back(item);
+  queue.accepted++;
+  size_t size = queue.items.size();
+  queue.max_depth = std::max(queue.max_depth, size);
+  if (size == 1 || size == queue.batch_size) {
+    queue.not_empty.notify_one();
+  }
+}
+
+// 调用时持有 GIL，返回消息是否入队
+static bool put(Queue &queue, PyObject *item) {
+  while (true) {
+    std::unique_lock<std::mutex> lock(queue.mutex);
+    if (queue.closed) {
+      queue.dropped++;
+      return false;
+    }
+    bool is_consumer =
+        queue.has_consumer && queue.consumer == std::this_thread::get_id();
+    size_t size = queue.items.size();
+    if (queue.policy == Policy::kSample && !is_consumer &&
+        size >= queue.capacity - queue.capacity / 4 &&
+        queue.sample_counter++ % queue.sample_rate != 0) {
+      queue.dropped++;
+      return false;
+    }
+    if (size < queue.capacity || is_consumer) {
+      Py_INCREF(item);
+      push(queue, item);
+      return true;
+    }
+    if (queue.policy == Policy::kSample) {
+      queue.dropped++;
+      return false;
+    }
+    if (queue.policy == Policy::kDropOldest) {
+      PyObject *oldest = queue.items.front();
+      queue.items.pop_front();
+      queue.dropped++;
+      Py_INCREF(item);
+      push(queue, item);
+      lock.unlock();
+      Py_DECREF(oldest);
+      return true;
+    }
+    // kBlock：释放 GIL 后等待，让消费线程能运行输出处理函数
+    queue.blocked++;
+    queue.waiting_producers++;
+    lock.unlock();
+    PyThreadState *save = PyEval_SaveThread();
+    lock.lock();
+    queue.not_full.wait(lock, [&] {
+      return queue.closed || queue.items.size() < queue.capacity;
+    });
+    queue.waiting_producers--;
+    lock.unlock();
+    PyEval_RestoreThread(save);
+  }
+}
+
+// 调用时不持有 GIL，取出的引用交给调用方
+static void take_batch(Queue &queue, std::vector<PyObject *> &batch) {
+  std::unique_lock<std::mutex> lock(queue.mutex);
+  queue.consumer = std::this_thread::get_id();
+  queue.has_consumer = true;
+  queue.not_empty.wait(lock,
+                       [&] { return queue.closed || !queue.items.empty(); });
+  if (!queue.closed && queue.items.size() < queue.batch_size) {
+    queue.not_empty.wait_for(lock, queue.latency, [&] {
+      return queue.closed || queue.items.size() >= queue.batch_size;
+    });
+  }
+  size_t count = std::min(queue.items.size(), queue.batch_size);
+  batch.assign(queue.items.begin(), queue.items.begin() + count);
+  queue.items.erase(queue.items.begin(), queue.items.begin() + count);
+  if (queue.waiting_producers && count) {
+    queue.not_full.notify_all();
+  }
+}
+
+} // namespace output_queue
+
+typedef struct {
+  PyObject_HEAD output_queue::Queue *queue;
+} OutputQueueObject;
+
+static PyObject *list_from_items(const std::vector<PyObject *> &items) {
+  PyObject *result = PyList_New(items.size());
+  if (!result) {
+    for (PyObject *item : items) {
+      Py_DECREF(item);
+    }
+    return nullptr;
+  }
+  for (size_t i = 0; i < items.size(); i++) {
+    PyList_SET_ITEM(result, i, items[i]);
+  }
+  return result;
+}
+
+static PyObject *OutputQueue_new(PyTypeObject *type, PyObject *args,
+                                 PyObject *kwargs) {
+  Py_ssize_t capacity = 65536;
+  const char *policy_name = "block";
+  Py_ssize_t batch_size = 256;
+  double latency_ms = 50.0;
+  Py_ssize_t sample_rate = 10;
+  static const char *kwlist[] = {"capacity",   "policy",      "batch_size",
+                                 "latency_ms", "sample_rate", nullptr};
+  if (!PyArg_ParseTupleAndKeywords(
+          args, kwargs, "|nsndn", const_cast<char **>(kwlist), &capacity,
+          &policy_name, &batch_size, &latency_ms, &sample_rate)) {
+    return nullptr;
+  }
+  output_queue::Policy policy;
+  if (!output_queue::parse_policy(policy_name, policy)) {
+    PyErr_Format(PyExc_ValueError, "unknown output queue policy: %s",
+                 policy_name);
+    return nullptr;
+  }
+  if (capacity < 1 || batch_size < 1 || sample_rate < 1 || latency_ms < 0) {
+    PyErr_SetString(PyExc_ValueError,
+                    "capacity, batch_size and sample_rate must be positive");
+    return nullptr;
+  }
+  OutputQueueObject *self = (OutputQueueObject *)type->tp_alloc(type, 0);
+  if (!self) {
+    return nullptr;
+  }
+  self->queue = new output_queue::Queue();
+  self->queue->capacity = capacity;
+  self->queue->policy = policy;
+  self->queue->batch_size = batch_size;
+  self->queue->latency =
+      std::chrono::microseconds((int64_t)(latency_ms * 1000));
+  self->queue->sample_rate = sample_rate;
+  return (PyObject *)self;
+}
+
+static void OutputQueue_dealloc(OutputQueueObject *self) {
+  for (PyObject *item : self->queue->items) {
+    Py_DECREF(item);
+  }
+  PyTypeObject *type = Py_TYPE(self);
+  delete self->queue;
+  type->tp_free((PyObject *)self);
+  Py_DECREF(type); // 堆类型的实例持有类型的引用
+}
+
+static PyObject *OutputQueue_put(PyObject *self, PyObject *item) {
+  return PyBool_FromLong(
+      output_queue::put(*((OutputQueueObject *)self)->queue, item));
+}
+
+static PyObject *OutputQueue_get_batch(PyObject *self, PyObject *) {
+  std::vector<PyObject *> batch;
+  PyThreadState *save = PyEval_SaveThread();
+  output_queue::take_batch(*((OutputQueueObject *)self)->queue, batch);
+  PyEval_RestoreThread(save);
+  return list_from_items(batch);
+}
+
+static PyObject *OutputQueue_drain(PyObject *self, PyObject *) {
+  output_queue::Queue &queue = *((OutputQueueObject *)self)->queue;
+  std::vector<PyObject *> items;
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    items.assign(queue.items.begin(), queue.items.end());
+    queue.items.clear();
+    if (queue.waiting_producers) {
+      queue.not_full.notify_all();
+    }
+  }
+  return list_from_items(items);
+}
+
+static PyObject *OutputQueue_close(PyObject *self, PyObject *) {
+  output_queue::Queue &queue = *((OutputQueueObject *)self)->queue;
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.closed = true;
+  }
+  queue.not_empty.notify_all();
+  queue.not_full.notify_all();
+  Py_RETURN_NONE;
+}
+
+static PyObject *OutputQueue_stats(PyObject *self, PyObject *) {
+  output_queue::Queue &queue = *((OutputQueueObject *)self)->queue;
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  return Py_BuildValue("{s:n,s:K,s:K,s:K,s:n}", "queued",
+                       (Py_ssize_t)queue.items.size(), "accepted",
+                       (unsigned long long)queue.accepted, "dropped",
+                       (unsigned long long)queue.dropped, "blocked",
+                       (unsigned long long)queue.blocked, "max_depth",
+                       (Py_ssize_t)queue.max_depth);
+}
+
+static PyObject *OutputQueue_get_closed(PyObject *self, void *) {
+  output_queue::Queue &queue = *((OutputQueueObject *)self)->queue;
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  return PyBool_FromLong(queue.closed);
+}
+
+static Py_ssize_t OutputQueue_len(PyObject *self) {
+  output_queue::Queue &queue = *((OutputQueueObject *)self)->queue;
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  return queue.items.size();
+}
+
+static PyMethodDef OutputQueue_methods[] = {
+    {"put", OutputQueue_put, METH_O,
+     "Enqueue an item, returning False if it was dropped"},
+    {"get_batch", OutputQueue_get_batch, METH_NOARGS,
+     "Wait for the next batch without holding the GIL; [] once closed and "
+     "empty"},
+    {"drain", OutputQueue_drain, METH_NOARGS,
+     "Remove and return all queued items"},
+    {"close", OutputQueue_close, METH_NOARGS,
+     "Reject further items and wake all waiting threads"},
+    {"stats", OutputQueue_stats, METH_NOARGS,
+     "Counters: queued, accepted, dropped, blocked, max_depth"},
+    {nullptr, nullptr, 0, nullptr}};
+
+static PyGetSetDef OutputQueue_getset[] = {
+    {"closed", OutputQueue_get_closed, nullptr, "Whether close() was called",
+     nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr}};
+
+static PyType_Slot OutputQueue_slots[] = {
+    {Py_tp_dealloc, (void *)OutputQueue_dealloc},
+    {Py_tp_doc, (void *)"Bounded multi-producer output queue"},
+    {Py_tp_methods, OutputQueue_methods},
+    {Py_tp_getset, OutputQueue_getset},
+    {Py_tp_new, (void *)OutputQueue_new},
+    {Py_sq_length, (void *)OutputQueue_len},
+    {0, nullptr}};
+
+static PyType_Spec OutputQueue_spec = {"tracer_core.OutputQueue",
+                                       sizeof(OutputQueueObject), 0,
+                                       Py_TPFLAGS_DEFAULT, OutputQueue_slots};
+
+/*
+追踪日志对比：trace_diff.py 中 _py_split_threads / _py_diff_streams 的原生实现，
+对齐规则见该模块的说明。split_trace_threads 把一份日志（Python 二进制文件对象，
+按块 read()）逐行解析一遍，按线程把事件写入各自的分流文件；diff_trace_streams
+同步比较两个分流文件，只保存双方共同所在的调用栈和各自预读的一个事件，
+时间与日志大小成正比，内存与调用深度成正比。每处分歧回调
+record(kind, a, b, stack, a_events, b_events)，事件是 (kind, depth, text, lineno,
+position) 元组。文本按 UTF-8 字节比较，只在回调时解码；"# Debug: " 后缀的
+name=value 项排序后再比较。▷ 行按深度归到线程，规则同 trace_diff.py。
+
+分流文件的记录：kind(u8) depth(u32) lineno(u64) position(u64) size(u32)，
+本机字节序、无填充，其后是 size 字节的文本。
+*/
+namespace trace_diff {
+
+enum Kind { kCall, kReturn, kException, kLine };
+
+static const char *const kKindNames[] = {"call", "return", "exception", "line"};
+constexpr Py_ssize_t kReadSize = 1 << 20;
+
+// 行首标记的 UTF-8 编码
+constexpr std::string_view kCallMark = "\xe2\x86\x98";   // ↘
+constexpr std::string_view kReturnMark = "\xe2\x86\x97"; // ↗
+constexpr std::string_view kLineMark = "\xe2\x96\xb7";   // ▷
+constexpr std::string_view kExceptionMark = "\xe2\x9a\xa0 EXCEPTION";
+constexpr std::string_view kCRaiseMark = "\xe2\x9a\xa0 C-RAISE";
+constexpr std::string_view kDebugVars = " # Debug: ";
+
+struct Event {
+  int kind = kLine;
+  long depth = 0;
+  std::string text; // 去掉缩进、帧号、线程号和对象地址后的内容
+  long long lineno = 0;
+  long long position = 0;
+};
+
+constexpr size_t kSpillHeader = 1 + 4 + 8 + 8 + 4;
+constexpr size_t kSpillFlush = 1 << 18;
+
+// 按块读取 Python 文件对象
+struct Input {
+  PyObject *file = nullptr;
+  std::string buffer;
+  size_t offset = 0; // buffer 中未消费部分的起点
+  bool eof = false;
+};
+
+// 再读一块；返回 false 表示 Python 异常
+static bool fill(Input &input) {
+  input.buffer.erase(0, input.offset);
+  input.offset = 0;
+  PyObject *data = PyObject_CallMethod(input.file, "read", "n", kReadSize);
+  if (!data) {
+    return false;
+  }
+  char *bytes;
+  Py_ssize_t size;
+  if (PyBytes_AsStringAndSize(data, &bytes, &size) < 0) {
+    Py_DECREF(data);
+    return false;
+  }
+  input.buffer.append(bytes, size);
+  input.eof = size == 0;
+  Py_DECREF(data);
+  return true;
+}
+
+// 日志的逐行解析状态
+struct LogReader {
+  Input input;
+  long long position = 0; // 下一行在日志中的位置
+  long long lineno = 0;
+  std::unordered_map<long long, long> threads;       // 线程号 -> 序号
+  std::unordered_map<long long, long> frame_threads; // 未返回的帧所属线程
+  std::vector<std::vector<long>> stacks{1}; // 各线程未返回调用的深度
+  std::vector<long long> active{0}; // 各线程最近一次带线程标记事件的行号
+  long current = 0;
+};
+
+// 取下一行（不含换行符）；返回 1 成功，0 日志结束，-1 Python 异常
+static int read_line(LogReader &reader, std::string_view &line) {
+  Input &input = reader.input;
+  while (true) {
+    size_t newline = input.buffer.find('\n', input.offset);
+    bool found = newline != std::string::npos;
+    if (found || (input.eof && input.offset < input.buffer.size())) {
+      size_t end = found ? newline : input.buffer.size();
+      size_t consumed = end - input.offset + found;
+      line = std::string_view(input.buffer)
+                 .substr(input.offset, end - input.offset);
+      input.offset += consumed;
+      reader.position += consumed;
+      reader.lineno++;
+      return 1;
+    }
+    if (input.eof) {
+      return 0;
+    }
+    if (!fill(input)) {
+      return -1;
+    }
+  }
+}
+
+static const char *parse_number(const char *p, const char *end,
+                                long long &value) {
+  const char *start = p;
+  value = 0;
+  while (p < end && *p >= '0' && *p <= '9') {
+    value = value * 10 + (*p++ - '0');
+  }
+  return p > start ? p : nullptr;
+}
+
+// 查找 " [frame:N]" 及紧随其后的 "[thread:N]"，返回匹配区间
+static bool find_tag(std::string_view text, size_t &start, size_t &stop,
+                     long long &frame_id, long long &thread_id,
+                     bool &has_thread) {
+  constexpr std::string_view kFrame = "[frame:";
+  constexpr std::string_view kThread = "[thread:";
+  const char *end = text.data() + text.size();
+  for (size_t at = text.find(kFrame); at != std::string_view::npos;
+       at = text.find(kFrame, at + 1)) {
+    const char *p =
+        parse_number(text.data() + at + kFrame.size(), end, frame_id);
+    if (!p || p == end || *p != ']') {
+      continue;
+    }
+    p++;
+    has_thread = false;
+    if (std::string_view(p, end - p).substr(0, kThread.size()) ==
+        kThread) {
+      const char *q = parse_number(p + kThread.size(), end, thread_id);
+      if (q && q < end && *q == ']') {
+        has_thread = true;
+        p = q + 1;
+      }
+    }
+    start = at > 0 && text[at - 1] == ' ' ? at - 1 : at;
+    stop = p - text.data();
+    return true;
+  }
+  return false;
+}
+
+static bool is_hex(char c) {
+  return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') ||
+         (c >= 'A' && c <= 'F');
+}
+
+// " at 0x7f..." -> " at 0x?"
+static void mask_addresses(std::string &text) {
+  constexpr std::string_view kAddress = " at 0x";
+  size_t at = text.find(kAddress);
+  while (at != std::string::npos) {
+    size_t digits = at + kAddress.size();
+    size_t stop = digits;
+    while (stop < text.size() && is_hex(text[stop])) {
+      stop++;
+    }
+    if (stop > digits) {
+      text.replace(digits, stop - digits, "?");
+      stop = digits + 1;
+    }
+    at = text.find(kAddress, stop);
+  }
+}
+
+// ", " 之后是否为 "name="（name 不含空格、逗号和等号），与 _DEBUG_VAR_SEP 一致
+static bool starts_with_name(std::string_view text) {
+  size_t stop = text.find_first_of(" ,=");
+  return stop != std::string_view::npos && stop > 0 && text[stop] == '=';
+}
+
+// "# Debug: " 后缀的变量顺序每次运行都可能不同，按 name=value 项排序
+static void sort_debug_vars(std::string &text) {
+  size_t at = text.find(kDebugVars);
+  if (at == std::string::npos) {
+    return;
+  }
+  std::string_view rest = std::string_view(text).substr(at + kDebugVars.size());
+  std::vector<std::string_view> items;
+  size_t item = 0;
+  for (size_t comma = rest.find(", "); comma != std::string_view::npos;
+       comma = rest.find(", ", comma + 1)) {
+    if (starts_with_name(rest.substr(comma + 2))) {
+      items.push_back(rest.substr(item, comma - item));
+      item = comma + 2;
+    }
+  }
+  items.push_back(rest.substr(item));
+  std::sort(items.begin(), items.end());
+  std::string sorted(text, 0, at + kDebugVars.size());
+  for (size_t i = 0; i < items.size(); i++) {
+    if (i) {
+      sorted.append(", ");
+    }
+    sorted.append(items[i]);
+  }
+  text.swap(sorted);
+}
+
+// depth 处的 ▷ 行所属线程：最内层未返回调用在 depth - 1 的线程，
+// 优先上一个事件的线程，其次最近活动的线程，都不符合时仍取上一个事件的线程
+static long line_thread(const LogReader &reader, long depth) {
+  auto fits = [&](long thread) {
+    const std::vector<long> &stack = reader.stacks[thread];
+    return (stack.empty() ? -1 : stack.back()) == depth - 1;
+  };
+  if (fits(reader.current)) {
+    return reader.current;
+  }
+  long best = -1;
+  for (long thread = 0; thread < (long)reader.stacks.size(); thread++) {
+    if (fits(thread) &&
+        (best < 0 || reader.active[thread] > reader.active[best])) {
+      best = thread;
+    }
+  }
+  return best < 0 ? reader.current : best;
+}
+
+// 解析一行，不是事件时返回 false；更新当前线程
+static bool parse_event(LogReader &reader, std::string_view line,
+                        Event &event) {
+  while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) {
+    line.remove_suffix(1);
+  }
+  size_t indent = line.find_first_not_of(' ');
+  if (indent == std::string_view::npos) {
+    return false;
+  }
+  std::string_view text = line.substr(indent);
+  if (text.substr(0, kCallMark.size()) == kCallMark) {
+    event.kind = kCall;
+  } else if (text.substr(0, kReturnMark.size()) == kReturnMark) {
+    event.kind = kReturn;
+  } else if (text.substr(0, kLineMark.size()) == kLineMark) {
+    event.kind = kLine;
+  } else if (text.substr(0, kExceptionMark.size()) == kExceptionMark) {
+    event.kind = kException;
+  } else if (text.substr(0, kCRaiseMark.size()) == kCRaiseMark) {
+    event.kind = kReturn;
+  } else {
+    // ↳ 变量、多行语句的后续行、错误信息不参与比较
+    return false;
+  }
+  event.depth = indent / 2;
+  size_t start, stop;
+  long long frame_id, thread_id;
+  bool has_thread;
+  // ▷ 行没有帧号和线程号
+  if (event.kind != kLine &&
+      find_tag(text, start, stop, frame_id, thread_id, has_thread)) {
+    long owner = -1;
+    if (has_thread) {
+      auto inserted =
+          reader.threads.emplace(thread_id, (long)reader.threads.size());
+      owner = inserted.first->second;
+      if (reader.stacks.size() < reader.threads.size()) {
+        reader.stacks.resize(reader.threads.size());
+        reader.active.resize(reader.threads.size(), 0);
+      }
+      if (event.kind == kCall) {
+        reader.frame_threads[frame_id] = owner;
+      }
+    } else {
+      auto found = reader.frame_threads.find(frame_id);
+      if (found != reader.frame_threads.end()) {
+        owner = found->second;
+        if (event.kind == kReturn) {
+          reader.frame_threads.erase(found);
+        }
+      }
+    }
+    if (owner >= 0) {
+      reader.current = owner;
+      reader.active[owner] = reader.lineno;
+      std::vector<long> &stack = reader.stacks[owner];
+      if (event.kind == kCall) {
+        stack.push_back(event.depth);
+      } else if (event.kind == kReturn) {
+        while (!stack.empty() && stack.back() >= event.depth) {
+          stack.pop_back();
+        }
+      }
+    }
+    event.text.assign(text.substr(0, start));
+    event.text.append(text.substr(stop));
+  } else {
+    if (event.kind == kLine) {
+      reader.current = line_thread(reader, event.depth);
+    }
+    event.text.assign(text);
+  }
+  if (event.text.find("0x") != std::string::npos) {
+    mask_addresses(event.text);
+  }
+  sort_debug_vars(event.text);
+  return true;
+}
+
+// 一个线程的分流文件
+struct Spill {
+  PyObject *file = nullptr; // 新引用
+  std::string pending;      // 尚未写出的记录
+};
+
+static bool flush(Spill &spill) {
+  if (spill.pending.empty()) {
+    return true;
+  }
+  PyObject *data = PyBytes_FromStringAndSize(spill.pending.data(),
+                                             spill.pending.size());
+  if (!data) {
+    return false;
+  }
+  PyObject *result = PyObject_CallMethod(spill.file, "write", "O", data);
+  Py_DECREF(data);
+  Py_XDECREF(result);
+  spill.pending.clear();
+  return result != nullptr;
+}
+
+static void append_event(std::string &out, const Event &event) {
+  char header[kSpillHeader];
+  uint8_t kind = (uint8_t)event.kind;
+  uint32_t depth = (uint32_t)event.depth;
+  uint64_t lineno = (uint64_t)event.lineno;
+  uint64_t position = (uint64_t)event.position;
+  uint32_t size = (uint32_t)event.text.size();
+  char *p = header;
+  std::memcpy(p, &kind, 1);
+  std::memcpy(p += 1, &depth, 4);
+  std::memcpy(p += 4, &lineno, 8);
+  std::memcpy(p += 8, &position, 8);
+  std::memcpy(p += 8, &size, 4);
+  out.append(header, kSpillHeader);
+  out.append(event.text);
+}
+
+// 把日志按线程分流，new_spill() 依次为线程 0、1、… 返回可写的二进制文件；
+// 返回线程数，-1 表示 Python 异常
+static long split(PyObject *file, PyObject *new_spill) {
+  LogReader reader;
+  reader.input.file = file;
+  std::vector<Spill> spills;
+  Event event;
+  std::string_view line;
+  bool ok = true;
+  while (ok) {
+    long long start = reader.position;
+    int status = read_line(reader, line);
+    if (status <= 0) {
+      ok = status == 0;
+      break;
+    }
+    if (!parse_event(reader, line, event)) {
+      continue;
+    }
+    event.lineno = reader.lineno;
+    event.position = start;
+    while (ok && spills.size() <= (size_t)reader.current) {
+      PyObject *spill = PyObject_CallObject(new_spill, nullptr);
+      ok = spill != nullptr;
+      if (ok) {
+        spills.push_back(Spill{spill, {}});
+      }
+    }
+    if (!ok) {
+      break;
+    }
+    Spill &spill = spills[reader.current];
+    append_event(spill.pending, event);
+    if (spill.pending.size() >= kSpillFlush) {
+      ok = flush(spill);
+    }
+  }
+  for (Spill &spill : spills) {
+    ok = ok && flush(spill);
+    Py_DECREF(spill.file);
+  }
+  return ok ? std::max<long>(1, (long)reader.threads.size()) : -1;
+}
+
+// 读取分流文件的一方，预读一个事件
+struct Reader {
+  Input input;
+  Event next;
+  bool has_next = false;
 };
 
+// 确保 buffer 中至少有 n 字节未消费；返回 1 成功，0 文件结束，-1 Python 异常
+static int ensure(Input &input, size_t n) {
+  while (input.buffer.size() - input.offset < n) {
+    if (input.eof) {
+      return 0;
+    }
+    if (!fill(input)) {
+      return -1;
+    }
+  }
+  return 1;
+}
+
+// 预读下一个事件；返回 false 表示 Python 异常
+static bool advance(Reader &reader) {
+  Input &input = reader.input;
+  int status = ensure(input, kSpillHeader);
+  if (status <= 0) {
+    reader.has_next = false;
+    return status == 0;
+  }
+  const char *p = input.buffer.data() + input.offset;
+  uint8_t kind;
+  uint32_t depth, size;
+  uint64_t lineno, position;
+  std::memcpy(&kind, p, 1);
+  std::memcpy(&depth, p += 1, 4);
+  std::memcpy(&lineno, p += 4, 8);
+  std::memcpy(&position, p += 8, 8);
+  std::memcpy(&size, p += 8, 4);
+  status = ensure(input, kSpillHeader + size);
+  if (status <= 0) {
+    reader.has_next = false;
+    return status == 0;
+  }
+  Event &event = reader.next;
+  event.kind = kind;
+  event.depth = (long)depth;
+  event.lineno = (long long)lineno;
+  event.position = (long long)position;
+  event.text.assign(input.buffer, input.offset + kSpillHeader, size);
+  input.offset += kSpillHeader + size;
+  reader.has_next = true;
+  return true;
+}
+
+// 跳过在 depth 处调用的帧剩下的事件（含其 RETURN）
+static bool skip_frame(Reader &reader, long depth, Py_ssize_t &skipped) {
+  while (reader.has_next) {
+    const Event &event = reader.next;
+    bool done = event.depth == depth && event.kind == kReturn;
+    // 帧自己的异常和调用深度相同；更浅的事件说明帧已结束（没有 RETURN 行）
+    if (!done && (event.depth < depth ||
+                  (event.depth == depth && event.kind != kException))) {
+      break;
+    }
+    skipped++;
+    if (!advance(reader)) {
+      return false;
+    }
+    if (done) {
+      break;
+    }
+  }
+  return true;
+}
+
+static bool drain(Reader &reader, Py_ssize_t &skipped) {
+  while (reader.has_next) {
+    skipped++;
+    if (!advance(reader)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void settle(std::vector<Event> &stack, const Event &event) {
+  long limit = event.kind == kException ? event.depth + 1 : event.depth;
+  while (!stack.empty() && stack.back().depth >= limit) {
+    stack.pop_back();
+  }
+  if (event.kind == kCall) {
+    stack.push_back(event);
+  }
+}
+
+static std::string_view call_label(const std::string &text) {
+  std::string_view rest(text);
+  for (int i = 0; i < 2; i++) {
+    size_t space = rest.find(' ');
+    rest = space == std::string_view::npos ? std::string_view()
+                                            : rest.substr(space + 1);
+  }
+  return rest.substr(0, rest.find('('));
+}
+
+static PyObject *event_tuple(const Event *event) {
+  if (!event) {
+    Py_RETURN_NONE;
+  }
+  PyObject *text = PyUnicode_DecodeUTF8(event->text.data(),
+                                        event->text.size(), "replace");
+  if (!text) {
+    return nullptr;
+  }
+  return Py_BuildValue("(slNLL)", kKindNames[event->kind], event->depth, text,
+                       event->lineno, event->position);
+}
+
+static bool record(PyObject *callback, const char *kind, const Event *a,
+                   const Event *b, const std::vector<Event> &stack,
+                   Py_ssize_t a_events, Py_ssize_t b_events) {
+  PyObject *path = PyTuple_New(stack.size());
+  if (!path) {
+    return false;
+  }
+  for (size_t i = 0; i < stack.size(); i++) {
+    PyObject *item = event_tuple(&stack[i]);
+    if (!item) {
+      Py_DECREF(path);
+      return false;
+    }
+    PyTuple_SET_ITEM(path, i, item);
+  }
+  PyObject *result =
+      PyObject_CallFunction(callback, "sNNNnn", kind, event_tuple(a),
+                            event_tuple(b), path, a_events, b_events);
+  Py_XDECREF(result);
+  return result != nullptr;
+}
+
+static const char *classify(const Event *a, const Event *b) {
+  if (!a || !b) {
+    return "missing";
+  }
+  if (a->kind == kCall && b->kind == kCall) {
+    return "call";
+  }
+  if (a->kind == kReturn && b->kind == kReturn) {
+    return "return";
+  }
+  if (a->kind == kException || b->kind == kException) {
+    return "exception";
+  }
+  return "branch";
+}
+
+static bool diff(Reader &a, Reader &b, PyObject *callback,
+                 Py_ssize_t &matched) {
+  std::vector<Event> stack; // 双方都已进入、尚未返回的调用
+  if (!advance(a) || !advance(b)) {
+    return false;
+  }
+  while (a.has_next || b.has_next) {
+    if (a.has_next && b.has_next && a.next.depth == b.next.depth &&
+        a.next.text == b.next.text) {
+      matched++;
+      settle(stack, a.next);
+      if (!advance(a) || !advance(b)) {
+        return false;
+      }
+      continue;
+    }
+    Event ea = a.next, eb = b.next;
+    const Event *pa = a.has_next ? &ea : nullptr;
+    const Event *pb = b.has_next ? &eb : nullptr;
+    const char *kind = classify(pa, pb);
+    Py_ssize_t a_events = 0, b_events = 0;
+    bool same_depth = pa && pb && ea.depth == eb.depth;
+    if (same_depth && ea.kind == kCall && eb.kind == kCall) {
+      if (call_label(ea.text) == call_label(eb.text)) {
+        // 同一函数、参数不同：继续比较函数内部
+        if (!record(callback, kind, pa, pb, stack, 1, 1)) {
+          return false;
+        }
+        settle(stack, ea);
+        if (!advance(a) || !advance(b)) {
+          return false;
+        }
+        continue;
+      }
+      // 调用了不同的函数：跳过两边的子树，后面的调用仍按顺序对齐
+      a_events = b_events = 1;
+      if (!advance(a) || !skip_frame(a, ea.depth, a_events) || !advance(b) ||
+          !skip_frame(b, eb.depth, b_events)) {
+        return false;
+      }
+      if (!record(callback, kind, pa, pb, stack, a_events, b_events)) {
+        return false;
+      }
+      continue;
+    }
+    if (same_depth && ea.kind == kReturn && eb.kind == kReturn) {
+      if (!record(callback, kind, pa, pb, stack, 1, 1)) {
+        return false;
+      }
+      settle(stack, ea);
+      if (!advance(a) || !advance(b)) {
+        return false;
+      }
+      continue;
+    }
+    if (!pa || !pb || stack.empty()) {
+      // 一方已结束，或顶层的分歧无法重新对齐：其余事件都算作分歧子树
+      return drain(a, a_events) && drain(b, b_events) &&
+             record(callback, kind, pa, pb, stack, a_events, b_events);
+    }
+    // 分支不同：跳过当前共同帧剩下的部分
+    long depth = stack.back().depth;
+    if (!skip_frame(a, depth, a_events) || !skip_frame(b, depth, b_events) ||
+        !record(callback, kind, pa, pb, stack, a_events, b_events)) {
+      return false;
+    }
+    stack.pop_back();
+  }
+  return true;
+}
+
+} // namespace trace_diff
+
+static PyObject *split_trace_threads(PyObject *, PyObject *args) {
+  PyObject *file;
+  PyObject *new_spill;
+  if (!PyArg_ParseTuple(args, "OO", &file, &new_spill)) {
+    return nullptr;
+  }
+  long threads = trace_diff::split(file, new_spill);
+  return threads < 0 ? nullptr : PyLong_FromLong(threads);
+}
+
+static PyObject *diff_trace_streams(PyObject *, PyObject *args) {
+  PyObject *stream_a;
+  PyObject *stream_b;
+  PyObject *callback;
+  if (!PyArg_ParseTuple(args, "OOO", &stream_a, &stream_b, &callback)) {
+    return nullptr;
+  }
+  trace_diff::Reader a, b;
+  a.input.file = stream_a;
+  b.input.file = stream_b;
+  Py_ssize_t matched = 0;
+  if (!trace_diff::diff(a, b, callback, matched)) {
+    return nullptr;
+  }
+  return PyLong_FromSsize_t(matched);
+}
+
+static PyObject *statement_range(PyObject *, PyObject *args) {
+  PyCodeObject *code;
+  int lineno;
+  PyObject *lines;
+  if (!PyArg_ParseTuple(args, "O!iO!", &PyCode_Type, &code, &lineno,
+                        &PyList_Type, &lines)) {
+    return nullptr;
+  }
+  stmt_span::Table *table = stmt_span::get_table(code, lines);
+  if (!table) {
+    return nullptr;
+  }
+  uint32_t index = (uint32_t)lineno - table->first_line;
+  if (lineno < 1 || index >= table->count) {
+    Py_RETURN_NONE;
+  }
+  uint32_t start = table->spans[2 * index];
+  uint32_t end = table->spans[2 * index + 1];
+  if (start == stmt_span::kUnknown) {
+    Py_RETURN_NONE;
+  }
+  if (start == stmt_span::kNone) {
+    start = end = lineno;
+  }
+  return Py_BuildValue("(II)", start, end);
+}
+
+static PyObject *statement_spans(PyObject *, PyObject *lines) {
+  if (!PyList_Check(lines)) {
+    PyErr_SetString(PyExc_TypeError, "lines must be a list of str");
+    return nullptr;
+  }
+  Py_ssize_t total = PyList_GET_SIZE(lines);
+  stmt_span::Table *table = stmt_span::build(lines, 1, total, false);
+  if (!table) {
+    return nullptr;
+  }
+  PyObject *result = PyBytes_FromStringAndSize(
+      reinterpret_cast<const char *>(table->spans),
+      2 * sizeof(uint32_t) * table->count);
+  stmt_span::free_table(table);
+  return result;
+}
+
+static PyMethodDef tracer_core_methods[] = {
+    {"statement_range", statement_range, METH_VARARGS,
+     "statement_range(code, lineno, lines) -> (start, end) or None\n"
+     "Statement span of a line, built lazily per code object from the "
+     "source lines."},
+    {"statement_spans", statement_spans, METH_O,
+     "statement_spans(lines) -> bytes\n"
+     "Native-order uint32 (start, end) pairs for every line of a file, "
+     "0 for lines outside simple statements."},
+    {"format_log", format_log, METH_VARARGS,
+     "format_log(template, data) -> str or None\n"
+     "Same as template.format(**data) for templates that only use {name} "
+     "fields; None for any other template."},
+    {"build_frame_index", build_frame_index, METH_VARARGS,
+     "build_frame_index(index_path, out_path, log_size) -> int\n"
+     "Convert a trace log .index file into the binary frame-range index "
+     "read by trace_pager, returning the number of frames."},
+    {"build_call_graph", build_call_graph, METH_VARARGS,
+     "build_call_graph(index_path) -> dict\n"
+     "Build the call tree of a trace log .index file as CSR columns "
+     "for debugger.call_graph.CallGraph."},
+    {"split_trace_threads", split_trace_threads, METH_VARARGS,
+     "split_trace_threads(file, new_spill) -> threads\n"
+     "Parse a binary trace log file once and write the events of thread i "
+     "to the i-th file returned by new_spill()."},
+    {"diff_trace_streams", diff_trace_streams, METH_VARARGS,
+     "diff_trace_streams(stream_a, stream_b, record) -> matched\n"
+     "Compare two per-thread event streams written by split_trace_threads, "
+     "calling record(kind, a, b, stack, a_events, b_events) for each "
+     "divergence."},
+    {nullptr, nullptr, 0, nullptr}};
+
 static PyModuleDef tracer_core_module = {
     PyModuleDef_HEAD_INIT,       /* m_base */
     "tracer_core",               /* m_name */
     "Python tracer core module", /* m_doc */
     -1,                          /* m_size */
-    NULL,                        /* m_methods */
+    tracer_core_methods,         /* m_methods */
     NULL,                        /* m_slots */
     NULL,                        /* m_traverse */
     NULL,                        /* m_clear */
     NULL                         /* m_free */
 };
 
+static bool add_type(PyObject *module, const char *name, PyType_Spec *spec) {
+  PyObject *type = PyType_FromSpec(spec);
+  if (!type) {
+    return false;
+  }
+  if (PyModule_AddObject(module, name, type) < 0) {
+    Py_DECREF(type);
+    return false;
+  }
+  return true;
+}
+
 PyMODINIT_FUNC PyInit_tracer_core(void) {
   PyObject *module = PyModule_Create(&tracer_core_module);
   if (!module) {
     printf("Failed to create module\n");
     return nullptr;
   }
-  if (PyType_Ready(&TraceDispatcherType) < 0) {
-    printf("PyType_Ready failed\n");
+  stmt_span::extra_index =
+      _PyEval_RequestCodeExtraIndex(stmt_span::free_table);
+  if (stmt_span::extra_index < 0) {
+    printf("Failed to request code extra index\n");
+    Py_DECREF(module);
+    return nullptr;
+  }
+  log_format::template_cache = PyDict_New();
+  if (!log_format::template_cache) {
+    Py_DECREF(module);
     return nullptr;
   }
-
-  Py_INCREF(&TraceDispatcherType);
-  if (PyModule_AddObject(module, "TraceDispatcher",
-                         (PyObject *)&TraceDispatcherType) < 0) {
-    printf("Failed to add TraceDispatcher to module\n");
-    Py_DECREF(&TraceDispatcherType);
+  if (!add_type(module, "TraceDispatcher", &TraceDispatcher_spec) ||
+      !add_type(module, "LineBitmap", &LineBitmap_spec) ||
+      !add_type(module, "OutputQueue", &OutputQueue_spec)) {
+    printf("Failed to add types to module\n");
     Py_DECREF(module);
     return nullptr;
   }
@@ -0,0 +1,117 @@
+"""
+Compact executed-line sets for the HTML report.
+
+A frame's executed lines are kept in a bitmap while the frame runs and are
+written to the report as run lengths: the first executed line, then
+alternating counts of executed and skipped lines, all LEB128 varints, base64
+encoded. Lines of one frame belong to a single code object, so a typical frame
+encodes to a handful of bytes instead of a JSON list.
+
+`LineBitmap` is the native implementation from cpp/tracer_core.cpp when the
+extension is built, otherwise `PyLineBitmap`. `decodeLineRuns` in
+tracer_scripts.js reads the same format.
+"""
+
+import base64
+from typing import Iterable, List
+
+
+def encode_runs(lines: Iterable[int]) -> bytes:
+    """Encodes line numbers (ascending, without duplicates) as run lengths."""
+    out = bytearray()
+
+    def put(value: int) -> None:
+        while value >= 0x80:
+            out.append(value & 0x7F | 0x80)
+            value >>= 7
+        out.append(value)
+
+    run_start = prev = None
+    for line in lines:
+        if prev is None:
+            put(line)
+            run_start = line
+        elif line != prev + 1:
+            put(prev + 1 - run_start)
+            put(line - prev - 1)
+            run_start = line
+        prev = line
+    if prev is not None:
+        put(prev + 1 - run_start)
+    return bytes(out)
+
+
+def decode_runs(data: bytes) -> List[int]:
+    """Inverse of `encode_runs`."""
+    values = []
+    value = shift = 0
+    for byte in data:
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            values.append(value)
+            value = shift = 0
+    if not values:
+        return []
+    lines = []
+    line = values[0]
+    for i, count in enumerate(values[1:]):
+        if i % 2 == 0:
+            lines.extend(range(line, line + count))
+        line += count
+    return lines
+
+
+def to_base64(bitmap: "LineBitmap") -> str:
+    """The form stored in `lines_<n>.js` chunks."""
+    return base64.b64encode(bitmap.encode()).decode("ascii")
+
+
+class PyLineBitmap:
+    """Pure Python version of tracer_core.LineBitmap, one bit per line in a bytearray."""
+
+    __slots__ = ("_bits", "_count")
+
+    def __init__(self):
+        self._bits = bytearray()
+        self._count = 0
+
+    def add(self, lineno: int) -> None:
+        if lineno < 0:
+            raise ValueError("line number out of range")
+        index = lineno >> 3
+        if index >= len(self._bits):
+            # 一次扩到所需长度，与 line_bitmap::add 的 resize 一致
+            self._bits.extend(bytes(index + 1 - len(self._bits)))
+        bit = 1 << (lineno & 7)
+        if not self._bits[index] & bit:
+            self._bits[index] |= bit
+            self._count += 1
+
+    def update(self, other: "PyLineBitmap") -> None:
+        size = max(len(self._bits), len(other._bits))
+        merged = int.from_bytes(self._bits, "little") | int.from_bytes(other._bits, "little")
+        self._bits = bytearray(merged.to_bytes(size, "little"))
+        self._count = merged.bit_count()
+
+    def lines(self) -> List[int]:
+        lines = []
+        for index, byte in enumerate(self._bits):
+            while byte:
+                low = byte & -byte
+                lines.append(index * 8 + low.bit_length() - 1)
+                byte ^= low
+        return lines
+
+    def encode(self) -> bytes:
+        return encode_runs(self.lines())
+
+    def __len__(self) -> int:
+        return self._count
+
+
+try:
+    from .tracer_core import LineBitmap
+except ImportError:
+    # tracer_core is not built or was built for another Python version.
+    LineBitmap = PyLineBitmap
@@ -0,0 +1,140 @@
+"""
+Bounded output queue between the traced threads and the output thread.
+
+Traced threads `put` messages; the output thread calls `get_batch`, which
+waits until `batch_size` items are queued or the first queued item has waited
+`latency_ms`, and returns up to `batch_size` items.
+When the queue is full the policy decides what happens:
+
+- ``block``: the producer waits for space (no message is lost).
+- ``drop_oldest``: the oldest queued message is discarded.
+- ``sample``: above 3/4 of the capacity only every `sample_rate`-th message
+  is kept; when full, new messages are discarded.
+
+Messages put by the consumer thread itself are always accepted so that it
+never waits on itself.
+
+`OutputQueue` is the native implementation from cpp/tracer_core.cpp, which
+waits without holding the GIL; `PyOutputQueue` is the fallback with the same
+interface.
+"""
+
+import threading
+from collections import deque
+from typing import Any, Deque, Dict, List, Optional
+
+POLICIES = ("block", "drop_oldest", "sample")
+DEFAULT_CAPACITY = 65536
+DEFAULT_BATCH_SIZE = 256
+DEFAULT_LATENCY_MS = 50.0
+DEFAULT_SAMPLE_RATE = 10
+
+
+class PyOutputQueue:
+    """Pure Python version of tracer_core.OutputQueue."""
+
+    def __init__(
+        self,
+        capacity: int = DEFAULT_CAPACITY,
+        policy: str = "block",
+        batch_size: int = DEFAULT_BATCH_SIZE,
+        latency_ms: float = DEFAULT_LATENCY_MS,
+        sample_rate: int = DEFAULT_SAMPLE_RATE,
+    ):
+        if policy not in POLICIES:
+            raise ValueError(f"unknown output queue policy: {policy}")
+        if capacity < 1 or batch_size < 1 or sample_rate < 1 or latency_ms < 0:
+            raise ValueError("capacity, batch_size and sample_rate must be positive")
+        self._capacity = capacity
+        self._policy = policy
+        self._batch_size = batch_size
+        self._latency = latency_ms / 1000
+        self._sample_rate = sample_rate
+        self._items: Deque[Any] = deque()
+        self._cond = threading.Condition()
+        self._closed = False
+        self._consumer: Optional[int] = None
+        self._sample_counter = 0
+        self._stats = {"accepted": 0, "dropped": 0, "blocked": 0, "max_depth": 0}
+
+    def _push(self, item: Any) -> None:
+        self._items.append(item)
+        self._stats["accepted"] += 1
+        size = len(self._items)
+        self._stats["max_depth"] = max(self._stats["max_depth"], size)
+        if size in (1, self._batch_size):
+            self._cond.notify_all()
+
+    def put(self, item: Any) -> bool:
+        """Enqueues an item, returning False if it was dropped."""
+        with self._cond:
+            is_consumer = self._consumer == threading.get_ident()
+            while True:
+                if self._closed:
+                    self._stats["dropped"] += 1
+                    return False
+                size = len(self._items)
+                if self._policy == "sample" and not is_consumer and size >= self._capacity - self._capacity // 4:
+                    self._sample_counter += 1
+                    if (self._sample_counter - 1) % self._sample_rate != 0:
+                        self._stats["dropped"] += 1
+                        return False
+                if size < self._capacity or is_consumer:
+                    self._push(item)
+                    return True
+                if self._policy == "sample":
+                    self._stats["dropped"] += 1
+                    return False
+                if self._policy == "drop_oldest":
+                    self._items.popleft()
+                    self._stats["dropped"] += 1
+                    self._push(item)
+                    return True
+                self._stats["blocked"] += 1
+                self._cond.wait_for(lambda: self._closed or len(self._items) < self._capacity)
+
+    def get_batch(self) -> List[Any]:
+        """Waits for the next batch; returns [] once the queue is closed and empty."""
+        with self._cond:
+            self._consumer = threading.get_ident()
+            self._cond.wait_for(lambda: self._closed or self._items)
+            if not self._closed and len(self._items) < self._batch_size:
+                self._cond.wait_for(lambda: self._closed or len(self._items) >= self._batch_size, self._latency)
+            count = min(len(self._items), self._batch_size)
+            batch = [self._items.popleft() for _ in range(count)]
+            if count:
+                self._cond.notify_all()
+            return batch
+
+    def drain(self) -> List[Any]:
+        """Removes and returns all queued items."""
+        with self._cond:
+            items = list(self._items)
+            self._items.clear()
+            self._cond.notify_all()
+            return items
+
+    def close(self) -> None:
+        """Rejects further items and wakes all waiting threads."""
+        with self._cond:
+            self._closed = True
+            self._cond.notify_all()
+
+    def stats(self) -> Dict[str, int]:
+        """Counters: queued, accepted, dropped, blocked, max_depth."""
+        with self._cond:
+            return {"queued": len(self._items), **self._stats}
+
+    @property
+    def closed(self) -> bool:
+        return self._closed
+
+    def __len__(self) -> int:
+        return len(self._items)
+
+
+try:
+    from .tracer_core import OutputQueue
+except ImportError:
+    # tracer_core is not built or was built for another Python version.
+    OutputQueue = PyOutputQueue
@@ -0,0 +1,270 @@
+"""
+Compressed trace logs that keep random access.
+
+A compressed log is a sequence of independent deflate frames, each holding at
+most `frame_size` bytes of log text, followed by a seek table:
+
+    header   "TRSEEKZ1", u32 version, u32 frame_size
+    frame    u32 compressed size, u32 text size, raw deflate data   (repeated)
+    table    u64 file offset, u64 text offset                       (per frame)
+    footer   u64 frame count, u64 text size, "TRSEEKTB"
+
+Byte positions everywhere else (the `.index` file, the frame-range index,
+`TraceLogExtractor`) stay positions in the uncompressed text, so readers only
+need to map a text range to the frames covering it. A log whose writer did not
+close it has no table; its frames are found by walking the frame headers.
+
+`SeekableLogWriter` is the text-file-like object `TraceLogic._file_output`
+writes to. `SeekableLogReader` exposes the bytes-like subset `trace_pager`
+uses on a memory-mapped plain log, and `open_log` returns a seekable text (or
+binary) file for either format.
+"""
+
+import bisect
+import io
+import os
+import struct
+import zlib
+from collections import OrderedDict
+from typing import List, Optional, Tuple, Union
+
+MAGIC = b"TRSEEKZ1"
+TABLE_MAGIC = b"TRSEEKTB"
+VERSION = 1
+DEFAULT_FRAME_SIZE = 256 * 1024
+COMPRESSION_LEVEL = 6
+
+_HEADER = struct.Struct("=8sII")
+_FRAME = struct.Struct("=II")
+_ENTRY = struct.Struct("=QQ")
+_FOOTER = struct.Struct("=QQ8s")
+
+PathLike = Union[str, os.PathLike]
+
+
+def is_seekable_log(path: PathLike) -> bool:
+    try:
+        with open(path, "rb") as f:
+            return f.read(len(MAGIC)) == MAGIC
+    except OSError:
+        return False
+
+
+class SeekableLogWriter:
+    """Write side of a compressed log with the text-file methods TraceLogic uses."""
+
+    def __init__(self, path: PathLike, frame_size: int = DEFAULT_FRAME_SIZE, level: int = COMPRESSION_LEVEL):
+        self.name = str(path)
+        self._file = open(path, "wb")
+        self._file.write(_HEADER.pack(MAGIC, VERSION, frame_size))
+        self._frame_size = frame_size
+        self._level = level
+        self._buffer = bytearray()
+        self._written = 0  # 已压缩写出的文本字节数
+        self._table: List[Tuple[int, int]] = []
+        self.closed = False
+
+    def write(self, text: str) -> int:
+        self._buffer += text.encode("utf-8")
+        while len(self._buffer) >= self._frame_size:
+            self._write_frame(self._frame_size)
+        return len(text)
+
+    def tell(self) -> int:
+        """Position in the uncompressed text, as `tell()` on the plain log."""
+        return self._written + len(self._buffer)
+
+    def _write_frame(self, size: int) -> None:
+        # zlib 压缩时释放 GIL，不阻塞被追踪的线程
+        compressor = zlib.compressobj(self._level, zlib.DEFLATED, -15)
+        data = compressor.compress(bytes(self._buffer[:size])) + compressor.flush()
+        self._table.append((self._file.tell(), self._written))
+        self._file.write(_FRAME.pack(len(data), size))
+        self._file.write(data)
+        del self._buffer[:size]
+        self._written += size
+
+    def flush(self) -> None:
+        """Only whole frames reach the file before `close`; this flushes those."""
+        self._file.flush()
+
+    def close(self) -> None:
+        if self.closed:
+            return
+        if self._buffer:
+            self._write_frame(len(self._buffer))
+        for entry in self._table:
+            self._file.write(_ENTRY.pack(*entry))
+        self._file.write(_FOOTER.pack(len(self._table), self._written, TABLE_MAGIC))
+        self._file.close()
+        self.closed = True
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc_info):
+        self.close()
+
+
+class SeekableLogReader:
+    """
+    Random access to the text of a compressed log.
+
+    Supports `len`, slicing, `find` and `rfind` like the mmap of a plain log;
+    the most recently used frames are kept decompressed.
+    """
+
+    CACHED_FRAMES = 8
+
+    def __init__(self, path: PathLike):
+        self.path = str(path)
+        self._file = open(path, "rb")
+        magic, version, _ = _HEADER.unpack(self._file.read(_HEADER.size))
+        if magic != MAGIC or version != VERSION:
+            self._file.close()
+            raise ValueError(f"not a compressed trace log: {path}")
+        self._offsets, self._starts, self.size = self._read_table()
+        self._cache: "OrderedDict[int, bytes]" = OrderedDict()
+
+    def _read_table(self) -> Tuple[List[int], List[int], int]:
+        file_size = os.fstat(self._file.fileno()).st_size
+        if file_size >= _HEADER.size + _FOOTER.size:
+            self._file.seek(file_size - _FOOTER.size)
+            count, size, magic = _FOOTER.unpack(self._file.read(_FOOTER.size))
+            table_start = file_size - _FOOTER.size - count * _ENTRY.size
+            if magic == TABLE_MAGIC and table_start >= _HEADER.size:
+                self._file.seek(table_start)
+                entries = list(_ENTRY.iter_unpack(self._file.read(count * _ENTRY.size)))
+                return [e[0] for e in entries], [e[1] for e in entries], size
+        # 写入未结束的日志：顺着帧头找，忽略最后不完整的帧
+        offsets, starts, size, offset = [], [], 0, _HEADER.size
+        while offset + _FRAME.size <= file_size:
+            self._file.seek(offset)
+            compressed, length = _FRAME.unpack(self._file.read(_FRAME.size))
+            if offset + _FRAME.size + compressed > file_size:
+                break
+            offsets.append(offset)
+            starts.append(size)
+            size += length
+            offset += _FRAME.size + compressed
+        return offsets, starts, size
+
+    def _frame(self, i: int) -> bytes:
+        data = self._cache.get(i)
+        if data is not None:
+            self._cache.move_to_end(i)
+            return data
+        self._file.seek(self._offsets[i])
+        compressed, _ = _FRAME.unpack(self._file.read(_FRAME.size))
+        data = zlib.decompress(self._file.read(compressed), -15)
+        self._cache[i] = data
+        if len(self._cache) > self.CACHED_FRAMES:
+            self._cache.popitem(last=False)
+        return data
+
+    def _frame_at(self, position: int) -> int:
+        return bisect.bisect_right(self._starts, position) - 1
+
+    def read(self, start: int, end: int) -> bytes:
+        """Text bytes in [start, end)."""
+        start, end = max(0, start), min(end, self.size)
+        parts = []
+        i = self._frame_at(start)
+        while start < end and i < len(self._starts):
+            data = self._frame(i)
+            offset = start - self._starts[i]
+            chunk = data[offset : offset + end - start]
+            parts.append(chunk)
+            start += len(chunk)
+            i += 1
+        return b"".join(parts)
+
+    def __len__(self) -> int:
+        return self.size
+
+    def __getitem__(self, key: slice) -> bytes:
+        start, stop, _ = key.indices(self.size)
+        return self.read(start, stop)
+
+    def _frame_end(self, i: int) -> int:
+        return self._starts[i + 1] if i + 1 < len(self._starts) else self.size
+
+    def find(self, sub: bytes, start: int = 0, end: Optional[int] = None) -> int:
+        end = self.size if end is None else min(end, self.size)
+        start = max(0, start)
+        i = self._frame_at(start)
+        while 0 <= i < len(self._starts) and self._starts[i] < end:
+            # 窗口延伸到下一帧开头 len(sub) - 1 个字节，跨帧的匹配也能找到
+            window_start = max(start, self._starts[i])
+            window = self.read(window_start, min(end, self._frame_end(i) + len(sub) - 1))
+            hit = window.find(sub)
+            if hit >= 0:
+                return window_start + hit
+            i += 1
+        return -1
+
+    def rfind(self, sub: bytes, start: int = 0, end: Optional[int] = None) -> int:
+        end = self.size if end is None else min(end, self.size)
+        i = self._frame_at(end - 1)
+        while i >= 0 and self._frame_end(i) > start:
+            window_start = max(start, self._starts[i])
+            window = self.read(window_start, min(end, self._frame_end(i) + len(sub) - 1))
+            hit = window.rfind(sub)
+            if hit >= 0:
+                return window_start + hit
+            i -= 1
+        return -1
+
+    def close(self) -> None:
+        self._file.close()
+        self._cache.clear()
+
+
+class _SeekableLogRaw(io.RawIOBase):
+    """Binary file view of a compressed log for `open_log`."""
+
+    def __init__(self, reader: SeekableLogReader):
+        self._reader = reader
+        self._position = 0
+
+    def readable(self) -> bool:
+        return True
+
+    def seekable(self) -> bool:
+        return True
+
+    def readinto(self, buffer) -> int:
+        data = self._reader.read(self._position, self._position + len(buffer))
+        buffer[: len(data)] = data
+        self._position += len(data)
+        return len(data)
+
+    def seek(self, offset: int, whence: int = io.SEEK_SET) -> int:
+        base = {io.SEEK_SET: 0, io.SEEK_CUR: self._position, io.SEEK_END: self._reader.size}[whence]
+        self._position = max(0, base + offset)
+        return self._position
+
+    def tell(self) -> int:
+        return self._position
+
+    def close(self) -> None:
+        if not self.closed:
+            self._reader.close()
+        super().close()
+
+
+def open_log(path: PathLike, binary: bool = False):
+    """Opens a plain or compressed trace log as a seekable UTF-8 text file, or a binary one."""
+    if is_seekable_log(path):
+        buffered = io.BufferedReader(_SeekableLogRaw(SeekableLogReader(path)))
+        return buffered if binary else io.TextIOWrapper(buffered, encoding="utf-8")
+    return open(path, "rb") if binary else open(path, "r", encoding="utf-8")
+
+
+def log_text_size(path: PathLike) -> int:
+    """Size of the log text: the file size, or the uncompressed size of a compressed log."""
+    if is_seekable_log(path):
+        reader = SeekableLogReader(path)
+        reader.close()
+        return reader.size
+    return os.path.getsize(path)
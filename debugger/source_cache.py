@@ -1,8 +1,17 @@
 import os
-from typing import Dict, Optional, Tuple
+from types import CodeType
+from typing import Dict, List, Optional, Tuple
 
+from .source_disk_cache import CachedSource, SourceDiskCache
 from .stmt_line_table import StmtLineTable
 
+try:
+    # Native statement spans, built lazily per code object (see cpp/tracer_core.cpp).
+    from .tracer_core import statement_range as _native_statement_range
+except ImportError:
+    # tracer_core is not built or was built for another Python version.
+    _native_statement_range = None
+
 
 class SourceCacheManager:
     """
@@ -22,6 +31,36 @@ class SourceCacheManager:
         self._table_cache: Dict[str, StmtLineTable] = {}
         # Cache for file contents to avoid re-reading from disk.
         self._source_cache: Dict[str, str] = {}
+        # Cache of split source lines, shared with the native statement spans.
+        self._lines_cache: Dict[str, List[str]] = {}
+        # Optional persistent cache; entries are looked up once per file.
+        self._disk_cache: Optional[SourceDiskCache] = None
+        self._disk_entries: Dict[str, Optional[CachedSource]] = {}
+
+    def set_disk_cache(self, disk_cache: Optional[SourceDiskCache]):
+        """
+        Serves statement spans and source lines from a persistent cache.
+
+        Files found unchanged in the cache are never read or parsed; other
+        files are added to it on first use. Pass None to disable.
+        """
+        if self._disk_cache is not None and self._disk_cache is not disk_cache:
+            self._disk_cache.close()
+        self._disk_cache = disk_cache
+        self._disk_entries.clear()
+
+    def get_cached_source(self, filename: str) -> Optional[CachedSource]:
+        """Returns the persistent cache entry for a file, or None if the cache is disabled or unusable."""
+        if self._disk_cache is None:
+            return None
+        if filename not in self._disk_entries:
+            self._disk_entries[filename] = self._disk_cache.get(filename)
+        return self._disk_entries[filename]
+
+    def flush_disk_cache(self):
+        """Writes data collected during this run (var-ops tables) to the persistent cache."""
+        if self._disk_cache is not None:
+            self._disk_cache.flush()
 
     def add_source(self, filename: str, source_code: str):
         """
@@ -40,6 +79,37 @@ class SourceCacheManager:
             # (e.g., from a failed file read), we should invalidate it.
             if filename in self._table_cache:
                 del self._table_cache[filename]
+            self._lines_cache.pop(filename, None)
+
+    def _read_source(self, filename: str) -> Tuple[str, str]:
+        """
+        Returns (cache_key, source_code) for a file, reading it on first use.
+
+        Raises:
+            FileNotFoundError, IOError: If the file cannot be read.
+        """
+        source_code = self._source_cache.get(filename)
+        if source_code is not None:
+            return filename, source_code
+        # Ensure the path is absolute and normalized for a consistent cache key.
+        abs_filename = os.path.abspath(filename)
+        if abs_filename not in self._source_cache:
+            with open(abs_filename, "r", encoding="utf-8") as f:
+                self._source_cache[abs_filename] = f.read()
+        return abs_filename, self._source_cache[abs_filename]
+
+    def _get_lines(self, filename: str) -> Optional[List[str]]:
+        """Retrieves the source lines of a file without parsing it."""
+        lines = self._lines_cache.get(filename)
+        if lines is not None:
+            return lines
+        try:
+            _, source_code = self._read_source(filename)
+        except (FileNotFoundError, IOError, UnicodeDecodeError):
+            return None
+        lines = source_code.splitlines()
+        self._lines_cache[filename] = lines
+        return lines
 
     def _get_table(self, filename: str) -> Optional[StmtLineTable]:
         """
@@ -51,18 +121,7 @@ class SourceCacheManager:
             return self._table_cache[filename]
 
         try:
-            source_code = self._source_cache.get(filename)
-            if source_code is None:
-                # Ensure the path is absolute and normalized for a consistent cache key.
-                abs_filename = os.path.abspath(filename)
-                if abs_filename in self._source_cache:
-                    source_code = self._source_cache[abs_filename]
-                else:
-                    with open(abs_filename, "r", encoding="utf-8") as f:
-                        source_code = f.read()
-                    self._source_cache[abs_filename] = source_code
-                filename = abs_filename  # Use the canonical path as the key
-
+            filename, source_code = self._read_source(filename)  # Use the canonical path as the key
             table = StmtLineTable(source_code, filename)
             self._table_cache[filename] = table
             return table
@@ -105,21 +164,52 @@ class SourceCacheManager:
         # Line number is out of bounds for the file.
         return None
 
-    def get_statement_info(self, filename: str, lineno: int) -> Optional[Tuple[str, int, int]]:
+    def get_statement_info(
+        self, filename: str, lineno: int, code: Optional[CodeType] = None
+    ) -> Optional[Tuple[str, int, int]]:
         """
         Gets the full source, start, and end line for the statement at a given line.
 
         This method intelligently handles multi-line simple statements and provides
         the necessary context (start and end lines) for consumers like a debugger.
 
+        When the executing code object is given and tracer_core is built, the
+        statement span comes first from a native table covering only that code
+        object; the table lives on the code object, so repeated lookups stay in
+        memory and the file is never run through `ast.parse`. With a persistent
+        cache configured (see set_disk_cache), the source lines of an unchanged
+        file come from it, and lines the native table cannot resolve (a lambda
+        or comprehension starting mid-statement) use its precomputed spans.
+        Everything else falls back to the AST table.
+
         Args:
             filename: The path to the source file.
             lineno: The 1-based line number.
+            code: The code object executing the line (optional).
 
         Returns:
             A tuple (source_code, start_lineno, end_lineno), or None if the
             file cannot be processed or the line is invalid.
         """
+        cached = self.get_cached_source(filename) if filename not in self._source_cache else None
+
+        if code is not None and _native_statement_range is not None:
+            lines = cached.lines if cached is not None else self._get_lines(filename)
+            if lines is not None:
+                if not 1 <= lineno <= len(lines):
+                    return None
+                statement_range = _native_statement_range(code, lineno, lines)
+                if statement_range is not None:
+                    start, end = statement_range
+                    return "\n".join(lines[start - 1 : end]), start, end
+
+        if cached is not None:
+            statement_range = cached.statement_range(lineno)
+            if statement_range is None:
+                return None
+            start, end = statement_range
+            return "\n".join(cached.lines[start - 1 : end]), start, end
+
         table = self._get_table(filename)
         if not table:
             return None
@@ -146,6 +236,8 @@ class SourceCacheManager:
         """Clears the entire cache."""
         self._table_cache.clear()
         self._source_cache.clear()
+        self._lines_cache.clear()
+        self._disk_entries.clear()
 
 
 # A global instance to be used throughout the application.
@@ -162,10 +254,10 @@ def get_source_for_line(filename: str, lineno: int) -> Optional[str]:
     return source_cache_manager.get_source_for_line(filename, lineno)
 
 
-def get_statement_info(filename: str, lineno: int) -> Optional[Tuple[str, int, int]]:
+def get_statement_info(filename: str, lineno: int, code: Optional[CodeType] = None) -> Optional[Tuple[str, int, int]]:
     """
     A convenient module-level function to get statement info for a line.
 
     See SourceCacheManager.get_statement_info for details.
     """
-    return source_cache_manager.get_statement_info(filename, lineno)
+    return source_cache_manager.get_statement_info(filename, lineno, code)
@@ -0,0 +1,361 @@
+import hashlib
+import mmap
+import os
+import struct
+import sys
+import zlib
+from array import array
+from pathlib import Path
+from types import CodeType
+from typing import Dict, List, Optional, Set, Tuple
+
+from .stmt_line_table import StmtLineTable
+
+try:
+    from .tracer_core import statement_spans as _native_statement_spans
+except ImportError:
+    _native_statement_spans = None
+
+# On-disk layout of one cached source file, all integers in native byte order:
+#
+#   header         _HEADER, fixed size
+#   path           UTF-8 absolute path of the source file
+#   spans          line_count pairs of uint32 (start, end), 0 = not a simple statement
+#   source         zlib-compressed file content
+#   var-ops        uint32 length + NUL-joined string table, padded to 4 bytes,
+#                  then a uint32 stream: n_codes, per code (key, n_lines,
+#                  per line (lineno, n_vars, var...)), names as string indices
+#
+# The spans section is read in place through mmap. var-ops depend on the
+# bytecode, so they are only used when cache_tag matches the running interpreter.
+_MAGIC = b"TRSRCCH1"
+_VERSION = 2
+_BYTE_ORDER = 0x01020304
+_HEADER = struct.Struct("=8sII16sqQ16sIIQQQQQ")
+_MTIME_OFFSET = 8 + 4 + 4 + 16
+_CACHE_TAG = (sys.implementation.cache_tag or sys.implementation.name).encode()[:16]
+
+VarOps = Dict[int, Set[str]]
+
+
+def code_key(code: CodeType) -> str:
+    """
+    Identifies a code object inside its file across interpreter runs.
+
+    Qualified name and first line are not enough: two lambdas or comprehensions
+    on one line share both. Their bodies never overlap, so the earliest source
+    position of the body tells them apart. RESUME and other synthetic
+    instructions carry no real column and are skipped.
+    """
+    start = min(
+        (
+            (line, col)
+            for line, _, col, end_col in code.co_positions()
+            if line is not None and col is not None and (col, end_col) != (0, 0)
+        ),
+        default=(code.co_firstlineno, 0),
+    )
+    return f"{code.co_qualname}@{code.co_firstlineno}:{start[0]}:{start[1]}"
+
+
+def _digest(content: bytes) -> bytes:
+    return hashlib.blake2b(content, digest_size=16).digest()
+
+
+def _align(offset: int, alignment: int = 8) -> int:
+    return (offset + alignment - 1) & ~(alignment - 1)
+
+
+def _compute_spans(source_code: str, lines: List[str], filename: str) -> bytes:
+    if _native_statement_spans is not None:
+        return _native_statement_spans(lines)
+    spans = array("I", bytes(8 * len(lines)))
+    for index, statement_range in enumerate(StmtLineTable(source_code, filename).line_map):
+        if statement_range:
+            spans[2 * index], spans[2 * index + 1] = statement_range
+    return spans.tobytes()
+
+
+def _encode_var_ops(var_ops: Dict[str, VarOps]) -> bytes:
+    strings: Dict[str, int] = {}
+
+    def intern(name: str) -> int:
+        return strings.setdefault(name, len(strings))
+
+    stream = array("I", [len(var_ops)])
+    for key, line_vars in var_ops.items():
+        stream.extend((intern(key), len(line_vars)))
+        for lineno, names in sorted(line_vars.items()):
+            stream.extend((lineno, len(names)))
+            stream.extend(intern(name) for name in sorted(names))
+    table = "\0".join(strings).encode("utf-8")
+    return struct.pack("=I", len(table)) + table + bytes(_align(len(table), 4) - len(table)) + stream.tobytes()
+
+
+def _decode_var_ops(data: memoryview) -> Dict[str, VarOps]:
+    (table_len,) = struct.unpack_from("=I", data)
+    strings = bytes(data[4 : 4 + table_len]).decode("utf-8").split("\0")
+    stream = data[4 + _align(table_len, 4) :].cast("I")
+    var_ops: Dict[str, VarOps] = {}
+    pos = 1
+    for _ in range(stream[0]):
+        key, n_lines = stream[pos], stream[pos + 1]
+        pos += 2
+        line_vars: VarOps = {}
+        for _ in range(n_lines):
+            lineno, n_vars = stream[pos], stream[pos + 1]
+            line_vars[lineno] = {strings[i] for i in stream[pos + 2 : pos + 2 + n_vars]}
+            pos += 2 + n_vars
+        var_ops[strings[key]] = line_vars
+    return var_ops
+
+
+class CachedSource:
+    """
+    One source file backed by a memory-mapped cache file.
+
+    Statement spans are looked up directly in the mapping; the source lines are
+    decompressed and the var-ops section is decoded on first use. Var-ops for
+    code objects analyzed during this run are kept in memory until the cache
+    is flushed.
+    """
+
+    def __init__(self, path: str, cache_file: Path, data: memoryview, header: tuple, owner=None):
+        self.path = path
+        self.cache_file = cache_file
+        self._owner = None
+        self._load(data, header, owner)
+        self._lines: Optional[List[str]] = None
+        self._var_ops: Optional[Dict[str, VarOps]] = None
+        self._pending: Dict[str, VarOps] = {}
+
+    def _load(self, data: memoryview, header: tuple, owner):
+        self._data = data
+        self._owner = owner  # mmap keeping `data` alive, None for in-memory entries
+        (_, _, _, self._cache_tag, self.mtime_ns, self.size, self.digest, self.line_count, _) = header[:9]
+        spans_off, self._source_off, self._source_len, self._var_ops_off, self._var_ops_len = header[9:]
+        self._spans = data[spans_off : spans_off + 8 * self.line_count].cast("I")
+
+    @property
+    def lines(self) -> List[str]:
+        if self._lines is None:
+            compressed = self._data[self._source_off : self._source_off + self._source_len]
+            self._lines = zlib.decompress(compressed).decode("utf-8").splitlines()
+        return self._lines
+
+    @property
+    def dirty(self) -> bool:
+        return bool(self._pending)
+
+    def statement_range(self, lineno: int) -> Optional[Tuple[int, int]]:
+        """(start, end) of the statement containing a line; the line itself outside simple statements."""
+        if not 1 <= lineno <= self.line_count:
+            return None
+        start = self._spans[2 * lineno - 2]
+        if not start:
+            return lineno, lineno
+        return start, self._spans[2 * lineno - 1]
+
+    def _stored_var_ops(self) -> Dict[str, VarOps]:
+        if self._var_ops is None:
+            self._var_ops = {}
+            if self._cache_tag.rstrip(b"\0") == _CACHE_TAG and self._var_ops_len:
+                self._var_ops = _decode_var_ops(self._data[self._var_ops_off : self._var_ops_off + self._var_ops_len])
+        return self._var_ops
+
+    def get_var_ops(self, key: str) -> Optional[VarOps]:
+        if key in self._pending:
+            return self._pending[key]
+        return self._stored_var_ops().get(key)
+
+    def put_var_ops(self, key: str, var_ops: VarOps):
+        self._pending[key] = {lineno: set(names) for lineno, names in var_ops.items()}
+
+    def _serialize(self) -> bytes:
+        var_ops = dict(self._stored_var_ops())
+        var_ops.update(self._pending)
+        spans = bytes(self._spans.cast("B"))
+        source = bytes(self._data[self._source_off : self._source_off + self._source_len])
+        return _pack(self.path, self.mtime_ns, self.size, self.digest, self.line_count, spans, source, var_ops)
+
+    def commit(self) -> bytes:
+        """Merges pending var-ops and switches to the serialized bytes, releasing the mapping."""
+        data = self._serialize()
+        self._var_ops = dict(self._stored_var_ops())
+        self._var_ops.update(self._pending)
+        self._pending = {}
+        self.close()
+        self._load(memoryview(data), _HEADER.unpack_from(data), None)
+        return data
+
+    def close(self):
+        self._spans.release()
+        self._data.release()
+        if self._owner is not None:
+            self._owner.close()
+            self._owner = None
+
+
+def _pack(path, mtime_ns, size, digest, line_count, spans, source, var_ops) -> bytes:
+    path_bytes = path.encode("utf-8")
+    var_ops_blob = _encode_var_ops(var_ops) if var_ops else b""
+    spans_off = _align(_HEADER.size + len(path_bytes))
+    source_off = spans_off + len(spans)
+    var_ops_off = _align(source_off + len(source))
+    header = _HEADER.pack(
+        _MAGIC,
+        _VERSION,
+        _BYTE_ORDER,
+        _CACHE_TAG,
+        mtime_ns,
+        size,
+        digest,
+        line_count,
+        len(path_bytes),
+        spans_off,
+        source_off,
+        len(source),
+        var_ops_off,
+        len(var_ops_blob),
+    )
+    out = bytearray(header + path_bytes)
+    out += bytes(spans_off - len(out))
+    out += spans + source
+    out += bytes(var_ops_off - len(out))
+    out += var_ops_blob
+    return bytes(out)
+
+
+class SourceDiskCache:
+    """
+    Persistent cache of statement spans, var-ops tables and compressed source.
+
+    Each source file maps to one cache file named after the hash of its
+    absolute path. An entry is reused when the file's mtime and size match the
+    header; otherwise the content hash decides, so a touched but unchanged file
+    is still a hit. Unchanged files are never parsed again.
+    """
+
+    def __init__(self, cache_dir):
+        self.cache_dir = Path(cache_dir)
+        self._entries: Dict[str, CachedSource] = {}
+
+    def _cache_file(self, path: str) -> Path:
+        return self.cache_dir / (hashlib.sha1(path.encode("utf-8")).hexdigest() + ".stc")
+
+    def get(self, filename: str) -> Optional[CachedSource]:
+        """Returns the cached entry for a file, building it on a miss. None if the file cannot be read."""
+        path = os.path.abspath(filename)
+        entry = self._entries.get(path)
+        if entry is not None:
+            return entry
+        try:
+            stat = os.stat(path)
+        except OSError:
+            return None
+        cache_file = self._cache_file(path)
+        entry = self._open(path, cache_file)
+        content = None
+        if entry is not None and (entry.mtime_ns, entry.size) != (stat.st_mtime_ns, stat.st_size):
+            content = self._read(path)
+            if content is None:
+                entry.close()
+                return None
+            if _digest(content) == entry.digest:
+                self._touch(cache_file, stat.st_mtime_ns)
+                entry.mtime_ns = stat.st_mtime_ns
+            else:
+                entry.close()
+                entry = None
+        if entry is None:
+            content = content if content is not None else self._read(path)
+            if content is None:
+                return None
+            entry = self._build(path, cache_file, content, stat.st_mtime_ns)
+            if entry is None:
+                return None
+        self._entries[path] = entry
+        return entry
+
+    @staticmethod
+    def _read(path: str) -> Optional[bytes]:
+        try:
+            with open(path, "rb") as f:
+                return f.read()
+        except OSError:
+            return None
+
+    @staticmethod
+    def _open(path: str, cache_file: Path) -> Optional[CachedSource]:
+        try:
+            with open(cache_file, "rb") as f:
+                mapping = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        except (OSError, ValueError):
+            return None
+        data = memoryview(mapping)
+        try:
+            header = _HEADER.unpack_from(data)
+            magic, version, byte_order = header[:3]
+            path_len, spans_off, source_off, source_len, var_ops_off, var_ops_len = header[8:]
+            valid = (
+                (magic, version, byte_order) == (_MAGIC, _VERSION, _BYTE_ORDER)
+                and bytes(data[_HEADER.size : _HEADER.size + path_len]).decode("utf-8", "replace") == path
+                and spans_off + 8 * header[7] <= source_off
+                and source_off + source_len <= len(data)
+                and var_ops_off + var_ops_len <= len(data)
+            )
+        except struct.error:
+            valid = False
+        if not valid:
+            data.release()
+            mapping.close()
+            return None
+        return CachedSource(path, cache_file, data, header, mapping)
+
+    @staticmethod
+    def _touch(cache_file: Path, mtime_ns: int):
+        try:
+            with open(cache_file, "r+b") as f:
+                f.seek(_MTIME_OFFSET)
+                f.write(struct.pack("=q", mtime_ns))
+        except OSError:
+            pass
+
+    def _build(self, path: str, cache_file: Path, content: bytes, mtime_ns: int) -> Optional[CachedSource]:
+        try:
+            source_code = content.decode("utf-8")
+        except UnicodeDecodeError:
+            return None
+        lines = source_code.splitlines()
+        spans = _compute_spans(source_code, lines, path)
+        data = _pack(path, mtime_ns, len(content), _digest(content), len(lines), spans, zlib.compress(content), {})
+        self._write(cache_file, data)
+        entry = CachedSource(path, cache_file, memoryview(data), _HEADER.unpack_from(data))
+        entry._lines = lines
+        return entry
+
+    def _write(self, cache_file: Path, data: bytes):
+        tmp_file = cache_file.with_name(f"{cache_file.name}.{os.getpid()}.tmp")
+        try:
+            self.cache_dir.mkdir(parents=True, exist_ok=True)
+            with open(tmp_file, "wb") as f:
+                f.write(data)
+            os.replace(tmp_file, cache_file)
+        except OSError:
+            # The cache is an optimization; a read-only or full disk only costs a re-parse next time.
+            try:
+                tmp_file.unlink()
+            except OSError:
+                pass
+
+    def flush(self):
+        """Writes var-ops analyzed during this run back to the cache files."""
+        for entry in self._entries.values():
+            if entry.dirty:
+                self._write(entry.cache_file, entry.commit())
+
+    def close(self):
+        self.flush()
+        for entry in self._entries.values():
+            entry.close()
+        self._entries.clear()
@@ -0,0 +1,494 @@
+"""
+First divergence between two trace logs of the same program.
+
+Each log (plain `.log` or compressed `.log.z`) is read and decompressed once
+and parsed into call / return / exception / line events, which are split by
+thread into temporary per-thread spill files. Frame and thread ids and object
+addresses are removed because they differ between runs; threads are paired by
+the order in which they first appear, and each pair of spill files is then
+compared on its own.
+
+Events of a thread pair are compared in lockstep while keeping only the stack
+of calls both runs are inside, so time is linear in the log size and memory
+is bounded by the call depth:
+
+- calls of the same function with different arguments are reported and
+  compared further; calls of different functions are reported and both
+  subtrees are skipped, which keeps the following calls aligned by order;
+- differing return values are reported and both frames end;
+- any other difference (a different line, an exception on one side) is a
+  branch: the rest of the innermost common frame is skipped on both sides.
+
+Each difference is a `Divergence` holding the common call path and the number
+of events in the differing subtree on each side. The `# Debug: a=1, b=2`
+suffix written by `--enable-var-trace` lists the variables in an order that
+changes between runs, so its `name=value` items (split at each `, ` followed by
+a name and `=`) are sorted before comparing.
+
+Line events carry no thread tag. A line at depth d belongs to a thread whose
+innermost unreturned call is at depth d - 1: the thread of the previous event
+when it fits, otherwise the most recently active thread that fits, otherwise
+the previous event's thread. This is exact for single-threaded traces and for
+threads running at different depths; lines of threads interleaved at the same
+depth may still be credited to the wrong one of them.
+
+`split_trace_threads` and `diff_trace_streams` are the native implementations
+from cpp/tracer_core.cpp when the extension is built, otherwise
+`_py_split_threads` and `_py_diff_streams`; both compare the UTF-8 text of the
+events and share the spill record layout (`_SPILL` followed by the text).
+
+    python -m debugger.trace_diff good.log bad.log
+"""
+
+import functools
+import io
+import json
+import re
+import struct
+import tempfile
+from collections import Counter
+from pathlib import Path
+from typing import BinaryIO, Callable, Dict, Iterator, List, NamedTuple, Optional, Tuple
+
+from .seekable_log import open_log
+
+CALL = "call"
+RETURN = "return"
+EXCEPTION = "exception"
+LINE = "line"
+
+# Divergence kinds
+KIND_CALL = "call"
+KIND_RETURN = "return"
+KIND_EXCEPTION = "exception"
+KIND_BRANCH = "branch"
+KIND_MISSING = "missing"
+
+DEFAULT_MAX_DIVERGENCES = 100
+MAX_SUMMARY_PATHS = 1000
+
+_MARKERS = {"↘": CALL, "↗": RETURN, "▷": LINE}
+# 分流文件的记录头：kind, depth, lineno, position, 文本字节数；与 tracer_core 一致
+_SPILL = struct.Struct("=BIQQI")
+_KINDS = (CALL, RETURN, EXCEPTION, LINE)
+_KIND_CODES = {kind: code for code, kind in enumerate(_KINDS)}
+_TAG = re.compile(r" ?\[frame:(\d+)\](?:\[thread:(\d+)\])?")
+_ADDRESS = re.compile(r" at 0x[0-9a-fA-F]+")
+_DEBUG_VARS = " # Debug: "
+_DEBUG_VAR_SEP = re.compile(r", (?=[^ ,=]+=)")
+
+
+class TraceEvent(NamedTuple):
+    kind: str
+    depth: int
+    text: str  # 去掉缩进、帧号、线程号和对象地址后的内容
+    lineno: int  # 日志中的行号，从 1 开始
+    position: int  # 日志文本中的字节位置
+
+
+class Divergence(NamedTuple):
+    kind: str
+    thread: int
+    path: Tuple[str, ...]  # 双方共同所在的调用栈
+    a: Optional[TraceEvent]
+    b: Optional[TraceEvent]
+    a_events: int  # 分歧子树在 A 中的事件数
+    b_events: int
+
+
+def call_label(event: TraceEvent) -> str:
+    """`file:lineno func` of a call event, without arguments."""
+    _, _, rest = event.text.partition(" ")
+    _, _, rest = rest.partition(" ")
+    return rest.partition("(")[0]
+
+
+def _sort_debug_vars(text: str) -> str:
+    """Sorts the items of a `# Debug: ...` suffix, whose order differs between runs."""
+    head, sep, items = text.partition(_DEBUG_VARS)
+    if not sep:
+        return text
+    return head + sep + ", ".join(sorted(_DEBUG_VAR_SEP.split(items)))
+
+
+def _line_thread(stacks: List[List[int]], active: List[int], current: int, depth: int) -> int:
+    """The thread a line event at `depth` belongs to; see the module docstring."""
+
+    def fits(thread: int) -> bool:
+        stack = stacks[thread]
+        return (stack[-1] if stack else -1) == depth - 1
+
+    if fits(current):
+        return current
+    return max((t for t in range(len(stacks)) if fits(t)), key=active.__getitem__, default=current)
+
+
+class TraceEventReader:
+    """Iterates `(thread, event)` over a binary log file; `thread_count` grows as threads appear."""
+
+    def __init__(self, file):
+        self.file = file
+        self.thread_count = 1
+
+    def __iter__(self) -> Iterator[Tuple[int, TraceEvent]]:
+        threads: Dict[int, int] = {}
+        frame_threads: Dict[int, int] = {}  # 未返回的帧所属线程
+        stacks: List[List[int]] = [[]]  # 各线程未返回调用的深度
+        active: List[int] = [0]  # 各线程最近一次带线程标记事件的行号
+        current = 0
+        position = 0
+        for lineno, raw in enumerate(self.file, 1):
+            start = position
+            position += len(raw)
+            line = raw.decode("utf-8", "replace").rstrip("\r\n")
+            text = line.lstrip(" ")
+            if not text:
+                continue
+            depth = (len(line) - len(text)) // 2
+            kind = _MARKERS.get(text[0])
+            if kind is None:
+                if text.startswith("⚠ EXCEPTION"):
+                    kind = EXCEPTION
+                elif text.startswith("⚠ C-RAISE"):
+                    kind = RETURN
+                else:
+                    # ↳ 变量、多行语句的后续行、错误信息不参与比较
+                    continue
+            # ▷ 行没有帧号和线程号
+            match = _TAG.search(text) if kind != LINE else None
+            if match:
+                frame_id = int(match.group(1))
+                owner = None
+                if match.group(2) is not None:
+                    owner = threads.setdefault(int(match.group(2)), len(threads))
+                    self.thread_count = max(self.thread_count, len(threads))
+                    while len(stacks) < len(threads):
+                        stacks.append([])
+                        active.append(0)
+                    if kind == CALL:
+                        frame_threads[frame_id] = owner
+                else:
+                    owner = frame_threads.pop(frame_id, None) if kind == RETURN else frame_threads.get(frame_id)
+                if owner is not None:
+                    current = owner
+                    active[current] = lineno
+                    stack = stacks[current]
+                    if kind == CALL:
+                        stack.append(depth)
+                    elif kind == RETURN:
+                        while stack and stack[-1] >= depth:
+                            stack.pop()
+                text = text[: match.start()] + text[match.end() :]
+            elif kind == LINE:
+                current = _line_thread(stacks, active, current, depth)
+            if "0x" in text:
+                text = _ADDRESS.sub(" at 0x?", text)
+            if _DEBUG_VARS in text:
+                text = _sort_debug_vars(text)
+            yield current, TraceEvent(kind, depth, text, lineno, start)
+
+
+def _py_split_threads(file, new_spill: Callable[[], BinaryIO]) -> int:
+    """
+    Parses a binary log file once, writing the events of thread i to the i-th
+    file returned by `new_spill()`. Returns the number of threads.
+    """
+    reader = TraceEventReader(file)
+    spills: List[BinaryIO] = []
+    for thread, event in reader:
+        while len(spills) <= thread:
+            spills.append(new_spill())
+        text = event.text.encode("utf-8")
+        header = _SPILL.pack(_KIND_CODES[event.kind], event.depth, event.lineno, event.position, len(text))
+        spills[thread].write(header + text)
+    return reader.thread_count
+
+
+def _read_spill(stream) -> Iterator[TraceEvent]:
+    while True:
+        header = stream.read(_SPILL.size)
+        if len(header) < _SPILL.size:
+            return
+        kind, depth, lineno, position, size = _SPILL.unpack(header)
+        text = stream.read(size)
+        if len(text) < size:
+            return
+        yield TraceEvent(_KINDS[kind], depth, text.decode("utf-8", "replace"), lineno, position)
+
+
+class _ThreadStream:
+    """Events of one spill file with one event of lookahead."""
+
+    def __init__(self, stream):
+        self._events = _read_spill(stream)
+        self._next = next(self._events, None)
+
+    def peek(self) -> Optional[TraceEvent]:
+        return self._next
+
+    def pop(self) -> Optional[TraceEvent]:
+        event = self._next
+        self._next = next(self._events, None)
+        return event
+
+    def skip_frame(self, depth: int) -> int:
+        """Skips the rest of the frame called at `depth`, including its return."""
+        skipped = 0
+        while self._next is not None:
+            event = self._next
+            if event.depth == depth and event.kind == RETURN:
+                self.pop()
+                return skipped + 1
+            # 帧自己的异常和调用深度相同；更浅的事件说明帧已结束（没有 RETURN 行）
+            if event.depth < depth or (event.depth == depth and event.kind != EXCEPTION):
+                break
+            self.pop()
+            skipped += 1
+        return skipped
+
+    def skip_call(self) -> int:
+        """Skips the call event at the head and its whole subtree."""
+        call = self.pop()
+        return 1 + self.skip_frame(call.depth)
+
+    def drain(self) -> int:
+        """Skips all remaining events."""
+        skipped = 0
+        while self.pop() is not None:
+            skipped += 1
+        return skipped
+
+
+def _settle(stack: List[TraceEvent], event: TraceEvent) -> None:
+    """Updates the common call stack after an event both sides agree on."""
+    limit = event.depth + 1 if event.kind == EXCEPTION else event.depth
+    while stack and stack[-1].depth >= limit:
+        stack.pop()
+    if event.kind == CALL:
+        stack.append(event)
+
+
+def _classify(a: Optional[TraceEvent], b: Optional[TraceEvent]) -> str:
+    if a is None or b is None:
+        return KIND_MISSING
+    if a.kind == b.kind == CALL:
+        return KIND_CALL
+    if a.kind == b.kind == RETURN:
+        return KIND_RETURN
+    if EXCEPTION in (a.kind, b.kind):
+        return KIND_EXCEPTION
+    return KIND_BRANCH
+
+
+def _py_diff_streams(stream_a, stream_b, record) -> int:
+    """
+    Compares the spill files of one thread pair, calling
+    `record(kind, a, b, stack, a_events, b_events)` for each divergence.
+    Returns the number of matched events.
+    """
+    a = _ThreadStream(stream_a)
+    b = _ThreadStream(stream_b)
+    matched = 0
+    stack: List[TraceEvent] = []  # 双方都已进入、尚未返回的调用
+    while True:
+        ea, eb = a.peek(), b.peek()
+        if ea is None and eb is None:
+            break
+        if ea is not None and eb is not None and ea.depth == eb.depth and ea.text == eb.text:
+            a.pop()
+            b.pop()
+            matched += 1
+            _settle(stack, ea)
+            continue
+        kind = _classify(ea, eb)
+        if kind == KIND_CALL and ea.depth == eb.depth:
+            if call_label(ea) == call_label(eb):
+                # 同一函数、参数不同：继续比较函数内部
+                record(kind, ea, eb, tuple(stack), 1, 1)
+                a.pop()
+                b.pop()
+                _settle(stack, ea)
+            else:
+                # 调用了不同的函数：跳过两边的子树，后面的调用仍按顺序对齐
+                record(kind, ea, eb, tuple(stack), a.skip_call(), b.skip_call())
+            continue
+        if kind == KIND_RETURN and ea.depth == eb.depth:
+            record(kind, ea, eb, tuple(stack), 1, 1)
+            a.pop()
+            b.pop()
+            _settle(stack, ea)
+            continue
+        if kind == KIND_MISSING or not stack:
+            # 一方已结束，或顶层的分歧无法重新对齐：其余事件都算作分歧子树
+            record(kind, ea, eb, tuple(stack), a.drain(), b.drain())
+            break
+        # 分支不同：跳过当前共同帧剩下的部分
+        frame_depth = stack[-1].depth
+        record(kind, ea, eb, tuple(stack), a.skip_frame(frame_depth), b.skip_frame(frame_depth))
+        stack.pop()
+    return matched
+
+
+def _split_log(path: Path) -> Tuple[List[BinaryIO], int]:
+    """Splits a log into per-thread temporary spill files, rewound for reading."""
+    spills: List[BinaryIO] = []
+
+    def new_spill() -> BinaryIO:
+        spills.append(tempfile.TemporaryFile())
+        return spills[-1]
+
+    try:
+        with open_log(path, binary=True) as file:
+            threads = split_trace_threads(file, new_spill)
+        for spill in spills:
+            spill.seek(0)
+    except BaseException:
+        for spill in spills:
+            spill.close()
+        raise
+    return spills, threads
+
+
+class TraceDiff:
+    """Result of comparing two trace logs; see the module docstring."""
+
+    def __init__(self, log_a, log_b, max_divergences: int = DEFAULT_MAX_DIVERGENCES):
+        self.log_a = Path(log_a)
+        self.log_b = Path(log_b)
+        self.max_divergences = max_divergences
+        self.divergences: List[Divergence] = []  # 最多 max_divergences 条
+        self.first_by_thread: Dict[int, Divergence] = {}
+        self.counts: Counter = Counter()  # 各类分歧的数量
+        self.subtrees: Counter = Counter()  # (调用路径, 类型) -> 数量
+        self.matched = 0  # 双方一致的事件数
+        self.threads = (0, 0)
+
+    @property
+    def identical(self) -> bool:
+        return not self.counts
+
+    @property
+    def first(self) -> Optional[Divergence]:
+        """The earliest divergence in log A (or B when it only exists there)."""
+        if not self.first_by_thread:
+            return None
+        return min(
+            self.first_by_thread.values(),
+            key=lambda d: (d.a.position if d.a else float("inf"), d.b.position if d.b else float("inf")),
+        )
+
+    def _record(self, thread, kind, a, b, stack, a_events, b_events) -> None:
+        divergence = Divergence(
+            kind,
+            thread,
+            tuple(call_label(TraceEvent._make(e)) for e in stack),
+            TraceEvent._make(a) if a is not None else None,
+            TraceEvent._make(b) if b is not None else None,
+            a_events,
+            b_events,
+        )
+        self.counts[kind] += 1
+        self.first_by_thread.setdefault(thread, divergence)
+        if len(self.divergences) < self.max_divergences:
+            self.divergences.append(divergence)
+        key = (" > ".join(divergence.path), kind)
+        if key in self.subtrees or len(self.subtrees) < MAX_SUMMARY_PATHS:
+            self.subtrees[key] += 1
+        else:
+            self.subtrees[("…", kind)] += 1
+
+    def run(self) -> "TraceDiff":
+        spills_a, threads_a = _split_log(self.log_a)
+        try:
+            spills_b, threads_b = _split_log(self.log_b)
+        except BaseException:
+            for spill in spills_a:
+                spill.close()
+            raise
+        try:
+            for thread in range(max(len(spills_a), len(spills_b))):
+                stream_a = spills_a[thread] if thread < len(spills_a) else io.BytesIO()
+                stream_b = spills_b[thread] if thread < len(spills_b) else io.BytesIO()
+                self.matched += diff_trace_streams(stream_a, stream_b, functools.partial(self._record, thread))
+        finally:
+            for spill in spills_a + spills_b:
+                spill.close()
+        self.threads = (threads_a, threads_b)
+        return self
+
+    def to_dict(self) -> Dict:
+        def event(e: Optional[TraceEvent]):
+            return e._asdict() if e else None
+
+        def divergence(d: Optional[Divergence]):
+            if d is None:
+                return None
+            return {**d._asdict(), "path": list(d.path), "a": event(d.a), "b": event(d.b)}
+
+        return {
+            "log_a": str(self.log_a),
+            "log_b": str(self.log_b),
+            "identical": self.identical,
+            "matched_events": self.matched,
+            "threads": list(self.threads),
+            "counts": dict(self.counts),
+            "first": divergence(self.first),
+            "divergences": [divergence(d) for d in self.divergences],
+            "subtrees": [{"path": path, "kind": kind, "count": n} for (path, kind), n in self.subtrees.most_common()],
+        }
+
+    def format(self, max_subtrees: int = 20) -> str:
+        lines = [f"A: {self.log_a}", f"B: {self.log_b}"]
+        lines.append(f"一致事件 {self.matched}，线程数 A {self.threads[0]} / B {self.threads[1]}")
+        first = self.first
+        if first is None:
+            lines.append("两次运行的追踪完全一致")
+            return "\n".join(lines)
+        lines.append(f"第一处分歧（线程 {first.thread}，{first.kind}）：")
+        lines.append(f"  调用栈: {' > '.join(first.path) or '<顶层>'}")
+        for name, log, e in (("A", self.log_a, first.a), ("B", self.log_b, first.b)):
+            lines.append(f"  {name} {log.name}:{e.lineno}  {e.text}" if e else f"  {name} <已结束>")
+        total = sum(self.counts.values())
+        lines.append(f"分歧共 {total} 处: " + ", ".join(f"{k} {n}" for k, n in self.counts.most_common()))
+        for (path, kind), n in self.subtrees.most_common(max_subtrees):
+            lines.append(f"  {n:>6}  {kind:<9} {path or '<顶层>'}")
+        return "\n".join(lines)
+
+
+def diff_traces(log_a, log_b, max_divergences: int = DEFAULT_MAX_DIVERGENCES) -> TraceDiff:
+    """Compares two trace logs; see the module docstring."""
+    return TraceDiff(log_a, log_b, max_divergences).run()
+
+
+def main(argv=None) -> int:
+    import argparse
+
+    parser = argparse.ArgumentParser(description="找出两次运行的追踪日志的第一处分歧 (读取 .log / .log.z)")
+    parser.add_argument("log_a", type=Path, help="基准运行的日志，例如 good/trace_report.log")
+    parser.add_argument("log_b", type=Path, help="对比运行的日志")
+    parser.add_argument("--json", action="store_true", help="以 JSON 输出结果")
+    parser.add_argument(
+        "--max-divergences", type=int, default=DEFAULT_MAX_DIVERGENCES, help="最多记录的分歧条数（汇总不受限制）"
+    )
+    args = parser.parse_args(argv)
+    for path in (args.log_a, args.log_b):
+        if not path.exists():
+            parser.error(f"{path} 不存在")
+    diff = diff_traces(args.log_a, args.log_b, args.max_divergences)
+    if args.json:
+        print(json.dumps(diff.to_dict(), ensure_ascii=False, indent=2))
+    else:
+        print(diff.format())
+    return 0 if diff.identical else 1
+
+
+try:
+    from .tracer_core import diff_trace_streams, split_trace_threads
+except ImportError:
+    # tracer_core is not built or was built for another Python version.
+    diff_trace_streams = _py_diff_streams
+    split_trace_threads = _py_split_threads
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,481 @@
+"""
+Paged access to a trace log through a binary frame-range index.
+
+The tracer writes `<name>.log` together with `<name>.log.index`, a JSON line
+per call/return/exception holding its byte position in the log. The index is
+converted once into `<name>.log.frames`: fixed-size records in call order (a
+preorder walk of the call tree), so a frame's descendants are the contiguous
+records `[i + 1, subtree_end)`. A page of any subtree is then a binary search
+plus a bounded read of the memory-mapped log, independent of the trace size.
+Compressed `<name>.log.z` logs (see seekable_log.py) are read through the
+same interface, decompressing only the frames a page touches.
+
+`serve_trace` exposes the pages over a local HTTP endpoint for the viewer in
+`web/templates/trace_viewer.html`; `web/service.py` mounts the same API.
+"""
+
+import json
+import logging
+import mmap
+import os
+import struct
+import threading
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from pathlib import Path
+from typing import Any, Dict, List, NamedTuple, Optional, Tuple
+from urllib.parse import parse_qs, urlparse
+
+from .seekable_log import SeekableLogReader, is_seekable_log, log_text_size
+
+try:
+    from .tracer_core import build_frame_index as _native_build_frame_index
+except ImportError:
+    _native_build_frame_index = None
+
+# Shared with frame_index::Header / frame_index::Record in cpp/tracer_core.cpp.
+_MAGIC = b"TRFRIDX1"
+_VERSION = 1
+_HEADER = struct.Struct("=8sIIQQQ24x")
+_RECORD = struct.Struct("=QQIIIIII")
+
+# 摘要里的日志路径相对项目根目录显示，避免把本机绝对路径暴露给查看器。
+_PROJECT_ROOT = Path(__file__).resolve().parent.parent
+
+NO_PARENT = 0xFFFFFFFF
+FLAG_OPEN, FLAG_RETURNED, FLAG_EXCEPTION = 0, 1, 2
+_STATUS = {FLAG_OPEN: "open", FLAG_RETURNED: "returned", FLAG_EXCEPTION: "exception"}
+
+DEFAULT_PAGE_SIZE = 200
+MAX_PAGE_SIZE = 2000
+MAX_LINE_CHARS = 20000
+
+_WEB_DIR = Path(__file__).parent / "web"
+
+
+class FrameRecord(NamedTuple):
+    start: int
+    end: int
+    frame_id: int
+    parent: int
+    subtree_end: int
+    child_count: int
+    depth: int
+    flags: int
+
+
+def _build_frame_index_py(index_file: str, out_file: str, log_size: int) -> int:
+    """Pure Python version of tracer_core.build_frame_index, used when the extension is not built."""
+    with open(index_file, "rb") as f:
+        index_data = f.read()
+    records: List[List[int]] = []
+    open_frames: Dict[int, int] = {}
+    for raw in index_data.splitlines():
+        if raw.startswith(b"#"):
+            continue
+        try:
+            entry = json.loads(raw)
+            entry_type, frame_id, position = entry["type"], int(entry["frame_id"]), int(entry["position"])
+        except (ValueError, KeyError, TypeError):
+            continue
+        current = open_frames.get(frame_id)
+        if entry_type == "call":
+            if current is not None:
+                if records[current][7] == FLAG_OPEN:
+                    records[current][1] = position
+                del open_frames[frame_id]
+            open_frames[frame_id] = len(records)
+            records.append([position, 0, frame_id, NO_PARENT, 0, 0, 0, FLAG_OPEN])
+        elif current is not None and position >= records[current][0]:
+            records[current][1] = position
+            if entry_type == "return":
+                records[current][7] = FLAG_RETURNED
+                del open_frames[frame_id]
+            elif entry_type == "exception":
+                records[current][7] = FLAG_EXCEPTION
+
+    stack: List[int] = []
+    for i, record in enumerate(records):
+        while stack and records[stack[-1]][1] <= record[0]:
+            records[stack.pop()][4] = i
+        limit = records[stack[-1]][1] if stack else log_size
+        if record[1] == 0 or record[1] > limit:
+            record[1] = limit
+            if record[7] != FLAG_RETURNED or record[1] < record[0]:
+                record[7] = FLAG_OPEN
+        record[1] = max(record[1], record[0])
+        record[6] = len(stack)
+        if stack:
+            record[3] = stack[-1]
+            records[stack[-1]][5] += 1
+        stack.append(i)
+    for i in stack:
+        records[i][4] = len(records)
+
+    tmp_file = f"{out_file}.tmp"
+    with open(tmp_file, "wb") as f:
+        f.write(_HEADER.pack(_MAGIC, _VERSION, _RECORD.size, len(records), log_size, len(index_data)))
+        for record in records:
+            f.write(_RECORD.pack(*record))
+    os.replace(tmp_file, out_file)
+    return len(records)
+
+
+def build_frame_index(index_file: str, out_file: str, log_size: int) -> int:
+    """Writes the frame-range index for a log, natively when tracer_core is available."""
+    if _native_build_frame_index is not None:
+        return _native_build_frame_index(str(index_file), str(out_file), log_size)
+    return _build_frame_index_py(str(index_file), str(out_file), log_size)
+
+
+def prebuild_frame_index(log_file) -> None:
+    """Builds the index right after tracing so the viewer opens instantly; skipped without tracer_core."""
+    if _native_build_frame_index is None or not os.path.exists(f"{log_file}.index"):
+        return
+    try:
+        build_frame_index(f"{log_file}.index", f"{log_file}.frames", log_text_size(log_file))
+    except OSError as e:
+        logging.warning("无法生成帧区间索引 %s: %s", log_file, e)
+
+
+def _map(path: str):
+    with open(path, "rb") as f:
+        if os.fstat(f.fileno()).st_size == 0:
+            return b""
+        return mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+
+
+class FrameRangeIndex:
+    """
+    A trace log and its frame-range index, both memory-mapped.
+
+    The `.frames` file is rebuilt when it is missing or was built for a log or
+    index of a different size, so reopening an unchanged trace costs nothing.
+    """
+
+    def __init__(self, log_file):
+        self.log_file = str(log_file)
+        self.index_file = self.log_file + ".index"
+        self.frames_file = self.log_file + ".frames"
+        # 压缩日志（seekable_log.py）提供同样的切片/find/rfind 接口，位置都是未压缩文本中的位置
+        self._log = SeekableLogReader(self.log_file) if is_seekable_log(self.log_file) else _map(self.log_file)
+        self.log_size = len(self._log)
+        index_size = os.path.getsize(self.index_file) if os.path.exists(self.index_file) else 0
+        self._frames = self._open_frames(index_size)
+        if self._frames is None:
+            if index_size:
+                build_frame_index(self.index_file, self.frames_file, self.log_size)
+            else:
+                with open(self.frames_file, "wb") as f:
+                    f.write(_HEADER.pack(_MAGIC, _VERSION, _RECORD.size, 0, self.log_size, 0))
+            self._frames = self._open_frames(index_size)
+            if self._frames is None:
+                raise ValueError(f"invalid frame index: {self.frames_file}")
+        self.count = _HEADER.unpack_from(self._frames)[3]
+
+    def _open_frames(self, index_size: int):
+        try:
+            frames = _map(self.frames_file)
+        except OSError:
+            return None
+        if len(frames) >= _HEADER.size:
+            magic, version, record_size, count, log_size, stored_index_size = _HEADER.unpack_from(frames)
+            if (
+                (magic, version, record_size) == (_MAGIC, _VERSION, _RECORD.size)
+                and (log_size, stored_index_size) == (self.log_size, index_size)
+                and len(frames) >= _HEADER.size + count * _RECORD.size
+            ):
+                return frames
+        if isinstance(frames, mmap.mmap):
+            frames.close()
+        return None
+
+    def record(self, i: int) -> FrameRecord:
+        return FrameRecord._make(_RECORD.unpack_from(self._frames, _HEADER.size + i * _RECORD.size))
+
+    def _start(self, i: int) -> int:
+        return struct.unpack_from("=Q", self._frames, _HEADER.size + i * _RECORD.size)[0]
+
+    def first_at_or_after(self, position: int, lo: int = 0, hi: Optional[int] = None) -> int:
+        """Index of the first record in [lo, hi) whose call starts at or after `position`."""
+        hi = self.count if hi is None else hi
+        while lo < hi:
+            mid = (lo + hi) // 2
+            if self._start(mid) < position:
+                lo = mid + 1
+            else:
+                hi = mid
+        return lo
+
+    def innermost(self, position: int) -> int:
+        """The deepest frame whose range contains `position`, -1 for top level."""
+        i = self.first_at_or_after(position + 1) - 1
+        while i >= 0:
+            record = self.record(i)
+            if record.end > position:
+                return i
+            i = record.parent if record.parent != NO_PARENT else -1
+        return -1
+
+    def line_end(self, position: int, limit: int) -> int:
+        newline = self._log.find(b"\n", position, limit)
+        return limit if newline < 0 else newline + 1
+
+    def last_line_start(self, start: int, end: int) -> int:
+        return self._log.rfind(b"\n", start, max(start, end - 1)) + 1
+
+    def text(self, start: int, end: int) -> str:
+        text = self._log[start : min(end, start + 4 * MAX_LINE_CHARS)].decode("utf-8", "replace").rstrip("\n")
+        return text if len(text) <= MAX_LINE_CHARS else text[:MAX_LINE_CHARS] + " …"
+
+    def find(self, needle: bytes, position: int) -> int:
+        return self._log.find(needle, position)
+
+    def close(self):
+        for mapping in (self._log, self._frames):
+            if isinstance(mapping, (mmap.mmap, SeekableLogReader)):
+                mapping.close()
+
+
+class TracePager:
+    """
+    Serves the call tree of a trace log page by page.
+
+    Node -1 is the top level. A page lists, in log order, the lines of a node's
+    body and its direct child frames; children are collapsed items that are
+    paged in separately when expanded.
+    """
+
+    def __init__(self, log_file):
+        self.index = FrameRangeIndex(log_file)
+        self._lock = threading.Lock()
+
+    def close(self):
+        self.index.close()
+
+    def _body(self, node: int) -> Tuple[int, int, int, int]:
+        """(body_start, body_end, first_child, child_limit) of a node."""
+        index = self.index
+        if node < 0:
+            return 0, index.log_size, 0, index.count
+        record = index.record(node)
+        body_start = index.line_end(record.start, record.end)
+        body_end = record.end
+        if record.flags != FLAG_OPEN:
+            body_end = max(body_start, index.last_line_start(record.start, record.end))
+        return body_start, body_end, node + 1, record.subtree_end
+
+    def frame_item(self, i: int) -> Dict[str, Any]:
+        index = self.index
+        record = index.record(i)
+        call_end = index.line_end(record.start, record.end)
+        close = None
+        if record.flags != FLAG_OPEN:
+            close_start = index.last_line_start(record.start, record.end)
+            if close_start >= call_end:
+                close = index.text(close_start, record.end)
+        return {
+            "type": "frame",
+            "id": i,
+            "frame_id": record.frame_id,
+            "offset": record.start,
+            "call": index.text(record.start, call_end),
+            "close": close,
+            "status": _STATUS.get(record.flags, "open"),
+            "children": record.child_count,
+            "descendants": record.subtree_end - i - 1,
+            "has_body": call_end < (close_start if close is not None else record.end),
+        }
+
+    def page(self, node: int = -1, cursor: Optional[int] = None, limit: int = DEFAULT_PAGE_SIZE) -> Dict[str, Any]:
+        """
+        One page of a node's body starting at byte `cursor` (the body start by default).
+
+        Returns the items and the cursor of the next page, None at the end.
+        """
+        with self._lock:
+            index = self.index
+            if node >= index.count:
+                raise ValueError(f"no such frame: {node}")
+            limit = max(1, min(limit, MAX_PAGE_SIZE))
+            body_start, body_end, lo, hi = self._body(node)
+            pos = body_start if cursor is None else min(max(cursor, body_start), body_end)
+            child = index.first_at_or_after(pos, lo, hi)
+            items: List[Dict[str, Any]] = []
+            while pos < body_end and len(items) < limit:
+                next_start = index.record(child).start if child < hi else body_end
+                if child < hi and next_start <= pos:
+                    items.append(self.frame_item(child))
+                    record = index.record(child)
+                    pos = max(pos, record.end)
+                    child = record.subtree_end
+                    continue
+                stop = min(next_start, body_end)
+                while pos < stop and len(items) < limit:
+                    end = index.line_end(pos, stop)
+                    items.append({"type": "line", "offset": pos, "text": index.text(pos, end)})
+                    pos = end
+            return {
+                "node": node,
+                "cursor": body_start if cursor is None else cursor,
+                "at_start": cursor is None or cursor <= body_start,
+                "items": items,
+                "next": pos if pos < body_end else None,
+            }
+
+    def search(self, query: str, position: int = 0) -> Optional[Dict[str, Any]]:
+        """
+        Finds the next occurrence of `query` at or after `position`.
+
+        Returns the frames to expand, from the top level down, each with the
+        cursor to page it from so the match is on the first page.
+        """
+        if not query:
+            return None
+        with self._lock:
+            index = self.index
+            hit = index.find(query.encode("utf-8"), max(0, position))
+            if hit < 0:
+                return None
+            line_start = index.last_line_start(0, hit + 1) if hit else 0
+            target = index.innermost(line_start)
+            container, cursor = target, line_start
+            if target >= 0:
+                record = index.record(target)
+                call_end = index.line_end(record.start, record.end)
+                body_end = self._body(target)[1]
+                if line_start < call_end or (record.flags != FLAG_OPEN and line_start >= body_end):
+                    # 命中 call 行或结束行：定位到父节点中的这个帧条目
+                    container = record.parent if record.parent != NO_PARENT else -1
+                    cursor = record.start
+            path = []
+            node = container
+            while node >= 0:
+                path.append(node)
+                parent = index.record(node).parent
+                node = parent if parent != NO_PARENT else -1
+            path.reverse()
+            levels = [-1] + path
+            cursors = [index.record(n).start for n in path] + [cursor]
+            return {
+                "position": hit,
+                "line": line_start,
+                "levels": [{"node": n, "cursor": c} for n, c in zip(levels, cursors)],
+                "next": hit + 1,
+            }
+
+    def summary(self) -> Dict[str, Any]:
+        index = self.index
+        log = Path(index.log_file).resolve()
+        try:
+            log = log.relative_to(_PROJECT_ROOT)
+        except ValueError:
+            pass
+        return {"log": log.as_posix(), "size": index.log_size, "frames": index.count}
+
+
+def handle_api(pager: TracePager, action: str, params: Dict[str, str]) -> Dict[str, Any]:
+    """Dispatches one API call; shared by `serve_trace` and web/service.py."""
+    if action == "page":
+        cursor = params.get("cursor")
+        return pager.page(
+            int(params.get("node", -1)),
+            int(cursor) if cursor not in (None, "") else None,
+            int(params.get("limit", DEFAULT_PAGE_SIZE)),
+        )
+    if action == "search":
+        return {"result": pager.search(params.get("q", ""), int(params.get("from", 0)))}
+    if action == "summary":
+        return pager.summary()
+    raise KeyError(action)
+
+
+def _static_file(path: str) -> Optional[Path]:
+    root = (_WEB_DIR / "static").resolve()
+    candidate = (root / path).resolve()
+    if root not in candidate.parents or not candidate.is_file():
+        return None
+    return candidate
+
+
+_CONTENT_TYPES = {".js": "application/javascript", ".css": "text/css", ".html": "text/html"}
+
+
+def make_server(log_file, host: str = "127.0.0.1", port: int = 0) -> ThreadingHTTPServer:
+    """HTTP server for the paged viewer of one trace log; port 0 picks a free port."""
+    pager = TracePager(log_file)
+
+    class Handler(BaseHTTPRequestHandler):
+        def _send(self, status: int, body: bytes, content_type: str):
+            self.send_response(status)
+            self.send_header("Content-Type", f"{content_type}; charset=utf-8")
+            self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+            self.wfile.write(body)
+
+        def do_GET(self):  # noqa: N802
+            url = urlparse(self.path)
+            if url.path in ("/", "/index.html"):
+                body = (_WEB_DIR / "templates" / "trace_viewer.html").read_bytes()
+                self._send(200, body, "text/html")
+            elif url.path.startswith("/static/"):
+                static = _static_file(url.path[len("/static/") :])
+                if static is None:
+                    self._send(404, b"not found", "text/plain")
+                else:
+                    self._send(200, static.read_bytes(), _CONTENT_TYPES.get(static.suffix, "text/plain"))
+            elif url.path.startswith("/api/"):
+                params = {key: values[-1] for key, values in parse_qs(url.query).items()}
+                try:
+                    result = handle_api(pager, url.path[len("/api/") :], params)
+                except KeyError:
+                    self._send(404, b"not found", "text/plain")
+                    return
+                except ValueError as e:
+                    self._send(400, json.dumps({"error": str(e)}).encode("utf-8"), "application/json")
+                    return
+                self._send(200, json.dumps(result, ensure_ascii=False).encode("utf-8"), "application/json")
+            else:
+                self._send(404, b"not found", "text/plain")
+
+        def log_message(self, format, *args):  # pylint: disable=redefined-builtin
+            pass
+
+    server = ThreadingHTTPServer((host, port), Handler)
+    server.pager = pager
+    return server
+
+
+def serve_trace(log_file, port: int = 0, open_browser: bool = False) -> None:
+    """Serves the paged viewer of a trace log until interrupted."""
+    server = make_server(log_file, port=port)
+    url = f"http://127.0.0.1:{server.server_address[1]}/"
+    print(f"分页查看追踪日志: {url}  (Ctrl+C 退出)")
+    if open_browser:
+        import webbrowser
+
+        webbrowser.open(url)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        server.server_close()
+        server.pager.close()
+
+
+def main(argv=None) -> int:
+    import argparse
+
+    parser = argparse.ArgumentParser(description="分页查看追踪日志 (读取 .log/.log.index)")
+    parser.add_argument("log_file", type=Path, help="追踪日志，例如 debugger/logs/trace_report.log")
+    parser.add_argument("--port", type=int, default=0, help="监听端口，默认随机")
+    parser.add_argument("--open", action="store_true", help="在浏览器中打开")
+    args = parser.parse_args(argv)
+    if not args.log_file.exists():
+        parser.error(f"{args.log_file} 不存在")
+    serve_trace(args.log_file, args.port, args.open)
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
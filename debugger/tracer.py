@@ -7,17 +7,19 @@ import json
 import linecache
 import logging
 import os
-import queue
 import sys
 import threading
-import time
 import traceback
 from collections import defaultdict
 from pathlib import Path
 from typing import TYPE_CHECKING, Any, Callable, Dict, List, Optional, Set, Tuple, Union
 
-from .source_cache import get_statement_info
-from .tracer_common import TraceTypes, truncate_repr_value
+from .output_queue import DEFAULT_CAPACITY, POLICIES, OutputQueue
+from .seekable_log import SeekableLogWriter, open_log
+from .source_cache import get_statement_info, source_cache_manager
+from .source_disk_cache import SourceDiskCache, code_key
+from .trace_pager import prebuild_frame_index
+from .tracer_common import TraceTypes, format_log_message, truncate_repr_value
 from .tracer_html import CallTreeHtmlRender
 from .utils.path_utils import to_relative_module_path
 
@@ -74,9 +76,11 @@ _INDENT = "  "
 _LOG_DIR = Path(__file__).parent / "logs"
 _LOG_DIR.mkdir(parents=True, exist_ok=True)
 TRACE_LOG_NAME = _LOG_DIR / "trace.log"
+_DEFAULT_SOURCE_CACHE_DIR = _LOG_DIR / "source_cache"
 LOG_NAME = _LOG_DIR / "debug.log"
 _MAX_CALL_DEPTH = 20
 _DEFAULT_REPORT_NAME = "trace_report.html"
+_FLUSH_JOIN_TIMEOUT = 10.0  # stop() 等待输出线程写完剩余日志的秒数
 
 
 # 该字典已被colorama替代
@@ -109,6 +113,11 @@ class TraceConfig:
         disable_html: bool = False,
         include_stdlibs: Optional[List[str]] = None,
         trace_c_calls: bool = False,
+        enable_source_cache: bool = True,
+        source_cache_dir: Optional[Union[str, Path]] = None,
+        output_policy: str = "block",
+        output_queue_size: int = DEFAULT_CAPACITY,
+        compress_log: bool = False,
     ):
         """
         初始化跟踪配置
@@ -128,6 +137,11 @@ class TraceConfig:
             disable_html: 是否禁用HTML报告生成
             include_stdlibs: 特别包含的标准库模块列表（即使ignore_system_paths=True）
             trace_c_calls: 是否启用C函数调用跟踪
+            enable_source_cache: 是否启用磁盘上的语句行表/源码缓存，未修改的文件不再重新解析
+            source_cache_dir: 磁盘缓存目录，默认为 logs/source_cache
+            output_policy: 输出队列满时的策略，block（等待）、drop_oldest（丢弃最旧）或 sample（采样）
+            output_queue_size: 输出队列容量（消息条数）
+            compress_log: 是否把追踪日志写成可随机访问的压缩格式（.log.z），见 seekable_log.py
         """
         self.target_files = target_files or []
         self.line_ranges = self._parse_line_ranges(line_ranges or {})
@@ -146,6 +160,18 @@ class TraceConfig:
         self.disable_html = disable_html
         self.include_stdlibs = include_stdlibs or []
         self.trace_c_calls = trace_c_calls
+        self.enable_source_cache = enable_source_cache
+        self.source_cache_dir: Path = Path(source_cache_dir) if source_cache_dir else _DEFAULT_SOURCE_CACHE_DIR
+        if output_policy not in POLICIES:
+            raise ValueError(f"未知的输出队列策略: {output_policy}，可选 {', '.join(POLICIES)}")
+        self.output_policy = output_policy
+        self.output_queue_size = output_queue_size
+        self.compress_log = compress_log
+
+    @property
+    def log_name(self) -> str:
+        """追踪日志文件名，与报告同名；压缩日志使用 .log.z 后缀"""
+        return Path(self.report_name).stem + (".log.z" if self.compress_log else ".log")
 
     @staticmethod
     def _get_system_paths() -> Set[str]:
@@ -242,6 +268,11 @@ class TraceConfig:
             include_stdlibs=config_data.get("include_stdlibs", []),
             disable_html=config_data.get("disable_html", False),
             trace_c_calls=config_data.get("trace_c_calls", False),
+            enable_source_cache=config_data.get("enable_source_cache", True),
+            source_cache_dir=config_data.get("source_cache_dir", None),
+            output_policy=config_data.get("output_policy", "block"),
+            output_queue_size=config_data.get("output_queue_size", DEFAULT_CAPACITY),
+            compress_log=config_data.get("compress_log", False),
         )
 
     @staticmethod
@@ -929,7 +960,7 @@ class TraceLogExtractor:
 
         logs = []
         for start, end in pair:
-            with open(self.log_file, "r", encoding="utf-8") as f:
+            with open_log(self.log_file) as f:
                 f.seek(start)
                 log_lines = []
                 while f.tell() <= end:
@@ -970,7 +1001,7 @@ class TraceLogic:
     def __init__(self, config: TraceConfig):
         """初始化实例属性"""
         self.config = config
-        self._log_queue = queue.Queue()
+        self._log_queue = self._create_output_queue()
         self._flush_event = threading.Event()
         self._timer_thread = None
         self._running_flag = False
@@ -985,12 +1016,18 @@ class TraceLogic:
         self._output = self._OutputHandlers(self)
         self.last_statement_vars = None
         self._last_vars_by_frame = {}  # Cache for tracking variable changes
-        self.enable_output("file", filename=str(Path(_LOG_DIR) / Path(self.config.report_name).stem) + ".log")
+        self.enable_output(
+            "file", filename=str(Path(_LOG_DIR) / self.config.log_name), compress=self.config.compress_log
+        )
         if self.config.disable_html:
             self.disable_output("html")
         self._local = threading.local()
         self._local.stack_depth = 0
         self._local.bad_frame = None
+        # 磁盘缓存：未修改的文件直接读取预先算好的语句行表和变量操作表
+        source_cache_manager.set_disk_cache(
+            SourceDiskCache(self.config.source_cache_dir) if self.config.enable_source_cache else None
+        )
 
     def maybe_unwanted_frame(self, frame):
         if frame.f_code.co_name in self.config.exclude_functions and self._local.bad_frame is None:
@@ -1032,8 +1069,11 @@ class TraceLogic:
         """启用特定类型的输出"""
         if output_type == "file" and "filename" in kwargs:
             try:
-                # 使用with语句确保文件正确关闭
-                self._output._log_file = open(kwargs["filename"], "w+", encoding="utf-8")
+                if kwargs.get("compress"):
+                    # 压缩日志：tell() 仍返回未压缩文本中的位置，索引格式不变
+                    self._output._log_file = SeekableLogWriter(kwargs["filename"])
+                else:
+                    self._output._log_file = open(kwargs["filename"], "w+", encoding="utf-8")
                 self._output._log_file_index = open(str(kwargs["filename"]) + ".index", "w+", encoding="utf-8")
             except (IOError, OSError, PermissionError) as e:
                 logging.error("无法打开日志文件: %s", str(e))
@@ -1100,35 +1140,43 @@ class TraceLogic:
         self._html_render.add_raw_message(log_data, color_type)
 
     def _format_log_message(self, log_data):
-        """格式化日志消息"""
-        if isinstance(log_data, str):
-            return log_data
-        return log_data["template"].format(**log_data["data"])
+        """格式化日志消息，同一条消息只格式化一次，各输出共用结果"""
+        return format_log_message(log_data)
+
+    def _create_output_queue(self):
+        """创建输出队列，批量大小和等待时间见 output_queue.py"""
+        return OutputQueue(capacity=self.config.output_queue_size, policy=self.config.output_policy)
 
     def _add_to_buffer(self, log_data, color_type):
-        """将日志数据添加到队列并立即处理"""
+        """将日志数据添加到输出队列，由输出线程批量处理"""
         if isinstance(log_data, dict) and "data" in log_data:
             thread_id = log_data["data"].get("thread_id")
             if thread_id is not None:
                 self._seen_thread_ids.add(thread_id)
         self._log_queue.put((log_data, color_type))
 
+    def _dispatch_batch(self, batch):
+        """把一批日志分发给所有启用的输出"""
+        handlers = [
+            self._output._output_handlers[output_type]
+            for output_type in self._output._active_outputs
+            if output_type in self._output._output_handlers
+        ]
+        for log_data, color_type in batch:
+            for handler in handlers:
+                handler(log_data, color_type)
+
     def _flush_buffer(self):
-        """刷新队列，输出所有日志"""
-        while not self._log_queue.empty():
-            try:
-                log_data, color_type = self._log_queue.get_nowait()
-                for output_type in self._output._active_outputs:
-                    if output_type in self._output._output_handlers:
-                        self._output._output_handlers[output_type](log_data, color_type)
-            except queue.Empty:
-                break
+        """刷新队列，在当前线程输出所有剩余日志"""
+        self._dispatch_batch(self._log_queue.drain())
 
     def _flush_scheduler(self):
-        """定时刷新调度器"""
-        while self._running_flag:
-            time.sleep(1)
-            self._flush_buffer()
+        """输出线程：等待下一批日志（不持有 GIL），队列关闭并取空后退出"""
+        while True:
+            batch = self._log_queue.get_batch()
+            if not batch:
+                break
+            self._dispatch_batch(batch)
 
     def _get_formatted_filename(self, filename: str) -> str:
         """
@@ -1311,7 +1359,12 @@ class TraceLogic:
 
         from .variable_trace import analyze_variable_ops  # 导入分析函数
 
-        analysis = analyze_variable_ops(code_obj)
+        cached_source = source_cache_manager.get_cached_source(code_obj.co_filename)
+        analysis = cached_source.get_var_ops(code_key(code_obj)) if cached_source else None
+        if analysis is None:
+            analysis = analyze_variable_ops(code_obj)
+            if cached_source:
+                cached_source.put_var_ops(code_key(code_obj), analysis)
         self._file_cache._var_ops_cache[code_obj] = analysis
         return analysis
 
@@ -1380,7 +1433,7 @@ class TraceLogic:
         lineno = frame.f_lineno
         filename = frame.f_code.co_filename
 
-        statement_info = get_statement_info(filename, lineno)
+        statement_info = get_statement_info(filename, lineno, frame.f_code)
         if statement_info:
             full_statement, start_line, end_line = statement_info
             if end_line - start_line > 10:
@@ -1677,6 +1730,8 @@ class TraceLogic:
             return {}
 
     def start_flush_thread(self):
+        if self._log_queue.closed:
+            self._log_queue = self._create_output_queue()
         self._timer_thread = threading.Thread(target=self._flush_scheduler)
         self._timer_thread.daemon = True
         self._timer_thread.start()
@@ -1690,13 +1745,34 @@ class TraceLogic:
         停止逻辑处理, 返回最终报告路径
         """
         self._running_flag = False
+        # 关闭后输出线程把剩余日志处理完再退出
+        self._log_queue.close()
+        output_done = True
         if self._timer_thread:
-            self._timer_thread.join(timeout=1)
-
-        self._flush_buffer()
-        while not self._log_queue.empty():
-            self._log_queue.get_nowait()
-        self.disable_output("file")
+            self._timer_thread.join(timeout=_FLUSH_JOIN_TIMEOUT)
+            if self._timer_thread.is_alive():
+                # 输出线程还在写：本线程不再取空队列、也不关闭日志文件，免得两个线程同时写或写到已关闭的文件
+                logging.warning("输出线程 %.0f 秒内未退出，剩余日志由它继续写，日志文件不关闭", _FLUSH_JOIN_TIMEOUT)
+                output_done = False
+            self._timer_thread = None
+        if output_done:
+            self._flush_buffer()
+        stats = self._log_queue.stats()
+        if stats["dropped"]:
+            logging.warning(
+                "输出队列按 %s 策略丢弃了 %d 条日志（共 %d 条）",
+                self.config.output_policy,
+                stats["dropped"],
+                stats["accepted"] + stats["dropped"],
+            )
+        log_file = None
+        if output_done:
+            log_file = self._output._log_file.name if self._output._log_file else None
+            self.disable_output("file")
+        source_cache_manager.flush_disk_cache()
+        if log_file:
+            # 提前生成帧区间索引，分页查看大日志时不用再等
+            prebuild_frame_index(log_file)
 
         report_path = None
         if "html" in self._output._active_outputs:
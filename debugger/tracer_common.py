@@ -6,6 +6,13 @@ from unittest.mock import Mock
 if TYPE_CHECKING:
     from unittest.mock import Mock
 
+try:
+    # 原生模板格式化（见 cpp/tracer_core.cpp 的 log_format）
+    from .tracer_core import format_log as _native_format_log
+except ImportError:
+    # tracer_core 未编译或与当前 Python 版本不匹配
+    _native_format_log = None
+
 # Constants
 _MAX_VALUE_LENGTH = 256
 _MAX_SEQ_ITEMS = 10
@@ -152,3 +159,27 @@ def truncate_repr_value(value: Any, keep_elements: int = 10) -> str:
     if len(preview) > _MAX_VALUE_LENGTH:
         preview = preview[:_MAX_VALUE_LENGTH] + "..."
     return preview
+
+
+def format_log_message(log_data) -> str:
+    """
+    Formats a log message once and stores the result in `log_data["message"]`,
+    so the console, file and HTML outputs share a single formatting pass.
+
+    Args:
+        log_data: A plain string, or a dict with "template" and "data".
+
+    Returns:
+        The formatted message.
+    """
+    if isinstance(log_data, str):
+        return log_data
+    message = log_data.get("message")
+    if message is None:
+        template, data = log_data["template"], log_data["data"]
+        if _native_format_log is not None:
+            message = _native_format_log(template, data)
+        if message is None:
+            message = template.format(**data)
+        log_data["message"] = message
+    return message
@@ -3,20 +3,32 @@ HTML Report Renderer for Python Tracer.
 
 This module provides the CallTreeHtmlRender class, which is responsible for
 transforming raw trace data into an interactive and human-readable HTML report.
+
+The report is streamed: message fragments are written to a work file as they
+arrive, and source files and per-frame executed lines are written to small
+script chunks that the viewer loads on demand. Memory use does not grow with
+the number of trace events.
 """
 
 import base64
 import datetime
 import dis
 import html
+import io
 import json
 import logging
+import os
 import shutil
-from collections import defaultdict
+import tempfile
+import threading
+from collections import defaultdict, deque
 from pathlib import Path
-from typing import TYPE_CHECKING, Any, DefaultDict, Dict, List, Optional, Set, Tuple, Union
+from typing import IO, TYPE_CHECKING, Any, DefaultDict, Deque, Dict, List, Optional, Set, Tuple, Union
+
+from .line_bitmap import LineBitmap, to_base64
+from .tracer_common import TraceTypes, format_log_message, truncate_repr_value
 
-from .tracer_common import TraceTypes, truncate_repr_value
+_LOG_DIR = Path(__file__).parent / "logs"
 
 if TYPE_CHECKING:
     from .tracer import TraceLogic
@@ -30,15 +42,26 @@ class CallTreeHtmlRender:
     into HTML, and embeds them in a template that includes JavaScript for
     interactivity (e.g., searching, folding/unfolding call stacks, viewing source).
 
+    Messages are rendered as soon as their stack variables are complete (when a
+    message with a later index arrives) and appended to a work file. Executed
+    lines are kept in a `LineBitmap` only for frames that have not returned yet;
+    finished frames are appended to `lines_<n>.js` chunks grouped by frame id,
+    encoded as base64 run lengths (see line_bitmap.py). Every source file
+    is written once to a `source_<n>.js` chunk. `save_to_file` wraps the work
+    file in the template and moves the chunks to `<report>_files/` next to it.
+
     Attributes:
         trace_logic (TraceLogic): The parent TraceLogic instance providing context.
-        _messages (List[Tuple[str, str, Optional[Dict[str, Any]]]]): A list to store log messages.
+        _pending (Deque[Tuple[str, str, Optional[Dict[str, Any]]]]): Messages waiting for their stack variables.
             Each tuple contains the formatted message string, message type, and original log data.
-        _executed_lines (DefaultDict[str, DefaultDict[int, Set[int]]]): A nested dictionary mapping
-            `filename -> frame_id -> set of executed line numbers`.
-        _source_files (Dict[str, str]): A cache for base64 encoded source file contents.
+        _frame_lines (Dict[int, Tuple[str, LineBitmap]]): Executed lines of frames that have not returned,
+            `frame_id -> (filename, bitmap of executed line numbers)`.
+        _finished_lines (DefaultDict[int, Dict[str, Dict[int, LineBitmap]]]): Executed lines of returned frames
+            waiting to be appended to their chunk, `chunk -> filename -> frame_id -> bitmap`.
+        _source_chunks (Dict[str, int]): Maps a source filename to the number of its chunk.
         _stack_variables (Dict[int, List[Tuple[int, Any, Any]]]): Maps a message index to its stack variables.
         _comments_data (DefaultDict[str, DefaultDict[int, List[str]]]): Maps filename and line number to comments.
+        _work_dir (Optional[Path]): Directory holding the streamed body and chunks until the report is saved.
         current_message_id (int): A counter for messages, used for unique IDs.
         _size_limit (int): The maximum size of the HTML report in bytes to prevent performance issues.
         _current_size (int): The current calculated size of the generated HTML content.
@@ -46,6 +69,11 @@ class CallTreeHtmlRender:
         _html_template (str): The HTML template string for the final report.
     """
 
+    # 每个 lines_<n>.js 分块包含的帧 ID 数
+    LINE_CHUNK_FRAMES = 1024
+    # 已返回帧的执行行累计到这么多帧后写出
+    LINE_FLUSH_FRAMES = 4096
+
     def __init__(self, trace_logic: "TraceLogic"):
         """
         Initializes the CallTreeHtmlRender instance.
@@ -54,15 +82,25 @@ class CallTreeHtmlRender:
             trace_logic: The parent TraceLogic instance that holds the trace configuration and state.
         """
         self.trace_logic: "TraceLogic" = trace_logic
-        self._messages: List[Tuple[str, str, Optional[Dict[str, Any]]]] = []
-        self._executed_lines: DefaultDict[str, DefaultDict[int, Set[int]]] = defaultdict(lambda: defaultdict(set))
-        self._source_files: Dict[str, str] = {}
+        self._pending: Deque[Tuple[str, str, Optional[Dict[str, Any]]]] = deque()
+        self._max_idx: int = -1
+        self._frame_lines: Dict[int, Tuple[str, LineBitmap]] = {}
+        self._finished_lines: DefaultDict[int, Dict[str, Dict[int, LineBitmap]]] = defaultdict(dict)
+        self._finished_frames: int = 0
+        self._source_chunks: Dict[str, int] = {}
         self._stack_variables: Dict[int, List[Tuple[int, Any, Any]]] = {}
         self._comments_data: DefaultDict[str, DefaultDict[int, List[str]]] = defaultdict(lambda: defaultdict(list))
         self.current_message_id: int = 0
         self._size_limit: int = 1024 * 1024 * 1024  # 100 MB
         self._current_size: int = 0
         self._size_exceeded: bool = False
+        self._message_count: int = 0
+        self._error_count: int = 0
+        self._work_dir: Optional[Path] = None
+        self._body: Optional[IO[str]] = None
+        # 刷新线程和 stop() 可能同时写报告
+        self._lock = threading.RLock()
+        self._closed: bool = False
         self._html_template: str = """
         <!DOCTYPE html>
         <html>
@@ -111,12 +149,15 @@ class CallTreeHtmlRender:
             <script src="https://cdnjs.cloudflare.com/ajax/libs/prism/1.29.0/plugins/line-numbers/prism-line-numbers.min.js"></script>
             <script src="https://cdnjs.cloudflare.com/ajax/libs/prism/1.29.0/plugins/toolbar/prism-toolbar.min.js"></script>
             <script src="https://cdnjs.cloudflare.com/ajax/libs/prism/1.29.0/plugins/copy-to-clipboard/prism-copy-to-clipboard.min.js"></script>
-            <script src="../tracer_scripts.js"></script>
             <script>
                 window.executedLines = {executed_lines_data};
                 window.sourceFiles = {source_files_data};
                 window.commentsData = {comments_data};
+                window.traceChunkBase = {chunk_base};
+                window.traceSourceChunks = {source_chunks};
+                window.traceLineChunkFrames = {line_chunk_frames};
             </script>
+            <script src="../tracer_scripts.js"></script>
         </body>
         </html>
         """
@@ -289,23 +330,88 @@ onclick="event.stopPropagation(); toggleCommentExpand('{comment_id}', event)">
         escaped_filename = filename.replace("\\", "\\\\").replace("'", "\\'")
         return f'<span class="view-source-btn" onclick="showSource(\'{escaped_filename}\', {line_number}, {frame_id})">view source</span>'
 
+    def _ensure_work_dir(self) -> Path:
+        """Creates the directory that receives the streamed body and chunks."""
+        if self._work_dir is None:
+            report_dir: Path = _LOG_DIR
+            report_dir.mkdir(exist_ok=True)
+            self._work_dir = Path(tempfile.mkdtemp(prefix=".report_", dir=report_dir))
+            (self._work_dir / "chunks").mkdir()
+            self._body = open(self._work_dir / "body.html", "w", encoding="utf-8")
+        return self._work_dir
+
+    def _write_chunk(self, name: str, script: str, mode: str = "w") -> None:
+        with open(self._ensure_work_dir() / "chunks" / name, mode, encoding="utf-8") as f:
+            f.write(script)
+
     def _load_source_file(self, filename: str) -> None:
         """
-        Loads source file content and stores it in a base64 encoded format.
+        Writes a source file, base64 encoded, to its own chunk.
 
-        If the file is already loaded, it does nothing.
+        If the file is already written, it does nothing.
 
         Args:
             filename: The path to the source file.
         """
-        if filename in self._source_files:
+        if filename in self._source_chunks:
             return
         try:
             with open(filename, "rb") as f:
                 content: str = base64.b64encode(f.read()).decode("utf-8")
-                self._source_files[filename] = content
         except (IOError, OSError) as e:
-            self._source_files[filename] = f"// Error loading source file: {str(e)}"
+            content = base64.b64encode(f"// Error loading source file: {str(e)}".encode("utf-8")).decode("utf-8")
+        chunk = len(self._source_chunks)
+        self._source_chunks[filename] = chunk
+        self._write_chunk(f"source_{chunk}.js", f"TraceChunks.source({json.dumps(filename)}, {json.dumps(content)});\n")
+
+    def _finish_frame(self, frame_id: int) -> None:
+        """Moves the executed lines of a returned frame to the chunk buffer."""
+        entry = self._frame_lines.pop(frame_id, None)
+        if entry is None:
+            return
+        filename, lines = entry
+        chunk = self._finished_lines[frame_id // self.LINE_CHUNK_FRAMES].setdefault(filename, {})
+        if frame_id in chunk:
+            chunk[frame_id].update(lines)
+        else:
+            chunk[frame_id] = lines
+        self._finished_frames += 1
+        if self._finished_frames >= self.LINE_FLUSH_FRAMES:
+            self._flush_lines()
+
+    def _flush_lines(self) -> None:
+        """Appends buffered executed lines to their `lines_<n>.js` chunks as base64 run lengths."""
+        for chunk, files in self._finished_lines.items():
+            encoded = {
+                filename: {frame_id: to_base64(lines) for frame_id, lines in frames.items()}
+                for filename, frames in files.items()
+            }
+            self._write_chunk(f"lines_{chunk}.js", f"TraceChunks.lines({json.dumps(encoded)});\n", mode="a")
+        self._finished_lines.clear()
+        self._finished_frames = 0
+
+    def _render_pending(self, final: bool = False) -> None:
+        """
+        Writes out pending messages whose stack variables are complete.
+
+        Stack variables for message `idx` are recorded while the tracer is still
+        on that message, so a message is complete once a later index was seen.
+        """
+        while self._pending:
+            message, msg_type, log_data = self._pending[0]
+            idx: Optional[int] = log_data.get("idx") if isinstance(log_data, dict) else None
+            if not final and idx is not None and idx >= self._max_idx:
+                break
+            self._pending.popleft()
+            is_error = msg_type in (TraceTypes.ERROR, TraceTypes.EXCEPTION, TraceTypes.COLOR_EXCEPTION)
+            if not self._size_exceeded or is_error:
+                self._ensure_work_dir()
+                self._body.write(self._message_to_html(message, msg_type, log_data))
+                self._message_count += 1
+                if is_error:
+                    self._error_count += 1
+            if idx is not None:
+                self._stack_variables.pop(idx, None)
 
     def add_message(self, message: str, msg_type: str, log_data: Optional[Dict[str, Any]] = None) -> None:
         """
@@ -316,9 +422,11 @@ onclick="event.stopPropagation(); toggleCommentExpand('{comment_id}', event)">
             msg_type: The category of the message (e.g., call, return).
             log_data: The associated raw log data dictionary.
         """
-        if self._size_exceeded:
-            return
-        self._messages.append((message, msg_type, log_data))
+        with self._lock:
+            if self._size_exceeded or self._closed:
+                return
+            self._pending.append((message, msg_type, log_data))
+            self._render_pending()
 
     def add_stack_variable_create(self, idx: int, opcode: int, var_name: Any, value: Any) -> None:
         """
@@ -330,68 +438,54 @@ onclick="event.stopPropagation(); toggleCommentExpand('{comment_id}', event)">
             var_name: The name of the variable.
             value: The value of the variable.
         """
-        if self._size_exceeded:
-            return
-        if idx not in self._stack_variables:
-            self._stack_variables[idx] = []
-        self._stack_variables[idx].append((opcode, var_name, value))
+        with self._lock:
+            if self._size_exceeded or self._closed:
+                return
+            if idx not in self._stack_variables:
+                self._stack_variables[idx] = []
+            self._stack_variables[idx].append((opcode, var_name, value))
 
     def add_raw_message(self, log_data: Union[str, Dict[str, Any]], color_type: str) -> None:
         """
         Adds a raw log data object and processes it for HTML rendering.
 
-        This method formats the log data, tracks executed lines, loads source
-        code, and appends the result to the message list.
+        This method formats the log data, tracks executed lines, writes source
+        code chunks, and queues the result for streaming.
 
         Args:
             log_data: The raw log data, which can be a string or a dictionary.
             color_type: The color/type category for the message.
         """
-        if self._size_exceeded:
-            return
+        with self._lock:
+            if self._size_exceeded or self._closed:
+                return
 
-        if isinstance(log_data, str):
-            message = log_data
-        else:
-            # Pre-format the message to avoid duplicate formatting.
-            message = log_data["template"].format(**log_data["data"])
+            # Shares the formatted text with the console and file outputs.
+            message = format_log_message(log_data)
 
-        if color_type == TraceTypes.COLOR_LINE and isinstance(log_data, dict) and "lineno" in log_data.get("data", {}):
-            data: Dict[str, Any] = log_data["data"]
-            original_filename: Optional[str] = data.get("original_filename")
-            lineno: Optional[int] = data.get("lineno")
+            data: Dict[str, Any] = log_data.get("data", {}) if isinstance(log_data, dict) else {}
             frame_id: Optional[int] = data.get("frame_id")
-            if original_filename and lineno is not None and frame_id is not None:
-                self._executed_lines[original_filename][frame_id].add(lineno)
-                self._load_source_file(original_filename)
-
-        self._messages.append((message, color_type, log_data))
-
-    def generate_html(self) -> str:
-        """
-        Generates the final, complete HTML report.
-
-        This method iterates through all collected messages, converts them to HTML,
-        and injects the result, along with metadata and supporting data (like
-        executed lines and source files), into the main HTML template.
-
-        Returns:
-            A string containing the full HTML report.
-        """
-        buffer: List[str] = []
-        error_count: int = 0
-        for _idx, (message, msg_type, log_data) in enumerate(self._messages):
-            if self._size_exceeded and msg_type not in (
-                TraceTypes.ERROR,
-                TraceTypes.EXCEPTION,
-                TraceTypes.COLOR_EXCEPTION,
-            ):
-                continue
-            buffer.append(self._message_to_html(message, msg_type, log_data))
-            if msg_type in (TraceTypes.ERROR, TraceTypes.EXCEPTION, TraceTypes.COLOR_EXCEPTION):
-                error_count += 1
-
-        title: str
+            if color_type == TraceTypes.COLOR_LINE and "lineno" in data:
+                original_filename: Optional[str] = data.get("original_filename")
+                lineno: Optional[int] = data.get("lineno")
+                if original_filename and lineno is not None and frame_id is not None:
+                    entry = self._frame_lines.get(frame_id)
+                    if entry is None or entry[0] != original_filename:
+                        if entry is not None:
+                            self._finish_frame(frame_id)
+                        entry = self._frame_lines[frame_id] = (original_filename, LineBitmap())
+                    entry[1].add(lineno)
+                    self._load_source_file(original_filename)
+            elif color_type == TraceTypes.COLOR_RETURN and frame_id is not None:
+                self._finish_frame(frame_id)
+
+            idx: Optional[int] = log_data.get("idx") if isinstance(log_data, dict) else None
+            if idx is not None:
+                self._max_idx = max(self._max_idx, idx)
+            self._pending.append((message, color_type, log_data))
+            self._render_pending()
+
+    def _report_title(self) -> str:
         try:
             # Defensively access config attributes to create a dynamic title
             config = getattr(self.trace_logic, "config", None)
@@ -399,42 +493,71 @@ onclick="event.stopPropagation(); toggleCommentExpand('{comment_id}', event)">
             target_module: Optional[str] = getattr(config, "target_module", None)
 
             if target_script and isinstance(target_script, Path):
-                title = f"Trace Report for {target_script.name}"
-            elif target_module:
-                title = f"Trace Report for module {target_module}"
-            else:
-                title = "Python Trace Report"
+                return f"Trace Report for {target_script.name}"
+            if target_module:
+                return f"Trace Report for module {target_module}"
+            return "Python Trace Report"
         except Exception:
             # Ultimate fallback in case of any unexpected errors
-            title = "Python Trace Report"
-
-        generation_time = datetime.datetime.now().strftime("%Y-%m-%d %H:%M:%S")
-        executed_lines_data: Dict[str, Dict[int, List[int]]] = {
-            filename: {frame_id: list(lines) for frame_id, lines in frames.items()}
-            for filename, frames in self._executed_lines.items()
-        }
-        executed_lines_json: str = json.dumps(executed_lines_data)
-        source_files_json: str = json.dumps(self._source_files)
-        comments_json: str = json.dumps(self._comments_data)
-
-        return self._html_template.format(
-            title=title,
-            generation_time=generation_time,
-            message_count=len(self._messages),
-            error_count=error_count,
-            content="".join(buffer),
-            executed_lines_data=executed_lines_json,
-            source_files_data=source_files_json,
-            comments_data=comments_json,
+            return "Python Trace Report"
+
+    def _finish(self) -> None:
+        """Renders all pending messages and writes out the remaining executed lines."""
+        self._render_pending(final=True)
+        for frame_id in list(self._frame_lines):
+            self._finish_frame(frame_id)
+        self._flush_lines()
+        self._ensure_work_dir()
+        self._body.flush()
+
+    def _write_report(self, out: IO[str], chunk_base: Optional[str], asset_prefix: str = "../") -> None:
+        """Writes the template around the streamed body."""
+        head, tail = self._html_template.split("{content}")
+        out.write(
+            head.format(
+                title=self._report_title(),
+                generation_time=datetime.datetime.now().strftime("%Y-%m-%d %H:%M:%S"),
+                message_count=self._message_count,
+                error_count=self._error_count,
+            ).replace('href="../tracer_styles.css"', f'href="{asset_prefix}tracer_styles.css"')
+        )
+        with open(self._work_dir / "body.html", "r", encoding="utf-8") as body:
+            shutil.copyfileobj(body, out)
+        out.write(
+            tail.format(
+                executed_lines_data="{}",
+                source_files_data="{}",
+                comments_data=json.dumps(self._comments_data),
+                chunk_base=json.dumps(chunk_base),
+                source_chunks=json.dumps(self._source_chunks),
+                line_chunk_frames=self.LINE_CHUNK_FRAMES,
+            ).replace('src="../tracer_scripts.js"', f'src="{asset_prefix}tracer_scripts.js"')
         )
 
+    def generate_html(self) -> str:
+        """
+        Generates the complete HTML report as a string.
+
+        Chunk data (source files, executed lines) is referenced relative to the
+        working directory; use `save_to_file` for a report that can be opened.
+
+        Returns:
+            A string containing the full HTML report.
+        """
+        with self._lock:
+            self._finish()
+            out = io.StringIO()
+            self._write_report(out, chunk_base=(self._work_dir / "chunks").as_uri() + "/")
+            return out.getvalue()
+
     def save_to_file(self, filename: str, is_multi_threaded: bool) -> Path:
         """
         Saves the generated HTML report to a file.
 
         If the trace was multi-threaded, it creates a self-contained directory
         with the HTML report and its CSS/JS assets. Otherwise, it saves a single
-        HTML file and assumes assets are in a relative parent directory.
+        HTML file and assumes assets are in a relative parent directory. Source
+        and executed-line chunks go to `<report stem>_files/` next to the HTML.
 
         Args:
             filename: The base name for the report file (e.g., "report.html").
@@ -443,37 +566,53 @@ onclick="event.stopPropagation(); toggleCommentExpand('{comment_id}', event)">
         Returns:
             The Path object pointing to the final saved HTML file.
         """
-        report_dir: Path = Path(__file__).parent / "logs"
-        report_dir.mkdir(exist_ok=True)
-        html_content: str = self.generate_html()
-
-        final_report_path: Path
-        if is_multi_threaded:
-            timestamp = datetime.datetime.now().strftime("%Y%m%d_%H%M%S")
-            dir_name = f"{Path(filename).stem}_{timestamp}"
-            output_dir = report_dir / dir_name
-            output_dir.mkdir(exist_ok=True)
-            final_report_path = output_dir / "report.html"
-
-            # Copy asset files
-            try:
-                asset_dir: Path = Path(__file__).parent
-                assets: List[str] = ["tracer_styles.css", "tracer_scripts.js"]
-                for asset in assets:
-                    source_asset = asset_dir / asset
-                    if source_asset.exists():
-                        shutil.copy(source_asset, output_dir / asset)
-
-                # Adjust asset paths in HTML to be relative to the new directory
-                html_content = html_content.replace('href="../tracer_styles.css"', 'href="tracer_styles.css"')
-                html_content = html_content.replace('src="../tracer_scripts.js"', 'src="tracer_scripts.js"')
-            except Exception as e:
-                logging.error(f"无法复制资源文件: {e}")
-                print(f"ERROR: 无法复制资源文件: {e}")
-
-        else:
-            final_report_path = report_dir / filename
+        with self._lock:
+            report_dir: Path = _LOG_DIR
+            report_dir.mkdir(exist_ok=True)
+            self._finish()
+
+            final_report_path: Path
+            asset_prefix = "../"
+            if is_multi_threaded:
+                timestamp = datetime.datetime.now().strftime("%Y%m%d_%H%M%S")
+                dir_name = f"{Path(filename).stem}_{timestamp}"
+                output_dir = report_dir / dir_name
+                output_dir.mkdir(exist_ok=True)
+                final_report_path = output_dir / "report.html"
+
+                # Copy asset files
+                try:
+                    asset_dir: Path = Path(__file__).parent
+                    assets: List[str] = ["tracer_styles.css", "tracer_scripts.js"]
+                    for asset in assets:
+                        source_asset = asset_dir / asset
+                        if source_asset.exists():
+                            shutil.copy(source_asset, output_dir / asset)
+
+                    # Adjust asset paths in HTML to be relative to the new directory
+                    asset_prefix = ""
+                except Exception as e:
+                    logging.error(f"无法复制资源文件: {e}")
+                    print(f"ERROR: 无法复制资源文件: {e}")
 
-        final_report_path.write_text(html_content, encoding="utf-8")
-        print(f"正在生成HTML报告 {final_report_path} ...")
-        return final_report_path
+            else:
+                final_report_path = report_dir / filename
+
+            chunk_dir = final_report_path.with_name(f"{final_report_path.stem}_files")
+            shutil.rmtree(chunk_dir, ignore_errors=True)
+            os.replace(self._work_dir / "chunks", chunk_dir)
+            with open(final_report_path, "w", encoding="utf-8") as out:
+                self._write_report(out, chunk_base=f"{chunk_dir.name}/", asset_prefix=asset_prefix)
+            self.close()
+            print(f"正在生成HTML报告 {final_report_path} ...")
+            return final_report_path
+
+    def close(self) -> None:
+        """Removes the working directory of the streamed report."""
+        self._closed = True
+        if self._body is not None:
+            self._body.close()
+            self._body = None
+        if self._work_dir is not None:
+            shutil.rmtree(self._work_dir, ignore_errors=True)
+            self._work_dir = None
@@ -13,6 +13,8 @@ from types import ModuleType
 from typing import Any, Dict, List, Optional
 
 sys.path.insert(0, str(Path(__file__).parent.parent))
+from debugger.output_queue import DEFAULT_CAPACITY, POLICIES
+from debugger.trace_pager import serve_trace
 from debugger.tracer import TraceConfig, color_wrap, start_trace, stop_trace
 
 
@@ -100,6 +102,17 @@ def create_parser() -> ArgumentParser:
         action="store_true",
         help="调试完成后自动打开HTML报告",
     )
+    parser.add_argument(
+        "--serve-report",
+        action="store_true",
+        help="调试完成后启动本地分页查看服务 (按需加载调用树，适合大日志)",
+    )
+    parser.add_argument(
+        "--serve-port",
+        type=int,
+        default=0,
+        help="分页查看服务的端口，默认随机",
+    )
     parser.add_argument(
         "--verbose",
         action="store_true",
@@ -165,6 +178,33 @@ def create_parser() -> ArgumentParser:
         type=Path,
         help="源代码的根目录，用于在报告中显示相对路径",
     )
+    parser.add_argument(
+        "--no-source-cache",
+        action="store_true",
+        help="禁用磁盘上的语句行表/源码缓存 (默认启用，未修改的文件不再重新解析)",
+    )
+    parser.add_argument(
+        "--source-cache-dir",
+        type=Path,
+        help="语句行表/源码缓存目录，默认为 debugger/logs/source_cache",
+    )
+    parser.add_argument(
+        "--compress-log",
+        action="store_true",
+        help="把追踪日志写成分帧压缩、可随机访问的 .log.z 文件 (节省磁盘，分页查看和日志提取照常使用)",
+    )
+    parser.add_argument(
+        "--output-policy",
+        choices=POLICIES,
+        default="block",
+        help="输出队列满时的策略：block 等待输出线程 (默认，不丢日志)，drop_oldest 丢弃最旧的日志，sample 采样保留",
+    )
+    parser.add_argument(
+        "--output-queue-size",
+        type=int,
+        default=DEFAULT_CAPACITY,
+        help=f"输出队列容量 (日志条数，默认 {DEFAULT_CAPACITY})",
+    )
     return parser
 
 
@@ -254,6 +294,13 @@ def parse_cli_args(argv: List[str]) -> Dict[str, Any]:
         "source_base_dir": args.source_base_dir,
         "include_stdlibs": args.include_stdlibs or [],
         "trace_c_calls": args.trace_c_calls,
+        "enable_source_cache": not args.no_source_cache,
+        "source_cache_dir": args.source_cache_dir,
+        "compress_log": args.compress_log,
+        "output_policy": args.output_policy,
+        "output_queue_size": args.output_queue_size,
+        "serve_report": args.serve_report,
+        "serve_port": args.serve_port,
     }
 
 
@@ -363,6 +410,11 @@ def debug_main(argv: Optional[List[str]] = None) -> int:
             source_base_dir=args["source_base_dir"],
             include_stdlibs=args["include_stdlibs"],
             trace_c_calls=args["trace_c_calls"],
+            enable_source_cache=args["enable_source_cache"],
+            source_cache_dir=args["source_cache_dir"],
+            compress_log=args["compress_log"],
+            output_policy=args["output_policy"],
+            output_queue_size=args["output_queue_size"],
         )
 
         log_dir = Path(__file__).parent / "logs"
@@ -380,7 +432,7 @@ def debug_main(argv: Optional[List[str]] = None) -> int:
         print(color_wrap("  ✓ 彩色终端输出 (日志文件无颜色)", "return"))
         print(color_wrap("  ✓ 多线程跟踪支持", "return"))
         print(color_wrap(f"\n📂 调试日志路径: {log_dir / 'debug.log'}", "line"))
-        print(color_wrap(f"📂 报告文件路径: {report_path.parent / Path(report_path.stem + '.log')}\n", "line"))
+        print(color_wrap(f"📂 报告文件路径: {report_path.parent / config.log_name}\n", "line"))
 
         original_argv = sys.argv.copy()
         exit_code = 0
@@ -406,6 +458,8 @@ def debug_main(argv: Optional[List[str]] = None) -> int:
                 print_debug_summary(report_path)
                 if args["open_report"] and not config.disable_html:
                     open_trace_report(report_path)
+            if args["serve_report"] and tracer:
+                serve_trace(log_dir / config.log_name, args["serve_port"], open_browser=True)
 
         return exit_code
     except (ValueError, FileNotFoundError) as e:
@@ -339,7 +339,7 @@ const TraceViewer = {
     
     // Initialize "Focus Subtree" functionality
     initFocusSubtree() {
-        this.elements.content.addEventListener('click', e => {
+        this.elements.content.addEventListener('click', async e => {
             if (!e.target.classList.contains('focus-subtree-btn')) {
                 return;
             }
@@ -382,6 +382,7 @@ const TraceViewer = {
             // 2. Filter required data (executedLines, sourceFiles, commentsData)
             const requiredFiles = new Set();
             const requiredExecutedLines = {};
+            const requiredFrames = [];
 
             const viewSourceButtons = subtreeContainer.querySelectorAll('.view-source-btn');
             viewSourceButtons.forEach(btn => {
@@ -390,16 +391,20 @@ const TraceViewer = {
                 const match = onclickAttr.match(/showSource\('(.+?)',\s*(\d+),\s*(\d+)\)/);
                 if (match) {
                     let filename = match[1].replace(/\\\\/g, '\\'); // Un-escape backslashes for JS
-                    const frameId = match[3];
+                    requiredFrames.push([filename, match[3]]);
+                }
+            });
 
-                    requiredFiles.add(filename);
+            // 子树用到的源码和执行行分块先加载进来，再内联到新窗口中
+            await Promise.all(requiredFrames.map(([filename, frameId]) => TraceChunks.ensure(filename, frameId)));
+            requiredFrames.forEach(([filename, frameId]) => {
+                requiredFiles.add(filename);
 
-                    if (window.executedLines[filename] && window.executedLines[filename][frameId]) {
-                        if (!requiredExecutedLines[filename]) {
-                            requiredExecutedLines[filename] = {};
-                        }
-                        requiredExecutedLines[filename][frameId] = window.executedLines[filename][frameId];
+                if (window.executedLines[filename] && window.executedLines[filename][frameId]) {
+                    if (!requiredExecutedLines[filename]) {
+                        requiredExecutedLines[filename] = {};
                     }
+                    requiredExecutedLines[filename][frameId] = window.executedLines[filename][frameId];
                 }
             });
 
@@ -440,6 +445,8 @@ const TraceViewer = {
                 /window\.commentsData = .*?;/,
                 `window.commentsData = ${JSON.stringify(filteredCommentsData)};`
             );
+            newHtml = newHtml.replace(/window\.traceChunkBase = .*?;/, 'window.traceChunkBase = null;');
+            newHtml = newHtml.replace(/window\.traceSourceChunks = .*?;/, 'window.traceSourceChunks = {};');
 
             // Update title
             const callText = foldable.textContent.trim().replace(/\s+/g, ' ').substring(0, 50);
@@ -812,6 +819,89 @@ const TraceViewer = {
     }
 };
 
+// 按需加载报告的分块数据：source_<n>.js 是一个源文件，lines_<n>.js 是一段帧 ID 的执行行。
+// 解码 lines_<n>.js 中的执行行：base64 的 LEB128 序列，第一个数是起始行，
+// 之后交替是连续执行的行数和跳过的行数，与 line_bitmap.py 的 encode_runs 一致
+function decodeLineRuns(encoded) {
+    const bytes = atob(encoded);
+    const lines = [];
+    let line = 0;
+    let index = -1;
+    let value = 0;
+    let shift = 0;
+    for (let i = 0; i < bytes.length; i++) {
+        const byte = bytes.charCodeAt(i);
+        value += (byte & 0x7f) * 2 ** shift;
+        shift += 7;
+        if (byte & 0x80) {
+            continue;
+        }
+        if (index < 0) {
+            line = value;
+        } else {
+            if (index % 2 === 0) {
+                for (let j = 0; j < value; j++) {
+                    lines.push(line + j);
+                }
+            }
+            line += value;
+        }
+        index++;
+        value = 0;
+        shift = 0;
+    }
+    return lines;
+}
+
+// file:// 下不能 fetch，所以用 <script> 标签加载，分块脚本再回调 TraceChunks.source/lines。
+const TraceChunks = {
+    loaded: {},
+
+    load(name) {
+        if (!window.traceChunkBase) {
+            return Promise.resolve();
+        }
+        if (!this.loaded[name]) {
+            this.loaded[name] = new Promise(resolve => {
+                const script = document.createElement('script');
+                script.src = window.traceChunkBase + name;
+                script.onload = () => resolve();
+                script.onerror = () => resolve(); // 缺失的分块按"无数据"处理
+                document.head.appendChild(script);
+            });
+        }
+        return this.loaded[name];
+    },
+
+    // 确保某个帧的源码和执行行已加载
+    ensure(filename, frameId) {
+        const pending = [];
+        const sourceChunk = (window.traceSourceChunks || {})[filename];
+        if (sourceChunk !== undefined) {
+            pending.push(this.load(`source_${sourceChunk}.js`));
+        }
+        const frameChunk = Math.floor(Number(frameId) / (window.traceLineChunkFrames || 1024));
+        if (!Number.isNaN(frameChunk)) {
+            pending.push(this.load(`lines_${frameChunk}.js`));
+        }
+        return Promise.all(pending);
+    },
+
+    source(filename, content) {
+        window.sourceFiles[filename] = content;
+    },
+
+    // 同一帧（如生成器）可能分多次写出，行号合并
+    lines(files) {
+        Object.entries(files).forEach(([filename, frames]) => {
+            const target = window.executedLines[filename] || (window.executedLines[filename] = {});
+            Object.entries(frames).forEach(([frameId, encoded]) => {
+                target[frameId] = (target[frameId] || []).concat(decodeLineRuns(encoded));
+            });
+        });
+    }
+};
+
 // Initialize the application
 document.addEventListener('DOMContentLoaded', () => {
     TraceViewer.init();
@@ -819,7 +909,9 @@ document.addEventListener('DOMContentLoaded', () => {
 
 // Make source viewer methods available globally to be used by inline event handlers
 function showSource(filename, lineNumber, frameId) {
-    TraceViewer.sourceViewer.showSource(filename, lineNumber, frameId);
+    TraceChunks.ensure(filename, frameId).then(() => {
+        TraceViewer.sourceViewer.showSource(filename, lineNumber, frameId);
+    });
 }
 
 function getFrameLines(filename, frameId) {
@@ -11,6 +11,9 @@ import tornado.web
 import tornado.websocket
 from tornado.options import define
 
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+from debugger.trace_pager import TracePager, handle_api  # noqa: E402
+
 define("port", default=5555, help="run on the given port", type=int)
 
 # Configure logging
@@ -205,6 +208,46 @@ class FileAutocompleteHandler(tornado.web.RequestHandler):
             self.write({"error": str(e)})
 
 
+class TraceViewerHandler(tornado.web.RequestHandler):
+    async def get(self):
+        self.render("trace_viewer.html")
+
+
+class TracePageHandler(tornado.web.RequestHandler):
+    """分页读取追踪日志，只允许访问 debugger/logs 下的日志"""
+
+    log_dir = os.path.realpath(os.path.join(os.path.dirname(os.path.dirname(__file__)), "logs"))
+    pagers = {}
+    pagers_lock = threading.Lock()
+
+    def _get_pager(self, log_file):
+        log_file = os.path.realpath(os.path.join(self.log_dir, log_file))
+        if os.path.dirname(log_file) != self.log_dir or not os.path.isfile(log_file):
+            raise tornado.web.HTTPError(404, "日志不存在")
+        # 按文件的 mtime 和大小判断是否变化；.log.z 的文件大小与 index.log_size（解压后大小）不可比
+        st = os.stat(log_file)
+        stamp = (st.st_mtime_ns, st.st_size)
+        with self.pagers_lock:
+            cached = self.pagers.get(log_file)
+            if cached is not None and cached[0] != stamp:
+                cached[1].close()
+                cached = None
+            if cached is None:
+                cached = self.pagers[log_file] = (stamp, TracePager(log_file))
+            return cached[1]
+
+    async def get(self, action):
+        pager = self._get_pager(self.get_argument("log"))
+        params = {key: self.get_argument(key) for key in self.request.arguments}
+        try:
+            self.write(handle_api(pager, action, params))
+        except KeyError as e:
+            raise tornado.web.HTTPError(404) from e
+        except ValueError as e:
+            self.set_status(400)
+            self.write({"status": "error", "message": str(e)})
+
+
 class DebuggerWebUI(Pdb):
     def __init__(self, port=5555, start_loop=True):
         super().__init__()
@@ -232,6 +275,8 @@ class DebuggerWebUI(Pdb):
                 (r"/breakpoints/(\d+)", BreakpointHandler),
                 (r"/variables", VariableHandler),
                 (r"/autocomplete/file", FileAutocompleteHandler),
+                (r"/trace/", TraceViewerHandler),
+                (r"/trace/api/(page|search|summary)", TracePageHandler),
                 (r"/static/(.*)", tornado.web.StaticFileHandler, {"path": static_path}),
             ],
             template_path=template_path,
@@ -0,0 +1,192 @@
+// TraceViewer (paged) - 按页加载调用树：先显示顶层，展开帧时再向服务端请求该帧的子树页面。
+// 服务端接口见 debugger/trace_pager.py 的 handle_api：api/page、api/search、api/summary。
+const PagedTraceViewer = {
+    pageSize: 200,
+    logParam: new URLSearchParams(window.location.search).get('log'),
+    search: { query: '', next: 0 },
+
+    async api(action, params) {
+        const url = new URL(`api/${action}`, window.location.href);
+        Object.entries(params || {}).forEach(([key, value]) => {
+            if (value !== null && value !== undefined) {
+                url.searchParams.set(key, value);
+            }
+        });
+        if (this.logParam) {
+            url.searchParams.set('log', this.logParam);
+        }
+        const response = await fetch(url);
+        if (!response.ok) {
+            throw new Error(`${action}: HTTP ${response.status}`);
+        }
+        return response.json();
+    },
+
+    async init() {
+        this.content = document.getElementById('content');
+        this.searchInput = document.getElementById('search');
+        this.searchStatus = document.getElementById('searchStatus');
+        document.getElementById('reloadBtn').addEventListener('click', () => this.showTopLevel());
+        this.searchInput.addEventListener('keydown', e => {
+            if (e.key === 'Enter') {
+                this.findNext(this.searchInput.value);
+            }
+        });
+
+        const summary = await this.api('summary');
+        document.getElementById('summary').textContent =
+            `${summary.log} · ${(summary.size / 1048576).toFixed(1)} MB · ${summary.frames} frames`;
+        await this.showTopLevel();
+    },
+
+    async showTopLevel() {
+        this.content.innerHTML = '';
+        await this.loadPage(this.content, -1, null);
+    },
+
+    lineClass(text) {
+        const stripped = text.trimStart();
+        if (stripped.startsWith('⚠')) return 'error';
+        if (stripped.startsWith('↳')) return 'var';
+        return '';
+    },
+
+    renderLine(item) {
+        const div = document.createElement('div');
+        div.className = `item line ${this.lineClass(item.text)}`;
+        div.textContent = item.text.trimStart();
+        div.dataset.offset = item.offset;
+        return div;
+    },
+
+    renderFrame(item) {
+        const frame = document.createElement('div');
+        frame.className = `frame ${item.status}`;
+        frame.dataset.node = item.id;
+        frame.dataset.offset = item.offset;
+
+        const call = document.createElement('div');
+        call.className = 'item call';
+        call.textContent = item.call.trimStart();
+        const meta = document.createElement('span');
+        meta.className = 'meta';
+        meta.textContent = item.descendants ? `${item.children} calls / ${item.descendants} frames` : '';
+        call.appendChild(meta);
+        call.addEventListener('click', () => this.toggle(frame));
+        frame.appendChild(call);
+
+        const children = document.createElement('div');
+        children.className = 'children';
+        children.style.display = 'none';
+        frame.appendChild(children);
+
+        if (item.close) {
+            const close = document.createElement('div');
+            close.className = 'item close';
+            close.textContent = item.close.trimStart();
+            frame.appendChild(close);
+        }
+        return frame;
+    },
+
+    // 加载节点的一页，cursor 为 null 时从头开始；不是从头开始的页前面放一个"加载前面内容"的入口
+    async loadPage(container, node, cursor) {
+        const page = await this.api('page', { node, cursor, limit: this.pageSize });
+        if (!page.at_start) {
+            const earlier = document.createElement('div');
+            earlier.className = 'more';
+            earlier.textContent = '⋯ 显示前面的内容';
+            earlier.addEventListener('click', async () => {
+                container.innerHTML = '';
+                await this.loadPage(container, node, null);
+            });
+            container.appendChild(earlier);
+        }
+        this.appendItems(container, node, page);
+        return page;
+    },
+
+    appendItems(container, node, page) {
+        const fragment = document.createDocumentFragment();
+        page.items.forEach(item => {
+            fragment.appendChild(item.type === 'frame' ? this.renderFrame(item) : this.renderLine(item));
+        });
+        if (page.next !== null) {
+            const more = document.createElement('div');
+            more.className = 'more';
+            more.textContent = '⋯ 加载更多';
+            more.addEventListener('click', async () => {
+                more.remove();
+                const next = await this.api('page', { node, cursor: page.next, limit: this.pageSize });
+                this.appendItems(container, node, next);
+            });
+            fragment.appendChild(more);
+        }
+        container.appendChild(fragment);
+    },
+
+    async expand(frame, cursor) {
+        const children = frame.querySelector(':scope > .children');
+        if (!frame.dataset.loaded || cursor !== undefined) {
+            children.innerHTML = '';
+            await this.loadPage(children, Number(frame.dataset.node), cursor === undefined ? null : cursor);
+            frame.dataset.loaded = '1';
+        }
+        children.style.display = '';
+        frame.classList.add('expanded');
+        return children;
+    },
+
+    async toggle(frame) {
+        if (frame.classList.contains('expanded')) {
+            frame.classList.remove('expanded');
+            frame.querySelector(':scope > .children').style.display = 'none';
+        } else {
+            await this.expand(frame);
+        }
+    },
+
+    // 服务端返回从顶层到目标节点的路径，每一层都从包含匹配的位置开始加载
+    async findNext(query) {
+        if (query !== this.search.query) {
+            this.search = { query, next: 0 };
+        }
+        if (!query) return;
+        this.searchStatus.textContent = '搜索中…';
+        const { result } = await this.api('search', { q: query, from: this.search.next });
+        if (!result) {
+            this.searchStatus.textContent = this.search.next ? '没有更多匹配，再按回车从头搜索' : '没有匹配';
+            this.search.next = 0;
+            return;
+        }
+        this.search.next = result.next;
+
+        this.content.innerHTML = '';
+        let container = this.content;
+        for (const [i, level] of result.levels.entries()) {
+            if (level.node < 0) {
+                await this.loadPage(container, -1, level.cursor);
+            } else {
+                const frame = container.querySelector(`:scope > .frame[data-node="${level.node}"]`);
+                if (!frame) break;
+                container = await this.expand(frame, level.cursor);
+            }
+            if (i + 1 < result.levels.length) {
+                continue;
+            }
+            const target = container.querySelector(`:scope > [data-offset="${level.cursor}"]`);
+            if (target) {
+                const row = target.classList.contains('frame') ? target.firstElementChild : target;
+                row.classList.add('match');
+                row.scrollIntoView({ block: 'center' });
+            }
+        }
+        this.searchStatus.textContent = `匹配位于字节 ${result.position}`;
+    }
+};
+
+document.addEventListener('DOMContentLoaded', () => {
+    PagedTraceViewer.init().catch(e => {
+        document.getElementById('content').textContent = `加载失败: ${e.message}`;
+    });
+});
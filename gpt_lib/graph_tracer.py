@@ -1,13 +1,14 @@
-import json
-from collections import defaultdict
 from enum import Enum
 from pathlib import Path
-from typing import Any, Dict, List, Literal, Optional, Set, Tuple, TypedDict
+from typing import List, Optional, Set, Tuple, TypedDict
+
+from debugger.call_graph import CallGraph, load_call_graph
 
 try:
     import networkx as nx
-except ImportError as exc:
-    raise ImportError("networkx is required. Please install it with `pip install networkx`.") from exc
+except ImportError:
+    # 只有 export_trace_graph 需要 networkx
+    nx = None
 
 
 class TraceTypes(str, Enum):
@@ -27,15 +28,6 @@ class IndexEntry(TypedDict):
     func: str
 
 
-class FrameInfo(TypedDict):
-    filename: str
-    lineno: int
-    func: str
-    start_pos: int
-    end_pos: Optional[int]
-    status: Optional[Literal["return", "exception", "partial"]]
-
-
 class ReferenceInfo(TypedDict):
     filename: str
     lineno: int
@@ -53,17 +45,13 @@ TRACE_LOG_NAME = "trace.log"
 ROOT_FRAME_ID = 0
 
 
-class _CallStackState:
-    """封装调用栈状态和缓存，用于图构建过程"""
-
-    def __init__(self):
-        self.stack: List[int] = []
-        self.frame_data_cache: Dict[int, IndexEntry] = {}
-        self.partial_frames: Set[int] = set()
-        self.all_frame_ids: Set[int] = set()
-
-
 class GraphTraceLogExtractor:
+    """
+    按帧查询追踪日志的调用树。调用树由 debugger.call_graph 从索引文件构建
+    （有 tracer_core 时在原生代码中完成），每次调用一个节点，兄弟和后代都是连续区间；
+    对外接口仍以帧 ID 标识调用。
+    """
+
     def __init__(self, log_file: str = None):
         self.log_file: Path = Path(log_file or TRACE_LOG_NAME)
         self.index_file: Path = self.log_file.with_suffix(self.log_file.suffix + ".index")
@@ -73,241 +61,76 @@ class GraphTraceLogExtractor:
         if not self.index_file.exists():
             raise FileNotFoundError(f"Index file not found: {self.index_file}")
 
-        self._graph: Optional[nx.DiGraph] = None
-        self._frames: Dict[int, FrameInfo] = {}
-        self._file_line_to_frames: Dict[Tuple[str, int], List[int]] = defaultdict(list)
-
-    def _parse_index_line(self, line: str) -> Optional[IndexEntry]:
-        try:
-            entry = json.loads(line.strip())
-            return entry if isinstance(entry, dict) and "type" in entry else None
-        except json.JSONDecodeError:
-            return None
-
-    def _load_index_entries(self) -> List[IndexEntry]:
-        """加载并排序索引条目"""
-        entries = []
-        with open(self.index_file, "r", encoding="utf-8") as f:
-            for line in f:
-                if not line.startswith("#"):
-                    if entry := self._parse_index_line(line):
-                        entries.append(entry)
-        return sorted(entries, key=lambda e: e["position"])
-
-    def _add_frame_node(self, entry: IndexEntry, parent_id: int):
-        """添加新的帧节点到图中"""
-        frame_id = entry["frame_id"]
-        self._graph.add_node(
-            frame_id,
-            filename=entry["filename"],
-            lineno=entry["lineno"],
-            func=entry.get("func", "N/A"),
-            start_pos=entry["position"],
-            end_pos=None,
-            status=None,
-        )
-        self._graph.add_edge(parent_id, frame_id)
-        self._file_line_to_frames[(entry["filename"], entry["lineno"])].append(frame_id)
-
-    def _process_call_event(self, entry: IndexEntry, state: _CallStackState):
-        """处理调用事件"""
-        parent_id = state.stack[-1] if state.stack else ROOT_FRAME_ID
-        self._add_frame_node(entry, parent_id)
-        state.frame_data_cache[entry["frame_id"]] = entry
-        state.all_frame_ids.add(entry["frame_id"])
-        state.stack.append(entry["frame_id"])
-
-    def _process_return_event(self, entry: IndexEntry, state: _CallStackState):
-        """处理返回/异常事件"""
-        frame_id = entry["frame_id"]
-        if frame_id in state.frame_data_cache:
-            start_entry = state.frame_data_cache[frame_id]
-            self._update_frame_info(frame_id, start_entry, entry["position"], entry["type"])
-
-        # 弹出栈直到找到匹配的帧
-        if frame_id in state.stack:
-            while state.stack:
-                popped_id = state.stack.pop()
-                if popped_id == frame_id:
-                    break
-                state.partial_frames.add(popped_id)
-
-    def _update_frame_info(self, frame_id: int, start_entry: IndexEntry, end_pos: int, status: str):
-        """更新帧的结束位置和状态"""
-        frame_info = {
-            "filename": start_entry["filename"],
-            "lineno": start_entry["lineno"],
-            "func": start_entry.get("func", "N/A"),
-            "start_pos": start_entry["position"],
-            "end_pos": end_pos,
-            "status": status,
-        }
-        self._frames[frame_id] = frame_info
-
-        if frame_id in self._graph:
-            self._graph.nodes[frame_id]["end_pos"] = end_pos
-            self._graph.nodes[frame_id]["status"] = status
-
-    def _mark_partial_frames(self, state: _CallStackState):
-        """标记未关闭的帧为部分帧"""
-        for frame_id in state.partial_frames:
-            if frame_id in state.frame_data_cache:
-                start_entry = state.frame_data_cache[frame_id]
-                self._update_frame_info(frame_id, start_entry, None, TraceTypes.PARTIAL.value)
-
-    def _detect_cycles(self):
-        """检测图中的环并记录到日志文件"""
-        try:
-            visited = set()
-            rec_stack = set()
-            parent_map = {}
-
-            def dfs(node, parent=None):
-                visited.add(node)
-                rec_stack.add(node)
-                parent_map[node] = parent
-
-                for neighbor in self._graph.successors(node):
-                    if neighbor not in visited:
-                        if dfs(neighbor, node):
-                            return True
-                    elif neighbor in rec_stack:
-                        self._log_cycle(neighbor, node, parent_map)
-                        return True
-
-                rec_stack.remove(node)
-                return False
-
-            for node in list(self._graph.nodes):
-                if node != ROOT_FRAME_ID and node not in visited:
-                    if dfs(node):
-                        break
-        except Exception as e:
-            print(f"WARNING: Error during cycle detection: {str(e)}")
-
-    def _log_cycle(self, cycle_start: int, current: int, parent_map: Dict[int, int]):
+        self._graph: Optional[CallGraph] = None
+
+    def _log_cycle(self, cycle_path: List[int]):
         """记录环的详细信息到日志文件"""
-        cycle_path = []
-        temp = current
-
-        while temp != cycle_start and temp is not None:
-            cycle_path.append(temp)
-            temp = parent_map.get(temp)
-
-        if temp is not None:
-            cycle_path.append(cycle_start)
-            cycle_path.reverse()
-
-            cycle_info = []
-            for i, frame_id in enumerate(cycle_path):
-                node_data = self._graph.nodes[frame_id]
-                cycle_info.append(
-                    f"Cycle Node {i + 1}: frame_id={frame_id}\n"
-                    f"  Function: {node_data.get('func', 'N/A')}\n"
-                    f"  Location: {node_data.get('filename', 'N/A')}:{node_data.get('lineno', 'N/A')}\n"
-                    f"  Log Position: {node_data.get('start_pos', 'N/A')}"
-                )
-
-            error_report = (
-                "ERROR: Cycle detected in call graph!\n"
-                f"Log File: {self.log_file}\n"
-                f"Index File: {self.index_file}\n"
-                "Cycle Path:\n" + "\n".join(cycle_info) + "\n\n"
-                "This cycle suggests incorrect logging behavior."
+        cycle_info = []
+        for i, frame_id in enumerate(cycle_path):
+            node = self._graph.calls_of(frame_id)[0]
+            cycle_info.append(
+                f"Cycle Node {i + 1}: frame_id={frame_id}\n"
+                f"  Function: {self._graph.func_of(node)}\n"
+                f"  Location: {self._graph.filename_of(node)}:{self._graph.lineno[node]}\n"
+                f"  Log Position: {self._graph.start[node]}"
             )
 
-            cycle_log_file = self.log_file.with_suffix(".cycle.log")
-            with open(cycle_log_file, "w", encoding="utf-8") as f:
-                f.write(error_report)
+        error_report = (
+            "ERROR: Cycle detected in call graph!\n"
+            f"Log File: {self.log_file}\n"
+            f"Index File: {self.index_file}\n"
+            "Cycle Path:\n" + "\n".join(cycle_info) + "\n\n"
+            "This cycle suggests incorrect logging behavior."
+        )
+
+        cycle_log_file = self.log_file.with_suffix(".cycle.log")
+        with open(cycle_log_file, "w", encoding="utf-8") as f:
+            f.write(error_report)
 
-            print(f"WARNING: Cycle detected! Details written to {cycle_log_file}")
+        print(f"WARNING: Cycle detected! Details written to {cycle_log_file}")
 
     def _build_graph(self):
         if self._graph is not None:
             return
 
-        self._graph = nx.DiGraph()
-        self._frames.clear()
-        self._file_line_to_frames.clear()
-
-        # 添加虚拟根节点
-        self._graph.add_node(
-            ROOT_FRAME_ID, filename="<root>", lineno=0, func="<root>", start_pos=0, end_pos=0, status=None
-        )
-
-        index_entries = self._load_index_entries()
-        state = _CallStackState()
-
-        for entry in index_entries:
-            frame_id = entry["frame_id"]
-            type_tag = entry["type"]
-
-            if type_tag == TraceTypes.CALL:
-                self._process_call_event(entry, state)
-            elif type_tag in (TraceTypes.RETURN, TraceTypes.EXCEPTION):
-                self._process_return_event(entry, state)
+        self._graph = load_call_graph(self.index_file)
+        # 调用树本身无环；帧 ID 之间成环说明日志记录有误
+        if self._graph.cycle:
+            self._log_cycle(self._graph.cycle)
 
-        # 标记部分帧并检测环
-        state.partial_frames.update(set(state.stack))
-        self._mark_partial_frames(state)
-        self._detect_cycles()
-
-    def _create_reference_event(self, node_id: int, event_type: str) -> ReferenceInfo:
-        node_data = self._graph.nodes[node_id]
+    def _create_reference_event(self, node: int, event_type: Optional[str]) -> ReferenceInfo:
         return {
-            "filename": node_data["filename"],
-            "lineno": node_data["lineno"],
-            "func": node_data.get("func", "N/A"),
+            "filename": self._graph.filename_of(node),
+            "lineno": self._graph.lineno[node],
+            "func": self._graph.func_of(node),
             "type": event_type,
         }
 
-    def _get_descendant_events(self, frame_id: int) -> List[ReferenceInfo]:
+    def _get_descendant_events(self, node: int) -> List[ReferenceInfo]:
+        """按先序遍历子树，调用事件在前，子调用都结束后是结束事件"""
+        graph = self._graph
         events = []
-        stack: List[Tuple[int, int, Tuple[int, ...]]] = [(frame_id, 0, (frame_id,))]
-        visited: Set[int] = set()
-
-        while stack:
-            node_id, state, path = stack.pop()
-
-            if state == 0:  # 处理调用事件
-                events.append(self._create_reference_event(node_id, TraceTypes.CALL.value))
-                stack.append((node_id, 1, path))  # 标记为待处理结束事件
-
-                # 按时间顺序处理子节点
-                children = sorted(
-                    self._graph.successors(node_id),
-                    key=lambda cid: self._graph.nodes[cid].get("start_pos", 0),
-                    reverse=True,
-                )
-
-                for child_id in children:
-                    if child_id not in path:  # 避免环
-                        stack.append((child_id, 0, path + (child_id,)))
-            else:  # state == 1, 处理结束事件
-                status = self._graph.nodes[node_id].get("status", TraceTypes.PARTIAL.value)
-                events.append(self._create_reference_event(node_id, status))
-                visited.add(node_id)
-
+        open_nodes: List[int] = []
+        for current in range(node, graph.subtree_end[node]):
+            while open_nodes and graph.subtree_end[open_nodes[-1]] <= current:
+                closed = open_nodes.pop()
+                events.append(self._create_reference_event(closed, graph.status_of(closed)))
+            events.append(self._create_reference_event(current, TraceTypes.CALL.value))
+            open_nodes.append(current)
+        while open_nodes:
+            closed = open_nodes.pop()
+            events.append(self._create_reference_event(closed, graph.status_of(closed)))
         return events
 
-    def _get_relevant_frames(self, frame_id: int, next_siblings: Optional[int]) -> List[int]:
-        """获取目标帧及其兄弟帧"""
-        relevant_frames = [frame_id]
+    def _get_relevant_frames(self, nodes: List[int], next_siblings: Optional[int]) -> List[int]:
+        """获取目标调用及最后一次调用之后的兄弟调用"""
+        relevant_frames = list(nodes)
 
         if next_siblings and next_siblings > 0:
-            predecessors = list(self._graph.predecessors(frame_id))
-            if predecessors and predecessors[0] != ROOT_FRAME_ID:
-                parent_id = predecessors[0]
-                target_start_pos = self._graph.nodes[frame_id]["start_pos"]
-
-                siblings = [
-                    sid
-                    for sid in self._graph.successors(parent_id)
-                    if sid != frame_id and self._graph.nodes[sid]["start_pos"] > target_start_pos
-                ]
-
-                sorted_siblings = sorted(siblings, key=lambda s: self._graph.nodes[s]["start_pos"])
-                relevant_frames.extend(sorted_siblings[:next_siblings])
+            parent = self._graph.parent_of(nodes[-1])
+            if parent is not None and parent != CallGraph.ROOT:
+                siblings, index = self._graph.siblings_of(nodes[-1])
+                relevant_frames.extend(siblings[index + 1 : index + 1 + next_siblings])
 
         return relevant_frames
 
@@ -320,73 +143,56 @@ class GraphTraceLogExtractor:
             f.seek(start_pos)
             return f.read(end_pos - start_pos if end_pos else None)
 
+    def _get_frames_content(self, nodes: List[int]) -> str:
+        """从第一个调用开始，到最晚结束的调用为止的日志"""
+        start_pos = self._graph.start[nodes[0]]
+        valid_end_positions = [end for end in map(self._graph.end_of, nodes) if end is not None]
+        end_pos = max(valid_end_positions) if valid_end_positions else None
+        return self._get_log_content(start_pos, end_pos)
+
     def _lookup_by_frame_id(
         self, frame_id: int, next_siblings: Optional[int] = None
     ) -> Tuple[List[str], List[List[ReferenceInfo]]]:
-        if frame_id not in self._graph or frame_id == ROOT_FRAME_ID:
+        # 生成器每次恢复都是同一帧 ID 的一次调用，全部作为目标
+        targets = list(self._graph.calls_of(frame_id))
+        if not targets or frame_id == ROOT_FRAME_ID:
             return [], []
 
-        relevant_frames = self._get_relevant_frames(frame_id, next_siblings)
-        sorted_frames = sorted(relevant_frames, key=lambda fid: self._graph.nodes[fid]["start_pos"])
-
-        # 计算日志范围
-        start_pos = self._graph.nodes[sorted_frames[0]]["start_pos"]
-        valid_end_positions = [
-            self._graph.nodes[fid].get("end_pos")
-            for fid in sorted_frames
-            if self._graph.nodes[fid].get("end_pos") is not None
-        ]
-        end_pos = max(valid_end_positions) if valid_end_positions else None
-
-        log_content = self._get_log_content(start_pos, end_pos)
-        references = self._build_reference_chain(sorted_frames, frame_id)
+        sorted_frames = sorted(self._get_relevant_frames(targets, next_siblings))
+        log_content = self._get_frames_content(sorted_frames)
+        references = self._build_reference_chain(sorted_frames, set(targets))
 
         return [log_content], [references]
 
-    def _build_reference_chain(self, frame_ids: List[int], target_frame_id: int) -> List[ReferenceInfo]:
-        """为帧列表构建引用链"""
+    def _build_reference_chain(self, nodes: List[int], targets: Set[int]) -> List[ReferenceInfo]:
+        """为调用列表构建引用链"""
         references = []
 
-        for fid in frame_ids:
-            if fid == target_frame_id:
-                references.extend(self._get_descendant_events(fid))
+        for node in nodes:
+            if node in targets:
+                references.extend(self._get_descendant_events(node))
             else:
-                references.append(self._create_reference_event(fid, TraceTypes.CALL.value))
-                if status := self._graph.nodes[fid].get("status"):
-                    references.append(self._create_reference_event(fid, status))
+                references.append(self._create_reference_event(node, TraceTypes.CALL.value))
+                if status := self._graph.status_of(node):
+                    references.append(self._create_reference_event(node, status))
 
         return references
 
-    def _get_sibling_frames(self, frame_id: int, sibling_config: SiblingConfig) -> List[int]:
-        """根据配置获取兄弟帧"""
-        relevant_frames = [frame_id]
-        predecessors = list(self._graph.predecessors(frame_id))
-
-        if not predecessors:
+    def _get_sibling_frames(self, node: int, sibling_config: SiblingConfig) -> List[int]:
+        """根据配置获取兄弟调用"""
+        relevant_frames = [node]
+        if self._graph.parent_of(node) is None:
             return relevant_frames
 
-        parent_id = predecessors[0]
-        target_data = self._graph.nodes[frame_id]
-        target_start_pos = target_data["start_pos"]
-
-        all_siblings = [
-            sid
-            for sid in self._graph.successors(parent_id)
-            if sid != frame_id and self._graph.nodes[sid].get("func") in sibling_config["functions"]
-        ]
-
-        # 获取之前的兄弟帧
-        before_siblings = sorted(
-            [s for s in all_siblings if self._graph.nodes[s]["start_pos"] < target_start_pos],
-            key=lambda s: self._graph.nodes[s]["start_pos"],
-            reverse=True,
-        )
+        siblings, index = self._graph.siblings_of(node)
+        functions = set(sibling_config["functions"])
 
-        # 获取之后的兄弟帧
-        after_siblings = sorted(
-            [s for s in all_siblings if self._graph.nodes[s]["start_pos"] > target_start_pos],
-            key=lambda s: self._graph.nodes[s]["start_pos"],
-        )
+        def matches(sibling: int) -> bool:
+            return self._graph.func_of(sibling) in functions
+
+        # 之前的兄弟调用由近及远，之后的按调用顺序
+        before_siblings = [s for s in reversed(siblings[:index]) if matches(s)]
+        after_siblings = [s for s in siblings[index + 1 :] if matches(s)]
 
         # 应用数量限制
         num_before = sibling_config.get("before")
@@ -405,34 +211,20 @@ class GraphTraceLogExtractor:
         lineno: int,
         sibling_config: Optional[SiblingConfig] = None,
     ) -> Tuple[List[str], List[List[ReferenceInfo]]]:
-        matching_frame_ids = self._file_line_to_frames.get((filename, lineno), [])
-        if not matching_frame_ids:
-            return [], []
-
         logs = []
         references_group = []
 
-        for frame_id in matching_frame_ids:
-            if frame_id not in self._frames:
+        for node in self._graph.nodes_at(filename, lineno):
+            if self._graph.status_of(node) is None:
                 continue
 
-            relevant_frames = [frame_id]
+            relevant_frames = [node]
             if sibling_config and sibling_config.get("functions"):
-                relevant_frames = self._get_sibling_frames(frame_id, sibling_config)
-
-            sorted_frames = sorted(relevant_frames, key=lambda fid: self._graph.nodes[fid]["start_pos"])
+                relevant_frames = self._get_sibling_frames(node, sibling_config)
 
-            # 计算日志范围
-            start_pos = self._graph.nodes[sorted_frames[0]]["start_pos"]
-            valid_end_positions = [
-                self._graph.nodes[fid].get("end_pos")
-                for fid in sorted_frames
-                if self._graph.nodes[fid].get("end_pos") is not None
-            ]
-            end_pos = max(valid_end_positions) if valid_end_positions else None
-
-            logs.append(self._get_log_content(start_pos, end_pos))
-            references_group.append(self._build_reference_chain(sorted_frames, frame_id))
+            sorted_frames = sorted(relevant_frames)
+            logs.append(self._get_frames_content(sorted_frames))
+            references_group.append(self._build_reference_chain(sorted_frames, {node}))
 
         return logs, references_group
 
@@ -462,76 +254,78 @@ class GraphTraceLogExtractor:
 
         raise ValueError("Must provide either `frame_id` or both `filename` and `lineno` for lookup.")
 
+    def _trace_roots(self, frame_id: int, show_full_trace: bool) -> List[int]:
+        """帧 ID 各次调用所在的追踪起点，去重并保持调用顺序"""
+        nodes = self._graph.calls_of(frame_id)
+        if not nodes:
+            raise ValueError(f"Frame ID {frame_id} not found in trace graph.")
+        roots = [self._find_trace_root(node) if show_full_trace else node for node in nodes]
+        return list(dict.fromkeys(roots))
+
     def export_trace_graph(self, frame_id: int, output_path: str, show_full_trace: bool = True):
+        if nx is None:
+            raise ImportError("networkx is required. Please install it with `pip install networkx`.")
         self._build_graph()
         assert self._graph is not None
 
-        if frame_id not in self._graph:
-            raise ValueError(f"Frame ID {frame_id} not found in trace graph.")
-
-        root = self._find_trace_root(frame_id) if show_full_trace else frame_id
-        trace_nodes = self._get_trace_subgraph(root, show_full_trace)
-        subgraph = self._graph.subgraph(trace_nodes).copy()
-        self._render_graph(subgraph, output_path, highlight_node=frame_id)
+        trace_nodes = []
+        for root in self._trace_roots(frame_id, show_full_trace):
+            trace_nodes.extend(range(root, self._graph.subtree_end[root]))
+        self._render_graph(self._to_networkx(trace_nodes), output_path, highlight_node=frame_id)
+
+    def _to_networkx(self, nodes: List[int]) -> "nx.DiGraph":
+        """以帧 ID 为节点的子图，生成器的多次调用合并为一个节点"""
+        graph = self._graph
+        g = nx.DiGraph()
+        included = set(nodes)
+        for node in nodes:
+            g.add_node(
+                graph.frame_id[node],
+                filename=graph.filename_of(node),
+                lineno=graph.lineno[node],
+                func=graph.func_of(node),
+                start_pos=graph.start[node],
+                end_pos=graph.end_of(node),
+                status=graph.status_of(node),
+            )
+            parent = graph.parent_of(node)
+            if parent in included:
+                g.add_edge(graph.frame_id[parent], graph.frame_id[node])
+        return g
 
-    def _find_trace_root(self, frame_id: int) -> int:
+    def _find_trace_root(self, node: int) -> int:
         """查找完整追踪的根节点"""
-        current = frame_id
-        while preds := list(self._graph.predecessors(current)):
-            if (pred := preds[0]) == ROOT_FRAME_ID:
-                break
-            current = pred
+        current = node
+        while (parent := self._graph.parent_of(current)) is not None and parent != CallGraph.ROOT:
+            current = parent
         return current
 
-    def _get_trace_subgraph(self, start_node: int, full_trace: bool) -> Set[int]:
-        """获取追踪子图的节点集合"""
-        if full_trace:
-            return {start_node} | nx.descendants(self._graph, start_node)
-        return {start_node} | nx.descendants(self._graph, start_node)
-
-    def _format_node_text(self, node_id: int, level: int) -> str:
-        node_data = self._graph.nodes[node_id]
-        filename = Path(node_data["filename"]).name
-        status = node_data.get("status", "unknown")
-        func = node_data.get("func", "N/A")
-        lineno = node_data["lineno"]
-        return f"{'  ' * level}- {func} ({filename}:{lineno}) [status: {status}, id: {node_id}]"
+    def _format_node_text(self, node: int, level: int) -> str:
+        filename = Path(self._graph.filename_of(node)).name
+        status = self._graph.status_of(node)
+        func = self._graph.func_of(node)
+        lineno = self._graph.lineno[node]
+        return f"{'  ' * level}- {func} ({filename}:{lineno}) [status: {status}, id: {self._graph.frame_id[node]}]"
 
     def export_trace_graph_text(self, frame_id: int, output_path: str, show_full_trace: bool = True):
         self._build_graph()
         assert self._graph is not None
 
-        if frame_id not in self._graph:
-            raise ValueError(f"Frame ID {frame_id} not found in trace graph.")
-
-        start_node = self._find_trace_root(frame_id) if show_full_trace else frame_id
         output_lines = []  # 直接输出树结构，移除标题和分隔线
-
-        stack: List[Tuple[int, int]] = [(start_node, 0)]
-        visited: Set[int] = set()
-
-        while stack:
-            node_id, level = stack.pop()
-            if node_id in visited:
-                continue
-            visited.add(node_id)
-
-            output_lines.append(self._format_node_text(node_id, level))
-
-            children = sorted(
-                self._graph.successors(node_id),
-                key=lambda cid: self._graph.nodes[cid].get("start_pos", 0),
-                reverse=True,
-            )
-            for child_id in children:
-                if child_id not in visited:
-                    stack.append((child_id, level + 1))
+        for root in self._trace_roots(frame_id, show_full_trace):
+            # 子树是连续的先序区间，栈中保留当前节点的祖先
+            ancestors: List[int] = []
+            for node in range(root, self._graph.subtree_end[root]):
+                while ancestors and self._graph.subtree_end[ancestors[-1]] <= node:
+                    ancestors.pop()
+                output_lines.append(self._format_node_text(node, len(ancestors)))
+                ancestors.append(node)
 
         with open(output_path, "w", encoding="utf-8") as f:
             f.write("\n".join(output_lines))
         print(f"Graph text representation exported to {output_path}")
 
-    def _render_graph(self, g: nx.DiGraph, output_path: str, highlight_node: Optional[int] = None):
+    def _render_graph(self, g: "nx.DiGraph", output_path: str, highlight_node: Optional[int] = None):
         if ROOT_FRAME_ID in g:
             g.remove_node(ROOT_FRAME_ID)
 
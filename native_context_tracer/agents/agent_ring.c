@@ -0,0 +1,432 @@
+#define _GNU_SOURCE
+#include "agent_ring.h"
+#include "func_trace_format.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+#include <mach-o/dyld.h>
+#else
+#include <link.h>
+#include <sys/syscall.h>
+#endif
+
+#define FT_DEFAULT_RING (1u << 16)
+#define FT_FLUSH_INTERVAL_NS 20000000L
+
+// 单生产者环形缓冲区：只有所属线程写 head，
+// 消费者（后台线程、缓冲区满时的本线程、退出清理）持 drain_lock 推进 tail
+typedef struct ThreadRing {
+  uint8_t *events;
+  uint32_t mask;
+  _Atomic uint64_t head;
+  _Atomic uint64_t tail;
+  pthread_mutex_t drain_lock;
+  uint32_t tid;
+  struct ThreadRing *next;
+} ThreadRing;
+
+static struct {
+  pthread_once_t once;
+  pthread_mutex_t list_lock; // 保护 rings 链表，持有期间链表中的缓冲区不会被释放
+  pthread_mutex_t file_lock; // 保证 chunk 整块写入
+  ThreadRing *rings;
+  int fd;
+  uint32_t capacity;
+  const AgentConfig *config;
+  pthread_key_t key;
+  pthread_t flusher;
+  _Atomic int enabled;
+  _Atomic int running;
+  _Atomic int shut_down;
+} g = {PTHREAD_ONCE_INIT, PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER,
+       NULL, -1, 0, NULL, 0, 0, 0, 0, 0};
+
+static __thread ThreadRing *t_ring;
+static __thread int t_busy;
+
+AGENT_NO_INSTR static uint64_t now_ns(clockid_t clock) {
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+AGENT_NO_INSTR static uint32_t current_tid(void) {
+#ifdef __APPLE__
+  uint64_t tid = 0;
+  pthread_threadid_np(NULL, &tid);
+  return (uint32_t)tid;
+#else
+  return (uint32_t)syscall(SYS_gettid);
+#endif
+}
+
+AGENT_NO_INSTR static int write_all(int fd, struct iovec *iov, int count) {
+  while (count > 0) {
+    ssize_t n = writev(fd, iov, count);
+    if (n < 0)
+      return 0;
+    while (count > 0 && (size_t)n >= iov->iov_len) {
+      n -= (ssize_t)iov->iov_len;
+      iov++;
+      count--;
+    }
+    if (count > 0) {
+      iov->iov_base = (char *)iov->iov_base + n;
+      iov->iov_len -= (size_t)n;
+    }
+  }
+  return 1;
+}
+
+AGENT_NO_INSTR static void write_chunk(uint16_t type, uint32_t tid,
+                                    struct iovec *payload, int count) {
+  struct iovec iov[4];
+  FtChunkHeader hdr = {FT_CHUNK_MAGIC, type, 0, tid, 0};
+  for (int i = 0; i < count; i++) {
+    hdr.size += (uint32_t)payload[i].iov_len;
+    iov[i + 1] = payload[i];
+  }
+  iov[0].iov_base = &hdr;
+  iov[0].iov_len = sizeof(hdr);
+  pthread_mutex_lock(&g.file_lock);
+  if (g.fd >= 0)
+    write_all(g.fd, iov, count + 1);
+  pthread_mutex_unlock(&g.file_lock);
+}
+
+// 把 [tail, head) 写成一个 chunk，环绕时分两段
+AGENT_NO_INSTR static void drain(ThreadRing *ring) {
+  pthread_mutex_lock(&ring->drain_lock);
+  uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+  if (head != tail) {
+    uint32_t cap = ring->mask + 1;
+    uint32_t start = (uint32_t)(tail & ring->mask);
+    uint64_t count = head - tail;
+    uint64_t first = count < cap - start ? count : cap - start;
+    struct iovec payload[2] = {
+        {ring->events + (size_t)start * g.config->event_size,
+         first * g.config->event_size},
+        {ring->events, (count - first) * g.config->event_size}};
+    write_chunk(g.config->chunk_type, ring->tid, payload, count > first ? 2 : 1);
+    atomic_store_explicit(&ring->tail, head, memory_order_release);
+  }
+  pthread_mutex_unlock(&ring->drain_lock);
+}
+
+AGENT_NO_INSTR static void release_ring(void *arg) {
+  ThreadRing *ring = arg;
+  drain(ring);
+  pthread_mutex_lock(&g.list_lock);
+  for (ThreadRing **p = &g.rings; *p; p = &(*p)->next) {
+    if (*p == ring) {
+      *p = ring->next;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&g.list_lock);
+  t_ring = NULL;
+  pthread_mutex_destroy(&ring->drain_lock);
+  free(ring->events);
+  free(ring);
+}
+
+AGENT_NO_INSTR static void drain_all(void) {
+  pthread_mutex_lock(&g.list_lock);
+  for (ThreadRing *ring = g.rings; ring; ring = ring->next)
+    drain(ring);
+  pthread_mutex_unlock(&g.list_lock);
+}
+
+AGENT_NO_INSTR static void *flusher_main(void *arg) {
+  (void)arg;
+  t_busy = 1; // 后台线程自身的调用（如被拦截的 libc 函数）不记录
+  struct timespec interval = {0, FT_FLUSH_INTERVAL_NS};
+  while (atomic_load(&g.running)) {
+    nanosleep(&interval, NULL);
+    drain_all();
+  }
+  return NULL;
+}
+
+// 打开输出文件并写文件头。fork 出的子进程另开一个文件：
+// 默认文件名本来就带 pid，指定了文件名时在后面加 .<pid>
+AGENT_NO_INSTR static int open_output(int forked) {
+  const char *path = getenv(g.config->file_env);
+  char buf[4096];
+  if (!path || !path[0]) {
+    snprintf(buf, sizeof(buf), "%s.%ld.bin", g.config->file_prefix,
+             (long)getpid());
+    path = buf;
+  } else if (forked) {
+    snprintf(buf, sizeof(buf), "%s.%ld", path, (long)getpid());
+    path = buf;
+  }
+  g.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (g.fd < 0) {
+    fprintf(stderr, "%s: cannot open %s\n", g.config->file_prefix, path);
+    return 0;
+  }
+
+  FtFileHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, FT_FILE_MAGIC, 8);
+  hdr.version = FT_FILE_VERSION;
+  hdr.pid = (uint32_t)getpid();
+  hdr.start_monotonic_ns = now_ns(CLOCK_MONOTONIC);
+  hdr.start_realtime_ns = now_ns(CLOCK_REALTIME);
+  struct iovec iov = {&hdr, sizeof(hdr)};
+  write_all(g.fd, &iov, 1);
+  return 1;
+}
+
+AGENT_NO_INSTR static void start_flusher(void) {
+  atomic_store(&g.running, 1);
+  if (pthread_create(&g.flusher, NULL, flusher_main, NULL) != 0)
+    atomic_store(&g.running, 0);
+}
+
+// fork 前按 list_lock -> drain_lock -> file_lock 的顺序拿住所有锁，
+// 子进程里不会留下被已不存在的线程持有的锁
+AGENT_NO_INSTR static void before_fork(void) {
+  pthread_mutex_lock(&g.list_lock);
+  for (ThreadRing *ring = g.rings; ring; ring = ring->next)
+    pthread_mutex_lock(&ring->drain_lock);
+  pthread_mutex_lock(&g.file_lock);
+}
+
+AGENT_NO_INSTR static void after_fork_parent(void) {
+  pthread_mutex_unlock(&g.file_lock);
+  for (ThreadRing *ring = g.rings; ring; ring = ring->next)
+    pthread_mutex_unlock(&ring->drain_lock);
+  pthread_mutex_unlock(&g.list_lock);
+}
+
+// 子进程只剩调用 fork 的线程：缓冲区中 fork 前的事件归父进程落盘，这里丢弃；
+// 其他线程的缓冲区释放，本线程的缓冲区清空并换成子进程的 tid；
+// 输出换到子进程自己的文件，落盘线程重新启动
+AGENT_NO_INSTR static void after_fork_child(void) {
+  int busy = t_busy;
+  t_busy = 1;
+  pthread_mutex_unlock(&g.file_lock);
+  ThreadRing **p = &g.rings;
+  while (*p) {
+    ThreadRing *ring = *p;
+    pthread_mutex_unlock(&ring->drain_lock);
+    if (ring == t_ring) {
+      atomic_store(&ring->tail, atomic_load(&ring->head));
+      ring->tid = current_tid();
+      p = &ring->next;
+    } else {
+      *p = ring->next;
+      pthread_mutex_destroy(&ring->drain_lock);
+      free(ring->events);
+      free(ring);
+    }
+  }
+  pthread_mutex_unlock(&g.list_lock);
+
+  if (g.fd >= 0)
+    close(g.fd);
+  g.fd = -1;
+  atomic_store(&g.running, 0);
+  if (!atomic_load(&g.shut_down) && open_output(1))
+    start_flusher();
+  else
+    atomic_store(&g.enabled, 0);
+  t_busy = busy;
+}
+
+AGENT_NO_INSTR static void init_once(void) {
+  if (!open_output(0))
+    return;
+
+  uint32_t cap = FT_DEFAULT_RING;
+  const char *ring = getenv(g.config->ring_env);
+  if (ring && atol(ring) > 0) {
+    unsigned long want = (unsigned long)atol(ring);
+    for (cap = 64; cap < want && cap < (1u << 26); cap <<= 1)
+      ;
+  }
+  g.capacity = cap;
+
+  pthread_key_create(&g.key, release_ring);
+  pthread_atfork(before_fork, after_fork_parent, after_fork_child);
+  start_flusher();
+
+  const char *disable = getenv(g.config->disable_env);
+  atomic_store(&g.enabled, !(disable && strcmp(disable, "1") == 0));
+}
+
+AGENT_NO_INSTR static ThreadRing *thread_ring(const AgentConfig *config) {
+  if (t_ring)
+    return t_ring;
+  g.config = config;
+  pthread_once(&g.once, init_once);
+  if (g.fd < 0 || atomic_load(&g.shut_down))
+    return NULL;
+  ThreadRing *ring = calloc(1, sizeof(*ring));
+  if (!ring)
+    return NULL;
+  ring->events = malloc((size_t)g.capacity * config->event_size);
+  if (!ring->events) {
+    free(ring);
+    return NULL;
+  }
+  ring->mask = g.capacity - 1;
+  ring->tid = current_tid();
+  pthread_mutex_init(&ring->drain_lock, NULL);
+  pthread_mutex_lock(&g.list_lock);
+  ring->next = g.rings;
+  g.rings = ring;
+  pthread_mutex_unlock(&g.list_lock);
+  pthread_setspecific(g.key, ring);
+  t_ring = ring;
+  return ring;
+}
+
+AGENT_NO_INSTR int agent_enter(void) {
+  if (t_busy)
+    return 0;
+  t_busy = 1;
+  return 1;
+}
+
+AGENT_NO_INSTR void agent_leave(void) { t_busy = 0; }
+
+AGENT_NO_INSTR uint64_t agent_now_ns(void) { return now_ns(CLOCK_MONOTONIC); }
+
+AGENT_NO_INSTR void *agent_reserve(const AgentConfig *config) {
+  ThreadRing *ring = thread_ring(config);
+  if (!ring || !atomic_load_explicit(&g.enabled, memory_order_relaxed))
+    return NULL;
+  uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) >
+      ring->mask)
+    drain(ring); // 缓冲区满，同步落盘而不是丢事件
+  return ring->events + (size_t)(head & ring->mask) * config->event_size;
+}
+
+AGENT_NO_INSTR void agent_commit(void) {
+  ThreadRing *ring = t_ring;
+  uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+AGENT_NO_INSTR void agent_enable(const AgentConfig *config, int enable) {
+  g.config = config;
+  pthread_once(&g.once, init_once);
+  atomic_store(&g.enabled, enable != 0);
+}
+
+AGENT_NO_INSTR int agent_enabled(void) { return atomic_load(&g.enabled); }
+
+AGENT_NO_INSTR void agent_flush(const AgentConfig *config) {
+  g.config = config;
+  pthread_once(&g.once, init_once);
+  drain_all();
+}
+
+typedef struct {
+  char *buf;
+  size_t size;
+  size_t cap;
+} ModuleBuf;
+
+AGENT_NO_INSTR static void append(ModuleBuf *mb, const void *data, size_t len) {
+  if (mb->size + len > mb->cap) {
+    size_t cap = mb->cap ? mb->cap * 2 : 4096;
+    while (cap < mb->size + len)
+      cap *= 2;
+    char *p = realloc(mb->buf, cap);
+    if (!p)
+      return;
+    mb->buf = p;
+    mb->cap = cap;
+  }
+  memcpy(mb->buf + mb->size, data, len);
+  mb->size += len;
+}
+
+AGENT_NO_INSTR static void add_module(ModuleBuf *mb, uint64_t bias,
+                                   uint64_t start, uint64_t end,
+                                   const char *path) {
+  static const char pad[8];
+  FtModule m = {bias, start, end, (uint32_t)strlen(path), 0};
+  append(mb, &m, sizeof(m));
+  append(mb, path, m.path_len);
+  append(mb, pad, (8 - m.path_len % 8) % 8);
+}
+
+#ifdef __APPLE__
+// dyld 只给出镜像头地址，end 记为0，由转换工具取不超过地址的最近镜像
+AGENT_NO_INSTR static void collect_modules(ModuleBuf *mb) {
+  uint32_t count = _dyld_image_count();
+  for (uint32_t i = 0; i < count; i++) {
+    const char *path = _dyld_get_image_name(i);
+    if (path && path[0] == '/')
+      add_module(mb, (uint64_t)_dyld_get_image_vmaddr_slide(i),
+                 (uint64_t)(uintptr_t)_dyld_get_image_header(i), 0, path);
+  }
+}
+#else
+AGENT_NO_INSTR static int add_phdr_module(struct dl_phdr_info *info, size_t size,
+                                       void *data) {
+  (void)size;
+  char exe[4096];
+  const char *path = info->dlpi_name;
+  if (!path || !path[0]) {
+    ssize_t n = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (n <= 0)
+      return 0;
+    exe[n] = '\0';
+    path = exe;
+  }
+  // 每个可执行 PT_LOAD 段一项，vdso 之类没有路径的跳过
+  if (path[0] != '/')
+    return 0;
+  for (int i = 0; i < info->dlpi_phnum; i++) {
+    const ElfW(Phdr) *ph = &info->dlpi_phdr[i];
+    if (ph->p_type == PT_LOAD && (ph->p_flags & PF_X))
+      add_module(data, info->dlpi_addr, info->dlpi_addr + ph->p_vaddr,
+                 info->dlpi_addr + ph->p_vaddr + ph->p_memsz, path);
+  }
+  return 0;
+}
+
+AGENT_NO_INSTR static void collect_modules(ModuleBuf *mb) {
+  dl_iterate_phdr(add_phdr_module, mb);
+}
+#endif
+
+// 进程退出：停止后台线程，写出剩余事件和模块表。
+// 仍在运行的其他线程此后产生的事件被丢弃
+AGENT_NO_INSTR __attribute__((destructor)) static void agent_shutdown(void) {
+  if (g.fd < 0)
+    return;
+  t_busy = 1;
+  atomic_store(&g.enabled, 0);
+  atomic_store(&g.shut_down, 1);
+  if (atomic_exchange(&g.running, 0))
+    pthread_join(g.flusher, NULL);
+  drain_all();
+
+  ModuleBuf mb = {NULL, 0, 0};
+  collect_modules(&mb);
+  struct iovec payload = {mb.buf, mb.size};
+  write_chunk(FT_CHUNK_MODULES, 0, &payload, 1);
+  free(mb.buf);
+
+  pthread_mutex_lock(&g.file_lock);
+  close(g.fd);
+  g.fd = -1;
+  pthread_mutex_unlock(&g.file_lock);
+}
@@ -0,0 +1,49 @@
+#include "agent_ring.h"
+#include "func_trace.h"
+#include "func_trace_format.h"
+
+// 代理自身绝不能被插桩，否则进入钩子会无限递归
+#define FT_NO_INSTR AGENT_NO_INSTR
+
+static const AgentConfig config = {"NC_FTRACE_FILE", "func_trace",
+                                   "NC_FTRACE_RING", "NC_FTRACE_DISABLE",
+                                   FT_CHUNK_EVENTS, sizeof(FtEvent)};
+
+// 关闭记录期间也维护深度，重新打开后深度仍然正确
+static __thread uint32_t t_depth;
+
+FT_NO_INSTR static void record(uint32_t kind, void *fn, void *call_site) {
+  if (!agent_enter())
+    return;
+  if (kind == FT_EXIT && t_depth > 0)
+    t_depth--;
+  uint32_t depth = t_depth;
+  if (kind == FT_ENTER)
+    t_depth++;
+  FtEvent *ev = agent_reserve(&config);
+  if (ev) {
+    ev->ts = agent_now_ns();
+    ev->fn = (uint64_t)(uintptr_t)fn;
+    ev->call_site = (uint64_t)(uintptr_t)call_site;
+    ev->kind = kind;
+    ev->depth = depth;
+    agent_commit();
+  }
+  agent_leave();
+}
+
+FT_NO_INSTR void __cyg_profile_func_enter(void *fn, void *call_site) {
+  record(FT_ENTER, fn, call_site);
+}
+
+FT_NO_INSTR void __cyg_profile_func_exit(void *fn, void *call_site) {
+  record(FT_EXIT, fn, call_site);
+}
+
+FT_NO_INSTR void func_trace_enable(int enable) {
+  agent_enable(&config, enable);
+}
+
+FT_NO_INSTR int func_trace_enabled(void) { return agent_enabled(); }
+
+FT_NO_INSTR void func_trace_flush(void) { agent_flush(&config); }
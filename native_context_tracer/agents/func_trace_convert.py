@@ -0,0 +1,333 @@
+#!/usr/bin/env python3
+"""
+把 func_trace / libc_trace 代理写出的二进制跟踪文件转换为 tracer 的 trace.log / trace.log.index，
+调用树查看工具（TraceLogExtractor 等）可以像读取调试器跟踪一样读取原生函数调用。
+同一进程的两种跟踪文件可以一起转换，libc 调用作为叶子帧出现在调用它的函数之下。
+
+符号化优先使用 op_parser 的原生符号表和DWARF行号表，不可用时以十六进制地址代替函数名。
+"""
+
+import argparse
+import heapq
+import json
+import struct
+import sys
+from pathlib import Path
+
+FILE_MAGIC = b"NCFTRACE"
+FILE_VERSION = 1
+CHUNK_MAGIC = 0x4B435446
+CHUNK_EVENTS = 1
+CHUNK_MODULES = 2
+CHUNK_LIBC_CALLS = 3
+FT_ENTER = 1
+FT_EXIT = 2
+
+# 与 include/func_trace_format.h 保持一致
+FILE_HEADER = struct.Struct("=8sIIQQ")
+CHUNK_HEADER = struct.Struct("=IHHII")
+EVENT = struct.Struct("=QQQII")
+MODULE = struct.Struct("=QQQII")
+LIBC_CALL = struct.Struct("=QQQQ4QIi56s")
+
+# 按 FT_LIBC_* 编号：(函数名, [(参数名, 格式)], 返回类型)
+# 格式：u 无符号十进制，i 有符号，p 指针，o 八进制，x 十六进制，s0/s1 第几个字符串参数
+LIBC_FUNCS = [
+    ("malloc", [("size", "u")], "void*"),
+    ("calloc", [("nmemb", "u"), ("size", "u")], "void*"),
+    ("realloc", [("ptr", "p"), ("size", "u")], "void*"),
+    ("free", [("ptr", "p")], "void"),
+    ("fopen", [("path", "s0"), ("mode", "s1")], "FILE*"),
+    ("fclose", [("stream", "p")], "int"),
+    ("fread", [("ptr", "p"), ("size", "u"), ("nmemb", "u"), ("stream", "p")], "size_t"),
+    ("fwrite", [("ptr", "p"), ("size", "u"), ("nmemb", "u"), ("stream", "p")], "size_t"),
+    ("open", [("path", "s0"), ("flags", "x"), ("mode", "o")], "int"),
+    ("close", [("fd", "i")], "int"),
+    ("read", [("fd", "i"), ("buf", "p"), ("count", "u")], "ssize_t"),
+    ("write", [("fd", "i"), ("buf", "p"), ("count", "u")], "ssize_t"),
+    ("open64", [("path", "s0"), ("flags", "x"), ("mode", "o")], "int"),
+    ("openat", [("dirfd", "i"), ("path", "s0"), ("flags", "x"), ("mode", "o")], "int"),
+    ("__read_chk", [("fd", "i"), ("buf", "p"), ("nbytes", "u"), ("buflen", "u")], "ssize_t"),
+    ("__memcpy_chk", [("dest", "p"), ("src", "p"), ("len", "u"), ("destlen", "u")], "void*"),
+]
+
+_INDENT = "  "
+
+
+class FuncTrace:
+    def __init__(self, pid, start_ns, start_realtime_ns):
+        self.pid = pid
+        self.start_ns = start_ns
+        self.start_realtime_ns = start_realtime_ns
+        self.events = {}  # tid -> [(ts, fn, call_site, kind, depth)]
+        self.libc_calls = {}  # tid -> [(ts, duration, caller, ret, args, func, err, strings)]
+        self.modules = []  # [(bias, start, end, path)]
+
+    def merge(self, other):
+        """合并同一进程的另一个跟踪文件（例如 func_trace 与 libc_trace）"""
+        for tid, events in other.events.items():
+            self.events.setdefault(tid, []).extend(events)
+        for tid, calls in other.libc_calls.items():
+            self.libc_calls.setdefault(tid, []).extend(calls)
+        known = set(self.modules)
+        self.modules.extend(m for m in other.modules if m not in known)
+        self.start_ns = min(self.start_ns, other.start_ns)
+
+
+def read_trace(path):
+    data = Path(path).read_bytes()
+    if len(data) < FILE_HEADER.size:
+        raise ValueError(f"{path}: truncated header")
+    magic, version, pid, start_ns, start_realtime_ns = FILE_HEADER.unpack_from(data)
+    if magic != FILE_MAGIC or version != FILE_VERSION:
+        raise ValueError(f"{path}: not a func_trace file (version {version})")
+    trace = FuncTrace(pid, start_ns, start_realtime_ns)
+
+    off = FILE_HEADER.size
+    while off + CHUNK_HEADER.size <= len(data):
+        magic, kind, _, tid, size = CHUNK_HEADER.unpack_from(data, off)
+        off += CHUNK_HEADER.size
+        if magic != CHUNK_MAGIC or off + size > len(data):
+            # 进程被强制结束时最后一个 chunk 可能不完整
+            print(f"warning: {path}: truncated chunk at offset {off}", file=sys.stderr)
+            break
+        payload = memoryview(data)[off : off + size]
+        off += size
+        if kind == CHUNK_EVENTS:
+            trace.events.setdefault(tid, []).extend(EVENT.iter_unpack(payload))
+        elif kind == CHUNK_LIBC_CALLS:
+            calls = trace.libc_calls.setdefault(tid, [])
+            for ts, duration, caller, ret, a0, a1, a2, a3, func, err, raw in LIBC_CALL.iter_unpack(payload):
+                strings = [part.decode("utf-8", errors="replace") for part in raw.split(b"\0")[:2]]
+                calls.append((ts, duration, caller, ret, (a0, a1, a2, a3), func, err, strings))
+        elif kind == CHUNK_MODULES:
+            pos = 0
+            while pos + MODULE.size <= size:
+                bias, start, end, path_len, _ = MODULE.unpack_from(payload, pos)
+                pos += MODULE.size
+                module_path = bytes(payload[pos : pos + path_len]).decode("utf-8", errors="replace")
+                pos += (path_len + 7) & ~7
+                trace.modules.append((bias, start, end, module_path))
+    return trace
+
+
+def _import_op_parser():
+    src = str(Path(__file__).resolve().parents[1] / "op_parser_package" / "src")
+    if src not in sys.path:
+        sys.path.append(src)
+    try:
+        import op_parser
+    except (ImportError, OSError, RuntimeError):  # 未安装或 libop_parser.so 未构建
+        return None
+    return op_parser
+
+
+class Symbolizer:
+    """运行时地址 -> (函数名, 文件名, 行号)"""
+
+    def __init__(self, modules, line_cache_dir=None):
+        # 没有结束地址的模块（macOS）覆盖到下一个模块之前
+        self._modules = sorted(modules, key=lambda m: m[1])
+        self._line_cache_dir = line_cache_dir
+        self._lines = {}
+        self._cache = {}
+        self._symbols = None
+        self._op_parser = _import_op_parser()
+        if self._op_parser is not None:
+            self._symbols = self._op_parser.SymbolTable()
+            for bias, _, _, path in self._modules:
+                try:
+                    self._symbols.load_elf(path, bias)
+                except ValueError:
+                    pass
+
+    def _module(self, addr):
+        found = None
+        for module in self._modules:
+            bias, start, end, _ = module
+            if start <= addr and (addr < end or end == 0):
+                found = module
+            elif start > addr:
+                break
+        return found
+
+    def _line_table(self, path):
+        if path not in self._lines:
+            try:
+                self._lines[path] = self._op_parser.LineTable(path, self._line_cache_dir)
+            except ValueError:
+                self._lines[path] = None
+        return self._lines[path]
+
+    def resolve(self, addr):
+        result = self._cache.get(addr)
+        if result is not None:
+            return result
+        module = self._module(addr)
+        func, filename, lineno = f"0x{addr:x}", module[3] if module else "??", 0
+        if self._symbols is not None:
+            symbol, offset = self._symbols.lookup(addr)
+            if symbol is not None:
+                func = symbol.name if offset == 0 else f"{symbol.name}+{offset}"
+            if module is not None:
+                lines = self._line_table(module[3])
+                entry = lines.lookup(addr, load_bias=module[0]) if lines else None
+                if entry is not None and entry.file:
+                    filename, lineno = entry.file, entry.line
+        result = (func, filename, lineno)
+        self._cache[addr] = result
+        return result
+
+
+def _format_elapsed(ns):
+    if ns >= 1000000:
+        return f"{ns / 1e6:.3f}ms"
+    return f"{ns / 1e3:.3f}us"
+
+
+def _signed(value, bits=64):
+    return value - (1 << bits) if value >= 1 << (bits - 1) else value
+
+
+def _format_libc_value(value, fmt, strings):
+    if fmt == "u":
+        return str(value)
+    if fmt == "i":
+        return str(_signed(value))
+    if fmt == "o":
+        return f"0{value:o}"
+    if fmt == "x":
+        return f"0x{value:x}"
+    if fmt in ("s0", "s1"):
+        index = int(fmt[1])
+        return json.dumps(strings[index] if index < len(strings) else "", ensure_ascii=False)
+    return f"0x{value:x}"
+
+
+def format_libc_call(call):
+    """(函数名, 参数文本, 返回值文本)"""
+    _, _, _, ret, args, func, err, strings = call
+    if func >= len(LIBC_FUNCS):
+        return f"libc#{func}", "", f"0x{ret:x}"
+    name, params, ret_type = LIBC_FUNCS[func]
+    text = ", ".join(f"{pname}={_format_libc_value(args[i], fmt, strings)}" for i, (pname, fmt) in enumerate(params))
+    if ret_type == "void":
+        result = "void"
+    elif ret_type.endswith("*"):
+        result = f"0x{ret:x} ({ret_type})" if ret else f"NULL ({ret_type})"
+    elif ret_type == "size_t":
+        result = f"{ret} ({ret_type})"
+    else:
+        result = f"{_signed(ret)} ({ret_type})"
+    failed = (ret_type.endswith("*") and ret == 0 and name != "free") or (
+        ret_type in ("int", "ssize_t") and _signed(ret) < 0
+    )
+    if failed and err:
+        result += f" errno={err}"
+    return name, text, result
+
+
+def convert(trace, log_path, symbolizer):
+    """按时间合并各线程事件，写出与 TraceLogic 文件输出相同格式的日志和索引"""
+    log_path = Path(log_path)
+
+    def by_time(item):
+        return item[0], item[1]
+
+    # libc 调用是叶子（钩子期间的嵌套调用不记录），在调用开始处一次写出 CALL 与 RETURN
+    streams = []
+    for tid in set(trace.events) | set(trace.libc_calls):
+        events = [(ev[0], tid, FT_ENTER if ev[3] == FT_ENTER else FT_EXIT, ev) for ev in trace.events.get(tid, ())]
+        calls = sorted((call[0], tid, None, call) for call in trace.libc_calls.get(tid, ()))
+        streams.append(heapq.merge(events, calls, key=by_time))
+    stacks = {}
+    next_frame_id = 1
+    calls = 0
+    with open(log_path, "wb") as log, open(str(log_path) + ".index", "w", encoding="utf-8") as index:
+
+        def write_index(kind, filename, lineno, frame_id, func, parent_frame_id):
+            entry = {
+                "type": kind,
+                "filename": filename,
+                "lineno": lineno,
+                "frame_id": frame_id,
+                "position": log.tell(),
+                "func": func,
+                "parent_frame_id": parent_frame_id,
+            }
+            index.write(json.dumps(entry) + "\n")
+
+        for ts, tid, kind, item in heapq.merge(*streams, key=by_time):
+            stack = stacks.setdefault(tid, [])
+            if kind is None:
+                # 位置取调用点所在的源码行
+                name, text, result = format_libc_call(item)
+                _, filename, lineno = symbolizer.resolve(item[2])
+                frame_id = next_frame_id
+                next_frame_id += 1
+                parent_frame_id = stack[-1][0] if stack else 0
+                indent = _INDENT * len(stack)
+                write_index("call", filename, lineno, frame_id, name, parent_frame_id)
+                line = f"{indent}↘ CALL {filename}:{lineno} {name}({text}) [frame:{frame_id}][thread:{tid}]\n"
+                log.write(line.encode("utf-8"))
+                line = (
+                    f"{indent}↗ RETURN {filename} {name}() → {result} [frame:{frame_id}]"
+                    f" # elapsed: {_format_elapsed(item[1])}\n"
+                )
+                log.write(line.encode("utf-8"))
+                write_index("return", filename, lineno, frame_id, name, 0)
+                calls += 1
+                continue
+            fn = item[1]
+            if kind == FT_ENTER:
+                func, filename, lineno = symbolizer.resolve(fn)
+                frame_id = next_frame_id
+                next_frame_id += 1
+                parent_frame_id = stack[-1][0] if stack else 0
+                write_index("call", filename, lineno, frame_id, func, parent_frame_id)
+                line = f"{_INDENT * len(stack)}↘ CALL {filename}:{lineno} {func}() [frame:{frame_id}][thread:{tid}]\n"
+                log.write(line.encode("utf-8"))
+                stack.append((frame_id, fn, ts, func, filename, lineno))
+                calls += 1
+                continue
+            # 记录开启前进入的帧没有对应的 CALL，跳过；longjmp/异常跳过的帧一并弹出
+            if not any(frame[1] == fn for frame in stack):
+                continue
+            while stack[-1][1] != fn:
+                stack.pop()
+            frame_id, _, enter_ts, func, filename, lineno = stack.pop()
+            line = (
+                f"{_INDENT * len(stack)}↗ RETURN {filename} {func}() → ? [frame:{frame_id}]"
+                f" # elapsed: {_format_elapsed(ts - enter_ts)}\n"
+            )
+            log.write(line.encode("utf-8"))
+            write_index("return", filename, lineno, frame_id, func, 0)
+        # 注释行结尾：TraceLogExtractor 读到返回位置之后才停止，位置不能恰好是文件末尾
+        log.write(f"# func_trace pid={trace.pid} calls={calls}\n".encode("utf-8"))
+    return calls
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description="Convert func_trace/libc_trace binary files to trace.log + trace.log.index")
+    parser.add_argument(
+        "trace_files", nargs="+", help="func_trace.<pid>.bin / libc_trace.<pid>.bin written by the agents (same process)"
+    )
+    parser.add_argument("-o", "--output", default="trace.log", help="output log path (index is <output>.index)")
+    parser.add_argument("--line-cache-dir", default=None, help="cache directory for DWARF line tables")
+    args = parser.parse_args(argv)
+
+    trace = read_trace(args.trace_files[0])
+    for path in args.trace_files[1:]:
+        other = read_trace(path)
+        if other.pid != trace.pid:
+            print(f"warning: {path}: pid {other.pid} differs from {trace.pid}", file=sys.stderr)
+        trace.merge(other)
+    symbolizer = Symbolizer(trace.modules, args.line_cache_dir)
+    calls = convert(trace, args.output, symbolizer)
+    threads = len(set(trace.events) | set(trace.libc_calls))
+    print(f"{calls} calls from {threads} threads -> {args.output}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,37 @@
+#ifndef AGENT_RING_H
+#define AGENT_RING_H
+
+#include <stdint.h>
+
+// 跟踪代理共用的每线程环形缓冲区与落盘线程（内部接口）
+// 每个代理库各自编译一份 agent_ring.c，符号隐藏，同一进程中加载多个代理时状态互不干扰
+
+#define AGENT_HIDDEN __attribute__((visibility("hidden")))
+#define AGENT_NO_INSTR __attribute__((no_instrument_function))
+
+typedef struct {
+  const char *file_env;    // 输出文件路径的环境变量
+  const char *file_prefix; // 默认输出 <prefix>.<pid>.bin
+  const char *ring_env;    // 每线程缓冲区容量（事件数）的环境变量
+  const char *disable_env; // 为1时启动后不记录
+  uint16_t chunk_type;     // 事件 chunk 的类型
+  uint32_t event_size;
+} AgentConfig;
+
+// 进入代理代码；已经在代理中（代理自身调用了被拦截/插桩的函数，
+// 或信号处理函数重入）时返回0，调用方应直接放行
+AGENT_HIDDEN int agent_enter(void);
+AGENT_HIDDEN void agent_leave(void);
+
+// 当前线程缓冲区的下一个槽位，首次调用时初始化代理；
+// 未开启记录或代理不可用时返回NULL。填写完成后调用 agent_commit
+AGENT_HIDDEN void *agent_reserve(const AgentConfig *config);
+AGENT_HIDDEN void agent_commit(void);
+
+AGENT_HIDDEN void agent_enable(const AgentConfig *config, int enable);
+AGENT_HIDDEN int agent_enabled(void);
+AGENT_HIDDEN void agent_flush(const AgentConfig *config);
+
+AGENT_HIDDEN uint64_t agent_now_ns(void);
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef FUNC_TRACE_H
+#define FUNC_TRACE_H
+
+// -finstrument-functions 函数进出跟踪代理
+// 链接 libfunc_trace_agent 后自动生效，以下接口用于在程序内控制跟踪范围
+//
+// 环境变量：
+//   NC_FTRACE_FILE     输出文件，默认 func_trace.<pid>.bin
+//   NC_FTRACE_RING     每线程环形缓冲区容量（事件数，取2的幂），默认 65536
+//   NC_FTRACE_DISABLE  为1时启动后不记录，直到 func_trace_enable(1)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void func_trace_enable(int enable);
+int func_trace_enabled(void);
+
+// 把所有线程缓冲区中的事件写入文件
+void func_trace_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef FUNC_TRACE_FORMAT_H
+#define FUNC_TRACE_FORMAT_H
+
+#include <stdint.h>
+
+// 跟踪代理（func_trace、libc_trace）共用的二进制文件格式（主机字节序）：
+//   FtFileHeader
+//   若干 chunk：FtChunkHeader + payload
+// 同一线程的事件 chunk 按时间顺序出现，不同线程的 chunk 可以交错；
+// 最后一个 chunk 是模块表，用于把运行时地址符号化
+
+#define FT_FILE_MAGIC "NCFTRACE"
+#define FT_FILE_VERSION 1
+#define FT_CHUNK_MAGIC 0x4b435446u // "FTCK"
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t pid;
+  uint64_t start_monotonic_ns; // 与事件时间戳同一时钟
+  uint64_t start_realtime_ns;  // 对应的墙上时间
+} FtFileHeader;
+
+enum {
+  FT_CHUNK_EVENTS = 1,    // payload 为 FtEvent 数组
+  FT_CHUNK_MODULES = 2,   // payload 为若干 FtModule + 路径
+  FT_CHUNK_LIBC_CALLS = 3 // payload 为 FtLibcCall 数组
+};
+
+typedef struct {
+  uint32_t magic;
+  uint16_t type;
+  uint16_t reserved;
+  uint32_t tid;
+  uint32_t size; // payload 字节数
+} FtChunkHeader;
+
+enum { FT_ENTER = 1, FT_EXIT = 2 };
+
+typedef struct {
+  uint64_t ts;        // CLOCK_MONOTONIC 纳秒
+  uint64_t fn;        // 函数运行时地址
+  uint64_t call_site; // 调用点运行时地址
+  uint32_t kind;      // FT_ENTER / FT_EXIT
+  uint32_t depth;     // 帧所在深度，同一帧的进入与退出相同
+} FtEvent;
+
+// libc_trace 拦截的函数，编号与转换工具中的表一致
+enum {
+  FT_LIBC_MALLOC,
+  FT_LIBC_CALLOC,
+  FT_LIBC_REALLOC,
+  FT_LIBC_FREE,
+  FT_LIBC_FOPEN,
+  FT_LIBC_FCLOSE,
+  FT_LIBC_FREAD,
+  FT_LIBC_FWRITE,
+  FT_LIBC_OPEN,
+  FT_LIBC_CLOSE,
+  FT_LIBC_READ,
+  FT_LIBC_WRITE,
+  FT_LIBC_OPEN64,
+  FT_LIBC_OPENAT,
+  FT_LIBC_READ_CHK,
+  FT_LIBC_MEMCPY_CHK,
+  FT_LIBC_COUNT
+};
+
+#define FT_LIBC_STR_MAX 56
+
+// 一次完整的 libc 调用，返回后记录
+typedef struct {
+  uint64_t ts;       // 调用开始，CLOCK_MONOTONIC 纳秒
+  uint64_t duration; // 纳秒
+  uint64_t caller;   // 返回地址
+  uint64_t ret;
+  uint64_t args[4];
+  uint32_t func; // FT_LIBC_*
+  int32_t err;   // 调用后的 errno
+  char str[FT_LIBC_STR_MAX]; // 字符串参数，多个时以 NUL 分隔，超长截断
+} FtLibcCall;
+
+// 可执行段，path 紧跟其后，长度按8字节向上对齐
+typedef struct {
+  uint64_t bias; // 运行时地址 - 文件虚拟地址
+  uint64_t start;
+  uint64_t end;
+  uint32_t path_len;
+  uint32_t reserved;
+} FtModule;
+
+#endif
@@ -0,0 +1,331 @@
+#define _GNU_SOURCE
+#include "agent_ring.h"
+#include "func_trace_format.h"
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// LD_PRELOAD 的 libc 拦截代理：记录所选函数的参数、返回值、耗时和调用点，
+// 代替调试器在每次调用时停下来读取寄存器
+//
+// 环境变量：
+//   NC_LTRACE_FUNCS    要记录的函数，逗号分隔或 all，
+//                      默认 fopen,fclose,read,write,malloc,free
+//   NC_LTRACE_FILE     输出文件，默认 libc_trace.<pid>.bin
+//   NC_LTRACE_RING     每线程缓冲区容量（事件数）
+//   NC_LTRACE_DISABLE  为1时不记录
+//
+// 钩子在整个调用期间标记为忙，libc 内部的嵌套调用（fopen 里的 malloc）
+// 以及代理自身的分配不会被记录
+
+static const AgentConfig config = {"NC_LTRACE_FILE", "libc_trace",
+                                   "NC_LTRACE_RING", "NC_LTRACE_DISABLE",
+                                   FT_CHUNK_LIBC_CALLS, sizeof(FtLibcCall)};
+
+static const char *const func_names[FT_LIBC_COUNT] = {
+    "malloc", "calloc", "realloc", "free",  "fopen", "fclose",
+    "fread",  "fwrite", "open",    "close", "read",  "write",
+    "open64", "openat", "__read_chk", "__memcpy_chk"};
+
+#define DEFAULT_FUNCS "fopen,fclose,read,write,malloc,free"
+
+// glibc 的分配器入口，不经过 dlsym，避免 dlsym 内部分配时递归
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+// _FORTIFY_SOURCE 检查失败时终止进程
+extern void __chk_fail(void) __attribute__((noreturn));
+
+static _Atomic int selected = -1; // 函数位图，-1 表示尚未读取配置
+static void *real_funcs[FT_LIBC_COUNT];
+
+// 解析函数列表，不分配内存
+static int parse_selection(const char *list) {
+  if (strcmp(list, "all") == 0)
+    return (1 << FT_LIBC_COUNT) - 1;
+  int mask = 0;
+  while (*list) {
+    size_t len = strcspn(list, ",");
+    for (int i = 0; i < FT_LIBC_COUNT; i++)
+      if (strlen(func_names[i]) == len && strncmp(list, func_names[i], len) == 0)
+        mask |= 1 << i;
+    list += len;
+    if (*list == ',')
+      list++;
+  }
+  return mask;
+}
+
+static int traced(int func) {
+  int mask = atomic_load_explicit(&selected, memory_order_relaxed);
+  if (mask < 0) {
+    const char *list = getenv("NC_LTRACE_FUNCS");
+    mask = parse_selection(list && list[0] ? list : DEFAULT_FUNCS);
+    atomic_store_explicit(&selected, mask, memory_order_relaxed);
+  }
+  return (mask >> func) & 1;
+}
+
+static void *real(int func) {
+  void *fn = __atomic_load_n(&real_funcs[func], __ATOMIC_RELAXED);
+  if (!fn) {
+    fn = dlsym(RTLD_NEXT, func_names[func]);
+    __atomic_store_n(&real_funcs[func], fn, __ATOMIC_RELAXED);
+  }
+  return fn;
+}
+
+// 在调用前占好槽位（首次调用时初始化代理，开始时间不早于文件头）；
+// 不记录时返回NULL，调用方直接放行
+static FtLibcCall *begin(int func) {
+  if (!traced(func) || !agent_enter())
+    return NULL;
+  FtLibcCall *c = agent_reserve(&config);
+  if (!c) {
+    agent_leave();
+    return NULL;
+  }
+  c->func = (uint32_t)func;
+  c->ts = agent_now_ns();
+  return c;
+}
+
+// 字符串参数依次拷入 str，以 NUL 分隔；总长度超出时截断前一个
+static void copy_strings(char *dst, const char *s0, const char *s1) {
+  size_t n1 = s1 ? strnlen(s1, 8) + 1 : 0;
+  size_t room = FT_LIBC_STR_MAX - n1;
+  size_t n0 = s0 ? strnlen(s0, room - 1) : 0;
+  memset(dst, 0, FT_LIBC_STR_MAX);
+  if (s0)
+    memcpy(dst, s0, n0);
+  if (s1)
+    memcpy(dst + n0 + 1, s1, n1 - 1);
+}
+
+static void end(FtLibcCall *c, void *caller, uint64_t ret, uint64_t a0,
+                uint64_t a1, uint64_t a2, uint64_t a3, const char *s0,
+                const char *s1) {
+  int err = errno;
+  c->duration = agent_now_ns() - c->ts;
+  c->caller = (uint64_t)(uintptr_t)caller;
+  c->ret = ret;
+  c->args[0] = a0;
+  c->args[1] = a1;
+  c->args[2] = a2;
+  c->args[3] = a3;
+  c->err = err;
+  copy_strings(c->str, s0, s1);
+  agent_commit();
+  agent_leave();
+  errno = err;
+}
+
+#define CALLER __builtin_return_address(0)
+#define U64(x) ((uint64_t)(uintptr_t)(x))
+
+void *malloc(size_t size) {
+  FtLibcCall *c = begin(FT_LIBC_MALLOC);
+  if (!c)
+    return __libc_malloc(size);
+  void *p = __libc_malloc(size);
+  end(c, CALLER, U64(p), size, 0, 0, 0, NULL, NULL);
+  return p;
+}
+
+void *calloc(size_t nmemb, size_t size) {
+  FtLibcCall *c = begin(FT_LIBC_CALLOC);
+  if (!c)
+    return __libc_calloc(nmemb, size);
+  void *p = __libc_calloc(nmemb, size);
+  end(c, CALLER, U64(p), nmemb, size, 0, 0, NULL, NULL);
+  return p;
+}
+
+void *realloc(void *ptr, size_t size) {
+  FtLibcCall *c = begin(FT_LIBC_REALLOC);
+  if (!c)
+    return __libc_realloc(ptr, size);
+  void *p = __libc_realloc(ptr, size);
+  end(c, CALLER, U64(p), U64(ptr), size, 0, 0, NULL, NULL);
+  return p;
+}
+
+void free(void *ptr) {
+  FtLibcCall *c = begin(FT_LIBC_FREE);
+  if (!c) {
+    __libc_free(ptr);
+    return;
+  }
+  __libc_free(ptr);
+  end(c, CALLER, 0, U64(ptr), 0, 0, 0, NULL, NULL);
+}
+
+typedef FILE *(*fopen_fn)(const char *, const char *);
+typedef int (*fclose_fn)(FILE *);
+typedef size_t (*fio_fn)(void *, size_t, size_t, FILE *);
+typedef int (*open_fn)(const char *, int, ...);
+typedef int (*close_fn)(int);
+typedef ssize_t (*read_fn)(int, void *, size_t);
+typedef ssize_t (*write_fn)(int, const void *, size_t);
+
+FILE *fopen(const char *path, const char *mode) {
+  fopen_fn fn = (fopen_fn)real(FT_LIBC_FOPEN);
+  FtLibcCall *c = begin(FT_LIBC_FOPEN);
+  if (!c)
+    return fn(path, mode);
+  FILE *f = fn(path, mode);
+  end(c, CALLER, U64(f), U64(path), U64(mode), 0, 0, path,
+      mode);
+  return f;
+}
+
+int fclose(FILE *stream) {
+  fclose_fn fn = (fclose_fn)real(FT_LIBC_FCLOSE);
+  FtLibcCall *c = begin(FT_LIBC_FCLOSE);
+  if (!c)
+    return fn(stream);
+  int ret = fn(stream);
+  end(c, CALLER, (uint64_t)(int64_t)ret, U64(stream), 0,
+      0, 0, NULL, NULL);
+  return ret;
+}
+
+size_t fread(void *ptr, size_t size, size_t nmemb, FILE *stream) {
+  fio_fn fn = (fio_fn)real(FT_LIBC_FREAD);
+  FtLibcCall *c = begin(FT_LIBC_FREAD);
+  if (!c)
+    return fn(ptr, size, nmemb, stream);
+  size_t ret = fn(ptr, size, nmemb, stream);
+  end(c, CALLER, ret, U64(ptr), size, nmemb, U64(stream),
+      NULL, NULL);
+  return ret;
+}
+
+size_t fwrite(const void *ptr, size_t size, size_t nmemb, FILE *stream) {
+  fio_fn fn = (fio_fn)real(FT_LIBC_FWRITE);
+  FtLibcCall *c = begin(FT_LIBC_FWRITE);
+  if (!c)
+    return fn((void *)ptr, size, nmemb, stream);
+  size_t ret = fn((void *)ptr, size, nmemb, stream);
+  end(c, CALLER, ret, U64(ptr), size, nmemb, U64(stream),
+      NULL, NULL);
+  return ret;
+}
+
+typedef int (*openat_fn)(int, const char *, int, ...);
+
+// open 与 open64 只差符号名，记录格式相同
+static int traced_open(int func, void *caller, const char *path, int flags,
+                       mode_t mode) {
+  open_fn fn = (open_fn)real(func);
+  FtLibcCall *c = begin(func);
+  if (!c)
+    return fn(path, flags, mode);
+  int fd = fn(path, flags, mode);
+  end(c, caller, (uint64_t)(int64_t)fd, U64(path),
+      (uint64_t)flags, mode, 0, path, NULL);
+  return fd;
+}
+
+#define OPEN_MODE(flags, mode)                                                 \
+  do {                                                                         \
+    if ((flags) & (O_CREAT | O_TMPFILE)) {                                     \
+      va_list ap;                                                              \
+      va_start(ap, flags);                                                     \
+      mode = (mode_t)va_arg(ap, int);                                          \
+      va_end(ap);                                                              \
+    }                                                                          \
+  } while (0)
+
+int open(const char *path, int flags, ...) {
+  mode_t mode = 0;
+  OPEN_MODE(flags, mode);
+  return traced_open(FT_LIBC_OPEN, CALLER, path, flags, mode);
+}
+
+int open64(const char *path, int flags, ...) {
+  mode_t mode = 0;
+  OPEN_MODE(flags, mode);
+  return traced_open(FT_LIBC_OPEN64, CALLER, path, flags, mode);
+}
+
+int openat(int dirfd, const char *path, int flags, ...) {
+  mode_t mode = 0;
+  OPEN_MODE(flags, mode);
+  openat_fn fn = (openat_fn)real(FT_LIBC_OPENAT);
+  FtLibcCall *c = begin(FT_LIBC_OPENAT);
+  if (!c)
+    return fn(dirfd, path, flags, mode);
+  int fd = fn(dirfd, path, flags, mode);
+  end(c, CALLER, (uint64_t)(int64_t)fd, (uint64_t)(int64_t)dirfd, U64(path),
+      (uint64_t)flags, mode, path, NULL);
+  return fd;
+}
+
+int close(int fd) {
+  close_fn fn = (close_fn)real(FT_LIBC_CLOSE);
+  FtLibcCall *c = begin(FT_LIBC_CLOSE);
+  if (!c)
+    return fn(fd);
+  int ret = fn(fd);
+  end(c, CALLER, (uint64_t)(int64_t)ret, (uint64_t)fd, 0,
+      0, 0, NULL, NULL);
+  return ret;
+}
+
+ssize_t read(int fd, void *buf, size_t count) {
+  read_fn fn = (read_fn)real(FT_LIBC_READ);
+  FtLibcCall *c = begin(FT_LIBC_READ);
+  if (!c)
+    return fn(fd, buf, count);
+  ssize_t ret = fn(fd, buf, count);
+  end(c, CALLER, (uint64_t)ret, (uint64_t)fd, U64(buf),
+      count, 0, NULL, NULL);
+  return ret;
+}
+
+ssize_t write(int fd, const void *buf, size_t count) {
+  write_fn fn = (write_fn)real(FT_LIBC_WRITE);
+  FtLibcCall *c = begin(FT_LIBC_WRITE);
+  if (!c)
+    return fn(fd, buf, count);
+  ssize_t ret = fn(fd, buf, count);
+  end(c, CALLER, (uint64_t)ret, (uint64_t)fd, U64(buf),
+      count, 0, NULL, NULL);
+  return ret;
+}
+
+// _FORTIFY_SOURCE 编译的程序调用 __read_chk/__memcpy_chk 而不是 read/memcpy。
+// 缓冲区检查在这里做，之后调用真正的 read/memcpy；__memcpy_chk 不经过 dlsym，
+// 代理自身被 fortify 编译时 memcpy 也会落到这里，此时可能正在 dlsym 里
+ssize_t __read_chk(int fd, void *buf, size_t nbytes, size_t buflen) {
+  if (nbytes > buflen)
+    __chk_fail();
+  read_fn fn = (read_fn)real(FT_LIBC_READ);
+  FtLibcCall *c = begin(FT_LIBC_READ_CHK);
+  if (!c)
+    return fn(fd, buf, nbytes);
+  ssize_t ret = fn(fd, buf, nbytes);
+  end(c, CALLER, (uint64_t)ret, (uint64_t)fd, U64(buf),
+      nbytes, buflen, NULL, NULL);
+  return ret;
+}
+
+void *__memcpy_chk(void *dest, const void *src, size_t len, size_t destlen) {
+  if (len > destlen)
+    __chk_fail();
+  FtLibcCall *c = begin(FT_LIBC_MEMCPY_CHK);
+  if (!c)
+    return memcpy(dest, src, len);
+  void *ret = memcpy(dest, src, len);
+  end(c, CALLER, U64(ret), U64(dest), U64(src), len, destlen,
+      NULL, NULL);
+  return ret;
+}
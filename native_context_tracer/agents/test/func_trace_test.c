@@ -0,0 +1,131 @@
+#include "func_trace.h"
+#include "func_trace_format.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// 本文件不插桩：父进程只负责校验子进程写出的跟踪文件
+int ft_fib(int n);
+int ft_workload(int threads);
+
+#define THREADS 4
+#define MAX_TIDS 16
+#define MAX_DEPTH 64
+
+typedef struct {
+  uint32_t tid;
+  uint64_t last_ts;
+  int depth;
+  uint64_t stack[MAX_DEPTH];
+} ThreadState;
+
+static ThreadState threads[MAX_TIDS];
+static int thread_count;
+
+static ThreadState *thread_state(uint32_t tid) {
+  for (int i = 0; i < thread_count; i++)
+    if (threads[i].tid == tid)
+      return &threads[i];
+  assert(thread_count < MAX_TIDS);
+  threads[thread_count].tid = tid;
+  return &threads[thread_count++];
+}
+
+// fib(n) 的调用次数
+static int fib_calls(int n) { return n < 2 ? 1 : 1 + fib_calls(n - 1) + fib_calls(n - 2); }
+
+static void run_child(const char *path) {
+  setenv("NC_FTRACE_FILE", path, 1);
+  setenv("NC_FTRACE_RING", "64", 1); // 小缓冲区，覆盖满时同步落盘的路径
+  int expected = 55 * THREADS + 144;
+  if (ft_workload(THREADS) != expected)
+    _exit(2);
+  // 关闭期间的调用不记录
+  func_trace_enable(0);
+  ft_fib(5);
+  func_trace_enable(1);
+  func_trace_flush();
+  exit(0); // 由析构函数写出剩余事件和模块表
+}
+
+static void check_file(const char *path, pid_t pid) {
+  FILE *f = fopen(path, "rb");
+  assert(f);
+  FtFileHeader hdr;
+  assert(fread(&hdr, sizeof(hdr), 1, f) == 1);
+  assert(memcmp(hdr.magic, FT_FILE_MAGIC, 8) == 0);
+  assert(hdr.version == FT_FILE_VERSION && hdr.pid == (uint32_t)pid);
+
+  uint64_t fib = (uint64_t)(uintptr_t)ft_fib;
+  long fib_enters = 0, events = 0, chunks = 0;
+  int module_found = 0, saw_modules = 0;
+  FtChunkHeader ch;
+  while (fread(&ch, sizeof(ch), 1, f) == 1) {
+    assert(ch.magic == FT_CHUNK_MAGIC);
+    assert(!saw_modules); // 模块表是最后一个 chunk
+    char *payload = malloc(ch.size ? ch.size : 1);
+    assert(fread(payload, 1, ch.size, f) == ch.size);
+    chunks++;
+    if (ch.type == FT_CHUNK_EVENTS) {
+      assert(ch.size % sizeof(FtEvent) == 0);
+      ThreadState *ts = thread_state(ch.tid);
+      const FtEvent *ev = (const FtEvent *)payload;
+      for (size_t i = 0; i < ch.size / sizeof(FtEvent); i++, events++) {
+        assert(ev[i].ts >= ts->last_ts && ev[i].ts >= hdr.start_monotonic_ns);
+        ts->last_ts = ev[i].ts;
+        if (ev[i].kind == FT_ENTER) {
+          assert((int)ev[i].depth == ts->depth && ts->depth < MAX_DEPTH);
+          ts->stack[ts->depth++] = ev[i].fn;
+          fib_enters += ev[i].fn == fib;
+        } else {
+          assert(ev[i].kind == FT_EXIT && ts->depth > 0);
+          assert(ts->stack[--ts->depth] == ev[i].fn);
+          assert((int)ev[i].depth == ts->depth);
+        }
+      }
+    } else {
+      assert(ch.type == FT_CHUNK_MODULES);
+      saw_modules = 1;
+      size_t off = 0;
+      while (off < ch.size) {
+        const FtModule *m = (const FtModule *)(payload + off);
+        assert(off + sizeof(*m) + m->path_len <= ch.size);
+        if (m->start <= fib && fib < m->end)
+          module_found = 1;
+        off += sizeof(*m) + ((m->path_len + 7u) & ~7u);
+      }
+    }
+    free(payload);
+  }
+  fclose(f);
+
+  assert(saw_modules && module_found);
+  assert(thread_count == THREADS + 1);
+  for (int i = 0; i < thread_count; i++)
+    assert(threads[i].depth == 0);
+  assert(fib_enters == THREADS * fib_calls(10) + fib_calls(12));
+  printf("func_trace: %ld events in %ld chunks, %d threads ok\n", events,
+         chunks, thread_count);
+}
+
+int main() {
+  char path[] = "/tmp/func_trace_test_XXXXXX";
+  int fd = mkstemp(path);
+  assert(fd >= 0);
+  close(fd);
+
+  pid_t pid = fork();
+  assert(pid >= 0);
+  if (pid == 0)
+    run_child(path);
+  int status;
+  assert(waitpid(pid, &status, 0) == pid);
+  assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  check_file(path, pid);
+  unlink(path);
+  printf("All func_trace tests passed!\n");
+  return 0;
+}
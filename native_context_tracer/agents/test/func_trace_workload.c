@@ -0,0 +1,23 @@
+// 以 -finstrument-functions 编译的被测代码
+#include <pthread.h>
+
+int ft_fib(int n) { return n < 2 ? n : ft_fib(n - 1) + ft_fib(n - 2); }
+
+static void *ft_worker(void *arg) {
+  *(int *)arg = ft_fib(10);
+  return NULL;
+}
+
+int ft_workload(int threads) {
+  pthread_t tids[8];
+  int results[8];
+  int sum = 0;
+  for (int i = 0; i < threads; i++)
+    pthread_create(&tids[i], NULL, ft_worker, &results[i]);
+  sum += ft_fib(12);
+  for (int i = 0; i < threads; i++) {
+    pthread_join(tids[i], NULL);
+    sum += results[i];
+  }
+  return sum;
+}
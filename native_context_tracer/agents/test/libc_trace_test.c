@@ -0,0 +1,320 @@
+#define _GNU_SOURCE
+#include "func_trace_format.h"
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// 父进程以 LD_PRELOAD 加载代理重新执行自身，子进程跑固定的 libc 调用序列，
+// 父进程读回跟踪文件逐项校验
+
+#define ALLOC_SIZE 1234
+#define THREAD_ALLOC 4321
+#define MISSING_PATH "/nonexistent/libc_trace_test"
+#define BEFORE_FORK_ALLOC 2345
+#define AFTER_FORK_ALLOC 3456
+
+// _FORTIFY_SOURCE 下编译器生成的调用，这里直接调用以免依赖编译选项
+extern ssize_t __read_chk(int fd, void *buf, size_t nbytes, size_t buflen);
+extern void *__memcpy_chk(void *dest, const void *src, size_t len,
+                          size_t destlen);
+
+static void *thread_main(void *arg) {
+  (void)arg;
+  free(malloc(THREAD_ALLOC));
+  return NULL;
+}
+
+static int run_workload(const char *tmp_path) {
+  void *p = malloc(ALLOC_SIZE);
+  if (!p)
+    return 1;
+  free(p);
+
+  FILE *f = fopen("/dev/null", "r");
+  if (!f || fclose(f) != 0)
+    return 1;
+  if (fopen(MISSING_PATH, "r") != NULL || errno != ENOENT)
+    return 1;
+
+  int fds[2];
+  char buf[8];
+  if (pipe(fds) != 0 || write(fds[1], "hello", 5) != 5 ||
+      read(fds[0], buf, sizeof(buf)) != 5)
+    return 1;
+
+  int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0 || close(fd) != 0)
+    return 1;
+  fd = open64(tmp_path, O_RDONLY);
+  if (fd < 0 || close(fd) != 0)
+    return 1;
+  fd = openat(AT_FDCWD, tmp_path, O_WRONLY | O_CREAT, 0640);
+  if (fd < 0 || close(fd) != 0)
+    return 1;
+
+  if (write(fds[1], "chk", 3) != 3 ||
+      __read_chk(fds[0], buf, 3, sizeof(buf)) != 3)
+    return 1;
+  // __memcpy_chk 是编译器内建函数，经函数指针调用以免被展开
+  void *(*volatile memcpy_chk)(void *, const void *, size_t, size_t) =
+      __memcpy_chk;
+  char copy[8];
+  if (memcpy_chk(copy, buf, 3, sizeof(copy)) != copy ||
+      memcmp(copy, "chk", 3) != 0)
+    return 1;
+
+  pthread_t th;
+  if (pthread_create(&th, NULL, thread_main, NULL) != 0)
+    return 1;
+  pthread_join(th, NULL);
+  return 0;
+}
+
+// 另一个线程带着未落盘的事件停在 fork 时刻；fork 前刚分配的内存也还在缓冲区里。
+// 子进程的 pid 写进 tmp_path 供检查方找到它的跟踪文件
+static void *fork_thread_main(void *arg) {
+  int *fds = arg;
+  char c;
+  free(malloc(THREAD_ALLOC));
+  return read(fds[0], &c, 1) == 1 ? NULL : arg;
+}
+
+static int run_fork_workload(const char *tmp_path) {
+  int fds[2];
+  pthread_t th;
+  if (pipe(fds) != 0 || pthread_create(&th, NULL, fork_thread_main, fds) != 0)
+    return 1;
+  usleep(1000);
+  free(malloc(BEFORE_FORK_ALLOC));
+  pid_t pid = fork();
+  if (pid < 0)
+    return 1;
+  if (pid == 0) {
+    free(malloc(AFTER_FORK_ALLOC));
+    exit(0);
+  }
+  int status;
+  void *ret = NULL;
+  if (write(fds[1], "x", 1) != 1 || pthread_join(th, &ret) != 0 || ret ||
+      waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+      WEXITSTATUS(status) != 0)
+    return 1;
+  FILE *f = fopen(tmp_path, "w");
+  if (!f)
+    return 1;
+  fprintf(f, "%ld\n", (long)pid);
+  return fclose(f) != 0;
+}
+
+typedef struct {
+  uint32_t pid;
+  FtLibcCall *calls;
+  size_t count;
+  uint32_t tids[4];
+  int tid_count;
+} Trace;
+
+static Trace read_trace(const char *path) {
+  Trace t = {0};
+  FILE *f = fopen(path, "rb");
+  assert(f);
+  FtFileHeader hdr;
+  assert(fread(&hdr, sizeof(hdr), 1, f) == 1);
+  assert(memcmp(hdr.magic, FT_FILE_MAGIC, 8) == 0);
+  t.pid = hdr.pid;
+  FtChunkHeader ch;
+  int saw_modules = 0;
+  while (fread(&ch, sizeof(ch), 1, f) == 1) {
+    assert(ch.magic == FT_CHUNK_MAGIC);
+    char *payload = malloc(ch.size ? ch.size : 1);
+    assert(fread(payload, 1, ch.size, f) == ch.size);
+    if (ch.type == FT_CHUNK_LIBC_CALLS) {
+      assert(ch.size % sizeof(FtLibcCall) == 0);
+      size_t n = ch.size / sizeof(FtLibcCall);
+      t.calls = realloc(t.calls, (t.count + n) * sizeof(FtLibcCall));
+      memcpy(t.calls + t.count, payload, ch.size);
+      for (size_t i = 0; i < n; i++) {
+        assert(t.calls[t.count + i].ts >= hdr.start_monotonic_ns);
+        assert(t.calls[t.count + i].func < FT_LIBC_COUNT);
+      }
+      t.count += n;
+      int known = 0;
+      for (int i = 0; i < t.tid_count; i++)
+        known |= t.tids[i] == ch.tid;
+      if (!known && t.tid_count < 4)
+        t.tids[t.tid_count++] = ch.tid;
+    } else {
+      assert(ch.type == FT_CHUNK_MODULES);
+      saw_modules = 1;
+    }
+    free(payload);
+  }
+  fclose(f);
+  assert(saw_modules);
+  return t;
+}
+
+static const FtLibcCall *find(const Trace *t, uint32_t func, size_t from,
+                              size_t *index) {
+  for (size_t i = from; i < t->count; i++)
+    if (t->calls[i].func == func) {
+      *index = i;
+      return &t->calls[i];
+    }
+  return NULL;
+}
+
+static size_t count_alloc(const Trace *t, uint64_t size) {
+  size_t n = 0;
+  for (size_t i = 0; i < t->count; i++)
+    n += t->calls[i].func == FT_LIBC_MALLOC && t->calls[i].args[0] == size;
+  return n;
+}
+
+static void run(const char *agent, const char *mode, const char *funcs,
+                const char *trace_path, const char *tmp_path) {
+  pid_t pid = fork();
+  assert(pid >= 0);
+  if (pid == 0) {
+    setenv("LD_PRELOAD", agent, 1);
+    setenv("NC_LTRACE_FILE", trace_path, 1);
+    setenv("NC_LTRACE_FUNCS", funcs, 1);
+    execl("/proc/self/exe", "libc_trace_test", mode, tmp_path, (char *)NULL);
+    _exit(127);
+  }
+  int status;
+  assert(waitpid(pid, &status, 0) == pid);
+  assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+static void test_all(const char *agent, const char *trace_path,
+                     const char *tmp_path) {
+  run(agent, "child", "all", trace_path, tmp_path);
+  Trace t = read_trace(trace_path);
+  size_t i = 0;
+
+  // malloc 与 free 的是同一块内存
+  const FtLibcCall *c = NULL;
+  while ((c = find(&t, FT_LIBC_MALLOC, i, &i)) && c->args[0] != ALLOC_SIZE)
+    i++;
+  assert(c && c->ret != 0);
+  uint64_t block = c->ret;
+  c = find(&t, FT_LIBC_FREE, i, &i);
+  assert(c && c->args[0] == block);
+
+  // fopen 的路径与模式，fclose 关闭同一个 FILE*
+  c = find(&t, FT_LIBC_FOPEN, i, &i);
+  assert(c && c->ret != 0 && c->caller != 0);
+  assert(strcmp(c->str, "/dev/null") == 0);
+  assert(strcmp(c->str + strlen(c->str) + 1, "r") == 0);
+  uint64_t stream = c->ret;
+  c = find(&t, FT_LIBC_FCLOSE, i, &i);
+  assert(c && c->args[0] == stream && c->ret == 0);
+
+  // 失败的调用记录 errno
+  c = find(&t, FT_LIBC_FOPEN, i + 1, &i);
+  assert(c && c->ret == 0 && c->err == ENOENT);
+  assert(strcmp(c->str, MISSING_PATH) == 0);
+
+  c = find(&t, FT_LIBC_WRITE, i, &i);
+  assert(c && c->ret == 5 && c->args[2] == 5);
+  c = find(&t, FT_LIBC_READ, i, &i);
+  assert(c && c->ret == 5 && c->args[2] == 8);
+
+  // open 的可变参数 mode
+  c = find(&t, FT_LIBC_OPEN, i, &i);
+  assert(c && (int64_t)c->ret >= 0 && c->args[2] == 0600);
+  assert(strcmp(c->str, tmp_path) == 0);
+  uint64_t fd = c->ret;
+  c = find(&t, FT_LIBC_CLOSE, i, &i);
+  assert(c && c->args[0] == fd && c->ret == 0);
+
+  c = find(&t, FT_LIBC_OPEN64, i, &i);
+  assert(c && (int64_t)c->ret >= 0 && c->args[1] == O_RDONLY);
+  assert(strcmp(c->str, tmp_path) == 0);
+  c = find(&t, FT_LIBC_OPENAT, i, &i);
+  assert(c && (int64_t)c->ret >= 0 && (int)c->args[0] == AT_FDCWD);
+  assert(c->args[3] == 0640 && strcmp(c->str, tmp_path) == 0);
+
+  // fortify 版本记录缓冲区大小
+  c = find(&t, FT_LIBC_READ_CHK, i, &i);
+  assert(c && c->ret == 3 && c->args[2] == 3 && c->args[3] == 8);
+  c = find(&t, FT_LIBC_MEMCPY_CHK, i, &i);
+  assert(c && c->ret == c->args[0] && c->args[2] == 3 && c->args[3] == 8);
+
+  // 其他线程的调用在自己的 chunk 里
+  assert(count_alloc(&t, THREAD_ALLOC) && t.tid_count >= 2);
+
+  printf("all: %zu calls in %d threads ok\n", t.count, t.tid_count);
+  free(t.calls);
+}
+
+static void test_selection(const char *agent, const char *trace_path,
+                           const char *tmp_path) {
+  run(agent, "child", "fopen", trace_path, tmp_path);
+  Trace t = read_trace(trace_path);
+  // 只有两次 fopen；fopen 内部的 malloc/open 也不会出现
+  assert(t.count == 2);
+  for (size_t i = 0; i < t.count; i++)
+    assert(t.calls[i].func == FT_LIBC_FOPEN);
+  printf("selection: ok\n");
+  free(t.calls);
+}
+
+// fork 前的事件只在父进程文件里出现一次；子进程写自己的文件，
+// 用自己的 pid/tid，不带父进程残留的事件
+static void test_fork(const char *agent, const char *trace_path,
+                      const char *tmp_path) {
+  run(agent, "fork", "malloc", trace_path, tmp_path);
+  FILE *f = fopen(tmp_path, "r");
+  long child = 0;
+  assert(f && fscanf(f, "%ld", &child) == 1 && child > 0);
+  fclose(f);
+
+  Trace parent = read_trace(trace_path);
+  assert(count_alloc(&parent, BEFORE_FORK_ALLOC) == 1);
+  assert(count_alloc(&parent, THREAD_ALLOC) == 1);
+  assert(count_alloc(&parent, AFTER_FORK_ALLOC) == 0);
+
+  char child_path[96];
+  snprintf(child_path, sizeof(child_path), "%s.%ld", trace_path, child);
+  Trace t = read_trace(child_path);
+  assert(t.pid == (uint32_t)child);
+  assert(t.tid_count == 1 && t.tids[0] == (uint32_t)child);
+  assert(count_alloc(&t, AFTER_FORK_ALLOC) == 1);
+  assert(count_alloc(&t, BEFORE_FORK_ALLOC) == 0);
+  assert(count_alloc(&t, THREAD_ALLOC) == 0);
+  unlink(child_path);
+  printf("fork: parent %zu calls, child %zu calls ok\n", parent.count, t.count);
+  free(parent.calls);
+  free(t.calls);
+}
+
+int main(int argc, char **argv) {
+  if (argc == 3 && strcmp(argv[1], "child") == 0)
+    return run_workload(argv[2]);
+  if (argc == 3 && strcmp(argv[1], "fork") == 0)
+    return run_fork_workload(argv[2]);
+  assert(argc == 2);
+
+  char trace_path[] = "/tmp/libc_trace_test_XXXXXX";
+  int fd = mkstemp(trace_path);
+  assert(fd >= 0);
+  close(fd);
+  char tmp_path[64];
+  snprintf(tmp_path, sizeof(tmp_path), "%s.out", trace_path);
+
+  test_all(argv[1], trace_path, tmp_path);
+  test_selection(argv[1], trace_path, tmp_path);
+  test_fork(argv[1], trace_path, tmp_path);
+  unlink(trace_path);
+  unlink(tmp_path);
+  printf("All libc_trace tests passed!\n");
+  return 0;
+}
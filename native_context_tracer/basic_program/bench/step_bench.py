@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+"""
+步进性能基准：用 ptrace_stepper/pt_trace 按各种步进策略跟踪 basic_program 的汇编测试程序，
+报告每种组合的 steps/s（单步/自由运行掉的指令数 / 秒）和 events/s（写入日志的记录数 / 秒）。
+
+用法：
+    python3 step_bench.py --build-dir ../build --pt-trace ../../ptrace_stepper/build/pt_trace
+    python3 step_bench.py --build-dir ../build --strategies single block --repeat 5 --json out.json
+"""
+
+import argparse
+import json
+import re
+import statistics
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+
+HERE = Path(__file__).resolve().parent
+sys.path.insert(0, str(HERE.parents[1] / "ptrace_stepper"))
+from pt_step_convert import REC_BLOCK_STEP, REC_STEP, read_step_log  # noqa: E402
+
+# 策略名 -> pt_trace 参数
+STRATEGIES = {
+    "single": [],  # 逐条单步主程序，库调用用硬件断点跳过
+    "block": ["-b"],  # 直线代码运行到下一条控制流指令
+    "all-modules": ["-a"],  # 逐条单步所有模块，不跳过调用
+}
+
+# 程序名 -> 附加参数
+PROGRAMS = {
+    "branch_test": [],
+    "cond_branch_test": [],
+    "loop_test": ["5000"],
+}
+
+_STATS = re.compile(
+    r"pt_trace: (\d+) steps \((\d+) silent\), (\d+) stops, (\d+) skipped calls, (\d+) threads, ([\d.]+)s"
+)
+
+
+def run_once(pt_trace, program, args, strategy_args, log_path):
+    cmd = [str(pt_trace), *strategy_args, "-o", str(log_path), "--", str(program), *args]
+    proc = subprocess.run(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True, check=False)
+    match = _STATS.search(proc.stderr)
+    if proc.returncode != 0 or not match:
+        raise RuntimeError(f"{' '.join(cmd)} failed ({proc.returncode}): {proc.stderr.strip()}")
+    steps, silent, stops, skipped, _, seconds = match.groups()
+    log = read_step_log(log_path)
+    return {
+        "steps": int(steps),
+        "silent": int(silent),
+        "stops": int(stops),
+        "skipped_calls": int(skipped),
+        "events": len(log.records),
+        "instructions": sum(1 for rec in log.records if rec[0] in (REC_STEP, REC_BLOCK_STEP)),
+        "seconds": float(seconds),
+    }
+
+
+def bench(pt_trace, build_dir, programs, strategies, repeat):
+    results = []
+    with tempfile.TemporaryDirectory() as tmp:
+        log_path = Path(tmp) / "step.bin"
+        for name in programs:
+            program = Path(build_dir) / name
+            if not program.exists():
+                print(f"skip {name}: {program} not built", file=sys.stderr)
+                continue
+            for strategy in strategies:
+                runs = [run_once(pt_trace, program, PROGRAMS.get(name, []), STRATEGIES[strategy], log_path)
+                        for _ in range(repeat)]
+                # 取耗时中位数的一次，计数在各次之间相同
+                best = sorted(runs, key=lambda r: r["seconds"])[len(runs) // 2]
+                seconds = statistics.median(r["seconds"] for r in runs) or 1e-9
+                results.append(
+                    {
+                        "program": name,
+                        "strategy": strategy,
+                        **best,
+                        "seconds": seconds,
+                        "steps_per_s": (best["steps"] + best["silent"]) / seconds,
+                        "events_per_s": best["events"] / seconds,
+                    }
+                )
+    return results
+
+
+def print_table(results):
+    header = f"{'program':<18}{'strategy':<13}{'steps':>9}{'silent':>9}{'stops':>9}{'events':>9}" \
+             f"{'seconds':>9}{'steps/s':>11}{'events/s':>11}"  # fmt: skip
+    print(header)
+    print("-" * len(header))
+    for r in results:
+        print(
+            f"{r['program']:<18}{r['strategy']:<13}{r['steps']:>9}{r['silent']:>9}{r['stops']:>9}{r['events']:>9}"
+            f"{r['seconds']:>9.3f}{r['steps_per_s']:>11.0f}{r['events_per_s']:>11.0f}"
+        )
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description="Benchmark stepping strategies on the basic_program test corpus")
+    parser.add_argument("--build-dir", required=True, help="basic_program build directory")
+    parser.add_argument(
+        "--pt-trace", default=str(HERE.parents[1] / "ptrace_stepper" / "build" / "pt_trace"), help="pt_trace binary"
+    )
+    parser.add_argument("--programs", nargs="+", default=list(PROGRAMS), help="test programs to trace")
+    parser.add_argument("--strategies", nargs="+", default=list(STRATEGIES), choices=list(STRATEGIES))
+    parser.add_argument("--repeat", type=int, default=3, help="runs per combination, the median is reported")
+    parser.add_argument("--json", help="also write the results to this file")
+    args = parser.parse_args(argv)
+
+    if not Path(args.pt_trace).exists():
+        parser.error(f"{args.pt_trace} not found; build ptrace_stepper first")
+    results = bench(args.pt_trace, args.build_dir, args.programs, args.strategies, max(1, args.repeat))
+    print_table(results)
+    if args.json:
+        Path(args.json).write_text(json.dumps(results, indent=2), encoding="utf-8")
+    return 0 if results else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -2,7 +2,7 @@
 #include <stdio.h>
 
 int main() {
-  printf("=== Starting ARM64 Branch Instruction Tests ===\n");
+  printf("=== Starting " TEST_ARCH " Branch Instruction Tests ===\n");
   run_branch_tests();
   printf("=== Branch Tests Completed ===\n");
   return 0;
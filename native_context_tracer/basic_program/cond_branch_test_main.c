@@ -2,7 +2,7 @@
 #include <stdio.h>
 
 int main() {
-  printf("=== Starting ARM64 Conditional Branch Tests ===\n");
+  printf("=== Starting " TEST_ARCH " Conditional Branch Tests ===\n");
   run_cond_branch_tests();
   printf("=== Conditional Branch Tests Completed ===\n");
   return 0;
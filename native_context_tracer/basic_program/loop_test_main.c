@@ -0,0 +1,17 @@
+#include "test_entry_point.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// 用法：loop_test [迭代次数]，默认10000；校验和不符时返回1
+int main(int argc, char **argv) {
+  long n = argc > 1 ? strtol(argv[1], NULL, 10) : 10000;
+  if (n < 0)
+    n = 0;
+  printf("=== Starting x86-64 Loop Tests (n=%ld) ===\n", n);
+  long result = run_loop_tests(n);
+  // 计数循环 + LOOP + 访存循环 + 嵌套循环 + 循环内调用
+  long expected = n * (n + 1) / 2 + 3 * n + n * (n - 1) / 2 + (n >> 4) * 16 + n * n;
+  printf("checksum %ld, expected %ld\n", result, expected);
+  printf("=== Loop Tests Completed ===\n");
+  return result == expected ? 0 : 1;
+}
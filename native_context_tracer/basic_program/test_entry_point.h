@@ -1,8 +1,17 @@
 #ifndef TEST_ENTRY_POINT_H
 #define TEST_ENTRY_POINT_H
 
-// Declare ARM64 test functions
+#if defined(__x86_64__)
+#define TEST_ARCH "x86-64"
+#else
+#define TEST_ARCH "ARM64"
+#endif
+
+// Declare branch test functions (arm64_asm/ or x86_64_asm/, chosen by CMake)
 void run_branch_tests(void);
 void run_cond_branch_tests(void);
 
+// x86-64 only: tight loops, returns a checksum (see loop_test_main.c)
+long run_loop_tests(long n);
+
 #endif // TEST_ENTRY_POINT_H
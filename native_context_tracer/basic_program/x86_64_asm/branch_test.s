@@ -0,0 +1,193 @@
+# x86-64 无条件分支测试：直接/间接跳转、直接/间接调用、跳转表、PLT 调用和尾调用
+# 与 arm64_asm/branch_test.s 对应，GNU as（AT&T 语法），位置无关
+    .section .rodata
+msg_jmp:      .asciz "JMP instruction: jumping from 0x%lx to 0x%lx\n"
+msg_jmp_near: .asciz "JMP rel32 instruction: jumping over %d bytes to 0x%lx\n"
+msg_call:     .asciz "CALL instruction: calling func1 at 0x%lx, return=0x%lx\n"
+msg_call_reg: .asciz "CALL *reg instruction: calling func2 via register, return=0x%lx\n"
+msg_call_mem: .asciz "CALL *mem instruction: calling func3 via pointer at 0x%lx\n"
+msg_jmp_reg:  .asciz "JMP *reg instruction: jumping via register to 0x%lx\n"
+msg_table:    .asciz "JMP *table instruction: case %ld at 0x%lx\n"
+msg_plt:      .asciz "CALL printf@PLT: strlen(\"%s\") = %ld\n"
+msg_tail:     .asciz "JMP tail call: tail_caller -> tail_target, return=0x%lx\n"
+msg_tail_plt: .asciz "JMP puts@PLT tail call from tail_puts"
+msg_ret:      .asciz "RET instruction: returning from 0x%lx to 0x%lx\n"
+
+    .section .data.rel.local,"aw"
+    .align 8
+func3_ptr:    .quad func3
+
+    .text
+    .globl _run_branch_tests
+    .globl run_branch_tests
+    .type _run_branch_tests, @function
+_run_branch_tests:
+run_branch_tests:
+    push %rbp
+    mov %rsp, %rbp
+    push %rbx
+    push %r12
+
+    # Test short direct jump (JMP rel8)
+    lea msg_jmp(%rip), %rdi
+    lea .Ljmp_source(%rip), %rsi
+    lea .Ljmp_target(%rip), %rdx
+    xor %eax, %eax
+    call printf@PLT
+.Ljmp_source:
+    jmp .Ljmp_target
+    ud2
+.Ljmp_target:
+
+    # Test near direct jump (JMP rel32) over a padding block
+    lea msg_jmp_near(%rip), %rdi
+    mov $256, %esi
+    lea .Ljmp_near_target(%rip), %rdx
+    xor %eax, %eax
+    call printf@PLT
+    jmp .Ljmp_near_target
+    .fill 256, 1, 0xcc
+.Ljmp_near_target:
+
+    # Test direct call (CALL rel32)
+    call func1
+
+    # Test indirect call via register (CALL *%rax)
+    lea func2(%rip), %rax
+    call *%rax
+.Lafter_call_reg:
+
+    # Test indirect call via memory (CALL *mem)
+    call *func3_ptr(%rip)
+
+    # Test indirect jump via register (JMP *%rax)
+    lea msg_jmp_reg(%rip), %rdi
+    lea .Lafter_jmp_reg(%rip), %rsi
+    xor %eax, %eax
+    call printf@PLT
+    lea .Lafter_jmp_reg(%rip), %rax
+    jmp *%rax
+    ud2
+.Lafter_jmp_reg:
+
+    # Test jump table dispatch (switch-style JMP *%rax on relative offsets)
+    xor %ebx, %ebx
+.Ltable_loop:
+    lea .Ltable(%rip), %rdx
+    movslq (%rdx,%rbx,4), %rax
+    add %rdx, %rax
+    jmp *%rax
+.Lcase0:
+.Lcase1:
+.Lcase2:
+.Lcase3:
+    lea msg_table(%rip), %rdi
+    mov %rbx, %rsi
+    mov %rax, %rdx
+    xor %eax, %eax
+    call printf@PLT
+    inc %rbx
+    cmp $4, %rbx
+    jb .Ltable_loop
+
+    # Test calls through the PLT into libc
+    lea msg_tail_plt(%rip), %r12
+    mov %r12, %rdi
+    call strlen@PLT
+    lea msg_plt(%rip), %rdi
+    mov %r12, %rsi
+    mov %rax, %rdx
+    xor %eax, %eax
+    call printf@PLT
+
+    # Test tail calls: local (JMP to function) and through the PLT
+    call tail_caller
+    call tail_puts
+
+    pop %r12
+    pop %rbx
+    xor %eax, %eax
+    pop %rbp
+    ret
+    .size _run_branch_tests, .-_run_branch_tests
+
+    .section .rodata
+    .align 4
+.Ltable:
+    .long .Lcase0-.Ltable
+    .long .Lcase1-.Ltable
+    .long .Lcase2-.Ltable
+    .long .Lcase3-.Ltable
+
+    .text
+    .type func1, @function
+func1:
+    push %rbp
+    mov %rsp, %rbp
+    lea msg_call(%rip), %rdi
+    lea func1(%rip), %rsi
+    mov 8(%rbp), %rdx
+    xor %eax, %eax
+    call printf@PLT
+    pop %rbp
+    ret
+    .size func1, .-func1
+
+    .type func2, @function
+func2:
+    push %rbp
+    mov %rsp, %rbp
+    lea msg_call_reg(%rip), %rdi
+    mov 8(%rbp), %rsi
+    xor %eax, %eax
+    call printf@PLT
+    pop %rbp
+    ret
+    .size func2, .-func2
+
+    .type func3, @function
+func3:
+    push %rbp
+    mov %rsp, %rbp
+    lea msg_call_mem(%rip), %rdi
+    lea func3_ptr(%rip), %rsi
+    xor %eax, %eax
+    call printf@PLT
+    lea msg_ret(%rip), %rdi
+    lea func3(%rip), %rsi
+    mov 8(%rbp), %rdx
+    xor %eax, %eax
+    call printf@PLT
+    pop %rbp
+    ret
+    .size func3, .-func3
+
+    # 尾调用：帧拆除后直接跳到目标，目标的 RET 返回到 tail_caller 的调用者
+    .type tail_caller, @function
+tail_caller:
+    push %rbp
+    mov %rsp, %rbp
+    mov 8(%rbp), %rdi
+    pop %rbp
+    jmp tail_target
+    .size tail_caller, .-tail_caller
+
+    .type tail_target, @function
+tail_target:
+    push %rbp
+    mov %rsp, %rbp
+    mov %rdi, %rsi
+    lea msg_tail(%rip), %rdi
+    xor %eax, %eax
+    call printf@PLT
+    pop %rbp
+    ret
+    .size tail_target, .-tail_target
+
+    .type tail_puts, @function
+tail_puts:
+    lea msg_tail_plt(%rip), %rdi
+    jmp puts@PLT
+    .size tail_puts, .-tail_puts
+
+    .section .note.GNU-stack,"",@progbits
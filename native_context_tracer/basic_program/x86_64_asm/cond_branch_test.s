@@ -0,0 +1,150 @@
+# x86-64 条件分支测试：全部 Jcc 条件码（满足与不满足）、JRCXZ、LOOP/LOOPE/LOOPNE，
+# 以及不产生分支的 CMOVcc / SETcc。与 arm64_asm/cond_branch_test.s 对应
+    .section .rodata
+msg_cond:   .asciz "Testing %s condition...\n"
+msg_jump:   .asciz "Condition %s met, jumping\n"
+msg_nojump: .asciz "Condition %s not met, continuing\n"
+msg_loop:   .asciz "%s executed %ld iterations\n"
+msg_cmov:   .asciz "CMOV/SETcc results: cmovl=%ld setg=%ld\n"
+e_str:      .asciz "E"
+ne_str:     .asciz "NE"
+g_str:      .asciz "G"
+l_str:      .asciz "L"
+ge_str:     .asciz "GE"
+le_str:     .asciz "LE"
+a_str:      .asciz "A"
+b_str:      .asciz "B"
+ae_str:     .asciz "AE"
+be_str:     .asciz "BE"
+s_str:      .asciz "S"
+ns_str:     .asciz "NS"
+o_str:      .asciz "O"
+no_str:     .asciz "NO"
+p_str:      .asciz "P"
+np_str:     .asciz "NP"
+jrcxz_str:  .asciz "JRCXZ"
+loop_str:   .asciz "LOOP"
+loope_str:  .asciz "LOOPE"
+loopne_str: .asciz "LOOPNE"
+    .align 8
+loope_data: .quad 0, 0, 0, 5, 0, 0
+
+# 打印条件名，以 "mov $a, reg; op $b, reg" 设置标志位，然后 j\cc；
+# 跳转与否各打印一行，两条路径在 2: 汇合
+.macro COND_TEST cc, name, reg, a, op, b
+    lea msg_cond(%rip), %rdi
+    lea \name(%rip), %rsi
+    xor %eax, %eax
+    call printf@PLT
+    mov $\a, \reg
+    \op $\b, \reg
+    j\cc 1f
+    lea msg_nojump(%rip), %rdi
+    jmp 2f
+1:  lea msg_jump(%rip), %rdi
+2:  lea \name(%rip), %rsi
+    xor %eax, %eax
+    call printf@PLT
+.endm
+
+    .text
+    .globl _run_cond_branch_tests
+    .globl run_cond_branch_tests
+    .type _run_cond_branch_tests, @function
+_run_cond_branch_tests:
+run_cond_branch_tests:
+    push %rbp
+    mov %rsp, %rbp
+    push %rbx
+    push %r12
+
+    # 有符号与相等比较：满足
+    COND_TEST e, e_str, %eax, 1, cmp, 1
+    COND_TEST ne, ne_str, %eax, 1, cmp, 2
+    COND_TEST g, g_str, %eax, 5, cmp, 3
+    COND_TEST l, l_str, %eax, -5, cmp, 3
+    COND_TEST ge, ge_str, %eax, 3, cmp, 3
+    COND_TEST le, le_str, %eax, -3, cmp, -3
+    # 无符号比较：-5 视为很大的无符号数
+    COND_TEST a, a_str, %eax, -5, cmp, 3
+    COND_TEST b, b_str, %eax, 3, cmp, -5
+    COND_TEST ae, ae_str, %eax, 3, cmp, 3
+    COND_TEST be, be_str, %eax, 2, cmp, 3
+    # 符号、溢出、奇偶标志
+    COND_TEST s, s_str, %eax, 1, sub, 2
+    COND_TEST ns, ns_str, %eax, 2, sub, 1
+    COND_TEST o, o_str, %eax, 0x7fffffff, add, 1
+    COND_TEST no, no_str, %eax, 1, add, 1
+    COND_TEST p, p_str, %eax, 3, and, 3
+    COND_TEST np, np_str, %eax, 1, and, 1
+
+    # 不满足的条件：顺序执行到下一条
+    COND_TEST e, e_str, %eax, 1, cmp, 2
+    COND_TEST g, g_str, %eax, -5, cmp, 3
+    COND_TEST a, a_str, %eax, 3, cmp, -5
+    COND_TEST o, o_str, %eax, 1, add, 1
+
+    # JRCXZ：rcx 为0时跳转
+    COND_TEST rcxz, jrcxz_str, %ecx, 0, or, 0
+    COND_TEST rcxz, jrcxz_str, %ecx, 1, or, 0
+
+    # LOOP：rcx 递减到0为止
+    mov $5, %ecx
+    xor %ebx, %ebx
+.Lloop:
+    inc %rbx
+    loop .Lloop
+    lea msg_loop(%rip), %rdi
+    lea loop_str(%rip), %rsi
+    mov %rbx, %rdx
+    xor %eax, %eax
+    call printf@PLT
+
+    # LOOPE：ZF=1 且 rcx 非0时继续；扫描数组，遇到非0元素时 ZF 变为0
+    mov $6, %ecx
+    xor %ebx, %ebx
+    lea loope_data(%rip), %rdx
+.Lloope:
+    cmpq $0, (%rdx,%rbx,8)
+    lea 1(%rbx), %rbx
+    loope .Lloope
+    lea msg_loop(%rip), %rdi
+    lea loope_str(%rip), %rsi
+    mov %rbx, %rdx
+    xor %eax, %eax
+    call printf@PLT
+
+    # LOOPNE：ZF=0 且 rcx 非0时继续，rbx 到4时 ZF 变为1
+    mov $10, %ecx
+    xor %ebx, %ebx
+.Lloopne:
+    inc %rbx
+    cmp $4, %rbx
+    loopne .Lloopne
+    lea msg_loop(%rip), %rdi
+    lea loopne_str(%rip), %rsi
+    mov %rbx, %rdx
+    xor %eax, %eax
+    call printf@PLT
+
+    # CMOVcc / SETcc：条件执行但不分支
+    mov $7, %ebx
+    mov $9, %r12d
+    cmp %r12, %rbx
+    cmovl %r12, %rbx
+    xor %edx, %edx
+    cmp $1, %r12
+    setg %dl
+    lea msg_cmov(%rip), %rdi
+    mov %rbx, %rsi
+    xor %eax, %eax
+    call printf@PLT
+
+    pop %r12
+    pop %rbx
+    xor %eax, %eax
+    pop %rbp
+    ret
+    .size _run_cond_branch_tests, .-_run_cond_branch_tests
+
+    .section .note.GNU-stack,"",@progbits
@@ -0,0 +1,107 @@
+# x86-64 紧凑循环测试：单步跟踪中每次迭代的分支与访存开销最集中的代码形态，
+# 也用作步进性能基准的负载。返回各循环结果的校验和，由调用者核对
+#   long run_loop_tests(long n)
+    .text
+    .globl _run_loop_tests
+    .globl run_loop_tests
+    .type _run_loop_tests, @function
+_run_loop_tests:
+run_loop_tests:
+    push %rbp
+    mov %rsp, %rbp
+    push %rbx
+    push %r12
+    push %r13
+    push %r14
+    sub $64, %rsp
+    mov %rdi, %r12          # n
+    xor %r13d, %r13d        # 校验和
+
+    # 1. 计数循环：sum(1..n)，DEC/JNZ
+    xor %eax, %eax
+    mov %r12, %rcx
+    test %rcx, %rcx
+    jz 2f
+1:  add %rcx, %rax
+    dec %rcx
+    jnz 1b
+2:  add %rax, %r13
+
+    # 2. LOOP 指令：累加 n 次 3
+    xor %eax, %eax
+    mov %r12, %rcx
+    jrcxz 2f
+1:  add $3, %rax
+    loop 1b
+2:  add %rax, %r13
+
+    # 3. 带访存的循环：在栈上的8个槽中轮流累加，i & 7 选槽
+    xor %eax, %eax
+    mov %rax, 0(%rsp)
+    mov %rax, 8(%rsp)
+    mov %rax, 16(%rsp)
+    mov %rax, 24(%rsp)
+    mov %rax, 32(%rsp)
+    mov %rax, 40(%rsp)
+    mov %rax, 48(%rsp)
+    mov %rax, 56(%rsp)
+    xor %ecx, %ecx
+    jmp 2f
+1:  mov %rcx, %rdx
+    and $7, %rdx
+    add %rcx, (%rsp,%rdx,8)
+    inc %rcx
+2:  cmp %r12, %rcx
+    jl 1b
+    xor %ecx, %ecx
+3:  add (%rsp,%rcx,8), %r13
+    inc %rcx
+    cmp $8, %rcx
+    jb 3b
+
+    # 4. 嵌套循环：外层 n/16 次，内层16次
+    mov %r12, %r14
+    shr $4, %r14
+    xor %ebx, %ebx
+    xor %eax, %eax
+    jmp 4f
+1:  xor %ecx, %ecx
+2:  inc %rax
+    inc %rcx
+    cmp $16, %rcx
+    jb 2b
+    inc %rbx
+4:  cmp %r14, %rbx
+    jb 1b
+    add %rax, %r13
+
+    # 5. 循环内调用叶子函数：每次迭代一对 CALL/RET
+    xor %ebx, %ebx
+    xor %r14d, %r14d
+    jmp 2f
+1:  mov %rbx, %rdi
+    call loop_leaf
+    add %rax, %r14
+    inc %rbx
+2:  cmp %r12, %rbx
+    jl 1b
+    add %r14, %r13
+
+    mov %r13, %rax
+    add $64, %rsp
+    pop %r14
+    pop %r13
+    pop %r12
+    pop %rbx
+    pop %rbp
+    ret
+    .size _run_loop_tests, .-_run_loop_tests
+
+    # 返回 2*x + 1
+    .type loop_leaf, @function
+loop_leaf:
+    lea 1(%rdi,%rdi), %rax
+    ret
+    .size loop_leaf, .-loop_leaf
+
+    .section .note.GNU-stack,"",@progbits
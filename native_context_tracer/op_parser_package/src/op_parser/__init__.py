@@ -3,12 +3,23 @@ OP Parser package - ARM instruction operand parser with C extensions.
 """
 
 from .op_parser import (
+    BasicBlock,
     DisasmLine,
+    InsnRegisters,
+    LineEntry,
+    LineTable,
     Operand,
     OperandType,
+    Symbol,
+    SymbolizedLine,
+    SymbolTable,
+    analyze_registers,
+    get_scan_kernel,
+    instruction_registers,
     parse_disassembly,
     parse_disassembly_line,
     parse_operands,
+    set_scan_kernel,
 )
 
 __version__ = "0.1.0"
@@ -19,4 +30,15 @@ __all__ = [
     "parse_operands",
     "parse_disassembly_line",
     "parse_disassembly",
+    "get_scan_kernel",
+    "set_scan_kernel",
+    "InsnRegisters",
+    "BasicBlock",
+    "instruction_registers",
+    "analyze_registers",
+    "Symbol",
+    "SymbolizedLine",
+    "SymbolTable",
+    "LineEntry",
+    "LineTable",
 ]
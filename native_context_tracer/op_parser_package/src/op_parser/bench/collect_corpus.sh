@@ -0,0 +1,38 @@
+#!/bin/bash
+# 用LLDB导出 basic_program、so1-so4 和 libc 的完整反汇编，作为基准测试语料
+# 用法: bench/collect_corpus.sh <basic_program构建目录> [输出目录]
+set -e
+
+BUILD_DIR=${1:?"usage: $0 <basic_program build dir> [output dir]"}
+OUT_DIR=${2:-$(dirname "$0")/corpus}
+mkdir -p "$OUT_DIR"
+
+dump_module() {
+    local target=$1
+    local module=$2
+    local name=$3
+    lldb --batch \
+        -o "target create \"$target\"" \
+        -o "b main" \
+        -o "run" \
+        -o "image dump symtab $module" \
+        -o "script import lldb; m = lldb.target.module['$module']; [lldb.debugger.HandleCommand('disassemble -s 0x%x -e 0x%x' % (s.GetStartAddress().GetLoadAddress(lldb.target), s.GetEndAddress().GetLoadAddress(lldb.target))) for s in m if s.GetType() == lldb.eSymbolTypeCode and s.GetEndAddress().IsValid()]" \
+        -o "kill" \
+        2>/dev/null | grep -E '^(->)? +0x[0-9a-f]+ ' > "$OUT_DIR/$name.txt" || true
+    echo "$OUT_DIR/$name.txt: $(wc -l < "$OUT_DIR/$name.txt") lines"
+}
+
+PROGRAM="$BUILD_DIR/basic_program"
+dump_module "$PROGRAM" basic_program basic_program
+for so in so1 so2 so3 so4; do
+    for ext in so dylib; do
+        if [ -f "$BUILD_DIR/lib$so.$ext" ]; then
+            dump_module "$PROGRAM" "lib$so.$ext" "$so"
+        fi
+    done
+done
+if [ "$(uname)" = "Darwin" ]; then
+    dump_module "$PROGRAM" libsystem_c.dylib libc
+else
+    dump_module "$PROGRAM" libc.so.6 libc
+fi
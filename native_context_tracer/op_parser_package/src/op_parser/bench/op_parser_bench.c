@@ -0,0 +1,210 @@
+// op_parser 吞吐量基准
+// 用法: op_parser_bench [-iterations=N] [corpus.txt ...]
+// 语料可用 bench/collect_corpus.sh 从 basic_program/so1-so4/libc 的LLDB反汇编生成，
+// 未指定语料时使用内置样本合成约20万行的文本。
+#define _POSIX_C_SOURCE 200809L
+#include "op_parser.h"
+#include "op_scan.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+  char *text;
+  size_t size;
+  int lines;
+} Corpus;
+
+static const char *sample_lines[] = {
+    "    0x100001240 <+0>:   sub    sp, sp, #0x90",
+    "    0x100001244 <+4>:   stp    x29, x30, [sp, #0x80]",
+    "    0x100001248 <+8>:   add    x29, sp, #0x80",
+    "    0x10000124c <+12>:  stur   wzr, [x29, #-0x4]",
+    "    0x100001250 <+16>:  ldr    x17, [x17, x16, lsl #3]",
+    "->  0x100001254 <+20>:  bl     0x100001300 ; so2_plt_function",
+    "    0x100001258 <+24>:  b.ne   0x100001240 ; <+0> at basic_main.c:12",
+    "    0x10000125c <+28>:  cbz    w0, 0x100001270",
+    "    0x100001260 <+32>:  ldp    x29, x30, [sp], #0x10",
+    "    0x100001264 <+36>:  ret",
+};
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int count_lines(const char *text, size_t size) {
+  int lines = 0;
+  for (size_t i = 0; i < size; i++)
+    lines += text[i] == '\n';
+  return lines + (size > 0 && text[size - 1] != '\n');
+}
+
+static int load_corpus(Corpus *corpus, int argc, char **argv, int first) {
+  size_t cap = 1 << 20;
+  corpus->text = malloc(cap);
+  corpus->size = 0;
+
+  for (int i = first; i < argc; i++) {
+    FILE *f = fopen(argv[i], "rb");
+    if (f == NULL) {
+      fprintf(stderr, "cannot open %s\n", argv[i]);
+      return 0;
+    }
+    char chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+      while (corpus->size + n + 1 > cap) {
+        cap *= 2;
+        corpus->text = realloc(corpus->text, cap);
+      }
+      memcpy(corpus->text + corpus->size, chunk, n);
+      corpus->size += n;
+    }
+    fclose(f);
+  }
+
+  if (corpus->size == 0) {
+    size_t n_samples = sizeof(sample_lines) / sizeof(sample_lines[0]);
+    for (int i = 0; i < 200000; i++) {
+      const char *line = sample_lines[i % n_samples];
+      size_t len = strlen(line);
+      while (corpus->size + len + 2 > cap) {
+        cap *= 2;
+        corpus->text = realloc(corpus->text, cap);
+      }
+      memcpy(corpus->text + corpus->size, line, len);
+      corpus->size += len;
+      corpus->text[corpus->size++] = '\n';
+    }
+  }
+  corpus->text[corpus->size] = '\0';
+  corpus->lines = count_lines(corpus->text, corpus->size);
+  return 1;
+}
+
+static void report(const char *api, const char *kernel, double seconds,
+                   long lines, size_t bytes) {
+  printf("%-24s %-7s %10.3f ms %14.0f lines/s %10.1f MB/s\n", api, kernel,
+         seconds * 1e3, (double)lines / seconds,
+         (double)bytes / seconds / (1024.0 * 1024.0));
+}
+
+static void bench_newline(const Corpus *corpus, int iterations,
+                          const char *kernel) {
+  long lines = 0;
+  double start = now_seconds();
+  for (int it = 0; it < iterations; it++) {
+    const char *p = corpus->text;
+    const char *end = corpus->text + corpus->size;
+    while (p < end) {
+      p = op_scan_newline(p, end) + 1;
+      lines++;
+    }
+  }
+  report("op_scan_newline", kernel, now_seconds() - start, lines,
+         corpus->size * iterations);
+}
+
+static void bench_parse_disassembly(const Corpus *corpus, int iterations,
+                                    const char *kernel) {
+  DisasmLine *out = malloc(sizeof(DisasmLine) * (size_t)corpus->lines);
+  long lines = 0;
+  double start = now_seconds();
+  for (int it = 0; it < iterations; it++)
+    lines += parse_disassembly(corpus->text, out, corpus->lines);
+  report("parse_disassembly", kernel, now_seconds() - start, lines,
+         corpus->size * iterations);
+  free(out);
+}
+
+static void bench_parse_line(const Corpus *corpus, int iterations,
+                             const char *kernel) {
+  DisasmLine out;
+  char line[256];
+  long lines = 0;
+  double start = now_seconds();
+  for (int it = 0; it < iterations; it++) {
+    const char *p = corpus->text;
+    const char *end = corpus->text + corpus->size;
+    while (p < end) {
+      const char *nl = op_scan_newline(p, end);
+      size_t len = (size_t)(nl - p);
+      if (len > sizeof(line) - 1)
+        len = sizeof(line) - 1;
+      memcpy(line, p, len);
+      line[len] = '\0';
+      lines += parse_disassembly_line(line, &out);
+      p = nl + 1;
+    }
+  }
+  report("parse_disassembly_line", kernel, now_seconds() - start, lines,
+         corpus->size * iterations);
+}
+
+static void bench_parse_operands(const Corpus *corpus, int iterations,
+                                 const char *kernel) {
+  Operand ops[4];
+  char line[256];
+  long lines = 0;
+  size_t bytes = 0;
+  double start = now_seconds();
+  for (int it = 0; it < iterations; it++) {
+    const char *p = corpus->text;
+    const char *end = corpus->text + corpus->size;
+    while (p < end) {
+      const char *nl = op_scan_newline(p, end);
+      // 操作数从 ':' 之后的第二个字段开始
+      const char *colon = memchr(p, ':', (size_t)(nl - p));
+      const char *q = colon ? colon + 1 : p;
+      while (q < nl && (*q == ' ' || *q == '\t'))
+        q++;
+      while (q < nl && *q != ' ' && *q != '\t')
+        q++;
+      size_t len = (size_t)(nl - q);
+      if (len > sizeof(line) - 1)
+        len = sizeof(line) - 1;
+      memcpy(line, q, len);
+      line[len] = '\0';
+      parse_operands(line, ops, 4);
+      bytes += len;
+      lines++;
+      p = nl + 1;
+    }
+  }
+  report("parse_operands", kernel, now_seconds() - start, lines, bytes);
+}
+
+int main(int argc, char **argv) {
+  int iterations = 5;
+  int first = 1;
+  if (argc > 1 && strncmp(argv[1], "-iterations=", 12) == 0) {
+    iterations = atoi(argv[1] + 12);
+    first = 2;
+  }
+
+  Corpus corpus;
+  if (!load_corpus(&corpus, argc, argv, first))
+    return 1;
+  printf("corpus: %d lines, %zu bytes, %d iteration(s)\n", corpus.lines,
+         corpus.size, iterations);
+
+  static const OpScanKernel kernels[] = {
+      OP_SCAN_KERNEL_SCALAR, OP_SCAN_KERNEL_SSE2, OP_SCAN_KERNEL_AVX2,
+      OP_SCAN_KERNEL_NEON};
+  for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+    if (!op_scan_set_kernel(kernels[k]))
+      continue;
+    const char *name = op_scan_kernel_name(kernels[k]);
+    bench_newline(&corpus, iterations, name);
+    bench_parse_disassembly(&corpus, iterations, name);
+    bench_parse_line(&corpus, iterations, name);
+    bench_parse_operands(&corpus, iterations, name);
+  }
+
+  free(corpus.text);
+  return 0;
+}
@@ -0,0 +1,134 @@
+// 不依赖libFuzzer的回放驱动：回放语料文件/目录，并可基于语料做随机变异。
+// gcc 构建和 ctest 使用它；clang 下 OP_PARSER_BUILD_FUZZ=ON 会构建真正的
+// libFuzzer 目标 op_parser_fuzz。
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+#define MAX_SEEDS 256
+#define FUZZ_MAX_INPUT 4096
+
+static char *seeds[MAX_SEEDS];
+static size_t seed_sizes[MAX_SEEDS];
+static int seed_count = 0;
+
+static void run_file(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) {
+    fprintf(stderr, "cannot open %s\n", path);
+    exit(1);
+  }
+  char *buf = malloc(FUZZ_MAX_INPUT);
+  size_t size = fread(buf, 1, FUZZ_MAX_INPUT, f);
+  fclose(f);
+
+  LLVMFuzzerTestOneInput((const uint8_t *)buf, size);
+  if (seed_count < MAX_SEEDS) {
+    seeds[seed_count] = buf;
+    seed_sizes[seed_count] = size;
+    seed_count++;
+  } else {
+    free(buf);
+  }
+}
+
+static void run_path(const char *path) {
+  struct stat st;
+  if (stat(path, &st) != 0) {
+    fprintf(stderr, "cannot stat %s\n", path);
+    exit(1);
+  }
+  if (!S_ISDIR(st.st_mode)) {
+    run_file(path);
+    return;
+  }
+  DIR *dir = opendir(path);
+  struct dirent *entry;
+  while (dir && (entry = readdir(dir)) != NULL) {
+    if (entry->d_name[0] == '.')
+      continue;
+    char child[1024];
+    snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+    run_path(child);
+  }
+  if (dir)
+    closedir(dir);
+}
+
+// 变异时偏向反汇编里的结构字符，更容易走到各个状态
+static char random_byte(unsigned *rng) {
+  static const char alphabet[] = "0x1f9 <+->:[],#;\nlsrawdpxzbc";
+  unsigned r = rand_r(rng);
+  if (r % 8 == 0)
+    return (char)(r >> 8);
+  return alphabet[(r >> 3) % (sizeof(alphabet) - 1)];
+}
+
+static void run_mutations(long runs) {
+  static char buf[FUZZ_MAX_INPUT * 2];
+  unsigned rng = 0x5eed;
+  for (long i = 0; i < runs; i++) {
+    size_t size = 0;
+    if (seed_count > 0) {
+      int s = rand_r(&rng) % seed_count;
+      size = seed_sizes[s];
+      memcpy(buf, seeds[s], size);
+    }
+    int edits = 1 + rand_r(&rng) % 8;
+    for (int e = 0; e < edits; e++) {
+      size_t pos = size ? (size_t)rand_r(&rng) % (size + 1) : 0;
+      switch (rand_r(&rng) % 4) {
+      case 0: // 替换
+        if (pos < size)
+          buf[pos] = random_byte(&rng);
+        break;
+      case 1: // 插入
+        if (size < sizeof(buf)) {
+          memmove(buf + pos + 1, buf + pos, size - pos);
+          buf[pos] = random_byte(&rng);
+          size++;
+        }
+        break;
+      case 2: // 删除
+        if (pos < size) {
+          memmove(buf + pos, buf + pos + 1, size - pos - 1);
+          size--;
+        }
+        break;
+      default: { // 重复一段，制造超长字段
+        size_t len = 1 + (size_t)rand_r(&rng) % 64;
+        for (int rep = 0; rep < 8 && size + len <= sizeof(buf) && pos < size;
+             rep++) {
+          if (pos + len > size)
+            len = size - pos;
+          memmove(buf + pos + len, buf + pos, size - pos);
+          size += len;
+        }
+        break;
+      }
+      }
+    }
+    LLVMFuzzerTestOneInput((const uint8_t *)buf, size);
+  }
+}
+
+int main(int argc, char **argv) {
+  long runs = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "-runs=", 6) == 0) {
+      runs = atol(argv[i] + 6);
+      continue;
+    }
+    run_path(argv[i]);
+  }
+  run_mutations(runs);
+  printf("replayed %d seed(s), %ld mutation(s): ok\n", seed_count, runs);
+  for (int i = 0; i < seed_count; i++)
+    free(seeds[i]);
+  return 0;
+}
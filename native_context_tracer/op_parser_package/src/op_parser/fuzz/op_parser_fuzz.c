@@ -0,0 +1,85 @@
+#include "op_parser.h"
+#include "op_scan.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 参考状态机（由 fuzz/reference_names.h 改名后编译的 op_parser.c）
+int ref_parse_operands(const char *str, Operand *ops, int max_ops);
+int ref_parse_disassembly_line(const char *line, DisasmLine *disasm_line);
+int ref_parse_disassembly(const char *disassembly, DisasmLine *lines,
+                          int max_lines);
+
+#define FUZZ_MAX_LINES 64
+
+static void fail(const char *what) {
+  fprintf(stderr, "op_parser_fuzz: mismatch in %s\n", what);
+  abort();
+}
+
+static void check_scan_kernels(const char *text, size_t len) {
+  static const OpScanKernel kernels[] = {
+      OP_SCAN_KERNEL_SSE2, OP_SCAN_KERNEL_AVX2, OP_SCAN_KERNEL_NEON};
+  uint16_t ref_off[256], off[256];
+  uint8_t ref_kind[256], kind[256];
+  size_t window = len > UINT16_MAX ? UINT16_MAX : len;
+
+  OpScanKernel saved = op_scan_get_kernel();
+  op_scan_set_kernel(OP_SCAN_KERNEL_SCALAR);
+  const char *ref_nl = op_scan_newline(text, text + len);
+  size_t ref_n = op_scan_delims(text, window, ref_off, ref_kind, 256);
+
+  for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+    if (!op_scan_set_kernel(kernels[k]))
+      continue;
+    if (op_scan_newline(text, text + len) != ref_nl)
+      fail("op_scan_newline");
+    size_t n = op_scan_delims(text, window, off, kind, 256);
+    if (n != ref_n || memcmp(off, ref_off, n * sizeof(off[0])) != 0 ||
+        memcmp(kind, ref_kind, n) != 0)
+      fail("op_scan_delims");
+  }
+  op_scan_set_kernel(saved);
+}
+
+static void check_parsers(const char *text) {
+  static DisasmLine fast[FUZZ_MAX_LINES], ref[FUZZ_MAX_LINES];
+  memset(fast, 0, sizeof(fast));
+  memset(ref, 0, sizeof(ref));
+
+  int n_fast = parse_disassembly(text, fast, FUZZ_MAX_LINES);
+  int n_ref = ref_parse_disassembly(text, ref, FUZZ_MAX_LINES);
+  if (n_fast != n_ref || memcmp(fast, ref, sizeof(DisasmLine) * n_fast) != 0)
+    fail("parse_disassembly");
+
+  DisasmLine line_fast, line_ref;
+  int r_fast = parse_disassembly_line(text, &line_fast);
+  int r_ref = ref_parse_disassembly_line(text, &line_ref);
+  if (r_fast != r_ref ||
+      (r_fast && memcmp(&line_fast, &line_ref, sizeof(DisasmLine)) != 0))
+    fail("parse_disassembly_line");
+
+  Operand ops_fast[4], ops_ref[4];
+  memset(ops_fast, 0, sizeof(ops_fast));
+  memset(ops_ref, 0, sizeof(ops_ref));
+  int c_fast = parse_operands(text, ops_fast, 4);
+  int c_ref = ref_parse_operands(text, ops_ref, 4);
+  if (c_fast != c_ref || memcmp(ops_fast, ops_ref, sizeof(ops_fast)) != 0)
+    fail("parse_operands");
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  // 拷贝成刚好 size+1 字节的堆内存，越界读能被ASan捕获
+  char *text = malloc(size + 1);
+  if (text == NULL)
+    return 0;
+  memcpy(text, data, size);
+  text[size] = '\0';
+
+  check_scan_kernels(text, size);
+  check_parsers(text);
+
+  free(text);
+  return 0;
+}
@@ -0,0 +1,12 @@
+#ifndef OP_PARSER_REFERENCE_NAMES_H
+#define OP_PARSER_REFERENCE_NAMES_H
+
+// 以 -include 方式注入，把 op_parser.c 的导出符号改名，
+// 与快速路径版本链接进同一个模糊测试程序
+#define OP_PARSER_REFERENCE 1
+#define operand_type_to_str ref_operand_type_to_str
+#define parse_operands ref_parse_operands
+#define parse_disassembly_line ref_parse_disassembly_line
+#define parse_disassembly ref_parse_disassembly
+
+#endif // OP_PARSER_REFERENCE_NAMES_H
@@ -0,0 +1,49 @@
+#ifndef OP_ELF_H
+#define OP_ELF_H
+
+// ELF64 只读映射的内部辅助函数，op_symtab 和 op_lines 共用
+// 所有偏移在访问前都做越界检查，畸形文件只会导致加载失败
+
+#if defined(__has_include)
+#if __has_include(<elf.h>)
+#define OP_HAVE_ELF 1
+#endif
+#endif
+
+#ifdef OP_HAVE_ELF
+#include <elf.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+  const uint8_t *data;
+  size_t size;
+  const Elf64_Ehdr *ehdr;
+  const Elf64_Shdr *shdrs;
+  const char *shstrtab;
+  size_t shstrtab_size;
+  int mapped; // 由 op_elf_map 映射，需要 op_elf_unmap
+} OpElfFile;
+
+// 映射并校验文件，成功返回1
+int op_elf_map(OpElfFile *elf, const char *path);
+void op_elf_unmap(OpElfFile *elf);
+
+// 校验内存中的ELF镜像（不接管内存）
+int op_elf_open(OpElfFile *elf, const uint8_t *data, size_t size);
+
+int op_elf_in_file(const OpElfFile *elf, uint64_t off, uint64_t len);
+// 按结构体访问的表（节头、符号、重定位）还要求8字节对齐
+int op_elf_table_in_file(const OpElfFile *elf, uint64_t off, uint64_t len);
+
+const Elf64_Shdr *op_elf_section(const OpElfFile *elf, const char *name);
+
+// 节内容，NOBITS/越界/压缩节返回 NULL
+const uint8_t *op_elf_section_data(const OpElfFile *elf, const Elf64_Shdr *sec,
+                                   size_t *size);
+
+// .note.gnu.build-id 的内容，返回长度，没有时返回0
+size_t op_elf_build_id(const OpElfFile *elf, uint8_t *out, size_t max);
+#endif
+
+#endif
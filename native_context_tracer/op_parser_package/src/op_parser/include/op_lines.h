@@ -0,0 +1,46 @@
+#ifndef OP_LINES_H
+#define OP_LINES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// DWARF 2-5 .debug_line 读取器
+// 把行号程序展开成按地址排序的 (file, line, column) 表，并以 build-id 为键
+// 持久化成可直接 mmap 的缓存文件，查找只是一次二分
+
+enum {
+  OP_LINE_IS_STMT = 1 << 0,
+  OP_LINE_END_SEQUENCE = 1 << 1, // 序列结束，地址是最后一条指令之后
+  OP_LINE_PROLOGUE_END = 1 << 2
+};
+
+typedef struct {
+  uint64_t addr; // 文件中的虚拟地址，运行时地址需减去加载偏移
+  uint32_t file; // op_lines_file 的下标，文件编号无效时为 UINT32_MAX
+  uint32_t line;
+  uint32_t column;
+  uint32_t flags;
+} OpLineRow;
+
+typedef struct OpLineTable OpLineTable;
+
+// 打开 ELF 的行号表。cache_dir 非空且文件有 build-id 时先尝试
+// <cache_dir>/<build-id>.oplines，没有或无效则解析 .debug_line 并写回缓存。
+// 没有 .debug_line（或只有压缩的调试节）时返回 NULL
+OpLineTable *op_lines_open(const char *elf_path, const char *cache_dir);
+void op_lines_close(OpLineTable *table);
+
+size_t op_lines_count(const OpLineTable *table);
+const OpLineRow *op_lines_row(const OpLineTable *table, size_t index);
+size_t op_lines_file_count(const OpLineTable *table);
+const char *op_lines_file(const OpLineTable *table, uint32_t file);
+
+// 包含 addr 的行，找不到（不在任何序列内）返回 -1
+long op_lines_lookup(const OpLineTable *table, uint64_t addr);
+
+// 十六进制 build-id，没有时为空串
+const char *op_lines_build_id(const OpLineTable *table);
+// 是否由缓存文件映射而来
+int op_lines_from_cache(const OpLineTable *table);
+
+#endif
@@ -57,4 +57,117 @@ const char *operand_type_to_str(OperandType type);
 int parse_operands(const char *str, Operand *ops, int max_ops);
 int parse_disassembly_line(const char *line, DisasmLine *disasm_line);
 int parse_disassembly(const char *disassembly, DisasmLine *lines,
-                      int max_lines);
\ No newline at end of file
+                      int max_lines);
+
+typedef enum {
+  OP_SCAN_KERNEL_SCALAR,
+  OP_SCAN_KERNEL_SSE2,
+  OP_SCAN_KERNEL_AVX2,
+  OP_SCAN_KERNEL_NEON
+} OpScanKernel;
+
+OpScanKernel op_scan_get_kernel(void);
+int op_scan_set_kernel(OpScanKernel kernel);
+const char *op_scan_kernel_name(OpScanKernel kernel);
+
+typedef struct {
+  uint64_t bits[2];
+} OpRegSet;
+
+typedef struct {
+  OpRegSet defs;
+  OpRegSet uses;
+  OpRegSet live_out;
+  OpRegSet read_after;
+  int block;
+} OpInsnRegs;
+
+typedef enum {
+  OP_BLOCK_FALLTHROUGH,
+  OP_BLOCK_BRANCH,
+  OP_BLOCK_COND_BRANCH,
+  OP_BLOCK_INDIRECT,
+  OP_BLOCK_RETURN,
+  OP_BLOCK_EXIT
+} OpBlockEnd;
+
+typedef struct {
+  int first;
+  int last;
+  uint64_t start_addr;
+  uint64_t end_addr;
+  OpBlockEnd end_kind;
+  int succ[2];
+  int succ_count;
+  OpRegSet defs;
+  OpRegSet uses;
+  OpRegSet live_in;
+  OpRegSet live_out;
+  OpRegSet read_set;
+} OpBlock;
+
+int op_reg_from_name(const char *name);
+const char *op_reg_name(int reg);
+int op_regset_to_list(const OpRegSet *set, int *regs, int max_regs);
+int op_regset_count(const OpRegSet *set);
+void op_regs_def_use(const DisasmLine *line, OpRegSet *def, OpRegSet *use);
+int op_regs_analyze(const DisasmLine *lines, int count, OpInsnRegs *insns,
+                    OpBlock *blocks, int max_blocks);
+
+typedef enum { OP_SYM_FUNC, OP_SYM_OBJECT, OP_SYM_PLT } OpSymKind;
+
+typedef struct {
+  uint64_t addr;
+  uint64_t size;
+  const char *name;
+  OpSymKind kind;
+  int weak;
+  int module;
+} OpSymbol;
+
+typedef struct {
+  int symbol;
+  uint64_t offset;
+  int target_symbol;
+  uint64_t target;
+  uint64_t target_offset;
+} OpSymbolized;
+
+typedef struct OpSymtab OpSymtab;
+
+OpSymtab *op_symtab_create(void);
+void op_symtab_destroy(OpSymtab *tab);
+int op_symtab_load_elf(OpSymtab *tab, const char *path, uint64_t load_bias);
+size_t op_symtab_count(const OpSymtab *tab);
+const OpSymbol *op_symtab_get(const OpSymtab *tab, int index);
+const char *op_symtab_module_path(const OpSymtab *tab, int module);
+int op_symtab_lookup(const OpSymtab *tab, uint64_t addr, uint64_t *offset);
+int op_symtab_find(const OpSymtab *tab, const char *name);
+int op_symtab_symbolize(const OpSymtab *tab, const DisasmLine *lines, int count,
+                        OpSymbolized *out);
+
+enum {
+  OP_LINE_IS_STMT = 1,
+  OP_LINE_END_SEQUENCE = 2,
+  OP_LINE_PROLOGUE_END = 4
+};
+
+typedef struct {
+  uint64_t addr;
+  uint32_t file;
+  uint32_t line;
+  uint32_t column;
+  uint32_t flags;
+} OpLineRow;
+
+typedef struct OpLineTable OpLineTable;
+
+OpLineTable *op_lines_open(const char *elf_path, const char *cache_dir);
+void op_lines_close(OpLineTable *table);
+size_t op_lines_count(const OpLineTable *table);
+const OpLineRow *op_lines_row(const OpLineTable *table, size_t index);
+size_t op_lines_file_count(const OpLineTable *table);
+const char *op_lines_file(const OpLineTable *table, uint32_t file);
+long op_lines_lookup(const OpLineTable *table, uint64_t addr);
+const char *op_lines_build_id(const OpLineTable *table);
+int op_lines_from_cache(const OpLineTable *table);
@@ -0,0 +1,85 @@
+#ifndef OP_REGS_H
+#define OP_REGS_H
+
+#include "op_parser.h"
+#include <stdint.h>
+
+// ARM64 寄存器 def-use 与活跃性分析
+// 单步跟踪时只需读取"本条指令写入且之后仍会被读取"的寄存器，
+// 而不是整个寄存器文件
+
+// 寄存器编号：x0-x30 为 0-30，wN 与 xN 共用编号
+enum {
+  OP_REG_X0 = 0,
+  OP_REG_FP = 29,
+  OP_REG_LR = 30,
+  OP_REG_SP = 31,
+  OP_REG_NZCV = 32,
+  OP_REG_V0 = 33, // v0-v31，q/d/s/h/b 视图共用编号
+  OP_REG_COUNT = 65
+};
+
+typedef struct {
+  uint64_t bits[2];
+} OpRegSet;
+
+// 单条指令的分析结果
+typedef struct {
+  OpRegSet defs;       // 写入的寄存器（调用指令包含调用者保存寄存器）
+  OpRegSet uses;       // 读取的寄存器
+  OpRegSet live_out;   // 执行后仍然活跃的寄存器
+  OpRegSet read_after; // 单步后需要读取的寄存器 = defs ∩ live_out
+  int block;           // 所属基本块下标
+} OpInsnRegs;
+
+// 基本块终结方式
+typedef enum {
+  OP_BLOCK_FALLTHROUGH, // 顺序落入下一块
+  OP_BLOCK_BRANCH,      // 无条件直接跳转
+  OP_BLOCK_COND_BRANCH, // 条件跳转 (b.cond/cbz/cbnz/tbz/tbnz)
+  OP_BLOCK_INDIRECT,    // br 等间接跳转
+  OP_BLOCK_RETURN,      // ret
+  OP_BLOCK_EXIT         // 跳出当前指令序列或序列结束
+} OpBlockEnd;
+
+typedef struct {
+  int first;         // 第一条指令下标
+  int last;          // 最后一条指令下标（含）
+  uint64_t start_addr;
+  uint64_t end_addr; // 最后一条指令地址
+  OpBlockEnd end_kind;
+  int succ[2];       // 后继块下标，-1 表示无
+  int succ_count;
+  OpRegSet defs;     // 块内写入的寄存器
+  OpRegSet uses;     // 块内先读后写（向上暴露）的寄存器
+  OpRegSet live_in;
+  OpRegSet live_out;
+  OpRegSet read_set; // 块内各指令 read_after 的并集
+} OpBlock;
+
+static inline void op_regset_add(OpRegSet *set, int reg) {
+  set->bits[reg >> 6] |= (uint64_t)1 << (reg & 63);
+}
+
+static inline int op_regset_has(const OpRegSet *set, int reg) {
+  return (int)((set->bits[reg >> 6] >> (reg & 63)) & 1);
+}
+
+// 寄存器名转编号，支持 xN/wN/sp/wsp/fp/lr/ip0/ip1/nzcv 和 vN/qN/dN/sN/hN/bN
+// （可带 {} 和 .4s/[1] 之类的后缀）；xzr/wzr 和非寄存器返回 -1
+int op_reg_from_name(const char *name);
+const char *op_reg_name(int reg);
+
+// 集合展开为寄存器编号列表，返回写入的数量
+int op_regset_to_list(const OpRegSet *set, int *regs, int max_regs);
+int op_regset_count(const OpRegSet *set);
+
+// 单条指令的 def/use，不依赖上下文
+void op_regs_def_use(const DisasmLine *line, OpRegSet *def, OpRegSet *use);
+
+// 对按地址升序排列的一段指令（通常是一个函数）划分基本块并求活跃性
+// insns 需要 count 个元素；返回基本块数量，blocks 不够或参数错误时返回 -1
+int op_regs_analyze(const DisasmLine *lines, int count, OpInsnRegs *insns,
+                    OpBlock *blocks, int max_blocks);
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef OP_SCAN_H
+#define OP_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 反汇编文本的向量化扫描前端
+// 负责批量定位换行符和结构分隔符，提供与locale无关的字符分类表
+
+typedef enum {
+  OP_SCAN_KERNEL_SCALAR, // 纯C实现，所有平台可用
+  OP_SCAN_KERNEL_SSE2,   // x86-64基线
+  OP_SCAN_KERNEL_AVX2,   // x86-64，运行时检测
+  OP_SCAN_KERNEL_NEON    // arm64
+} OpScanKernel;
+
+// 分隔符种类，op_scan_delims 输出的 kinds 取值
+enum {
+  OP_DELIM_NEWLINE = '\n',
+  OP_DELIM_LT = '<',
+  OP_DELIM_GT = '>',
+  OP_DELIM_COLON = ':',
+  OP_DELIM_LBRACKET = '[',
+  OP_DELIM_RBRACKET = ']',
+  OP_DELIM_COMMA = ',',
+  OP_DELIM_HASH = '#',
+  OP_DELIM_PLUS = '+',
+  OP_DELIM_MINUS = '-',
+  OP_DELIM_SEMICOLON = ';'
+};
+
+// 字符分类位
+enum {
+  OP_CC_ALPHA = 1 << 0,
+  OP_CC_DIGIT = 1 << 1,
+  OP_CC_XDIGIT = 1 << 2,
+  OP_CC_SPACE = 1 << 3,
+  OP_CC_DELIM = 1 << 4
+};
+
+extern const uint8_t op_char_class[256];
+
+#define OP_CC(c) (op_char_class[(unsigned char)(c)])
+#define op_isalpha(c) (OP_CC(c) & OP_CC_ALPHA)
+#define op_isdigit(c) (OP_CC(c) & OP_CC_DIGIT)
+#define op_isxdigit(c) (OP_CC(c) & OP_CC_XDIGIT)
+#define op_isspace(c) (OP_CC(c) & OP_CC_SPACE)
+#define op_isalnum(c) (OP_CC(c) & (OP_CC_ALPHA | OP_CC_DIGIT))
+#define op_isdelim(c) (OP_CC(c) & OP_CC_DELIM)
+
+// 返回 [p, end) 中第一个 '\n' 的位置，找不到返回 end
+const char *op_scan_newline(const char *p, const char *end);
+
+// 收集 [p, p+len) 中所有分隔符的偏移和种类，返回找到的数量（最多 max 个）
+size_t op_scan_delims(const char *p, size_t len, uint16_t *offsets,
+                      uint8_t *kinds, size_t max);
+
+// 内核选择，set 返回0表示当前CPU不支持该内核
+OpScanKernel op_scan_get_kernel(void);
+int op_scan_set_kernel(OpScanKernel kernel);
+const char *op_scan_kernel_name(OpScanKernel kernel);
+
+#endif // OP_SCAN_H
@@ -0,0 +1,58 @@
+#ifndef OP_SYMTAB_H
+#define OP_SYMTAB_H
+
+#include "op_parser.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// 原生符号表：从各模块ELF的 .symtab/.dynsym 加载符号，识别PLT桩，
+// 建立按地址排序的区间索引，批量符号化反汇编结果而不需要调试器调用
+
+typedef enum {
+  OP_SYM_FUNC,   // STT_FUNC / STT_GNU_IFUNC
+  OP_SYM_OBJECT, // STT_OBJECT
+  OP_SYM_PLT     // 由 .rela.plt 推导出的PLT桩，名字为 "name@plt"
+} OpSymKind;
+
+typedef struct {
+  uint64_t addr; // 运行时地址（已加上模块加载偏移）
+  uint64_t size; // 0 表示大小未知，覆盖到下一个符号之前
+  const char *name;
+  OpSymKind kind;
+  int weak;      // STB_WEAK
+  int module;    // op_symtab_load_elf 返回的模块编号
+} OpSymbol;
+
+// 一条反汇编的符号化结果，下标为 -1 表示没有找到
+typedef struct {
+  int symbol;            // 指令地址所在符号
+  uint64_t offset;       // 指令相对符号起始的偏移
+  int target_symbol;     // 跳转/地址操作数所在符号
+  uint64_t target;       // 目标地址，没有地址操作数时为0
+  uint64_t target_offset;
+} OpSymbolized;
+
+typedef struct OpSymtab OpSymtab;
+
+OpSymtab *op_symtab_create(void);
+void op_symtab_destroy(OpSymtab *tab);
+
+// 加载一个ELF模块，load_bias 为运行时地址与文件中虚拟地址之差
+// （可执行文件非PIE时为0）；返回模块编号，失败返回 -1
+int op_symtab_load_elf(OpSymtab *tab, const char *path, uint64_t load_bias);
+
+size_t op_symtab_count(const OpSymtab *tab);
+const OpSymbol *op_symtab_get(const OpSymtab *tab, int index);
+const char *op_symtab_module_path(const OpSymtab *tab, int module);
+
+// 查找包含 addr 的符号下标，找不到返回 -1；offset 可为NULL
+int op_symtab_lookup(const OpSymtab *tab, uint64_t addr, uint64_t *offset);
+
+// 按名字查找（线性扫描），同名时优先非weak的符号
+int op_symtab_find(const OpSymtab *tab, const char *name);
+
+// 批量符号化：out 需要 count 个元素，返回找到指令所在符号的行数
+int op_symtab_symbolize(const OpSymtab *tab, const DisasmLine *lines, int count,
+                        OpSymbolized *out);
+
+#endif
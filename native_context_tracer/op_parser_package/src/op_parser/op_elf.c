@@ -0,0 +1,127 @@
+#define _GNU_SOURCE
+#include "op_elf.h"
+
+#ifdef OP_HAVE_ELF
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+int op_elf_in_file(const OpElfFile *elf, uint64_t off, uint64_t len) {
+  return off <= elf->size && len <= elf->size - off;
+}
+
+int op_elf_table_in_file(const OpElfFile *elf, uint64_t off, uint64_t len) {
+  return off % 8 == 0 && op_elf_in_file(elf, off, len);
+}
+
+int op_elf_open(OpElfFile *elf, const uint8_t *data, size_t size) {
+  memset(elf, 0, sizeof(*elf));
+  elf->data = data;
+  elf->size = size;
+  if (size < sizeof(Elf64_Ehdr) || memcmp(data, ELFMAG, SELFMAG) != 0)
+    return 0;
+  const Elf64_Ehdr *ehdr = (const Elf64_Ehdr *)data;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  if (ehdr->e_ident[EI_DATA] != ELFDATA2LSB)
+    return 0;
+#else
+  if (ehdr->e_ident[EI_DATA] != ELFDATA2MSB)
+    return 0;
+#endif
+  if (ehdr->e_ident[EI_CLASS] != ELFCLASS64 ||
+      ehdr->e_shentsize != sizeof(Elf64_Shdr) ||
+      !op_elf_table_in_file(elf, ehdr->e_shoff,
+                            (uint64_t)ehdr->e_shnum * sizeof(Elf64_Shdr)) ||
+      ehdr->e_shstrndx >= ehdr->e_shnum)
+    return 0;
+  elf->ehdr = ehdr;
+  elf->shdrs = (const Elf64_Shdr *)(data + ehdr->e_shoff);
+
+  const Elf64_Shdr *shstr = &elf->shdrs[ehdr->e_shstrndx];
+  if (!op_elf_in_file(elf, shstr->sh_offset, shstr->sh_size))
+    return 0;
+  elf->shstrtab = (const char *)data + shstr->sh_offset;
+  elf->shstrtab_size = shstr->sh_size;
+  return 1;
+}
+
+int op_elf_map(OpElfFile *elf, const char *path) {
+  memset(elf, 0, sizeof(*elf));
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return 0;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    close(fd);
+    return 0;
+  }
+  void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return 0;
+  if (!op_elf_open(elf, data, (size_t)st.st_size)) {
+    munmap(data, (size_t)st.st_size);
+    memset(elf, 0, sizeof(*elf));
+    return 0;
+  }
+  elf->mapped = 1;
+  return 1;
+}
+
+void op_elf_unmap(OpElfFile *elf) {
+  if (elf->mapped)
+    munmap((void *)elf->data, elf->size);
+  memset(elf, 0, sizeof(*elf));
+}
+
+const Elf64_Shdr *op_elf_section(const OpElfFile *elf, const char *name) {
+  for (int i = 0; i < elf->ehdr->e_shnum; i++) {
+    uint32_t off = elf->shdrs[i].sh_name;
+    if (off < elf->shstrtab_size &&
+        strncmp(elf->shstrtab + off, name, elf->shstrtab_size - off) == 0)
+      return &elf->shdrs[i];
+  }
+  return NULL;
+}
+
+const uint8_t *op_elf_section_data(const OpElfFile *elf, const Elf64_Shdr *sec,
+                                   size_t *size) {
+  if (!sec || sec->sh_type == SHT_NOBITS || (sec->sh_flags & SHF_COMPRESSED) ||
+      !op_elf_in_file(elf, sec->sh_offset, sec->sh_size))
+    return NULL;
+  *size = sec->sh_size;
+  return elf->data + sec->sh_offset;
+}
+
+size_t op_elf_build_id(const OpElfFile *elf, uint8_t *out, size_t max) {
+  for (int i = 0; i < elf->ehdr->e_shnum; i++) {
+    const Elf64_Shdr *sec = &elf->shdrs[i];
+    size_t size;
+    const uint8_t *p;
+    if (sec->sh_type != SHT_NOTE || !(p = op_elf_section_data(elf, sec, &size)))
+      continue;
+
+    // 依次遍历 note：namesz/descsz/type + 4字节对齐的 name 和 desc
+    size_t off = 0;
+    while (off + sizeof(Elf64_Nhdr) <= size) {
+      Elf64_Nhdr nhdr;
+      memcpy(&nhdr, p + off, sizeof(nhdr));
+      size_t name_off = off + sizeof(nhdr);
+      size_t desc_off = name_off + ((nhdr.n_namesz + 3u) & ~3u);
+      size_t next = desc_off + ((nhdr.n_descsz + 3u) & ~3u);
+      if (desc_off > size || next > size || next <= off)
+        break;
+      if (nhdr.n_type == NT_GNU_BUILD_ID && nhdr.n_namesz == 4 &&
+          memcmp(p + name_off, "GNU", 4) == 0) {
+        size_t len = nhdr.n_descsz < max ? nhdr.n_descsz : max;
+        memcpy(out, p + desc_off, len);
+        return len;
+      }
+      off = next;
+    }
+  }
+  return 0;
+}
+#endif
@@ -0,0 +1,882 @@
+#define _GNU_SOURCE
+#include "op_lines.h"
+#include "op_elf.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define OP_LINES_MAGIC "OPLINES1"
+#define OP_LINES_VERSION 1
+#define OP_LINES_MAX_BUILD_ID 32
+
+// 缓存文件布局（主机字节序，只在同构机器间复用）：
+// header | rows[row_count] | file_offsets[file_count] | strings
+// 每段都是8字节对齐，映射后可以直接当数组使用
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t row_size; // sizeof(OpLineRow)，布局变化时缓存自动失效
+  uint32_t build_id_len;
+  uint32_t reserved;
+  uint8_t build_id[OP_LINES_MAX_BUILD_ID];
+  uint64_t row_count;
+  uint64_t file_count;
+  uint64_t strings_size;
+} OpLinesHeader;
+
+struct OpLineTable {
+  void *map; // 缓存文件映射，解析得到的表为NULL
+  size_t map_size;
+  OpLineRow *owned_rows;
+  uint64_t *owned_offsets;
+  char *owned_strings;
+
+  const OpLineRow *rows;
+  size_t row_count;
+  const uint64_t *file_offsets;
+  size_t file_count;
+  const char *strings;
+  size_t strings_size;
+  int from_cache;
+  char build_id[OP_LINES_MAX_BUILD_ID * 2 + 1];
+};
+
+size_t op_lines_count(const OpLineTable *table) { return table->row_count; }
+
+const OpLineRow *op_lines_row(const OpLineTable *table, size_t index) {
+  return index < table->row_count ? &table->rows[index] : NULL;
+}
+
+size_t op_lines_file_count(const OpLineTable *table) {
+  return table->file_count;
+}
+
+const char *op_lines_file(const OpLineTable *table, uint32_t file) {
+  return file < table->file_count ? table->strings + table->file_offsets[file]
+                                  : NULL;
+}
+
+const char *op_lines_build_id(const OpLineTable *table) {
+  return table->build_id;
+}
+
+int op_lines_from_cache(const OpLineTable *table) { return table->from_cache; }
+
+long op_lines_lookup(const OpLineTable *table, uint64_t addr) {
+  // 最后一个 addr <= 目标的行；落在序列结束行上说明地址在两个序列之间
+  size_t lo = 0, hi = table->row_count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (table->rows[mid].addr <= addr)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == 0 || (table->rows[lo - 1].flags & OP_LINE_END_SEQUENCE))
+    return -1;
+  return (long)(lo - 1);
+}
+
+void op_lines_close(OpLineTable *table) {
+  if (!table)
+    return;
+  if (table->map)
+    munmap(table->map, table->map_size);
+  free(table->owned_rows);
+  free(table->owned_offsets);
+  free(table->owned_strings);
+  free(table);
+}
+
+#ifndef OP_HAVE_ELF
+OpLineTable *op_lines_open(const char *elf_path, const char *cache_dir) {
+  (void)elf_path;
+  (void)cache_dir;
+  return NULL;
+}
+#else
+
+enum {
+  DW_LNS_copy = 1,
+  DW_LNS_advance_pc,
+  DW_LNS_advance_line,
+  DW_LNS_set_file,
+  DW_LNS_set_column,
+  DW_LNS_negate_stmt,
+  DW_LNS_set_basic_block,
+  DW_LNS_const_add_pc,
+  DW_LNS_fixed_advance_pc,
+  DW_LNS_set_prologue_end,
+  DW_LNS_set_epilogue_begin,
+  DW_LNS_set_isa
+};
+
+enum {
+  DW_LNE_end_sequence = 1,
+  DW_LNE_set_address = 2,
+  DW_LNE_define_file = 3
+};
+
+enum { DW_LNCT_path = 1, DW_LNCT_directory_index = 2 };
+
+enum {
+  DW_FORM_block2 = 0x03,
+  DW_FORM_block4 = 0x04,
+  DW_FORM_data2 = 0x05,
+  DW_FORM_data4 = 0x06,
+  DW_FORM_data8 = 0x07,
+  DW_FORM_string = 0x08,
+  DW_FORM_block = 0x09,
+  DW_FORM_block1 = 0x0a,
+  DW_FORM_data1 = 0x0b,
+  DW_FORM_sdata = 0x0d,
+  DW_FORM_strp = 0x0e,
+  DW_FORM_udata = 0x0f,
+  DW_FORM_strx = 0x1a,
+  DW_FORM_data16 = 0x1e,
+  DW_FORM_line_strp = 0x1f,
+  DW_FORM_strx1 = 0x25,
+  DW_FORM_strx2 = 0x26,
+  DW_FORM_strx3 = 0x27,
+  DW_FORM_strx4 = 0x28
+};
+
+// 越界读取置 bad 并停在末尾，调用方在关键位置检查一次即可
+typedef struct {
+  const uint8_t *p;
+  const uint8_t *end;
+  int bad;
+} Reader;
+
+static uint64_t rd_fixed(Reader *r, size_t n) {
+  if (r->bad || n > 8 || (size_t)(r->end - r->p) < n) {
+    r->bad = 1;
+    r->p = r->end;
+    return 0;
+  }
+  uint64_t v = 0;
+  for (size_t i = 0; i < n; i++) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    v |= (uint64_t)r->p[i] << (8 * i);
+#else
+    v = (v << 8) | r->p[i];
+#endif
+  }
+  r->p += n;
+  return v;
+}
+
+static uint64_t rd_uleb(Reader *r) {
+  uint64_t v = 0;
+  unsigned shift = 0;
+  while (r->p < r->end) {
+    uint8_t b = *r->p++;
+    if (shift < 64)
+      v |= (uint64_t)(b & 0x7f) << shift;
+    shift += 7;
+    if (!(b & 0x80))
+      return v;
+  }
+  r->bad = 1;
+  return 0;
+}
+
+static int64_t rd_sleb(Reader *r) {
+  uint64_t v = 0;
+  unsigned shift = 0;
+  while (r->p < r->end) {
+    uint8_t b = *r->p++;
+    if (shift < 64)
+      v |= (uint64_t)(b & 0x7f) << shift;
+    shift += 7;
+    if (!(b & 0x80)) {
+      if (shift < 64 && (b & 0x40))
+        v |= ~(uint64_t)0 << shift;
+      return (int64_t)v;
+    }
+  }
+  r->bad = 1;
+  return 0;
+}
+
+static const char *rd_cstr(Reader *r) {
+  const uint8_t *nul =
+      r->bad ? NULL : memchr(r->p, 0, (size_t)(r->end - r->p));
+  if (!nul) {
+    r->bad = 1;
+    r->p = r->end;
+    return "";
+  }
+  const char *s = (const char *)r->p;
+  r->p = nul + 1;
+  return s;
+}
+
+static void rd_skip(Reader *r, uint64_t n) {
+  if (r->bad || (uint64_t)(r->end - r->p) < n) {
+    r->bad = 1;
+    r->p = r->end;
+    return;
+  }
+  r->p += n;
+}
+
+static int grow(void **buf, size_t *cap, size_t need, size_t elem) {
+  if (need <= *cap)
+    return 1;
+  size_t next = *cap ? *cap * 2 : 64;
+  while (next < need)
+    next *= 2;
+  void *p = realloc(*buf, next * elem);
+  if (!p)
+    return 0;
+  *buf = p;
+  *cap = next;
+  return 1;
+}
+
+typedef struct {
+  uint64_t start;
+  size_t begin;
+  size_t end; // 不含
+} Sequence;
+
+typedef struct {
+  const uint8_t *line_str;
+  size_t line_str_size;
+  const uint8_t *str;
+  size_t str_size;
+
+  OpLineRow *rows;
+  size_t row_count, row_cap;
+  Sequence *seqs;
+  size_t seq_count, seq_cap;
+
+  // 全局文件表：路径去重后拼接在 strings 中
+  char *strings;
+  size_t strings_size, strings_cap;
+  uint64_t *offsets;
+  size_t file_count, offsets_cap;
+  uint32_t *slots; // 开放寻址哈希，存 file+1，0 为空
+  size_t slot_count;
+
+  char *scratch;
+  size_t scratch_cap;
+  int oom;
+} Parser;
+
+static uint64_t hash_str(const char *s) {
+  uint64_t h = 1469598103934665603ull;
+  for (; *s; s++)
+    h = (h ^ (uint8_t)*s) * 1099511628211ull;
+  return h;
+}
+
+static int rehash(Parser *ps) {
+  size_t count = ps->slot_count ? ps->slot_count * 2 : 256;
+  uint32_t *slots = calloc(count, sizeof(*slots));
+  if (!slots)
+    return 0;
+  for (size_t i = 0; i < ps->file_count; i++) {
+    size_t h = (size_t)hash_str(ps->strings + ps->offsets[i]) & (count - 1);
+    while (slots[h])
+      h = (h + 1) & (count - 1);
+    slots[h] = (uint32_t)i + 1;
+  }
+  free(ps->slots);
+  ps->slots = slots;
+  ps->slot_count = count;
+  return 1;
+}
+
+static uint32_t intern_file(Parser *ps, const char *path) {
+  if ((ps->file_count + 1) * 2 > ps->slot_count && !rehash(ps)) {
+    ps->oom = 1;
+    return UINT32_MAX;
+  }
+  size_t h = (size_t)hash_str(path) & (ps->slot_count - 1);
+  while (ps->slots[h]) {
+    uint32_t id = ps->slots[h] - 1;
+    if (strcmp(ps->strings + ps->offsets[id], path) == 0)
+      return id;
+    h = (h + 1) & (ps->slot_count - 1);
+  }
+
+  size_t len = strlen(path) + 1;
+  if (!grow((void **)&ps->strings, &ps->strings_cap, ps->strings_size + len,
+            1) ||
+      !grow((void **)&ps->offsets, &ps->offsets_cap, ps->file_count + 1,
+            sizeof(uint64_t))) {
+    ps->oom = 1;
+    return UINT32_MAX;
+  }
+  memcpy(ps->strings + ps->strings_size, path, len);
+  ps->offsets[ps->file_count] = ps->strings_size;
+  ps->strings_size += len;
+  ps->slots[h] = (uint32_t)ps->file_count + 1;
+  return (uint32_t)ps->file_count++;
+}
+
+// 目录与文件名拼接后入表；绝对路径或没有目录时直接使用文件名
+static uint32_t intern_path(Parser *ps, const char *dir, const char *name) {
+  if (name[0] == '/' || !dir || !dir[0])
+    return intern_file(ps, name);
+  size_t dlen = strlen(dir), nlen = strlen(name);
+  if (!grow((void **)&ps->scratch, &ps->scratch_cap, dlen + nlen + 2, 1)) {
+    ps->oom = 1;
+    return UINT32_MAX;
+  }
+  memcpy(ps->scratch, dir, dlen);
+  size_t pos = dlen;
+  if (dir[dlen - 1] != '/')
+    ps->scratch[pos++] = '/';
+  memcpy(ps->scratch + pos, name, nlen + 1);
+  return intern_file(ps, ps->scratch);
+}
+
+static const char *section_str(const uint8_t *sec, size_t size, uint64_t off) {
+  if (!sec || off >= size || !memchr(sec + off, 0, size - off))
+    return "";
+  return (const char *)sec + off;
+}
+
+typedef struct {
+  uint64_t u;
+  const char *s; // 字符串形式的值，否则为NULL
+} FormValue;
+
+static int read_form(Parser *ps, Reader *r, uint64_t form, int offset_size,
+                     FormValue *v) {
+  v->u = 0;
+  v->s = NULL;
+  switch (form) {
+  case DW_FORM_string:
+    v->s = rd_cstr(r);
+    break;
+  case DW_FORM_line_strp:
+    v->s = section_str(ps->line_str, ps->line_str_size,
+                       rd_fixed(r, (size_t)offset_size));
+    break;
+  case DW_FORM_strp:
+    v->s = section_str(ps->str, ps->str_size, rd_fixed(r, (size_t)offset_size));
+    break;
+  case DW_FORM_strx: // 需要 .debug_str_offsets 基址，行号表里取不到
+    rd_uleb(r);
+    v->s = "";
+    break;
+  case DW_FORM_strx1:
+  case DW_FORM_strx2:
+  case DW_FORM_strx3:
+  case DW_FORM_strx4:
+    rd_skip(r, form - DW_FORM_strx1 + 1);
+    v->s = "";
+    break;
+  case DW_FORM_udata:
+    v->u = rd_uleb(r);
+    break;
+  case DW_FORM_sdata:
+    v->u = (uint64_t)rd_sleb(r);
+    break;
+  case DW_FORM_data1:
+    v->u = rd_fixed(r, 1);
+    break;
+  case DW_FORM_data2:
+    v->u = rd_fixed(r, 2);
+    break;
+  case DW_FORM_data4:
+    v->u = rd_fixed(r, 4);
+    break;
+  case DW_FORM_data8:
+    v->u = rd_fixed(r, 8);
+    break;
+  case DW_FORM_data16:
+    rd_skip(r, 16);
+    break;
+  case DW_FORM_block:
+    rd_skip(r, rd_uleb(r));
+    break;
+  case DW_FORM_block1:
+    rd_skip(r, rd_fixed(r, 1));
+    break;
+  case DW_FORM_block2:
+    rd_skip(r, rd_fixed(r, 2));
+    break;
+  case DW_FORM_block4:
+    rd_skip(r, rd_fixed(r, 4));
+    break;
+  default:
+    return 0;
+  }
+  return !r->bad;
+}
+
+// 单元内的目录表与文件表（下标为DWARF中的编号）
+typedef struct {
+  const char **dirs;
+  size_t dir_count, dir_cap;
+  uint32_t *files;
+  size_t file_count, file_cap;
+} UnitTables;
+
+static int push_dir(UnitTables *u, const char *dir) {
+  if (!grow((void **)&u->dirs, &u->dir_cap, u->dir_count + 1,
+            sizeof(*u->dirs)))
+    return 0;
+  u->dirs[u->dir_count++] = dir;
+  return 1;
+}
+
+static int push_file(Parser *ps, UnitTables *u, const char *name,
+                     uint64_t dir) {
+  if (!grow((void **)&u->files, &u->file_cap, u->file_count + 1,
+            sizeof(*u->files)))
+    return 0;
+  const char *d = dir < u->dir_count ? u->dirs[dir] : NULL;
+  u->files[u->file_count++] = intern_path(ps, d, name);
+  return !ps->oom;
+}
+
+// DWARF 5 的目录/文件项：先是 (内容类型, form) 格式描述，再是各项
+static int read_v5_entries(Parser *ps, Reader *r, int offset_size,
+                           UnitTables *u, int is_files) {
+  uint8_t format_count = (uint8_t)rd_fixed(r, 1);
+  uint64_t formats[2 * 255];
+  for (int i = 0; i < format_count; i++) {
+    formats[2 * i] = rd_uleb(r);
+    formats[2 * i + 1] = rd_uleb(r);
+  }
+  uint64_t count = rd_uleb(r);
+  for (uint64_t n = 0; n < count && !r->bad; n++) {
+    const char *path = "";
+    uint64_t dir = 0;
+    for (int i = 0; i < format_count; i++) {
+      FormValue v;
+      if (!read_form(ps, r, formats[2 * i + 1], offset_size, &v))
+        return 0;
+      if (formats[2 * i] == DW_LNCT_path && v.s)
+        path = v.s;
+      else if (formats[2 * i] == DW_LNCT_directory_index)
+        dir = v.u;
+    }
+    if (!(is_files ? push_file(ps, u, path, dir) : push_dir(u, path)))
+      return 0;
+  }
+  return !r->bad;
+}
+
+typedef struct {
+  uint64_t addr;
+  uint64_t file;
+  uint32_t line;
+  uint32_t column;
+  uint32_t flags;
+} LineState;
+
+static void emit_row(Parser *ps, const UnitTables *u, const LineState *st) {
+  if (!grow((void **)&ps->rows, &ps->row_cap, ps->row_count + 1,
+            sizeof(OpLineRow))) {
+    ps->oom = 1;
+    return;
+  }
+  OpLineRow *row = &ps->rows[ps->row_count++];
+  row->addr = st->addr;
+  row->file = st->file < u->file_count ? u->files[st->file] : UINT32_MAX;
+  row->line = st->line;
+  row->column = st->column;
+  row->flags = st->flags;
+}
+
+// 序列结束：丢弃被链接器 gc 掉的函数（起始地址为0或 ~0 墓碑值）
+static void end_sequence(Parser *ps, size_t begin) {
+  uint64_t start = ps->rows[begin].addr;
+  if (ps->row_count - begin < 2 || start == 0 || start >= UINT64_MAX - 1) {
+    ps->row_count = begin;
+    return;
+  }
+  if (!grow((void **)&ps->seqs, &ps->seq_cap, ps->seq_count + 1,
+            sizeof(Sequence))) {
+    ps->oom = 1;
+    return;
+  }
+  ps->seqs[ps->seq_count++] = (Sequence){start, begin, ps->row_count};
+}
+
+static void run_program(Parser *ps, Reader *r, UnitTables *u,
+                        int version, uint8_t min_inst, int default_is_stmt,
+                        int8_t line_base, uint8_t line_range,
+                        uint8_t opcode_base, const uint8_t *std_lengths) {
+  LineState init = {0, version >= 5 ? 0 : 1, 1, 0,
+                    default_is_stmt ? OP_LINE_IS_STMT : 0};
+  LineState st = init;
+  size_t seq_begin = ps->row_count;
+
+  while (r->p < r->end && !r->bad && !ps->oom) {
+    uint8_t op = (uint8_t)rd_fixed(r, 1);
+    if (op >= opcode_base) {
+      uint8_t adj = (uint8_t)(op - opcode_base);
+      st.addr += (uint64_t)(adj / line_range) * min_inst;
+      st.line += (uint32_t)(line_base + adj % line_range);
+      emit_row(ps, u, &st);
+      st.flags &= ~(uint32_t)OP_LINE_PROLOGUE_END;
+      continue;
+    }
+    switch (op) {
+    case 0: {
+      uint64_t len = rd_uleb(r);
+      if (r->bad || len == 0 || len > (uint64_t)(r->end - r->p)) {
+        r->bad = 1;
+        break;
+      }
+      Reader ext = {r->p, r->p + len, 0};
+      r->p += len;
+      uint8_t sub = (uint8_t)rd_fixed(&ext, 1);
+      if (sub == DW_LNE_end_sequence) {
+        st.flags |= OP_LINE_END_SEQUENCE;
+        emit_row(ps, u, &st);
+        if (!ps->oom)
+          end_sequence(ps, seq_begin);
+        st = init;
+        seq_begin = ps->row_count;
+      } else if (sub == DW_LNE_set_address) {
+        st.addr = rd_fixed(&ext, len - 1);
+      } else if (sub == DW_LNE_define_file) {
+        // DWARF 5 已废弃，单元内临时追加的文件
+        const char *name = rd_cstr(&ext);
+        uint64_t dir = rd_uleb(&ext);
+        if (!ext.bad && !push_file(ps, u, name, dir))
+          ps->oom = 1;
+      }
+      break;
+    }
+    case DW_LNS_copy:
+      emit_row(ps, u, &st);
+      st.flags &= ~(uint32_t)OP_LINE_PROLOGUE_END;
+      break;
+    case DW_LNS_advance_pc:
+      st.addr += rd_uleb(r) * min_inst;
+      break;
+    case DW_LNS_advance_line:
+      st.line += (uint32_t)rd_sleb(r);
+      break;
+    case DW_LNS_set_file:
+      st.file = rd_uleb(r);
+      break;
+    case DW_LNS_set_column:
+      st.column = (uint32_t)rd_uleb(r);
+      break;
+    case DW_LNS_negate_stmt:
+      st.flags ^= OP_LINE_IS_STMT;
+      break;
+    case DW_LNS_const_add_pc:
+      st.addr += (uint64_t)((255 - opcode_base) / line_range) * min_inst;
+      break;
+    case DW_LNS_fixed_advance_pc:
+      st.addr += rd_fixed(r, 2);
+      break;
+    case DW_LNS_set_prologue_end:
+      st.flags |= OP_LINE_PROLOGUE_END;
+      break;
+    default:
+      // set_basic_block/set_epilogue_begin/set_isa 以及未知的标准操作码
+      // 按头部声明的参数个数跳过
+      for (int i = 0; i < std_lengths[op - 1]; i++)
+        rd_uleb(r);
+      break;
+    }
+  }
+  // 没有以 end_sequence 结束的残余行不可信
+  if (ps->row_count > seq_begin && !ps->oom)
+    ps->row_count = seq_begin;
+}
+
+// 解析一个行号程序单元，r 前进到下一个单元；头部无法解析时返回0
+static int parse_unit(Parser *ps, Reader *r) {
+  int offset_size = 4;
+  uint64_t unit_length = rd_fixed(r, 4);
+  if (unit_length == 0xffffffffu) {
+    offset_size = 8;
+    unit_length = rd_fixed(r, 8);
+  } else if (unit_length >= 0xfffffff0u) {
+    return 0;
+  }
+  if (r->bad || unit_length > (uint64_t)(r->end - r->p))
+    return 0;
+  Reader u = {r->p, r->p + unit_length, 0};
+  r->p += unit_length;
+
+  int version = (int)rd_fixed(&u, 2);
+  if (version < 2 || version > 5)
+    return 1; // 跳过不认识的版本，继续下一个单元
+  if (version >= 5)
+    rd_skip(&u, 2); // address_size, segment_selector_size
+  uint64_t header_length = rd_fixed(&u, (size_t)offset_size);
+  if (u.bad || header_length > (uint64_t)(u.end - u.p))
+    return 0;
+  Reader prog = {u.p + header_length, u.end, 0};
+
+  uint8_t min_inst = (uint8_t)rd_fixed(&u, 1);
+  if (version >= 4)
+    rd_skip(&u, 1); // maximum_operations_per_instruction，只有VLIW使用
+  int default_is_stmt = (int)rd_fixed(&u, 1);
+  int8_t line_base = (int8_t)rd_fixed(&u, 1);
+  uint8_t line_range = (uint8_t)rd_fixed(&u, 1);
+  uint8_t opcode_base = (uint8_t)rd_fixed(&u, 1);
+  uint8_t std_lengths[256] = {0};
+  for (int i = 1; i < opcode_base; i++)
+    std_lengths[i - 1] = (uint8_t)rd_fixed(&u, 1);
+  if (u.bad || line_range == 0 || opcode_base == 0)
+    return 1;
+
+  UnitTables tables = {0};
+  int ok = 1;
+  if (version >= 5) {
+    ok = read_v5_entries(ps, &u, offset_size, &tables, 0) &&
+         read_v5_entries(ps, &u, offset_size, &tables, 1);
+  } else {
+    // 目录0是编译目录，DWARF 4 及以前不在行号表中
+    ok = push_dir(&tables, "");
+    for (;;) {
+      const char *dir = rd_cstr(&u);
+      if (u.bad || !dir[0] || !(ok = push_dir(&tables, dir)))
+        break;
+    }
+    // 文件编号从1开始
+    ok = ok && grow((void **)&tables.files, &tables.file_cap, 1,
+                    sizeof(*tables.files));
+    if (ok)
+      tables.files[tables.file_count++] = UINT32_MAX;
+    while (ok) {
+      const char *name = rd_cstr(&u);
+      if (u.bad || !name[0])
+        break;
+      uint64_t dir = rd_uleb(&u);
+      rd_uleb(&u); // mtime
+      rd_uleb(&u); // length
+      ok = push_file(ps, &tables, name, dir);
+    }
+  }
+  if (!ok && !ps->oom && !u.bad)
+    ps->oom = 1;
+  if (ok && !u.bad)
+    run_program(ps, &prog, &tables, version, min_inst, default_is_stmt,
+                line_base, line_range, opcode_base, std_lengths);
+  free(tables.dirs);
+  free(tables.files);
+  return 1;
+}
+
+static int compare_seq(const void *a, const void *b) {
+  const Sequence *x = a, *y = b;
+  if (x->start != y->start)
+    return x->start < y->start ? -1 : 1;
+  return x->begin < y->begin ? -1 : (x->begin > y->begin);
+}
+
+// 按起始地址排列序列并拼成最终的行数组；与前一个序列重叠的
+// （例如未去重的 COMDAT 副本）丢弃，保证整张表按地址单调
+static OpLineTable *finish(Parser *ps) {
+  OpLineTable *t = calloc(1, sizeof(*t));
+  if (!t)
+    return NULL;
+  if (ps->seq_count)
+    qsort(ps->seqs, ps->seq_count, sizeof(Sequence), compare_seq);
+  size_t total = 0;
+  for (size_t i = 0; i < ps->seq_count; i++)
+    total += ps->seqs[i].end - ps->seqs[i].begin;
+  t->owned_rows = malloc((total ? total : 1) * sizeof(OpLineRow));
+  if (!t->owned_rows) {
+    free(t);
+    return NULL;
+  }
+  size_t n = 0;
+  uint64_t prev_end = 0;
+  for (size_t i = 0; i < ps->seq_count; i++) {
+    const Sequence *s = &ps->seqs[i];
+    if (n && s->start < prev_end)
+      continue;
+    size_t len = s->end - s->begin;
+    memcpy(t->owned_rows + n, ps->rows + s->begin, len * sizeof(OpLineRow));
+    n += len;
+    prev_end = ps->rows[s->end - 1].addr;
+  }
+  t->rows = t->owned_rows;
+  t->row_count = n;
+
+  t->owned_offsets = ps->offsets;
+  t->owned_strings = ps->strings;
+  ps->offsets = NULL;
+  ps->strings = NULL;
+  t->file_offsets = t->owned_offsets;
+  t->file_count = ps->file_count;
+  t->strings = t->owned_strings;
+  t->strings_size = ps->strings_size;
+  return t;
+}
+
+static OpLineTable *parse_debug_line(const OpElfFile *elf) {
+  size_t size;
+  const uint8_t *line =
+      op_elf_section_data(elf, op_elf_section(elf, ".debug_line"), &size);
+  if (!line)
+    return NULL;
+
+  Parser ps;
+  memset(&ps, 0, sizeof(ps));
+  ps.line_str = op_elf_section_data(
+      elf, op_elf_section(elf, ".debug_line_str"), &ps.line_str_size);
+  ps.str = op_elf_section_data(elf, op_elf_section(elf, ".debug_str"),
+                               &ps.str_size);
+
+  Reader r = {line, line + size, 0};
+  while (r.p < r.end && !ps.oom && parse_unit(&ps, &r))
+    ;
+
+  OpLineTable *t = ps.oom ? NULL : finish(&ps);
+  free(ps.rows);
+  free(ps.seqs);
+  free(ps.strings);
+  free(ps.offsets);
+  free(ps.slots);
+  free(ps.scratch);
+  return t;
+}
+
+static int cache_path(char *out, size_t max, const char *dir,
+                      const char *hex) {
+  int n = snprintf(out, max, "%s/%s.oplines", dir, hex);
+  return n > 0 && (size_t)n < max;
+}
+
+static OpLineTable *load_cache(const char *path, const uint8_t *build_id,
+                               size_t build_id_len) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return NULL;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(OpLinesHeader)) {
+    close(fd);
+    return NULL;
+  }
+  size_t size = (size_t)st.st_size;
+  void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return NULL;
+
+  const OpLinesHeader *h = map;
+  size_t avail = size - sizeof(*h);
+  int ok = memcmp(h->magic, OP_LINES_MAGIC, 8) == 0 &&
+           h->version == OP_LINES_VERSION &&
+           h->row_size == sizeof(OpLineRow) &&
+           h->build_id_len == build_id_len &&
+           memcmp(h->build_id, build_id, build_id_len) == 0 &&
+           h->row_count <= avail / sizeof(OpLineRow);
+  if (ok) {
+    avail -= h->row_count * sizeof(OpLineRow);
+    ok = h->file_count <= avail / sizeof(uint64_t) &&
+         h->strings_size == avail - h->file_count * sizeof(uint64_t);
+  }
+  const uint8_t *base = (const uint8_t *)map + sizeof(*h);
+  const uint64_t *offsets = NULL;
+  const char *strings = NULL;
+  if (ok) {
+    offsets = (const uint64_t *)(base + h->row_count * sizeof(OpLineRow));
+    strings = (const char *)(offsets + h->file_count);
+  }
+  if (ok && h->strings_size)
+    ok = strings[h->strings_size - 1] == '\0';
+  for (uint64_t i = 0; ok && i < h->file_count; i++)
+    ok = offsets[i] < h->strings_size;
+  OpLineTable *t = ok ? calloc(1, sizeof(*t)) : NULL;
+  if (!t) {
+    munmap(map, size);
+    return NULL;
+  }
+  t->map = map;
+  t->map_size = size;
+  t->rows = (const OpLineRow *)base;
+  t->row_count = h->row_count;
+  t->file_offsets = offsets;
+  t->file_count = h->file_count;
+  t->strings = strings;
+  t->strings_size = h->strings_size;
+  t->from_cache = 1;
+  return t;
+}
+
+static int write_all(int fd, const void *data, size_t size) {
+  const uint8_t *p = data;
+  while (size) {
+    ssize_t n = write(fd, p, size);
+    if (n <= 0)
+      return 0;
+    p += n;
+    size -= (size_t)n;
+  }
+  return 1;
+}
+
+// 先写临时文件再 rename，并发的进程只会看到完整的缓存
+static void save_cache(const OpLineTable *t, const char *cache_dir,
+                       const char *path, const uint8_t *build_id,
+                       size_t build_id_len) {
+  mkdir(cache_dir, 0755);
+  char tmp[4096];
+  int n = snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", path, (long)getpid());
+  if (n <= 0 || (size_t)n >= sizeof(tmp))
+    return;
+  int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return;
+
+  OpLinesHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, OP_LINES_MAGIC, 8);
+  h.version = OP_LINES_VERSION;
+  h.row_size = sizeof(OpLineRow);
+  h.build_id_len = (uint32_t)build_id_len;
+  memcpy(h.build_id, build_id, build_id_len);
+  h.row_count = t->row_count;
+  h.file_count = t->file_count;
+  h.strings_size = t->strings_size;
+  int ok = write_all(fd, &h, sizeof(h)) &&
+           write_all(fd, t->rows, t->row_count * sizeof(OpLineRow)) &&
+           write_all(fd, t->file_offsets, t->file_count * sizeof(uint64_t)) &&
+           write_all(fd, t->strings, t->strings_size);
+  ok = close(fd) == 0 && ok;
+  if (!ok || rename(tmp, path) != 0)
+    unlink(tmp);
+}
+
+OpLineTable *op_lines_open(const char *elf_path, const char *cache_dir) {
+  OpElfFile elf;
+  if (!op_elf_map(&elf, elf_path))
+    return NULL;
+  uint8_t build_id[OP_LINES_MAX_BUILD_ID];
+  size_t build_id_len = op_elf_build_id(&elf, build_id, sizeof(build_id));
+  char hex[OP_LINES_MAX_BUILD_ID * 2 + 1];
+  for (size_t i = 0; i < build_id_len; i++)
+    snprintf(hex + 2 * i, 3, "%02x", build_id[i]);
+  hex[2 * build_id_len] = '\0';
+
+  char path[4096];
+  int use_cache = cache_dir && cache_dir[0] && build_id_len > 0 &&
+                  cache_path(path, sizeof(path), cache_dir, hex);
+  OpLineTable *t = NULL;
+  if (use_cache)
+    t = load_cache(path, build_id, build_id_len);
+  if (!t) {
+    t = parse_debug_line(&elf);
+    if (t && use_cache)
+      save_cache(t, cache_dir, path, build_id, build_id_len);
+  }
+  op_elf_unmap(&elf);
+  if (t)
+    memcpy(t->build_id, hex, sizeof(hex));
+  return t;
+}
+#endif
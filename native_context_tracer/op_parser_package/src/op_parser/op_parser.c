@@ -1,5 +1,5 @@
 #include "op_parser.h"
-#include <ctype.h>
+#include "op_scan.h"
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -23,6 +23,70 @@ static int parse_offset(const char *str, int *value) {
   return (*endptr == '\0') ? 1 : 0;
 }
 
+// 有界写入：超出容量的字符被丢弃，但位置照常计数，保持状态机原有语义
+static inline void put_char(char *dst, int cap, int *pos, char c) {
+  if (*pos < cap - 1)
+    dst[*pos] = c;
+  (*pos)++;
+}
+
+static inline void terminate(char *dst, int cap, int pos) {
+  dst[pos < cap ? pos : cap - 1] = '\0';
+}
+
+static void copy_field(char *dst, int cap, const char *src, int len) {
+  if (len > cap - 1)
+    len = cap - 1;
+  memcpy(dst, src, (size_t)len);
+  dst[len] = '\0';
+}
+
+// 定义 OP_PARSER_REFERENCE 时编译出不带任何快速路径的参考状态机，
+// 模糊测试用它交叉校验快速路径的结果
+static const char *next_line_end(const char *p, const char *end) {
+#ifdef OP_PARSER_REFERENCE
+  while (p < end && *p != '\n')
+    p++;
+  return p;
+#else
+  return op_scan_newline(p, end);
+#endif
+}
+
+#ifndef OP_PARSER_REFERENCE
+// 返回 span 中第一个 '>'、'+'、'-' 之前的字符数，并把其中的非空白字符
+// 追加到 buffer（与逐字符状态机的行为一致）
+static int skip_func_span(const char *span, char *buffer, int buf_size,
+                          int *buf_pos) {
+  size_t len = strlen(span);
+  size_t stop = len;
+  size_t base = 0;
+  uint16_t offsets[32];
+  uint8_t kinds[32];
+
+  while (base < len && stop == len) {
+    size_t window = len - base;
+    if (window > UINT16_MAX)
+      window = UINT16_MAX;
+    size_t n = op_scan_delims(span + base, window, offsets, kinds, 32);
+    for (size_t i = 0; i < n; i++) {
+      if (kinds[i] == OP_DELIM_GT || kinds[i] == OP_DELIM_PLUS ||
+          kinds[i] == OP_DELIM_MINUS) {
+        stop = base + offsets[i];
+        break;
+      }
+    }
+    base += (n < 32) ? window : (size_t)offsets[n - 1] + 1;
+  }
+
+  for (size_t i = 0; i < stop; i++) {
+    if (!op_isspace(span[i]))
+      put_char(buffer, buf_size, buf_pos, span[i]);
+  }
+  return (int)stop;
+}
+#endif
+
 int parse_disassembly_line(const char *line, DisasmLine *disasm_line) {
   if (line == NULL || disasm_line == NULL)
     return 0;
@@ -43,17 +107,17 @@ int parse_disassembly_line(const char *line, DisasmLine *disasm_line) {
     case LINE_STATE_START:
       if (c == '0' && line[pos + 1] == 'x') {
         state = LINE_STATE_IN_ADDR;
-        buffer[buf_pos++] = c;
-        buffer[buf_pos++] = line[++pos]; // 跳过x
-      } else if (addr_parsed && isalpha(c)) {
+        put_char(buffer, sizeof(buffer), &buf_pos, c);
+        put_char(buffer, sizeof(buffer), &buf_pos, line[++pos]); // 跳过x
+      } else if (addr_parsed && op_isalpha(c)) {
         state = LINE_STATE_IN_OPCODE;
-        disasm_line->opcode[buf_pos++] = c;
+        put_char(disasm_line->opcode, sizeof(disasm_line->opcode), &buf_pos, c);
       }
       break;
 
     case LINE_STATE_IN_ADDR:
-      if (isxdigit(c)) {
-        buffer[buf_pos++] = c;
+      if (op_isxdigit(c)) {
+        put_char(buffer, sizeof(buffer), &buf_pos, c);
       } else if (c == ' ' || c == '<') {
         if (!parse_hex(buffer, &disasm_line->addr)) {
           return 0;
@@ -68,27 +132,35 @@ int parse_disassembly_line(const char *line, DisasmLine *disasm_line) {
     case LINE_STATE_AFTER_ADDR:
       if (c == '<') {
         state = LINE_STATE_IN_FUNC;
-      } else if (isalpha(c)) {
+      } else if (op_isalpha(c)) {
         state = LINE_STATE_IN_OPCODE;
-        disasm_line->opcode[buf_pos++] = c;
+        put_char(disasm_line->opcode, sizeof(disasm_line->opcode), &buf_pos, c);
       }
       break;
 
     case LINE_STATE_IN_FUNC:
+#ifndef OP_PARSER_REFERENCE
+      if (c != '>' && c != '+' && c != '-' && c != '\0') {
+        // 函数名可能很长（C++模板、ObjC方法），借助分隔符索引直接跳到
+        // 下一个 '>'、'+' 或 '-'，中间的非空白字符照旧收进 buffer
+        pos += skip_func_span(line + pos, buffer, sizeof(buffer), &buf_pos);
+        continue;
+      }
+#endif
       if (c == '>') {
         state = LINE_STATE_AFTER_FUNC;
       } else if (c == '+' || c == '-') {
         // 遇到偏移量符号，开始解析偏移量
         state = LINE_STATE_IN_OFFSET;
-        buffer[buf_pos++] = c;
-      } else if (!isspace(c)) {
-        buffer[buf_pos++] = c;
+        put_char(buffer, sizeof(buffer), &buf_pos, c);
+      } else if (!op_isspace(c)) {
+        put_char(buffer, sizeof(buffer), &buf_pos, c);
       }
       break;
 
     case LINE_STATE_IN_OFFSET:
       if (c == '>') {
-        buffer[buf_pos] = '\0';
+        terminate(buffer, sizeof(buffer), buf_pos);
         if (!parse_offset(buffer, &disasm_line->offset)) {
           // 解析失败，重置为-1
           disasm_line->offset = -1;
@@ -96,30 +168,30 @@ int parse_disassembly_line(const char *line, DisasmLine *disasm_line) {
         state = LINE_STATE_AFTER_FUNC;
         buf_pos = 0;
         memset(buffer, 0, sizeof(buffer));
-      } else if (isdigit(c)) {
-        buffer[buf_pos++] = c;
+      } else if (op_isdigit(c)) {
+        put_char(buffer, sizeof(buffer), &buf_pos, c);
       }
       break;
 
     case LINE_STATE_AFTER_FUNC:
       if (c == ':') {
         state = LINE_STATE_AFTER_ADDR;
-      } else if (isalpha(c)) {
+      } else if (op_isalpha(c)) {
         state = LINE_STATE_IN_OPCODE;
-        disasm_line->opcode[buf_pos++] = c;
+        put_char(disasm_line->opcode, sizeof(disasm_line->opcode), &buf_pos, c);
       }
       break;
 
     case LINE_STATE_IN_OPCODE:
-      if (isspace(c)) {
-        disasm_line->opcode[buf_pos] = '\0';
+      if (op_isspace(c)) {
+        terminate(disasm_line->opcode, sizeof(disasm_line->opcode), buf_pos);
         buf_pos = 0;
         state = LINE_STATE_IN_OPERANDS;
-        while (line[pos] && isspace(line[pos]))
+        while (line[pos] && op_isspace(line[pos]))
           pos++;
         pos--; // 补偿循环的pos++
       } else {
-        disasm_line->opcode[buf_pos++] = c;
+        put_char(disasm_line->opcode, sizeof(disasm_line->opcode), &buf_pos, c);
       }
       break;
 
@@ -145,12 +217,17 @@ int parse_disassembly(const char *disassembly, DisasmLine *lines,
 
   int line_count = 0;
   const char *line_start = disassembly;
+  const char *end = disassembly + strlen(disassembly);
   const char *line_end;
 
-  while ((line_end = strchr(line_start, '\n')) != NULL &&
+  while ((line_end = next_line_end(line_start, end)) != end &&
          line_count < max_lines) {
-    char line[256] = {0};
-    strncpy(line, line_start, line_end - line_start);
+    char line[256];
+    size_t len = (size_t)(line_end - line_start);
+    if (len > sizeof(line) - 1)
+      len = sizeof(line) - 1;
+    memcpy(line, line_start, len);
+    line[len] = '\0';
 
     if (parse_disassembly_line(line, &lines[line_count])) {
       line_count++;
@@ -182,19 +259,15 @@ int parse_operands(const char *str, Operand *ops, int max_ops) {
   // 预处理：去除注释和前后空格
   char clean_str[256];
   const char *comment = strchr(str, ';');
-  if (comment) {
-    strncpy(clean_str, str, comment - str);
-    clean_str[comment - str] = '\0';
-  } else {
-    strcpy(clean_str, str);
-  }
+  copy_field(clean_str, sizeof(clean_str), str,
+             comment ? (int)(comment - str) : (int)strlen(str));
 
   // 去除前后空格
   len = strlen(clean_str);
-  while (len > 0 && isspace(clean_str[len - 1]))
+  while (len > 0 && op_isspace(clean_str[len - 1]))
     clean_str[--len] = '\0';
   const char *start = clean_str;
-  while (*start && isspace(*start))
+  while (*start && op_isspace(*start))
     start++;
   len = strlen(start);
   if (start != clean_str)
@@ -207,29 +280,28 @@ int parse_operands(const char *str, Operand *ops, int max_ops) {
     case STATE_START:
       if (c == 'x' || c == 'w' || c == 's' || c == 'd') {
         state = STATE_IN_REG;
-        buffer[buf_pos++] = c;
+        put_char(buffer, sizeof(buffer), &buf_pos, c);
       } else if (c == '#') {
         state = STATE_IN_IMM;
-        buffer[buf_pos++] = c;
+        put_char(buffer, sizeof(buffer), &buf_pos, c);
       } else if (c == '[') {
         state = STATE_IN_MEM_BASE;
       } else if (c == '0' && pos + 1 < len && clean_str[pos + 1] == 'x') {
         state = STATE_IN_ADDR;
-        buffer[buf_pos++] = c;
-        buffer[buf_pos++] = clean_str[++pos]; // 跳过x
-      } else if (!isspace(c)) {
+        put_char(buffer, sizeof(buffer), &buf_pos, c);
+        put_char(buffer, sizeof(buffer), &buf_pos, clean_str[++pos]); // 跳过x
+      } else if (!op_isspace(c)) {
         state = STATE_IN_OTHER;
-        buffer[buf_pos++] = c;
+        put_char(buffer, sizeof(buffer), &buf_pos, c);
       }
       break;
 
     case STATE_IN_REG:
-      if (isalnum(c)) {
-        buffer[buf_pos++] = c;
+      if (op_isalnum(c)) {
+        put_char(buffer, sizeof(buffer), &buf_pos, c);
       } else {
         ops[op_count].type = OPERAND_REGISTER;
-        strncpy(ops[op_count].value, buffer, buf_pos);
-        ops[op_count].value[buf_pos] = '\0';
+        copy_field(ops[op_count].value, sizeof(ops[op_count].value), buffer, buf_pos);
         op_count++;
         buf_pos = 0;
         memset(buffer, 0, sizeof(buffer));
@@ -241,12 +313,11 @@ int parse_operands(const char *str, Operand *ops, int max_ops) {
       break;
 
     case STATE_IN_IMM:
-      if (isxdigit(c) || c == 'x') {
-        buffer[buf_pos++] = c;
+      if (op_isxdigit(c) || c == 'x') {
+        put_char(buffer, sizeof(buffer), &buf_pos, c);
       } else {
         ops[op_count].type = OPERAND_IMMEDIATE;
-        strncpy(ops[op_count].value, buffer, buf_pos);
-        ops[op_count].value[buf_pos] = '\0';
+        copy_field(ops[op_count].value, sizeof(ops[op_count].value), buffer, buf_pos);
         op_count++;
         buf_pos = 0;
         memset(buffer, 0, sizeof(buffer));
@@ -259,8 +330,7 @@ int parse_operands(const char *str, Operand *ops, int max_ops) {
 
     case STATE_IN_MEM_BASE:
       if (c == ',' || c == ']' || c == '\0') {
-        strncpy(memref.base_reg, buffer, buf_pos);
-        memref.base_reg[buf_pos] = '\0';
+        copy_field(memref.base_reg, sizeof(memref.base_reg), buffer, buf_pos);
         buf_pos = 0;
         memset(buffer, 0, sizeof(buffer));
 
@@ -275,7 +345,7 @@ int parse_operands(const char *str, Operand *ops, int max_ops) {
         }
         // 遇到逗号后，检查下一个字符是否是寄存器名
         pos++;
-        while (pos < len && isspace(clean_str[pos]))
+        while (pos < len && op_isspace(clean_str[pos]))
           pos++;
         if (pos < len && (clean_str[pos] == 'x' || clean_str[pos] == 'w')) {
           state = STATE_IN_MEM_INDEX;
@@ -286,14 +356,13 @@ int parse_operands(const char *str, Operand *ops, int max_ops) {
         }
         pos--; // 补偿循环的pos++
       } else {
-        buffer[buf_pos++] = c;
+        put_char(buffer, sizeof(buffer), &buf_pos, c);
       }
       break;
 
     case STATE_IN_MEM_INDEX:
       if (c == ',' || c == ']' || c == '\0') {
-        strncpy(memref.index_reg, buffer, buf_pos);
-        memref.index_reg[buf_pos] = '\0';
+        copy_field(memref.index_reg, sizeof(memref.index_reg), buffer, buf_pos);
         buf_pos = 0;
         memset(buffer, 0, sizeof(buffer));
 
@@ -308,12 +377,12 @@ int parse_operands(const char *str, Operand *ops, int max_ops) {
         }
         // 遇到逗号后，准备解析移位操作
         pos++;
-        while (pos < len && isspace(clean_str[pos]))
+        while (pos < len && op_isspace(clean_str[pos]))
           pos++;
         state = STATE_IN_MEM_SHIFT;
         pos--; // 补偿循环的pos++
       } else {
-        buffer[buf_pos++] = c;
+        put_char(buffer, sizeof(buffer), &buf_pos, c);
       }
       break;
 
@@ -331,33 +400,33 @@ int parse_operands(const char *str, Operand *ops, int max_ops) {
       } else if (c == ',') {
         // 跳过逗号，继续解析偏移量
         pos++;
-        while (pos < len && isspace(clean_str[pos]))
+        while (pos < len && op_isspace(clean_str[pos]))
           pos++;
         state = STATE_IN_MEM_OFFSET;
         pos--; // 补偿循环的pos++
-      } else if (isspace(c)) {
+      } else if (op_isspace(c)) {
         // 跳过空格
-      } else if (isalpha(c)) {
+      } else if (op_isalpha(c)) {
         // 解析移位操作符 (lsl, lsr, asr, ror)
-        buffer[buf_pos++] = c;
+        put_char(buffer, sizeof(buffer), &buf_pos, c);
       } else if (c == '#') {
         // 移位量 - 检查是否已经收集了移位操作符
         if (buf_pos > 0) {
           // 保存移位操作符
-          buffer[buf_pos] = '\0';
+          terminate(buffer, sizeof(buffer), buf_pos);
           strncpy(memref.shift_op, buffer, sizeof(memref.shift_op) - 1);
           buf_pos = 0;
         }
         // 开始收集移位量
         state = STATE_IN_MEM_SHIFT_AMOUNT;
-        buffer[buf_pos++] = c;
+        put_char(buffer, sizeof(buffer), &buf_pos, c);
       }
       break;
 
     case STATE_IN_MEM_SHIFT_AMOUNT:
-      if (c == ']' || c == ',' || isspace(c) || c == '\0') {
+      if (c == ']' || c == ',' || op_isspace(c) || c == '\0') {
         // 保存移位量
-        buffer[buf_pos] = '\0';
+        terminate(buffer, sizeof(buffer), buf_pos);
         strncpy(memref.shift_amount, buffer, sizeof(memref.shift_amount) - 1);
         buf_pos = 0;
 
@@ -379,14 +448,13 @@ int parse_operands(const char *str, Operand *ops, int max_ops) {
           continue; // 不增加pos，让外层循环处理当前字符
         }
       } else {
-        buffer[buf_pos++] = c;
+        put_char(buffer, sizeof(buffer), &buf_pos, c);
       }
       break;
 
     case STATE_IN_MEM_OFFSET:
       if (c == ']' || c == '\0') {
-        strncpy(memref.offset, buffer, buf_pos);
-        memref.offset[buf_pos] = '\0';
+        copy_field(memref.offset, sizeof(memref.offset), buffer, buf_pos);
         ops[op_count].type = OPERAND_MEMREF;
         memcpy(&ops[op_count].memref, &memref, sizeof(MemRef));
         op_count++;
@@ -397,17 +465,16 @@ int parse_operands(const char *str, Operand *ops, int max_ops) {
         state = STATE_START;
         continue;
       } else {
-        buffer[buf_pos++] = c;
+        put_char(buffer, sizeof(buffer), &buf_pos, c);
       }
       break;
 
     case STATE_IN_ADDR:
-      if (isxdigit(c)) {
-        buffer[buf_pos++] = c;
+      if (op_isxdigit(c)) {
+        put_char(buffer, sizeof(buffer), &buf_pos, c);
       } else {
         ops[op_count].type = OPERAND_ADDRESS;
-        strncpy(ops[op_count].value, buffer, buf_pos);
-        ops[op_count].value[buf_pos] = '\0';
+        copy_field(ops[op_count].value, sizeof(ops[op_count].value), buffer, buf_pos);
         op_count++;
         buf_pos = 0;
         memset(buffer, 0, sizeof(buffer));
@@ -421,8 +488,7 @@ int parse_operands(const char *str, Operand *ops, int max_ops) {
     case STATE_IN_OTHER:
       if (c == ',' || c == ' ' || c == '\0') {
         ops[op_count].type = OPERAND_OTHER;
-        strncpy(ops[op_count].value, buffer, buf_pos);
-        ops[op_count].value[buf_pos] = '\0';
+        copy_field(ops[op_count].value, sizeof(ops[op_count].value), buffer, buf_pos);
         op_count++;
         buf_pos = 0;
         memset(buffer, 0, sizeof(buffer));
@@ -431,7 +497,7 @@ int parse_operands(const char *str, Operand *ops, int max_ops) {
           pos++; // 跳过逗号
         continue;
       }
-      buffer[buf_pos++] = c;
+      put_char(buffer, sizeof(buffer), &buf_pos, c);
       break;
     }
 
@@ -442,13 +508,15 @@ int parse_operands(const char *str, Operand *ops, int max_ops) {
   if (state == STATE_IN_MEM_BASE || state == STATE_IN_MEM_INDEX ||
       state == STATE_IN_MEM_OFFSET || state == STATE_IN_MEM_SHIFT ||
       state == STATE_IN_MEM_SHIFT_AMOUNT) {
+    if (op_count >= max_ops)
+      return op_count;
     if (state == STATE_IN_MEM_SHIFT && buf_pos > 0) {
       // 处理未保存的移位操作符
-      buffer[buf_pos] = '\0';
+      terminate(buffer, sizeof(buffer), buf_pos);
       strncpy(memref.shift_op, buffer, sizeof(memref.shift_op) - 1);
     } else if (state == STATE_IN_MEM_SHIFT_AMOUNT && buf_pos > 0) {
       // 处理未保存的移位量
-      buffer[buf_pos] = '\0';
+      terminate(buffer, sizeof(buffer), buf_pos);
       strncpy(memref.shift_amount, buffer, sizeof(memref.shift_amount) - 1);
     }
 
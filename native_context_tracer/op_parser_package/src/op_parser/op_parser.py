@@ -167,6 +167,308 @@ def parse_disassembly(disassembly, max_lines=10):
     return [DisasmLine(c_lines[i]) for i in range(count)]
 
 
+_SCAN_KERNELS = {
+    "scalar": 0,
+    "sse2": 1,
+    "avx2": 2,
+    "neon": 3,
+}
+
+
+def get_scan_kernel():
+    """返回当前使用的扫描内核名称 (scalar/sse2/avx2/neon)"""
+    kernel = op_parser_lib.op_scan_get_kernel()
+    return ffi.string(op_parser_lib.op_scan_kernel_name(kernel)).decode("utf-8")
+
+
+def set_scan_kernel(name):
+    """强制使用指定扫描内核，CPU不支持时抛出ValueError"""
+    if name not in _SCAN_KERNELS:
+        raise ValueError(f"Unknown scan kernel: {name}")
+    if not op_parser_lib.op_scan_set_kernel(_SCAN_KERNELS[name]):
+        raise ValueError(f"Scan kernel not supported on this CPU: {name}")
+
+
+_REG_COUNT = 65
+
+
+def _regset_names(c_set):
+    regs = ffi.new(f"int[{_REG_COUNT}]")
+    count = op_parser_lib.op_regset_to_list(ffi.addressof(c_set), regs, _REG_COUNT)
+    return [ffi.string(op_parser_lib.op_reg_name(regs[i])).decode("utf-8") for i in range(count)]
+
+
+class InsnRegisters:
+    """单条指令的寄存器分析结果，寄存器统一用 x/v 编号 (w0 -> x0, d1 -> v1)"""
+
+    def __init__(self, c_line, c_insn):
+        self.addr = c_line.addr
+        self.opcode = ffi.string(c_line.opcode).decode("utf-8")
+        self.defs = _regset_names(c_insn.defs)
+        self.uses = _regset_names(c_insn.uses)
+        self.live_out = _regset_names(c_insn.live_out)
+        self.read_after = _regset_names(c_insn.read_after)  # 单步后需要读取的寄存器
+        self.block = c_insn.block
+
+    def __repr__(self):
+        return (
+            f"InsnRegisters(addr=0x{self.addr:x}, opcode={self.opcode}, "
+            f"defs={self.defs}, uses={self.uses}, read_after={self.read_after})"
+        )
+
+
+_BLOCK_END_KINDS = ["fallthrough", "branch", "cond_branch", "indirect", "return", "exit"]
+
+
+class BasicBlock:
+    def __init__(self, index, c_block):
+        self.index = index
+        self.first = c_block.first
+        self.last = c_block.last
+        self.start_addr = c_block.start_addr
+        self.end_addr = c_block.end_addr
+        self.end_kind = _BLOCK_END_KINDS[c_block.end_kind]
+        self.successors = [c_block.succ[i] for i in range(c_block.succ_count)]
+        self.live_in = _regset_names(c_block.live_in)
+        self.live_out = _regset_names(c_block.live_out)
+        self.read_set = _regset_names(c_block.read_set)  # 块内单步需要读取的寄存器并集
+
+    def __repr__(self):
+        return (
+            f"BasicBlock({self.index}, 0x{self.start_addr:x}-0x{self.end_addr:x}, "
+            f"{self.end_kind}, succ={self.successors}, read_set={self.read_set})"
+        )
+
+
+def instruction_registers(line):
+    """返回单行反汇编的 (defs, uses)，不做活跃性分析"""
+    c_line = ffi.new("DisasmLine *")
+    c_str = ffi.new("char[]", line.encode("utf-8"))
+    if not op_parser_lib.parse_disassembly_line(c_str, c_line):
+        raise ValueError("Failed to parse disassembly line")
+    c_def = ffi.new("OpRegSet *")
+    c_use = ffi.new("OpRegSet *")
+    op_parser_lib.op_regs_def_use(c_line, c_def, c_use)
+    return _regset_names(c_def[0]), _regset_names(c_use[0])
+
+
+def analyze_registers(disassembly, max_lines=4096):
+    """
+    对一个函数的反汇编做def-use和活跃性分析（ARM64）。
+    返回 (指令列表, 基本块列表)；单步跟踪时每条指令只需读取 read_after 中的寄存器。
+    """
+    c_lines = ffi.new(f"DisasmLine[{max_lines}]")
+    c_str = ffi.new("char[]", disassembly.encode("utf-8"))
+    count = op_parser_lib.parse_disassembly(c_str, c_lines, max_lines)
+
+    c_insns = ffi.new(f"OpInsnRegs[{max(count, 1)}]")
+    c_blocks = ffi.new(f"OpBlock[{max(count, 1)}]")
+    n_blocks = op_parser_lib.op_regs_analyze(c_lines, count, c_insns, c_blocks, max(count, 1))
+    if n_blocks < 0:
+        raise ValueError("Register analysis failed: instructions must be in ascending address order")
+
+    insns = [InsnRegisters(c_lines[i], c_insns[i]) for i in range(count)]
+    blocks = [BasicBlock(i, c_blocks[i]) for i in range(n_blocks)]
+    return insns, blocks
+
+
+_SYMBOL_KINDS = ["func", "object", "plt"]
+
+
+class Symbol:
+    def __init__(self, c_sym):
+        self.name = ffi.string(c_sym.name).decode("utf-8", errors="replace")
+        self.addr = c_sym.addr
+        self.size = c_sym.size
+        self.kind = _SYMBOL_KINDS[c_sym.kind]
+        self.weak = bool(c_sym.weak)
+        self.module = c_sym.module
+
+    def __repr__(self):
+        weak = ", weak" if self.weak else ""
+        return f"Symbol({self.name}, 0x{self.addr:x}, size={self.size}, {self.kind}{weak})"
+
+
+class SymbolizedLine:
+    """一条反汇编的符号化结果，symbol/target_symbol 为 None 表示未找到"""
+
+    def __init__(self, line, symbol, offset, target, target_symbol, target_offset):
+        self.line = line
+        self.symbol = symbol
+        self.offset = offset
+        self.target = target
+        self.target_symbol = target_symbol
+        self.target_offset = target_offset
+
+    def location(self):
+        return _format_location(self.symbol, self.offset)
+
+    def target_location(self):
+        return _format_location(self.target_symbol, self.target_offset)
+
+    def __repr__(self):
+        return f"SymbolizedLine(0x{self.line.addr:x} {self.location()} -> {self.target_location()})"
+
+
+def _format_location(symbol, offset):
+    if symbol is None:
+        return None
+    return f"{symbol.name}+{offset}" if offset else symbol.name
+
+
+class SymbolTable:
+    """
+    从ELF的 .symtab/.dynsym 加载的原生符号表，包含由 .rela.plt 推导的 name@plt 桩。
+    地址按区间索引查找，批量符号化反汇编时不需要调试器调用。
+    """
+
+    def __init__(self):
+        self._tab = ffi.gc(op_parser_lib.op_symtab_create(), op_parser_lib.op_symtab_destroy)
+        self._cache = {}
+
+    def load_elf(self, path, load_bias=0):
+        """加载模块，load_bias 为运行时地址与文件虚拟地址之差，返回模块编号"""
+        module = op_parser_lib.op_symtab_load_elf(self._tab, str(path).encode("utf-8"), load_bias)
+        if module < 0:
+            raise ValueError(f"Failed to load ELF symbols: {path}")
+        self._cache.clear()  # 加载后符号下标会重新排序
+        return module
+
+    def __len__(self):
+        return op_parser_lib.op_symtab_count(self._tab)
+
+    def module_path(self, module):
+        path = op_parser_lib.op_symtab_module_path(self._tab, module)
+        return None if path == ffi.NULL else ffi.string(path).decode("utf-8")
+
+    def _symbol(self, index):
+        if index < 0:
+            return None
+        symbol = self._cache.get(index)
+        if symbol is None:
+            symbol = Symbol(op_parser_lib.op_symtab_get(self._tab, index))
+            self._cache[index] = symbol
+        return symbol
+
+    def lookup(self, addr):
+        """返回 (Symbol, offset)，找不到返回 (None, 0)"""
+        offset = ffi.new("uint64_t *")
+        index = op_parser_lib.op_symtab_lookup(self._tab, addr, offset)
+        if index < 0:
+            return None, 0
+        return self._symbol(index), offset[0]
+
+    def find(self, name):
+        return self._symbol(op_parser_lib.op_symtab_find(self._tab, name.encode("utf-8")))
+
+    def symbolize(self, lines):
+        """批量符号化反汇编文本或 DisasmLine 列表"""
+        if isinstance(lines, str):
+            max_lines = lines.count("\n") + 1
+            c_lines = ffi.new(f"DisasmLine[{max_lines}]")
+            c_str = ffi.new("char[]", lines.encode("utf-8"))
+            count = op_parser_lib.parse_disassembly(c_str, c_lines, max_lines)
+            py_lines = [DisasmLine(c_lines[i]) for i in range(count)]
+        else:
+            py_lines = list(lines)
+            count = len(py_lines)
+            c_lines = ffi.new(f"DisasmLine[{max(count, 1)}]")
+            for i, line in enumerate(py_lines):
+                # 符号化只需要地址和地址操作数
+                c_lines[i].addr = line.addr
+                addresses = [op for op in line.operands if op.type == OperandType.ADDRESS]
+                if addresses:
+                    c_lines[i].operand_count = 1
+                    c_lines[i].operands[0].type = OperandType.ADDRESS
+                    c_lines[i].operands[0].value = addresses[-1].value.encode("utf-8")[:127]
+
+        c_out = ffi.new(f"OpSymbolized[{max(count, 1)}]")
+        op_parser_lib.op_symtab_symbolize(self._tab, c_lines, count, c_out)
+        results = []
+        for i in range(count):
+            r = c_out[i]
+            results.append(
+                SymbolizedLine(
+                    py_lines[i],
+                    self._symbol(r.symbol),
+                    r.offset,
+                    r.target,
+                    self._symbol(r.target_symbol),
+                    r.target_offset,
+                )
+            )
+        return results
+
+
+class LineEntry:
+    """行号表中的一行，addr 为ELF文件中的虚拟地址"""
+
+    def __init__(self, addr, file, line, column, flags):
+        self.addr = addr
+        self.file = file
+        self.line = line
+        self.column = column
+        self.is_stmt = bool(flags & op_parser_lib.OP_LINE_IS_STMT)
+        self.end_sequence = bool(flags & op_parser_lib.OP_LINE_END_SEQUENCE)
+        self.prologue_end = bool(flags & op_parser_lib.OP_LINE_PROLOGUE_END)
+
+    def __repr__(self):
+        return f"LineEntry(0x{self.addr:x}, {self.file}:{self.line}:{self.column})"
+
+
+class LineTable:
+    """
+    ELF .debug_line 的原生读取器，支持 DWARF 2-5。
+    给定 cache_dir 时以 build-id 为键缓存展开后的行表（<build-id>.oplines），
+    之后的打开只需 mmap 缓存文件，不再解析DWARF。
+    """
+
+    def __init__(self, elf_path, cache_dir=None):
+        c_dir = str(cache_dir).encode("utf-8") if cache_dir else ffi.NULL
+        table = op_parser_lib.op_lines_open(str(elf_path).encode("utf-8"), c_dir)
+        if table == ffi.NULL:
+            raise ValueError(f"No usable .debug_line in {elf_path}")
+        self._table = ffi.gc(table, op_parser_lib.op_lines_close)
+        self._files = {}
+
+    def __len__(self):
+        return op_parser_lib.op_lines_count(self._table)
+
+    @property
+    def build_id(self):
+        return ffi.string(op_parser_lib.op_lines_build_id(self._table)).decode("ascii")
+
+    @property
+    def from_cache(self):
+        return bool(op_parser_lib.op_lines_from_cache(self._table))
+
+    def file(self, index):
+        path = self._files.get(index)
+        if path is None:
+            c_path = op_parser_lib.op_lines_file(self._table, index)
+            if c_path == ffi.NULL:
+                return None
+            path = ffi.string(c_path).decode("utf-8", errors="replace")
+            self._files[index] = path
+        return path
+
+    def files(self):
+        return [self.file(i) for i in range(op_parser_lib.op_lines_file_count(self._table))]
+
+    def _entry(self, index):
+        row = op_parser_lib.op_lines_row(self._table, index)
+        return LineEntry(row.addr, self.file(row.file), row.line, row.column, row.flags)
+
+    def lookup(self, addr, load_bias=0):
+        """返回包含运行时地址 addr 的 LineEntry，不在任何序列内时返回 None"""
+        index = op_parser_lib.op_lines_lookup(self._table, addr - load_bias)
+        return None if index < 0 else self._entry(index)
+
+    def __iter__(self):
+        for i in range(len(self)):
+            yield self._entry(i)
+
+
 if __name__ == "__main__":
     # Test operand parsing
     test_cases = [
@@ -0,0 +1,567 @@
+#include "op_regs.h"
+#include "op_scan.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *reg_names[OP_REG_COUNT] = {
+    "x0",  "x1",  "x2",  "x3",  "x4",  "x5",  "x6",  "x7",  "x8",  "x9",
+    "x10", "x11", "x12", "x13", "x14", "x15", "x16", "x17", "x18", "x19",
+    "x20", "x21", "x22", "x23", "x24", "x25", "x26", "x27", "x28", "x29",
+    "x30", "sp",  "nzcv", "v0", "v1", "v2", "v3", "v4", "v5", "v6",
+    "v7",  "v8",  "v9",  "v10", "v11", "v12", "v13", "v14", "v15", "v16",
+    "v17", "v18", "v19", "v20", "v21", "v22", "v23", "v24", "v25", "v26",
+    "v27", "v28", "v29", "v30", "v31"};
+
+const char *op_reg_name(int reg) {
+  if (reg < 0 || reg >= OP_REG_COUNT)
+    return "";
+  return reg_names[reg];
+}
+
+static void regset_clear(OpRegSet *set) { set->bits[0] = set->bits[1] = 0; }
+
+static void regset_add_range(OpRegSet *set, int first, int last) {
+  for (int r = first; r <= last; r++)
+    op_regset_add(set, r);
+}
+
+static void regset_or(OpRegSet *dst, const OpRegSet *src) {
+  dst->bits[0] |= src->bits[0];
+  dst->bits[1] |= src->bits[1];
+}
+
+static int regset_equal(const OpRegSet *a, const OpRegSet *b) {
+  return a->bits[0] == b->bits[0] && a->bits[1] == b->bits[1];
+}
+
+static void regset_all(OpRegSet *set) {
+  regset_clear(set);
+  regset_add_range(set, 0, OP_REG_COUNT - 1);
+}
+
+int op_regset_count(const OpRegSet *set) {
+  return __builtin_popcountll(set->bits[0]) +
+         __builtin_popcountll(set->bits[1]);
+}
+
+int op_regset_to_list(const OpRegSet *set, int *regs, int max_regs) {
+  int n = 0;
+  for (int r = 0; r < OP_REG_COUNT && n < max_regs; r++) {
+    if (op_regset_has(set, r))
+      regs[n++] = r;
+  }
+  return n;
+}
+
+// 解析 0-30/0-31 的寄存器序号，后面只能跟 '.'、'['、'}' 或结束
+static int parse_reg_index(const char *p, int max) {
+  if (!op_isdigit(*p))
+    return -1;
+  int n = 0;
+  while (op_isdigit(*p)) {
+    n = n * 10 + (*p - '0');
+    if (n > max)
+      return -1;
+    p++;
+  }
+  if (*p != '\0' && *p != '.' && *p != '[' && *p != '}')
+    return -1;
+  return n;
+}
+
+int op_reg_from_name(const char *name) {
+  while (*name == '{' || op_isspace(*name))
+    name++;
+
+  // 以 '.' '[' '}' 结尾的视为寄存器名结束
+  char base[8];
+  int len = 0;
+  while (name[len] && name[len] != '.' && name[len] != '[' &&
+         name[len] != '}' && !op_isspace(name[len])) {
+    if (len >= (int)sizeof(base) - 1)
+      return -1;
+    base[len] = name[len];
+    len++;
+  }
+  base[len] = '\0';
+
+  if (strcmp(base, "sp") == 0 || strcmp(base, "wsp") == 0)
+    return OP_REG_SP;
+  if (strcmp(base, "fp") == 0)
+    return OP_REG_FP;
+  if (strcmp(base, "lr") == 0)
+    return OP_REG_LR;
+  if (strcmp(base, "ip0") == 0)
+    return 16;
+  if (strcmp(base, "ip1") == 0)
+    return 17;
+  if (strcmp(base, "nzcv") == 0)
+    return OP_REG_NZCV;
+
+  int n;
+  switch (base[0]) {
+  case 'x':
+  case 'w':
+    n = parse_reg_index(base + 1, 30);
+    return n < 0 ? -1 : OP_REG_X0 + n;
+  case 'v':
+  case 'q':
+  case 'd':
+  case 's':
+  case 'h':
+  case 'b':
+    n = parse_reg_index(base + 1, 31);
+    return n < 0 ? -1 : OP_REG_V0 + n;
+  default:
+    return -1;
+  }
+}
+
+// 操作数中的寄存器：REGISTER/OTHER 按名字识别，MEMREF 取基址和索引
+static int operand_reg(const Operand *op) {
+  if (op->type == OPERAND_REGISTER || op->type == OPERAND_OTHER)
+    return op_reg_from_name(op->value);
+  return -1;
+}
+
+static void add_memref_regs(const Operand *op, OpRegSet *set) {
+  int r = op_reg_from_name(op->memref.base_reg);
+  if (r >= 0)
+    op_regset_add(set, r);
+  r = op_reg_from_name(op->memref.index_reg);
+  if (r >= 0)
+    op_regset_add(set, r);
+}
+
+static int starts_with(const char *s, const char *prefix) {
+  return strncmp(s, prefix, strlen(prefix)) == 0;
+}
+
+static int opcode_in(const char *opcode, const char *const *list) {
+  for (; *list; list++) {
+    if (strcmp(opcode, *list) == 0)
+      return 1;
+  }
+  return 0;
+}
+
+typedef enum {
+  INSN_DEFAULT,    // 第一个寄存器为目的，其余为源
+  INSN_RMW,        // 目的寄存器同时被读取 (movk/bfi...)
+  INSN_COMPARE,    // 只读操作数，写 nzcv
+  INSN_LOAD,       // 内存引用之前的寄存器都是目的
+  INSN_STORE,      // 全部是源
+  INSN_STORE_EXCL, // stxr 类：第一个寄存器是状态目的
+  INSN_ATOMIC,     // ldadd/swp 类：第二个寄存器是目的
+  INSN_CAS,        // cas 类：第一个寄存器读写
+  INSN_BRANCH,     // b
+  INSN_COND_BRANCH,
+  INSN_CALL,       // bl/blr
+  INSN_INDIRECT,   // br
+  INSN_RETURN,     // ret
+  INSN_SYSCALL,    // svc
+  INSN_PAC,        // paciasp/autiasp
+  INSN_NONE        // nop/屏障等
+} InsnKind;
+
+static const char *const rmw_ops[] = {"movk", "bfi", "bfxil", "bfm", "bfc",
+                                      "ins",  "fmla", "fmls", "mla", "mls",
+                                      NULL};
+static const char *const compare_ops[] = {"cmp",  "cmn",  "tst",   "fcmp",
+                                          "fcmpe", "ccmp", "ccmn", "fccmp",
+                                          "fccmpe", NULL};
+static const char *const flag_setting_ops[] = {
+    "adds", "subs", "ands", "bics", "adcs", "sbcs", "negs", "ngcs", NULL};
+static const char *const flag_reading_ops[] = {
+    "csel", "csinc", "csinv", "csneg", "cset", "csetm", "cinc", "cinv",
+    "cneg", "fcsel", "adc",   "adcs",  "sbc",  "sbcs",  "ngc",  "ngcs",
+    "ccmp", "ccmn",  "fccmp", "fccmpe", NULL};
+static const char *const atomic_prefixes[] = {
+    "ldadd", "ldclr", "ldeor", "ldset", "ldsmax", "ldsmin",
+    "ldumax", "ldumin", "swp", NULL};
+static const char *const none_ops[] = {"nop",  "hint", "dmb", "dsb", "isb",
+                                       "yield", "brk", "udf", "bti", "clrex",
+                                       NULL};
+
+static InsnKind classify(const char *opcode) {
+  if (strcmp(opcode, "b") == 0)
+    return INSN_BRANCH;
+  if (starts_with(opcode, "b.") || opcode_in(opcode, (const char *const[]){
+                                        "cbz", "cbnz", "tbz", "tbnz", NULL}))
+    return INSN_COND_BRANCH;
+  if (strcmp(opcode, "bl") == 0 || starts_with(opcode, "blr"))
+    return INSN_CALL;
+  if (starts_with(opcode, "br"))
+    return opcode_in(opcode, (const char *const[]){"br", "braa", "braaz",
+                                                   "brab", "brabz", NULL})
+               ? INSN_INDIRECT
+               : INSN_NONE;
+  if (starts_with(opcode, "ret"))
+    return INSN_RETURN;
+  if (strcmp(opcode, "svc") == 0)
+    return INSN_SYSCALL;
+  if (opcode_in(opcode, (const char *const[]){"paciasp", "autiasp", "pacibsp",
+                                              "autibsp", NULL}))
+    return INSN_PAC;
+  if (opcode_in(opcode, none_ops))
+    return INSN_NONE;
+  if (opcode_in(opcode, compare_ops))
+    return INSN_COMPARE;
+  if (opcode_in(opcode, rmw_ops))
+    return INSN_RMW;
+  for (const char *const *p = atomic_prefixes; *p; p++) {
+    if (starts_with(opcode, *p))
+      return INSN_ATOMIC;
+  }
+  if (starts_with(opcode, "cas"))
+    return INSN_CAS;
+  if (starts_with(opcode, "prfm") || starts_with(opcode, "prfum"))
+    return INSN_STORE; // 只读内存引用中的寄存器
+  if (starts_with(opcode, "stxr") || starts_with(opcode, "stlxr") ||
+      starts_with(opcode, "stxp") || starts_with(opcode, "stlxp"))
+    return INSN_STORE_EXCL;
+  if (starts_with(opcode, "ld"))
+    return INSN_LOAD;
+  if (starts_with(opcode, "st"))
+    return INSN_STORE;
+  return INSN_DEFAULT;
+}
+
+// AAPCS64 调用者保存寄存器：x0-x18, nzcv, v0-v7, v16-v31
+static void add_call_clobbers(OpRegSet *set) {
+  regset_add_range(set, 0, 18);
+  op_regset_add(set, OP_REG_NZCV);
+  regset_add_range(set, OP_REG_V0, OP_REG_V0 + 7);
+  regset_add_range(set, OP_REG_V0 + 16, OP_REG_V0 + 31);
+}
+
+// 参数寄存器：x0-x8, sp, v0-v7；fp 作为栈帧链被被调用者和回溯读取
+static void add_call_args(OpRegSet *set) {
+  regset_add_range(set, 0, 8);
+  op_regset_add(set, OP_REG_FP);
+  op_regset_add(set, OP_REG_SP);
+  regset_add_range(set, OP_REG_V0, OP_REG_V0 + 7);
+}
+
+void op_regs_def_use(const DisasmLine *line, OpRegSet *def, OpRegSet *use) {
+  regset_clear(def);
+  regset_clear(use);
+
+  InsnKind kind = classify(line->opcode);
+  int count = line->operand_count;
+  int memref = -1;
+  for (int i = 0; i < count; i++) {
+    if (line->operands[i].type == OPERAND_MEMREF) {
+      memref = i;
+      break;
+    }
+  }
+
+  // 内存引用的基址/索引总是被读取；后面还有操作数 ("!" 或 ", #imm")
+  // 说明是前/后变址，基址被回写
+  if (memref >= 0) {
+    add_memref_regs(&line->operands[memref], use);
+    if (memref + 1 < count) {
+      int base = op_reg_from_name(line->operands[memref].memref.base_reg);
+      if (base >= 0)
+        op_regset_add(def, base);
+    }
+  }
+
+  int first_reg = -1;
+  for (int i = 0; i < count; i++) {
+    if (i == memref)
+      continue;
+    int r = operand_reg(&line->operands[i]);
+    if (r < 0)
+      continue;
+    if (first_reg < 0)
+      first_reg = i;
+
+    switch (kind) {
+    case INSN_DEFAULT:
+    case INSN_RMW:
+      if (i == first_reg) {
+        op_regset_add(def, r);
+        if (kind == INSN_RMW)
+          op_regset_add(use, r);
+      } else {
+        op_regset_add(use, r);
+      }
+      break;
+    case INSN_LOAD:
+      if (memref < 0 || i < memref)
+        op_regset_add(def, r);
+      else
+        op_regset_add(use, r);
+      break;
+    case INSN_STORE_EXCL:
+      op_regset_add(i == first_reg ? def : use, r);
+      break;
+    case INSN_ATOMIC:
+      // ldadd xs, xt, [xn]: xs 为源，xt 接收旧值
+      op_regset_add(i == first_reg ? use : def, r);
+      break;
+    case INSN_CAS:
+      op_regset_add(use, r);
+      if (i == first_reg)
+        op_regset_add(def, r);
+      break;
+    case INSN_NONE:
+      break;
+    default:
+      op_regset_add(use, r);
+      break;
+    }
+  }
+
+  switch (kind) {
+  case INSN_COMPARE:
+    op_regset_add(def, OP_REG_NZCV);
+    break;
+  case INSN_COND_BRANCH:
+    if (line->opcode[0] == 'b')
+      op_regset_add(use, OP_REG_NZCV);
+    break;
+  case INSN_CALL:
+    add_call_args(use);
+    add_call_clobbers(def);
+    op_regset_add(def, OP_REG_LR);
+    break;
+  case INSN_RETURN:
+    if (count == 0)
+      op_regset_add(use, OP_REG_LR);
+    break;
+  case INSN_SYSCALL:
+    // Linux 用 x8 传调用号，macOS 用 x16 并通过进位标志返回错误
+    regset_add_range(use, 0, 8);
+    op_regset_add(use, 16);
+    op_regset_add(def, 0);
+    op_regset_add(def, 1);
+    op_regset_add(def, OP_REG_NZCV);
+    break;
+  case INSN_PAC:
+    op_regset_add(use, OP_REG_LR);
+    op_regset_add(use, OP_REG_SP);
+    op_regset_add(def, OP_REG_LR);
+    break;
+  default:
+    break;
+  }
+
+  if (opcode_in(line->opcode, flag_setting_ops))
+    op_regset_add(def, OP_REG_NZCV);
+  if (opcode_in(line->opcode, flag_reading_ops))
+    op_regset_add(use, OP_REG_NZCV);
+}
+
+// 直接跳转的目标地址：最后一个 ADDRESS 操作数
+static int branch_target(const DisasmLine *line, uint64_t *target) {
+  for (int i = line->operand_count - 1; i >= 0; i--) {
+    const Operand *op = &line->operands[i];
+    if (op->type == OPERAND_ADDRESS) {
+      char *end;
+      *target = strtoull(op->value, &end, 16);
+      return end != op->value;
+    }
+  }
+  return 0;
+}
+
+static int find_addr(const DisasmLine *lines, int count, uint64_t addr) {
+  int lo = 0, hi = count - 1;
+  while (lo <= hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (lines[mid].addr == addr)
+      return mid;
+    if (lines[mid].addr < addr)
+      lo = mid + 1;
+    else
+      hi = mid - 1;
+  }
+  return -1;
+}
+
+// ret 之后活跃的寄存器：返回值 x0-x1/v0-v3（AAPCS64 复合类型/HFA 上限）、
+// 被调用者保存的 x19-x29/v8-v15、sp 和 lr
+static void return_live_set(OpRegSet *set) {
+  regset_clear(set);
+  regset_add_range(set, 0, 1);
+  regset_add_range(set, 19, OP_REG_SP);
+  regset_add_range(set, OP_REG_V0, OP_REG_V0 + 3);
+  regset_add_range(set, OP_REG_V0 + 8, OP_REG_V0 + 15);
+}
+
+int op_regs_analyze(const DisasmLine *lines, int count, OpInsnRegs *insns,
+                    OpBlock *blocks, int max_blocks) {
+  if (count < 0 || (count > 0 && (!lines || !insns || !blocks)))
+    return -1;
+  if (count == 0)
+    return 0;
+
+  for (int i = 1; i < count; i++) {
+    if (lines[i].addr <= lines[i - 1].addr)
+      return -1;
+  }
+
+  // 1. 找基本块首指令：第一条、跳转目标、控制流指令的下一条
+  unsigned char *leader = calloc((size_t)count, 1);
+  int *target_index = malloc(sizeof(int) * (size_t)count);
+  InsnKind *kinds = malloc(sizeof(InsnKind) * (size_t)count);
+  if (!leader || !target_index || !kinds) {
+    free(leader);
+    free(target_index);
+    free(kinds);
+    return -1;
+  }
+  leader[0] = 1;
+  for (int i = 0; i < count; i++) {
+    op_regs_def_use(&lines[i], &insns[i].defs, &insns[i].uses);
+    kinds[i] = classify(lines[i].opcode);
+    target_index[i] = -1;
+
+    InsnKind k = kinds[i];
+    if (k == INSN_BRANCH || k == INSN_COND_BRANCH) {
+      uint64_t target;
+      if (branch_target(&lines[i], &target))
+        target_index[i] = find_addr(lines, count, target);
+      if (target_index[i] >= 0)
+        leader[target_index[i]] = 1;
+    }
+    if ((k == INSN_BRANCH || k == INSN_COND_BRANCH || k == INSN_INDIRECT ||
+         k == INSN_RETURN) &&
+        i + 1 < count)
+      leader[i + 1] = 1;
+  }
+
+  // 2. 划分基本块
+  int n_blocks = 0;
+  for (int i = 0; i < count; i++) {
+    if (!leader[i])
+      continue;
+    if (n_blocks >= max_blocks) {
+      n_blocks = -1;
+      break;
+    }
+    OpBlock *b = &blocks[n_blocks];
+    memset(b, 0, sizeof(*b));
+    b->first = i;
+    b->start_addr = lines[i].addr;
+    n_blocks++;
+  }
+  if (n_blocks < 0) {
+    free(leader);
+    free(target_index);
+    free(kinds);
+    return -1;
+  }
+  for (int bi = 0; bi < n_blocks; bi++) {
+    OpBlock *b = &blocks[bi];
+    b->last = bi + 1 < n_blocks ? blocks[bi + 1].first - 1 : count - 1;
+    b->end_addr = lines[b->last].addr;
+    for (int i = b->first; i <= b->last; i++)
+      insns[i].block = bi;
+  }
+
+  // 3. 后继边
+  for (int bi = 0; bi < n_blocks; bi++) {
+    OpBlock *b = &blocks[bi];
+    int last = b->last;
+    int fall = bi + 1 < n_blocks ? bi + 1 : -1;
+    int target = target_index[last] >= 0 ? insns[target_index[last]].block : -1;
+    b->succ[0] = b->succ[1] = -1;
+
+    switch (kinds[last]) {
+    case INSN_BRANCH:
+      b->end_kind = target >= 0 ? OP_BLOCK_BRANCH : OP_BLOCK_EXIT;
+      if (target >= 0)
+        b->succ[b->succ_count++] = target;
+      break;
+    case INSN_COND_BRANCH:
+      b->end_kind = OP_BLOCK_COND_BRANCH;
+      if (fall >= 0)
+        b->succ[b->succ_count++] = fall;
+      if (target >= 0 && target != fall)
+        b->succ[b->succ_count++] = target;
+      break;
+    case INSN_INDIRECT:
+      b->end_kind = OP_BLOCK_INDIRECT;
+      break;
+    case INSN_RETURN:
+      b->end_kind = OP_BLOCK_RETURN;
+      break;
+    default:
+      b->end_kind = fall >= 0 ? OP_BLOCK_FALLTHROUGH : OP_BLOCK_EXIT;
+      if (fall >= 0)
+        b->succ[b->succ_count++] = fall;
+      break;
+    }
+  }
+
+  // 4. 块内 def/use（向上暴露的 use）
+  for (int bi = 0; bi < n_blocks; bi++) {
+    OpBlock *b = &blocks[bi];
+    for (int i = b->first; i <= b->last; i++) {
+      OpRegSet exposed = insns[i].uses;
+      exposed.bits[0] &= ~b->defs.bits[0];
+      exposed.bits[1] &= ~b->defs.bits[1];
+      regset_or(&b->uses, &exposed);
+      regset_or(&b->defs, &insns[i].defs);
+    }
+  }
+
+  // 5. 反向迭代求不动点：live_out = ∪ succ.live_in，
+  //    live_in = use ∪ (live_out - def)
+  //    间接跳转和跳出序列时保守地认为全部寄存器活跃
+  OpRegSet all, ret_live;
+  regset_all(&all);
+  return_live_set(&ret_live);
+  int changed = 1;
+  while (changed) {
+    changed = 0;
+    for (int bi = n_blocks - 1; bi >= 0; bi--) {
+      OpBlock *b = &blocks[bi];
+      OpRegSet out;
+      regset_clear(&out);
+      if (b->end_kind == OP_BLOCK_RETURN)
+        out = ret_live;
+      else if (b->end_kind == OP_BLOCK_INDIRECT ||
+               b->end_kind == OP_BLOCK_EXIT)
+        out = all;
+      else if (b->end_kind == OP_BLOCK_COND_BRANCH &&
+               (target_index[b->last] < 0 || bi + 1 >= n_blocks))
+        out = all; // 有一条边离开了当前序列
+      for (int s = 0; s < b->succ_count; s++)
+        regset_or(&out, &blocks[b->succ[s]].live_in);
+
+      OpRegSet in = out;
+      in.bits[0] = b->uses.bits[0] | (out.bits[0] & ~b->defs.bits[0]);
+      in.bits[1] = b->uses.bits[1] | (out.bits[1] & ~b->defs.bits[1]);
+      if (!regset_equal(&out, &b->live_out) || !regset_equal(&in, &b->live_in)) {
+        b->live_out = out;
+        b->live_in = in;
+        changed = 1;
+      }
+    }
+  }
+
+  // 6. 指令级活跃性和单步后需要读取的寄存器
+  for (int bi = 0; bi < n_blocks; bi++) {
+    OpBlock *b = &blocks[bi];
+    OpRegSet live = b->live_out;
+    for (int i = b->last; i >= b->first; i--) {
+      OpInsnRegs *insn = &insns[i];
+      insn->live_out = live;
+      insn->read_after.bits[0] = insn->defs.bits[0] & live.bits[0];
+      insn->read_after.bits[1] = insn->defs.bits[1] & live.bits[1];
+      regset_or(&b->read_set, &insn->read_after);
+      live.bits[0] = insn->uses.bits[0] | (live.bits[0] & ~insn->defs.bits[0]);
+      live.bits[1] = insn->uses.bits[1] | (live.bits[1] & ~insn->defs.bits[1]);
+    }
+  }
+
+  free(leader);
+  free(target_index);
+  free(kinds);
+  return n_blocks;
+}
@@ -0,0 +1,319 @@
+#include "op_scan.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define OP_SCAN_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define OP_SCAN_ARM64 1
+#include <arm_neon.h>
+#endif
+
+#define A OP_CC_ALPHA
+#define D (OP_CC_DIGIT | OP_CC_XDIGIT)
+#define X (OP_CC_ALPHA | OP_CC_XDIGIT)
+#define S OP_CC_SPACE
+#define P OP_CC_DELIM
+
+// 等价于 "C" locale 下的 ctype 结果，外加分隔符位；0x80 以上一律无分类
+const uint8_t op_char_class[256] = {
+    // 0x00 - 0x0f: \t \n \v \f \r 为空白，\n 同时是分隔符
+    0, 0, 0, 0, 0, 0, 0, 0, 0, S, S | P, S, S, S, 0, 0,
+    // 0x10 - 0x1f
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    // 0x20 - 0x2f:   ! " # $ % & ' ( ) * + , - . /
+    S, 0, 0, P, 0, 0, 0, 0, 0, 0, 0, P, P, P, 0, 0,
+    // 0x30 - 0x3f: 0-9 : ; < = > ?
+    D, D, D, D, D, D, D, D, D, D, P, P, P, 0, P, 0,
+    // 0x40 - 0x4f: @ A-O
+    0, X, X, X, X, X, X, A, A, A, A, A, A, A, A, A,
+    // 0x50 - 0x5f: P-Z [ \ ] ^ _
+    A, A, A, A, A, A, A, A, A, A, A, P, 0, P, 0, 0,
+    // 0x60 - 0x6f: ` a-o
+    0, X, X, X, X, X, X, A, A, A, A, A, A, A, A, A,
+    // 0x70 - 0x7f: p-z { | } ~ DEL
+    A, A, A, A, A, A, A, A, A, A, A, 0, 0, 0, 0, 0,
+};
+
+#undef A
+#undef D
+#undef X
+#undef S
+#undef P
+
+typedef const char *(*newline_fn)(const char *p, const char *end);
+typedef size_t (*delims_fn)(const char *p, size_t len, uint16_t *offsets,
+                            uint8_t *kinds, size_t max);
+
+/* ---------------- scalar ---------------- */
+
+static const char *newline_scalar(const char *p, const char *end) {
+  const char *hit = memchr(p, '\n', (size_t)(end - p));
+  return hit ? hit : end;
+}
+
+static size_t delims_scalar_from(const char *p, size_t start, size_t len,
+                                 uint16_t *offsets, uint8_t *kinds, size_t max,
+                                 size_t count) {
+  for (size_t i = start; i < len && count < max; i++) {
+    if (op_isdelim(p[i])) {
+      offsets[count] = (uint16_t)i;
+      kinds[count] = (uint8_t)p[i];
+      count++;
+    }
+  }
+  return count;
+}
+
+static size_t delims_scalar(const char *p, size_t len, uint16_t *offsets,
+                            uint8_t *kinds, size_t max) {
+  return delims_scalar_from(p, 0, len, offsets, kinds, max, 0);
+}
+
+// 把一个分隔符位图展开到输出数组
+static size_t emit_mask(const char *p, size_t base, uint64_t mask,
+                        uint16_t *offsets, uint8_t *kinds, size_t max,
+                        size_t count) {
+  while (mask && count < max) {
+    size_t i = base + (size_t)__builtin_ctzll(mask);
+    offsets[count] = (uint16_t)i;
+    kinds[count] = (uint8_t)p[i];
+    count++;
+    mask &= mask - 1;
+  }
+  return count;
+}
+
+/* ---------------- x86-64 ---------------- */
+
+#ifdef OP_SCAN_X86
+
+static const char *newline_sse2(const char *p, const char *end) {
+  const __m128i nl = _mm_set1_epi8('\n');
+  while (end - p >= 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, nl));
+    if (mask)
+      return p + __builtin_ctz((unsigned)mask);
+    p += 16;
+  }
+  return newline_scalar(p, end);
+}
+
+static inline __m128i delim_cmp_sse2(__m128i v) {
+  __m128i m = _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('<')));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('>')));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8(':')));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('[')));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8(']')));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8(',')));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('#')));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('+')));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('-')));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8(';')));
+  return m;
+}
+
+static size_t delims_sse2(const char *p, size_t len, uint16_t *offsets,
+                          uint8_t *kinds, size_t max) {
+  size_t i = 0, count = 0;
+  for (; i + 16 <= len && count < max; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+    uint64_t mask = (unsigned)_mm_movemask_epi8(delim_cmp_sse2(v));
+    count = emit_mask(p, i, mask, offsets, kinds, max, count);
+  }
+  return delims_scalar_from(p, i, len, offsets, kinds, max, count);
+}
+
+__attribute__((target("avx2"))) static const char *
+newline_avx2(const char *p, const char *end) {
+  const __m256i nl = _mm256_set1_epi8('\n');
+  while (end - p >= 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl));
+    if (mask)
+      return p + __builtin_ctz(mask);
+    p += 32;
+  }
+  return newline_sse2(p, end);
+}
+
+__attribute__((target("avx2"))) static size_t
+delims_avx2(const char *p, size_t len, uint16_t *offsets, uint8_t *kinds,
+            size_t max) {
+  static const char set[] = "\n<>:[],#+-;";
+  size_t i = 0, count = 0;
+  for (; i + 32 <= len && count < max; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+    __m256i m = _mm256_setzero_si256();
+    for (size_t k = 0; k < sizeof(set) - 1; k++)
+      m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(set[k])));
+    uint64_t mask = (unsigned)_mm256_movemask_epi8(m);
+    count = emit_mask(p, i, mask, offsets, kinds, max, count);
+  }
+  if (count >= max)
+    return count;
+  size_t rest = delims_sse2(p + i, len - i, offsets + count, kinds + count,
+                            max - count);
+  for (size_t k = count; k < count + rest; k++)
+    offsets[k] = (uint16_t)(offsets[k] + i);
+  return count + rest;
+}
+
+#endif // OP_SCAN_X86
+
+/* ---------------- arm64 ---------------- */
+
+#ifdef OP_SCAN_ARM64
+
+// 把16字节比较结果压成64位，每个字节占4位
+static inline uint64_t neon_mask(uint8x16_t cmp) {
+  uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(cmp), 4);
+  return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+}
+
+static const char *newline_neon(const char *p, const char *end) {
+  const uint8x16_t nl = vdupq_n_u8('\n');
+  while (end - p >= 16) {
+    uint8x16_t v = vld1q_u8((const uint8_t *)p);
+    uint64_t mask = neon_mask(vceqq_u8(v, nl));
+    if (mask)
+      return p + (__builtin_ctzll(mask) >> 2);
+    p += 16;
+  }
+  return newline_scalar(p, end);
+}
+
+static size_t delims_neon(const char *p, size_t len, uint16_t *offsets,
+                          uint8_t *kinds, size_t max) {
+  static const char set[] = "\n<>:[],#+-;";
+  size_t i = 0, count = 0;
+  for (; i + 16 <= len && count < max; i += 16) {
+    uint8x16_t v = vld1q_u8((const uint8_t *)(p + i));
+    uint8x16_t m = vdupq_n_u8(0);
+    for (size_t k = 0; k < sizeof(set) - 1; k++)
+      m = vorrq_u8(m, vceqq_u8(v, vdupq_n_u8((uint8_t)set[k])));
+    uint64_t nibbles = neon_mask(m) & 0x1111111111111111ULL;
+    while (nibbles && count < max) {
+      size_t pos = i + ((size_t)__builtin_ctzll(nibbles) >> 2);
+      offsets[count] = (uint16_t)pos;
+      kinds[count] = (uint8_t)p[pos];
+      count++;
+      nibbles &= nibbles - 1;
+    }
+  }
+  return delims_scalar_from(p, i, len, offsets, kinds, max, count);
+}
+
+#endif // OP_SCAN_ARM64
+
+/* ---------------- dispatch ---------------- */
+
+static struct {
+  int ready;
+  OpScanKernel kernel;
+  newline_fn newline;
+  delims_fn delims;
+} g_scan;
+
+static int kernel_supported(OpScanKernel kernel) {
+  switch (kernel) {
+  case OP_SCAN_KERNEL_SCALAR:
+    return 1;
+#ifdef OP_SCAN_X86
+  case OP_SCAN_KERNEL_SSE2:
+    return 1;
+  case OP_SCAN_KERNEL_AVX2:
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+#ifdef OP_SCAN_ARM64
+  case OP_SCAN_KERNEL_NEON:
+    return 1;
+#endif
+  default:
+    return 0;
+  }
+}
+
+static void install_kernel(OpScanKernel kernel) {
+  switch (kernel) {
+#ifdef OP_SCAN_X86
+  case OP_SCAN_KERNEL_SSE2:
+    g_scan.newline = newline_sse2;
+    g_scan.delims = delims_sse2;
+    break;
+  case OP_SCAN_KERNEL_AVX2:
+    g_scan.newline = newline_avx2;
+    g_scan.delims = delims_avx2;
+    break;
+#endif
+#ifdef OP_SCAN_ARM64
+  case OP_SCAN_KERNEL_NEON:
+    g_scan.newline = newline_neon;
+    g_scan.delims = delims_neon;
+    break;
+#endif
+  default:
+    kernel = OP_SCAN_KERNEL_SCALAR;
+    g_scan.newline = newline_scalar;
+    g_scan.delims = delims_scalar;
+    break;
+  }
+  g_scan.kernel = kernel;
+  g_scan.ready = 1;
+}
+
+static void ensure_kernel(void) {
+  if (g_scan.ready)
+    return;
+  if (kernel_supported(OP_SCAN_KERNEL_AVX2))
+    install_kernel(OP_SCAN_KERNEL_AVX2);
+  else if (kernel_supported(OP_SCAN_KERNEL_SSE2))
+    install_kernel(OP_SCAN_KERNEL_SSE2);
+  else if (kernel_supported(OP_SCAN_KERNEL_NEON))
+    install_kernel(OP_SCAN_KERNEL_NEON);
+  else
+    install_kernel(OP_SCAN_KERNEL_SCALAR);
+}
+
+const char *op_scan_newline(const char *p, const char *end) {
+  ensure_kernel();
+  if (p >= end)
+    return end;
+  return g_scan.newline(p, end);
+}
+
+size_t op_scan_delims(const char *p, size_t len, uint16_t *offsets,
+                      uint8_t *kinds, size_t max) {
+  ensure_kernel();
+  if (len > UINT16_MAX)
+    len = UINT16_MAX;
+  return g_scan.delims(p, len, offsets, kinds, max);
+}
+
+OpScanKernel op_scan_get_kernel(void) {
+  ensure_kernel();
+  return g_scan.kernel;
+}
+
+int op_scan_set_kernel(OpScanKernel kernel) {
+  if (!kernel_supported(kernel))
+    return 0;
+  install_kernel(kernel);
+  return 1;
+}
+
+const char *op_scan_kernel_name(OpScanKernel kernel) {
+  switch (kernel) {
+  case OP_SCAN_KERNEL_SSE2:
+    return "sse2";
+  case OP_SCAN_KERNEL_AVX2:
+    return "avx2";
+  case OP_SCAN_KERNEL_NEON:
+    return "neon";
+  default:
+    return "scalar";
+  }
+}
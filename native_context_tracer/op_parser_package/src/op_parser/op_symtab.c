@@ -0,0 +1,443 @@
+#define _GNU_SOURCE
+#include "op_symtab.h"
+#include "op_elf.h"
+#include <stdlib.h>
+#include <string.h>
+
+// macOS 等没有 <elf.h> 的平台只保留索引部分，op_symtab_load_elf 返回 -1
+
+typedef struct {
+  char *path;
+  uint64_t load_bias;
+  char *strings; // 本模块所有符号名的存储
+} Module;
+
+struct OpSymtab {
+  OpSymbol *syms; // 按 (地址, 优先级) 排序
+  size_t count;
+  size_t cap;
+  // 区间索引：每个不同地址取优先级最高的符号
+  int *index;
+  uint64_t *end;     // index[k] 覆盖 [addr, end)
+  uint64_t *max_end; // end[0..k] 的前缀最大值，用于处理嵌套/重叠区间
+  size_t index_count;
+  Module *modules;
+  int module_count;
+};
+
+OpSymtab *op_symtab_create(void) { return calloc(1, sizeof(OpSymtab)); }
+
+void op_symtab_destroy(OpSymtab *tab) {
+  if (!tab)
+    return;
+  for (int i = 0; i < tab->module_count; i++) {
+    free(tab->modules[i].path);
+    free(tab->modules[i].strings);
+  }
+  free(tab->modules);
+  free(tab->syms);
+  free(tab->index);
+  free(tab->end);
+  free(tab->max_end);
+  free(tab);
+}
+
+size_t op_symtab_count(const OpSymtab *tab) { return tab->count; }
+
+const OpSymbol *op_symtab_get(const OpSymtab *tab, int index) {
+  if (index < 0 || (size_t)index >= tab->count)
+    return NULL;
+  return &tab->syms[index];
+}
+
+const char *op_symtab_module_path(const OpSymtab *tab, int module) {
+  if (module < 0 || module >= tab->module_count)
+    return NULL;
+  return tab->modules[module].path;
+}
+
+int op_symtab_lookup(const OpSymtab *tab, uint64_t addr, uint64_t *offset) {
+  // 最后一个起始地址 <= addr 的区间
+  size_t lo = 0, hi = tab->index_count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (tab->syms[tab->index[mid]].addr <= addr)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  for (size_t k = lo; k-- > 0;) {
+    if (tab->max_end[k] <= addr)
+      break;
+    if (addr < tab->end[k]) {
+      const OpSymbol *s = &tab->syms[tab->index[k]];
+      if (offset)
+        *offset = addr - s->addr;
+      return tab->index[k];
+    }
+  }
+  return -1;
+}
+
+int op_symtab_find(const OpSymtab *tab, const char *name) {
+  int found = -1;
+  for (size_t i = 0; i < tab->count; i++) {
+    if (strcmp(tab->syms[i].name, name) != 0)
+      continue;
+    if (!tab->syms[i].weak)
+      return (int)i;
+    if (found < 0)
+      found = (int)i;
+  }
+  return found;
+}
+
+#ifdef OP_HAVE_ELF
+
+// 同一地址有多个符号时的优先级：有大小 > 全局 > 函数/PLT > 对象 >
+// 前导下划线少（malloc 优于 __libc_malloc） > 名字字典序
+static int leading_underscores(const char *name) {
+  int n = 0;
+  while (name[n] == '_')
+    n++;
+  return n;
+}
+
+static int compare_symbols(const void *a, const void *b) {
+  const OpSymbol *x = a, *y = b;
+  if (x->addr != y->addr)
+    return x->addr < y->addr ? -1 : 1;
+  if ((x->size == 0) != (y->size == 0))
+    return x->size == 0 ? 1 : -1;
+  if (x->weak != y->weak)
+    return x->weak - y->weak;
+  if (x->kind != y->kind)
+    return (int)x->kind - (int)y->kind;
+  int ux = leading_underscores(x->name), uy = leading_underscores(y->name);
+  if (ux != uy)
+    return ux - uy;
+  return strcmp(x->name, y->name);
+}
+
+static int rebuild_index(OpSymtab *tab) {
+  if (tab->count > 0)
+    qsort(tab->syms, tab->count, sizeof(OpSymbol), compare_symbols);
+
+  // .symtab 和 .dynsym 中重复的符号只保留一份
+  size_t w = 0;
+  for (size_t r = 0; r < tab->count; r++) {
+    if (w > 0 && tab->syms[w - 1].addr == tab->syms[r].addr &&
+        strcmp(tab->syms[w - 1].name, tab->syms[r].name) == 0)
+      continue;
+    tab->syms[w++] = tab->syms[r];
+  }
+  tab->count = w;
+
+  free(tab->index);
+  free(tab->end);
+  free(tab->max_end);
+  tab->index = malloc(sizeof(int) * (tab->count + 1));
+  tab->end = malloc(sizeof(uint64_t) * (tab->count + 1));
+  tab->max_end = malloc(sizeof(uint64_t) * (tab->count + 1));
+  if (!tab->index || !tab->end || !tab->max_end)
+    return 0;
+
+  size_t n = 0;
+  for (size_t i = 0; i < tab->count; i++) {
+    if (n > 0 && tab->syms[tab->index[n - 1]].addr == tab->syms[i].addr)
+      continue;
+    tab->index[n++] = (int)i;
+  }
+  for (size_t k = 0; k < n; k++) {
+    const OpSymbol *s = &tab->syms[tab->index[k]];
+    if (s->size > 0)
+      tab->end[k] = s->addr + s->size;
+    else if (k + 1 < n)
+      tab->end[k] = tab->syms[tab->index[k + 1]].addr; // 覆盖到下一个符号
+    else
+      tab->end[k] = s->addr + 1;
+    tab->max_end[k] =
+        k > 0 && tab->max_end[k - 1] > tab->end[k] ? tab->max_end[k - 1]
+                                                    : tab->end[k];
+  }
+  tab->index_count = n;
+  return 1;
+}
+
+static int push_symbol(OpSymtab *tab, const OpSymbol *sym) {
+  if (tab->count == tab->cap) {
+    size_t cap = tab->cap ? tab->cap * 2 : 1024;
+    OpSymbol *syms = realloc(tab->syms, sizeof(OpSymbol) * cap);
+    if (!syms)
+      return 0;
+    tab->syms = syms;
+    tab->cap = cap;
+  }
+  tab->syms[tab->count++] = *sym;
+  return 1;
+}
+
+// 符号表及其字符串表，检查通过返回符号数量
+static size_t symtab_section(const OpElfFile *elf, const Elf64_Shdr *sec,
+                             const Elf64_Sym **syms, const Elf64_Shdr **strsec) {
+  if (!sec || sec->sh_type == SHT_NOBITS || sec->sh_entsize != sizeof(Elf64_Sym) ||
+      !op_elf_table_in_file(elf, sec->sh_offset, sec->sh_size) ||
+      sec->sh_link >= elf->ehdr->e_shnum)
+    return 0;
+  const Elf64_Shdr *str = &elf->shdrs[sec->sh_link];
+  if (str->sh_type == SHT_NOBITS || !op_elf_in_file(elf, str->sh_offset, str->sh_size) ||
+      str->sh_size == 0)
+    return 0;
+  *syms = (const Elf64_Sym *)(elf->data + sec->sh_offset);
+  *strsec = str;
+  return sec->sh_size / sizeof(Elf64_Sym);
+}
+
+// 复制字符串表到模块存储区，保证末尾有 '\0'
+static char *copy_strtab(const OpElfFile *elf, const Elf64_Shdr *str, char **cursor) {
+  char *base = *cursor;
+  memcpy(base, elf->data + str->sh_offset, str->sh_size);
+  base[str->sh_size] = '\0';
+  *cursor += str->sh_size + 1;
+  return base;
+}
+
+static int add_symbols(OpSymtab *tab, int module, uint64_t bias,
+                       const Elf64_Sym *syms, size_t n, const char *strings,
+                       size_t strings_size) {
+  for (size_t i = 1; i < n; i++) {
+    const Elf64_Sym *s = &syms[i];
+    int type = ELF64_ST_TYPE(s->st_info);
+    int bind = ELF64_ST_BIND(s->st_info);
+    if (s->st_shndx == SHN_UNDEF || s->st_value == 0 ||
+        s->st_name >= strings_size || strings[s->st_name] == '\0')
+      continue;
+    if (bind != STB_GLOBAL && bind != STB_LOCAL && bind != STB_WEAK)
+      continue;
+
+    OpSymbol sym;
+    if (type == STT_FUNC || type == STT_GNU_IFUNC)
+      sym.kind = OP_SYM_FUNC;
+    else if (type == STT_OBJECT)
+      sym.kind = OP_SYM_OBJECT;
+    else
+      continue;
+    sym.addr = s->st_value + bias;
+    sym.size = s->st_size;
+    sym.name = strings + s->st_name;
+    sym.weak = bind == STB_WEAK;
+    sym.module = module;
+    if (!push_symbol(tab, &sym))
+      return 0;
+  }
+  return 1;
+}
+
+// PLT桩布局。有 .plt.sec（x86-64 IBT）时桩在 .plt.sec 中从头排列；
+// 否则在 .plt 中跳过 PLT0（x86-64 16字节，AArch64 32字节）
+static int plt_layout(const OpElfFile *elf, size_t n_slots, uint64_t *start,
+                      uint64_t *entsize) {
+  const Elf64_Shdr *plt_sec = op_elf_section(elf, ".plt.sec");
+  const Elf64_Shdr *plt = op_elf_section(elf, ".plt");
+  if (n_slots == 0)
+    return 0;
+  if (plt_sec && plt_sec->sh_size >= n_slots) {
+    *start = plt_sec->sh_addr;
+    *entsize = plt_sec->sh_size / n_slots;
+    return *entsize > 0;
+  }
+  if (!plt)
+    return 0;
+  uint64_t header = elf->ehdr->e_machine == EM_AARCH64 ? 32 : 16;
+  if (plt->sh_size <= header)
+    return 0;
+  *start = plt->sh_addr + header;
+  *entsize = (plt->sh_size - header) / n_slots;
+  return *entsize > 0;
+}
+
+// 重定位对应的桩序号：由它写入的 .got.plt 槽位决定（前3个槽位保留），
+// .rela.plt 的顺序不一定与桩顺序一致（libc 中混有 IRELATIVE）
+static int64_t plt_slot(const Elf64_Shdr *got_plt, const Elf64_Rela *rela,
+                        size_t index) {
+  if (!got_plt)
+    return (int64_t)index;
+  if (rela->r_offset < got_plt->sh_addr + 24)
+    return -1;
+  return (int64_t)((rela->r_offset - got_plt->sh_addr) / 8) - 3;
+}
+
+static size_t plt_relocs(const OpElfFile *elf, const Elf64_Rela **relocs,
+                         const Elf64_Shdr **dynsym) {
+  const Elf64_Shdr *sec = op_elf_section(elf, ".rela.plt");
+  if (!sec || sec->sh_entsize != sizeof(Elf64_Rela) ||
+      !op_elf_table_in_file(elf, sec->sh_offset, sec->sh_size) ||
+      sec->sh_link >= elf->ehdr->e_shnum)
+    return 0;
+  *relocs = (const Elf64_Rela *)(elf->data + sec->sh_offset);
+  *dynsym = &elf->shdrs[sec->sh_link];
+  return sec->sh_size / sizeof(Elf64_Rela);
+}
+
+static int load_image(OpSymtab *tab, int module, const OpElfFile *elf,
+                      uint64_t bias) {
+  const Elf64_Sym *symtab = NULL, *dynsym = NULL;
+  const Elf64_Shdr *symstr = NULL, *dynstr = NULL;
+  size_t n_symtab =
+      symtab_section(elf, op_elf_section(elf, ".symtab"), &symtab, &symstr);
+  size_t n_dynsym =
+      symtab_section(elf, op_elf_section(elf, ".dynsym"), &dynsym, &dynstr);
+
+  const Elf64_Rela *relocs = NULL;
+  const Elf64_Shdr *reloc_syms = NULL;
+  size_t n_relocs = plt_relocs(elf, &relocs, &reloc_syms);
+  const Elf64_Shdr *got_plt = op_elf_section(elf, ".got.plt");
+  size_t n_slots = n_relocs;
+  if (got_plt && got_plt->sh_size / 8 > 3)
+    n_slots = got_plt->sh_size / 8 - 3;
+  else
+    got_plt = NULL;
+  uint64_t plt_start = 0, plt_entsize = 0;
+  if (n_dynsym == 0 || !plt_layout(elf, n_slots, &plt_start, &plt_entsize) ||
+      reloc_syms != op_elf_section(elf, ".dynsym"))
+    n_relocs = 0;
+
+  // 名字存储区：两个字符串表 + 每个PLT桩的 "name@plt"
+  size_t arena = (symstr ? symstr->sh_size + 1 : 0) +
+                 (dynstr ? dynstr->sh_size + 1 : 0) + n_relocs * 5;
+  const char *dyn_names = dynstr ? (const char *)elf->data + dynstr->sh_offset : NULL;
+  for (size_t i = 0; i < n_relocs; i++) {
+    size_t sym = ELF64_R_SYM(relocs[i].r_info);
+    if (sym < n_dynsym && dynsym[sym].st_name < dynstr->sh_size)
+      arena += strnlen(dyn_names + dynsym[sym].st_name,
+                       dynstr->sh_size - dynsym[sym].st_name);
+  }
+  char *strings = malloc(arena + 1);
+  if (!strings)
+    return 0;
+  tab->modules[module].strings = strings;
+  char *cursor = strings;
+
+  if (n_symtab) {
+    char *names = copy_strtab(elf, symstr, &cursor);
+    if (!add_symbols(tab, module, bias, symtab, n_symtab, names, symstr->sh_size))
+      return 0;
+  }
+  if (n_dynsym) {
+    char *names = copy_strtab(elf, dynstr, &cursor);
+    if (!add_symbols(tab, module, bias, dynsym, n_dynsym, names, dynstr->sh_size))
+      return 0;
+
+    for (size_t i = 0; i < n_relocs; i++) {
+      size_t sym = ELF64_R_SYM(relocs[i].r_info);
+      if (sym == 0 || sym >= n_dynsym || dynsym[sym].st_name >= dynstr->sh_size)
+        continue;
+      const char *name = names + dynsym[sym].st_name;
+      int64_t slot = plt_slot(got_plt, &relocs[i], i);
+      if (*name == '\0' || slot < 0 || (size_t)slot >= n_slots)
+        continue;
+      OpSymbol plt;
+      plt.addr = plt_start + (uint64_t)slot * plt_entsize + bias;
+      plt.size = plt_entsize;
+      plt.name = cursor;
+      plt.kind = OP_SYM_PLT;
+      plt.weak = ELF64_ST_BIND(dynsym[sym].st_info) == STB_WEAK;
+      plt.module = module;
+      size_t len = strlen(name);
+      memcpy(cursor, name, len);
+      memcpy(cursor + len, "@plt", 5);
+      cursor += len + 5;
+      if (!push_symbol(tab, &plt))
+        return 0;
+    }
+  }
+  return 1;
+}
+
+int op_symtab_load_elf(OpSymtab *tab, const char *path, uint64_t load_bias) {
+  OpElfFile elf;
+  if (!op_elf_map(&elf, path))
+    return -1;
+
+  int module = -1;
+  Module *modules =
+      realloc(tab->modules, sizeof(Module) * (size_t)(tab->module_count + 1));
+  if (modules) {
+    tab->modules = modules;
+    module = tab->module_count++;
+    memset(&modules[module], 0, sizeof(Module));
+    modules[module].path = strdup(path);
+    modules[module].load_bias = load_bias;
+
+    size_t before = tab->count;
+    if (!modules[module].path || !load_image(tab, module, &elf, load_bias)) {
+      // 回滚本模块已加入的符号，模块记录保留为空
+      tab->count = before;
+      module = -1;
+    }
+  }
+  op_elf_unmap(&elf);
+  if (!rebuild_index(tab))
+    return -1;
+  return module;
+}
+
+#else
+
+int op_symtab_load_elf(OpSymtab *tab, const char *path, uint64_t load_bias) {
+  (void)tab;
+  (void)path;
+  (void)load_bias;
+  return -1;
+}
+
+#endif
+
+// 最后一个 ADDRESS 操作数（跳转目标、adr/adrp 地址）
+static int address_operand(const DisasmLine *line, uint64_t *addr) {
+  for (int i = line->operand_count - 1; i >= 0; i--) {
+    const Operand *op = &line->operands[i];
+    if (op->type == OPERAND_ADDRESS) {
+      char *end;
+      *addr = strtoull(op->value, &end, 16);
+      return end != op->value;
+    }
+  }
+  return 0;
+}
+
+int op_symtab_symbolize(const OpSymtab *tab, const DisasmLine *lines, int count,
+                        OpSymbolized *out) {
+  int found = 0;
+  int last_symbol = -1;
+  uint64_t last_start = 0, last_end = 0;
+  for (int i = 0; i < count; i++) {
+    OpSymbolized *r = &out[i];
+    uint64_t addr = lines[i].addr;
+
+    // 连续指令通常落在同一符号内，先检查上一次命中的区间
+    if (last_symbol >= 0 && addr >= last_start && addr < last_end) {
+      r->symbol = last_symbol;
+      r->offset = addr - last_start;
+    } else {
+      r->symbol = op_symtab_lookup(tab, addr, &r->offset);
+      if (r->symbol >= 0) {
+        const OpSymbol *s = &tab->syms[r->symbol];
+        last_symbol = r->symbol;
+        last_start = s->addr;
+        last_end = s->size ? s->addr + s->size : s->addr;
+      }
+    }
+    if (r->symbol < 0)
+      r->offset = 0;
+    else
+      found++;
+
+    r->target = 0;
+    r->target_offset = 0;
+    r->target_symbol = -1;
+    if (address_operand(&lines[i], &r->target))
+      r->target_symbol = op_symtab_lookup(tab, r->target, &r->target_offset);
+  }
+  return found;
+}
@@ -0,0 +1,143 @@
+#define _GNU_SOURCE
+#include "op_lines.h"
+#include <assert.h>
+#include <link.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static uint64_t main_bias;
+
+static int find_main(struct dl_phdr_info *info, size_t size, void *data) {
+  (void)size;
+  (void)data;
+  if (info->dlpi_name == NULL || info->dlpi_name[0] == '\0') {
+    main_bias = info->dlpi_addr;
+    return 1;
+  }
+  return 0;
+}
+
+// 函数入口行就是声明所在的行
+static const int probe_line = __LINE__ + 1;
+__attribute__((noinline)) int op_lines_probe(int x) { return x * 5 + 3; }
+
+static uint64_t file_addr(const void *p) {
+  return (uint64_t)(uintptr_t)p - main_bias;
+}
+
+static int ends_with(const char *s, const char *suffix) {
+  size_t n = strlen(s), m = strlen(suffix);
+  return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+static void check_table(const OpLineTable *t) {
+  assert(op_lines_count(t) > 0);
+  for (size_t i = 1; i < op_lines_count(t); i++)
+    assert(op_lines_row(t, i - 1)->addr <= op_lines_row(t, i)->addr);
+  assert(op_lines_row(t, op_lines_count(t)) == NULL);
+  assert(op_lines_row(t, op_lines_count(t) - 1)->flags & OP_LINE_END_SEQUENCE);
+
+  long idx = op_lines_lookup(t, file_addr((const void *)op_lines_probe));
+  assert(idx >= 0);
+  const OpLineRow *row = op_lines_row(t, (size_t)idx);
+  assert(row->line == (uint32_t)probe_line);
+  assert(ends_with(op_lines_file(t, row->file), "test/op_lines_test.c"));
+  assert(op_lines_file(t, UINT32_MAX) == NULL);
+
+  // 函数体内部地址仍在本文件
+  idx = op_lines_lookup(t, file_addr((const char *)op_lines_probe + 2));
+  assert(idx >= 0);
+  assert(ends_with(op_lines_file(t, op_lines_row(t, (size_t)idx)->file),
+                   "op_lines_test.c"));
+
+  // 第一个序列之前、最后一个序列之后都没有行
+  assert(op_lines_lookup(t, 0) == -1);
+  assert(op_lines_lookup(t, UINT64_MAX) == -1);
+}
+
+static int same_rows(const OpLineTable *a, const OpLineTable *b) {
+  if (op_lines_count(a) != op_lines_count(b) ||
+      op_lines_file_count(a) != op_lines_file_count(b))
+    return 0;
+  for (size_t i = 0; i < op_lines_count(a); i++)
+    if (memcmp(op_lines_row(a, i), op_lines_row(b, i), sizeof(OpLineRow)))
+      return 0;
+  for (uint32_t i = 0; i < op_lines_file_count(a); i++)
+    if (strcmp(op_lines_file(a, i), op_lines_file(b, i)))
+      return 0;
+  return 1;
+}
+
+void test_parse(void) {
+  OpLineTable *t = op_lines_open("/proc/self/exe", NULL);
+  assert(t);
+  assert(!op_lines_from_cache(t));
+  check_table(t);
+  printf("parse: %zu rows, %zu files ok\n", op_lines_count(t),
+         op_lines_file_count(t));
+  op_lines_close(t);
+}
+
+void test_cache(void) {
+  OpLineTable *parsed = op_lines_open("/proc/self/exe", NULL);
+  assert(parsed);
+  if (op_lines_build_id(parsed)[0] == '\0') {
+    printf("cache: no build-id, skipped\n");
+    op_lines_close(parsed);
+    return;
+  }
+
+  char dir[] = "/tmp/op_lines_test_XXXXXX";
+  assert(mkdtemp(dir));
+  char cache_dir[256], cache_file[512];
+  snprintf(cache_dir, sizeof(cache_dir), "%s/cache", dir);
+  snprintf(cache_file, sizeof(cache_file), "%s/%s.oplines", cache_dir,
+           op_lines_build_id(parsed));
+
+  // 第一次解析并写入缓存（目录不存在时自动创建）
+  OpLineTable *t = op_lines_open("/proc/self/exe", cache_dir);
+  assert(t && !op_lines_from_cache(t));
+  assert(access(cache_file, R_OK) == 0);
+  op_lines_close(t);
+
+  // 第二次直接映射
+  t = op_lines_open("/proc/self/exe", cache_dir);
+  assert(t && op_lines_from_cache(t));
+  assert(strcmp(op_lines_build_id(t), op_lines_build_id(parsed)) == 0);
+  assert(same_rows(t, parsed));
+  check_table(t);
+  op_lines_close(t);
+
+  // 截断的缓存视为无效，重新解析并覆盖
+  assert(truncate(cache_file, 100) == 0);
+  t = op_lines_open("/proc/self/exe", cache_dir);
+  assert(t && !op_lines_from_cache(t));
+  op_lines_close(t);
+  t = op_lines_open("/proc/self/exe", cache_dir);
+  assert(t && op_lines_from_cache(t) && same_rows(t, parsed));
+  op_lines_close(t);
+
+  unlink(cache_file);
+  rmdir(cache_dir);
+  rmdir(dir);
+  op_lines_close(parsed);
+  printf("cache: ok\n");
+}
+
+void test_errors(void) {
+  assert(op_lines_open("/nonexistent/libfoo.so", NULL) == NULL);
+  assert(op_lines_open("/proc/self/cmdline", NULL) == NULL);
+  printf("errors: ok\n");
+}
+
+int main() {
+  assert(op_lines_probe(1) == 8);
+  dl_iterate_phdr(find_main, NULL);
+  test_parse();
+  test_cache();
+  test_errors();
+  printf("All line table tests passed!\n");
+  return 0;
+}
@@ -0,0 +1,214 @@
+#include "op_parser.h"
+#include "op_regs.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+static OpRegSet regs(const char *names) {
+  // 空格分隔的寄存器名列表
+  OpRegSet set = {{0, 0}};
+  char buf[256];
+  strncpy(buf, names, sizeof(buf) - 1);
+  buf[sizeof(buf) - 1] = '\0';
+  for (char *tok = strtok(buf, " "); tok; tok = strtok(NULL, " ")) {
+    int r = op_reg_from_name(tok);
+    assert(r >= 0);
+    op_regset_add(&set, r);
+  }
+  return set;
+}
+
+static int same(OpRegSet a, OpRegSet b) {
+  return a.bits[0] == b.bits[0] && a.bits[1] == b.bits[1];
+}
+
+static void def_use(const char *line, OpRegSet *def, OpRegSet *use) {
+  DisasmLine l;
+  assert(parse_disassembly_line(line, &l));
+  op_regs_def_use(&l, def, use);
+}
+
+void test_reg_names() {
+  assert(op_reg_from_name("x0") == 0);
+  assert(op_reg_from_name("w30") == OP_REG_LR);
+  assert(op_reg_from_name("fp") == OP_REG_FP);
+  assert(op_reg_from_name("lr") == OP_REG_LR);
+  assert(op_reg_from_name("wsp") == OP_REG_SP);
+  assert(op_reg_from_name("nzcv") == OP_REG_NZCV);
+  assert(op_reg_from_name("{v1.4s") == OP_REG_V0 + 1);
+  assert(op_reg_from_name("v2.s[1]") == OP_REG_V0 + 2);
+  assert(op_reg_from_name("d31") == OP_REG_V0 + 31);
+  assert(op_reg_from_name("xzr") == -1);
+  assert(op_reg_from_name("wzr") == -1);
+  assert(op_reg_from_name("x31") == -1);
+  assert(op_reg_from_name("lsl") == -1);
+  assert(op_reg_from_name("sxtw") == -1);
+  assert(op_reg_from_name("eq") == -1);
+  assert(strcmp(op_reg_name(OP_REG_SP), "sp") == 0);
+  assert(strcmp(op_reg_name(OP_REG_V0 + 3), "v3") == 0);
+  printf("register names: ok\n");
+}
+
+void test_def_use() {
+  OpRegSet def, use;
+
+  def_use("0x1000 <+0>: sub    sp, sp, #0x90", &def, &use);
+  assert(same(def, regs("sp")) && same(use, regs("sp")));
+
+  def_use("0x1000 <+0>: add    x0, x1, x2, lsl #3", &def, &use);
+  assert(same(def, regs("x0")) && same(use, regs("x1 x2")));
+
+  def_use("0x1000 <+0>: stp    x29, x30, [sp, #-0x10]!", &def, &use);
+  assert(same(def, regs("sp")) && same(use, regs("x29 x30 sp")));
+
+  def_use("0x1000 <+0>: ldp    x29, x30, [sp], #0x10", &def, &use);
+  assert(same(def, regs("x29 x30 sp")) && same(use, regs("sp")));
+
+  def_use("0x1000 <+0>: ldr    x17, [x17, x16, lsl #3]", &def, &use);
+  assert(same(def, regs("x17")) && same(use, regs("x16 x17")));
+
+  def_use("0x1000 <+0>: stur   wzr, [x29, #-0x4]", &def, &use);
+  assert(same(def, regs("")) && same(use, regs("x29")));
+
+  def_use("0x1000 <+0>: cmp    w0, #0x3", &def, &use);
+  assert(same(def, regs("nzcv")) && same(use, regs("x0")));
+
+  def_use("0x1000 <+0>: subs   x8, x8, #0x1", &def, &use);
+  assert(same(def, regs("x8 nzcv")) && same(use, regs("x8")));
+
+  def_use("0x1000 <+0>: csel   w0, w1, w2, eq", &def, &use);
+  assert(same(def, regs("x0")) && same(use, regs("x1 x2 nzcv")));
+
+  def_use("0x1000 <+0>: movk   x9, #0x1234, lsl #16", &def, &use);
+  assert(same(def, regs("x9")) && same(use, regs("x9")));
+
+  def_use("0x1000 <+0>: b.ne   0x1000", &def, &use);
+  assert(same(def, regs("")) && same(use, regs("nzcv")));
+
+  def_use("0x1000 <+0>: cbz    w0, 0x1010", &def, &use);
+  assert(same(def, regs("")) && same(use, regs("x0")));
+
+  def_use("0x1000 <+0>: ret", &def, &use);
+  assert(same(def, regs("")) && same(use, regs("lr")));
+
+  def_use("0x1000 <+0>: blr    x8", &def, &use);
+  assert(op_regset_has(&use, 8) && op_regset_has(&def, OP_REG_LR));
+  assert(op_regset_has(&def, 0) && !op_regset_has(&def, 19));
+
+  def_use("0x1000 <+0>: ldadd  w1, w2, [x0]", &def, &use);
+  assert(same(def, regs("x2")) && same(use, regs("x0 x1")));
+
+  def_use("0x1000 <+0>: stxr   w3, x2, [x0]", &def, &use);
+  assert(same(def, regs("x3")) && same(use, regs("x0 x2")));
+
+  def_use("0x1000 <+0>: ld1    {v0.4s, v1.4s}, [x0]", &def, &use);
+  assert(same(def, regs("v0 v1")) && same(use, regs("x0")));
+  printf("def/use: ok\n");
+}
+
+// 循环：x0 计数递减到0，x1 累加，循环外读取 x1 作为返回值
+void test_loop_liveness() {
+  const char *text = "0x1000 <+0>:  mov    x1, #0x0\n"
+                     "0x1004 <+4>:  mov    x9, #0x5\n"
+                     "0x1008 <+8>:  add    x1, x1, x0\n"
+                     "0x100c <+12>: subs   x0, x0, #0x1\n"
+                     "0x1010 <+16>: b.ne   0x1008\n"
+                     "0x1014 <+20>: mov    x0, x1\n"
+                     "0x1018 <+24>: ret\n";
+  DisasmLine lines[16];
+  OpInsnRegs insns[16];
+  OpBlock blocks[8];
+  int count = parse_disassembly(text, lines, 16);
+  assert(count == 7);
+
+  int n_blocks = op_regs_analyze(lines, count, insns, blocks, 8);
+  assert(n_blocks == 3);
+  assert(blocks[0].first == 0 && blocks[0].last == 1);
+  assert(blocks[1].first == 2 && blocks[1].last == 4);
+  assert(blocks[1].end_kind == OP_BLOCK_COND_BRANCH);
+  assert(blocks[1].succ_count == 2);
+  assert(blocks[1].succ[0] == 2 && blocks[1].succ[1] == 1);
+  assert(blocks[2].end_kind == OP_BLOCK_RETURN);
+
+  // 进入循环时 x0/x1 活跃，x9 从未被读取
+  assert(op_regset_has(&blocks[1].live_in, 0));
+  assert(op_regset_has(&blocks[1].live_in, 1));
+  assert(!op_regset_has(&blocks[1].live_in, 9));
+
+  // mov x9 是死写入，单步后不需要读取任何寄存器
+  assert(op_regset_count(&insns[1].read_after) == 0);
+  assert(same(insns[0].read_after, regs("x1")));
+  assert(same(insns[3].read_after, regs("x0 nzcv")));
+  // ret 后 nzcv 不再活跃
+  assert(!op_regset_has(&insns[4].live_out, OP_REG_NZCV));
+  assert(same(blocks[1].read_set, regs("x0 x1 nzcv")));
+  printf("loop liveness: ok\n");
+}
+
+void test_prologue_epilogue() {
+  const char *text =
+      "0x100001240 <+0>:   stp    x29, x30, [sp, #-0x10]!\n"
+      "0x100001244 <+4>:   mov    x29, sp\n"
+      "0x100001248 <+8>:   bl     0x100001300\n"
+      "0x10000124c <+12>:  add    w0, w0, #0x1\n"
+      "0x100001250 <+16>:  ldp    x29, x30, [sp], #0x10\n"
+      "0x100001254 <+20>:  ret\n";
+  DisasmLine lines[8];
+  OpInsnRegs insns[8];
+  OpBlock blocks[4];
+  int count = parse_disassembly(text, lines, 8);
+  assert(count == 6);
+
+  // 调用不结束基本块
+  assert(op_regs_analyze(lines, count, insns, blocks, 4) == 1);
+  assert(same(insns[0].read_after, regs("sp")));
+  assert(same(insns[1].read_after, regs("x29")));
+  // 调用后只有可能的返回值还活跃（lr 随后被 ldp 覆盖）
+  assert(same(insns[2].read_after, regs("x0 x1 v0 v1 v2 v3")));
+  assert(same(insns[3].read_after, regs("x0")));
+  assert(same(insns[4].read_after, regs("x29 x30 sp")));
+  for (int i = 0; i < count; i++) {
+    if (i != 2)
+      assert(op_regset_count(&insns[i].read_after) <= 3);
+  }
+  printf("prologue/epilogue: ok\n");
+}
+
+void test_exits_and_errors() {
+  // 跳出当前序列的尾调用，保守地认为全部寄存器活跃
+  const char *text = "0x2000 <+0>: mov    x9, #0x1\n"
+                     "0x2004 <+4>: b      0x9000\n";
+  DisasmLine lines[4];
+  OpInsnRegs insns[4];
+  OpBlock blocks[4];
+  int count = parse_disassembly(text, lines, 4);
+  assert(op_regs_analyze(lines, count, insns, blocks, 4) == 1);
+  assert(blocks[0].end_kind == OP_BLOCK_EXIT && blocks[0].succ_count == 0);
+  assert(same(insns[0].read_after, regs("x9")));
+
+  // 基本块数组不够
+  const char *three = "0x3000 <+0>: cbz x0, 0x3008\n"
+                      "0x3004 <+4>: ret\n"
+                      "0x3008 <+8>: ret\n";
+  count = parse_disassembly(three, lines, 4);
+  assert(op_regs_analyze(lines, count, insns, blocks, 2) == -1);
+  assert(op_regs_analyze(lines, count, insns, blocks, 4) == 3);
+
+  // 地址必须升序
+  DisasmLine tmp = lines[0];
+  lines[0] = lines[1];
+  lines[1] = tmp;
+  assert(op_regs_analyze(lines, count, insns, blocks, 4) == -1);
+  assert(op_regs_analyze(lines, 0, insns, blocks, 4) == 0);
+  printf("exits and errors: ok\n");
+}
+
+int main() {
+  test_reg_names();
+  test_def_use();
+  test_loop_liveness();
+  test_prologue_epilogue();
+  test_exits_and_errors();
+  printf("All register analysis tests passed!\n");
+  return 0;
+}
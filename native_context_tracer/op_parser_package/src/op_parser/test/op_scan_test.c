@@ -0,0 +1,125 @@
+#include "op_parser.h"
+#include "op_scan.h"
+#include <assert.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const OpScanKernel all_kernels[] = {
+    OP_SCAN_KERNEL_SCALAR, OP_SCAN_KERNEL_SSE2, OP_SCAN_KERNEL_AVX2,
+    OP_SCAN_KERNEL_NEON};
+
+void test_char_class_table() {
+  // 分类表必须和 "C" locale 下的 ctype 完全一致
+  for (int c = 0; c < 128; c++) {
+    assert(!!op_isalpha(c) == !!isalpha(c));
+    assert(!!op_isdigit(c) == !!isdigit(c));
+    assert(!!op_isxdigit(c) == !!isxdigit(c));
+    assert(!!op_isspace(c) == !!isspace(c));
+    assert(!!op_isalnum(c) == !!isalnum(c));
+  }
+  for (int c = 128; c < 256; c++) {
+    assert(OP_CC(c) == 0);
+  }
+  printf("char class table: ok\n");
+}
+
+static void fill_random(char *buf, size_t len, unsigned *seed) {
+  static const char alphabet[] = "0x1f <+>:[],#-;\n\tabcdefsp";
+  for (size_t i = 0; i < len; i++) {
+    buf[i] = alphabet[rand_r(seed) % (sizeof(alphabet) - 1)];
+  }
+}
+
+void test_kernels_match_scalar() {
+  char buf[300];
+  uint16_t ref_off[300], off[300];
+  uint8_t ref_kind[300], kind[300];
+  unsigned seed = 12345;
+
+  for (size_t k = 0; k < sizeof(all_kernels) / sizeof(all_kernels[0]); k++) {
+    if (!op_scan_set_kernel(all_kernels[k]))
+      continue;
+    printf("kernel %s: ", op_scan_kernel_name(all_kernels[k]));
+    for (int iter = 0; iter < 2000; iter++) {
+      size_t len = (size_t)(rand_r(&seed) % sizeof(buf));
+      fill_random(buf, len, &seed);
+
+      op_scan_set_kernel(OP_SCAN_KERNEL_SCALAR);
+      const char *ref_nl = op_scan_newline(buf, buf + len);
+      size_t ref_n = op_scan_delims(buf, len, ref_off, ref_kind, 300);
+      size_t ref_capped = op_scan_delims(buf, len, ref_off, ref_kind, 5);
+
+      op_scan_set_kernel(all_kernels[k]);
+      assert(op_scan_newline(buf, buf + len) == ref_nl);
+      size_t n = op_scan_delims(buf, len, off, kind, 300);
+      assert(n == ref_n);
+      assert(memcmp(off, ref_off, n * sizeof(off[0])) == 0 || n == 0);
+      assert(memcmp(kind, ref_kind, n) == 0 || n == 0);
+      assert(op_scan_delims(buf, len, off, kind, 5) == ref_capped);
+    }
+    printf("ok\n");
+  }
+}
+
+// 旧实现的行切分方式，作为 parse_disassembly 的参考
+static int reference_parse(const char *text, DisasmLine *lines, int max) {
+  int count = 0;
+  const char *start = text;
+  const char *end;
+  while ((end = strchr(start, '\n')) != NULL && count < max) {
+    char line[256] = {0};
+    strncpy(line, start, (size_t)(end - start));
+    if (parse_disassembly_line(line, &lines[count]))
+      count++;
+    start = end + 1;
+  }
+  if (*start && count < max && parse_disassembly_line(start, &lines[count]))
+    count++;
+  return count;
+}
+
+void test_disassembly_equivalence() {
+  const char *disassembly =
+      "libc.so.6`malloc:\n"
+      "0x7ffff7e5a0e0 <+0>:   endbr64\n"
+      "0x100001240 <+0>:   sub    sp, sp, #0x90\n"
+      "->  0x100001244 <+4>:   stp    x29, x30, [sp, #0x80]\n"
+      "0x100001250 <+16>:  ldr    x17, [x17, x16, lsl #3]\n"
+      "0x100001254 <-[NSObject init]+8>: bl     0x100001300 ; symbol stub\n"
+      "0x100001258 <std::vector<int>::push_back+12>:  ret\n"
+      "0x10000125c <main>:  b.ne   0x100001240\n"
+      "0x100001260:  cbz    w0, 0x100001270\n"
+      "\n"
+      "    0x100001264 <+36>: tbz    w8, #0x3, 0x100001280";
+
+  DisasmLine expected[16], actual[16];
+  memset(expected, 0, sizeof(expected));
+  memset(actual, 0, sizeof(actual));
+  int ref_count = reference_parse(disassembly, expected, 16);
+
+  for (size_t k = 0; k < sizeof(all_kernels) / sizeof(all_kernels[0]); k++) {
+    if (!op_scan_set_kernel(all_kernels[k]))
+      continue;
+    memset(actual, 0, sizeof(actual));
+    int count = parse_disassembly(disassembly, actual, 16);
+    assert(count == ref_count);
+    for (int i = 0; i < count; i++) {
+      assert(memcmp(&actual[i], &expected[i], sizeof(DisasmLine)) == 0);
+    }
+  }
+
+  assert(expected[2].addr == 0x100001240 && expected[2].offset == 0);
+  assert(strcmp(expected[2].opcode, "sub") == 0);
+  assert(expected[4].offset == 16 && expected[4].operand_count == 2);
+  printf("disassembly equivalence: %d lines ok\n", ref_count);
+}
+
+int main() {
+  test_char_class_table();
+  test_kernels_match_scalar();
+  test_disassembly_equivalence();
+  printf("All scan tests passed!\n");
+  return 0;
+}
@@ -0,0 +1,171 @@
+#define _GNU_SOURCE
+#include "op_parser.h"
+#include "op_symtab.h"
+#include <assert.h>
+#include <link.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  const char *needle; // NULL 表示主程序
+  char path[512];
+  uint64_t bias;
+  int found;
+} ModuleQuery;
+
+static int find_module(struct dl_phdr_info *info, size_t size, void *data) {
+  (void)size;
+  ModuleQuery *q = data;
+  const char *name = info->dlpi_name ? info->dlpi_name : "";
+  if ((q->needle == NULL && name[0] == '\0') ||
+      (q->needle != NULL && strstr(name, q->needle) != NULL)) {
+    snprintf(q->path, sizeof(q->path), "%s",
+             q->needle ? name : "/proc/self/exe");
+    q->bias = info->dlpi_addr;
+    q->found = 1;
+    return 1;
+  }
+  return 0;
+}
+
+__attribute__((noinline)) static int local_helper(int x) { return x * 3 + 1; }
+
+__attribute__((noinline)) int op_symtab_test_callee(int x) {
+  return local_helper(x) + 2;
+}
+
+__attribute__((weak, noinline)) int op_symtab_weak_probe(void) { return 7; }
+
+int op_symtab_test_object[4] = {1, 2, 3, 4};
+
+static const OpSymbol *lookup(OpSymtab *tab, const void *addr, uint64_t *off) {
+  int idx = op_symtab_lookup(tab, (uint64_t)(uintptr_t)addr, off);
+  return idx < 0 ? NULL : op_symtab_get(tab, idx);
+}
+
+void test_self_exe(OpSymtab *tab) {
+  ModuleQuery q = {NULL, "", 0, 0};
+  dl_iterate_phdr(find_module, &q);
+  assert(q.found);
+  int module = op_symtab_load_elf(tab, q.path, q.bias);
+  assert(module == 0);
+  assert(strcmp(op_symtab_module_path(tab, module), "/proc/self/exe") == 0);
+  assert(op_symtab_count(tab) > 0);
+
+  uint64_t off = 99;
+  const OpSymbol *s = lookup(tab, (const void *)op_symtab_test_callee, &off);
+  assert(s && strcmp(s->name, "op_symtab_test_callee") == 0);
+  assert(off == 0 && s->kind == OP_SYM_FUNC && s->module == module);
+
+  // 函数内部地址
+  s = lookup(tab, (const char *)op_symtab_test_callee + 1, &off);
+  assert(s && strcmp(s->name, "op_symtab_test_callee") == 0 && off == 1);
+
+  // 局部符号来自 .symtab
+  s = lookup(tab, (const void *)local_helper, &off);
+  assert(s && strcmp(s->name, "local_helper") == 0);
+
+  int idx = op_symtab_find(tab, "op_symtab_weak_probe");
+  assert(idx >= 0 && op_symtab_get(tab, idx)->weak);
+  assert(op_symtab_get(tab, idx)->addr ==
+         (uint64_t)(uintptr_t)op_symtab_weak_probe);
+
+  // 全局数据对象
+  s = lookup(tab, &op_symtab_test_object[2], &off);
+  assert(s && strcmp(s->name, "op_symtab_test_object") == 0);
+  assert(s->kind == OP_SYM_OBJECT && off == 2 * sizeof(int));
+  printf("self exe: %zu symbols ok\n", op_symtab_count(tab));
+}
+
+void test_plt(OpSymtab *tab) {
+  // 本程序通过PLT调用 printf/puts 之一，对应的桩名为 name@plt
+  int idx = op_symtab_find(tab, "printf@plt");
+  if (idx < 0)
+    idx = op_symtab_find(tab, "puts@plt");
+  if (idx < 0) {
+    printf("plt: no lazy PLT in this build, skipped\n");
+    return;
+  }
+  const OpSymbol *plt = op_symtab_get(tab, idx);
+  assert(plt->kind == OP_SYM_PLT && plt->size > 0);
+  uint64_t off;
+  assert(op_symtab_lookup(tab, plt->addr + plt->size - 1, &off) == idx);
+  assert(off == plt->size - 1);
+  printf("plt: %s at 0x%llx ok\n", plt->name, (unsigned long long)plt->addr);
+}
+
+void test_libc(OpSymtab *tab) {
+  ModuleQuery q = {"libc.so", "", 0, 0};
+  dl_iterate_phdr(find_module, &q);
+  if (!q.found) {
+    printf("libc: not found, skipped\n");
+    return;
+  }
+  int module = op_symtab_load_elf(tab, q.path, q.bias);
+  assert(module == 1);
+
+  // libc 通常只有 .dynsym；别名中任选其一，地址必须一致
+  uint64_t off = 99;
+  int idx = op_symtab_lookup(tab, (uint64_t)(uintptr_t)&fopen, &off);
+  assert(idx >= 0 && off == 0);
+  assert(op_symtab_get(tab, idx)->module == module);
+  int by_name = op_symtab_find(tab, "fopen");
+  assert(by_name >= 0);
+  assert(op_symtab_get(tab, by_name)->addr == op_symtab_get(tab, idx)->addr);
+  printf("libc: %s ok\n", op_symtab_get(tab, idx)->name);
+}
+
+void test_symbolize(OpSymtab *tab) {
+  char text[512];
+  uint64_t callee = (uint64_t)(uintptr_t)op_symtab_test_callee;
+  uint64_t helper = (uint64_t)(uintptr_t)local_helper;
+  snprintf(text, sizeof(text),
+           "0x%llx <+0>: bl     0x%llx\n"
+           "0x%llx <+4>: adrp   x8, 0x%llx\n"
+           "0x%llx <+8>: ret\n",
+           (unsigned long long)callee, (unsigned long long)helper,
+           (unsigned long long)callee + 4, (unsigned long long)helper + 8,
+           (unsigned long long)callee + 8);
+
+  DisasmLine lines[4];
+  OpSymbolized out[4];
+  int count = parse_disassembly(text, lines, 4);
+  assert(count == 3);
+  assert(op_symtab_symbolize(tab, lines, count, out) == 3);
+
+  const OpSymbol *s = op_symtab_get(tab, out[0].symbol);
+  assert(strcmp(s->name, "op_symtab_test_callee") == 0 && out[0].offset == 0);
+  assert(out[1].symbol == out[0].symbol && out[1].offset == 4);
+  assert(out[0].target == helper);
+  assert(strcmp(op_symtab_get(tab, out[0].target_symbol)->name,
+                "local_helper") == 0);
+  assert(out[1].target_offset == 8);
+  assert(out[2].target_symbol == -1 && out[2].target == 0);
+  printf("symbolize: ok\n");
+}
+
+void test_errors() {
+  OpSymtab *tab = op_symtab_create();
+  assert(op_symtab_load_elf(tab, "/nonexistent/libfoo.so", 0) == -1);
+  assert(op_symtab_load_elf(tab, "/proc/self/cmdline", 0) == -1);
+  assert(op_symtab_lookup(tab, 0x1000, NULL) == -1);
+  assert(op_symtab_find(tab, "main") == -1);
+  assert(op_symtab_get(tab, 0) == NULL);
+  op_symtab_destroy(tab);
+  printf("errors: ok\n");
+}
+
+int main() {
+  OpSymtab *tab = op_symtab_create();
+  assert(local_helper(1) == 4 && op_symtab_test_callee(1) == 6);
+  assert(op_symtab_weak_probe() == 7);
+  test_self_exe(tab);
+  test_plt(tab);
+  test_libc(tab);
+  test_symbolize(tab);
+  op_symtab_destroy(tab);
+  test_errors();
+  printf("All symbol table tests passed!\n");
+  return 0;
+}
@@ -0,0 +1,72 @@
+#ifndef PT_DECODE_H
+#define PT_DECODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 机器码直接解码：只求单步需要的信息（长度、控制流分类、内存操作数），
+// 不生成反汇编文本。两种架构的解码器都不依赖宿主架构，可以在任何平台上测试
+
+// 寄存器文件下标，与 Linux 的 user_regs_struct（x86_64）/ user_pt_regs（arm64）布局一致
+enum {
+  PT_X86_R15, PT_X86_R14, PT_X86_R13, PT_X86_R12, PT_X86_RBP, PT_X86_RBX,
+  PT_X86_R11, PT_X86_R10, PT_X86_R9, PT_X86_R8, PT_X86_RAX, PT_X86_RCX,
+  PT_X86_RDX, PT_X86_RSI, PT_X86_RDI, PT_X86_ORIG_RAX, PT_X86_RIP, PT_X86_CS,
+  PT_X86_EFLAGS, PT_X86_RSP, PT_X86_SS, PT_X86_FS_BASE, PT_X86_GS_BASE,
+  PT_X86_DS, PT_X86_ES, PT_X86_FS, PT_X86_GS,
+  PT_X86_REG_COUNT
+};
+
+enum {
+  PT_A64_X0 = 0, // x0-x30
+  PT_A64_LR = 30,
+  PT_A64_SP = 31,
+  PT_A64_PC = 32,
+  PT_A64_PSTATE = 33,
+  PT_A64_REG_COUNT
+};
+
+enum {
+  PT_BASE_NONE = -1, // 无基址 / 无变址（arm64 的 xzr 变址同样视为0）
+  PT_BASE_PC = -2,   // 当前指令地址（arm64 字面量）
+  PT_BASE_NEXT_PC = -3 // 下一条指令地址（x86_64 RIP 相对）
+};
+
+enum { PT_EXT_NONE, PT_EXT_UXTW, PT_EXT_SXTW };
+enum { PT_SEG_NONE, PT_SEG_FS, PT_SEG_GS };
+
+// 一个内存操作数：addr = base + extend(index) << shift + disp (+ 段基址)
+typedef struct {
+  int8_t base;
+  int8_t index;
+  uint8_t shift;
+  uint8_t extend; // PT_EXT_*
+  uint8_t seg;    // PT_SEG_*
+  uint8_t flags;  // PT_MEM_READ / PT_MEM_WRITE
+  uint16_t size;  // 字节
+  int64_t disp;
+} PtMemRef;
+
+#define PT_MAX_MEM 2
+
+enum {
+  PT_DEC_MEM_UNKNOWN = 1 // 指令访问内存但操作数未解码（x87、EVEX、arm64 ld1/st1 等）
+};
+
+typedef struct {
+  uint8_t len;
+  uint8_t kind; // PT_INSN_*
+  uint8_t mem_count;
+  uint8_t flags; // PT_DEC_*
+  PtMemRef mem[PT_MAX_MEM];
+} PtInsn;
+
+// 解码 code 处的一条指令，avail 为可用字节数；无法识别时返回0
+int pt_decode_x86_64(const uint8_t *code, size_t avail, PtInsn *out);
+int pt_decode_arm64(uint32_t word, PtInsn *out);
+
+// 用执行前的寄存器求内存操作数地址，arch 为 PT_ARCH_*
+uint64_t pt_mem_address(int arch, const PtMemRef *ref, const uint64_t *regs,
+                        uint64_t pc, uint8_t len);
+
+#endif
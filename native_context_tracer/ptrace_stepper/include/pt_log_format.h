@@ -0,0 +1,78 @@
+#ifndef PT_LOG_FORMAT_H
+#define PT_LOG_FORMAT_H
+
+#include <stdint.h>
+
+// pt_stepper 二进制日志格式（主机字节序）：
+//   PtFileHeader
+//   若干记录：PtRecord + 寄存器值 + PtMemOp / PtModuleInfo
+// 记录按发生顺序写出，不同线程的记录交错出现
+
+#define PT_FILE_MAGIC "NCPTSTEP"
+#define PT_FILE_VERSION 1
+
+enum { PT_ARCH_X86_64 = 1, PT_ARCH_ARM64 = 2 };
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t arch;      // PT_ARCH_*
+  uint32_t pid;
+  uint32_t reg_count; // 寄存器文件中的寄存器数，见 PT_X86_* / PT_A64_*
+  uint64_t start_realtime_ns;
+} PtFileHeader;
+
+enum {
+  PT_REC_STEP = 1,         // 执行了 pc 处的一条指令
+  PT_REC_THREAD_START = 2, // 线程开始单步，regmask 为全部寄存器
+  PT_REC_THREAD_EXIT = 3,  // pc 为退出码（被信号结束时为 128+信号）
+  PT_REC_SKIP_BEGIN = 4,   // 离开跟踪范围，pc 为范围外的第一条指令
+  PT_REC_SKIP_END = 5,     // 回到跟踪范围，pc 为回来后的第一条指令（尚未执行）
+  PT_REC_MODULE = 6,       // 可执行映射，pc 为起始地址，后跟 PtModuleInfo
+  PT_REC_BLOCK_STEP = 7    // 块步进中未单步、按解码结果补出的直线指令：不带访存值，
+                           // 整个块的寄存器变化记在块的最后一条上
+};
+
+// 指令分类，由指令解码得到
+enum {
+  PT_INSN_OTHER = 0,
+  PT_INSN_CALL = 1,
+  PT_INSN_RET = 2,
+  PT_INSN_JUMP = 3,
+  PT_INSN_COND_JUMP = 4,
+  PT_INSN_SYSCALL = 5,
+  PT_INSN_INTERRUPT = 6 // int3/int n/int1，陷入内核后由信号或内核决定去向
+};
+
+typedef struct {
+  uint32_t tid;
+  uint8_t type;      // PT_REC_*
+  uint8_t kind;      // PT_INSN_*，仅 STEP
+  uint8_t mem_count; // 其后的 PtMemOp 数
+  uint8_t len;       // 指令长度，仅 STEP
+  uint64_t pc;
+  uint64_t regmask;  // 与上一条记录相比发生变化的寄存器，值按编号升序紧随其后
+} PtRecord;
+
+enum {
+  PT_MEM_READ = 1,
+  PT_MEM_WRITE = 2,
+  PT_MEM_UNREADABLE = 4 // 执行后无法读取，value 为0
+};
+
+typedef struct {
+  uint64_t addr;
+  uint64_t value; // 执行后该地址处的内容，超过8字节时只取前8字节
+  uint32_t size;
+  uint32_t flags; // PT_MEM_*
+} PtMemOp;
+
+// path 紧跟其后，长度按8字节向上对齐
+typedef struct {
+  uint64_t end;
+  uint64_t bias;  // 运行时地址 - 文件虚拟地址
+  uint32_t path_len;
+  uint32_t reserved;
+} PtModuleInfo;
+
+#endif
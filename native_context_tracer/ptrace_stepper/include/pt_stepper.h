@@ -0,0 +1,36 @@
+#ifndef PT_STEPPER_H
+#define PT_STEPPER_H
+
+#include <stdint.h>
+
+// 基于 ptrace 的原生单步引擎（Linux x86_64 / arm64）
+// 不经过 LLDB：PTRACE_SINGLESTEP 单步跟踪范围内的指令，记录 PC、变化的寄存器
+// 和内存操作数；范围外的调用用线程私有的硬件断点跳过（PTRACE_CONT），
+// 起始函数用软件断点。日志格式见 pt_log_format.h
+
+typedef struct {
+  const char *log_path;     // 输出日志
+  const char *start_symbol; // 跟踪起点（符号名），NULL 时为 main，找不到则为程序入口
+  uint64_t start_addr;      // 非0时代替 start_symbol，运行时地址
+  const char **modules;     // 逐条记录的模块（路径包含该字符串即可），NULL 结尾；
+                            // NULL 表示只记录主程序
+  int all_modules;          // 1：所有模块都单步记录，不跳过调用
+  uint64_t max_steps;       // 记录到该步数后分离，0 表示不限
+  int block_step;           // 1：直线指令用硬件断点一次运行到下一条控制流指令，
+                            // 只单步控制流指令本身
+} PtOptions;
+
+typedef struct {
+  uint64_t steps;         // STEP 记录数
+  uint64_t silent_steps;  // 跟踪范围外、无法用断点跳过而逐条单步的指令数
+  uint64_t skipped_calls; // 用硬件断点跳过的范围外调用
+  uint64_t threads;       // 被单步过的线程数
+  uint64_t stops;         // 开始跟踪后线程停下交给跟踪器的次数
+  double seconds;         // 从开始单步到结束
+} PtStats;
+
+// 启动 argv[0] 并跟踪到进程退出（或达到 max_steps 后分离并等待退出）。
+// 返回被跟踪进程的退出码（被信号结束时为 128+信号），启动失败返回 -1
+int pt_trace_run(const PtOptions *options, char *const argv[], PtStats *stats);
+
+#endif
@@ -0,0 +1,28 @@
+#include "pt_decode.h"
+#include "pt_log_format.h"
+
+static uint64_t reg_value(int reg, const uint64_t *regs, uint64_t pc,
+                          uint8_t len) {
+  switch (reg) {
+  case PT_BASE_NONE: return 0;
+  case PT_BASE_PC: return pc;
+  case PT_BASE_NEXT_PC: return pc + len;
+  default: return regs[reg];
+  }
+}
+
+uint64_t pt_mem_address(int arch, const PtMemRef *ref, const uint64_t *regs,
+                        uint64_t pc, uint8_t len) {
+  uint64_t index = reg_value(ref->index, regs, pc, len);
+  if (ref->extend == PT_EXT_UXTW)
+    index = (uint32_t)index;
+  else if (ref->extend == PT_EXT_SXTW)
+    index = (uint64_t)(int64_t)(int32_t)index;
+  uint64_t addr = reg_value(ref->base, regs, pc, len) + (index << ref->shift) +
+                  (uint64_t)ref->disp;
+  if (arch == PT_ARCH_X86_64 && ref->seg == PT_SEG_FS)
+    addr += regs[PT_X86_FS_BASE];
+  else if (arch == PT_ARCH_X86_64 && ref->seg == PT_SEG_GS)
+    addr += regs[PT_X86_GS_BASE];
+  return addr;
+}
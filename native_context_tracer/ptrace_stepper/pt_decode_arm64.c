@@ -0,0 +1,131 @@
+#include "pt_decode.h"
+#include "pt_log_format.h"
+#include <string.h>
+
+// arm64 指令解码：定长4字节，只需识别控制流和各类 load/store 的寻址方式。
+// SIMD 结构化访存（ld1/st1 等）只标记 PT_DEC_MEM_UNKNOWN
+
+static int64_t sign_extend(uint32_t value, int bits) {
+  uint64_t m = (uint64_t)1 << (bits - 1);
+  return (int64_t)(((uint64_t)value ^ m) - m);
+}
+
+static void add_mem(PtInsn *out, int base, int index, int shift, int extend,
+                    int64_t disp, int size, int flags) {
+  if (out->mem_count >= PT_MAX_MEM)
+    return;
+  PtMemRef *m = &out->mem[out->mem_count++];
+  memset(m, 0, sizeof(*m));
+  m->base = (int8_t)base;
+  m->index = (int8_t)index;
+  m->shift = (uint8_t)shift;
+  m->extend = (uint8_t)extend;
+  m->disp = disp;
+  m->size = (uint16_t)size;
+  m->flags = (uint8_t)flags;
+}
+
+// 基址寄存器编号31在 load/store 中是 sp
+static int base_reg(uint32_t insn) { return (int)((insn >> 5) & 31); }
+
+// 单寄存器 load/store 的访问大小和方向；opc 为 23:22 位，返回0表示预取等不访存
+static int single_access(uint32_t insn, int *size, int *flags) {
+  int sz = (int)(insn >> 30), v = (insn >> 26) & 1, opc = (int)((insn >> 22) & 3);
+  if (v) {
+    *size = (opc & 2) && sz == 0 ? 16 : 1 << sz;
+    *flags = opc & 1 ? PT_MEM_READ : PT_MEM_WRITE;
+    return !((opc & 2) && sz != 0);
+  }
+  if (sz == 3 && opc == 2) // prfm
+    return 0;
+  *size = 1 << sz;
+  *flags = opc == 0 ? PT_MEM_WRITE : PT_MEM_READ;
+  return 1;
+}
+
+static void decode_load_store(uint32_t insn, PtInsn *out) {
+  int size, flags;
+  int v = (insn >> 26) & 1;
+
+  if ((insn & 0x3b000000) == 0x39000000) { // 无符号立即数偏移
+    if (!single_access(insn, &size, &flags))
+      return;
+    uint32_t imm12 = (insn >> 10) & 0xfff;
+    add_mem(out, base_reg(insn), PT_BASE_NONE, 0, PT_EXT_NONE,
+            (int64_t)imm12 * size, size, flags);
+    return;
+  }
+  if ((insn & 0x3b200000) == 0x38000000) { // 非缩放 / 后变址 / 前变址
+    if (!single_access(insn, &size, &flags))
+      return;
+    int mode = (int)((insn >> 10) & 3);
+    int64_t imm9 = sign_extend((insn >> 12) & 0x1ff, 9);
+    add_mem(out, base_reg(insn), PT_BASE_NONE, 0, PT_EXT_NONE,
+            mode == 1 ? 0 : imm9, size, flags);
+    return;
+  }
+  if ((insn & 0x3b200c00) == 0x38200800) { // 寄存器偏移
+    if (!single_access(insn, &size, &flags))
+      return;
+    int rm = (int)((insn >> 16) & 31), option = (int)((insn >> 13) & 7);
+    int shift = (insn >> 12) & 1 ? __builtin_ctz((unsigned)size) : 0;
+    int extend = option == 2 ? PT_EXT_UXTW : option == 6 ? PT_EXT_SXTW : PT_EXT_NONE;
+    add_mem(out, base_reg(insn), rm == 31 ? PT_BASE_NONE : rm, shift, extend, 0,
+            size, flags);
+    return;
+  }
+  if ((insn & 0x3b200c00) == 0x38200000 && !v) { // LSE 原子操作
+    add_mem(out, base_reg(insn), PT_BASE_NONE, 0, PT_EXT_NONE, 0,
+            1 << (insn >> 30), PT_MEM_READ | PT_MEM_WRITE);
+    return;
+  }
+  if ((insn & 0x3a000000) == 0x28000000) { // ldp/stp
+    int opc = (int)(insn >> 30), mode = (int)((insn >> 23) & 7);
+    int elem = v ? 4 << opc : opc & 2 ? 8 : 4;
+    if (mode > 3 || (v && opc == 3))
+      return;
+    int64_t imm7 = sign_extend((insn >> 15) & 0x7f, 7) * elem;
+    add_mem(out, base_reg(insn), PT_BASE_NONE, 0, PT_EXT_NONE,
+            mode == 1 ? 0 : imm7, elem * 2,
+            (insn >> 22) & 1 ? PT_MEM_READ : PT_MEM_WRITE);
+    return;
+  }
+  if ((insn & 0x3b000000) == 0x18000000) { // 字面量
+    int opc = (int)(insn >> 30);
+    if (opc == 3 && !v) // prfm literal
+      return;
+    size = v ? 4 << opc : opc == 1 ? 8 : 4;
+    add_mem(out, PT_BASE_PC, PT_BASE_NONE, 0, PT_EXT_NONE,
+            sign_extend((insn >> 5) & 0x7ffff, 19) * 4, size, PT_MEM_READ);
+    return;
+  }
+  if ((insn & 0x3f000000) == 0x08000000) { // 独占 / 获取-释放
+    int pair = (insn >> 21) & 1, load = (insn >> 22) & 1;
+    size = (1 << (insn >> 30)) * (pair ? 2 : 1);
+    add_mem(out, base_reg(insn), PT_BASE_NONE, 0, PT_EXT_NONE, 0, size,
+            load ? PT_MEM_READ : PT_MEM_WRITE);
+    return;
+  }
+  if ((insn & 0xbf800000) == 0x0c000000 || (insn & 0xbf800000) == 0x0c800000 ||
+      (insn & 0xbf800000) == 0x0d000000 || (insn & 0xbf800000) == 0x0d800000)
+    out->flags |= PT_DEC_MEM_UNKNOWN; // ld1/st1 等结构化访存
+}
+
+int pt_decode_arm64(uint32_t insn, PtInsn *out) {
+  memset(out, 0, sizeof(*out));
+  out->len = 4;
+  if ((insn & 0xfc000000) == 0x94000000 || (insn & 0xfffffc1f) == 0xd63f0000)
+    out->kind = PT_INSN_CALL; // bl / blr
+  else if ((insn & 0xfffffc1f) == 0xd65f0000)
+    out->kind = PT_INSN_RET;
+  else if ((insn & 0xfc000000) == 0x14000000 || (insn & 0xfffffc1f) == 0xd61f0000)
+    out->kind = PT_INSN_JUMP; // b / br
+  else if ((insn & 0xff000010) == 0x54000000 || (insn & 0x7e000000) == 0x34000000 ||
+           (insn & 0x7e000000) == 0x36000000)
+    out->kind = PT_INSN_COND_JUMP; // b.cond / cbz / cbnz / tbz / tbnz
+  else if ((insn & 0xffe0001f) == 0xd4000001)
+    out->kind = PT_INSN_SYSCALL; // svc
+  else if ((insn & 0x0a000000) == 0x08000000)
+    decode_load_store(insn, out); // op0 x1x0：load/store 指令组
+  return 1;
+}
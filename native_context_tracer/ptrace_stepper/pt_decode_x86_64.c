@@ -0,0 +1,621 @@
+#include "pt_decode.h"
+#include "pt_log_format.h"
+#include <string.h>
+
+// x86_64 指令解码：前缀、REX/VEX/EVEX、ModRM/SIB/位移、立即数，
+// 覆盖编译器生成代码中常见的通用寄存器、SSE/AVX 访存指令。
+// 只解码长度的指令（x87、EVEX 等）标记 PT_DEC_MEM_UNKNOWN
+
+// ModRM/SIB 中的寄存器编号 -> 寄存器文件下标
+static const int8_t gpr[16] = {
+    PT_X86_RAX, PT_X86_RCX, PT_X86_RDX, PT_X86_RBX, PT_X86_RSP, PT_X86_RBP,
+    PT_X86_RSI, PT_X86_RDI, PT_X86_R8,  PT_X86_R9,  PT_X86_R10, PT_X86_R11,
+    PT_X86_R12, PT_X86_R13, PT_X86_R14, PT_X86_R15};
+
+typedef struct {
+  const uint8_t *p, *end;
+  int opsize16, addr32, rep, repne, rex_w, rex_r, rex_x, rex_b;
+  uint8_t seg;
+  PtInsn *out;
+} Cursor;
+
+enum { NONE = 0, R = PT_MEM_READ, W = PT_MEM_WRITE, RW = R | W };
+
+static int get(Cursor *c, uint8_t *v) {
+  if (c->p >= c->end)
+    return 0;
+  *v = *c->p++;
+  return 1;
+}
+
+static int skip(Cursor *c, size_t n) {
+  if ((size_t)(c->end - c->p) < n)
+    return 0;
+  c->p += n;
+  return 1;
+}
+
+static int get_signed(Cursor *c, int n, int64_t *v) {
+  if ((size_t)(c->end - c->p) < (size_t)n)
+    return 0;
+  if (n == 1) {
+    *v = (int8_t)c->p[0];
+  } else {
+    int32_t d;
+    memcpy(&d, c->p, 4);
+    *v = d;
+  }
+  c->p += n;
+  return 1;
+}
+
+// 操作数大小 v：16/32/64
+static int vsize(const Cursor *c) {
+  return c->rex_w ? 8 : c->opsize16 ? 2 : 4;
+}
+
+// 立即数大小 z：16/32
+static int zsize(const Cursor *c) { return c->opsize16 ? 2 : 4; }
+
+static void add_mem(Cursor *c, const PtMemRef *ref, int size, int flags) {
+  PtInsn *out = c->out;
+  if (flags == NONE || out->mem_count >= PT_MAX_MEM)
+    return;
+  if (c->addr32) { // 32位地址运算，不计算地址
+    out->flags |= PT_DEC_MEM_UNKNOWN;
+    return;
+  }
+  PtMemRef *m = &out->mem[out->mem_count++];
+  *m = *ref;
+  m->size = (uint16_t)size;
+  m->flags = (uint8_t)flags;
+}
+
+static void add_reg_mem(Cursor *c, int base, int64_t disp, int size, int flags,
+                        int seg) {
+  PtMemRef ref = {(int8_t)base, PT_BASE_NONE, 0, PT_EXT_NONE, (uint8_t)seg,
+                  0, 0, disp};
+  add_mem(c, &ref, size, flags);
+}
+
+static void push_op(Cursor *c, int size) {
+  add_reg_mem(c, PT_X86_RSP, -size, size, W, PT_SEG_NONE);
+}
+
+static void pop_op(Cursor *c, int size) {
+  add_reg_mem(c, PT_X86_RSP, 0, size, R, PT_SEG_NONE);
+}
+
+// 解析 ModRM（及 SIB、位移）。返回1表示内存操作数，0表示寄存器，-1表示截断
+static int modrm(Cursor *c, PtMemRef *ref, int *reg) {
+  uint8_t m;
+  if (!get(c, &m))
+    return -1;
+  int mod = m >> 6, rm = m & 7;
+  *reg = (m >> 3) & 7;
+  if (mod == 3)
+    return 0;
+  memset(ref, 0, sizeof(*ref));
+  ref->base = ref->index = PT_BASE_NONE;
+  ref->seg = c->seg;
+  int disp_size = mod == 1 ? 1 : mod == 2 ? 4 : 0;
+  if (rm == 4) {
+    uint8_t sib;
+    if (!get(c, &sib))
+      return -1;
+    int index = ((sib >> 3) & 7) | (c->rex_x << 3);
+    int base = sib & 7;
+    if (index != 4) {
+      ref->index = gpr[index];
+      ref->shift = sib >> 6;
+    }
+    if (base == 5 && mod == 0)
+      disp_size = 4;
+    else
+      ref->base = gpr[base | (c->rex_b << 3)];
+  } else if (rm == 5 && mod == 0) {
+    ref->base = PT_BASE_NEXT_PC;
+    disp_size = 4;
+  } else {
+    ref->base = gpr[rm | (c->rex_b << 3)];
+  }
+  if (disp_size && !get_signed(c, disp_size, &ref->disp))
+    return -1;
+  return 1;
+}
+
+// 带 ModRM 的指令：内存操作数按 size/flags 记录，之后跳过 imm 字节立即数
+static int with_modrm(Cursor *c, int size, int flags, int imm) {
+  PtMemRef ref;
+  int reg;
+  int is_mem = modrm(c, &ref, &reg);
+  if (is_mem < 0)
+    return 0;
+  if (is_mem)
+    add_mem(c, &ref, size, flags);
+  return skip(c, (size_t)imm);
+}
+
+// SSE/MMX 向量操作数大小
+static int vec_size(const Cursor *c) {
+  return c->opsize16 || c->rep || c->repne ? 16 : 8;
+}
+
+static int decode_0f(Cursor *c, PtInsn *out) {
+  uint8_t op;
+  if (!get(c, &op))
+    return 0;
+  PtMemRef ref;
+  int reg, is_mem;
+
+  if (op >= 0x80 && op <= 0x8f) {
+    out->kind = PT_INSN_COND_JUMP;
+    return skip(c, 4);
+  }
+  if (op >= 0xc8 && op <= 0xcf) // bswap
+    return 1;
+  switch (op) {
+  case 0x05: // syscall
+  case 0x34: // sysenter
+    out->kind = PT_INSN_SYSCALL;
+    return 1;
+  case 0x06: case 0x07: case 0x08: case 0x09: case 0x0b: case 0x0e:
+  case 0x30: case 0x31: case 0x32: case 0x33: case 0x35: case 0x37:
+  case 0x77: case 0xa0: case 0xa1: case 0xa2: case 0xa8: case 0xa9:
+  case 0xaa:
+    return 1;
+  case 0x38: // 三字节 0F 38
+    if (!get(c, &op))
+      return 0;
+    return with_modrm(c, vec_size(c), R, 0);
+  case 0x3a: { // 三字节 0F 3A，带 imm8
+    if (!get(c, &op))
+      return 0;
+    int size = vec_size(c), flags = R;
+    if (op >= 0x14 && op <= 0x17) { // pextrb/w/d/q, extractps
+      static const int sizes[4] = {1, 2, 4, 4};
+      size = op == 0x16 && c->rex_w ? 8 : sizes[op - 0x14];
+      flags = W;
+    }
+    return with_modrm(c, size, flags, 1);
+  }
+  case 0x0d: case 0x18: case 0x19: case 0x1a: case 0x1b: case 0x1c:
+  case 0x1d: case 0x1e: case 0x1f: // prefetch / nop / endbr
+    return with_modrm(c, 0, NONE, 0);
+  case 0x00: case 0x01: case 0xae: case 0xc7: // 系统指令、fxsave、cmpxchg16b 等
+    is_mem = modrm(c, &ref, &reg);
+    if (is_mem < 0)
+      return 0;
+    if (is_mem && op == 0xc7 && reg == 1)
+      add_mem(c, &ref, c->rex_w ? 16 : 8, RW);
+    else if (is_mem && op == 0xae && (reg == 2 || reg == 3))
+      add_mem(c, &ref, 4, reg == 2 ? R : W); // ldmxcsr / stmxcsr
+    else if (is_mem)
+      out->flags |= PT_DEC_MEM_UNKNOWN;
+    return 1;
+  case 0x10: case 0x11: {
+    int size = c->rep ? 4 : c->repne ? 8 : 16;
+    return with_modrm(c, size, op == 0x11 ? W : R, 0);
+  }
+  case 0x12: case 0x16:
+    return with_modrm(c, 8, R, 0);
+  case 0x13: case 0x17:
+    return with_modrm(c, 8, W, 0);
+  case 0x29: case 0x2b: case 0xe7:
+    return with_modrm(c, 16, W, 0);
+  case 0x7f:
+    return with_modrm(c, vec_size(c), W, 0);
+  case 0xd6:
+    return with_modrm(c, 8, W, 0);
+  case 0x7e:
+    if (c->rep) // movq xmm, m64
+      return with_modrm(c, 8, R, 0);
+    return with_modrm(c, c->rex_w ? 8 : 4, W, 0);
+  case 0x6e:
+    return with_modrm(c, c->rex_w ? 8 : 4, R, 0);
+  case 0xc3: // movnti
+    return with_modrm(c, c->rex_w ? 8 : 4, W, 0);
+  case 0x2a:
+    return with_modrm(c, c->rep || c->repne ? (c->rex_w ? 8 : 4) : 8, R, 0);
+  case 0x2c: case 0x2d:
+    return with_modrm(c, c->rep ? 4 : 8, R, 0);
+  case 0x2e: case 0x2f:
+    return with_modrm(c, c->opsize16 ? 8 : 4, R, 0);
+  case 0xa3: case 0xaf: case 0xbc: case 0xbd: case 0xb8:
+    return with_modrm(c, vsize(c), R, 0);
+  case 0xab: case 0xb3: case 0xbb: case 0xa5: case 0xad:
+    return with_modrm(c, vsize(c), RW, 0);
+  case 0xa4: case 0xac:
+    return with_modrm(c, vsize(c), RW, 1);
+  case 0xba:
+    is_mem = modrm(c, &ref, &reg);
+    if (is_mem < 0)
+      return 0;
+    if (is_mem)
+      add_mem(c, &ref, vsize(c), reg == 4 ? R : RW);
+    return skip(c, 1);
+  case 0xb0: case 0xc0:
+    return with_modrm(c, 1, RW, 0);
+  case 0xb1: case 0xc1:
+    return with_modrm(c, vsize(c), RW, 0);
+  case 0xb6: case 0xbe:
+    return with_modrm(c, 1, R, 0);
+  case 0xb7: case 0xbf:
+    return with_modrm(c, 2, R, 0);
+  case 0x70: case 0x71: case 0x72: case 0x73: case 0xc2: case 0xc6:
+    return with_modrm(c, vec_size(c), R, 1);
+  case 0xc4:
+    return with_modrm(c, 2, R, 1);
+  case 0xc5:
+    return with_modrm(c, 0, NONE, 1);
+  case 0x0f: // 3DNow!
+    return with_modrm(c, 8, R, 1);
+  default:
+    break;
+  }
+  if (op >= 0x40 && op <= 0x4f) // cmovcc
+    return with_modrm(c, vsize(c), R, 0);
+  if (op >= 0x90 && op <= 0x9f) // setcc
+    return with_modrm(c, 1, W, 0);
+  if ((op >= 0x14 && op <= 0x15) || op == 0x28 || (op >= 0x50 && op <= 0x5f))
+    return with_modrm(c, c->rep ? 4 : c->repne ? 8 : 16, R, 0);
+  if ((op >= 0x60 && op <= 0x6f) || (op >= 0x74 && op <= 0x76) ||
+      op >= 0xd0)
+    return with_modrm(c, vec_size(c), R, 0);
+  return with_modrm(c, vsize(c), R, 0);
+}
+
+// VEX 编码（C4/C5）：所有指令都有 ModRM，访存大小取向量长度
+static int decode_vex(Cursor *c, uint8_t first, PtInsn *out) {
+  uint8_t b1, b2 = 0, op;
+  int map = 1, pp, l;
+  if (!get(c, &b1))
+    return 0;
+  if (first == 0xc5) {
+    c->rex_r = !(b1 & 0x80);
+    pp = b1 & 3;
+    l = (b1 >> 2) & 1;
+  } else {
+    if (!get(c, &b2))
+      return 0;
+    c->rex_r = !(b1 & 0x80);
+    c->rex_x = !(b1 & 0x40);
+    c->rex_b = !(b1 & 0x20);
+    map = b1 & 0x1f;
+    c->rex_w = b2 >> 7;
+    pp = b2 & 3;
+    l = (b2 >> 2) & 1;
+  }
+  if (!get(c, &op))
+    return 0;
+  if (map == 1 && op == 0x77) // vzeroupper / vzeroall
+    return 1;
+  int size = l ? 32 : 16, flags = R, imm = map == 3;
+  if (map == 1) {
+    switch (op) {
+    case 0x10: case 0x11: // vmovups/vmovss/vmovsd
+      size = pp == 2 ? 4 : pp == 3 ? 8 : size;
+      flags = op == 0x11 ? W : R;
+      break;
+    case 0x13: case 0x17: case 0xd6:
+      size = 8;
+      flags = W;
+      break;
+    case 0x12: case 0x16:
+      size = 8;
+      break;
+    case 0x29: case 0x2b: case 0x7f: case 0xe7:
+      flags = W;
+      break;
+    case 0x7e:
+      size = pp == 2 ? 8 : c->rex_w ? 8 : 4;
+      flags = pp == 2 ? R : W;
+      break;
+    case 0x6e:
+      size = c->rex_w ? 8 : 4;
+      break;
+    case 0x70: case 0x71: case 0x72: case 0x73: case 0xc2: case 0xc4:
+    case 0xc5: case 0xc6:
+      imm = 1;
+      break;
+    default:
+      if (pp >= 2 && op >= 0x51 && op <= 0x5f) // 标量运算
+        size = pp == 2 ? 4 : 8;
+      break;
+    }
+  } else if (map == 3 && op >= 0x14 && op <= 0x17) {
+    static const int sizes[4] = {1, 2, 4, 4};
+    size = op == 0x16 && c->rex_w ? 8 : sizes[op - 0x14];
+    flags = W;
+  } else if (map == 3 && (op == 0x19 || op == 0x39 || op == 0x1d)) {
+    size = 16; // vextractf128 / vextracti128 / vcvtps2ph
+    flags = W;
+  } else if (map != 2 && map != 3) {
+    return 0;
+  }
+  (void)out;
+  return with_modrm(c, size, flags, imm);
+}
+
+// EVEX 编码（62）：压缩位移需要知道元素大小，只解码长度
+static int decode_evex(Cursor *c, PtInsn *out) {
+  uint8_t p0, p1, p2, op;
+  if (!get(c, &p0) || !get(c, &p1) || !get(c, &p2) || !get(c, &op))
+    return 0;
+  (void)p1;
+  (void)p2;
+  int map = p0 & 3;
+  if (map == 0)
+    return 0;
+  PtMemRef ref;
+  int reg, is_mem = modrm(c, &ref, &reg);
+  if (is_mem < 0)
+    return 0;
+  if (is_mem)
+    out->flags |= PT_DEC_MEM_UNKNOWN;
+  int imm = map == 3 || (map == 1 && ((op >= 0x70 && op <= 0x73) ||
+                                      op == 0xc2 || op == 0xc4 ||
+                                      op == 0xc5 || op == 0xc6));
+  return skip(c, imm ? 1 : 0);
+}
+
+// 字符串指令：rsi 一侧可被段前缀覆盖，rdi 一侧固定
+static void string_op(Cursor *c, int size, int src, int dst) {
+  if (src)
+    add_reg_mem(c, PT_X86_RSI, 0, size, src, c->seg);
+  if (dst)
+    add_reg_mem(c, PT_X86_RDI, 0, size, dst, PT_SEG_NONE);
+}
+
+static int decode_one(Cursor *c, uint8_t op, PtInsn *out) {
+  PtMemRef ref;
+  int reg, is_mem;
+  int v = vsize(c);
+
+  if (op < 0x40) {
+    int low = op & 7;
+    if (op == 0x0f)
+      return decode_0f(c, out);
+    if (low >= 6)
+      return 0; // 64位模式下无效
+    int dst = op >= 0x38 && op <= 0x3d ? R : RW; // cmp 只读
+    switch (low) {
+    case 0: return with_modrm(c, 1, dst, 0);
+    case 1: return with_modrm(c, v, dst, 0);
+    case 2: return with_modrm(c, 1, R, 0);
+    case 3: return with_modrm(c, v, R, 0);
+    case 4: return skip(c, 1);
+    default: return skip(c, (size_t)zsize(c));
+    }
+  }
+  if (op >= 0x50 && op <= 0x57) {
+    push_op(c, c->opsize16 ? 2 : 8);
+    return 1;
+  }
+  if (op >= 0x58 && op <= 0x5f) {
+    pop_op(c, c->opsize16 ? 2 : 8);
+    return 1;
+  }
+  if (op >= 0x70 && op <= 0x7f) {
+    out->kind = PT_INSN_COND_JUMP;
+    return skip(c, 1);
+  }
+  if (op >= 0x90 && op <= 0x99)
+    return 1;
+  if (op >= 0xb0 && op <= 0xb7)
+    return skip(c, 1);
+  if (op >= 0xb8 && op <= 0xbf)
+    return skip(c, c->rex_w ? 8 : (size_t)zsize(c));
+  if (op >= 0xd8 && op <= 0xdf) { // x87
+    is_mem = modrm(c, &ref, &reg);
+    if (is_mem < 0)
+      return 0;
+    if (is_mem)
+      out->flags |= PT_DEC_MEM_UNKNOWN;
+    return 1;
+  }
+
+  switch (op) {
+  case 0x63: return with_modrm(c, 4, R, 0);
+  case 0x68: push_op(c, 8); return skip(c, (size_t)zsize(c));
+  case 0x6a: push_op(c, 8); return skip(c, 1);
+  case 0x69: return with_modrm(c, v, R, zsize(c));
+  case 0x6b: return with_modrm(c, v, R, 1);
+  case 0x6c: case 0x6d: case 0x6e: case 0x6f: return 1;
+  case 0x80: case 0x81: case 0x83:
+    is_mem = modrm(c, &ref, &reg);
+    if (is_mem < 0)
+      return 0;
+    if (is_mem)
+      add_mem(c, &ref, op == 0x80 ? 1 : v, reg == 7 ? R : RW);
+    return skip(c, op == 0x81 ? (size_t)zsize(c) : 1);
+  case 0x84: return with_modrm(c, 1, R, 0);
+  case 0x85: return with_modrm(c, v, R, 0);
+  case 0x86: return with_modrm(c, 1, RW, 0);
+  case 0x87: return with_modrm(c, v, RW, 0);
+  case 0x88: return with_modrm(c, 1, W, 0);
+  case 0x89: return with_modrm(c, v, W, 0);
+  case 0x8a: return with_modrm(c, 1, R, 0);
+  case 0x8b: return with_modrm(c, v, R, 0);
+  case 0x8c: return with_modrm(c, 2, W, 0);
+  case 0x8d: return with_modrm(c, 0, NONE, 0); // lea 不访存
+  case 0x8e: return with_modrm(c, 2, R, 0);
+  case 0x8f:
+    pop_op(c, 8);
+    return with_modrm(c, 8, W, 0);
+  case 0x9b: case 0x9e: case 0x9f: return 1;
+  case 0x9c: push_op(c, 8); return 1;
+  case 0x9d: pop_op(c, 8); return 1;
+  case 0xa0: case 0xa1: case 0xa2: case 0xa3: { // mov al/eax, moffs
+    size_t n = c->addr32 ? 4 : 8;
+    if ((size_t)(c->end - c->p) < n)
+      return 0;
+    uint64_t addr = 0;
+    memcpy(&addr, c->p, n);
+    c->p += n;
+    add_reg_mem(c, PT_BASE_NONE, (int64_t)addr, op & 1 ? v : 1,
+                op < 0xa2 ? R : W, c->seg);
+    return 1;
+  }
+  case 0xa4: string_op(c, 1, R, W); return 1;
+  case 0xa5: string_op(c, v, R, W); return 1;
+  case 0xa6: string_op(c, 1, R, R); return 1;
+  case 0xa7: string_op(c, v, R, R); return 1;
+  case 0xa8: return skip(c, 1);
+  case 0xa9: return skip(c, (size_t)zsize(c));
+  case 0xaa: string_op(c, 1, NONE, W); return 1;
+  case 0xab: string_op(c, v, NONE, W); return 1;
+  case 0xac: string_op(c, 1, R, NONE); return 1;
+  case 0xad: string_op(c, v, R, NONE); return 1;
+  case 0xae: string_op(c, 1, NONE, R); return 1;
+  case 0xaf: string_op(c, v, NONE, R); return 1;
+  case 0xc0: return with_modrm(c, 1, RW, 1);
+  case 0xc1: return with_modrm(c, v, RW, 1);
+  case 0xc2:
+    out->kind = PT_INSN_RET;
+    pop_op(c, 8);
+    return skip(c, 2);
+  case 0xc3:
+    out->kind = PT_INSN_RET;
+    pop_op(c, 8);
+    return 1;
+  case 0xc6: return with_modrm(c, 1, W, 1);
+  case 0xc7: return with_modrm(c, v, W, zsize(c));
+  case 0xc8: push_op(c, 8); return skip(c, 3);
+  case 0xc9: // leave：从 [rbp] 弹出
+    add_reg_mem(c, PT_X86_RBP, 0, 8, R, PT_SEG_NONE);
+    return 1;
+  case 0xca: case 0xcb: // 远返回：弹出 ip 和 cs，默认32位操作数
+    out->kind = PT_INSN_RET;
+    pop_op(c, 2 * v);
+    return op == 0xca ? skip(c, 2) : 1;
+  case 0xcf: // iret：弹出 ip、cs、flags、sp、ss
+    out->kind = PT_INSN_RET;
+    pop_op(c, 5 * v);
+    return 1;
+  case 0xcc: case 0xf1: // int3、int1
+    out->kind = PT_INSN_INTERRUPT;
+    return 1;
+  case 0xcd: // int n
+    out->kind = PT_INSN_INTERRUPT;
+    return skip(c, 1);
+  case 0xf4: case 0xf5: case 0xf8: case 0xf9: case 0xfa: case 0xfb:
+  case 0xfc: case 0xfd:
+    return 1;
+  case 0xd0: case 0xd2: return with_modrm(c, 1, RW, 0);
+  case 0xd1: case 0xd3: return with_modrm(c, v, RW, 0);
+  case 0xd7:
+    out->flags |= PT_DEC_MEM_UNKNOWN; // xlat
+    return 1;
+  case 0xe0: case 0xe1: case 0xe2: case 0xe3:
+    out->kind = PT_INSN_COND_JUMP;
+    return skip(c, 1);
+  case 0xe4: case 0xe5: case 0xe6: case 0xe7: return skip(c, 1);
+  case 0xec: case 0xed: case 0xee: case 0xef: return 1;
+  case 0xe8:
+    out->kind = PT_INSN_CALL;
+    push_op(c, 8);
+    return skip(c, 4);
+  case 0xe9:
+    out->kind = PT_INSN_JUMP;
+    return skip(c, 4);
+  case 0xeb:
+    out->kind = PT_INSN_JUMP;
+    return skip(c, 1);
+  case 0xf6: case 0xf7: {
+    int size = op == 0xf6 ? 1 : v;
+    is_mem = modrm(c, &ref, &reg);
+    if (is_mem < 0)
+      return 0;
+    if (is_mem)
+      add_mem(c, &ref, size, reg == 2 || reg == 3 ? RW : R);
+    if (reg < 2)
+      return skip(c, op == 0xf6 ? 1 : (size_t)zsize(c));
+    return 1;
+  }
+  case 0xfe:
+    return with_modrm(c, 1, RW, 0);
+  case 0xff:
+    is_mem = modrm(c, &ref, &reg);
+    if (is_mem < 0 || reg == 7)
+      return 0;
+    switch (reg) {
+    case 0: case 1:
+      if (is_mem)
+        add_mem(c, &ref, v, RW);
+      break;
+    case 2: // call r/m64
+      out->kind = PT_INSN_CALL;
+      if (is_mem)
+        add_mem(c, &ref, 8, R);
+      push_op(c, 8);
+      break;
+    case 4: // jmp r/m64
+      out->kind = PT_INSN_JUMP;
+      if (is_mem)
+        add_mem(c, &ref, 8, R);
+      break;
+    case 6:
+      if (is_mem)
+        add_mem(c, &ref, 8, R);
+      push_op(c, 8);
+      break;
+    default: // 远调用/远跳转
+      out->kind = reg == 3 ? PT_INSN_CALL : PT_INSN_JUMP;
+      if (is_mem)
+        out->flags |= PT_DEC_MEM_UNKNOWN;
+      break;
+    }
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+int pt_decode_x86_64(const uint8_t *code, size_t avail, PtInsn *out) {
+  Cursor c;
+  memset(&c, 0, sizeof(c));
+  memset(out, 0, sizeof(*out));
+  c.p = code;
+  c.end = code + (avail > 15 ? 15 : avail); // 指令最长15字节
+  c.out = out;
+
+  uint8_t op;
+  for (;;) {
+    if (!get(&c, &op))
+      return 0;
+    switch (op) {
+    case 0x66: c.opsize16 = 1; continue;
+    case 0x67: c.addr32 = 1; continue;
+    case 0xf2: c.repne = 1; continue;
+    case 0xf3: c.rep = 1; continue;
+    case 0x64: c.seg = PT_SEG_FS; continue;
+    case 0x65: c.seg = PT_SEG_GS; continue;
+    case 0xf0: case 0x2e: case 0x3e: case 0x26: case 0x36: continue;
+    default: break;
+    }
+    break;
+  }
+  if ((op & 0xf0) == 0x40) { // REX 必须紧挨操作码
+    c.rex_w = (op >> 3) & 1;
+    c.rex_r = (op >> 2) & 1;
+    c.rex_x = (op >> 1) & 1;
+    c.rex_b = op & 1;
+    if (!get(&c, &op))
+      return 0;
+  }
+
+  int ok;
+  if (op == 0xc4 || op == 0xc5)
+    ok = decode_vex(&c, op, out);
+  else if (op == 0x62)
+    ok = decode_evex(&c, out);
+  else
+    ok = decode_one(&c, op, out);
+  if (!ok) {
+    memset(out, 0, sizeof(*out));
+    return 0;
+  }
+  out->len = (uint8_t)(c.p - code);
+  return 1;
+}
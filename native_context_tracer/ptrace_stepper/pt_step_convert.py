@@ -0,0 +1,232 @@
+#!/usr/bin/env python3
+"""
+把 pt_trace 写出的单步日志转换为 tracer 的 trace.log / trace.log.index。
+
+每条执行的指令输出一行 ▷，附带变化的寄存器和访存值；CALL / RET 指令和跳过的范围外调用
+还原为 CALL / RETURN 帧，返回值取返回后的 rax / x0。符号化复用 agents/func_trace_convert.py 的 Symbolizer。
+"""
+
+import argparse
+import json
+import struct
+import sys
+from pathlib import Path
+
+sys.path.insert(0, str(Path(__file__).resolve().parents[1] / "agents"))
+from func_trace_convert import Symbolizer  # noqa: E402
+
+FILE_MAGIC = b"NCPTSTEP"
+FILE_VERSION = 1
+ARCH_X86_64 = 1
+ARCH_ARM64 = 2
+
+REC_STEP = 1
+REC_THREAD_START = 2
+REC_THREAD_EXIT = 3
+REC_SKIP_BEGIN = 4
+REC_SKIP_END = 5
+REC_MODULE = 6
+REC_BLOCK_STEP = 7
+
+INSN_CALL = 1
+INSN_RET = 2
+
+MEM_READ = 1
+MEM_WRITE = 2
+MEM_UNREADABLE = 4
+
+# 与 include/pt_log_format.h 保持一致
+FILE_HEADER = struct.Struct("=8sIIIIQ")
+RECORD = struct.Struct("=IBBBBQQ")
+MEM_OP = struct.Struct("=QQII")
+MODULE_INFO = struct.Struct("=QQII")
+
+# 寄存器名，顺序与 include/pt_decode.h 的 PT_X86_* / PT_A64_* 一致
+X86_64_REGS = [
+    "r15", "r14", "r13", "r12", "rbp", "rbx", "r11", "r10", "r9", "r8", "rax", "rcx", "rdx",
+    "rsi", "rdi", "orig_rax", "rip", "cs", "eflags", "rsp", "ss", "fs_base", "gs_base",
+    "ds", "es", "fs", "gs",
+]  # fmt: skip
+ARM64_REGS = [f"x{i}" for i in range(30)] + ["lr", "sp", "pc", "pstate"]
+
+# (寄存器名表, 程序计数器, 返回值寄存器)
+ARCHS = {
+    ARCH_X86_64: (X86_64_REGS, "rip", "rax"),
+    ARCH_ARM64: (ARM64_REGS, "pc", "x0"),
+}
+
+_INDENT = "  "
+
+
+class StepLog:
+    def __init__(self, arch, pid, start_realtime_ns):
+        self.arch = arch
+        self.pid = pid
+        self.start_realtime_ns = start_realtime_ns
+        self.records = []  # [(type, tid, kind, len, pc, {寄存器编号: 值}, [(addr, value, size, flags)])]
+        self.modules = []  # [(bias, start, end, path)]
+
+
+def read_step_log(path):
+    data = Path(path).read_bytes()
+    if len(data) < FILE_HEADER.size:
+        raise ValueError(f"{path}: truncated header")
+    magic, version, arch, pid, reg_count, start_realtime_ns = FILE_HEADER.unpack_from(data)
+    if magic != FILE_MAGIC or version != FILE_VERSION or arch not in ARCHS:
+        raise ValueError(f"{path}: not a pt_trace log (version {version}, arch {arch})")
+    log = StepLog(arch, pid, start_realtime_ns)
+
+    off = FILE_HEADER.size
+    while off + RECORD.size <= len(data):
+        tid, kind, insn_kind, mem_count, insn_len, pc, regmask = RECORD.unpack_from(data, off)
+        regs = [i for i in range(reg_count) if (regmask >> i) & 1]
+        extra = 8 * len(regs) + MEM_OP.size * mem_count
+        if kind == REC_MODULE:
+            extra = MODULE_INFO.size
+        if off + RECORD.size + extra > len(data):
+            break  # 被跟踪进程异常结束时最后一条记录可能不完整
+        off += RECORD.size
+        if kind == REC_MODULE:
+            end, bias, path_len, _ = MODULE_INFO.unpack_from(data, off)
+            off += MODULE_INFO.size
+            module_path = data[off : off + path_len].decode("utf-8", errors="replace")
+            off += (path_len + 7) & ~7
+            module = (bias, pc, end, module_path)
+            if module not in log.modules:
+                log.modules.append(module)
+            continue
+        values = struct.unpack_from(f"={len(regs)}Q", data, off)
+        off += 8 * len(regs)
+        mem = list(MEM_OP.iter_unpack(data[off : off + MEM_OP.size * mem_count]))
+        off += MEM_OP.size * mem_count
+        log.records.append((kind, tid, insn_kind, insn_len, pc, dict(zip(regs, values)), mem))
+    return log
+
+
+def _format_mem(mem):
+    parts = []
+    for addr, value, size, flags in mem:
+        access = "W" if flags & MEM_WRITE else "R"
+        shown = "?" if flags & MEM_UNREADABLE else f"0x{value:x}"
+        parts.append(f"{access}[0x{addr:x}:{size}]={shown}")
+    return " ".join(parts)
+
+
+class _Thread:
+    def __init__(self):
+        self.regs = {}
+        self.stack = []  # [(frame_id, 返回地址, func, filename, lineno)]
+        self.call_return = None  # 上一条指令是 CALL 时的返回地址
+        self.last_kind = 0
+        self.skip_frame = None  # 跳过的范围外调用
+
+
+def convert(log, log_path, symbolizer):
+    """按记录顺序写出与 TraceLogic 文件输出相同格式的日志和索引"""
+    log_path = Path(log_path)
+    names, pc_name, ret_name = ARCHS[log.arch]
+    pc_reg, ret_reg = names.index(pc_name), names.index(ret_name)
+    threads = {}
+    next_frame_id = 1
+    steps = calls = 0
+    with open(log_path, "wb") as out, open(str(log_path) + ".index", "w", encoding="utf-8") as index:
+
+        def write_index(kind, filename, lineno, frame_id, func, parent_frame_id):
+            entry = {
+                "type": kind,
+                "filename": filename,
+                "lineno": lineno,
+                "frame_id": frame_id,
+                "position": out.tell(),
+                "func": func,
+                "parent_frame_id": parent_frame_id,
+            }
+            index.write(json.dumps(entry) + "\n")
+
+        def write(text):
+            out.write(text.encode("utf-8"))
+
+        def enter(thread, tid, addr, return_addr):
+            nonlocal next_frame_id, calls
+            func, filename, lineno = symbolizer.resolve(addr)
+            frame_id = next_frame_id
+            next_frame_id += 1
+            parent_frame_id = thread.stack[-1][0] if thread.stack else 0
+            write_index("call", filename, lineno, frame_id, func, parent_frame_id)
+            write(f"{_INDENT * len(thread.stack)}↘ CALL {filename}:{lineno} {func}() [frame:{frame_id}][thread:{tid}]\n")
+            thread.stack.append((frame_id, return_addr, func, filename, lineno))
+            calls += 1
+
+        def leave(thread, result):
+            frame_id, _, func, filename, lineno = thread.stack.pop()
+            write(f"{_INDENT * len(thread.stack)}↗ RETURN {filename} {func}() → {result} [frame:{frame_id}]\n")
+            write_index("return", filename, lineno, frame_id, func, 0)
+
+        def unwind_to(thread, pc):
+            # 回到某个帧的返回地址：弹出它及其上方没有 RET 的帧（PLT 桩、尾调用）
+            for depth in range(len(thread.stack) - 1, -1, -1):
+                if thread.stack[depth][1] == pc:
+                    while len(thread.stack) > depth:
+                        leave(thread, f"0x{thread.regs.get(ret_reg, 0):x}")
+                    return
+
+        for kind, tid, insn_kind, insn_len, pc, regs, mem in log.records:
+            thread = threads.setdefault(tid, _Thread())
+            thread.regs.update(regs)
+            if kind == REC_THREAD_START:
+                write(f"# thread {tid} start at 0x{pc:x}\n")
+            elif kind == REC_THREAD_EXIT:
+                while thread.stack:
+                    leave(thread, "?")
+                write(f"# thread {tid} exit {pc}\n")
+            elif kind == REC_SKIP_BEGIN:
+                if thread.last_kind == INSN_RET:
+                    continue  # 返回到范围外（线程入口函数返回）
+                # 范围外的调用作为叶子帧，回到范围内时以返回值寄存器结束
+                return_addr, thread.call_return = thread.call_return, None
+                enter(thread, tid, pc, return_addr)
+                thread.skip_frame = thread.stack[-1][0]
+            elif kind == REC_SKIP_END:
+                if thread.skip_frame is not None and thread.stack and thread.stack[-1][0] == thread.skip_frame:
+                    leave(thread, f"0x{thread.regs.get(ret_reg, 0):x}")
+                thread.skip_frame = None
+                unwind_to(thread, pc)
+            elif kind in (REC_STEP, REC_BLOCK_STEP):
+                if thread.call_return is not None:
+                    enter(thread, tid, pc, thread.call_return)
+                    thread.call_return = None
+                func, filename, lineno = symbolizer.resolve(pc)
+                changed = " ".join(f"{names[i]}=0x{v:x}" for i, v in sorted(regs.items()) if i != pc_reg)
+                detail = " ".join(part for part in (changed, _format_mem(mem)) if part)
+                where = f"0x{pc:x}" if func == f"0x{pc:x}" else f"0x{pc:x} {func}"
+                write(f"{_INDENT * len(thread.stack)}▷ {filename}:{lineno} {where} {detail}".rstrip() + "\n")
+                steps += 1
+                thread.last_kind = insn_kind
+                if insn_kind == INSN_CALL:
+                    thread.call_return = pc + insn_len
+                elif insn_kind == INSN_RET and thread.stack:
+                    unwind_to(thread, thread.regs.get(pc_reg, 0))
+        for thread in threads.values():
+            while thread.stack:
+                leave(thread, "?")
+        # 注释行结尾：TraceLogExtractor 读到返回位置之后才停止，位置不能恰好是文件末尾
+        write(f"# pt_trace pid={log.pid} steps={steps} calls={calls}\n")
+    return steps, calls
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description="Convert a pt_trace step log to trace.log + trace.log.index")
+    parser.add_argument("step_log", help="binary log written by pt_trace -o")
+    parser.add_argument("-o", "--output", default="trace.log", help="output log path (index is <output>.index)")
+    parser.add_argument("--line-cache-dir", default=None, help="cache directory for DWARF line tables")
+    args = parser.parse_args(argv)
+
+    log = read_step_log(args.step_log)
+    symbolizer = Symbolizer(log.modules, args.line_cache_dir)
+    steps, calls = convert(log, args.output, symbolizer)
+    print(f"{steps} steps, {calls} calls -> {args.output}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,894 @@
+#define _GNU_SOURCE
+#include "pt_stepper.h"
+#include "op_elf.h"
+#include "op_symtab.h"
+#include "pt_decode.h"
+#include "pt_log_format.h"
+#include <elf.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/user.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__)
+#define ARCH PT_ARCH_X86_64
+#define REG_COUNT PT_X86_REG_COUNT
+#define REG_PC PT_X86_RIP
+#define REG_SP PT_X86_RSP
+// PC 单独记录；orig_rax 只在系统调用入口有意义
+#define DIFF_EXCLUDE ((1ull << PT_X86_RIP) | (1ull << PT_X86_ORIG_RAX))
+#elif defined(__aarch64__)
+#include <asm/ptrace.h>
+#define ARCH PT_ARCH_ARM64
+#define REG_COUNT PT_A64_REG_COUNT
+#define REG_PC PT_A64_PC
+#define REG_SP PT_A64_SP
+#define DIFF_EXCLUDE (1ull << PT_A64_PC)
+#else
+#error "pt_stepper supports Linux x86_64 and arm64 only"
+#endif
+
+_Static_assert(sizeof(struct user_regs_struct) == REG_COUNT * sizeof(uint64_t),
+               "register file layout");
+
+#define ALL_REGS ((REG_COUNT < 64 ? (1ull << REG_COUNT) : 0) - 1)
+
+// 块步进：一次运行的直线指令数上限；不足 PT_BLOCK_MIN 条时直接单步
+#define PT_BLOCK_MAX 256
+#define PT_BLOCK_MIN 2
+
+typedef enum {
+  T_WAITING,  // 跟踪尚未开始，自由运行
+  T_STEPPING, // 单步中
+  T_SKIPPING, // 自由运行到返回地址上的硬件断点
+  T_BLOCK,    // 自由运行到直线指令块末尾的硬件断点
+  T_DETACHING // 等待 SIGSTOP 后分离
+} ThreadMode;
+
+typedef struct {
+  pid_t tid;
+  ThreadMode mode;
+  int stop_requested; // 已发出（或新线程自带）SIGSTOP，尚未收到
+  int started;        // 已写 THREAD_START
+  int in_range;       // 当前 PC 在跟踪范围内
+  int pending;        // 已对 step_pc 处的指令发出单步
+  int skip_rearm;     // 跳过期间越过了别的帧的断点命中，单步后重新设置断点
+  uint64_t regs[REG_COUNT]; // 最近一次记录时的寄存器
+  uint64_t step_pc;
+  PtInsn insn;
+  uint64_t mem_addr[PT_MAX_MEM];
+  uint64_t skip_addr, skip_sp;
+  uint64_t block_start, block_end;
+  int block_count;
+} Thread;
+
+typedef struct {
+  uint64_t pc;
+  PtInsn insn;
+} DecodeEntry;
+
+typedef struct {
+  uint64_t start, end;
+} Range;
+
+static struct {
+  const PtOptions *options;
+  PtStats *stats;
+  pid_t pid;
+  FILE *log;
+  char exe[PATH_MAX];
+  Thread *threads;
+  size_t thread_count, thread_cap;
+  DecodeEntry *cache;
+  size_t cache_count, cache_cap; // cache_cap 为2的幂
+  Range *ranges;
+  size_t range_count;
+  uint64_t start_addr;
+  uint64_t start_word; // 被软件断点覆盖前的原始内容
+  int started;         // 已命中起点
+  int detaching;
+  struct timespec t0;
+} g;
+
+// ---- 线程表 ----
+
+static Thread *find_thread(pid_t tid) {
+  for (size_t i = 0; i < g.thread_count; i++)
+    if (g.threads[i].tid == tid)
+      return &g.threads[i];
+  return NULL;
+}
+
+static Thread *add_thread(pid_t tid) {
+  if (g.thread_count == g.thread_cap) {
+    size_t cap = g.thread_cap ? g.thread_cap * 2 : 16;
+    Thread *threads = realloc(g.threads, cap * sizeof(Thread));
+    if (!threads)
+      return NULL;
+    g.threads = threads;
+    g.thread_cap = cap;
+  }
+  Thread *t = &g.threads[g.thread_count++];
+  memset(t, 0, sizeof(*t));
+  t->tid = tid;
+  t->mode = T_WAITING;
+  return t;
+}
+
+static void remove_thread(Thread *t) {
+  *t = g.threads[--g.thread_count];
+}
+
+// ---- 寄存器与内存 ----
+
+static int get_regs(pid_t tid, uint64_t *regs) {
+#if defined(__x86_64__)
+  return ptrace(PTRACE_GETREGS, tid, 0, regs) == 0;
+#else
+  struct iovec iov = {regs, REG_COUNT * sizeof(uint64_t)};
+  return ptrace(PTRACE_GETREGSET, tid, (void *)NT_PRSTATUS, &iov) == 0;
+#endif
+}
+
+static int set_regs(pid_t tid, const uint64_t *regs) {
+#if defined(__x86_64__)
+  return ptrace(PTRACE_SETREGS, tid, 0, regs) == 0;
+#else
+  struct iovec iov = {(void *)regs, REG_COUNT * sizeof(uint64_t)};
+  return ptrace(PTRACE_SETREGSET, tid, (void *)NT_PRSTATUS, &iov) == 0;
+#endif
+}
+
+static size_t read_memory(pid_t tid, uint64_t addr, void *buf, size_t len) {
+  struct iovec local = {buf, len};
+  struct iovec remote = {(void *)(uintptr_t)addr, len};
+  ssize_t n = process_vm_readv(tid, &local, 1, &remote, 1, 0);
+  return n < 0 ? 0 : (size_t)n;
+}
+
+// 线程私有的执行断点，用于跳过范围外的调用和块步进
+static int set_hw_breakpoint(pid_t tid, uint64_t addr) {
+#if defined(__x86_64__)
+  if (ptrace(PTRACE_POKEUSER, tid, offsetof(struct user, u_debugreg[0]),
+             (void *)(uintptr_t)addr) != 0)
+    return 0;
+  // DR7：L0 启用，执行断点，长度1
+  return ptrace(PTRACE_POKEUSER, tid, offsetof(struct user, u_debugreg[7]),
+                (void *)1) == 0;
+#else
+  struct user_hwdebug_state state;
+  memset(&state, 0, sizeof(state));
+  state.dbg_regs[0].addr = addr;
+  // 启用，EL0，BAS 覆盖4字节，执行断点
+  state.dbg_regs[0].ctrl = (0xf << 5) | (2 << 1) | 1;
+  struct iovec iov = {&state, offsetof(struct user_hwdebug_state, dbg_regs) +
+                                  sizeof(state.dbg_regs[0])};
+  return ptrace(PTRACE_SETREGSET, tid, (void *)NT_ARM_HW_BREAK, &iov) == 0;
+#endif
+}
+
+static void clear_hw_breakpoint(pid_t tid) {
+#if defined(__x86_64__)
+  ptrace(PTRACE_POKEUSER, tid, offsetof(struct user, u_debugreg[7]), 0);
+  ptrace(PTRACE_POKEUSER, tid, offsetof(struct user, u_debugreg[6]), 0);
+#else
+  struct user_hwdebug_state state;
+  memset(&state, 0, sizeof(state));
+  struct iovec iov = {&state, offsetof(struct user_hwdebug_state, dbg_regs) +
+                                  sizeof(state.dbg_regs[0])};
+  ptrace(PTRACE_SETREGSET, tid, (void *)NT_ARM_HW_BREAK, &iov);
+#endif
+}
+
+// ---- 软件断点（跟踪起点） ----
+
+static int insert_start_breakpoint(void) {
+  errno = 0;
+  long word = ptrace(PTRACE_PEEKTEXT, g.pid, (void *)(uintptr_t)g.start_addr, 0);
+  if (errno)
+    return 0;
+  g.start_word = (uint64_t)word;
+#if defined(__x86_64__)
+  uint64_t patched = (g.start_word & ~0xffull) | 0xcc; // int3
+#else
+  uint64_t patched = (g.start_word & ~0xffffffffull) | 0xd4200000; // brk #0
+#endif
+  return ptrace(PTRACE_POKETEXT, g.pid, (void *)(uintptr_t)g.start_addr,
+                (void *)(uintptr_t)patched) == 0;
+}
+
+static void remove_start_breakpoint(pid_t tid) {
+  ptrace(PTRACE_POKETEXT, tid, (void *)(uintptr_t)g.start_addr,
+         (void *)(uintptr_t)g.start_word);
+}
+
+// 命中起点断点时 PC 的值（x86 的 int3 执行后 PC 前进1字节）
+static uint64_t start_trap_pc(void) {
+#if defined(__x86_64__)
+  return g.start_addr + 1;
+#else
+  return g.start_addr;
+#endif
+}
+
+// ---- 模块与跟踪范围 ----
+
+// 映射的加载偏移：运行时地址 - 文件虚拟地址
+static uint64_t module_bias(const char *path, uint64_t start, uint64_t offset) {
+  uint64_t bias = start - offset;
+  OpElfFile elf;
+  if (!op_elf_map(&elf, path))
+    return bias;
+  const Elf64_Ehdr *eh = elf.ehdr;
+  if (op_elf_table_in_file(&elf, eh->e_phoff,
+                           (uint64_t)eh->e_phnum * sizeof(Elf64_Phdr))) {
+    const Elf64_Phdr *ph = (const Elf64_Phdr *)(elf.data + eh->e_phoff);
+    for (int i = 0; i < eh->e_phnum; i++) {
+      uint64_t page_off = ph[i].p_offset & ~0xfffull;
+      if (ph[i].p_type == PT_LOAD && offset >= page_off &&
+          offset < ph[i].p_offset + ph[i].p_filesz) {
+        bias = start - ((ph[i].p_vaddr & ~0xfffull) + (offset - page_off));
+        break;
+      }
+    }
+  }
+  op_elf_unmap(&elf);
+  return bias;
+}
+
+static int traced_module(const char *path) {
+  const PtOptions *o = g.options;
+  if (o->all_modules)
+    return 1;
+  if (!o->modules)
+    return strcmp(path, g.exe) == 0;
+  for (const char **m = o->modules; *m; m++)
+    if (strstr(path, *m))
+      return 1;
+  return 0;
+}
+
+// 读取 /proc/pid/maps 的可执行映射：计算跟踪范围，可选写出模块记录
+static void scan_modules(int write_records) {
+  char maps[64], line[PATH_MAX + 128];
+  snprintf(maps, sizeof(maps), "/proc/%d/maps", g.pid);
+  FILE *f = fopen(maps, "r");
+  if (!f)
+    return;
+  g.range_count = 0;
+  while (fgets(line, sizeof(line), f)) {
+    unsigned long long start, end, offset;
+    char perms[8];
+    int path_pos = 0;
+    if (sscanf(line, "%llx-%llx %7s %llx %*s %*s %n", &start, &end, perms,
+               &offset, &path_pos) < 4 ||
+        perms[2] != 'x' || path_pos == 0)
+      continue;
+    char *path = line + path_pos;
+    path[strcspn(path, "\n")] = '\0';
+    if (path[0] != '/')
+      continue;
+    if (traced_module(path)) {
+      Range *ranges = realloc(g.ranges, (g.range_count + 1) * sizeof(Range));
+      if (ranges) {
+        g.ranges = ranges;
+        g.ranges[g.range_count++] = (Range){start, end};
+      }
+    }
+    if (write_records) {
+      uint32_t len = (uint32_t)strlen(path);
+      PtRecord rec = {0, PT_REC_MODULE, 0, 0, 0, start, 0};
+      PtModuleInfo info = {end, module_bias(path, start, offset), len, 0};
+      static const char pad[8];
+      fwrite(&rec, sizeof(rec), 1, g.log);
+      fwrite(&info, sizeof(info), 1, g.log);
+      fwrite(path, 1, len, g.log);
+      fwrite(pad, 1, ((len + 7u) & ~7u) - len, g.log);
+    }
+  }
+  fclose(f);
+}
+
+static int in_range(uint64_t pc) {
+  for (size_t i = 0; i < g.range_count; i++)
+    if (pc >= g.ranges[i].start && pc < g.ranges[i].end)
+      return 1;
+  return 0;
+}
+
+// 起点地址：显式地址 > 符号（默认 main）> 程序入口
+static int resolve_start(void) {
+  const PtOptions *o = g.options;
+  if (o->start_addr) {
+    g.start_addr = o->start_addr;
+    return 1;
+  }
+  char maps[64], line[PATH_MAX + 128];
+  snprintf(maps, sizeof(maps), "/proc/%d/maps", g.pid);
+  FILE *f = fopen(maps, "r");
+  if (!f)
+    return 0;
+  uint64_t bias = 0;
+  int found = 0;
+  while (!found && fgets(line, sizeof(line), f)) {
+    unsigned long long start, end, offset;
+    int path_pos = 0;
+    if (sscanf(line, "%llx-%llx %*s %llx %*s %*s %n", &start, &end, &offset,
+               &path_pos) < 3 || path_pos == 0)
+      continue;
+    char *path = line + path_pos;
+    path[strcspn(path, "\n")] = '\0';
+    if (strcmp(path, g.exe) == 0) {
+      bias = module_bias(g.exe, start, offset);
+      found = 1;
+    }
+  }
+  fclose(f);
+  if (!found)
+    return 0;
+
+  OpSymtab *tab = op_symtab_create();
+  if (tab && op_symtab_load_elf(tab, g.exe, bias) >= 0) {
+    int sym = op_symtab_find(tab, o->start_symbol ? o->start_symbol : "main");
+    if (sym >= 0)
+      g.start_addr = op_symtab_get(tab, sym)->addr;
+  }
+  op_symtab_destroy(tab);
+  if (g.start_addr || o->start_symbol) // 显式指定的符号找不到时报错
+    return g.start_addr != 0;
+
+  OpElfFile elf;
+  if (!op_elf_map(&elf, g.exe))
+    return 0;
+  g.start_addr = elf.ehdr->e_entry + bias;
+  op_elf_unmap(&elf);
+  return 1;
+}
+
+// ---- 解码缓存 ----
+
+static const PtInsn *decode_at(pid_t tid, uint64_t pc) {
+  if (g.cache_count * 2 >= g.cache_cap) {
+    size_t cap = g.cache_cap ? g.cache_cap * 2 : 4096;
+    DecodeEntry *cache = calloc(cap, sizeof(DecodeEntry));
+    if (!cache)
+      return NULL;
+    for (size_t i = 0; i < g.cache_cap; i++) {
+      if (!g.cache[i].pc)
+        continue;
+      size_t j = (g.cache[i].pc * 0x9e3779b97f4a7c15ull >> 20) & (cap - 1);
+      while (cache[j].pc)
+        j = (j + 1) & (cap - 1);
+      cache[j] = g.cache[i];
+    }
+    free(g.cache);
+    g.cache = cache;
+    g.cache_cap = cap;
+  }
+  size_t j = (pc * 0x9e3779b97f4a7c15ull >> 20) & (g.cache_cap - 1);
+  while (g.cache[j].pc && g.cache[j].pc != pc)
+    j = (j + 1) & (g.cache_cap - 1);
+  DecodeEntry *e = &g.cache[j];
+  if (e->pc == pc)
+    return &e->insn;
+
+  uint8_t code[16];
+  size_t n = read_memory(tid, pc, code, sizeof(code));
+  int ok;
+#if defined(__x86_64__)
+  ok = pt_decode_x86_64(code, n, &e->insn);
+#else
+  uint32_t word;
+  memcpy(&word, code, sizeof(word));
+  ok = n >= 4 && pt_decode_arm64(word, &e->insn);
+#endif
+  if (!ok) {
+    memset(&e->insn, 0, sizeof(e->insn));
+    e->insn.flags = PT_DEC_MEM_UNKNOWN;
+  }
+  e->pc = pc;
+  g.cache_count++;
+  return &e->insn;
+}
+
+// ---- 日志 ----
+
+static uint64_t changed_regs(const uint64_t *before, const uint64_t *after) {
+  uint64_t mask = 0;
+  for (int i = 0; i < REG_COUNT; i++)
+    if (before[i] != after[i])
+      mask |= 1ull << i;
+  return mask & ~DIFF_EXCLUDE;
+}
+
+static void write_record(const PtRecord *rec, const uint64_t *regs,
+                         const PtMemOp *mem) {
+  fwrite(rec, sizeof(*rec), 1, g.log);
+  for (int i = 0; i < REG_COUNT; i++)
+    if ((rec->regmask >> i) & 1)
+      fwrite(&regs[i], sizeof(uint64_t), 1, g.log);
+  if (rec->mem_count)
+    fwrite(mem, sizeof(PtMemOp), rec->mem_count, g.log);
+}
+
+// 以 regs 为新状态写记录（寄存器与上一条记录比较）
+static void write_state(Thread *t, uint8_t type, uint64_t pc,
+                        const uint64_t *regs) {
+  PtRecord rec = {(uint32_t)t->tid, type, 0, 0, 0, pc,
+                  type == PT_REC_THREAD_START ? ALL_REGS & ~DIFF_EXCLUDE
+                                              : changed_regs(t->regs, regs)};
+  write_record(&rec, regs, NULL);
+  memcpy(t->regs, regs, sizeof(t->regs));
+}
+
+static void write_step(Thread *t, const uint64_t *regs) {
+  PtMemOp mem[PT_MAX_MEM];
+  const PtInsn *insn = &t->insn;
+  struct iovec local[PT_MAX_MEM], remote[PT_MAX_MEM];
+  size_t total = 0;
+  for (int i = 0; i < insn->mem_count; i++) {
+    mem[i].addr = t->mem_addr[i];
+    mem[i].value = 0;
+    mem[i].size = insn->mem[i].size;
+    mem[i].flags = insn->mem[i].flags;
+    size_t n = mem[i].size < 8 ? mem[i].size : 8;
+    local[i] = (struct iovec){&mem[i].value, n};
+    remote[i] = (struct iovec){(void *)(uintptr_t)mem[i].addr, n};
+    total += n;
+  }
+  if (insn->mem_count) {
+    ssize_t n = process_vm_readv(t->tid, local, insn->mem_count, remote,
+                                 insn->mem_count, 0);
+    if (n != (ssize_t)total) // 部分失败时逐个重读，区分不可读的操作数
+      for (int i = 0; i < insn->mem_count; i++)
+        if (read_memory(t->tid, mem[i].addr, &mem[i].value, local[i].iov_len) !=
+            local[i].iov_len) {
+          mem[i].value = 0;
+          mem[i].flags |= PT_MEM_UNREADABLE;
+        }
+  }
+  PtRecord rec = {(uint32_t)t->tid, PT_REC_STEP, insn->kind, insn->mem_count,
+                  insn->len, t->step_pc, changed_regs(t->regs, regs)};
+  write_record(&rec, regs, mem);
+  memcpy(t->regs, regs, sizeof(t->regs));
+  g.stats->steps++;
+}
+
+// 块末尾：按解码缓存补出块内每条指令，寄存器变化记在最后一条
+static void write_block(Thread *t, const uint64_t *regs) {
+  uint64_t pc = t->block_start;
+  for (int i = 0; i < t->block_count; i++) {
+    const PtInsn *insn = decode_at(t->tid, pc);
+    if (!insn)
+      break;
+    PtRecord rec = {(uint32_t)t->tid, PT_REC_BLOCK_STEP, insn->kind, 0,
+                    insn->len, pc,
+                    i == t->block_count - 1 ? changed_regs(t->regs, regs) : 0};
+    write_record(&rec, regs, NULL);
+    pc += insn->len;
+    g.stats->steps++;
+  }
+  memcpy(t->regs, regs, sizeof(t->regs));
+  memset(&t->insn, 0, sizeof(t->insn)); // 块内没有调用，离开范围时不跳过
+}
+
+// ---- 线程控制 ----
+
+static void resume(Thread *t, int sig) {
+  enum __ptrace_request req = PTRACE_CONT;
+  if (t->mode == T_STEPPING || (t->mode == T_SKIPPING && t->skip_rearm))
+    req = PTRACE_SINGLESTEP;
+  ptrace(req, t->tid, 0, (void *)(uintptr_t)sig);
+}
+
+// 块步进：从 pc 起连续的非控制流指令不会改变执行路径，在第一条控制流指令
+// （或块长度上限）处设硬件断点后自由运行，到达后补出中间的指令
+static int run_block(Thread *t, uint64_t pc) {
+  uint64_t limit = PT_BLOCK_MAX;
+  if (g.options->max_steps && g.options->max_steps - g.stats->steps < limit)
+    limit = g.options->max_steps - g.stats->steps;
+  uint64_t end = pc;
+  int count = 0;
+  while ((uint64_t)count < limit && in_range(end)) {
+    const PtInsn *insn = decode_at(t->tid, end);
+    if (!insn || insn->len == 0 || insn->kind != PT_INSN_OTHER)
+      break;
+    end += insn->len;
+    count++;
+  }
+  if (count < PT_BLOCK_MIN || !set_hw_breakpoint(t->tid, end))
+    return 0;
+  t->mode = T_BLOCK;
+  t->block_start = pc;
+  t->block_end = end;
+  t->block_count = count;
+  ptrace(PTRACE_CONT, t->tid, 0, 0);
+  return 1;
+}
+
+// 对当前 PC 的指令发出单步（块步进时可能改为运行整个直线块）
+static void step(Thread *t, const uint64_t *regs) {
+  uint64_t pc = regs[REG_PC];
+  if (t->in_range && g.options->block_step && run_block(t, pc))
+    return;
+  t->pending = 1;
+  t->step_pc = pc;
+  if (t->in_range) {
+    const PtInsn *insn = decode_at(t->tid, pc);
+    if (insn) {
+      t->insn = *insn;
+      for (int i = 0; i < insn->mem_count; i++)
+        t->mem_addr[i] = pt_mem_address(ARCH, &insn->mem[i], regs, pc, insn->len);
+    } else {
+      memset(&t->insn, 0, sizeof(t->insn));
+    }
+  }
+  ptrace(PTRACE_SINGLESTEP, t->tid, 0, 0);
+}
+
+static void detach(Thread *t) {
+  clear_hw_breakpoint(t->tid);
+  ptrace(PTRACE_DETACH, t->tid, 0, 0);
+  remove_thread(t);
+}
+
+// 达到步数上限：停下其余线程后逐个分离
+static void start_detach(Thread *current) {
+  g.detaching = 1;
+  scan_modules(1);
+  pid_t tid = current->tid;
+  for (size_t i = 0; i < g.thread_count; i++) {
+    Thread *t = &g.threads[i];
+    if (t->tid == tid)
+      continue;
+    if (!t->stop_requested) {
+      syscall(SYS_tgkill, g.pid, t->tid, SIGSTOP);
+      t->stop_requested = 1;
+    }
+    t->mode = T_DETACHING;
+  }
+  detach(current);
+}
+
+static void begin_stepping(Thread *t) {
+  uint64_t regs[REG_COUNT];
+  if (!get_regs(t->tid, regs)) {
+    resume(t, 0);
+    return;
+  }
+  t->mode = T_STEPPING;
+  t->started = 1;
+  t->in_range = in_range(regs[REG_PC]);
+  write_state(t, PT_REC_THREAD_START, regs[REG_PC], regs);
+  g.stats->threads++;
+  step(t, regs);
+}
+
+static void on_start_breakpoint(Thread *t, uint64_t *regs) {
+  remove_start_breakpoint(t->tid);
+  regs[REG_PC] = g.start_addr;
+  set_regs(t->tid, regs);
+  g.started = 1;
+  clock_gettime(CLOCK_MONOTONIC, &g.t0);
+  scan_modules(1);
+  // 其余线程停下后开始单步
+  for (size_t i = 0; i < g.thread_count; i++) {
+    Thread *other = &g.threads[i];
+    if (other != t && other->mode == T_WAITING && !other->stop_requested) {
+      syscall(SYS_tgkill, g.pid, other->tid, SIGSTOP);
+      other->stop_requested = 1;
+    }
+  }
+  begin_stepping(t);
+}
+
+// 离开跟踪范围：返回地址在范围内时设硬件断点自由运行，否则逐条单步
+static int try_skip(Thread *t, const uint64_t *regs) {
+  if (g.options->all_modules)
+    return 0;
+  uint64_t ret = 0;
+  if (t->insn.kind == PT_INSN_CALL || t->insn.kind == PT_INSN_JUMP) {
+#if defined(__x86_64__)
+    if (read_memory(t->tid, regs[REG_SP], &ret, sizeof(ret)) != sizeof(ret))
+      return 0;
+#else
+    ret = regs[PT_A64_LR];
+#endif
+  }
+  if (!ret || !in_range(ret) || !set_hw_breakpoint(t->tid, ret))
+    return 0;
+  t->mode = T_SKIPPING;
+  t->skip_addr = ret;
+  t->skip_sp = regs[REG_SP];
+  t->skip_rearm = 0;
+  g.stats->skipped_calls++;
+  ptrace(PTRACE_CONT, t->tid, 0, 0);
+  return 1;
+}
+
+// 记录完一步或一个块之后：检查步数上限和跟踪范围的进出，再发出下一步
+static void next_step(Thread *t, const uint64_t *regs) {
+  if (g.options->max_steps && g.stats->steps >= g.options->max_steps) {
+    start_detach(t);
+    return;
+  }
+  uint64_t pc = regs[REG_PC];
+  int now_in = in_range(pc);
+  if (now_in && !t->in_range) {
+    write_state(t, PT_REC_SKIP_END, pc, regs);
+  } else if (!now_in && t->in_range) {
+    PtRecord rec = {(uint32_t)t->tid, PT_REC_SKIP_BEGIN, 0, 0, 0, pc, 0};
+    write_record(&rec, regs, NULL);
+    t->in_range = 0;
+    if (try_skip(t, regs))
+      return;
+  }
+  t->in_range = now_in;
+  step(t, regs);
+}
+
+static void on_step_trap(Thread *t) {
+  uint64_t regs[REG_COUNT];
+  if (!get_regs(t->tid, regs)) {
+    resume(t, 0);
+    return;
+  }
+  if (t->pending) {
+    t->pending = 0;
+    if (t->in_range)
+      write_step(t, regs);
+    else
+      g.stats->silent_steps++;
+  }
+  next_step(t, regs);
+}
+
+static void on_block_trap(Thread *t) {
+  uint64_t regs[REG_COUNT];
+  if (!get_regs(t->tid, regs)) {
+    resume(t, 0);
+    return;
+  }
+  if (regs[REG_PC] != t->block_end) { // 程序自己的 SIGTRAP
+    ptrace(PTRACE_CONT, t->tid, 0, (void *)SIGTRAP);
+    return;
+  }
+  clear_hw_breakpoint(t->tid);
+  t->mode = T_STEPPING;
+  write_block(t, regs);
+  next_step(t, regs);
+}
+
+static void on_skip_trap(Thread *t) {
+  uint64_t regs[REG_COUNT];
+  if (!get_regs(t->tid, regs)) {
+    resume(t, 0);
+    return;
+  }
+  if (t->skip_rearm) { // 已越过断点地址，重新设置后继续运行
+    t->skip_rearm = 0;
+    set_hw_breakpoint(t->tid, t->skip_addr);
+    ptrace(PTRACE_CONT, t->tid, 0, 0);
+    return;
+  }
+  if (regs[REG_PC] != t->skip_addr) { // 程序自己的 SIGTRAP
+    ptrace(PTRACE_CONT, t->tid, 0, (void *)SIGTRAP);
+    return;
+  }
+  clear_hw_breakpoint(t->tid);
+  if (regs[REG_SP] < t->skip_sp) {
+    // 更深的帧（递归或回调）经过同一返回地址：单步越过后重新设置
+    t->skip_rearm = 1;
+    ptrace(PTRACE_SINGLESTEP, t->tid, 0, 0);
+    return;
+  }
+  t->mode = T_STEPPING;
+  t->in_range = 1;
+  write_state(t, PT_REC_SKIP_END, regs[REG_PC], regs);
+  step(t, regs);
+}
+
+static void on_trap(Thread *t) {
+  switch (t->mode) {
+  case T_STEPPING:
+    on_step_trap(t);
+    return;
+  case T_SKIPPING:
+    on_skip_trap(t);
+    return;
+  case T_BLOCK:
+    on_block_trap(t);
+    return;
+  case T_WAITING: {
+    uint64_t regs[REG_COUNT];
+    if (!g.started && get_regs(t->tid, regs) && regs[REG_PC] == start_trap_pc()) {
+      on_start_breakpoint(t, regs);
+      return;
+    }
+    if (g.started && get_regs(t->tid, regs) && regs[REG_PC] == start_trap_pc()) {
+      // 与第一个线程同时命中起点，断点已移除，回退 PC 重新执行
+      regs[REG_PC] = g.start_addr;
+      set_regs(t->tid, regs);
+      resume(t, 0);
+      return;
+    }
+    resume(t, SIGTRAP);
+    return;
+  }
+  case T_DETACHING: // 可能是单步完成或跳过用的断点，断点清除后等待 SIGSTOP
+    clear_hw_breakpoint(t->tid);
+    resume(t, 0);
+    return;
+  }
+}
+
+static void on_requested_stop(Thread *t) {
+  t->stop_requested = 0;
+  if (g.detaching)
+    detach(t);
+  else if (g.started && t->mode == T_WAITING)
+    begin_stepping(t);
+  else
+    resume(t, 0);
+}
+
+static void on_event(Thread *t, int event) {
+  if (event == PTRACE_EVENT_CLONE) {
+    unsigned long new_tid = 0;
+    ptrace(PTRACE_GETEVENTMSG, t->tid, 0, &new_tid);
+    if (!find_thread((pid_t)new_tid)) {
+      Thread *n = add_thread((pid_t)new_tid);
+      if (n)
+        n->stop_requested = 1; // 新线程以 SIGSTOP 开始
+      t = find_thread(t->tid); // add_thread 可能移动了线程表
+    }
+  } else if (event == PTRACE_EVENT_EXIT && t->tid == g.pid && g.started &&
+             !g.detaching) {
+    scan_modules(1);
+  }
+  resume(t, 0);
+}
+
+static double elapsed(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)(now.tv_sec - g.t0.tv_sec) +
+         (double)(now.tv_nsec - g.t0.tv_nsec) / 1e9;
+}
+
+static int launch(char *const argv[]) {
+  g.pid = fork();
+  if (g.pid < 0)
+    return 0;
+  if (g.pid == 0) {
+    ptrace(PTRACE_TRACEME, 0, 0, 0);
+    execvp(argv[0], argv);
+    _exit(127);
+  }
+  int status;
+  if (waitpid(g.pid, &status, 0) != g.pid || !WIFSTOPPED(status))
+    return 0; // exec 失败，子进程已退出
+  ptrace(PTRACE_SETOPTIONS, g.pid, 0,
+         (void *)(PTRACE_O_TRACECLONE | PTRACE_O_TRACEEXIT | PTRACE_O_EXITKILL));
+  char link[64];
+  snprintf(link, sizeof(link), "/proc/%d/exe", g.pid);
+  ssize_t n = readlink(link, g.exe, sizeof(g.exe) - 1);
+  if (n <= 0)
+    return 0;
+  g.exe[n] = '\0';
+  return 1;
+}
+
+static void cleanup(void) {
+  free(g.threads);
+  free(g.cache);
+  free(g.ranges);
+}
+
+int pt_trace_run(const PtOptions *options, char *const argv[], PtStats *stats) {
+  memset(&g, 0, sizeof(g));
+  memset(stats, 0, sizeof(*stats));
+  g.options = options;
+  g.stats = stats;
+  g.log = fopen(options->log_path, "wb");
+  if (!g.log)
+    return -1;
+  setvbuf(g.log, NULL, _IOFBF, 1 << 20);
+
+  if (!launch(argv)) {
+    if (g.pid > 0) {
+      kill(g.pid, SIGKILL);
+      waitpid(g.pid, NULL, 0);
+    }
+    fclose(g.log);
+    return -1;
+  }
+  if (!resolve_start() || !insert_start_breakpoint() || !add_thread(g.pid)) {
+    kill(g.pid, SIGKILL);
+    waitpid(g.pid, NULL, 0);
+    fclose(g.log);
+    cleanup();
+    return -1;
+  }
+
+  struct timespec realtime;
+  clock_gettime(CLOCK_REALTIME, &realtime);
+  PtFileHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, PT_FILE_MAGIC, 8);
+  hdr.version = PT_FILE_VERSION;
+  hdr.arch = ARCH;
+  hdr.pid = (uint32_t)g.pid;
+  hdr.reg_count = REG_COUNT;
+  hdr.start_realtime_ns =
+      (uint64_t)realtime.tv_sec * 1000000000ull + (uint64_t)realtime.tv_nsec;
+  fwrite(&hdr, sizeof(hdr), 1, g.log);
+
+  int exit_code = -1;
+  ptrace(PTRACE_CONT, g.pid, 0, 0);
+  while (g.thread_count > 0) {
+    int status;
+    pid_t tid = waitpid(-1, &status, __WALL);
+    if (tid < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    Thread *t = find_thread(tid);
+    if (g.started)
+      stats->stops++;
+    if (WIFEXITED(status) || WIFSIGNALED(status)) {
+      int code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+      if (t) {
+        if (t->started) {
+          PtRecord rec = {(uint32_t)tid, PT_REC_THREAD_EXIT, 0, 0, 0,
+                          (uint64_t)code, 0};
+          write_record(&rec, NULL, NULL);
+        }
+        remove_thread(t);
+      }
+      if (tid == g.pid)
+        exit_code = code;
+      continue;
+    }
+    if (!WIFSTOPPED(status))
+      continue;
+    if (!t) { // 新线程的 SIGSTOP 先于父线程的 clone 事件到达
+      t = add_thread(tid);
+      if (!t)
+        continue;
+      t->stop_requested = 1;
+    }
+    int sig = WSTOPSIG(status), event = status >> 16;
+    if (sig == SIGTRAP && event)
+      on_event(t, event);
+    else if (sig == SIGSTOP && t->stop_requested)
+      on_requested_stop(t);
+    else if (sig == SIGTRAP)
+      on_trap(t);
+    else
+      resume(t, sig);
+  }
+  if (g.started)
+    stats->seconds = elapsed();
+  fclose(g.log);
+  cleanup();
+
+  if (exit_code < 0) { // 分离后等待进程自己结束
+    int status;
+    if (waitpid(g.pid, &status, 0) == g.pid)
+      exit_code = WIFEXITED(status) ? WEXITSTATUS(status)
+                                    : 128 + WTERMSIG(status);
+  }
+  return exit_code;
+}
@@ -0,0 +1,77 @@
+#include "pt_stepper.h"
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "usage: %s [-o log] [-s symbol|0xaddr] [-m module]... [-a] [-n steps]"
+          " [-b] -- program [args...]\n"
+          "  -o  output log (default pt_trace.bin)\n"
+          "  -s  start tracing when this function is first reached (default main)\n"
+          "  -m  record instructions in modules whose path contains this string\n"
+          "      (default: the main executable only); may be repeated\n"
+          "  -a  record every module, never skip calls\n"
+          "  -n  detach after this many recorded steps\n"
+          "  -b  block stepping: run straight-line code to the next branch on a\n"
+          "      hardware breakpoint; those instructions carry no memory values\n",
+          prog);
+}
+
+int main(int argc, char **argv) {
+  PtOptions options = {"pt_trace.bin", NULL, 0, NULL, 0, 0, 0};
+  const char **modules = calloc((size_t)argc + 1, sizeof(char *));
+  int module_count = 0, opt;
+  if (!modules)
+    return 1;
+  while ((opt = getopt(argc, argv, "+o:s:m:an:bh")) != -1) {
+    switch (opt) {
+    case 'o':
+      options.log_path = optarg;
+      break;
+    case 's':
+      if (optarg[0] == '0' && optarg[1] == 'x')
+        options.start_addr = strtoull(optarg, NULL, 16);
+      else
+        options.start_symbol = optarg;
+      break;
+    case 'm':
+      modules[module_count++] = optarg;
+      options.modules = modules;
+      break;
+    case 'a':
+      options.all_modules = 1;
+      break;
+    case 'n':
+      options.max_steps = strtoull(optarg, NULL, 10);
+      break;
+    case 'b':
+      options.block_step = 1;
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 2;
+    }
+  }
+  if (optind >= argc) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  PtStats stats;
+  int code = pt_trace_run(&options, argv + optind, &stats);
+  free(modules);
+  if (code < 0) {
+    fprintf(stderr, "pt_trace: failed to start %s\n", argv[optind]);
+    return 1;
+  }
+  fprintf(stderr,
+          "pt_trace: %llu steps (%llu silent), %llu stops, %llu skipped calls,"
+          " %llu threads, %.3fs, %.0f steps/s -> %s\n",
+          (unsigned long long)stats.steps, (unsigned long long)stats.silent_steps,
+          (unsigned long long)stats.stops, (unsigned long long)stats.skipped_calls,
+          (unsigned long long)stats.threads, stats.seconds,
+          stats.seconds > 0 ? (double)(stats.steps + stats.silent_steps) / stats.seconds : 0.0,
+          options.log_path);
+  return code;
+}
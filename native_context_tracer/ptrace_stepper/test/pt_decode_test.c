@@ -0,0 +1,290 @@
+#include "pt_decode.h"
+#include "pt_log_format.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define X86(insn, ...)                                                         \
+  do {                                                                         \
+    static const uint8_t code_[] = {__VA_ARGS__};                              \
+    assert(pt_decode_x86_64(code_, sizeof(code_), &(insn)));                   \
+    assert((insn).len == sizeof(code_));                                       \
+  } while (0)
+
+static void check_mem(const PtMemRef *m, int base, int index, int shift,
+                      int64_t disp, int size, int flags) {
+  assert(m->base == base);
+  assert(m->index == index);
+  assert(m->shift == shift);
+  assert(m->disp == disp);
+  assert(m->size == size);
+  assert(m->flags == flags);
+}
+
+void test_x86_memory(void) {
+  PtInsn in;
+  X86(in, 0x48, 0x89, 0x43, 0x10); // mov %rax,0x10(%rbx)
+  assert(in.mem_count == 1 && in.kind == PT_INSN_OTHER);
+  check_mem(&in.mem[0], PT_X86_RBX, PT_BASE_NONE, 0, 16, 8, PT_MEM_WRITE);
+
+  X86(in, 0x8b, 0x54, 0x8c, 0x08); // mov 0x8(%rsp,%rcx,4),%edx
+  check_mem(&in.mem[0], PT_X86_RSP, PT_X86_RCX, 2, 8, 4, PT_MEM_READ);
+
+  X86(in, 0x48, 0x8b, 0x05, 0x34, 0x12, 0x00, 0x00); // mov 0x1234(%rip),%rax
+  check_mem(&in.mem[0], PT_BASE_NEXT_PC, PT_BASE_NONE, 0, 0x1234, 8,
+            PT_MEM_READ);
+
+  X86(in, 0xc7, 0x45, 0xfc, 0x05, 0x00, 0x00, 0x00); // movl $5,-4(%rbp)
+  check_mem(&in.mem[0], PT_X86_RBP, PT_BASE_NONE, 0, -4, 4, PT_MEM_WRITE);
+
+  X86(in, 0x48, 0x83, 0x07, 0x01); // addq $1,(%rdi)
+  check_mem(&in.mem[0], PT_X86_RDI, PT_BASE_NONE, 0, 0, 8,
+            PT_MEM_READ | PT_MEM_WRITE);
+
+  X86(in, 0x80, 0x3e, 0x00); // cmpb $0,(%rsi)
+  check_mem(&in.mem[0], PT_X86_RSI, PT_BASE_NONE, 0, 0, 1, PT_MEM_READ);
+
+  X86(in, 0x43, 0x8b, 0x04, 0xa8); // mov (%r8,%r13,4),%eax
+  check_mem(&in.mem[0], PT_X86_R8, PT_X86_R13, 2, 0, 4, PT_MEM_READ);
+
+  X86(in, 0x41, 0x8b, 0x45, 0x00); // mov 0x0(%r13),%eax
+  check_mem(&in.mem[0], PT_X86_R13, PT_BASE_NONE, 0, 0, 4, PT_MEM_READ);
+
+  X86(in, 0x48, 0x8d, 0x58, 0x08); // lea 0x8(%rax),%rbx 不访存
+  assert(in.mem_count == 0);
+
+  X86(in, 0x0f, 0xb6, 0x08); // movzbl (%rax),%ecx
+  check_mem(&in.mem[0], PT_X86_RAX, PT_BASE_NONE, 0, 0, 1, PT_MEM_READ);
+
+  X86(in, 0x66, 0x89, 0x07); // mov %ax,(%rdi)
+  check_mem(&in.mem[0], PT_X86_RDI, PT_BASE_NONE, 0, 0, 2, PT_MEM_WRITE);
+
+  X86(in, 0x6b, 0x08, 0x64); // imul $100,(%rax),%ecx
+  check_mem(&in.mem[0], PT_X86_RAX, PT_BASE_NONE, 0, 0, 4, PT_MEM_READ);
+
+  X86(in, 0xf6, 0x47, 0x10, 0x01); // testb $1,0x10(%rdi)
+  check_mem(&in.mem[0], PT_X86_RDI, PT_BASE_NONE, 0, 16, 1, PT_MEM_READ);
+
+  X86(in, 0xf0, 0x0f, 0xb1, 0x0a); // lock cmpxchg %ecx,(%rdx)
+  check_mem(&in.mem[0], PT_X86_RDX, PT_BASE_NONE, 0, 0, 4,
+            PT_MEM_READ | PT_MEM_WRITE);
+
+  X86(in, 0x64, 0x48, 0x8b, 0x04, 0x25, 0x28, 0x00, 0x00, 0x00); // mov %fs:0x28,%rax
+  check_mem(&in.mem[0], PT_BASE_NONE, PT_BASE_NONE, 0, 0x28, 8, PT_MEM_READ);
+  assert(in.mem[0].seg == PT_SEG_FS);
+
+  X86(in, 0x48, 0xb8, 1, 2, 3, 4, 5, 6, 7, 8); // movabs $imm64,%rax
+  assert(in.mem_count == 0);
+  printf("x86_64 memory operands: ok\n");
+}
+
+void test_x86_vector(void) {
+  PtInsn in;
+  X86(in, 0xf2, 0x0f, 0x11, 0x44, 0x24, 0x08); // movsd %xmm0,0x8(%rsp)
+  check_mem(&in.mem[0], PT_X86_RSP, PT_BASE_NONE, 0, 8, 8, PT_MEM_WRITE);
+
+  X86(in, 0xf3, 0x0f, 0x6f, 0x0f); // movdqu (%rdi),%xmm1
+  check_mem(&in.mem[0], PT_X86_RDI, PT_BASE_NONE, 0, 0, 16, PT_MEM_READ);
+
+  X86(in, 0xc5, 0xfe, 0x7f, 0x07); // vmovdqu %ymm0,(%rdi)
+  check_mem(&in.mem[0], PT_X86_RDI, PT_BASE_NONE, 0, 0, 32, PT_MEM_WRITE);
+
+  X86(in, 0xc4, 0xc1, 0x7a, 0x10, 0x00); // vmovss (%r8),%xmm0
+  check_mem(&in.mem[0], PT_X86_R8, PT_BASE_NONE, 0, 0, 4, PT_MEM_READ);
+
+  X86(in, 0x66, 0x0f, 0x3a, 0x16, 0x07, 0x01); // pextrd $1,%xmm0,(%rdi)
+  check_mem(&in.mem[0], PT_X86_RDI, PT_BASE_NONE, 0, 0, 4, PT_MEM_WRITE);
+
+  X86(in, 0x62, 0xf1, 0x7c, 0x48, 0x10, 0x07); // vmovups (%rdi),%zmm0
+  assert(in.mem_count == 0 && (in.flags & PT_DEC_MEM_UNKNOWN));
+
+  X86(in, 0xdd, 0x45, 0xf8); // fldl -8(%rbp)
+  assert(in.mem_count == 0 && (in.flags & PT_DEC_MEM_UNKNOWN));
+  printf("x86_64 vector operands: ok\n");
+}
+
+void test_x86_control(void) {
+  PtInsn in;
+  X86(in, 0x55); // push %rbp
+  check_mem(&in.mem[0], PT_X86_RSP, PT_BASE_NONE, 0, -8, 8, PT_MEM_WRITE);
+  X86(in, 0x41, 0x5c); // pop %r12
+  check_mem(&in.mem[0], PT_X86_RSP, PT_BASE_NONE, 0, 0, 8, PT_MEM_READ);
+
+  X86(in, 0xe8, 0x00, 0x01, 0x00, 0x00); // call rel32
+  assert(in.kind == PT_INSN_CALL && in.mem_count == 1);
+  check_mem(&in.mem[0], PT_X86_RSP, PT_BASE_NONE, 0, -8, 8, PT_MEM_WRITE);
+
+  X86(in, 0xff, 0x50, 0x10); // call *0x10(%rax)
+  assert(in.kind == PT_INSN_CALL && in.mem_count == 2);
+  check_mem(&in.mem[0], PT_X86_RAX, PT_BASE_NONE, 0, 16, 8, PT_MEM_READ);
+
+  X86(in, 0xff, 0x25, 0x10, 0x00, 0x00, 0x00); // jmp *0x10(%rip)（PLT）
+  assert(in.kind == PT_INSN_JUMP);
+  check_mem(&in.mem[0], PT_BASE_NEXT_PC, PT_BASE_NONE, 0, 16, 8, PT_MEM_READ);
+
+  X86(in, 0xc3); // ret
+  assert(in.kind == PT_INSN_RET);
+  check_mem(&in.mem[0], PT_X86_RSP, PT_BASE_NONE, 0, 0, 8, PT_MEM_READ);
+
+  X86(in, 0xcb); // lret
+  assert(in.kind == PT_INSN_RET);
+  check_mem(&in.mem[0], PT_X86_RSP, PT_BASE_NONE, 0, 0, 8, PT_MEM_READ);
+  X86(in, 0x48, 0xca, 0x08, 0x00); // lretq $8
+  assert(in.kind == PT_INSN_RET);
+  check_mem(&in.mem[0], PT_X86_RSP, PT_BASE_NONE, 0, 0, 16, PT_MEM_READ);
+  X86(in, 0x48, 0xcf); // iretq
+  assert(in.kind == PT_INSN_RET);
+  check_mem(&in.mem[0], PT_X86_RSP, PT_BASE_NONE, 0, 0, 40, PT_MEM_READ);
+  X86(in, 0xcc); // int3
+  assert(in.kind == PT_INSN_INTERRUPT && in.mem_count == 0);
+  X86(in, 0xcd, 0x80); // int $0x80
+  assert(in.kind == PT_INSN_INTERRUPT);
+  X86(in, 0xf1); // int1
+  assert(in.kind == PT_INSN_INTERRUPT);
+
+  X86(in, 0xc9); // leave
+  check_mem(&in.mem[0], PT_X86_RBP, PT_BASE_NONE, 0, 0, 8, PT_MEM_READ);
+
+  X86(in, 0x75, 0x10); // jne rel8
+  assert(in.kind == PT_INSN_COND_JUMP);
+  X86(in, 0x0f, 0x84, 0, 0, 0, 0); // je rel32
+  assert(in.kind == PT_INSN_COND_JUMP);
+  X86(in, 0xeb, 0xfe); // jmp rel8
+  assert(in.kind == PT_INSN_JUMP);
+  X86(in, 0x0f, 0x05); // syscall
+  assert(in.kind == PT_INSN_SYSCALL);
+
+  X86(in, 0xf3, 0xaa); // rep stos %al,(%rdi)
+  check_mem(&in.mem[0], PT_X86_RDI, PT_BASE_NONE, 0, 0, 1, PT_MEM_WRITE);
+  X86(in, 0x48, 0xa5); // movsq
+  assert(in.mem_count == 2);
+  check_mem(&in.mem[0], PT_X86_RSI, PT_BASE_NONE, 0, 0, 8, PT_MEM_READ);
+  check_mem(&in.mem[1], PT_X86_RDI, PT_BASE_NONE, 0, 0, 8, PT_MEM_WRITE);
+
+  X86(in, 0xf3, 0x0f, 0x1e, 0xfa); // endbr64
+  assert(in.mem_count == 0 && in.kind == PT_INSN_OTHER);
+  X86(in, 0x66, 0x0f, 0x1f, 0x44, 0x00, 0x00); // nopw 0x0(%rax,%rax,1)
+  assert(in.mem_count == 0);
+  printf("x86_64 control flow: ok\n");
+}
+
+void test_x86_invalid(void) {
+  PtInsn in;
+  static const uint8_t truncated[] = {0x48, 0x8b, 0x05, 0x34}; // 位移不完整
+  assert(!pt_decode_x86_64(truncated, sizeof(truncated), &in));
+  static const uint8_t prefixes_only[] = {0x66, 0x66, 0xf3};
+  assert(!pt_decode_x86_64(prefixes_only, sizeof(prefixes_only), &in));
+  static const uint8_t invalid[] = {0x06}; // push %es 在64位模式下无效
+  assert(!pt_decode_x86_64(invalid, sizeof(invalid), &in));
+  assert(!pt_decode_x86_64(truncated, 0, &in));
+  printf("x86_64 invalid input: ok\n");
+}
+
+void test_arm64_memory(void) {
+  PtInsn in;
+  assert(pt_decode_arm64(0xf9400820, &in) && in.len == 4); // ldr x0, [x1, #16]
+  check_mem(&in.mem[0], 1, PT_BASE_NONE, 0, 16, 8, PT_MEM_READ);
+
+  pt_decode_arm64(0xb90007e2, &in); // str w2, [sp, #4]
+  check_mem(&in.mem[0], PT_A64_SP, PT_BASE_NONE, 0, 4, 4, PT_MEM_WRITE);
+
+  pt_decode_arm64(0xa9bf7bfd, &in); // stp x29, x30, [sp, #-16]!
+  check_mem(&in.mem[0], PT_A64_SP, PT_BASE_NONE, 0, -16, 16, PT_MEM_WRITE);
+
+  pt_decode_arm64(0xa8c17bfd, &in); // ldp x29, x30, [sp], #16
+  check_mem(&in.mem[0], PT_A64_SP, PT_BASE_NONE, 0, 0, 16, PT_MEM_READ);
+
+  pt_decode_arm64(0x38626820, &in); // ldrb w0, [x1, x2]
+  check_mem(&in.mem[0], 1, 2, 0, 0, 1, PT_MEM_READ);
+
+  pt_decode_arm64(0xf862d820, &in); // ldr x0, [x1, w2, sxtw #3]
+  check_mem(&in.mem[0], 1, 2, 3, 0, 8, PT_MEM_READ);
+  assert(in.mem[0].extend == PT_EXT_SXTW);
+
+  pt_decode_arm64(0xf85f83a0, &in); // ldur x0, [x29, #-8]
+  check_mem(&in.mem[0], 29, PT_BASE_NONE, 0, -8, 8, PT_MEM_READ);
+
+  pt_decode_arm64(0xf8408420, &in); // ldr x0, [x1], #8
+  check_mem(&in.mem[0], 1, PT_BASE_NONE, 0, 0, 8, PT_MEM_READ);
+
+  pt_decode_arm64(0x58000040, &in); // ldr x0, .+8
+  check_mem(&in.mem[0], PT_BASE_PC, PT_BASE_NONE, 0, 8, 8, PT_MEM_READ);
+
+  pt_decode_arm64(0x3dc00800, &in); // ldr q0, [x0, #32]
+  check_mem(&in.mem[0], 0, PT_BASE_NONE, 0, 32, 16, PT_MEM_READ);
+
+  pt_decode_arm64(0xc85f7c20, &in); // ldxr x0, [x1]
+  check_mem(&in.mem[0], 1, PT_BASE_NONE, 0, 0, 8, PT_MEM_READ);
+
+  pt_decode_arm64(0xb8200041, &in); // ldadd w0, w1, [x2]
+  check_mem(&in.mem[0], 2, PT_BASE_NONE, 0, 0, 4, PT_MEM_READ | PT_MEM_WRITE);
+
+  pt_decode_arm64(0xf9800000, &in); // prfm pldl1keep, [x0]
+  assert(in.mem_count == 0 && in.flags == 0);
+
+  pt_decode_arm64(0x4c407000, &in); // ld1 {v0.16b}, [x0]
+  assert(in.mem_count == 0 && (in.flags & PT_DEC_MEM_UNKNOWN));
+
+  pt_decode_arm64(0x91000420, &in); // add x0, x1, #1
+  assert(in.mem_count == 0 && in.kind == PT_INSN_OTHER);
+  printf("arm64 memory operands: ok\n");
+}
+
+void test_arm64_control(void) {
+  PtInsn in;
+  pt_decode_arm64(0x94000010, &in); // bl
+  assert(in.kind == PT_INSN_CALL);
+  pt_decode_arm64(0xd63f0100, &in); // blr x8
+  assert(in.kind == PT_INSN_CALL);
+  pt_decode_arm64(0xd65f03c0, &in); // ret
+  assert(in.kind == PT_INSN_RET);
+  pt_decode_arm64(0xd61f0220, &in); // br x17
+  assert(in.kind == PT_INSN_JUMP);
+  pt_decode_arm64(0x54000041, &in); // b.ne
+  assert(in.kind == PT_INSN_COND_JUMP);
+  pt_decode_arm64(0xb4000040, &in); // cbz x0
+  assert(in.kind == PT_INSN_COND_JUMP);
+  pt_decode_arm64(0xd4000001, &in); // svc #0
+  assert(in.kind == PT_INSN_SYSCALL);
+  printf("arm64 control flow: ok\n");
+}
+
+void test_address(void) {
+  uint64_t regs[PT_X86_REG_COUNT] = {0};
+  regs[PT_X86_RSP] = 0x7fff0000;
+  regs[PT_X86_RCX] = 3;
+  regs[PT_X86_FS_BASE] = 0x10000;
+  PtInsn in;
+  X86(in, 0x8b, 0x54, 0x8c, 0x08); // mov 0x8(%rsp,%rcx,4),%edx
+  assert(pt_mem_address(PT_ARCH_X86_64, &in.mem[0], regs, 0x1000, in.len) ==
+         0x7fff0000 + 12 + 8);
+  X86(in, 0x48, 0x8b, 0x05, 0x34, 0x12, 0x00, 0x00); // RIP 相对取下一条指令
+  assert(pt_mem_address(PT_ARCH_X86_64, &in.mem[0], regs, 0x1000, in.len) ==
+         0x1000 + 7 + 0x1234);
+  X86(in, 0x64, 0x48, 0x8b, 0x04, 0x25, 0x28, 0x00, 0x00, 0x00);
+  assert(pt_mem_address(PT_ARCH_X86_64, &in.mem[0], regs, 0x1000, in.len) ==
+         0x10028);
+
+  uint64_t a64[PT_A64_REG_COUNT] = {0};
+  a64[1] = 0x5000;
+  a64[2] = 0xfffffffe; // w2 = -2
+  pt_decode_arm64(0xf862d820, &in); // ldr x0, [x1, w2, sxtw #3]
+  assert(pt_mem_address(PT_ARCH_ARM64, &in.mem[0], a64, 0x400000, in.len) ==
+         0x5000 - 16);
+  pt_decode_arm64(0x58000040, &in); // ldr x0, .+8
+  assert(pt_mem_address(PT_ARCH_ARM64, &in.mem[0], a64, 0x400000, in.len) ==
+         0x400008);
+  printf("address: ok\n");
+}
+
+int main() {
+  test_x86_memory();
+  test_x86_vector();
+  test_x86_control();
+  test_x86_invalid();
+  test_arm64_memory();
+  test_arm64_control();
+  test_address();
+  printf("All decoder tests passed!\n");
+  return 0;
+}
@@ -0,0 +1,234 @@
+#include "pt_decode.h"
+#include "pt_log_format.h"
+#include "pt_stepper.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// 跟踪 pt_workload，按日志重建每个线程的寄存器，校验访存值、跳过的库调用、
+// 线程起止和步数上限后的分离
+
+#if defined(__x86_64__)
+#define ARCH PT_ARCH_X86_64
+#define REG_COUNT PT_X86_REG_COUNT
+#define REG_RET PT_X86_RAX
+#else
+#define ARCH PT_ARCH_ARM64
+#define REG_COUNT PT_A64_REG_COUNT
+#define REG_RET PT_A64_X0
+#endif
+
+#define MAX_THREADS 8
+
+typedef struct {
+  uint32_t tid;
+  uint64_t regs[REG_COUNT];
+  int started, exited, in_skip;
+} ThreadState;
+
+typedef struct {
+  ThreadState threads[MAX_THREADS];
+  int thread_count;
+  long steps, block_steps, calls, rets, skips, mem_ops, modules;
+  int magic_store, worker_store[3], atoi_result, sum_result;
+  uint64_t exe_start, exe_end;
+} Summary;
+
+static ThreadState *thread_state(Summary *s, uint32_t tid) {
+  for (int i = 0; i < s->thread_count; i++)
+    if (s->threads[i].tid == tid)
+      return &s->threads[i];
+  assert(s->thread_count < MAX_THREADS);
+  s->threads[s->thread_count].tid = tid;
+  return &s->threads[s->thread_count++];
+}
+
+static void read_regs(FILE *f, const PtRecord *rec, ThreadState *t) {
+  for (int i = 0; i < REG_COUNT; i++)
+    if ((rec->regmask >> i) & 1)
+      assert(fread(&t->regs[i], sizeof(uint64_t), 1, f) == 1);
+}
+
+static Summary read_log(const char *path, const char *workload) {
+  const char *name = strrchr(workload, '/');
+  name = name ? name + 1 : workload;
+  Summary s;
+  memset(&s, 0, sizeof(s));
+  FILE *f = fopen(path, "rb");
+  assert(f);
+  PtFileHeader hdr;
+  assert(fread(&hdr, sizeof(hdr), 1, f) == 1);
+  assert(memcmp(hdr.magic, PT_FILE_MAGIC, 8) == 0);
+  assert(hdr.version == PT_FILE_VERSION && hdr.arch == ARCH);
+  assert(hdr.reg_count == REG_COUNT);
+
+  PtRecord rec;
+  while (fread(&rec, sizeof(rec), 1, f) == 1) {
+    if (rec.type == PT_REC_MODULE) {
+      PtModuleInfo info;
+      char module[4096];
+      assert(fread(&info, sizeof(info), 1, f) == 1);
+      assert(info.path_len < sizeof(module) && info.end > rec.pc);
+      size_t padded = (info.path_len + 7u) & ~7u;
+      assert(fread(module, 1, padded, f) == padded);
+      module[info.path_len] = '\0';
+      if (strcmp(strrchr(module, '/') + 1, name) == 0) {
+        s.exe_start = s.exe_start && s.exe_start < rec.pc ? s.exe_start : rec.pc;
+        s.exe_end = info.end > s.exe_end ? info.end : s.exe_end;
+      }
+      s.modules++;
+      continue;
+    }
+    ThreadState *t = thread_state(&s, rec.tid);
+    read_regs(f, &rec, t);
+    switch (rec.type) {
+    case PT_REC_THREAD_START:
+      assert(!t->started);
+      t->started = 1;
+      break;
+    case PT_REC_THREAD_EXIT:
+      assert(t->started && !t->exited);
+      t->exited = 1;
+      break;
+    case PT_REC_SKIP_BEGIN:
+      assert(rec.regmask == 0);
+      assert(rec.pc < s.exe_start || rec.pc >= s.exe_end);
+      t->in_skip = 1;
+      s.skips++;
+      break;
+    case PT_REC_SKIP_END:
+      assert(rec.pc >= s.exe_start && rec.pc < s.exe_end);
+      if (t->in_skip && ((rec.regmask >> REG_RET) & 1) &&
+          t->regs[REG_RET] == 12345)
+        s.atoi_result = 1;
+      t->in_skip = 0;
+      break;
+    case PT_REC_BLOCK_STEP:
+      assert(rec.kind == PT_INSN_OTHER && rec.mem_count == 0);
+      s.block_steps++;
+      // fallthrough
+    case PT_REC_STEP: {
+      assert(t->started && !t->in_skip);
+      assert(rec.pc >= s.exe_start && rec.pc < s.exe_end);
+      assert(rec.len > 0);
+      s.steps++;
+      s.calls += rec.kind == PT_INSN_CALL;
+      s.rets += rec.kind == PT_INSN_RET;
+      if (rec.kind == PT_INSN_RET && t->regs[REG_RET] == 4950)
+        s.sum_result = 1;
+      for (int i = 0; i < rec.mem_count; i++) {
+        PtMemOp op;
+        assert(fread(&op, sizeof(op), 1, f) == 1);
+        assert(op.size > 0 && (op.flags & (PT_MEM_READ | PT_MEM_WRITE)));
+        s.mem_ops++;
+        if (!(op.flags & PT_MEM_WRITE) || op.size != 8)
+          continue;
+        if (op.value == 0x1122334455667788ull)
+          s.magic_store = 1;
+        if (op.value == 0x1001 || op.value == 0x1002)
+          s.worker_store[op.value - 0x1000] = 1;
+      }
+      break;
+    }
+    default:
+      assert(!"unknown record type");
+    }
+  }
+  fclose(f);
+  return s;
+}
+
+void test_trace(const char *workload, const char *log) {
+  PtOptions options = {log, NULL, 0, NULL, 0, 0, 0};
+  char *argv[] = {(char *)workload, NULL};
+  PtStats stats;
+  assert(pt_trace_run(&options, argv, &stats) == 0);
+  assert(stats.steps > 0 && stats.skipped_calls > 0);
+  assert(stats.threads == 3); // main + 2 个工作线程
+
+  Summary s = read_log(log, workload);
+  assert(s.modules > 0 && s.exe_start < s.exe_end);
+  assert(s.steps == (long)stats.steps);
+  assert(s.thread_count == 3);
+  for (int i = 0; i < s.thread_count; i++)
+    assert(s.threads[i].started && s.threads[i].exited);
+  assert(s.magic_store && s.worker_store[1] && s.worker_store[2]);
+  assert(s.atoi_result && s.sum_result);
+  assert(s.calls > 0 && s.rets > 0 && s.skips > 0 && s.mem_ops > 0);
+  printf("trace: %ld steps, %ld mem ops, %ld skips, %llu silent, "
+         "%.0f steps/s ok\n",
+         s.steps, s.mem_ops, s.skips, (unsigned long long)stats.silent_steps,
+         stats.seconds > 0 ? (double)(stats.steps + stats.silent_steps) / stats.seconds : 0.0);
+}
+
+// 块步进与逐条单步得到相同的指令序列，停顿次数明显减少
+void test_block_step(const char *workload, const char *log) {
+  char *argv[] = {(char *)workload, NULL};
+  PtOptions options = {log, NULL, 0, NULL, 0, 0, 0};
+  PtStats single, block;
+  assert(pt_trace_run(&options, argv, &single) == 0);
+  Summary a = read_log(log, workload);
+  options.block_step = 1;
+  assert(pt_trace_run(&options, argv, &block) == 0);
+  Summary b = read_log(log, workload);
+
+  assert(a.block_steps == 0 && b.block_steps > 0);
+  assert(b.steps == a.steps && b.steps == (long)block.steps);
+  assert(b.calls == a.calls && b.rets == a.rets && b.skips == a.skips);
+  assert(b.thread_count == 3 && b.atoi_result && b.sum_result);
+  // 范围外的静默单步与模式无关，只比较范围内的停顿
+  uint64_t single_stops = single.stops - single.silent_steps;
+  uint64_t block_stops = block.stops - block.silent_steps;
+  assert(block_stops * 3 < single_stops);
+  printf("block_step: %llu stops instead of %llu for %ld steps ok\n",
+         (unsigned long long)block_stops, (unsigned long long)single_stops,
+         b.steps);
+
+  // 步数上限落在块中间时仍然精确
+  options.start_symbol = "pt_sum";
+  options.max_steps = 20;
+  assert(pt_trace_run(&options, argv, &block) == 0);
+  assert(block.steps == 20);
+  Summary c = read_log(log, workload);
+  assert(c.steps == 20 && c.block_steps > 0);
+}
+
+void test_max_steps(const char *workload, const char *log) {
+  PtOptions options = {log, "pt_sum", 0, NULL, 0, 20, 0};
+  char *argv[] = {(char *)workload, NULL};
+  PtStats stats;
+  // 分离后进程自己运行结束
+  assert(pt_trace_run(&options, argv, &stats) == 0);
+  assert(stats.steps == 20 && stats.threads == 1);
+  Summary s = read_log(log, workload);
+  assert(s.steps == 20 && s.thread_count == 1 && !s.threads[0].exited);
+  printf("max_steps: ok\n");
+}
+
+void test_errors(const char *workload, const char *log) {
+  PtStats stats;
+  char *missing[] = {"/nonexistent/pt_workload", NULL};
+  PtOptions options = {log, NULL, 0, NULL, 0, 0, 0};
+  assert(pt_trace_run(&options, missing, &stats) == -1);
+  char *argv[] = {(char *)workload, NULL};
+  options.start_symbol = "no_such_function";
+  assert(pt_trace_run(&options, argv, &stats) == -1);
+  printf("errors: ok\n");
+}
+
+int main(int argc, char **argv) {
+  assert(argc == 2);
+  char log[] = "/tmp/pt_stepper_test_XXXXXX";
+  int fd = mkstemp(log);
+  assert(fd >= 0);
+  close(fd);
+  test_trace(argv[1], log);
+  test_block_step(argv[1], log);
+  test_max_steps(argv[1], log);
+  test_errors(argv[1], log);
+  unlink(log);
+  printf("All stepper tests passed!\n");
+  return 0;
+}
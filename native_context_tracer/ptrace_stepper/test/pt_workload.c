@@ -0,0 +1,42 @@
+#include <pthread.h>
+#include <stdlib.h>
+
+// pt_stepper_test 跟踪的进程：固定的访存、库调用和两个工作线程，
+// 测试从日志中找回这些值
+
+#define WORKERS 2
+#define MAGIC 0x1122334455667788L
+
+long pt_slots[WORKERS + 1];
+
+int pt_sum(const int *values, int n) {
+  int sum = 0;
+  for (int i = 0; i < n; i++)
+    sum += values[i];
+  return sum;
+}
+
+void pt_store(long *dst, long value) { *dst = value; }
+
+static void *pt_worker(void *arg) {
+  long index = (long)arg;
+  pt_store(&pt_slots[index], 0x1000 + index);
+  return NULL;
+}
+
+int main(void) {
+  int values[100];
+  for (int i = 0; i < 100; i++)
+    values[i] = i;
+  pt_store(&pt_slots[0], MAGIC);
+  volatile const char *digits = "12345";
+  int parsed = atoi((const char *)digits); // 跟踪范围外的调用
+  pthread_t threads[WORKERS];
+  for (long i = 0; i < WORKERS; i++)
+    pthread_create(&threads[i], NULL, pt_worker, (void *)(i + 1));
+  for (int i = 0; i < WORKERS; i++)
+    pthread_join(threads[i], NULL);
+  int ok = pt_sum(values, 100) == 4950 && parsed == 12345 &&
+           pt_slots[1] == 0x1001 && pt_slots[2] == 0x1002;
+  return ok ? 0 : 1;
+}
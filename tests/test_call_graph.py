@@ -0,0 +1,159 @@
+import json
+import random
+import shutil
+import tempfile
+import unittest
+from pathlib import Path
+
+from debugger import call_graph
+from debugger.call_graph import CallGraph
+
+
+def call(frame_id, func, filename="app.py", lineno=1):
+    return {"type": "call", "frame_id": frame_id, "func": func, "filename": filename, "lineno": lineno}
+
+
+def ret(frame_id, entry_type="return"):
+    return {"type": entry_type, "frame_id": frame_id, "filename": "app.py", "lineno": 0}
+
+
+class CallGraphTests:
+    build = None
+
+    def setUp(self):
+        self.tmp_dir = Path(tempfile.mkdtemp())
+
+    def tearDown(self):
+        shutil.rmtree(self.tmp_dir, ignore_errors=True)
+
+    def load(self, entries, positions=None):
+        path = self.tmp_dir / "trace.log.index"
+        with open(path, "w", encoding="utf-8") as f:
+            for i, entry in enumerate(entries):
+                f.write(json.dumps({**entry, "position": positions[i] if positions else i * 10}) + "\n")
+        return CallGraph(self.build(str(path)))
+
+    def frames(self, graph, nodes):
+        return [graph.frame_id[node] for node in nodes]
+
+    def test_tree_ranges(self):
+        graph = self.load(
+            [
+                call(1, "main"),
+                call(2, "foo"),
+                call(3, "bar"),
+                ret(3),
+                ret(2),
+                call(4, "baz"),
+                call(5, "qux"),
+                ret(4, "exception"),  # qux 没有返回，被 baz 的异常关闭
+                ret(1),
+            ]
+        )
+        self.assertEqual(len(graph), 6)
+        self.assertEqual(self.frames(graph, graph.children_of(0)), [1])
+        main = graph.calls_of(1)[0]
+        self.assertEqual(self.frames(graph, graph.children_of(main)), [2, 4])
+        self.assertEqual(self.frames(graph, graph.descendants_of(main)), [2, 3, 4, 5])
+        self.assertEqual(self.frames(graph, graph.descendants_of(graph.calls_of(2)[0])), [3])
+        siblings, index = graph.siblings_of(graph.calls_of(4)[0])
+        self.assertEqual((self.frames(graph, siblings), index), ([2, 4], 1))
+        self.assertEqual(graph.siblings_of(0), ((0,), 0))
+        self.assertIsNone(graph.parent_of(0))
+
+        baz, qux = graph.calls_of(4)[0], graph.calls_of(5)[0]
+        self.assertEqual((graph.status_of(baz), graph.end_of(baz)), ("exception", 70))
+        self.assertEqual((graph.status_of(qux), graph.end_of(qux)), ("partial", None))
+        self.assertEqual((graph.status_of(main), graph.end_of(main)), ("return", 80))
+        self.assertEqual((graph.func_of(0), graph.status_of(0)), ("<root>", None))
+        self.assertEqual(graph.cycle, [])
+
+    def test_generator_resumes_are_separate_calls(self):
+        graph = self.load([call(1, "main"), call(2, "gen"), ret(2), call(3, "other"), call(2, "gen"), ret(2), ret(3), ret(1)])
+        first, second = graph.calls_of(2)
+        self.assertEqual(self.frames(graph, [graph.parent_of(first), graph.parent_of(second)]), [1, 3])
+        self.assertEqual((graph.end_of(first), graph.end_of(second)), (20, 50))
+        self.assertEqual(graph.cycle, [])
+
+    def test_cycle_between_frame_ids(self):
+        graph = self.load([call(1, "a"), call(2, "b"), ret(2), ret(1), call(2, "b"), call(1, "a"), ret(1), ret(2)])
+        self.assertEqual(len(graph), 5)
+        self.assertEqual(graph.cycle, [1, 2])
+
+    def test_entries_sorted_by_position(self):
+        graph = self.load([ret(2), call(1, "main"), call(2, "foo"), ret(1)], positions=[20, 0, 10, 30])
+        foo = graph.calls_of(2)[0]
+        self.assertEqual(self.frames(graph, [graph.parent_of(foo)]), [1])
+        self.assertEqual((graph.start[foo], graph.end_of(foo)), (10, 20))
+
+    def test_locations_and_escaped_strings(self):
+        filename = 'dir/"quoted" é.py'
+        graph = self.load(
+            [
+                call(1, "main", "main.py", 1),
+                call(2, "f\\n", filename, 3),
+                ret(2),
+                call(3, "g", "main.py", 1),
+                ret(3),
+                call(4, "f\\n", filename, 3),
+                ret(4),
+                ret(1),
+            ]
+        )
+        self.assertEqual(self.frames(graph, graph.nodes_at(filename, 3)), [2, 4])
+        self.assertEqual(self.frames(graph, graph.nodes_at("main.py", 1)), [1, 3])
+        self.assertEqual(graph.nodes_at("main.py", 2), [])
+        self.assertEqual(graph.func_of(graph.calls_of(4)[0]), "f\\n")
+        self.assertEqual(graph.filename_of(graph.calls_of(4)[0]), filename)
+
+    def test_skips_invalid_lines(self):
+        path = self.tmp_dir / "trace.log.index"
+        path.write_text(
+            "# comment\n"
+            "not json\n"
+            '{"type": "call", "frame_id": 1, "position": 0}\n'
+            '{"type": "line", "frame_id": 1, "position": 5, "lineno": 2}\n'
+            '{"type": "call", "frame_id": 2}\n'
+            '{"type": "return", "frame_id": 1, "position": 10}\n',
+            encoding="utf-8",
+        )
+        graph = CallGraph(self.build(str(path)))
+        self.assertEqual(len(graph), 2)
+        self.assertEqual((graph.func_of(1), graph.filename_of(1), graph.status_of(1)), ("N/A", "", "return"))
+
+
+class TestPyCallGraph(CallGraphTests, unittest.TestCase):
+    build = staticmethod(call_graph._py_build_call_graph)
+
+
+@unittest.skipIf(call_graph.build_call_graph is call_graph._py_build_call_graph, "tracer_core is not built")
+class TestNativeCallGraph(CallGraphTests, unittest.TestCase):
+    build = staticmethod(call_graph.build_call_graph)
+
+    def test_matches_python(self):
+        rng = random.Random(7)
+        entries, stack, next_frame = [], [], 1
+        for _ in range(3000):
+            choice = rng.random()
+            if choice < 0.45 or not stack:
+                # 偶尔重新调用已有的帧 ID（生成器恢复）
+                frame_id = rng.randrange(1, next_frame) if next_frame > 1 and rng.random() < 0.1 else next_frame
+                next_frame = max(next_frame, frame_id + 1)
+                entries.append(call(frame_id, f"f{frame_id % 17}", f"m{frame_id % 5}.py", frame_id % 11))
+                stack.append(frame_id)
+            elif choice < 0.9:
+                entries.append(ret(stack.pop()))
+            else:
+                # 跳过几层：中间的调用没有返回事件
+                for _ in range(min(len(stack) - 1, rng.randrange(3))):
+                    stack.pop()
+                entries.append(ret(stack.pop(), rng.choice(["return", "exception"])))
+        path = self.tmp_dir / "trace.log.index"
+        with open(path, "w", encoding="utf-8") as f:
+            for i, entry in enumerate(entries):
+                f.write(json.dumps({**entry, "position": i * 10}) + "\n")
+        self.assertEqual(call_graph.build_call_graph(str(path)), call_graph._py_build_call_graph(str(path)))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -115,28 +115,42 @@ class TestGraphTraceLogExtractor(BaseTracerTest):
 
         self.assertIsNotNone(graph)
         # 虚拟根节点 + 6个真实节点
-        self.assertEqual(len(graph.nodes), 7)
+        self.assertEqual(len(graph), 7)
         # 栈模型将所有调用构建成一个以 main(100) 为根的单棵树
         # 0->100, 100->200, 200->300, 100->400, 400->500, 400->600
-        self.assertEqual(len(graph.edges), 6)
+        self.assertEqual(len(graph.children), 6)
 
         # 检查重构的树结构
-        self.assertTrue(graph.has_edge(ROOT_FRAME_ID, 100))
+        self.assertTrue(self._has_edge(graph, ROOT_FRAME_ID, 100))
         # worker(400) 是 main(100) 的子调用，因为它在 main 的生命周期内被调用
-        self.assertTrue(graph.has_edge(100, 400))
-        self.assertFalse(graph.has_edge(ROOT_FRAME_ID, 400))
+        self.assertTrue(self._has_edge(graph, 100, 400))
+        self.assertFalse(self._has_edge(graph, ROOT_FRAME_ID, 400))
 
-        self.assertTrue(graph.has_edge(100, 200))
-        self.assertTrue(graph.has_edge(200, 300))
-        self.assertTrue(graph.has_edge(400, 500))
-        self.assertTrue(graph.has_edge(400, 600))
+        self.assertTrue(self._has_edge(graph, 100, 200))
+        self.assertTrue(self._has_edge(graph, 200, 300))
+        self.assertTrue(self._has_edge(graph, 400, 500))
+        self.assertTrue(self._has_edge(graph, 400, 600))
 
         # 检查节点状态
-        self.assertEqual(graph.nodes[300]["status"], "return")
-        self.assertEqual(graph.nodes[400]["status"], "return")
+        self.assertEqual(self._status(graph, 300), "return")
+        self.assertEqual(self._status(graph, 400), "return")
         # service(600) 没有自己的返回事件，但其父节点 worker(400) 返回了，因此它被标记为 'partial'
-        self.assertEqual(graph.nodes[600]["status"], "partial")
-        self.assertEqual(graph.nodes[100]["status"], "return")
+        self.assertEqual(self._status(graph, 600), "partial")
+        self.assertEqual(self._status(graph, 100), "return")
+
+        # 子树和兄弟都是连续区间
+        (main,) = graph.calls_of(100)
+        self.assertEqual([graph.frame_id[n] for n in graph.descendants_of(main)], [200, 300, 400, 500, 600])
+        siblings, index = graph.siblings_of(graph.calls_of(500)[0])
+        self.assertEqual(([graph.frame_id[n] for n in siblings], index), ([500, 600], 0))
+
+    @staticmethod
+    def _has_edge(graph, parent_frame, frame):
+        return any(graph.frame_id[graph.parent[node]] == parent_frame for node in graph.calls_of(frame))
+
+    @staticmethod
+    def _status(graph, frame):
+        return graph.status_of(graph.calls_of(frame)[0])
 
     def test_lookup(self):
         # 测试部分调用（没有返回的节点）
@@ -242,9 +256,9 @@ class TestGraphTraceLogExtractor(BaseTracerTest):
         extractor._build_graph()
 
         # 节点 150 应该连接到根节点 (ID 0)，因为在调用它时堆栈为空
-        self.assertTrue(extractor._graph.has_edge(ROOT_FRAME_ID, 150))
+        self.assertTrue(self._has_edge(extractor._graph, ROOT_FRAME_ID, 150))
         # 节点 50 不应该被创建
-        self.assertFalse(extractor._graph.has_node(50))
+        self.assertEqual(len(extractor._graph.calls_of(50)), 0)
 
         # 验证 lookup 返回一个包含 call/return 的事件对
         logs, refs = extractor.lookup("fragment.py", 10)
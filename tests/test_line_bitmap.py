@@ -0,0 +1,69 @@
+import base64
+import json
+import shutil
+import subprocess
+import unittest
+from pathlib import Path
+
+from debugger import line_bitmap
+from debugger.line_bitmap import PyLineBitmap, decode_runs, encode_runs, to_base64
+
+SAMPLES = [[], [1], [5, 6, 7, 10], [3, 200, 300], list(range(1, 500, 2)), [0, 127, 128, 16384, 70000]]
+
+
+class TestLineBitmap(unittest.TestCase):
+    def build(self, cls, lines):
+        bitmap = cls()
+        for line in reversed(lines):
+            bitmap.add(line)
+            bitmap.add(line)
+        return bitmap
+
+    def test_runs_round_trip(self):
+        for lines in SAMPLES:
+            self.assertEqual(decode_runs(encode_runs(lines)), lines)
+        self.assertEqual(encode_runs([5, 6, 7, 10]), bytes([5, 3, 2, 1]))
+
+    def test_python_bitmap(self):
+        bitmap = self.build(PyLineBitmap, [10, 3, 7])
+        other = self.build(PyLineBitmap, [4, 7])
+        bitmap.update(other)
+        self.assertEqual((bitmap.lines(), len(bitmap)), ([3, 4, 7, 10], 4))
+        self.assertEqual(decode_runs(bitmap.encode()), [3, 4, 7, 10])
+
+    def test_python_bitmap_grows_to_far_lines(self):
+        bitmap = self.build(PyLineBitmap, [5000, 2, 5000])
+        bitmap.update(self.build(PyLineBitmap, [9]))
+        self.assertEqual((bitmap.lines(), len(bitmap)), ([2, 9, 5000], 3))
+
+    def test_native_and_python_bitmaps_agree(self):
+        if line_bitmap.LineBitmap is PyLineBitmap:
+            self.skipTest("tracer_core is not built")
+        for lines in SAMPLES:
+            native = self.build(line_bitmap.LineBitmap, lines)
+            self.assertEqual((native.lines(), len(native)), (lines, len(lines)))
+            self.assertEqual(native.encode(), self.build(PyLineBitmap, lines).encode())
+        merged = self.build(line_bitmap.LineBitmap, [100, 101])
+        merged.update(self.build(line_bitmap.LineBitmap, [1, 101, 300]))
+        self.assertEqual(merged.lines(), [1, 100, 101, 300])
+        with self.assertRaises(TypeError):
+            merged.update(PyLineBitmap())
+        with self.assertRaises(ValueError):
+            merged.add(-1)
+
+    def test_javascript_decoder(self):
+        node = shutil.which("node")
+        if node is None:
+            self.skipTest("node is not installed")
+        script = Path(line_bitmap.__file__).with_name("tracer_scripts.js").read_text(encoding="utf-8")
+        start = script.index("function decodeLineRuns")
+        decoder = script[start : script.index("\n}\n", start) + 3]
+        encoded = [to_base64(self.build(PyLineBitmap, lines)) for lines in SAMPLES]
+        program = f"{decoder}\nconsole.log(JSON.stringify({json.dumps(encoded)}.map(decodeLineRuns)));"
+        result = subprocess.run([node, "-e", program], capture_output=True, text=True, check=True)
+        self.assertEqual(json.loads(result.stdout), SAMPLES)
+        self.assertEqual(base64.b64decode(encoded[2]), encode_runs(SAMPLES[2]))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,52 @@
+import unittest
+from unittest.mock import patch
+
+from debugger import tracer_common
+from debugger.tracer_common import format_log_message
+
+CALL_DATA = {
+    "indent": "  ",
+    "prefix": "CALL",
+    "filename": "pkg/mod.py",
+    "original_filename": "/src/pkg/mod.py",
+    "lineno": 12,
+    "func": "run",
+    "args": "x=1, name='数据'",
+    "frame_id": 7,
+    "parent_frame_id": 3,
+    "thread_id": 4242,
+    "tracked_vars": {},
+}
+TEMPLATES = [
+    "{indent}↘ {prefix} {filename}:{lineno} {func}({args}) [frame:{frame_id}][thread:{thread_id}]",
+    "{indent}↗ RETURN {filename} {func}() → {args} [frame:{frame_id}] # Debug: {tracked_vars}",
+    "{{literal}} {func} }}{{",
+    "{lineno:>5} {func!r}",  # 原生格式化不支持，退回 str.format
+]
+
+
+class TestLogFormat(unittest.TestCase):
+    def test_native_matches_str_format(self):
+        if tracer_common._native_format_log is None:
+            self.skipTest("tracer_core is not built")
+        native = tracer_common._native_format_log
+        for template in TEMPLATES[:3]:
+            self.assertEqual(native(template, CALL_DATA), template.format(**CALL_DATA))
+        self.assertIsNone(native(TEMPLATES[3], CALL_DATA))
+        with self.assertRaises(KeyError):
+            native("{missing}", CALL_DATA)
+
+    def test_message_is_formatted_once(self):
+        for native in (tracer_common._native_format_log, None):
+            with patch.object(tracer_common, "_native_format_log", native):
+                for template in TEMPLATES:
+                    log_data = {"template": template, "data": dict(CALL_DATA)}
+                    self.assertEqual(format_log_message(log_data), template.format(**CALL_DATA))
+                    log_data["data"]["func"] = "changed"
+                    self.assertEqual(format_log_message(log_data), log_data["message"])
+                    self.assertNotIn("changed", log_data["message"])
+        self.assertEqual(format_log_message("plain"), "plain")
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,127 @@
+import shutil
+import tempfile
+import threading
+import time
+import unittest
+from pathlib import Path
+from unittest.mock import patch
+
+from debugger import output_queue, tracer
+from debugger.output_queue import PyOutputQueue
+
+
+class OutputQueueTests:
+    queue_class = None
+
+    def test_batches_by_size_and_latency(self):
+        queue = self.queue_class(capacity=100, batch_size=4, latency_ms=20)
+        for i in range(10):
+            self.assertTrue(queue.put(i))
+        self.assertEqual(queue.get_batch(), [0, 1, 2, 3])
+        self.assertEqual(queue.get_batch(), [4, 5, 6, 7])
+        start = time.monotonic()
+        self.assertEqual(queue.get_batch(), [8, 9])  # 不足一批，等待 latency 后返回
+        self.assertGreaterEqual(time.monotonic() - start, 0.015)
+        self.assertEqual(queue.stats()["max_depth"], 10)
+
+    def test_close_wakes_consumer_and_rejects_items(self):
+        queue = self.queue_class(batch_size=4, latency_ms=10000)
+        received = []
+        consumer = threading.Thread(target=lambda: [received.extend(batch) for batch in iter(queue.get_batch, [])])
+        consumer.start()
+        queue.put("a")
+        time.sleep(0.05)
+        queue.close()
+        consumer.join(timeout=5)
+        self.assertFalse(consumer.is_alive())
+        self.assertEqual(received, ["a"])
+        self.assertTrue(queue.closed)
+        self.assertFalse(queue.put("b"))
+        self.assertEqual(queue.stats()["dropped"], 1)
+
+    def test_drop_oldest(self):
+        queue = self.queue_class(capacity=3, policy="drop_oldest")
+        for i in range(5):
+            self.assertTrue(queue.put(i))
+        self.assertEqual(queue.drain(), [2, 3, 4])
+        self.assertEqual(queue.stats()["dropped"], 2)
+
+    def test_sample(self):
+        queue = self.queue_class(capacity=8, policy="sample", sample_rate=3)
+        accepted = [i for i in range(20) if queue.put(i)]
+        # 前 6 条直接入队，之后每 3 条保留 1 条，满 8 条后全部丢弃
+        self.assertEqual(accepted, [0, 1, 2, 3, 4, 5, 6, 9])
+        self.assertEqual(len(queue), 8)
+        self.assertEqual(queue.stats()["dropped"], 12)
+
+    def test_block_waits_for_consumer(self):
+        queue = self.queue_class(capacity=2, batch_size=1, latency_ms=0)
+        received = []
+
+        def consume():
+            for batch in iter(queue.get_batch, []):
+                time.sleep(0.002)
+                received.extend(batch)
+
+        consumer = threading.Thread(target=consume)
+        consumer.start()
+        for i in range(50):
+            self.assertTrue(queue.put(i))
+            self.assertLessEqual(len(queue), 2)
+        queue.close()
+        consumer.join(timeout=5)
+        self.assertEqual(received, list(range(50)))
+        self.assertGreater(queue.stats()["blocked"], 0)
+        self.assertEqual(queue.stats()["dropped"], 0)
+
+    def test_consumer_never_blocks_on_itself(self):
+        queue = self.queue_class(capacity=1, batch_size=1, latency_ms=0)
+        queue.put("first")
+        self.assertEqual(queue.get_batch(), ["first"])
+        queue.put("second")
+        self.assertTrue(queue.put("from consumer"))  # 同一线程，队列已满也入队
+        self.assertEqual(queue.drain(), ["second", "from consumer"])
+
+    def test_invalid_arguments(self):
+        with self.assertRaises(ValueError):
+            self.queue_class(policy="unknown")
+        with self.assertRaises(ValueError):
+            self.queue_class(capacity=0)
+
+
+class TestPyOutputQueue(OutputQueueTests, unittest.TestCase):
+    queue_class = PyOutputQueue
+
+
+@unittest.skipIf(output_queue.OutputQueue is PyOutputQueue, "tracer_core is not built")
+class TestNativeOutputQueue(OutputQueueTests, unittest.TestCase):
+    queue_class = output_queue.OutputQueue
+
+
+class TestTraceLogicStop(unittest.TestCase):
+    def setUp(self):
+        self.log_dir = Path(tempfile.mkdtemp())
+        self.addCleanup(shutil.rmtree, self.log_dir, ignore_errors=True)
+
+    def test_stop_gives_up_on_a_stuck_output_thread(self):
+        with patch.object(tracer, "_LOG_DIR", self.log_dir):
+            logic = tracer.TraceLogic(tracer.TraceConfig(disable_html=True, enable_source_cache=False))
+        release = threading.Event()
+        self.addCleanup(release.set)
+        stuck = threading.Thread(target=release.wait, daemon=True)
+        stuck.start()
+        logic._timer_thread = stuck
+        with patch.object(tracer, "_FLUSH_JOIN_TIMEOUT", 0.05), self.assertLogs(level="WARNING") as logs:
+            start = time.monotonic()
+            logic.stop()
+        self.assertLess(time.monotonic() - start, 5)
+        self.addCleanup(logic.disable_output, "file")
+        self.assertIsNone(logic._timer_thread)
+        self.assertTrue(any("输出线程" in line for line in logs.output))
+        # 输出线程可能还在写，日志文件保持打开
+        self.assertIsNotNone(logic._output._log_file)
+        self.assertIn("file", logic._output._active_outputs)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,85 @@
+import random
+import shutil
+import tempfile
+import unittest
+from pathlib import Path
+
+from debugger.seekable_log import SeekableLogReader, SeekableLogWriter, is_seekable_log, log_text_size, open_log
+from debugger.trace_pager import TracePager
+
+
+def sample_lines(count):
+    rng = random.Random(7)
+    return [f"{'  ' * rng.randint(0, 6)}▷ pkg/mod.py:{i} value = {rng.randint(0, 10**6)}\n" for i in range(count)]
+
+
+class TestSeekableLog(unittest.TestCase):
+    def setUp(self):
+        self.tmp_dir = Path(tempfile.mkdtemp())
+        self.path = self.tmp_dir / "trace.log.z"
+        self.lines = sample_lines(3000)
+        self.text = "".join(self.lines).encode("utf-8")
+        self.positions = []
+        with SeekableLogWriter(self.path, frame_size=4096) as writer:
+            for line in self.lines:
+                self.positions.append(writer.tell())
+                writer.write(line)
+            self.assertEqual(writer.tell(), len(self.text))
+
+    def tearDown(self):
+        shutil.rmtree(self.tmp_dir, ignore_errors=True)
+
+    def open_reader(self, path=None):
+        reader = SeekableLogReader(path or self.path)
+        self.addCleanup(reader.close)
+        return reader
+
+    def test_random_access_matches_text(self):
+        reader = self.open_reader()
+        self.assertTrue(is_seekable_log(self.path))
+        self.assertEqual((len(reader), log_text_size(self.path)), (len(self.text), len(self.text)))
+        self.assertLess(self.path.stat().st_size, len(self.text) // 2)
+        rng = random.Random(1)
+        for _ in range(500):
+            start = rng.randrange(len(self.text))
+            end = start + rng.randrange(20000)
+            self.assertEqual(reader[start:end], self.text[start:end])
+            needle = self.text[start : start + rng.randint(1, 16)]
+            self.assertEqual(reader.find(needle, max(0, start - 3)), self.text.find(needle, max(0, start - 3)))
+            self.assertEqual(reader.rfind(needle, 0, end), self.text.rfind(needle, 0, end))
+            self.assertEqual(reader.find(b"\n", start, end), self.text.find(b"\n", start, end))
+            self.assertEqual(reader.rfind(b"\n", start, end), self.text.rfind(b"\n", start, end))
+        self.assertEqual(reader.find(b"not in log"), -1)
+
+    def test_open_log_seeks_to_index_positions(self):
+        with open_log(self.path) as f:
+            for i in (0, 17, 1500, len(self.lines) - 1):
+                f.seek(self.positions[i])
+                self.assertEqual(f.readline(), self.lines[i])
+                if i + 1 < len(self.lines):
+                    self.assertEqual(f.tell(), self.positions[i + 1])
+
+    def test_unfinished_log_is_readable(self):
+        data = self.path.read_bytes()
+        truncated = self.tmp_dir / "partial.log.z"
+        truncated.write_bytes(data[: len(data) // 2])
+        reader = self.open_reader(truncated)
+        self.assertGreater(len(reader), 0)
+        self.assertEqual(reader[: len(reader)], self.text[: len(reader)])
+
+    def test_pager_reads_compressed_log(self):
+        plain = self.tmp_dir / "trace.log"
+        plain.write_bytes(self.text)
+        for log in (plain, self.path):
+            Path(f"{log}.index").write_text("", encoding="utf-8")
+        pages = []
+        for log in (plain, self.path):
+            pager = TracePager(log)
+            self.addCleanup(pager.close)
+            pages.append((pager.page(cursor=self.positions[1234], limit=50), pager.search("mod.py:2999")))
+        self.assertEqual(pages[0], pages[1])
+        self.assertEqual(pages[1][0]["items"][0]["text"], self.lines[1234].rstrip("\n"))
+
+
+if __name__ == "__main__":
+    unittest.main()
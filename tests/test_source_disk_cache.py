@@ -0,0 +1,164 @@
+import os
+import shutil
+import tempfile
+import textwrap
+import unittest
+from pathlib import Path
+from unittest.mock import patch
+
+from debugger import source_cache, source_disk_cache
+from debugger.source_cache import SourceCacheManager
+from debugger.source_disk_cache import SourceDiskCache, code_key
+from debugger.stmt_line_table import StmtLineTable
+from debugger.variable_trace import analyze_variable_ops
+
+SOURCE = textwrap.dedent(
+    """\
+    import os
+
+    values = [
+        1,
+        2,
+    ]
+
+
+    def total(items):
+        result = sum(
+            item for item in items
+        )
+        return result
+    """
+)
+
+
+class TestSourceDiskCache(unittest.TestCase):
+    def setUp(self):
+        self.tmp_dir = Path(tempfile.mkdtemp())
+        self.cache_dir = self.tmp_dir / "cache"
+        self.source_file = self.tmp_dir / "sample.py"
+        self.source_file.write_text(SOURCE, encoding="utf-8")
+
+    def tearDown(self):
+        shutil.rmtree(self.tmp_dir, ignore_errors=True)
+
+    def open_cache(self):
+        cache = SourceDiskCache(self.cache_dir)
+        self.addCleanup(cache.close)
+        return cache
+
+    def test_spans_and_source_match_ast_table(self):
+        entry = self.open_cache().get(str(self.source_file))
+        table = StmtLineTable(SOURCE)
+        self.assertEqual(entry.lines, SOURCE.splitlines())
+        for lineno in range(1, len(entry.lines) + 1):
+            self.assertEqual(entry.statement_range(lineno), table.get_statement_range(lineno) or (lineno, lineno))
+        self.assertIsNone(entry.statement_range(0))
+        self.assertIsNone(entry.statement_range(len(entry.lines) + 1))
+
+    def test_unchanged_file_is_not_read_or_parsed(self):
+        self.open_cache().get(str(self.source_file))
+        self.assertEqual(len(list(self.cache_dir.iterdir())), 1)
+        with patch.object(source_disk_cache, "_compute_spans", side_effect=AssertionError("parsed")), patch.object(
+            SourceDiskCache, "_read", side_effect=AssertionError("read")
+        ):
+            entry = self.open_cache().get(str(self.source_file))
+            self.assertEqual(entry.statement_range(4), (3, 6))
+            self.assertEqual(entry.lines[9], "    result = sum(")
+
+    def test_touched_file_is_validated_by_content_hash(self):
+        self.open_cache().get(str(self.source_file))
+        stat = self.source_file.stat()
+        os.utime(self.source_file, ns=(stat.st_atime_ns, stat.st_mtime_ns + 5_000_000_000))
+        with patch.object(source_disk_cache, "_compute_spans", side_effect=AssertionError("parsed")):
+            entry = self.open_cache().get(str(self.source_file))
+            self.assertEqual(entry.mtime_ns, stat.st_mtime_ns + 5_000_000_000)
+        # mtime 已写回缓存头，再次打开不需要读源文件
+        with patch.object(SourceDiskCache, "_read", side_effect=AssertionError("read")):
+            self.assertEqual(self.open_cache().get(str(self.source_file)).statement_range(11), (10, 12))
+
+    def test_modified_file_is_rebuilt(self):
+        self.open_cache().get(str(self.source_file))
+        self.source_file.write_text("x = (\n    1)\n" + SOURCE, encoding="utf-8")
+        entry = self.open_cache().get(str(self.source_file))
+        self.assertEqual(entry.statement_range(2), (1, 2))
+        self.assertEqual(entry.statement_range(6), (5, 8))
+
+    def test_corrupt_cache_file_is_rebuilt(self):
+        self.open_cache().get(str(self.source_file))
+        (cache_file,) = self.cache_dir.iterdir()
+        cache_file.write_bytes(b"garbage")
+        entry = self.open_cache().get(str(self.source_file))
+        self.assertEqual(entry.statement_range(4), (3, 6))
+        self.assertGreater(cache_file.stat().st_size, len(b"garbage"))
+
+    def test_var_ops_persist_across_runs(self):
+        module = compile(SOURCE, str(self.source_file), "exec")
+        func = next(const for const in module.co_consts if getattr(const, "co_name", None) == "total")
+        cache = self.open_cache()
+        entry = cache.get(str(self.source_file))
+        self.assertIsNone(entry.get_var_ops(code_key(func)))
+        entry.put_var_ops(code_key(func), analyze_variable_ops(func))
+        cache.flush()
+        self.assertFalse(entry.dirty)
+        self.assertEqual(entry.statement_range(13), (13, 13))
+
+        expected = {line: set(names) for line, names in analyze_variable_ops(func).items()}
+        reopened = self.open_cache().get(str(self.source_file))
+        self.assertEqual(reopened.get_var_ops(code_key(func)), expected)
+        with patch.object(source_disk_cache, "_CACHE_TAG", b"other-python"):
+            self.assertIsNone(self.open_cache().get(str(self.source_file)).get_var_ops(code_key(func)))
+
+    def test_code_key_separates_code_objects_on_one_line(self):
+        module = compile("f = lambda: a; g = lambda: b\nh = [x for x in y] + [z for z in y]\n", "s.py", "exec")
+        codes = [const for const in module.co_consts if hasattr(const, "co_code")]
+        self.assertEqual(len(codes), 4)
+        self.assertEqual(len({code_key(code) for code in codes}), 4)
+        self.assertEqual(code_key(codes[0]), code_key(compile("f = lambda: a", "s.py", "exec").co_consts[0]))
+
+    def test_missing_file_and_unwritable_cache_dir(self):
+        cache = self.open_cache()
+        self.assertIsNone(cache.get(str(self.tmp_dir / "missing.py")))
+        blocker = self.tmp_dir / "blocker"
+        blocker.write_text("", encoding="utf-8")
+        entry = SourceDiskCache(blocker / "cache").get(str(self.source_file))
+        self.assertEqual(entry.statement_range(5), (3, 6))
+
+
+class TestSourceCacheManagerDiskCache(unittest.TestCase):
+    def setUp(self):
+        self.tmp_dir = Path(tempfile.mkdtemp())
+        self.source_file = self.tmp_dir / "sample.py"
+        self.source_file.write_text(SOURCE, encoding="utf-8")
+
+    def tearDown(self):
+        shutil.rmtree(self.tmp_dir, ignore_errors=True)
+
+    def test_statement_info_from_disk_cache(self):
+        expected = SourceCacheManager()
+        manager = SourceCacheManager()
+        manager.set_disk_cache(SourceDiskCache(self.tmp_dir / "cache"))
+        self.addCleanup(manager.set_disk_cache, None)
+        for lineno in range(1, len(SOURCE.splitlines()) + 2):
+            self.assertEqual(
+                manager.get_statement_info(str(self.source_file), lineno),
+                expected.get_statement_info(str(self.source_file), lineno),
+            )
+        self.assertEqual(manager._table_cache, {})
+        self.assertEqual(manager._source_cache, {})
+
+    def test_code_path_comes_before_disk_cache(self):
+        module = compile(SOURCE, str(self.source_file), "exec")
+        manager = SourceCacheManager()
+        manager.set_disk_cache(SourceDiskCache(self.tmp_dir / "cache"))
+        self.addCleanup(manager.set_disk_cache, None)
+        with patch.object(source_cache, "_native_statement_range", return_value=(3, 4)) as native:
+            self.assertEqual(manager.get_statement_info(str(self.source_file), 4, module), ("values = [\n    1,", 3, 4))
+        native.assert_called_once()
+        self.assertIs(native.call_args.args[2], manager.get_cached_source(str(self.source_file)).lines)
+        with patch.object(source_cache, "_native_statement_range", return_value=None):
+            self.assertEqual(manager.get_statement_info(str(self.source_file), 4, module)[1:], (3, 6))
+        self.assertEqual(manager._source_cache, {})
+
+
+if __name__ == "__main__":
+    unittest.main()
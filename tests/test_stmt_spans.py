@@ -0,0 +1,189 @@
+import textwrap
+import types
+import unittest
+from unittest.mock import patch
+
+from debugger import source_cache
+from debugger.source_cache import SourceCacheManager
+from debugger.stmt_line_table import StmtLineTable
+
+try:
+    from debugger.tracer_core import statement_range
+except ImportError:
+    statement_range = None
+
+SAMPLE_SOURCE = textwrap.dedent(
+    '''\
+    """Module docstring
+    spanning two lines."""
+    import os
+    x = 1
+
+    my_list = [
+        1, 2, 3,  # comment inside brackets
+
+        4, 5, 6
+    ]
+    print("Hello",
+          "World",
+          sep=", ")
+    if x > 0:
+        print("positive")
+    elif (x < 0 and
+          x > -10):
+        print("negative")
+    else: y = [
+        x]
+    y = 1 + \\
+        2 + \\
+        3
+    text = """a ( [ {
+    still in the string ' "
+    """
+    escaped = "quote \\" ( inside"
+
+
+    def decorator(f):
+        return f
+
+
+    @decorator
+    def my_func(a,
+                b: int = 2) -> int:
+        # a pass statement inside a function
+        total = sum(
+            i * i for i in range(a)
+        )
+        squares = [i * i for i in range(b)]
+        return (total +
+                len(squares))
+
+
+    class Point:
+        x: int = 0
+        def norm(self): return abs(
+            self.x)
+
+
+    try:
+        result = 1 / x
+    except ZeroDivisionError:
+        print("Cannot divide by zero")
+    finally:
+        print("Done.")
+    match x:
+        case 1:
+            match = {"a":
+                     1}
+        case _:
+            pass
+    '''
+)
+
+
+def _code_objects(code):
+    stack = [code]
+    while stack:
+        code = stack.pop()
+        yield code
+        stack.extend(const for const in code.co_consts if isinstance(const, types.CodeType))
+
+
+def _executed_lines(code):
+    return sorted({line for _, _, line in code.co_lines() if line is not None})
+
+
+@unittest.skipIf(statement_range is None, "tracer_core is not built")
+class TestNativeStatementSpans(unittest.TestCase):
+    def assert_matches_ast(self, source):
+        table = StmtLineTable(source, "<sample>")
+        lines = source.splitlines()
+        for code in _code_objects(compile(source, "<sample>", "exec")):
+            for lineno in _executed_lines(code):
+                native = statement_range(code, lineno, lines)
+                if native is None:
+                    continue
+                expected = table.get_statement_range(lineno) or (lineno, lineno)
+                self.assertEqual(native, expected, f"{code.co_name} line {lineno}: {lines[lineno - 1]!r}")
+
+    def test_matches_ast_table_for_every_executed_line(self):
+        self.assert_matches_ast(SAMPLE_SOURCE)
+
+    def test_matches_ast_table_for_continuation_lines(self):
+        source = SAMPLE_SOURCE.splitlines()
+        table = StmtLineTable(SAMPLE_SOURCE)
+        module = compile(SAMPLE_SOURCE, "<sample>", "exec")
+        for lineno in range(1, len(source) + 1):
+            expected = table.get_statement_range(lineno) or (lineno, lineno)
+            self.assertEqual(statement_range(module, lineno, source), expected, f"line {lineno}")
+
+    def test_table_covers_only_the_code_object(self):
+        lines = SAMPLE_SOURCE.splitlines()
+        codes = _code_objects(compile(SAMPLE_SOURCE, "<sample>", "exec"))
+        func = next(code for code in codes if code.co_name == "my_func")
+        total = func.co_firstlineno + 4
+        self.assertEqual(statement_range(func, total, lines), (total, total + 2))
+        self.assertIsNone(statement_range(func, 1, lines))
+        self.assertIsNone(statement_range(func, len(lines), lines))
+
+    def test_expression_starting_mid_statement_is_unresolved(self):
+        source = textwrap.dedent(
+            """\
+            values = sorted(
+                [3, 1, 2],
+                key=lambda v: -v,
+            )
+            pairs = dict(
+                ((k, v)
+                 for k, v in [(1, 2)]),
+            )
+            first = [i for i in range(3)]
+            """
+        )
+        lines = source.splitlines()
+        codes = {code.co_name: code for code in _code_objects(compile(source, "<sample>", "exec"))}
+        self.assertIsNone(statement_range(codes["<lambda>"], 3, lines))
+        self.assertIsNone(statement_range(codes["<genexpr>"], 6, lines))
+        if "<listcomp>" in codes:  # 3.12 起推导式内联，没有单独的代码对象
+            self.assertEqual(statement_range(codes["<listcomp>"], 9, lines), (9, 9))
+        self.assert_matches_ast(source)
+
+    def test_argument_errors(self):
+        with self.assertRaises(TypeError):
+            statement_range("not code", 1, [])
+        code = compile("x = 1\n", "<sample>", "exec")
+        with self.assertRaises(TypeError):
+            statement_range(code, 1, [b"x = 1"])
+
+
+@unittest.skipIf(statement_range is None, "tracer_core is not built")
+class TestSourceCacheCodePath(unittest.TestCase):
+    def test_code_path_matches_file_path(self):
+        manager = SourceCacheManager()
+        manager.add_source("sample.py", SAMPLE_SOURCE)
+        codes = list(_code_objects(compile(SAMPLE_SOURCE, "sample.py", "exec")))
+        for code in codes:
+            for lineno in _executed_lines(code):
+                expected = manager.get_statement_info("sample.py", lineno)
+                self.assertEqual(manager.get_statement_info("sample.py", lineno, code), expected)
+        self.assertIsNone(manager.get_statement_info("sample.py", 10_000, codes[0]))
+
+    def test_code_path_does_not_parse_the_file(self):
+        manager = SourceCacheManager()
+        manager.add_source("sample.py", SAMPLE_SOURCE)
+        module = compile(SAMPLE_SOURCE, "sample.py", "exec")
+        statement = "\n".join(SAMPLE_SOURCE.splitlines()[10:13])
+        self.assertEqual(manager.get_statement_info("sample.py", 12, module), (statement, 11, 13))
+        self.assertEqual(manager._table_cache, {})
+
+    def test_falls_back_without_native_module(self):
+        manager = SourceCacheManager()
+        manager.add_source("sample.py", SAMPLE_SOURCE)
+        module = compile(SAMPLE_SOURCE, "sample.py", "exec")
+        with patch.object(source_cache, "_native_statement_range", None):
+            self.assertEqual(manager.get_statement_info("sample.py", 6, module)[1:], (6, 10))
+        self.assertIn("sample.py", manager._table_cache)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,342 @@
+import os
+import random
+import shutil
+import struct
+import tempfile
+import threading
+import unittest
+from pathlib import Path
+from unittest import mock
+
+import tree
+from tree import ProjectConfig, PySymbolTrie
+from tree_libs import ast as tree_ast
+
+
+def info(file_path, line=1):
+    return {
+        "file_path": file_path,
+        "signature": "",
+        "full_definition_hash": line * 7,
+        "location": ((line, 0), (line + 2, 1), (line * 10, line * 10 + 30)),
+        "calls": [{"name": "helper", "start_point": (line, 4)}],
+    }
+
+
+class SymbolTrieTests:
+    trie_class = None
+
+    def setUp(self):
+        self.tmp_dir = Path(tempfile.mkdtemp())
+
+    def tearDown(self):
+        shutil.rmtree(self.tmp_dir, ignore_errors=True)
+
+    def test_exact_and_file_alias(self):
+        trie = self.trie_class()
+        trie.insert("Foo.bar", info("src/foo.py", 3))
+        self.assertEqual(trie.search_exact("Foo.bar"), info("src/foo.py", 3))
+        self.assertEqual(trie.search_exact("symbol:src/foo.py/Foo.bar"), info("src/foo.py", 3))
+        self.assertIsNone(trie.search_exact("Foo"))
+        self.assertEqual(trie.size, 2)
+
+    def test_insert_replaces(self):
+        trie = self.trie_class()
+        trie.insert("main", info("a.c", 1))
+        trie.insert("main", info("b.c", 5))
+        self.assertEqual(trie.search_exact("main"), info("b.c", 5))
+        self.assertEqual(trie.search_exact("symbol:a.c/main"), info("a.c", 1))
+        self.assertEqual(trie.size, 3)
+
+    def test_prefix_bfs_order_and_limit(self):
+        trie = self.trie_class()
+        for name in ["abc", "ab", "abd", "b", "abcd", "a"]:
+            trie.insert(f"symbol:x.py/{name}", info("x.py"))
+        names = [item["name"] for item in trie.search_prefix("symbol:x.py/a", use_bfs=True)]
+        self.assertEqual(names, [f"symbol:x.py/{n}" for n in ["a", "ab", "abc", "abd", "abcd"]])
+        limited = trie.search_prefix("symbol:x.py/a", max_results=2, use_bfs=True)
+        self.assertEqual([item["name"] for item in limited], ["symbol:x.py/a", "symbol:x.py/ab"])
+        self.assertEqual(trie.search_prefix("symbol:x.py/c"), [])
+
+    def test_case_insensitive(self):
+        trie = self.trie_class(case_sensitive=False)
+        trie.insert("MyClass", info("m.py"))
+        self.assertEqual(trie.search_exact("myclass"), info("m.py"))
+        self.assertEqual([item["name"] for item in trie.search_prefix("MYC")], ["myclass"])
+
+    def test_from_symbols(self):
+        trie = self.trie_class.from_symbols({"run": [("r.py", "def run()", 42)]})
+        self.assertEqual(
+            trie.search_exact("run"), {"file_path": "r.py", "signature": "def run()", "full_definition_hash": 42}
+        )
+
+
+class TestPySymbolTrie(SymbolTrieTests, unittest.TestCase):
+    trie_class = PySymbolTrie
+
+
+@unittest.skipIf(tree.SymbolTrie is PySymbolTrie, "symbol_core is not built")
+class TestNativeSymbolTrie(SymbolTrieTests, unittest.TestCase):
+    trie_class = tree.SymbolTrie
+
+    def random_symbols(self, count, seed=5):
+        rng = random.Random(seed)
+        symbols = []
+        for i in range(count):
+            name = "".join(rng.choice("abcde_") for _ in range(rng.randrange(1, 9)))
+            symbols.append((name, info(f"pkg/m{rng.randrange(20)}.py", i)))
+        return symbols
+
+    def assert_same(self, native, python):
+        self.assertEqual(native.size, python.size)
+        for prefix in ["", "a", "ab", "symbol:pkg/m1", "symbol:pkg/m1.py/c", "zz"]:
+            self.assertEqual(
+                native.search_prefix(prefix, use_bfs=True), python.search_prefix(prefix, use_bfs=True), prefix
+            )
+            self.assertEqual(
+                native.search_prefix(prefix, max_results=7, use_bfs=True),
+                python.search_prefix(prefix, max_results=7, use_bfs=True),
+            )
+        self.assertEqual(native.to_dict(), python.to_dict())
+
+    def test_matches_python(self):
+        native, python = self.trie_class(), PySymbolTrie()
+        for name, details in self.random_symbols(3000):
+            native.insert(name, details)
+            python.insert(name, details)
+        self.assert_same(native, python)
+        native._index.merge()
+        self.assert_same(native, python)
+        # 合并后继续插入：增量表覆盖基础表
+        for name, details in self.random_symbols(500, seed=9):
+            native.insert(name, details)
+            python.insert(name, details)
+        self.assert_same(native, python)
+
+    def test_save_and_load(self):
+        native, python = self.trie_class(), PySymbolTrie()
+        for name, details in self.random_symbols(1000):
+            native.insert(name, details)
+            python.insert(name, details)
+        path = str(self.tmp_dir / "symbols.idx")
+        native.save(path)
+        loaded = self.trie_class.load(path)
+        self.assertTrue(loaded._index.stats()["mapped"])
+        self.assert_same(loaded, python)
+        loaded.insert("zz_new", info("new.py"))
+        python.insert("zz_new", info("new.py"))
+        self.assert_same(loaded, python)
+
+    def test_rejects_bad_file(self):
+        path = self.tmp_dir / "bad.idx"
+        path.write_bytes(b"not an index at all, definitely not" * 4)
+        with self.assertRaises(ValueError):
+            self.trie_class.load(str(path))
+
+    def saved_index(self):
+        trie = self.trie_class()
+        for name, details in self.random_symbols(300):
+            trie.insert(name, details)
+        path = self.tmp_dir / "symbols.idx"
+        trie.save(str(path))
+        data = path.read_bytes()
+        # Header：魔数、版本、标志、4 个 u64 计数，之后是 10 个 (offset, size) 段
+        sections = [struct.unpack_from("<QQ", data, 48 + 16 * i) for i in range(10)]
+        return path, bytearray(data), sections
+
+    def test_rejects_corrupted_sections(self):
+        path, data, sections = self.saved_index()
+        key_records, length_order, records, file_offsets = sections[2], sections[4], sections[5], sections[7]
+        corruptions = [
+            (key_records[0] + 4 * 7, struct.pack("<I", 1 << 30)),
+            (length_order[0] + 4 * 3, struct.pack("<I", 1 << 30)),
+            (records[0] + 16 * 5, struct.pack("<I", 1 << 20)),  # 文件号
+            (records[0] + 16 * 5 + 4, struct.pack("<I", 1 << 30)),  # 信息长度
+            (records[0] + 16 * 5 + 8, struct.pack("<Q", 1 << 40)),  # 信息偏移
+            (file_offsets[0] + 8, struct.pack("<Q", 1 << 40)),
+            (sections[1][0] + 8, struct.pack("<Q", 1 << 40)),  # block_offsets
+            (16, struct.pack("<Q", 1 << 62)),  # key_count
+        ]
+        for offset, value in corruptions:
+            corrupted = bytearray(data)
+            corrupted[offset : offset + len(value)] = value
+            path.write_bytes(corrupted)
+            with self.subTest(offset=offset), self.assertRaises(ValueError):
+                self.trie_class.load(str(path))
+
+    def test_random_corruption_does_not_crash(self):
+        path, data, _ = self.saved_index()
+        rng = random.Random(11)
+        for _ in range(300):
+            corrupted = bytearray(data)
+            for _ in range(rng.randrange(1, 8)):
+                corrupted[rng.randrange(len(corrupted))] = rng.randrange(256)
+            path.write_bytes(corrupted)
+            try:
+                trie = self.trie_class.load(str(path))
+                trie.search_prefix("", max_results=50)
+                trie.search_prefix("s", use_bfs=True)
+                trie.search_exact("symbol_1")
+                trie.insert("zz_new", info("new.py"))
+                trie.save(str(path) + ".out")
+            except (ValueError, EOFError, TypeError):
+                # 损坏的文件被拒绝，或信息字节无法被 marshal 解码
+                pass
+
+
+class IntervalIndexTests:
+    index_class = None
+
+    def test_stab_matches_scan(self):
+        rng = random.Random(3)
+        for _ in range(50):
+            ranges = []
+            for _ in range(rng.randrange(0, 120)):
+                start = rng.randrange(0, 500)
+                ranges.append((start, start + rng.randrange(0, 80)))
+            index = self.index_class(ranges)
+            self.assertEqual(len(index), len(ranges))
+            for pos in range(0, 600, 3):
+                expected = [i for i, (start, end) in enumerate(ranges) if start <= pos <= end]
+                self.assertEqual(index.stab(pos), expected)
+
+    def test_nested_symbol_ranges(self):
+        index = self.index_class([(0, 100), (10, 40), (20, 30), (50, 90), (40, 40)])
+        self.assertEqual(index.stab(25), [0, 1, 2])
+        self.assertEqual(index.stab(40), [0, 1, 4])
+        self.assertEqual(index.stab(95), [0])
+        self.assertEqual(index.stab(101), [])
+
+
+class TestPyIntervalIndex(IntervalIndexTests, unittest.TestCase):
+    index_class = tree_ast.PyIntervalIndex
+
+
+@unittest.skipIf(tree_ast.IntervalIndex is tree_ast.PyIntervalIndex, "symbol_core is not built")
+class TestNativeIntervalIndex(IntervalIndexTests, unittest.TestCase):
+    index_class = tree_ast.IntervalIndex
+
+    def test_out_of_range_positions(self):
+        index = self.index_class([(0, 10)])
+        self.assertEqual(index.stab(-1), [])
+        self.assertEqual(index.stab(1 << 70), [])
+
+
+class TestCodeMapIndexCache(unittest.TestCase):
+    @staticmethod
+    def entry(start, end):
+        return {
+            "type": "function",
+            "start_line": start,
+            "start_col": 0,
+            "end_line": end,
+            "end_col": 0,
+            "block_range": (start * 10, end * 10),
+        }
+
+    def test_in_place_range_change_rebuilds_index(self):
+        builder = tree_ast.CodeMapBuilder(None, None)
+        code_map = {"a": self.entry(1, 5), "b": self.entry(6, 9)}
+        self.assertEqual([m["symbol"] for m in builder.find_symbols_by_location(code_map, 7, 0)], ["b"])
+        self.assertEqual([m["symbol"] for m in builder.find_symbols_by_offset(code_map, 70)], ["b"])
+        code_map["a"].update(self.entry(1, 8))
+        code_map["b"].update(self.entry(20, 30))
+        self.assertEqual([m["symbol"] for m in builder.find_symbols_by_location(code_map, 7, 0)], ["a"])
+        self.assertEqual([m["symbol"] for m in builder.find_symbols_by_offset(code_map, 70)], ["a"])
+
+
+class FakeParserUtil:
+    """每个文件的每一行作为一个符号，替代 tree-sitter 解析"""
+
+    parsed = []
+
+    def __init__(self, parser_loader):
+        pass
+
+    def update_symbol_trie(self, file_path, trie):
+        self.parsed.append(Path(file_path).name)
+        for line, name in enumerate(Path(file_path).read_text().split(), 1):
+            trie.insert(name, info(file_path, line))
+
+
+@unittest.skipIf(tree.SymbolTrie is PySymbolTrie, "symbol_core is not built")
+class TestPersistentSymbolIndex(unittest.TestCase):
+    def setUp(self):
+        self.root = Path(tempfile.mkdtemp())
+        (self.root / "build").mkdir()
+        (self.root / "a.py").write_text("alpha\nbeta\n")
+        (self.root / "b.py").write_text("gamma\n")
+        (self.root / "build" / "gen.py").write_text("skipped\n")
+        (self.root / "notes.txt").write_text("ignored\n")
+        self.config = ProjectConfig(
+            project_root_dir=str(self.root),
+            exclude={"dirs": ["build"], "files": []},
+            include={"dirs": [], "files": []},
+            file_types=[".py"],
+        )
+        self.index_path = str(self.root / "symbols.idx")
+        FakeParserUtil.parsed = []
+        patcher = mock.patch.multiple(tree, ParserUtil=FakeParserUtil, ParserLoader=mock.MagicMock())
+        patcher.start()
+        self.addCleanup(patcher.stop)
+
+    def tearDown(self):
+        shutil.rmtree(self.root, ignore_errors=True)
+
+    def build(self):
+        FakeParserUtil.parsed = []
+        tree.build_symbol_index(self.config, self.index_path)
+        return sorted(FakeParserUtil.parsed)
+
+    def test_only_changed_files_are_reparsed(self):
+        self.assertEqual(self.build(), ["a.py", "b.py"])
+        trie = tree.open_symbol_index(self.index_path)
+        self.assertEqual(sorted(trie.manifest), ["a.py", "b.py"])
+        self.assertEqual(trie.search_exact("beta")["location"][0], (2, 0))
+        self.assertEqual(self.build(), [])
+
+        # mtime 变化但内容相同：只更新 manifest
+        os.utime(self.root / "a.py", (1, 1))
+        self.assertEqual(self.build(), [])
+        self.assertEqual(tree.open_symbol_index(self.index_path).manifest["a.py"][0], 1)
+
+        (self.root / "b.py").write_text("gamma\ndelta\n")
+        (self.root / "c.py").write_text("epsilon\n")
+        self.assertEqual(self.build(), ["b.py", "c.py"])
+        trie = tree.open_symbol_index(self.index_path)
+        self.assertIsNotNone(trie.search_exact("delta"))
+        self.assertIsNotNone(trie.search_exact("epsilon"))
+        self.assertIsNone(trie.search_exact("skipped"))
+
+    def test_service_swaps_in_refreshed_index(self):
+        from tree_libs import app
+
+        self.build()
+        (self.root / "c.py").write_text("epsilon\n")
+        started = threading.Event()
+        refresh = app.refresh_symbol_index
+
+        def delayed_refresh(trie, config):
+            started.wait(10)
+            return refresh(trie, config)
+
+        state = app.WebServiceState(self.config)
+        with mock.patch.object(app, "refresh_symbol_index", delayed_refresh):
+            thread = state.load_symbol_index(self.index_path)
+            mapped = state.symbol_trie
+            started.set()
+            thread.join(10)
+        # 后台刷新不修改已发布的符号表，完成后整体替换
+        self.assertIsNone(mapped.search_exact("epsilon"))
+        self.assertIsNot(state.symbol_trie, mapped)
+        self.assertIsNotNone(state.symbol_trie.search_exact("epsilon"))
+        self.assertEqual([p.name for p in self.root.iterdir() if p.name.startswith("symbols.idx.")], [])
+
+    def test_unreadable_index_is_rebuilt(self):
+        Path(self.index_path).write_bytes(b"TRSYMIX1" + bytes(64))
+        self.assertEqual(len(tree.open_symbol_index(self.index_path).manifest), 0)
+        self.assertEqual(self.build(), ["a.py", "b.py"])
+
+
+if __name__ == "__main__":
+    unittest.main()
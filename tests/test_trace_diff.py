@@ -0,0 +1,222 @@
+import contextlib
+import io
+import shutil
+import tempfile
+import unittest
+from pathlib import Path
+from unittest import mock
+
+from debugger import trace_diff
+from debugger.seekable_log import SeekableLogWriter
+from debugger.trace_diff import diff_traces
+
+BASE = """\
+↘ MODULE app.py:0 <module>() [frame:1][thread:100]
+  ▷ app.py:10 handle(2)
+  ↘ CALL app.py:5 handle(n=2) [frame:2][thread:100]
+    ▷ app.py:6 x = parse(n)
+    ↘ CALL app.py:1 parse(n=2) [frame:3][thread:100]
+      ▷ app.py:2 if n > 1:
+      ▷ app.py:3 return n
+    ↗ RETURN app.py parse() → 2 [frame:3]
+    ▷ app.py:7 return x
+  ↗ RETURN app.py handle() → 2 [frame:2]
+  ▷ app.py:11 done(obj)
+  ↘ CALL app.py:20 done(o=<Obj object at 0x7f00aa>) [frame:4][thread:100]
+    ▷ app.py:21 pass
+  ↗ RETURN app.py done() → None [frame:4]
+↗ RETURN app.py <module>() → None [frame:1]
+"""
+
+MODULE = "app.py:0 <module>"
+HANDLE = "app.py:5 handle"
+
+
+def renumber(text, thread="300", address="0x7f55bb"):
+    """The same run as another process would log it."""
+    for frame in range(4, 0, -1):
+        text = text.replace(f"[frame:{frame}]", f"[frame:{frame + 40}]")
+    return text.replace("[thread:100]", f"[thread:{thread}]").replace("0x7f00aa", address)
+
+
+class TraceDiffTests:
+    split_threads = None
+    diff_streams = None
+
+    def setUp(self):
+        self.tmp_dir = Path(tempfile.mkdtemp())
+        for name, impl in (("split_trace_threads", self.split_threads), ("diff_trace_streams", self.diff_streams)):
+            patcher = mock.patch.object(trace_diff, name, impl)
+            patcher.start()
+            self.addCleanup(patcher.stop)
+
+    def tearDown(self):
+        shutil.rmtree(self.tmp_dir, ignore_errors=True)
+
+    def write(self, name, text):
+        path = self.tmp_dir / name
+        path.write_text(text, encoding="utf-8")
+        return path
+
+    def diff(self, text_a, text_b):
+        return diff_traces(self.write("a.log", text_a), self.write("b.log", text_b))
+
+    def test_ignores_frame_thread_ids_and_addresses(self):
+        diff = self.diff(BASE, renumber(BASE))
+        self.assertTrue(diff.identical)
+        self.assertIsNone(diff.first)
+        self.assertEqual(diff.matched, 15)
+        self.assertEqual(diff.threads, (1, 1))
+
+    def test_branch_skips_common_frame_and_realigns(self):
+        bad = renumber(BASE).replace("▷ app.py:3 return n", "▷ app.py:4 return 0").replace("parse() → 2", "parse() → 0")
+        bad = bad.replace("handle() → 2", "handle() → 0")
+        diff = self.diff(BASE, bad)
+        first = diff.first
+        self.assertEqual(first.kind, "branch")
+        self.assertEqual(first.path, (MODULE, HANDLE, "app.py:1 parse"))
+        self.assertEqual((first.a.lineno, first.a.text), (7, "▷ app.py:3 return n"))
+        self.assertEqual(first.a.depth, 3)
+        self.assertEqual(first.b.text, "▷ app.py:4 return 0")
+        self.assertEqual((first.a_events, first.b_events), (2, 2))
+        # parse 之后重新对齐，handle 的返回值不同
+        self.assertEqual(dict(diff.counts), {"branch": 1, "return": 1})
+        self.assertEqual(diff.divergences[1].path, (MODULE, HANDLE))
+        self.assertEqual(diff.divergences[1].b.text, "↗ RETURN app.py handle() → 0")
+        self.assertEqual(diff.subtrees[(f"{MODULE} > {HANDLE}", "return")], 1)
+
+    def test_different_callee_keeps_call_order(self):
+        bad = renumber(BASE).replace("CALL app.py:1 parse(n=2)", "CALL app.py:30 check(n=2)")
+        bad = bad.replace("RETURN app.py parse()", "RETURN app.py check()")
+        diff = self.diff(BASE, bad)
+        self.assertEqual(dict(diff.counts), {"call": 1})
+        first = diff.first
+        self.assertEqual(first.path, (MODULE, HANDLE))
+        self.assertEqual(first.b.text, "↘ CALL app.py:30 check(n=2)")
+        self.assertEqual((first.a_events, first.b_events), (4, 4))
+        self.assertEqual(diff.matched, 11)
+
+    def test_same_function_with_other_arguments_is_compared_inside(self):
+        bad = renumber(BASE).replace("parse(n=2)", "parse(n=3)").replace("parse() → 2", "parse() → 3")
+        diff = self.diff(BASE, bad)
+        self.assertEqual([d.kind for d in diff.divergences], ["call", "return"])
+        self.assertEqual(diff.divergences[1].path, (MODULE, HANDLE, "app.py:1 parse"))
+
+    def test_exception_on_one_side(self):
+        bad = renumber(BASE).replace(
+            "      ▷ app.py:3 return n\n",
+            "      ▷ app.py:3 return n\n    ⚠ EXCEPTION IN parse AT app.py:3 ValueError: n [frame:43]\n",
+        )
+        diff = self.diff(BASE, bad)
+        self.assertEqual(diff.first.kind, "exception")
+        self.assertEqual(diff.first.path, (MODULE, HANDLE, "app.py:1 parse"))
+        self.assertEqual((diff.first.a_events, diff.first.b_events), (1, 2))
+        self.assertEqual(dict(diff.counts), {"exception": 1})
+
+    def test_truncated_log(self):
+        lines = renumber(BASE).splitlines(keepends=True)
+        diff = self.diff(BASE, "".join(lines[:9]))
+        self.assertEqual(diff.first.kind, "missing")
+        self.assertIsNone(diff.first.b)
+        self.assertEqual(diff.first.a.text, "↗ RETURN app.py handle() → 2")
+        self.assertEqual((diff.first.a_events, diff.first.b_events), (6, 0))
+
+    def test_threads_are_paired_by_first_appearance(self):
+        worker = (
+            "↘ CALL app.py:40 work() [frame:9][thread:200]\n"
+            "  ▷ app.py:41 return 1\n"
+            "↗ RETURN app.py work() → 1 [frame:9]\n"
+        )
+        base, other = BASE.splitlines(keepends=True), renumber(BASE).splitlines(keepends=True)
+        # B 中工作线程的事件与主线程交错的位置不同，返回值也不同
+        other_worker = worker.replace("[thread:200]", "[thread:400]").replace("→ 1", "→ 2")
+        text_a = "".join(base[:2]) + worker + "".join(base[2:])
+        text_b = "".join(other[:4]) + other_worker + "".join(other[4:])
+        diff = self.diff(text_a, text_b)
+        self.assertEqual(diff.threads, (2, 2))
+        self.assertEqual(dict(diff.counts), {"return": 1})
+        self.assertEqual(diff.first.thread, 1)
+        self.assertEqual(diff.first.path, ("app.py:40 work",))
+        self.assertEqual(diff.matched, 15 + 2)
+
+    def test_var_trace_order_is_ignored(self):
+        def var_trace(order):
+            text = BASE.replace("▷ app.py:7 return x", "▷ app.py:7 return x # Debug: " + ", ".join(order))
+            return text.replace("parse() → 2 [frame:3]", "parse() → 2 [frame:3] # Debug: " + ", ".join(order[::-1]))
+
+        names = ["x=[1, 2]", "n=2", "obj=<Obj object at 0x7f00aa>"]
+        diff = self.diff(var_trace(names), renumber(var_trace(names[::-1])))
+        self.assertTrue(diff.identical)
+        self.assertEqual(diff.matched, 15)
+
+        diff = self.diff(var_trace(names), var_trace(["x=[1, 3]", "n=2", names[2]]))
+        self.assertEqual(dict(diff.counts), {"return": 1, "branch": 1})
+        self.assertEqual(
+            diff.first.a.text, "↗ RETURN app.py parse() → 2 # Debug: n=2, obj=<Obj object at 0x?>, x=[1, 2]"
+        )
+
+    def test_lines_follow_the_thread_at_their_depth(self):
+        worker = (
+            "↘ CALL app.py:40 work() [frame:9][thread:200]\n"
+            "  ▷ app.py:41 return 1\n"
+            "↗ RETURN app.py work() → 1 [frame:9]\n"
+        )
+        base, other = BASE.splitlines(keepends=True), renumber(BASE).splitlines(keepends=True)
+        # 工作线程返回后的 ▷ 行没有线程标记，按深度归回主线程
+        text_a = "".join(base[:6]) + worker + "".join(base[6:])
+        text_b = "".join(other[:1]) + worker.replace("[thread:200]", "[thread:400]") + "".join(other[1:])
+        diff = self.diff(text_a, text_b)
+        self.assertTrue(diff.identical)
+        self.assertEqual(diff.threads, (2, 2))
+        self.assertEqual(diff.matched, 15 + 3)
+
+    def test_each_log_is_read_once(self):
+        worker = "↘ CALL app.py:40 work() [frame:9][thread:{}]\n↗ RETURN app.py work() → 1 [frame:9]\n"
+        base = BASE.splitlines(keepends=True)
+        text = "".join(base[:2]) + "".join(worker.format(200 + i) for i in range(3)) + "".join(base[2:])
+        a, b = self.write("a.log", text), self.write("b.log", renumber(text))
+        with mock.patch.object(trace_diff, "open_log", wraps=trace_diff.open_log) as opened:
+            diff = diff_traces(a, b)
+        self.assertEqual(sorted(call.args[0].name for call in opened.call_args_list), ["a.log", "b.log"])
+        self.assertTrue(diff.identical)
+        self.assertEqual(diff.threads, (4, 4))
+        self.assertEqual(diff.matched, 15 + 6)
+
+    def test_compressed_log(self):
+        path = self.tmp_dir / "b.log.z"
+        with SeekableLogWriter(path, frame_size=64) as writer:
+            writer.write(renumber(BASE))
+        diff = diff_traces(self.write("a.log", BASE), path)
+        self.assertTrue(diff.identical)
+        self.assertEqual(diff.matched, 15)
+
+    def test_cli_exit_code(self):
+        a = self.write("a.log", BASE)
+        b = self.write("b.log", renumber(BASE).replace("done() → None", "done() → 1"))
+        output = io.StringIO()
+        with contextlib.redirect_stdout(output):
+            self.assertEqual(trace_diff.main([str(a), str(a)]), 0)
+            self.assertEqual(trace_diff.main([str(a), str(b), "--json"]), 1)
+        self.assertIn('"return": 1', output.getvalue())
+
+
+class TestPyTraceDiff(TraceDiffTests, unittest.TestCase):
+    split_threads = staticmethod(trace_diff._py_split_threads)
+    diff_streams = staticmethod(trace_diff._py_diff_streams)
+
+
+@unittest.skipIf(trace_diff.diff_trace_streams is trace_diff._py_diff_streams, "tracer_core is not built")
+class TestNativeTraceDiff(TraceDiffTests, unittest.TestCase):
+    split_threads = staticmethod(trace_diff.split_trace_threads)
+    diff_streams = staticmethod(trace_diff.diff_trace_streams)
+
+
+class TestMixedTraceDiff(TraceDiffTests, unittest.TestCase):
+    """Spill files written by one implementation are read by the other."""
+
+    split_threads = staticmethod(trace_diff._py_split_threads)
+    diff_streams = staticmethod(trace_diff.diff_trace_streams)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,170 @@
+import json
+import shutil
+import tempfile
+import threading
+import unittest
+import urllib.request
+from pathlib import Path
+from unittest.mock import patch
+
+from debugger import trace_pager
+from debugger.trace_pager import TracePager, make_server
+
+
+class TraceLogWriter:
+    """Writes a log and its .index the way TraceLogic._file_output does."""
+
+    def __init__(self, log_file: Path):
+        self.log_file = log_file
+        self.log = open(log_file, "w", encoding="utf-8")
+        self.index = open(f"{log_file}.index", "w", encoding="utf-8")
+        self.depth = 0
+
+    def _entry(self, entry_type, frame_id, position):
+        entry = {"type": entry_type, "filename": "/tmp/a.py", "lineno": 1, "frame_id": frame_id}
+        entry.update({"position": position, "func": "f", "parent_frame_id": 0})
+        self.index.write(json.dumps(entry) + "\n")
+
+    def call(self, frame_id, name):
+        self._entry("call", frame_id, self.log.tell())
+        self.log.write(f"{'  ' * self.depth}↘ CALL a.py:1 {name}() [frame:{frame_id}]\n")
+        self.depth += 1
+
+    def line(self, text):
+        self.log.write(f"{'  ' * self.depth}▷ a.py:2 {text}\n")
+
+    def ret(self, frame_id, name):
+        self.depth -= 1
+        self.log.write(f"{'  ' * self.depth}↗ RETURN a.py {name}() → None [frame:{frame_id}]\n")
+        self._entry("return", frame_id, self.log.tell())
+
+    def close(self):
+        self.log.close()
+        self.index.close()
+
+
+class TestTracePager(unittest.TestCase):
+    def setUp(self):
+        self.tmp_dir = Path(tempfile.mkdtemp())
+        self.log_file = self.tmp_dir / "trace.log"
+        writer = TraceLogWriter(self.log_file)
+        writer.line("x = 1")
+        writer.call(1, "main")
+        writer.line("main body")
+        for i in range(5):
+            writer.call(10 + i, f"child{i}")
+            writer.line(f"child{i} body")
+            if i == 2:
+                writer.call(100, "grandchild")
+                writer.line("needle here")
+                writer.ret(100, "grandchild")
+            writer.ret(10 + i, f"child{i}")
+        writer.ret(1, "main")
+        writer.call(2, "unfinished")
+        writer.line("still running")
+        writer.close()
+
+    def tearDown(self):
+        shutil.rmtree(self.tmp_dir, ignore_errors=True)
+
+    def open_pager(self):
+        pager = TracePager(self.log_file)
+        self.addCleanup(pager.close)
+        return pager
+
+    def test_native_and_python_builders_agree(self):
+        if trace_pager._native_build_frame_index is None:
+            self.skipTest("tracer_core is not built")
+        size = self.log_file.stat().st_size
+        index_file = f"{self.log_file}.index"
+        trace_pager.build_frame_index(index_file, self.tmp_dir / "native.frames", size)
+        trace_pager._build_frame_index_py(index_file, str(self.tmp_dir / "python.frames"), size)
+        self.assertEqual((self.tmp_dir / "native.frames").read_bytes(), (self.tmp_dir / "python.frames").read_bytes())
+
+    def test_top_level_and_subtree_pages(self):
+        pager = self.open_pager()
+        top = pager.page()
+        self.assertEqual([item["type"] for item in top["items"]], ["line", "frame", "frame"])
+        main, unfinished = top["items"][1:]
+        self.assertEqual((main["children"], main["descendants"], main["status"]), (5, 6, "returned"))
+        self.assertIn("RETURN a.py main()", main["close"])
+        self.assertEqual((unfinished["status"], unfinished["close"]), ("open", None))
+        self.assertIsNone(top["next"])
+
+        body = pager.page(main["id"])
+        self.assertEqual(body["items"][0]["text"], "  ▷ a.py:2 main body")
+        self.assertEqual([item["call"].strip() for item in body["items"][1:]][2], "↘ CALL a.py:1 child2() [frame:12]")
+        child2 = body["items"][3]
+        self.assertEqual(child2["children"], 1)
+        self.assertEqual([item.get("text", item.get("call")).strip() for item in pager.page(child2["id"])["items"]],
+                         ["▷ a.py:2 child2 body", "↘ CALL a.py:1 grandchild() [frame:100]"])  # fmt: skip
+        self.assertEqual(pager.page(unfinished["id"])["items"][0]["text"].strip(), "▷ a.py:2 still running")
+
+    def test_pages_follow_cursor(self):
+        pager = self.open_pager()
+        main = pager.page()["items"][1]
+        seen = []
+        cursor = None
+        while True:
+            page = pager.page(main["id"], cursor, limit=2)
+            self.assertLessEqual(len(page["items"]), 2)
+            seen.extend(page["items"])
+            if page["next"] is None:
+                break
+            cursor = page["next"]
+        self.assertEqual(seen, pager.page(main["id"])["items"])
+
+    def test_search_returns_levels_to_expand(self):
+        pager = self.open_pager()
+        result = pager.search("needle")
+        levels = result["levels"]
+        self.assertEqual(len(levels), 4)  # 顶层 -> main -> child2 -> grandchild
+        last = pager.page(levels[-1]["node"], levels[-1]["cursor"], limit=1)
+        self.assertIn("needle here", last["items"][0]["text"])
+        for parent, child in zip(levels, levels[1:]):
+            first = pager.page(parent["node"], parent["cursor"], limit=1)["items"][0]
+            self.assertEqual(first["id"], child["node"])
+        self.assertIsNone(pager.search("needle", result["next"]))
+
+        # 命中 call 行时定位到父节点中的帧条目
+        call_hit = pager.search("child3()")
+        self.assertEqual(pager.page(**call_hit["levels"][-1], limit=1)["items"][0]["call"].strip()[:24],
+                         "↘ CALL a.py:1 child3() [")  # fmt: skip
+
+    def test_index_is_reused_until_the_log_changes(self):
+        self.open_pager()
+        frames_file = Path(f"{self.log_file}.frames")
+        self.assertTrue(frames_file.exists())
+        with patch.object(trace_pager, "build_frame_index", side_effect=AssertionError("rebuilt")):
+            self.assertEqual(self.open_pager().index.count, 8)
+        with open(self.log_file, "a", encoding="utf-8") as f:
+            f.write("  ▷ a.py:3 appended\n")
+        self.assertEqual(self.open_pager().page()["items"][-1]["status"], "open")
+
+    def test_summary_log_is_relative_to_project_root(self):
+        with patch.object(trace_pager, "_PROJECT_ROOT", self.tmp_dir.resolve()):
+            self.assertEqual(self.open_pager().summary()["log"], "trace.log")
+
+    def test_http_endpoint(self):
+        server = make_server(self.log_file)
+        self.addCleanup(server.pager.close)
+        self.addCleanup(server.server_close)
+        threading.Thread(target=server.serve_forever, daemon=True).start()
+        self.addCleanup(server.shutdown)
+        base = f"http://127.0.0.1:{server.server_address[1]}"
+
+        def get(path):
+            with urllib.request.urlopen(base + path, timeout=5) as response:
+                return response.read().decode("utf-8")
+
+        self.assertEqual(json.loads(get("/api/summary"))["frames"], 8)
+        page = json.loads(get("/api/page?node=0&limit=3"))
+        self.assertEqual(len(page["items"]), 3)
+        self.assertIn("trace_viewer.js", get("/"))
+        self.assertIn("PagedTraceViewer", get("/static/js/trace_viewer.js"))
+        with self.assertRaises(urllib.error.HTTPError):
+            get("/static/../../trace_pager.py")
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,107 @@
+import base64
+import json
+import re
+import shutil
+import tempfile
+import unittest
+from pathlib import Path
+from types import SimpleNamespace
+from unittest.mock import patch
+
+from debugger import tracer_html
+from debugger.line_bitmap import decode_runs
+from debugger.tracer_common import TraceTypes
+from debugger.tracer_html import CallTreeHtmlRender
+
+CALL = "{indent}↘ CALL {filename}:{lineno} {func}() [frame:{frame_id}]"
+LINE = "{indent}▷ {filename}:{lineno} {line}"
+RETURN = "{indent}↗ RETURN {filename} {func}() [frame:{frame_id}]"
+
+
+class TestStreamingHtmlReport(unittest.TestCase):
+    def setUp(self):
+        self.tmp_dir = Path(tempfile.mkdtemp())
+        self.log_dir = self.tmp_dir / "logs"
+        patcher = patch.object(tracer_html, "_LOG_DIR", self.log_dir)
+        patcher.start()
+        self.addCleanup(patcher.stop)
+        self.source_file = self.tmp_dir / "sample.py"
+        self.source_file.write_text("def f():\n    x = 1\n    return x\n", encoding="utf-8")
+        self.render = CallTreeHtmlRender(SimpleNamespace(config=SimpleNamespace(target_script=None)))
+        self.addCleanup(self.render.close)
+        self.idx = 0
+
+    def tearDown(self):
+        shutil.rmtree(self.tmp_dir, ignore_errors=True)
+
+    def emit(self, template, color_type, **data):
+        self.idx += 1
+        data.setdefault("indent", "")
+        data.setdefault("filename", "sample.py")
+        data.setdefault("func", "f")
+        data["original_filename"] = str(self.source_file)
+        self.render.add_raw_message({"idx": self.idx, "template": template, "data": data}, color_type)
+        return self.idx
+
+    def trace_call(self, frame_id):
+        self.emit(CALL, TraceTypes.COLOR_CALL, lineno=1, frame_id=frame_id)
+        line_idx = self.emit(LINE, TraceTypes.COLOR_LINE, lineno=2, line="x = 1", frame_id=frame_id)
+        self.render.add_stack_variable_create(line_idx, 0, "x", 1)
+        self.emit(LINE, TraceTypes.COLOR_LINE, lineno=3, line="return x", frame_id=frame_id)
+        self.emit(RETURN, TraceTypes.COLOR_RETURN, frame_id=frame_id)
+
+    def test_memory_is_drained_as_frames_return(self):
+        for frame_id in range(1, 201):
+            self.trace_call(frame_id)
+        # 只有最后一条消息在等待后续消息，已返回的帧不再占内存
+        self.assertLessEqual(len(self.render._pending), 1)
+        self.assertEqual(self.render._frame_lines, {})
+        self.assertEqual(self.render._stack_variables, {})
+        self.assertEqual(self.render._message_count, 799)
+        self.assertGreater((self.render._work_dir / "body.html").stat().st_size, 0)
+
+    def test_saved_report_references_chunks(self):
+        self.trace_call(1)
+        self.trace_call(CallTreeHtmlRender.LINE_CHUNK_FRAMES + 1)
+        report = self.render.save_to_file("report.html", is_multi_threaded=False)
+
+        html = report.read_text(encoding="utf-8")
+        self.assertEqual(report, self.log_dir / "report.html")
+        self.assertIn('window.traceChunkBase = "report_files/";', html)
+        self.assertIn(f"window.traceSourceChunks = {json.dumps({str(self.source_file): 0})};", html)
+        self.assertEqual(html.count('class="foldable call"'), 2)
+        self.assertIn("x=1", html)
+        self.assertIn("<p>Total messages: 8</p>", html)
+
+        chunk_dir = self.log_dir / "report_files"
+        self.assertEqual(sorted(p.name for p in chunk_dir.iterdir()), ["lines_0.js", "lines_1.js", "source_0.js"])
+        source_chunk = (chunk_dir / "source_0.js").read_text(encoding="utf-8")
+        filename, content = json.loads("[" + re.fullmatch(r"TraceChunks\.source\((.*)\);\n", source_chunk)[1] + "]")
+        self.assertEqual(filename, str(self.source_file))
+        self.assertEqual(base64.b64decode(content), self.source_file.read_bytes())
+        lines_chunk = (chunk_dir / "lines_1.js").read_text(encoding="utf-8")
+        frames = json.loads(re.fullmatch(r"TraceChunks\.lines\((.*)\);\n", lines_chunk)[1])
+        encoded = frames[str(self.source_file)][str(CallTreeHtmlRender.LINE_CHUNK_FRAMES + 1)]
+        self.assertEqual(decode_runs(base64.b64decode(encoded)), [2, 3])
+        # 工作目录已清理
+        self.assertEqual([p.name for p in self.log_dir.iterdir() if p.name.startswith(".report_")], [])
+
+    def test_multi_threaded_report_directory(self):
+        self.trace_call(1)
+        report = self.render.save_to_file("mt.html", is_multi_threaded=True)
+        html = report.read_text(encoding="utf-8")
+        self.assertEqual(report.name, "report.html")
+        self.assertTrue((report.parent / "report_files" / "lines_0.js").exists())
+        self.assertIn('src="tracer_scripts.js"', html)
+        self.assertIn('href="tracer_styles.css"', html)
+
+    def test_messages_after_save_are_ignored(self):
+        self.trace_call(1)
+        self.render.save_to_file("report.html", is_multi_threaded=False)
+        self.trace_call(2)
+        self.assertIsNone(self.render._work_dir)
+        self.assertEqual([p.name for p in self.log_dir.iterdir() if p.name.startswith(".report_")], [])
+
+
+if __name__ == "__main__":
+    unittest.main()
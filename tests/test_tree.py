@@ -32,6 +32,7 @@ from tree_libs.ast import (
     ParserLoader,
     ParserUtil,
     SourceSkeleton,
+    compute_source_edit,
     parse_code_file,
     split_source,
 )
@@ -1458,6 +1459,160 @@ class TestGoTypeAndFunctionAndMethod(TestParserUtil):
         self.assertIn("func Function3(param string) {}", code_map["main.Function3"]["code"])
 
 
+class TestIncrementalSymbolPaths(unittest.TestCase):
+    """update_symbol_paths 增量解析的结果应与完整解析相同，且只报告变化的符号"""
+
+    FIELDS = ("code", "type", "block_range", "start_line", "start_col", "end_line", "end_col", "calls")
+
+    def setUp(self):
+        self.tmp_dir = tempfile.mkdtemp()
+
+    def tearDown(self):
+        shutil.rmtree(self.tmp_dir, ignore_errors=True)
+
+    def assert_same_as_full_parse(self, parser_util, path, source):
+        paths, code_map, changed = parser_util.update_symbol_paths(path, source)
+        expected_paths, expected = ParserUtil(ParserLoader()).get_symbol_paths(path, source_code=source)
+        self.assertEqual(sorted(paths), sorted(set(expected_paths)))
+        self.assertEqual(
+            {key: tuple(entry[name] for name in self.FIELDS) for key, entry in code_map.items()},
+            {key: tuple(entry[name] for name in self.FIELDS) for key, entry in expected.items()},
+        )
+        return changed
+
+    def run_edits(self, suffix, source, edits):
+        path = os.path.join(self.tmp_dir, f"sample{suffix}")
+        Path(path).write_bytes(source)
+        parser_util = ParserUtil(ParserLoader())
+        parser_util.get_symbol_paths(path)
+        changes = []
+        for old, new in edits:
+            self.assertIn(old, source)
+            source = source.replace(old, new, 1)
+            changes.append(self.assert_same_as_full_parse(parser_util, path, source))
+        return changes
+
+    def test_python_edits(self):
+        source = dedent(
+            """
+            import os
+
+            # first helper
+            def first():
+                return os.getcwd()
+
+            @decorator
+            def second(value: Custom):
+                first()
+                return value
+
+            class Holder:
+                def method(self):
+                    second(1)
+
+            def last():
+                pass
+            """
+        ).encode()
+        changes = self.run_edits(
+            ".py",
+            source,
+            [
+                (b"second(1)", b"second(2)\n        first()"),
+                (b"# first helper", b"# the first helper"),
+                (b"@decorator", b"@other_decorator"),
+                (b"def last():\n    pass\n", b""),
+                (b"import os\n", b"import os\nimport sys\n"),
+                (b"class Holder:", b"class Holder(Base):"),
+            ],
+        )
+        # 只改 Holder.method 内部：前面的 first、second 不在变化列表中
+        self.assertIn("Holder.method", changes[0])
+        self.assertNotIn("first", changes[0])
+        self.assertNotIn("second", changes[0])
+        self.assertIn("first", changes[1])
+        self.assertIn("second", changes[2])
+
+    def test_cpp_edits_with_overloads(self):
+        source = dedent(
+            """
+            namespace ns {
+            int helper(int v) { return v; }
+            class Widget {
+            public:
+                Widget() {}
+                Widget(int v) { helper(v); }
+                void draw() { helper(1); }
+            };
+            }
+            int main() { return ns::helper(0); }
+            """
+        ).encode()
+        self.run_edits(
+            ".cpp",
+            source,
+            [
+                (b"helper(1);", b"helper(1);\n        helper(2);"),
+                (b"int helper(int v)", b"\nint helper(int v)"),
+                (b"Widget() {}", b""),
+                (b"return ns::helper(0);", b"return 1;"),
+            ],
+        )
+
+    def test_unchanged_source_reports_nothing(self):
+        path = os.path.join(self.tmp_dir, "same.py")
+        Path(path).write_text("def f():\n    pass\n")
+        parser_util = ParserUtil(ParserLoader())
+        paths, code_map, changed = parser_util.update_symbol_paths(path)
+        self.assertEqual(changed, ["f"])
+        self.assertEqual(parser_util.update_symbol_paths(path)[2], [])
+
+    def test_compute_source_edit(self):
+        self.assertIsNone(compute_source_edit(b"abc", b"abc"))
+        edit = compute_source_edit(b"a\nbc\nd", b"a\nbXYc\nd")
+        self.assertEqual((edit["start_byte"], edit["old_end_byte"], edit["new_end_byte"]), (3, 3, 5))
+        self.assertEqual((edit["start_point"], edit["old_end_point"], edit["new_end_point"]), ((1, 1), (1, 1), (1, 3)))
+
+
+class TestSymbolRangeIndex(unittest.TestCase):
+    """行、偏移查询走区间索引，语法树或 code_map 更新后索引随之重建"""
+
+    def setUp(self):
+        self.tmp_dir = tempfile.mkdtemp()
+        self.path = os.path.join(self.tmp_dir, "sample.py")
+        self.source = "class Holder:\n    def method(self):\n        return 1\n\ndef last():\n    pass\n"
+        Path(self.path).write_text(self.source)
+        self.parser_util = ParserUtil(ParserLoader())
+
+    def tearDown(self):
+        shutil.rmtree(self.tmp_dir, ignore_errors=True)
+
+    def test_location_and_offset_lookups(self):
+        _, code_map = self.parser_util.get_symbol_paths(self.path)
+        offset = self.source.index("return 1")
+        by_offset = [item["symbol"] for item in self.parser_util.find_symbols_by_offset(code_map, offset)]
+        by_location = [item["symbol"] for item in self.parser_util.find_symbols_by_location(code_map, 2, 8)]
+        self.assertEqual(by_offset, ["Holder.method", "Holder"])
+        self.assertEqual(by_location, by_offset)
+        self.assertEqual(self.parser_util.find_symbols_by_offset(code_map, -1), [])
+
+        source = "import os\n" + self.source
+        _, code_map, _ = self.parser_util.update_symbol_paths(self.path, source.encode())
+        offset = source.index("pass")
+        self.assertEqual([item["symbol"] for item in self.parser_util.find_symbols_by_offset(code_map, offset)], ["last"])
+
+    def test_symbol_at_line_follows_edits(self):
+        self.parser_util.get_symbol_paths(self.path)
+        builder = self.parser_util.code_map_builder
+        self.assertEqual(builder.symbol_at_line(0).type, "class_definition")
+        self.assertEqual(builder.symbol_at_line(4).type, "function_definition")
+        self.assertIsNone(builder.symbol_at_line(3))
+        self.parser_util.update_symbol_paths(self.path, ("\n" + self.source).encode())
+        self.assertIsNone(builder.symbol_at_line(0))
+        self.assertEqual(builder.symbol_at_line(1).type, "class_definition")
+        self.assertEqual(builder.symbol_at_line(5).type, "function_definition")
+
+
 class TestImportBlocks(TestParserUtil):
     def test_import_block_detection(self):
         code = dedent(
@@ -7,17 +7,23 @@ The tests are structured to reflect the refactored, modular architecture of the
 """
 
 import json
+import os
+import shutil
+import tempfile
+import threading
 import unittest
 from unittest.mock import AsyncMock, MagicMock, Mock, mock_open, patch
 
 from fastapi.responses import JSONResponse, PlainTextResponse
 
 from lsp.client import GenericLSPClient
+import tree
 from tree import ParserUtil
 from tree_libs.app import FileSearchResult, FileSearchResults, MatchResult, WebServiceState
 from tree_libs.web_handlers import (
     LSPCallResolver,
     _enrich_symbols_with_content,
+    _get_cached_file_data,
     _lookup_symbol_by_line,
     _lookup_symbol_by_name,
     _parse_symbol_request,
@@ -319,6 +325,87 @@ class TestLSPDidChangeHandler(unittest.IsolatedAsyncioTestCase):
         self.mock_lsp_client.did_change.assert_called_once_with("test.py", "new content")
 
 
+class FakeIncrementalParser:
+    """记录 update_symbol_paths 的调用，code_map 中带上解析的内容来源"""
+
+    instances = []
+
+    def __init__(self, *args):
+        self.calls = []
+        self.code_map_builder = Mock()
+        self.code_map_builder.build_symbol_info.side_effect = lambda info, rel_path: {"file_path": rel_path, **info}
+        self.instances.append(self)
+
+    def update_symbol_paths(self, file_path, source_code=None):
+        self.calls.append(source_code)
+        return ["f"], {"f": {"source": source_code or "disk"}}, ["f"]
+
+    def update_symbol_trie(self, file_path, trie, incremental=False):
+        self.calls.append(incremental)
+        return {"f": {"source": "disk"}}
+
+
+class TestCachedFileData(unittest.IsolatedAsyncioTestCase):
+    """file_parser_info_cache 的 (mtime, parser, code_map) 条目与缓存 ParserUtil 的复用"""
+
+    def setUp(self):
+        self.tmp_dir = tempfile.mkdtemp()
+        self.path = os.path.join(self.tmp_dir, "a.py")
+        with open(self.path, "w") as f:
+            f.write("def f():\n    pass\n")
+        config = Mock()
+        config.relative_path.side_effect = lambda path: path
+        config.absolute_path.side_effect = lambda path: path
+        self.state = WebServiceState(config)
+        FakeIncrementalParser.instances = []
+        patcher = patch.multiple("tree_libs.web_handlers", ParserUtil=FakeIncrementalParser, ParserLoader=Mock())
+        patcher.start()
+        self.addCleanup(patcher.stop)
+
+    def tearDown(self):
+        shutil.rmtree(self.tmp_dir, ignore_errors=True)
+
+    async def test_cached_parser_is_reused(self):
+        parser, code_map = await _get_cached_file_data(self.path, self.state)
+        self.assertEqual(code_map, {"f": {"source": "disk"}})
+        self.assertEqual(await _get_cached_file_data(self.path, self.state), (parser, code_map))
+        self.assertEqual(parser.calls, [None])
+
+        os.utime(self.path, (1, 1))
+        self.assertIs((await _get_cached_file_data(self.path, self.state))[0], parser)
+        self.assertEqual(parser.calls, [None, None])
+        self.assertEqual(len(FakeIncrementalParser.instances), 1)
+
+    async def test_did_change_marks_entry_dirty(self):
+        parser, _ = await _get_cached_file_data(self.path, self.state)
+        self.state.get_lsp_client = Mock(return_value=None)
+        await handle_lsp_did_change(self.path, "def g(): pass", self.state)
+        mtime, cached_parser, code_map = self.state.file_parser_info_cache[self.path]
+        self.assertIsNone(mtime)
+        self.assertIs(cached_parser, parser)
+        self.assertEqual(code_map, {"f": {"source": b"def g(): pass"}})
+
+        # 未保存的缓冲区内容不算命中，按磁盘内容重新解析
+        _, code_map = await _get_cached_file_data(self.path, self.state)
+        self.assertEqual(code_map, {"f": {"source": "disk"}})
+        self.assertEqual(parser.calls, [None, b"def g(): pass", None])
+
+    async def test_update_trie_if_needed_shares_entries(self):
+        parser, _ = await _get_cached_file_data(self.path, self.state)
+        cache = self.state.file_parser_info_cache
+
+        def update():
+            return tree.update_trie_if_needed(f"symbol:{self.path}", Mock(), cache, True, self.state.lock)
+
+        with patch.object(tree, "ParserUtil", FakeIncrementalParser):
+            self.assertFalse(update())
+            os.utime(self.path, (1, 1))
+            cache[self.path] = (0.5, parser, {})
+            self.assertTrue(update())
+        self.assertEqual(parser.calls, [None, True])
+        self.assertEqual(self.state.file_parser_info_cache[self.path], (1, parser, {"f": {"source": "disk"}}))
+
+
 class TestSearchToSymbolsHandler(unittest.IsolatedAsyncioTestCase):
     """Test the search-to-symbols handler."""
 
@@ -357,6 +444,7 @@ class TestRealtimeCompletionHandler(unittest.IsolatedAsyncioTestCase):
         self.mock_state = Mock(spec=WebServiceState)
         self.mock_state.file_symbol_trie = Mock()
         self.mock_state.file_parser_info_cache = {}
+        self.mock_state.lock = threading.Lock()
 
     @patch("tree_libs.web_handlers._get_cached_file_data", new_callable=AsyncMock)
     @patch("tree_libs.web_handlers.perform_trie_search")
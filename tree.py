@@ -1,8 +1,11 @@
 import argparse
 import asyncio
+import contextlib
+import fnmatch
 import importlib
 import json
 import logging
+import marshal
 import os
 import shutil
 import subprocess
@@ -13,7 +16,7 @@ from collections import defaultdict, deque
 from datetime import datetime, timezone
 from difflib import unified_diff
 from pathlib import Path
-from typing import Any, Dict, List, Optional, Tuple, Union
+from typing import Any, ContextManager, Dict, List, Optional, Tuple, Union
 
 import yaml
 
@@ -28,6 +31,7 @@ from tree_libs.ast import (
     ParserLoader,
     ParserUtil,
     SourceSkeleton,
+    calculate_crc32_hash,
 )
 
 just_fix_windows_console()
@@ -224,7 +228,9 @@ class TrieNode:
         self.symbols: List[Dict[str, Any]] = []  # 存储符号详细信息（支持同名不同定义的符号）
 
 
-class SymbolTrie:
+class PySymbolTrie:
+    """纯 Python 的符号前缀树，tree_libs.symbol_core 未编译时使用"""
+
     def __init__(self, case_sensitive: bool = True):
         self.root = TrieNode()
         self.case_sensitive = case_sensitive
@@ -362,7 +368,7 @@ class SymbolTrie:
         return self._size
 
     @classmethod
-    def from_symbols(cls, symbols_dict: Dict, case_sensitive: bool = True) -> "SymbolTrie":
+    def from_symbols(cls, symbols_dict: Dict, case_sensitive: bool = True) -> "PySymbolTrie":
         """从现有符号字典构建前缀树"""
         trie = cls(case_sensitive)
         for symbol_name, entries in symbols_dict.items():
@@ -378,6 +384,103 @@ class SymbolTrie:
         return trie
 
 
+class NativeSymbolTrie:
+    """基于 tree_libs.symbol_core.SymbolIndex 的符号表，接口与 PySymbolTrie 相同
+
+    键存成排序、前缀压缩的字符串表，符号信息用 marshal 序列化后存在紧凑的记录数组里，
+    带文件名的 symbol:<file>/<name> 键与普通键共用一条记录。
+    深度优先的前缀查询按字节序返回；广度优先按 (键长, 键) 返回，与逐层遍历前缀树一致。
+    save() 写出的文件可由 load() 直接 mmap，用于离线构建索引。
+    """
+
+    def __init__(self, case_sensitive: bool = True, index: Any = None):
+        if SymbolTrie is not NativeSymbolTrie:
+            raise RuntimeError("tree_libs.symbol_core is not built (cmake -S tree_libs -B build)")
+        self._index = index if index is not None else SymbolIndex(case_sensitive=case_sensitive)
+        self.case_sensitive = self._index.case_sensitive
+        self._identifiable_paths: Dict[str, str] = {}
+        self.modified = False  # 上次 load/save 之后是否有插入或 manifest 变化
+
+    def _normalize(self, word: str) -> str:
+        """统一大小写处理"""
+        return word if self.case_sensitive else word.lower()
+
+    def insert(self, symbol_name: str, symbol_info: Dict[str, Any]):
+        """插入符号，同名键的旧记录被替换"""
+        word = self._normalize(symbol_name)
+        alias = None
+        if not symbol_name.startswith("symbol:"):
+            file_path = symbol_info["file_path"]
+            file_basename = self._identifiable_paths.get(file_path)
+            if file_basename is None:
+                file_basename = self._identifiable_paths[file_path] = extract_identifiable_path(file_path)
+            alias = self._normalize(f"symbol:{file_basename}/{word}")
+        details = dict(symbol_info)
+        file_path = details.pop("file_path", None)
+        self._index.insert(word, file_path, marshal.dumps(details), alias)
+        self.modified = True
+
+    @staticmethod
+    def _details(file_path: Optional[str], info: bytes) -> Dict[str, Any]:
+        details = marshal.loads(info)
+        if file_path is None:
+            return details
+        return {"file_path": file_path, **details}
+
+    def search_exact(self, symbol_path: str) -> Optional[Dict[str, Any]]:
+        """精确搜索符号路径，未找到时返回None"""
+        found = self._index.search_exact(self._normalize(symbol_path))
+        return self._details(*found) if found else None
+
+    def search_prefix(
+        self, prefix: str, max_results: Optional[int] = None, use_bfs: bool = False
+    ) -> List[Dict[str, Any]]:
+        """前缀搜索，返回 [{"name": 键, "details": 符号信息}]"""
+        matches = self._index.search_prefix(self._normalize(prefix), max_results=max_results, bfs=use_bfs)
+        return [{"name": name, "details": self._details(file_path, info)} for name, file_path, info in matches]
+
+    def to_dict(self) -> Dict[str, List[Dict[str, Any]]]:
+        """将符号表转换为包含所有符号的字典"""
+        return {item["name"]: [item["details"]] for item in self.search_prefix("")}
+
+    @property
+    def size(self) -> int:
+        """返回唯一符号数量"""
+        return len(self._index)
+
+    @property
+    def manifest(self) -> Dict[str, Tuple[float, int]]:
+        """随索引保存的 {相对路径: (mtime, crc32)}，记录索引了哪些文件的哪个版本"""
+        data = self._index.manifest
+        return marshal.loads(data) if data else {}
+
+    @manifest.setter
+    def manifest(self, files: Dict[str, Tuple[float, int]]) -> None:
+        self._index.manifest = marshal.dumps(files)
+        self.modified = True
+
+    def save(self, path: str) -> None:
+        """写出可被 load() 映射的索引文件"""
+        self._index.save(path)
+        self.modified = False
+
+    @classmethod
+    def load(cls, path: str) -> "NativeSymbolTrie":
+        """mmap 由 save() 写出的索引文件，之后的插入先进入内存中的增量表"""
+        return cls(index=open_index(path) if SymbolTrie is NativeSymbolTrie else None)
+
+    from_symbols = classmethod(PySymbolTrie.from_symbols.__func__)
+
+
+try:
+    from tree_libs.symbol_core import SymbolIndex, open_index
+except ImportError:
+    # symbol_core 未编译或与当前 Python 版本不匹配
+    SymbolTrie: Any = PySymbolTrie
+else:
+    SymbolTrie = NativeSymbolTrie
+
+
 class Match:
     def __init__(self, line: int, column_range: tuple[int, int], text: str):
         self.line = line
@@ -794,7 +897,19 @@ def extract_identifiable_path(file_path: str) -> str:
     return abs_path.replace("\\", "/")
 
 
-def update_trie_if_needed(prefix: str, trie: SymbolTrie, file_parser_info_cache: Dict, just_path: bool = False) -> bool:
+def update_trie_if_needed(
+    prefix: str,
+    trie: SymbolTrie,
+    file_parser_info_cache: Dict,
+    just_path: bool = False,
+    lock: Optional[ContextManager] = None,
+) -> bool:
+    """文件比缓存新时重新解析并插入符号
+
+    file_parser_info_cache 与 web_handlers 共用：{相对路径: (mtime, ParserUtil, code_map)}，
+    mtime 为 None 表示 code_map 来自未保存的编辑器内容。缓存的 ParserUtil 会被增量解析修改，
+    多线程共用缓存时传入 lock。
+    """
     if not prefix.startswith("symbol:"):
         return False
     path_part = prefix.removeprefix("symbol:")
@@ -808,15 +923,17 @@ def update_trie_if_needed(prefix: str, trie: SymbolTrie, file_parser_info_cache:
     except FileNotFoundError:
         return False
 
-    parser_instance, cached_mtime, _ = file_parser_info_cache.get(file_path, (None, 0, ""))
-    if current_mtime > cached_mtime:
+    with lock or contextlib.nullcontext():
+        cached = file_parser_info_cache.get(file_path)
+        cached_mtime, parser_instance, _ = cached if isinstance(cached, tuple) else (None, None, None)
+        if cached_mtime is not None and current_mtime <= cached_mtime:
+            return False
         logger.debug("File modified, re-parsing: %s", file_path)
-        parser_loader = ParserLoader()
-        parser_instance = ParserUtil(parser_loader)
-        parser_instance.update_symbol_trie(file_path, trie)
-        file_parser_info_cache[file_path] = (parser_instance, current_mtime, file_path)
+        # 复用上次的 ParserUtil，在旧语法树上增量解析，只插入变化的符号
+        parser_instance = parser_instance or ParserUtil(ParserLoader())
+        code_map = parser_instance.update_symbol_trie(file_path, trie, incremental=True)
+        file_parser_info_cache[file_path] = (current_mtime, parser_instance, code_map)
         return True
-    return False
 
 
 def perform_trie_search(
@@ -827,6 +944,7 @@ def perform_trie_search(
     file_path: Optional[str] = None,
     use_bfs: bool = False,
     search_exact: bool = False,
+    lock: Optional[ContextManager] = None,
 ) -> list:
     if search_exact:
         result = trie.search_exact(prefix)
@@ -834,11 +952,76 @@ def perform_trie_search(
 
     results = trie.search_prefix(prefix, max_results=max_results, use_bfs=use_bfs)
     if not results and file_path:
-        if update_trie_if_needed(f"symbol:{file_path}", trie, file_parser_info_cache, just_path=True):
+        if update_trie_if_needed(f"symbol:{file_path}", trie, file_parser_info_cache, just_path=True, lock=lock):
             return trie.search_prefix(prefix, max_results=max_results, use_bfs=use_bfs)
     return results
 
 
+def iter_project_source_files(config: ProjectConfig):
+    """遍历项目中解析器支持的源文件，跳过 exclude 配置的目录和文件"""
+    exclude_dirs = config.exclude["dirs"]
+    exclude_files = config.exclude["files"]
+    for dir_path, dir_names, file_names in os.walk(config.project_root_dir):
+        dir_names[:] = sorted(d for d in dir_names if not any(fnmatch.fnmatch(d, p) for p in exclude_dirs))
+        for name in sorted(file_names):
+            if Path(name).suffix.lower() not in SUPPORTED_LANGUAGES:
+                continue
+            if any(fnmatch.fnmatch(name, p) for p in exclude_files):
+                continue
+            yield os.path.join(dir_path, name)
+
+
+def refresh_symbol_index(trie: NativeSymbolTrie, config: ProjectConfig) -> int:
+    """按 manifest 只重新解析新增或内容变化的文件，返回重新解析的文件数
+
+    mtime 没变的文件直接跳过；mtime 变了但 crc32 相同的只更新 manifest。
+    已删除文件的符号仍留在索引中，与 SymbolTrie 插入时替换、从不删除的行为一致。
+    """
+    previous = trie.manifest
+    manifest: Dict[str, Tuple[float, int]] = {}
+    parser_util: Optional[ParserUtil] = None
+    parsed = 0
+    for file_path in iter_project_source_files(config):
+        rel_path = config.relative_path(file_path)
+        try:
+            mtime = os.path.getmtime(file_path)
+            entry = previous.get(rel_path)
+            if entry and entry[0] == mtime:
+                manifest[rel_path] = entry
+                continue
+            with open(file_path, encoding="utf-8", errors="replace") as f:
+                crc32 = calculate_crc32_hash(f.read())
+            if not entry or entry[1] != crc32:
+                parser_util = parser_util or ParserUtil(ParserLoader())
+                parser_util.update_symbol_trie(file_path, trie)
+                parsed += 1
+            manifest[rel_path] = (mtime, crc32)
+        except Exception as e:
+            logger.warning("Failed to index %s: %s", file_path, e)
+    if parsed or manifest != previous:
+        trie.manifest = manifest
+    return parsed
+
+
+def open_symbol_index(index_path: str) -> NativeSymbolTrie:
+    """映射已有的索引文件；文件不存在或格式不符时返回空索引，之后由 refresh_symbol_index 重建"""
+    if os.path.exists(index_path):
+        try:
+            return NativeSymbolTrie.load(index_path)
+        except (OSError, ValueError) as e:
+            logger.warning("Ignoring symbol index %s: %s", index_path, e)
+    return NativeSymbolTrie()
+
+
+def build_symbol_index(config: ProjectConfig, output_path: str) -> int:
+    """解析整个项目并写出符号索引文件，已有索引时只重新解析变化的文件，返回唯一键数量"""
+    trie = open_symbol_index(output_path)
+    refresh_symbol_index(trie, config)
+    if trie.modified or not os.path.exists(output_path):
+        trie.save(output_path)
+    return trie.size
+
+
 def dynamic_import(module_name: str) -> Any:
     return importlib.import_module(module_name)
 
@@ -847,11 +1030,14 @@ def main(
     host: str = "127.0.0.1",
     port: int = 8000,
     project_paths: Optional[List[str]] = None,
+    symbol_index: Optional[str] = None,
 ):
     # This function is now a simple launcher for the web service.
     # The actual app is created by the factory in tree_libs.app
     app_factory = dynamic_import("tree_libs.app")
     app = app_factory.create_app()
+    if symbol_index:
+        app.state.web_service_state.load_symbol_index(symbol_index)
 
     # Initialization logic that might have been in `build_index` or `initialize_symbol_trie`
     # can now be performed here, populating the app's state.
@@ -990,6 +1176,10 @@ if __name__ == "__main__":
     )
     arg_parser.add_argument("--lsp", type=str, help="启动LSP客户端，指定LSP服务器命令（如：pylsp）")
     arg_parser.add_argument("--debugger-port", type=int, default=9911, help="调试器服务端口")
+    arg_parser.add_argument("--build-symbol-index", type=str, help="解析整个项目，把符号索引写到指定文件后退出")
+    arg_parser.add_argument(
+        "--symbol-index", type=str, help="启动服务时映射符号索引文件，并在后台重新解析变化的文件后写回"
+    )
     args = arg_parser.parse_args()
     logger.setLevel(args.log_level.upper())
     if args.lsp:
@@ -1005,6 +1195,9 @@ if __name__ == "__main__":
         skeleton = SourceSkeleton(parser_loader)
         framework = skeleton.generate_framework(args.debug_skeleton)
         print(SyntaxHighlight.highlight_if_terminal(framework, file_path=args.debug_skeleton))
+    elif args.build_symbol_index:
+        key_count = build_symbol_index(GLOBAL_PROJECT_CONFIG, args.build_symbol_index)
+        logger.info("Wrote %d symbol keys to %s", key_count, args.build_symbol_index)
     else:
         logger.info("Starting Code Analysis Service...")
-        main(host=args.host, port=args.port, project_paths=args.project)
+        main(host=args.host, port=args.port, project_paths=args.project, symbol_index=args.symbol_index)
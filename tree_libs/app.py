@@ -12,6 +12,8 @@ from tree import (
     GenericLSPClient,
     ProjectConfig,
     SymbolTrie,
+    open_symbol_index,
+    refresh_symbol_index,
     start_lsp_client_once,
 )
 
@@ -60,6 +62,33 @@ class WebServiceState:
         with self.lock:
             self.symbol_trie = SymbolTrie.from_symbols(symbols_dict, case_sensitive=True)
 
+    def load_symbol_index(self, index_path: str) -> threading.Thread:
+        """映射持久化的符号索引，后台只重新解析 manifest 中变化的文件，完成后写回索引文件。
+
+        刷新在同一文件的另一份映射上进行，完成后在锁内替换 symbol_trie，
+        请求处理中拿到的符号表不会被后台线程修改。
+        """
+        trie = open_symbol_index(index_path)
+        logger.info("Mapped symbol index %s (%d keys)", index_path, trie.size)
+        with self.lock:
+            self.symbol_trie = trie
+
+        def refresh():
+            try:
+                refreshed = open_symbol_index(index_path)
+                parsed = refresh_symbol_index(refreshed, self.config)
+                if refreshed.modified:
+                    refreshed.save(index_path)
+                with self.lock:
+                    self.symbol_trie = refreshed
+                logger.info("Symbol index refreshed: %d files re-parsed, %d keys", parsed, refreshed.size)
+            except Exception as e:
+                logger.error("Symbol index refresh failed: %s", e, exc_info=True)
+
+        thread = threading.Thread(target=refresh, daemon=True, name="SymbolIndexRefresh")
+        thread.start()
+        return thread
+
     def get_lsp_client(self, file_path: str) -> GenericLSPClient:
         """为给定的文件路径获取或创建一个LSP客户端。"""
         with self.lock:
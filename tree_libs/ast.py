@@ -10,7 +10,7 @@ import re
 import zlib
 from abc import abstractmethod
 
-from tree_sitter import Language, Node, Parser, Query
+from tree_sitter import Language, Node, Parser, Query, Tree
 
 # 定义语言名称常量
 C_LANG = "c"
@@ -277,6 +277,120 @@ def calculate_crc32_hash(text: str) -> int:
     return zlib.crc32(text.encode("utf-8"))
 
 
+class PyIntervalIndex:
+    """symbol_core.IntervalIndex 的纯 Python 实现：按起点排序的数组上的隐式区间树，节点记录子树内的最大终点"""
+
+    def __init__(self, ranges: List[Tuple[int, int]]):
+        items = sorted((start, end, i) for i, (start, end) in enumerate(ranges))
+        self._starts = [item[0] for item in items]
+        self._ends = [item[1] for item in items]
+        self._ids = [item[2] for item in items]
+        self._max_ends = list(self._ends)
+        self._fill_max_end(0, len(items))
+
+    def _fill_max_end(self, lo: int, hi: int) -> int:
+        if lo >= hi:
+            return -1
+        mid = (lo + hi) // 2
+        result = max(self._ends[mid], self._fill_max_end(lo, mid), self._fill_max_end(mid + 1, hi))
+        self._max_ends[mid] = result
+        return result
+
+    def stab(self, pos: int) -> List[int]:
+        """包含 pos 的闭区间在 ranges 中的序号，升序"""
+        found = []
+        stack = [(0, len(self._starts))]
+        while stack:
+            lo, hi = stack.pop()
+            if lo >= hi:
+                continue
+            mid = (lo + hi) // 2
+            if self._max_ends[mid] < pos:
+                continue
+            stack.append((lo, mid))
+            if self._starts[mid] <= pos:
+                if self._ends[mid] >= pos:
+                    found.append(self._ids[mid])
+                stack.append((mid + 1, hi))
+        return sorted(found)
+
+    def __len__(self) -> int:
+        return len(self._starts)
+
+
+try:
+    from .symbol_core import IntervalIndex
+except ImportError:
+    IntervalIndex = PyIntervalIndex
+
+
+def _location_key(line: int, column: int) -> int:
+    """(行, 列) 编码成一个整数，保持字典序"""
+    return (line << 32) | column
+
+
+def _common_prefix_length(old: bytes, new: bytes, limit: int) -> int:
+    """按 64KB 分块比较找到公共前缀长度，块内二分，切片比较都在 C 层完成"""
+    pos = 0
+    while pos < limit:
+        size = min(1 << 16, limit - pos)
+        if old[pos : pos + size] == new[pos : pos + size]:
+            pos += size
+            continue
+        lo, hi = pos, pos + size - 1
+        while lo < hi:
+            mid = (lo + hi + 1) // 2
+            if old[pos:mid] == new[pos:mid]:
+                lo = mid
+            else:
+                hi = mid - 1
+        return lo
+    return limit
+
+
+def _common_suffix_length(old: bytes, new: bytes, limit: int) -> int:
+    """公共后缀长度，不超过 limit"""
+    old_len, new_len = len(old), len(new)
+    length = 0
+    while length < limit:
+        size = min(1 << 16, limit - length)
+        if old[old_len - length - size : old_len - length] == new[new_len - length - size : new_len - length]:
+            length += size
+            continue
+        lo, hi = length, length + size - 1
+        while lo < hi:
+            mid = (lo + hi + 1) // 2
+            if old[old_len - mid : old_len - length] == new[new_len - mid : new_len - length]:
+                lo = mid
+            else:
+                hi = mid - 1
+        return lo
+    return limit
+
+
+def _point_at(source: bytes, byte: int) -> Tuple[int, int]:
+    """字节偏移对应的 (行, 字节列)，与 tree-sitter 的 Point 一致"""
+    return source.count(b"\n", 0, byte), byte - (source.rfind(b"\n", 0, byte) + 1)
+
+
+def compute_source_edit(old: bytes, new: bytes) -> Optional[Dict[str, Any]]:
+    """把新旧内容的差异归并为一处编辑（公共前缀和后缀之间的部分），返回 Tree.edit 的参数；内容相同时返回 None"""
+    if old == new:
+        return None
+    limit = min(len(old), len(new))
+    start = _common_prefix_length(old, new, limit)
+    suffix = _common_suffix_length(old, new, limit - start)
+    old_end, new_end = len(old) - suffix, len(new) - suffix
+    return {
+        "start_byte": start,
+        "old_end_byte": old_end,
+        "new_end_byte": new_end,
+        "start_point": _point_at(old, start),
+        "old_end_point": _point_at(old, old_end),
+        "new_end_point": _point_at(new, new_end),
+    }
+
+
 class ParserUtil:
     def __init__(self, parser_loader: ParserLoader) -> None:
         """初始化解析器工具类"""
@@ -284,43 +398,121 @@ class ParserUtil:
         self.node_processor = NodeProcessor()
         self.code_map_builder = CodeMapBuilder(None, self.node_processor, lang=parser_loader.lang)
         self._source_code: Optional[bytes] = None
-
-    def prepare_root_node(self, file_path: str) -> Node:
-        """获取文件的根节点"""
+        # 上次 get_symbol_paths 的语法树和结果，供 update_symbol_paths 增量解析
+        self._tree: Optional[Tree] = None
+        self._file_path: Optional[str] = None
+        self._symbol_paths: List[str] = []
+        self._code_map: Optional[Dict[str, Any]] = None
+
+    def prepare_root_node(self, file_path: str, source_code: Optional[bytes] = None) -> Node:
+        """获取文件的根节点，source_code 为空时从磁盘读取"""
         parser, _, lang_name = self.parser_loader.get_parser(file_path)
         self.node_processor.lang_spec = find_spec_for_lang(lang_name)
         self.code_map_builder.lang = lang_name
-        with open(file_path, "rb") as f:
-            source_code = f.read()
+        if source_code is None:
+            with open(file_path, "rb") as f:
+                source_code = f.read()
         self._source_code = source_code
         tree = parser.parse(source_code)
+        self._tree = tree
+        self._file_path = file_path
         root_node = tree.root_node
         self.code_map_builder.root_node = root_node
         return root_node
 
-    def get_symbol_paths(self, file_path: str, debug: bool = False) -> Tuple[List[str], Dict[str, Any]]:
+    def get_symbol_paths(
+        self, file_path: str, debug: bool = False, source_code: Optional[bytes] = None
+    ) -> Tuple[List[str], Dict[str, Any]]:
         """解析代码文件并返回所有符号路径及对应代码和位置信息"""
-        root_node = self.prepare_root_node(file_path)
+        root_node = self.prepare_root_node(file_path, source_code)
         results: List[str] = []
         code_map: Dict[str, Any] = {}
         assert self._source_code is not None
         if is_node_module(root_node.type) and len(root_node.children) != 0:
             self.code_map_builder.process_import_block(root_node, code_map, self._source_code, results)
         self.code_map_builder.traverse(root_node, [], [], code_map, self._source_code, results)
+        self._symbol_paths, self._code_map = results, code_map
         return results, code_map
 
-    def update_symbol_trie(self, file_path: str, symbol_trie: "SymbolTrie") -> None:
-        """更新符号前缀树，将文件中的所有符号插入到前缀树中"""
-        paths, code_map = self.get_symbol_paths(file_path)
+    def update_symbol_paths(
+        self, file_path: str, source_code: Optional[bytes] = None
+    ) -> Tuple[List[str], Dict[str, Any], List[str]]:
+        """重新解析文件，返回 (符号路径, code_map, 新增或变化的符号路径)
+
+        同一文件解析过时，把新旧内容的差异作为一次编辑应用到旧语法树（Tree.edit）后增量解析，
+        只重新提取与编辑范围或 changed_ranges 相交的符号，编辑之后的符号沿用旧结果并平移位置，
+        耗时随编辑大小而不是文件大小增长。平移会改变重名符号的 _<行号> 后缀，这种情况退回完整解析。
+        """
+        if source_code is None:
+            with open(file_path, "rb") as f:
+                source_code = f.read()
+        old_tree, old_source, old_code_map = self._tree, self._source_code, self._code_map
+        if old_tree is None or old_source is None or old_code_map is None or file_path != self._file_path:
+            paths, code_map = self.get_symbol_paths(file_path, source_code=source_code)
+            return paths, code_map, list(code_map)
+        edit = compute_source_edit(old_source, source_code)
+        if edit is None:
+            return self._symbol_paths, old_code_map, []
+
+        builder = self.code_map_builder
+        code_map = builder.shift_code_map(old_code_map, edit)
+        if code_map is None:
+            paths, code_map = self.get_symbol_paths(file_path, source_code=source_code)
+            return paths, code_map, builder.changed_symbols(old_code_map, code_map)
+
+        parser, _, _ = self.parser_loader.get_parser(file_path)
+        self._tree = None  # 旧树编辑后与 _source_code 不再对应，解析失败时下次完整解析
+        old_tree.edit(**edit)
+        tree = parser.parse(source_code, old_tree)
+        ranges = [(edit["start_byte"], edit["new_end_byte"])]
+        ranges.extend((r.start_byte, r.end_byte) for r in old_tree.changed_ranges(tree))
+        self._tree, self._source_code = tree, source_code
+        root_node = tree.root_node
+        builder.root_node = root_node
+
+        # 丢弃与变化范围相交的旧符号，再只遍历这些范围内的子树重新提取
+        code_map = {
+            key: entry
+            for key, entry in code_map.items()
+            if not any(entry["block_range"][0] <= end and start <= entry["block_range"][1] for start, end in ranges)
+        }
+        fresh: Dict[str, Any] = {}
+        results: List[str] = []
+        if is_node_module(root_node.type) and len(root_node.children) != 0:
+            builder.process_import_block(root_node, fresh, source_code, results)
+        builder.traverse_ranges(root_node, ranges, fresh, source_code, results)
+        if any(key in code_map for key in fresh):
+            # 新提取的符号与沿用的符号重名，_<行号> 后缀取决于整棵树的遍历顺序
+            paths, code_map = self.get_symbol_paths(file_path, source_code=source_code)
+            return paths, code_map, builder.changed_symbols(old_code_map, code_map)
+        code_map.update(fresh)
+
+        paths = sorted(code_map, key=lambda key: (key != "__import__",) + builder.block_order(code_map[key]))
+        self._symbol_paths, self._code_map = paths, code_map
+        return paths, code_map, builder.changed_symbols(old_code_map, code_map)
+
+    def update_symbol_trie(
+        self, file_path: str, symbol_trie: "SymbolTrie", incremental: bool = False
+    ) -> Dict[str, Any]:
+        """更新符号前缀树，将文件中的所有符号插入到前缀树中并返回 code_map；incremental 时只插入新增或变化的符号"""
+        if incremental:
+            _, code_map, paths = self.update_symbol_paths(file_path)
+        else:
+            paths, code_map = self.get_symbol_paths(file_path)
         for path in paths:
             info = code_map[path]
             symbol_info = self.code_map_builder.build_symbol_info(info, file_path)
             symbol_trie.insert(path, symbol_info)
+        return code_map
 
     def find_symbols_by_location(self, code_map: dict, line: int, column: int) -> list[dict]:
         """根据行列位置查找对应的符号信息列表，按嵌套层次排序（最内层在前）"""
         return self.code_map_builder.find_symbols_by_location(code_map, line, column)
 
+    def find_symbols_by_offset(self, code_map: dict, offset: int) -> list[dict]:
+        """根据字节偏移查找包含它的符号信息列表，排序与 find_symbols_by_location 相同"""
+        return self.code_map_builder.find_symbols_by_offset(code_map, offset)
+
     def find_symbols_for_locations(
         self,
         code_map: dict,
@@ -1019,19 +1211,68 @@ class CodeMapBuilder:
         self.node_processor = node_processor
         self.lang = lang
         self.root_node = root_node
+        # code_map 的区间索引，按符号和区间内容缓存：{"location"|"offset": (paths, ranges, index)}
+        self._code_map_indexes: Dict[str, Tuple[List[str], List[Tuple[Any, Any]], Any]] = {}
+
+    @property
+    def root_node(self) -> Optional[Node]:
+        return self._root_node
+
+    @root_node.setter
+    def root_node(self, node: Optional[Node]) -> None:
+        self._root_node = node
+        self._line_starts: Optional[Dict[int, Node]] = None
+
+    def _build_line_starts(self) -> Dict[int, Node]:
+        """每行开始的最浅节点（同层取最靠前的），即层级遍历中该行遇到的第一个非根节点；一次先序遍历建成"""
+        best: Dict[int, Tuple[int, int, Node]] = {}
+        assert self.root_node is not None
+        cursor = self.root_node.walk()
+        depth = 0
+        while True:
+            if cursor.goto_first_child():
+                depth += 1
+            else:
+                while not cursor.goto_next_sibling():
+                    if depth == 0 or not cursor.goto_parent():
+                        return {row: item[2] for row, item in best.items()}
+                    depth -= 1
+                    if depth == 0:
+                        return {row: item[2] for row, item in best.items()}
+            node = cursor.node
+            row = node.start_point[0]
+            current = best.get(row)
+            if current is None or (depth, node.start_byte) < (current[0], current[1]):
+                best[row] = (depth, node.start_byte, node)
 
     def symbol_at_line(self, line: int) -> Optional[Node]:
-        """查找指定行开始的第一个语法树节点，使用层级遍历"""
+        """查找指定行开始的第一个语法树节点（层级遍历顺序），行索引在语法树更新后首次查询时建立"""
         if not self.root_node:
             return None
-        queue: List[Node] = [self.root_node]
-        while queue:
-            current_node = queue.pop(0)
-            start_row, _ = current_node.start_point
-            if start_row == line and current_node.parent:
-                return current_node
-            queue.extend(current_node.children)
-        return None
+        if self._line_starts is None:
+            self._line_starts = self._build_line_starts()
+        return self._line_starts.get(line)
+
+    def _code_map_index(self, code_map: Dict[str, Any], kind: str) -> Tuple[List[str], Any]:
+        """code_map 的区间索引，kind 为 location（行列）或 offset（block_range 字节范围）
+
+        条目的范围可能被原地修改，所以每次都比较符号和区间，任何一处变化都重建索引。
+        """
+        paths = list(code_map)
+        if kind == "location":
+            ranges = [
+                (
+                    _location_key(code_map[path]["start_line"], code_map[path]["start_col"]),
+                    _location_key(code_map[path]["end_line"], code_map[path]["end_col"]),
+                )
+                for path in paths
+            ]
+        else:
+            ranges = [tuple(code_map[path]["block_range"]) for path in paths]
+        cached = self._code_map_indexes.get(kind)
+        if cached is None or cached[0] != paths or cached[1] != ranges:
+            cached = self._code_map_indexes[kind] = (paths, ranges, IntervalIndex(ranges))
+        return cached[0], cached[2]
 
     def build_symbol_info_at_line(self, line: int) -> Optional[dict]:
         """构建指定行符号的完整信息"""
@@ -1467,6 +1708,104 @@ class CodeMapBuilder:
             for child in reversed(current_node.children):
                 stack.append((child, new_depth))
 
+    def traverse_ranges(
+        self,
+        node: Node,
+        ranges: List[Tuple[int, int]],
+        code_map: Dict[str, Any],
+        source_bytes: bytes,
+        results: List[str],
+    ) -> None:
+        """与 traverse 规则相同，但只进入符号范围（含前导注释和缩进）与 ranges 相交的子树"""
+        lo = min(start for start, _ in ranges)
+        hi = max(end for _, end in ranges)
+        current_symbols: List[str] = []
+        current_nodes: List[Node] = []
+        stack: List[Tuple[Node, int]] = [(node, 0)]
+        while stack:
+            current_node, depth = stack.pop()
+            del current_symbols[depth:]
+            del current_nodes[depth:]
+            processed_node = self._process_symbol_node(
+                current_node, current_symbols, current_nodes, code_map, source_bytes, results
+            )
+            if processed_node:
+                self._extract_function_calls(processed_node, current_symbols, code_map)
+                self._extract_parameter_type_calls(processed_node, current_symbols, code_map)
+
+            new_depth: int = len(current_symbols)
+            selected: List[Node] = []
+            for child in current_node.children:
+                if child.end_byte < lo:
+                    continue
+                node_info = self.get_symbol_range_info(source_bytes, child)
+                if node_info["start_byte"] > hi:
+                    # 之后的兄弟节点连同前导注释都在 hi 之后
+                    break
+                if any(node_info["start_byte"] <= end and start <= node_info["end_byte"] for start, end in ranges):
+                    selected.append(child)
+            for child in reversed(selected):
+                stack.append((child, new_depth))
+
+    @staticmethod
+    def shift_code_map(code_map: Dict[str, Any], edit: Dict[str, Any]) -> Optional[Dict[str, Any]]:
+        """按编辑平移旧 code_map：编辑之前的条目原样沿用，之后的条目平移字节和行列位置，跨越编辑的条目丢弃。
+
+        被平移行号的重名符号（键带 _<行号> 后缀）无法直接改键，返回 None 由调用方完整解析。
+        """
+        start, old_end = edit["start_byte"], edit["old_end_byte"]
+        byte_delta = edit["new_end_byte"] - old_end
+        end_row, end_col = edit["old_end_point"]
+        row_delta = edit["new_end_point"][0] - end_row
+        col_delta = edit["new_end_point"][1] - end_col
+
+        def shift_point(point: Tuple[int, int]) -> Tuple[int, int]:
+            row, col = point
+            return (row + row_delta, col + col_delta if row == end_row else col)
+
+        shifted: Dict[str, Any] = {}
+        for key, entry in code_map.items():
+            if key == "__import__":
+                continue
+            block_start, block_end = entry["block_range"]
+            if block_end < start:
+                shifted[key] = entry
+                continue
+            if block_start <= old_end:
+                continue
+            base, sep, line = key.rpartition("_")
+            if row_delta and sep and base in code_map and line == str(entry["start_line"]):
+                return None
+            new_entry = dict(entry)
+            new_entry["block_range"] = (block_start + byte_delta, block_end + byte_delta)
+            new_entry["start_line"], new_entry["start_col"] = shift_point((entry["start_line"], entry["start_col"]))
+            new_entry["end_line"], new_entry["end_col"] = shift_point((entry["end_line"], entry["end_col"]))
+            new_entry["calls"] = [
+                dict(call, start_point=shift_point(call["start_point"]), end_point=shift_point(call["end_point"]))
+                for call in entry["calls"]
+            ]
+            shifted[key] = new_entry
+        return shifted
+
+    @staticmethod
+    def block_order(entry: Dict[str, Any]) -> Tuple[int, int]:
+        """按先序遍历的顺序排列符号：起点靠前的在前，起点相同时外层在前"""
+        block_start, block_end = entry["block_range"]
+        return block_start, -block_end
+
+    @staticmethod
+    def changed_symbols(old_code_map: Dict[str, Any], code_map: Dict[str, Any]) -> List[str]:
+        """新增或内容、位置、调用信息有变化的符号路径"""
+        fields = ("code", "type", "block_range", "start_line", "start_col", "end_line", "end_col", "calls")
+        changed = []
+        for key, entry in code_map.items():
+            old_entry = old_code_map.get(key)
+            if old_entry is entry:
+                continue
+            if old_entry is None or any(old_entry.get(name) != entry.get(name) for name in fields):
+                changed.append(key)
+        return changed
+
     def build_symbol_info(self, info: Dict[str, Any], file_path: str) -> Dict[str, Any]:
         """构建符号信息字典"""
         full_definition_hash = calculate_crc32_hash(info["code"])
@@ -1485,21 +1824,25 @@ class CodeMapBuilder:
 
     def find_symbols_by_location(self, code_map: dict, line: int, column: int) -> list[dict]:
         """根据行列位置查找对应的符号信息列表，按嵌套层次排序（最内层在前）"""
-        matched_symbols = []
+        if line < 0 or column < 0:
+            return []
+        paths, index = self._code_map_index(code_map, "location")
+        return self._sorted_matches(code_map, [paths[i] for i in index.stab(_location_key(line, column))])
+
+    def find_symbols_by_offset(self, code_map: dict, offset: int) -> list[dict]:
+        """根据字节偏移查找包含它的符号信息列表，按嵌套层次排序（最内层在前）"""
+        if offset < 0:
+            return []
+        paths, index = self._code_map_index(code_map, "offset")
+        return self._sorted_matches(code_map, [paths[i] for i in index.stab(offset)])
 
-        # 先查找包含位置的符号
-        for path, info in code_map.items():
-            start_line = info["start_line"]
-            start_col = info["start_col"]
-            end_line = info["end_line"]
-            end_col = info["end_col"]
-
-            if (start_line < line or (start_line == line and start_col <= column)) and (
-                line < end_line or (line == end_line and column <= end_col)
-            ):
-                if info.get("type") == "variable":
-                    continue
-                matched_symbols.append({"symbol": path, "info": info})
+    @staticmethod
+    def _sorted_matches(code_map: dict, matched_paths: List[str]) -> list[dict]:
+        matched_symbols = [
+            {"symbol": path, "info": code_map[path]}
+            for path in matched_paths
+            if code_map[path].get("type") != "variable"
+        ]
 
         # 按嵌套深度排序
         matched_symbols.sort(
@@ -1519,15 +1862,13 @@ class CodeMapBuilder:
         include_class_context: bool = True,
     ) -> dict[str, dict]:
         """批量处理位置并返回符号名到符号信息的映射"""
-        sorted_symbols = sorted(
-            code_map.items(),
-            key=lambda item: (
-                -item[1]["start_line"],
-                -item[1]["start_col"],
-                item[1]["end_line"],
-                item[1]["end_col"],
-            ),
-        )
+        paths, index = self._code_map_index(code_map, "location")
+
+        def innermost_rank(i: int) -> Tuple[int, int, int, int, int]:
+            # 起点最靠后、终点最靠前的为最内层，完全相同时按 code_map 顺序
+            info = code_map[paths[i]]
+            return (-info["start_line"], -info["start_col"], info["end_line"], info["end_col"], i)
+
         sorted_locations = sorted(locations, key=lambda loc: (loc[0], loc[1]))
 
         processed_symbols: Dict[str, Any] = {}
@@ -1538,22 +1879,13 @@ class CodeMapBuilder:
         processed_locations_with_symbols: List[Tuple[int, int, str]] = []
 
         for line, col in sorted_locations:
-            current_symbol: Optional[str] = None
-            for symbol_path, symbol_info in sorted_symbols:
-                if symbol_info["type"] == "variable":
-                    continue
-                s_line = symbol_info["start_line"]
-                s_col = symbol_info["start_col"]
-                e_line = symbol_info["end_line"]
-                e_col = symbol_info["end_col"]
-
-                if (
-                    (s_line <= line <= e_line)
-                    and (s_col <= col if line == s_line else True)
-                    and (col <= e_col if line == e_line else True)
-                ):
-                    current_symbol = symbol_path
-                    break
+            candidates = index.stab(_location_key(line, col)) if line >= 0 and col >= 0 else []
+            innermost = min(
+                (i for i in candidates if code_map[paths[i]]["type"] != "variable"),
+                key=innermost_rank,
+                default=None,
+            )
+            current_symbol: Optional[str] = None if innermost is None else paths[innermost]
 
             if current_symbol:
                 symbol_to_process = current_symbol
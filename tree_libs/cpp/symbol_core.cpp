@@ -0,0 +1,1310 @@
+/*
+符号索引：替代 tree.py 中每个字符一个 Python 节点的 SymbolTrie。
+两百万符号时原来的前缀树要几个 GB 内存、建树十几秒；这里把键存成排序的字符串表，
+符号信息存在紧凑的记录数组里，整个索引是一块连续内存，可以离线构建后直接 mmap。
+*/
+#include <Python.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#ifndef PLATFORM_WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+文件布局（小端，各段 8 字节对齐）：
+  Header        魔数、版本、计数和各段的 (offset, size)
+  blocks        键按字节序排列，每 16 个一块前缀压缩：
+                varint 与上一个键的公共前缀长度、varint 后缀长度、后缀
+  block_offsets 每块在 blocks 中的偏移，u64 × (块数 + 1)
+  key_records   每个键对应的记录号，u32
+  lengths       (键长, length_order 中的起点)，按键长升序，末尾一项是哨兵
+  length_order  按 (键长, 键) 排列的键序号，BFS 顺序的前缀查询用
+  records       每个符号一条：文件号、信息长度、信息偏移
+  payload       符号信息（Python 层 marshal 的字节）
+  file_offsets  文件路径在 file_blob 中的偏移，u64 × (文件数 + 1)
+  file_blob     文件路径
+  manifest      调用方的附加数据（tree.py 存放被索引文件的 mtime 和 crc32），原样保存
+插入先进入内存中的增量表，增量表变大后与基础表合并成新的基础表。
+*/
+namespace symbol_index {
+
+enum Section : uint32_t {
+  kBlocks,
+  kBlockOffsets,
+  kKeyRecords,
+  kLengths,
+  kLengthOrder,
+  kRecords,
+  kPayload,
+  kFileOffsets,
+  kFileBlob,
+  kManifest,
+  kSectionCount
+};
+
+constexpr uint32_t kVersion = 2;
+constexpr uint32_t kBlockKeys = 16;
+constexpr uint32_t kNoFile = UINT32_MAX;
+constexpr uint32_t kCaseInsensitive = 1;
+// 增量表超过基础表的 1/4（至少 64K 个键）时合并
+constexpr size_t kMinMergeKeys = 1 << 16;
+
+struct Span {
+  uint64_t offset;
+  uint64_t size;
+};
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+  uint64_t key_count;
+  uint64_t record_count;
+  uint64_t file_count;
+  uint64_t block_count;
+  Span sections[kSectionCount];
+};
+
+struct Record {
+  uint32_t file;
+  uint32_t payload_size;
+  uint64_t payload_offset;
+};
+
+struct LengthRun {
+  uint32_t length;
+  uint32_t begin;
+};
+
+static const uint8_t *read_varint(const uint8_t *p, const uint8_t *end,
+                                  uint32_t &value) {
+  value = 0;
+  for (int shift = 0; p < end && shift < 35; shift += 7) {
+    uint8_t byte = *p++;
+    value |= (uint32_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return p;
+    }
+  }
+  return nullptr;
+}
+
+static void put_varint(std::vector<uint8_t> &out, uint32_t value) {
+  while (value >= 0x80) {
+    out.push_back((uint8_t)((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.push_back((uint8_t)value);
+}
+
+// 只读的基础表，数据来自 mmap 的文件或合并生成的内存
+struct Base {
+  std::vector<uint8_t> owned;
+  void *mapped = nullptr;
+  size_t mapped_size = 0;
+
+  const uint8_t *data = nullptr;
+  const Header *header = nullptr;
+  uint64_t keys = 0, records_count = 0, files = 0, blocks_count = 0;
+  const uint8_t *blocks = nullptr, *blocks_end = nullptr;
+  const uint64_t *block_offsets = nullptr;
+  const uint32_t *key_records = nullptr;
+  const LengthRun *lengths = nullptr;
+  size_t length_runs = 0;
+  const uint32_t *length_order = nullptr;
+  const Record *records = nullptr;
+  const uint8_t *payload = nullptr;
+  uint64_t payload_size = 0;
+  const uint64_t *file_offsets = nullptr;
+  const char *file_blob = nullptr;
+  std::string_view manifest;
+
+  Base() = default;
+  Base(const Base &) = delete;
+  Base &operator=(const Base &) = delete;
+  ~Base() { release(); }
+
+  void release() {
+#ifndef PLATFORM_WINDOWS
+    if (mapped) {
+      munmap(mapped, mapped_size);
+    }
+#endif
+    mapped = nullptr;
+    mapped_size = 0;
+    owned.clear();
+    owned.shrink_to_fit();
+    data = nullptr;
+    header = nullptr;
+    keys = records_count = files = blocks_count = 0;
+    manifest = {};
+  }
+
+  template <typename T> const T *section(Section id, uint64_t count) const {
+    const Span &span = header->sections[id];
+    return count <= span.size / sizeof(T)
+               ? reinterpret_cast<const T *>(data + span.offset)
+               : nullptr;
+  }
+
+  // 校验各段都在数据范围内并且对齐，段内的记录号、键序号和偏移也逐项校验，
+  // 之后的访问不再检查边界；损坏的文件在这里被拒绝
+  bool attach(const uint8_t *bytes, size_t size) {
+    if (size < sizeof(Header)) {
+      return false;
+    }
+    const Header *h = reinterpret_cast<const Header *>(bytes);
+    if (std::memcmp(h->magic, "TRSYMIX1", 8) != 0 || h->version != kVersion) {
+      return false;
+    }
+    // 记录号和文件号是 u32，kNoFile 保留
+    if (h->key_count > UINT32_MAX || h->record_count > UINT32_MAX ||
+        h->file_count >= kNoFile || h->block_count > UINT32_MAX) {
+      return false;
+    }
+    for (const Span &span : h->sections) {
+      if (span.offset % 8 != 0 || span.offset > size ||
+          span.size > size - span.offset) {
+        return false;
+      }
+    }
+    data = bytes;
+    header = h;
+    keys = h->key_count;
+    records_count = h->record_count;
+    files = h->file_count;
+    blocks_count = h->block_count;
+    blocks = data + h->sections[kBlocks].offset;
+    blocks_end = blocks + h->sections[kBlocks].size;
+    block_offsets = section<uint64_t>(kBlockOffsets, blocks_count + 1);
+    key_records = section<uint32_t>(kKeyRecords, keys);
+    length_runs = h->sections[kLengths].size / sizeof(LengthRun);
+    lengths = section<LengthRun>(kLengths, 1);
+    length_order = section<uint32_t>(kLengthOrder, keys);
+    records = section<Record>(kRecords, records_count);
+    payload = data + h->sections[kPayload].offset;
+    payload_size = h->sections[kPayload].size;
+    file_offsets = section<uint64_t>(kFileOffsets, files + 1);
+    file_blob = reinterpret_cast<const char *>(data) +
+                h->sections[kFileBlob].offset;
+    manifest = std::string_view(reinterpret_cast<const char *>(data) +
+                                    h->sections[kManifest].offset,
+                                h->sections[kManifest].size);
+    if (!block_offsets || !key_records || !lengths || !length_order ||
+        !records || !file_offsets ||
+        blocks_count != (keys + kBlockKeys - 1) / kBlockKeys ||
+        !valid_contents()) {
+      data = nullptr;
+      header = nullptr;
+      return false;
+    }
+    return true;
+  }
+
+  bool valid_contents() const {
+    for (uint64_t i = 0; i < blocks_count; ++i) {
+      if (block_offsets[i] > block_offsets[i + 1]) {
+        return false;
+      }
+    }
+    if (block_offsets[blocks_count] > header->sections[kBlocks].size) {
+      return false;
+    }
+    for (uint64_t i = 0; i < keys; ++i) {
+      if (key_records[i] >= records_count || length_order[i] >= keys) {
+        return false;
+      }
+    }
+    // 各段起点不减且不超过键数，末尾的哨兵正好在 keys 处
+    for (size_t i = 0; i < length_runs; ++i) {
+      if (lengths[i].begin > keys ||
+          (i && lengths[i].begin < lengths[i - 1].begin)) {
+        return false;
+      }
+    }
+    if (lengths[length_runs - 1].begin != keys) {
+      return false;
+    }
+    for (uint64_t i = 0; i < records_count; ++i) {
+      const Record &record = records[i];
+      if ((record.file != kNoFile && record.file >= files) ||
+          record.payload_offset > payload_size ||
+          record.payload_size > payload_size - record.payload_offset) {
+        return false;
+      }
+    }
+    for (uint64_t i = 0; i < files; ++i) {
+      if (file_offsets[i] > file_offsets[i + 1]) {
+        return false;
+      }
+    }
+    return file_offsets[files] <= header->sections[kFileBlob].size;
+  }
+
+  std::string_view file(uint32_t id) const {
+    return std::string_view(file_blob + file_offsets[id],
+                            file_offsets[id + 1] - file_offsets[id]);
+  }
+
+  // 块的第一个键没有公共前缀，可以直接引用
+  std::string_view first_key(uint64_t block) const {
+    const uint8_t *p = blocks + block_offsets[block];
+    uint32_t shared, suffix;
+    p = p ? read_varint(p, blocks_end, shared) : nullptr;
+    p = p ? read_varint(p, blocks_end, suffix) : nullptr;
+    if (!p || suffix > (uint64_t)(blocks_end - p)) {
+      return {};
+    }
+    return std::string_view(reinterpret_cast<const char *>(p), suffix);
+  }
+
+  uint64_t lower_bound(std::string_view key) const;
+  bool key_at(uint64_t ordinal, std::string &key) const;
+};
+
+// 顺序解码基础表中的键
+struct Cursor {
+  const Base &base;
+  uint64_t ordinal = 0;
+  const uint8_t *p = nullptr;
+  std::string key;
+
+  explicit Cursor(const Base &base) : base(base) {}
+
+  bool valid() const { return ordinal < base.keys; }
+
+  bool decode() {
+    if (ordinal % kBlockKeys == 0) {
+      p = base.blocks + base.block_offsets[ordinal / kBlockKeys];
+      key.clear();
+    }
+    uint32_t shared, suffix;
+    p = p ? read_varint(p, base.blocks_end, shared) : nullptr;
+    p = p ? read_varint(p, base.blocks_end, suffix) : nullptr;
+    if (!p || shared > key.size() ||
+        suffix > (uint64_t)(base.blocks_end - p)) {
+      ordinal = base.keys; // 损坏的块：当作结束
+      return false;
+    }
+    key.resize(shared);
+    key.append(reinterpret_cast<const char *>(p), suffix);
+    p += suffix;
+    return true;
+  }
+
+  void seek(uint64_t target) {
+    ordinal = target - target % kBlockKeys;
+    while (ordinal < base.keys && decode() && ordinal < target) {
+      ++ordinal;
+    }
+  }
+
+  void next() {
+    if (++ordinal < base.keys) {
+      decode();
+    }
+  }
+};
+
+uint64_t Base::lower_bound(std::string_view key) const {
+  // 最后一个首键 <= key 的块
+  uint64_t lo = 0, hi = blocks_count;
+  while (lo < hi) {
+    uint64_t mid = (lo + hi) / 2;
+    if (first_key(mid) <= key) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo == 0) {
+    return 0;
+  }
+  Cursor cursor(*this);
+  cursor.seek((lo - 1) * kBlockKeys);
+  uint64_t end = std::min(keys, lo * kBlockKeys);
+  while (cursor.ordinal < end && std::string_view(cursor.key) < key) {
+    cursor.next();
+  }
+  return std::min(cursor.ordinal, end);
+}
+
+bool Base::key_at(uint64_t ordinal, std::string &key) const {
+  Cursor cursor(*this);
+  cursor.seek(ordinal);
+  if (!cursor.valid()) {
+    return false;
+  }
+  key.swap(cursor.key);
+  return true;
+}
+
+// 字节序中大于所有以 prefix 开头的键的最小字符串（UTF-8 中不会出现 0xff）
+static std::string prefix_end(std::string_view prefix) {
+  std::string end(prefix);
+  end.push_back('\xff');
+  return end;
+}
+
+struct Index {
+  Base base;
+  std::map<std::string, uint32_t, std::less<>> delta; // 键 -> 记录号
+  size_t delta_new_keys = 0; // 增量表中基础表没有的键
+  std::vector<Record> records; // 记录号从 base.records_count 开始
+  std::string payload;
+  std::vector<std::string> files; // 文件号从 base.files 开始
+  std::unordered_map<std::string, uint32_t> file_ids;
+  bool file_ids_loaded = false;
+  std::string new_manifest; // 设置后在下次合并或保存时替换基础表中的 manifest
+  bool manifest_changed = false;
+  uint32_t flags = 0;
+
+  size_t size() const { return base.keys + delta_new_keys; }
+
+  std::string_view manifest() const {
+    return manifest_changed ? std::string_view(new_manifest) : base.manifest;
+  }
+
+  bool dirty() const { return !delta.empty() || manifest_changed; }
+
+  bool base_contains(std::string_view key) const {
+    uint64_t ordinal = base.lower_bound(key);
+    std::string found;
+    return ordinal < base.keys && base.key_at(ordinal, found) && found == key;
+  }
+
+  uint32_t file_id(std::string_view path) {
+    if (!file_ids_loaded) {
+      for (uint32_t i = 0; i < base.files; ++i) {
+        file_ids.emplace(std::string(base.file(i)), i);
+      }
+      file_ids_loaded = true;
+    }
+    auto [it, inserted] =
+        file_ids.emplace(std::string(path), (uint32_t)(base.files + files.size()));
+    if (inserted) {
+      files.emplace_back(path);
+    }
+    return it->second;
+  }
+
+  std::string_view file(uint32_t id) const {
+    return id < base.files ? base.file(id)
+                           : std::string_view(files[id - base.files]);
+  }
+
+  Record record(uint32_t id) const {
+    return id < base.records_count ? base.records[id]
+                                   : records[id - base.records_count];
+  }
+
+  const uint8_t *payload_data(uint32_t id, const Record &record) const {
+    return id < base.records_count
+               ? base.payload + record.payload_offset
+               : reinterpret_cast<const uint8_t *>(payload.data()) +
+                     record.payload_offset;
+  }
+
+  void put_key(std::string_view key, uint32_t record_id) {
+    auto it = delta.find(key);
+    if (it != delta.end()) {
+      it->second = record_id;
+      return;
+    }
+    if (!base_contains(key)) {
+      ++delta_new_keys;
+    }
+    delta.emplace(std::string(key), record_id);
+  }
+
+  void insert(std::string_view key, std::string_view alias, bool has_alias,
+              const char *file_path, size_t file_size, bool has_file,
+              const uint8_t *info, size_t info_size) {
+    uint32_t file =
+        has_file ? file_id(std::string_view(file_path, file_size)) : kNoFile;
+    uint32_t record_id = (uint32_t)(base.records_count + records.size());
+    records.push_back(Record{file, (uint32_t)info_size, payload.size()});
+    payload.append(reinterpret_cast<const char *>(info), info_size);
+    put_key(key, record_id);
+    if (has_alias) {
+      put_key(alias, record_id);
+    }
+  }
+
+  bool needs_merge() const {
+    return delta.size() >= std::max<size_t>(kMinMergeKeys, base.keys / 4);
+  }
+
+  bool find(std::string_view key, uint32_t &record_id) const {
+    auto it = delta.find(key);
+    if (it != delta.end()) {
+      record_id = it->second;
+      return true;
+    }
+    uint64_t ordinal = base.lower_bound(key);
+    std::string found;
+    if (ordinal < base.keys && base.key_at(ordinal, found) && found == key) {
+      record_id = base.key_records[ordinal];
+      return true;
+    }
+    return false;
+  }
+
+  // 按字节序遍历以 prefix 开头的键（增量表覆盖基础表），fn 返回 false 时停止
+  template <typename Fn> void for_each_sorted(std::string_view prefix, Fn fn) const {
+    std::string end = prefix_end(prefix);
+    Cursor cursor(base);
+    cursor.seek(base.lower_bound(prefix));
+    uint64_t base_end = base.lower_bound(end);
+    auto it = delta.lower_bound(prefix);
+    auto delta_end = delta.lower_bound(std::string_view(end));
+    while (cursor.ordinal < base_end || it != delta_end) {
+      bool take_delta =
+          cursor.ordinal >= base_end ||
+          (it != delta_end && std::string_view(it->first) <= cursor.key);
+      if (take_delta) {
+        if (cursor.ordinal < base_end && it->first == cursor.key) {
+          cursor.next();
+        }
+        if (!fn(it->first, it->second)) {
+          return;
+        }
+        ++it;
+      } else {
+        if (!fn(cursor.key, base.key_records[cursor.ordinal])) {
+          return;
+        }
+        cursor.next();
+      }
+    }
+  }
+
+  // 按 (键长, 键) 的顺序遍历，与逐层访问前缀树的顺序相同
+  template <typename Fn>
+  void for_each_breadth_first(std::string_view prefix, Fn fn) const {
+    std::string end = prefix_end(prefix);
+    uint32_t lo = (uint32_t)base.lower_bound(prefix);
+    uint32_t hi = (uint32_t)base.lower_bound(end);
+    std::vector<std::pair<std::string_view, uint32_t>> pending;
+    for (auto it = delta.lower_bound(prefix),
+              last = delta.lower_bound(std::string_view(end));
+         it != last; ++it) {
+      pending.emplace_back(it->first, it->second);
+    }
+    std::stable_sort(pending.begin(), pending.end(),
+                     [](const auto &a, const auto &b) {
+                       return a.first.size() < b.first.size();
+                     });
+    size_t next_delta = 0;
+    // lengths 末尾是哨兵；空的基础表没有 lengths
+    const LengthRun *runs_end =
+        base.length_runs ? base.lengths + base.length_runs - 1 : nullptr;
+    const LengthRun *run = runs_end;
+    if (lo < hi) {
+      run = std::lower_bound(base.lengths, runs_end, (uint32_t)prefix.size(),
+                             [](const LengthRun &run, uint32_t length) {
+                               return run.length < length;
+                             });
+    }
+    std::string key;
+    const uint32_t *decoded = nullptr;
+    while (run < runs_end || next_delta < pending.size()) {
+      size_t length = run < runs_end ? run->length : SIZE_MAX;
+      if (next_delta < pending.size()) {
+        length = std::min(length, pending[next_delta].first.size());
+      }
+      // 基础表中这一长度、落在前缀范围内的键是 length_order 的一段
+      const uint32_t *first = base.length_order, *last = base.length_order;
+      if (run < runs_end && run->length == length) {
+        first = std::lower_bound(base.length_order + run[0].begin,
+                                 base.length_order + run[1].begin, lo);
+        last = std::lower_bound(first, base.length_order + run[1].begin, hi);
+        ++run;
+      }
+      size_t delta_last = next_delta;
+      while (delta_last < pending.size() &&
+             pending[delta_last].first.size() == length) {
+        ++delta_last;
+      }
+      while (first < last || next_delta < delta_last) {
+        if (first < last && decoded != first) {
+          if (!base.key_at(*first, key)) {
+            return;
+          }
+          decoded = first;
+        }
+        bool take_delta =
+            first == last ||
+            (next_delta < delta_last &&
+             pending[next_delta].first <= std::string_view(key));
+        if (take_delta) {
+          if (first < last && pending[next_delta].first == key) {
+            ++first;
+          }
+          if (!fn(pending[next_delta].first, pending[next_delta].second)) {
+            return;
+          }
+          ++next_delta;
+        } else {
+          if (!fn(std::string_view(key), base.key_records[*first])) {
+            return;
+          }
+          ++first;
+        }
+      }
+    }
+  }
+
+  void serialize(std::vector<uint8_t> &out) const;
+  void merge();
+};
+
+static void align(std::vector<uint8_t> &out) {
+  out.resize((out.size() + 7) & ~(size_t)7, 0);
+}
+
+template <typename T>
+static Span append(std::vector<uint8_t> &out, const T *items, size_t count) {
+  align(out);
+  Span span{out.size(), count * sizeof(T)};
+  if (count) {
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(items);
+    out.insert(out.end(), bytes, bytes + span.size);
+  }
+  return span;
+}
+
+// 把基础表和增量表合并写成新的基础表，只保留仍被引用的记录和文件
+void Index::serialize(std::vector<uint8_t> &out) const {
+  size_t record_total = base.records_count + records.size();
+  size_t file_total = base.files + files.size();
+  std::vector<uint32_t> record_map(record_total, UINT32_MAX);
+  std::vector<uint32_t> file_map(file_total, UINT32_MAX);
+  std::vector<Record> new_records;
+  std::vector<uint8_t> new_payload;
+  std::vector<uint64_t> file_offsets{0};
+  std::string file_blob;
+  std::vector<uint8_t> blocks;
+  std::vector<uint64_t> block_offsets;
+  std::vector<uint32_t> key_records;
+  std::vector<uint32_t> key_lengths;
+  std::string previous;
+
+  for_each_sorted("", [&](std::string_view key, uint32_t record_id) {
+    uint32_t &mapped = record_map[record_id];
+    if (mapped == UINT32_MAX) {
+      Record record = this->record(record_id);
+      const uint8_t *info = payload_data(record_id, record);
+      if (record.file != kNoFile) {
+        uint32_t &file = file_map[record.file];
+        if (file == UINT32_MAX) {
+          file = (uint32_t)(file_offsets.size() - 1);
+          file_blob.append(this->file(record.file));
+          file_offsets.push_back(file_blob.size());
+        }
+        record.file = file;
+      }
+      record.payload_offset = new_payload.size();
+      new_payload.insert(new_payload.end(), info, info + record.payload_size);
+      mapped = (uint32_t)new_records.size();
+      new_records.push_back(record);
+    }
+    size_t ordinal = key_records.size();
+    uint32_t shared = 0;
+    if (ordinal % kBlockKeys == 0) {
+      block_offsets.push_back(blocks.size());
+    } else {
+      size_t limit = std::min(previous.size(), key.size());
+      while (shared < limit && previous[shared] == key[shared]) {
+        ++shared;
+      }
+    }
+    put_varint(blocks, shared);
+    put_varint(blocks, (uint32_t)(key.size() - shared));
+    blocks.insert(blocks.end(), key.begin() + shared, key.end());
+    previous.assign(key);
+    key_records.push_back(mapped);
+    key_lengths.push_back((uint32_t)key.size());
+    return true;
+  });
+  uint64_t block_count = block_offsets.size();
+  block_offsets.push_back(blocks.size());
+
+  std::vector<uint32_t> length_order(key_records.size());
+  for (uint32_t i = 0; i < length_order.size(); ++i) {
+    length_order[i] = i;
+  }
+  std::stable_sort(length_order.begin(), length_order.end(),
+                   [&](uint32_t a, uint32_t b) {
+                     return key_lengths[a] < key_lengths[b];
+                   });
+  std::vector<LengthRun> lengths;
+  for (uint32_t i = 0; i < length_order.size(); ++i) {
+    uint32_t length = key_lengths[length_order[i]];
+    if (lengths.empty() || lengths.back().length != length) {
+      lengths.push_back(LengthRun{length, i});
+    }
+  }
+  lengths.push_back(LengthRun{UINT32_MAX, (uint32_t)length_order.size()});
+
+  Header header = {};
+  std::memcpy(header.magic, "TRSYMIX1", 8);
+  header.version = kVersion;
+  header.flags = flags;
+  header.key_count = key_records.size();
+  header.record_count = new_records.size();
+  header.file_count = file_offsets.size() - 1;
+  header.block_count = block_count;
+  out.clear();
+  out.resize(sizeof(Header));
+  header.sections[kBlocks] = append(out, blocks.data(), blocks.size());
+  header.sections[kBlockOffsets] =
+      append(out, block_offsets.data(), block_offsets.size());
+  header.sections[kKeyRecords] =
+      append(out, key_records.data(), key_records.size());
+  header.sections[kLengths] = append(out, lengths.data(), lengths.size());
+  header.sections[kLengthOrder] =
+      append(out, length_order.data(), length_order.size());
+  header.sections[kRecords] =
+      append(out, new_records.data(), new_records.size());
+  header.sections[kPayload] =
+      append(out, new_payload.data(), new_payload.size());
+  header.sections[kFileOffsets] =
+      append(out, file_offsets.data(), file_offsets.size());
+  header.sections[kFileBlob] =
+      append(out, file_blob.data(), file_blob.size());
+  std::string_view manifest = this->manifest();
+  header.sections[kManifest] = append(out, manifest.data(), manifest.size());
+  align(out);
+  std::memcpy(out.data(), &header, sizeof(header));
+}
+
+void Index::merge() {
+  std::vector<uint8_t> merged;
+  serialize(merged);
+  base.release();
+  base.owned.swap(merged);
+  base.attach(base.owned.data(), base.owned.size());
+  delta.clear();
+  delta_new_keys = 0;
+  records.clear();
+  payload.clear();
+  payload.shrink_to_fit();
+  files.clear();
+  file_ids.clear();
+  file_ids_loaded = false;
+  new_manifest.clear();
+  manifest_changed = false;
+}
+
+// 先写同目录下的临时文件再改名，已映射旧文件的进程不受影响；
+// 临时文件名唯一，多个进程同时刷新同一索引时不会互相覆盖
+static bool write_file(const std::string &path,
+                       const std::vector<uint8_t> &bytes) {
+#ifndef PLATFORM_WINDOWS
+  std::string tmp = path + ".XXXXXX";
+  int fd = mkstemp(tmp.data());
+  if (fd < 0) {
+    return false;
+  }
+  fchmod(fd, 0644);
+  FILE *f = fdopen(fd, "wb");
+  if (!f) {
+    ::close(fd);
+    std::remove(tmp.c_str());
+    return false;
+  }
+#else
+  std::string tmp = path + ".tmp";
+  FILE *f = std::fopen(tmp.c_str(), "wb");
+  if (!f) {
+    return false;
+  }
+#endif
+  bool ok = std::fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+  ok = std::fclose(f) == 0 && ok;
+  if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+    std::remove(tmp.c_str());
+    return false;
+  }
+  return true;
+}
+
+// 映射索引文件；不支持 mmap 的平台读入内存
+static bool map_file(const char *path, Base &base) {
+#ifndef PLATFORM_WINDOWS
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  void *mapped = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  ::close(fd);
+  if (mapped == MAP_FAILED) {
+    return false;
+  }
+  base.mapped = mapped;
+  base.mapped_size = st.st_size;
+  return true;
+#else
+  FILE *f = std::fopen(path, "rb");
+  if (!f) {
+    return false;
+  }
+  std::fseek(f, 0, SEEK_END);
+  long size = std::ftell(f);
+  std::fseek(f, 0, SEEK_SET);
+  base.owned.resize(size > 0 ? size : 0);
+  bool ok = size > 0 && std::fread(base.owned.data(), 1, size, f) ==
+                            (size_t)size;
+  std::fclose(f);
+  return ok;
+#endif
+}
+
+} // namespace symbol_index
+
+typedef struct {
+  PyObject_HEAD symbol_index::Index *index;
+} SymbolIndexObject;
+
+static SymbolIndexObject *SymbolIndex_alloc(PyTypeObject *type) {
+  SymbolIndexObject *self = (SymbolIndexObject *)type->tp_alloc(type, 0);
+  if (self) {
+    self->index = new symbol_index::Index();
+  }
+  return self;
+}
+
+static PyObject *SymbolIndex_new(PyTypeObject *type, PyObject *args,
+                                 PyObject *kwargs) {
+  static const char *kwlist[] = {"case_sensitive", nullptr};
+  int case_sensitive = 1;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|p", (char **)kwlist,
+                                   &case_sensitive)) {
+    return nullptr;
+  }
+  SymbolIndexObject *self = SymbolIndex_alloc(type);
+  if (self && !case_sensitive) {
+    self->index->flags |= symbol_index::kCaseInsensitive;
+  }
+  return (PyObject *)self;
+}
+
+static void SymbolIndex_dealloc(SymbolIndexObject *self) {
+  PyTypeObject *type = Py_TYPE(self);
+  delete self->index;
+  type->tp_free((PyObject *)self);
+  Py_DECREF(type); // 堆类型的实例持有类型的引用
+}
+
+static PyObject *decode(std::string_view text) {
+  return PyUnicode_DecodeUTF8(text.data(), text.size(), "replace");
+}
+
+// (file_path 或 None, 符号信息字节)；给出 key 时在前面加上键
+static PyObject *make_value(const symbol_index::Index &index,
+                            uint32_t record_id, const std::string_view *key) {
+  symbol_index::Record record = index.record(record_id);
+  PyObject *name = key ? decode(*key) : nullptr;
+  PyObject *file = record.file == symbol_index::kNoFile
+                       ? Py_NewRef(Py_None)
+                       : decode(index.file(record.file));
+  PyObject *info = PyBytes_FromStringAndSize(
+      reinterpret_cast<const char *>(index.payload_data(record_id, record)),
+      record.payload_size);
+  if ((key && !name) || !file || !info) {
+    Py_XDECREF(name);
+    Py_XDECREF(file);
+    Py_XDECREF(info);
+    return nullptr;
+  }
+  return key ? Py_BuildValue("(NNN)", name, file, info)
+             : Py_BuildValue("(NN)", file, info);
+}
+
+static bool as_utf8(PyObject *text, std::string_view &out) {
+  Py_ssize_t size;
+  const char *data = PyUnicode_AsUTF8AndSize(text, &size);
+  if (!data) {
+    return false;
+  }
+  out = std::string_view(data, size);
+  return true;
+}
+
+static PyObject *SymbolIndex_insert(SymbolIndexObject *self, PyObject *args,
+                                    PyObject *kwargs) {
+  static const char *kwlist[] = {"key", "file_path", "info", "alias",
+                                 nullptr};
+  PyObject *key, *file = Py_None, *alias = Py_None;
+  Py_buffer info;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "UOy*|O", (char **)kwlist,
+                                   &key, &file, &info, &alias)) {
+    return nullptr;
+  }
+  std::string_view key_text, file_text, alias_text;
+  bool ok = as_utf8(key, key_text) &&
+            (file == Py_None || (PyUnicode_Check(file) &&
+                                 as_utf8(file, file_text))) &&
+            (alias == Py_None ||
+             (PyUnicode_Check(alias) && as_utf8(alias, alias_text)));
+  if (ok && info.len > UINT32_MAX) {
+    PyErr_SetString(PyExc_OverflowError, "symbol info is too large");
+    ok = false;
+  }
+  if (!ok) {
+    if (!PyErr_Occurred()) {
+      PyErr_SetString(PyExc_TypeError, "file_path and alias must be str");
+    }
+    PyBuffer_Release(&info);
+    return nullptr;
+  }
+  symbol_index::Index &index = *self->index;
+  index.insert(key_text, alias_text, alias != Py_None, file_text.data(),
+               file_text.size(), file != Py_None,
+               static_cast<const uint8_t *>(info.buf), info.len);
+  PyBuffer_Release(&info);
+  if (index.needs_merge()) {
+    index.merge();
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject *SymbolIndex_search_exact(SymbolIndexObject *self,
+                                          PyObject *arg) {
+  std::string_view key;
+  if (!PyUnicode_Check(arg)) {
+    PyErr_SetString(PyExc_TypeError, "key must be str");
+    return nullptr;
+  }
+  if (!as_utf8(arg, key)) {
+    return nullptr;
+  }
+  uint32_t record_id;
+  if (!self->index->find(key, record_id)) {
+    Py_RETURN_NONE;
+  }
+  return make_value(*self->index, record_id, nullptr);
+}
+
+static PyObject *SymbolIndex_search_prefix(SymbolIndexObject *self,
+                                           PyObject *args, PyObject *kwargs) {
+  static const char *kwlist[] = {"prefix", "max_results", "bfs", nullptr};
+  PyObject *prefix, *max_obj = Py_None;
+  int bfs = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "U|Op", (char **)kwlist,
+                                   &prefix, &max_obj, &bfs)) {
+    return nullptr;
+  }
+  Py_ssize_t max_results = PY_SSIZE_T_MAX;
+  if (max_obj != Py_None) {
+    max_results = PyLong_AsSsize_t(max_obj);
+    if (max_results == -1 && PyErr_Occurred()) {
+      return nullptr;
+    }
+  }
+  std::string_view prefix_text;
+  if (!as_utf8(prefix, prefix_text)) {
+    return nullptr;
+  }
+  PyObject *results = PyList_New(0);
+  if (!results || max_results <= 0) {
+    return results;
+  }
+  const symbol_index::Index &index = *self->index;
+  bool failed = false;
+  auto collect = [&](std::string_view key, uint32_t record_id) {
+    PyObject *item = make_value(index, record_id, &key);
+    if (!item || PyList_Append(results, item) < 0) {
+      Py_XDECREF(item);
+      failed = true;
+      return false;
+    }
+    Py_DECREF(item);
+    return PyList_GET_SIZE(results) < max_results;
+  };
+  if (bfs) {
+    index.for_each_breadth_first(prefix_text, collect);
+  } else {
+    index.for_each_sorted(prefix_text, collect);
+  }
+  if (failed) {
+    Py_DECREF(results);
+    return nullptr;
+  }
+  return results;
+}
+
+static PyObject *SymbolIndex_merge(SymbolIndexObject *self, PyObject *) {
+  self->index->merge();
+  Py_RETURN_NONE;
+}
+
+static PyObject *SymbolIndex_save(SymbolIndexObject *self, PyObject *arg) {
+  PyObject *path_bytes;
+  if (!PyUnicode_FSConverter(arg, &path_bytes)) {
+    return nullptr;
+  }
+  std::string path(PyBytes_AS_STRING(path_bytes),
+                   PyBytes_GET_SIZE(path_bytes));
+  Py_DECREF(path_bytes);
+  symbol_index::Index &index = *self->index;
+  std::vector<uint8_t> bytes;
+  if (!index.dirty() && index.base.data) {
+    // 没有待合并的修改时基础表就是文件内容
+    bytes.assign(index.base.data,
+                 index.base.data + (index.base.mapped ? index.base.mapped_size
+                                                      : index.base.owned.size()));
+  } else {
+    index.serialize(bytes);
+  }
+  PyThreadState *save = PyEval_SaveThread();
+  bool ok = symbol_index::write_file(path, bytes);
+  PyEval_RestoreThread(save);
+  if (!ok) {
+    return PyErr_SetFromErrnoWithFilename(PyExc_OSError, path.c_str());
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject *SymbolIndex_stats(SymbolIndexObject *self, PyObject *) {
+  const symbol_index::Index &index = *self->index;
+  return Py_BuildValue(
+      "{snsnsnsnsnsO}", "keys", (Py_ssize_t)index.size(), "base_keys",
+      (Py_ssize_t)index.base.keys, "delta_keys", (Py_ssize_t)index.delta.size(),
+      "records", (Py_ssize_t)(index.base.records_count + index.records.size()),
+      "base_bytes",
+      (Py_ssize_t)(index.base.mapped ? index.base.mapped_size
+                                     : index.base.owned.size()),
+      "mapped", index.base.mapped ? Py_True : Py_False);
+}
+
+static Py_ssize_t SymbolIndex_len(PyObject *self) {
+  return ((SymbolIndexObject *)self)->index->size();
+}
+
+static PyObject *SymbolIndex_get_case_sensitive(SymbolIndexObject *self,
+                                                void *) {
+  return PyBool_FromLong(
+      !(self->index->flags & symbol_index::kCaseInsensitive));
+}
+
+static PyObject *SymbolIndex_get_manifest(SymbolIndexObject *self,
+                                          void *) {
+  std::string_view manifest = self->index->manifest();
+  return PyBytes_FromStringAndSize(manifest.data(), manifest.size());
+}
+
+static int SymbolIndex_set_manifest(SymbolIndexObject *self, PyObject *value,
+                                    void *) {
+  if (!value) {
+    PyErr_SetString(PyExc_AttributeError, "cannot delete manifest");
+    return -1;
+  }
+  Py_buffer view;
+  if (PyObject_GetBuffer(value, &view, PyBUF_SIMPLE) < 0) {
+    return -1;
+  }
+  symbol_index::Index &index = *self->index;
+  index.new_manifest.assign(static_cast<const char *>(view.buf), view.len);
+  index.manifest_changed = true;
+  PyBuffer_Release(&view);
+  return 0;
+}
+
+static PyMethodDef SymbolIndex_methods[] = {
+    {"insert", (PyCFunction)(void (*)(void))SymbolIndex_insert,
+     METH_VARARGS | METH_KEYWORDS,
+     "insert(key, file_path, info, alias=None)\n"
+     "Map key (and alias) to a new symbol record, replacing earlier ones"},
+    {"search_exact", (PyCFunction)SymbolIndex_search_exact, METH_O,
+     "search_exact(key) -> (file_path, info) or None"},
+    {"search_prefix", (PyCFunction)(void (*)(void))SymbolIndex_search_prefix,
+     METH_VARARGS | METH_KEYWORDS,
+     "search_prefix(prefix, max_results=None, bfs=False) -> "
+     "[(key, file_path, info)]\n"
+     "Keys in byte order, or by (length, key) when bfs is true"},
+    {"merge", (PyCFunction)SymbolIndex_merge, METH_NOARGS,
+     "Fold pending inserts into the sorted table"},
+    {"save", (PyCFunction)SymbolIndex_save, METH_O,
+     "save(path): write the index in the format open_index maps"},
+    {"stats", (PyCFunction)SymbolIndex_stats, METH_NOARGS,
+     "Key, record and memory counts"},
+    {nullptr, nullptr, 0, nullptr}};
+
+static PyGetSetDef SymbolIndex_getset[] = {
+    {"case_sensitive", (getter)SymbolIndex_get_case_sensitive, nullptr,
+     "Whether keys were inserted without case folding", nullptr},
+    {"manifest", (getter)SymbolIndex_get_manifest,
+     (setter)SymbolIndex_set_manifest,
+     "Opaque bytes saved with the index (written by save and merge)", nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr}};
+
+// 用 PyType_Spec 按槽位名称创建类型，PyInit_symbol_core 中生成
+static PyType_Slot SymbolIndex_slots[] = {
+    {Py_tp_dealloc, (void *)SymbolIndex_dealloc},
+    {Py_tp_doc,
+     (void *)"Sorted, front-coded symbol table with a packed record array"},
+    {Py_tp_methods, SymbolIndex_methods},
+    {Py_tp_getset, SymbolIndex_getset},
+    {Py_tp_new, (void *)SymbolIndex_new},
+    {Py_sq_length, (void *)SymbolIndex_len},
+    {0, nullptr}};
+
+static PyType_Spec SymbolIndex_spec = {"symbol_core.SymbolIndex",
+                                       sizeof(SymbolIndexObject), 0,
+                                       Py_TPFLAGS_DEFAULT, SymbolIndex_slots};
+
+static PyTypeObject *SymbolIndexType = nullptr;
+
+static PyObject *open_index(PyObject *, PyObject *arg) {
+  PyObject *path_bytes;
+  if (!PyUnicode_FSConverter(arg, &path_bytes)) {
+    return nullptr;
+  }
+  const char *path = PyBytes_AS_STRING(path_bytes);
+  SymbolIndexObject *self = SymbolIndex_alloc(SymbolIndexType);
+  if (!self) {
+    Py_DECREF(path_bytes);
+    return nullptr;
+  }
+  symbol_index::Base &base = self->index->base;
+  if (!symbol_index::map_file(path, base)) {
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
+    Py_DECREF(path_bytes);
+    Py_DECREF(self);
+    return nullptr;
+  }
+  const uint8_t *data = base.mapped
+                            ? static_cast<const uint8_t *>(base.mapped)
+                            : base.owned.data();
+  size_t size = base.mapped ? base.mapped_size : base.owned.size();
+  if (!base.attach(data, size)) {
+    PyErr_Format(PyExc_ValueError, "not a symbol index: %s", path);
+    Py_DECREF(path_bytes);
+    Py_DECREF(self);
+    return nullptr;
+  }
+  self->index->flags = base.header->flags;
+  Py_DECREF(path_bytes);
+  return (PyObject *)self;
+}
+
+/*
+区间索引：按起点排序的数组上的隐式区间树（以 [lo, hi) 的中点为子树根），
+每个节点记录子树内的最大终点，查询包含某个位置的全部区间为 O(log n + k)。
+ast.py 用它按行列或字节偏移查找包含某个位置的符号，区间是闭区间 [start, end]。
+*/
+namespace interval_index {
+
+struct Index {
+  std::vector<uint64_t> starts, ends, max_ends;
+  std::vector<uint32_t> ids; // 区间在构造参数中的序号
+
+  void build(std::vector<std::pair<std::pair<uint64_t, uint64_t>, uint32_t>>
+                 &items) {
+    std::sort(items.begin(), items.end());
+    starts.resize(items.size());
+    ends.resize(items.size());
+    ids.resize(items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+      starts[i] = items[i].first.first;
+      ends[i] = items[i].first.second;
+      ids[i] = items[i].second;
+    }
+    max_ends = ends;
+    fill_max_end(0, items.size());
+  }
+
+  uint64_t fill_max_end(size_t lo, size_t hi) {
+    if (lo >= hi) {
+      return 0;
+    }
+    size_t mid = lo + (hi - lo) / 2;
+    uint64_t result = std::max({ends[mid], fill_max_end(lo, mid),
+                                fill_max_end(mid + 1, hi)});
+    max_ends[mid] = result;
+    return result;
+  }
+
+  void stab(uint64_t pos, std::vector<uint32_t> &out) const {
+    std::vector<std::pair<size_t, size_t>> stack;
+    stack.emplace_back(0, starts.size());
+    while (!stack.empty()) {
+      auto [lo, hi] = stack.back();
+      stack.pop_back();
+      if (lo >= hi) {
+        continue;
+      }
+      size_t mid = lo + (hi - lo) / 2;
+      if (max_ends[mid] < pos) {
+        continue; // 子树里没有终点够得着 pos 的区间
+      }
+      stack.emplace_back(lo, mid);
+      if (starts[mid] <= pos) {
+        if (ends[mid] >= pos) {
+          out.push_back(ids[mid]);
+        }
+        stack.emplace_back(mid + 1, hi);
+      }
+    }
+    std::sort(out.begin(), out.end());
+  }
+};
+
+} // namespace interval_index
+
+typedef struct {
+  PyObject_HEAD interval_index::Index *index;
+} IntervalIndexObject;
+
+static PyObject *IntervalIndex_new(PyTypeObject *type, PyObject *args,
+                                   PyObject *kwargs) {
+  static const char *kwlist[] = {"ranges", nullptr};
+  PyObject *ranges;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O", (char **)kwlist,
+                                   &ranges)) {
+    return nullptr;
+  }
+  PyObject *sequence = PySequence_Fast(ranges, "ranges must be a sequence");
+  if (!sequence) {
+    return nullptr;
+  }
+  Py_ssize_t count = PySequence_Fast_GET_SIZE(sequence);
+  if ((size_t)count > UINT32_MAX) {
+    Py_DECREF(sequence);
+    PyErr_SetString(PyExc_OverflowError, "too many ranges");
+    return nullptr;
+  }
+  std::vector<std::pair<std::pair<uint64_t, uint64_t>, uint32_t>> items;
+  items.reserve(count);
+  for (Py_ssize_t i = 0; i < count; ++i) {
+    unsigned long long start, end;
+    if (!PyArg_ParseTuple(PySequence_Fast_GET_ITEM(sequence, i), "KK", &start,
+                          &end)) {
+      Py_DECREF(sequence);
+      return nullptr;
+    }
+    items.push_back({{start, end}, (uint32_t)i});
+  }
+  Py_DECREF(sequence);
+  IntervalIndexObject *self = (IntervalIndexObject *)type->tp_alloc(type, 0);
+  if (!self) {
+    return nullptr;
+  }
+  self->index = new interval_index::Index();
+  self->index->build(items);
+  return (PyObject *)self;
+}
+
+static void IntervalIndex_dealloc(IntervalIndexObject *self) {
+  PyTypeObject *type = Py_TYPE(self);
+  delete self->index;
+  type->tp_free((PyObject *)self);
+  Py_DECREF(type); // 堆类型的实例持有类型的引用
+}
+
+static PyObject *IntervalIndex_stab(IntervalIndexObject *self, PyObject *arg) {
+  unsigned long long pos = PyLong_AsUnsignedLongLong(arg);
+  if (pos == (unsigned long long)-1 && PyErr_Occurred()) {
+    if (!PyErr_ExceptionMatches(PyExc_OverflowError)) {
+      return nullptr;
+    }
+    PyErr_Clear();
+    return PyList_New(0); // 负数位置不在任何区间内
+  }
+  std::vector<uint32_t> ids;
+  self->index->stab(pos, ids);
+  PyObject *list = PyList_New((Py_ssize_t)ids.size());
+  for (size_t i = 0; list && i < ids.size(); ++i) {
+    PyList_SET_ITEM(list, (Py_ssize_t)i, PyLong_FromUnsignedLong(ids[i]));
+  }
+  return list;
+}
+
+static Py_ssize_t IntervalIndex_len(PyObject *self) {
+  return (Py_ssize_t)((IntervalIndexObject *)self)->index->starts.size();
+}
+
+static PyMethodDef IntervalIndex_methods[] = {
+    {"stab", (PyCFunction)IntervalIndex_stab, METH_O,
+     "stab(pos) -> [id]\n"
+     "Ids (positions in ranges) of the ranges with start <= pos <= end, "
+     "ascending"},
+    {nullptr, nullptr, 0, nullptr}};
+
+static PyType_Slot IntervalIndex_slots[] = {
+    {Py_tp_dealloc, (void *)IntervalIndex_dealloc},
+    {Py_tp_doc,
+     (void *)"IntervalIndex(ranges): static index of closed [start, end] ranges"},
+    {Py_tp_methods, IntervalIndex_methods},
+    {Py_tp_new, (void *)IntervalIndex_new},
+    {Py_sq_length, (void *)IntervalIndex_len},
+    {0, nullptr}};
+
+static PyType_Spec IntervalIndex_spec = {
+    "symbol_core.IntervalIndex", sizeof(IntervalIndexObject), 0,
+    Py_TPFLAGS_DEFAULT, IntervalIndex_slots};
+
+static PyMethodDef symbol_core_methods[] = {
+    {"open_index", open_index, METH_O,
+     "open_index(path) -> SymbolIndex\n"
+     "Memory-map an index written by SymbolIndex.save"},
+    {nullptr, nullptr, 0, nullptr}};
+
+static struct PyModuleDef symbol_core_module = {
+    PyModuleDef_HEAD_INIT,
+    "symbol_core",
+    "Compact symbol index for tree.py",
+    -1,
+    symbol_core_methods,
+    nullptr, /* m_slots */
+    nullptr, /* m_traverse */
+    nullptr, /* m_clear */
+    nullptr, /* m_free */
+};
+
+// 由 spec 创建类型并加入模块；给出 out 时另外保存一份引用供 C 代码使用
+static bool add_type(PyObject *module, const char *name, PyType_Spec *spec,
+                     PyTypeObject **out = nullptr) {
+  PyObject *type = PyType_FromSpec(spec);
+  if (!type) {
+    return false;
+  }
+  if (out) {
+    *out = (PyTypeObject *)Py_NewRef(type);
+  }
+  if (PyModule_AddObject(module, name, type) < 0) {
+    Py_DECREF(type);
+    return false;
+  }
+  return true;
+}
+
+PyMODINIT_FUNC PyInit_symbol_core(void) {
+  PyObject *module = PyModule_Create(&symbol_core_module);
+  if (!module) {
+    return nullptr;
+  }
+  if (!add_type(module, "SymbolIndex", &SymbolIndex_spec, &SymbolIndexType) ||
+      !add_type(module, "IntervalIndex", &IntervalIndex_spec)) {
+    Py_DECREF(module);
+    return nullptr;
+  }
+  return module;
+}
@@ -31,10 +31,20 @@ def clamp(value: int, min_val: int, max_val: int) -> int:
 # --- Centralized Caching and Parsing Logic ---
 
 
-def _update_trie_from_code_map(file_path: str, code_map: Dict[str, Any], state: WebServiceState, parser: ParserUtil):
-    """Helper to update the file_symbol_trie with symbols from a given code_map."""
+def _update_trie_from_code_map(
+    file_path: str,
+    code_map: Dict[str, Any],
+    state: WebServiceState,
+    parser: ParserUtil,
+    paths: Optional[List[str]] = None,
+):
+    """Helper to update the file_symbol_trie with symbols from a given code_map.
+
+    When paths is given only those symbols (e.g. the ones changed by an incremental re-parse) are inserted.
+    """
     rel_path = state.config.relative_path(file_path)
-    for path, info in code_map.items():
+    for path in code_map if paths is None else paths:
+        info = code_map[path]
         # The key in the trie should be fully qualified for global uniqueness.
         full_path = f"symbol:{rel_path}/{path}"
         # The symbol_info object itself should contain the relative path.
@@ -72,86 +82,46 @@ async def _get_cached_file_data(
         logger.debug(f"_get_cached_file_data: File not found or OS error for '{rel_path}' (abs: '{abs_path}'): {e}")
         return None, None
 
-    # Step 3: Use asyncio loop for lock (as before)
+    # Step 3: Check the cache and parse in a worker thread. The cached ParserUtil keeps the previous
+    # syntax tree and is modified by the incremental re-parse, so the whole check-parse-update runs under state.lock.
     loop = asyncio.get_running_loop()
-    logger.debug(f"_get_cached_file_data: Acquired event loop for '{rel_path}'")
+    return await loop.run_in_executor(None, _load_file_data, rel_path, abs_path, current_mtime, state)
 
-    # First, check cache with the lock (use rel_path as key for consistency)
-    logger.debug(f"_get_cached_file_data: Acquiring lock to check cache for '{rel_path}'")
-    await loop.run_in_executor(None, state.lock.acquire)
-    try:
-        if rel_path in state.file_parser_info_cache:
-            cached_mtime, parser, code_map = state.file_parser_info_cache[rel_path]
-            logger.debug(f"_get_cached_file_data: Found cached entry for '{rel_path}' with mtime {cached_mtime}")
-            if cached_mtime == current_mtime:
-                logger.info(
-                    f"_get_cached_file_data: Cache hit for '{rel_path}' - returning cached data"
-                )  # Upgraded to info for better visibility
-                return parser, code_map
-            else:
-                logger.debug(
-                    f"_get_cached_file_data: Cache stale for '{rel_path}' - cached: {cached_mtime}, current: {current_mtime}"
-                )
-        else:
-            logger.debug(f"_get_cached_file_data: No cached entry found for '{rel_path}'")
-    finally:
-        state.lock.release()
-        logger.debug(f"_get_cached_file_data: Released lock after cache check for '{rel_path}'")
-
-    # If not in cache or modified, parse the file (outside the lock to avoid blocking)
-    logger.info(f"File '{rel_path}' (abs: '{abs_path}') has been modified or is new, parsing...")
-    logger.debug(f"_get_cached_file_data: Starting file parsing for '{rel_path}'")
-    parser_loader = ParserLoader()
-    parser = ParserUtil(parser_loader)
-    try:
-        paths, code_map = parser.get_symbol_paths(abs_path)  # Parse using absolute path
-        logger.debug(
-            f"_get_cached_file_data: Successfully parsed '{rel_path}' - found {len(code_map) if code_map else 0} symbols"
-        )
-    except (ValueError, FileNotFoundError) as e:
-        logger.warning(f"Error parsing {rel_path} (abs: '{abs_path}'): {e}")
-        logger.debug(f"_get_cached_file_data: Caching parse failure for '{rel_path}'")
-        # Cache failure to avoid re-parsing a broken file repeatedly
-        await loop.run_in_executor(None, state.lock.acquire)
-        try:
-            state.file_parser_info_cache[rel_path] = (current_mtime, None, None)
-            logger.debug(f"_get_cached_file_data: Cached parse failure for '{rel_path}' with mtime {current_mtime}")
-        finally:
-            state.lock.release()
-        return None, None
 
-    # After parsing, acquire lock to update cache and trie
-    logger.debug(f"_get_cached_file_data: Acquiring lock to update cache for '{rel_path}'")
-    await loop.run_in_executor(None, state.lock.acquire)
-    try:
-        # Re-check in case another thread parsed and cached it while we were parsing
-        if rel_path in state.file_parser_info_cache:
-            cached_mtime, cached_parser, cached_code_map = state.file_parser_info_cache[rel_path]
+def _load_file_data(
+    rel_path: str, abs_path: str, current_mtime: float, state: WebServiceState
+) -> Tuple[Optional[ParserUtil], Optional[Dict[str, Any]]]:
+    """Synchronous part of _get_cached_file_data; runs in the executor while holding state.lock.
+
+    Cache entries are (mtime, parser, code_map). mtime is None when the code_map was built from an unsaved
+    editor buffer (didChange), so the next lookup re-parses the file on disk.
+    """
+    with state.lock:
+        cached = state.file_parser_info_cache.get(rel_path)
+        cached_mtime, parser, code_map = cached if isinstance(cached, tuple) else (None, None, None)
+        if cached_mtime is not None and cached_mtime == current_mtime:
+            logger.info(f"_get_cached_file_data: Cache hit for '{rel_path}' - returning cached data")
+            return parser, code_map
+        logger.debug(f"_get_cached_file_data: Cache stale or missing for '{rel_path}' - cached mtime: {cached_mtime}")
+
+        # A cached parser keeps the previous syntax tree, so a modified file is re-parsed incrementally.
+        logger.info(f"File '{rel_path}' (abs: '{abs_path}') has been modified or is new, parsing...")
+        parser = parser or ParserUtil(ParserLoader())
+        try:
+            paths, code_map, changed_paths = parser.update_symbol_paths(abs_path)  # Parse using absolute path
             logger.debug(
-                f"_get_cached_file_data: Re-checking cache for '{rel_path}' - cached mtime: {cached_mtime}, current: {current_mtime}"
+                f"_get_cached_file_data: Successfully parsed '{rel_path}' - found {len(code_map) if code_map else 0} symbols"
             )
-            if cached_mtime >= current_mtime:
-                logger.info(
-                    f"_get_cached_file_data: Another thread cached newer data for '{rel_path}' - using cached version"
-                )  # Upgraded to info
-                return cached_parser, cached_code_map
-
-        # Update cache and trie
-        logger.debug(f"_get_cached_file_data: Updating cache for '{rel_path}' with mtime {current_mtime}")
-        state.file_parser_info_cache[rel_path] = (current_mtime, parser, code_map)
-
-        logger.debug(f"_get_cached_file_data: Updating trie for '{rel_path}'")
-        _update_trie_from_code_map(
-            abs_path, code_map, state, parser
-        )  # Pass original abs_path if needed, but rel_path is computed inside
+        except (ValueError, FileNotFoundError) as e:
+            logger.warning(f"Error parsing {rel_path} (abs: '{abs_path}'): {e}")
+            # Cache failure to avoid re-parsing a broken file repeatedly
+            state.file_parser_info_cache[rel_path] = (current_mtime, None, None)
+            return None, None
 
-        logger.info(
-            f"_get_cached_file_data: Successfully cached and updated trie for '{rel_path}'"
-        )  # Upgraded to info for visibility
+        state.file_parser_info_cache[rel_path] = (current_mtime, parser, code_map)
+        _update_trie_from_code_map(abs_path, code_map, state, parser, changed_paths)
+        logger.info(f"_get_cached_file_data: Successfully cached and updated trie for '{rel_path}'")
         return parser, code_map
-    finally:
-        state.lock.release()
-        logger.debug(f"_get_cached_file_data: Released lock after cache update for '{rel_path}'")
 
 
 # --- Handler for /complete ---
@@ -354,6 +324,7 @@ class LSPCallResolver:
             file_path=rel_def_path,
             file_parser_info_cache=self.state.file_parser_info_cache,
             search_exact=True,
+            lock=self.state.lock,
         )
 
         collected = []
@@ -586,8 +557,33 @@ def _enrich_symbols_with_content(symbols: List[Dict[str, Any]]) -> List[Dict[str
     return enriched_list
 
 
+def _apply_did_change_to_symbols(file_path: str, content: str, state: WebServiceState) -> None:
+    """用编辑器中的内容增量更新已缓存文件的 code_map 和 file_symbol_trie，未打开过的文件等到查询时再解析
+
+    在线程池中运行，解析和缓存更新都在 state.lock 内完成。
+    """
+    clean_file_path = file_path.removeprefix("symbol:")
+    rel_path = state.config.relative_path(clean_file_path)
+    with state.lock:
+        cached = state.file_parser_info_cache.get(rel_path)
+        if not isinstance(cached, tuple) or cached[1] is None:
+            return
+        _, parser, _ = cached
+        abs_path = state.config.absolute_path(rel_path)
+        _, code_map, changed_paths = parser.update_symbol_paths(abs_path, content.encode("utf-8"))
+        # mtime 记为 None：code_map 来自未保存的缓冲区，下次按磁盘内容查询时重新（增量）解析
+        state.file_parser_info_cache[rel_path] = (None, parser, code_map)
+        _update_trie_from_code_map(abs_path, code_map, state, parser, changed_paths)
+    logger.debug("Updated %d symbols of %s from didChange", len(changed_paths), rel_path)
+
+
 # --- Handler for /lsp/didChange ---
 async def handle_lsp_did_change(file_path: str, content: str, state: WebServiceState) -> JSONResponse | Dict:
+    try:
+        loop = asyncio.get_running_loop()
+        await loop.run_in_executor(None, _apply_did_change_to_symbols, file_path, content, state)
+    except Exception as e:
+        logger.warning("Failed to update symbols from didChange for %s: %s", file_path, e)
     try:
         client = state.get_lsp_client(file_path)
         if not client or not client.running:
@@ -654,6 +650,7 @@ async def handle_symbol_completion_realtime(prefix: str, max_results: int, state
             file_path=file_path,
             file_parser_info_cache=state.file_parser_info_cache,
             use_bfs=True,
+            lock=state.lock,
         )
     completions = _build_completion_results(file_path, symbols, results)
     return PlainTextResponse("\n".join(completions))